@@ -34,6 +34,9 @@ import vmtk.vmtkmeshreader as meshreader
 import vmtk.vmtkmeshwriter as meshwriter
 import vmtk.vmtkmeshcompare as meshcompare
 
+import vtk
+from vmtk import vtkvmtk
+
 
 @pytest.fixture(scope='module')
 def input_datadir():
@@ -412,3 +415,100 @@ def compare_meshes(mesh_reference_datadir):
 
         return comp.Result
     return make_compare_meshes
+
+
+# **************************************************
+# Velocity Fields and Particle Tracing
+# **************************************************
+
+
+@pytest.fixture(scope='module')
+def velocity_grid():
+    def make_velocity_grid(velocity_per_timestep, tetrahedralize=False, dimensions=(11, 11, 11)):
+        '''A unit-spacing grid centered on the origin, 11x11x11 by default, with
+        one vector array "Velocity_<i>" per requested time step, optionally
+        tetrahedralized into an unstructured grid. A time step is either a
+        uniform velocity or a callable returning the velocity of a point from
+        its id and coordinates.'''
+        grid = vtk.vtkImageData()
+        grid.SetDimensions(*dimensions)
+        grid.SetSpacing(1.0, 1.0, 1.0)
+        grid.SetOrigin(*[-0.5 * (d - 1) for d in dimensions])
+        numberOfPoints = grid.GetNumberOfPoints()
+        for index, velocity in enumerate(velocity_per_timestep):
+            array = vtk.vtkDoubleArray()
+            array.SetName('Velocity_%d' % index)
+            array.SetNumberOfComponents(3)
+            array.SetNumberOfTuples(numberOfPoints)
+            for i in range(numberOfPoints):
+                if callable(velocity):
+                    array.SetTuple3(i, *velocity(i, grid.GetPoint(i)))
+                else:
+                    array.SetTuple3(i, *velocity)
+            grid.GetPointData().AddArray(array)
+        if not tetrahedralize:
+            return grid
+        triangleFilter = vtk.vtkDataSetTriangleFilter()
+        triangleFilter.SetInputData(grid)
+        triangleFilter.Update()
+        return triangleFilter.GetOutput()
+    return make_velocity_grid
+
+
+@pytest.fixture(scope='module')
+def time_steps_table():
+    def make_time_steps_table(times):
+        table = vtk.vtkTable()
+        indexColumn = vtk.vtkIntArray()
+        indexColumn.SetName('index')
+        timeColumn = vtk.vtkDoubleArray()
+        timeColumn.SetName('time')
+        for i, t in enumerate(times):
+            indexColumn.InsertNextValue(i)
+            timeColumn.InsertNextValue(t)
+        table.AddColumn(indexColumn)
+        table.AddColumn(timeColumn)
+        return table
+    return make_time_steps_table
+
+
+@pytest.fixture(scope='module')
+def seed_points():
+    def make_seed_points(points):
+        seedPoints = vtk.vtkPoints()
+        for point in points:
+            seedPoints.InsertNextPoint(point)
+        seeds = vtk.vtkPolyData()
+        seeds.SetPoints(seedPoints)
+        return seeds
+    return make_seed_points
+
+
+@pytest.fixture(scope='module')
+def run_tracer():
+    def make_run_tracer(mesh, seeds, maximum_propagation, table=None, time_series=None,
+                        multithreading=0, seed_batch_size=None, cell_walk=0):
+        '''Traces the seeds forward through the "Velocity_<i>" arrays of the mesh
+        listed in table, or through time_series, and returns the tracer.'''
+        tracer = vtkvmtk.vtkvmtkStaticTemporalStreamTracer()
+        tracer.SetInputData(mesh)
+        tracer.SetSourceData(seeds)
+        if time_series:
+            tracer.SetVelocityTimeSeries(time_series)
+        else:
+            tracer.SetTimeStepsTable(table)
+            tracer.SetVectorPrefix('Velocity_')
+        tracer.SetSeedTime(0.0)
+        tracer.SetIntegrationDirectionToForward()
+        tracer.SetIntegratorTypeToRungeKutta4()
+        tracer.SetMaximumPropagation(maximum_propagation)
+        tracer.SetMaximumNumberOfSteps(10000)
+        tracer.SetIntegrationStepUnit(1)  # LENGTH_UNIT: steps in arc length, not cell lengths
+        tracer.SetInitialIntegrationStep(0.05)
+        tracer.SetUseMultithreading(multithreading)
+        if seed_batch_size is not None:
+            tracer.SetSeedBatchSize(seed_batch_size)
+        tracer.SetUseCellWalk(cell_walk)
+        tracer.Update()
+        return tracer
+    return make_run_tracer
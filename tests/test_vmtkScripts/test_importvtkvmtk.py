@@ -89,6 +89,7 @@ def vmtk_vtkvmtk_attributes():
         'vtkvmtkItem',
         'vtkvmtkItems',
         'vtkvmtkIterativeClosestPointTransform',
+        'vtkvmtkKrylovLinearSystemSolver',
         'vtkvmtkLaplacianSegmentationLevelSetImageFilter',
         'vtkvmtkLevelSetSigmoidFilter',
         'vtkvmtkLinearSystem',
@@ -118,6 +119,7 @@ def vmtk_vtkvmtk_attributes():
         'vtkvmtkPolyBallLine',
         # 'vtkvmtkPolyBallLine2',
         'vtkvmtkPolyBallModeller',
+        'vtkvmtkPolyDataAdjacency',
         'vtkvmtkPolyDataAreaWeightedUmbrellaStencil',
         'vtkvmtkPolyDataBifurcationProfiles',
         'vtkvmtkPolyDataBifurcationSections',
@@ -145,6 +147,7 @@ def vmtk_vtkvmtk_attributes():
         # 'vtkvmtkPolyDataGeodesicRBFInterpolation',
         'vtkvmtkPolyDataGradientFilter',
         'vtkvmtkPolyDataGradientStencil',
+        'vtkvmtkPolyDataGraphGeodesicDistance',
         'vtkvmtkPolyDataHarmonicMappingFilter',
         'vtkvmtkPolyDataKiteRemovalFilter',
         'vtkvmtkPolyDataLaplaceBeltramiStencil',
@@ -210,6 +213,7 @@ def vmtk_vtkvmtk_attributes():
         'vtkvmtkUnstructuredGridTetraFilter',
         'vtkvmtkUnstructuredGridVorticityFilter',
         'vtkvmtkUpwindGradientMagnitudeImageFilter',
+        'vtkvmtkVelocityTimeSeries',
         'vtkvmtkVesselEnhancingDiffusionImageFilter',
         'vtkvmtkVesselnessMeasureImageFilter',
         'vtkvmtkVoronoiDiagram3D',
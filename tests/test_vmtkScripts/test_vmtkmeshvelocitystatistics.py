@@ -0,0 +1,121 @@
+## Program: VMTK
+## Language:  Python
+
+##   Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+##   See LICENSE file for details.
+
+##      This software is distributed WITHOUT ANY WARRANTY; without even
+##      the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+##      PURPOSE.  See the above copyright notices for more information.
+
+## Tests for vtkvmtkMeshVelocityStatistics: the statistics of random velocity
+## time steps are compared with numpy.
+
+import numpy as np
+import pytest
+import vtk
+from vtk.util import numpy_support
+from vmtk import vtkvmtk
+
+
+@pytest.fixture(scope='module')
+def velocities():
+    # 7 time steps of 50 points (a 5x5x2 grid), reversing direction at some points
+    rng = np.random.RandomState(0)
+    values = rng.uniform(-1.0, 1.0, (7, 50, 3))
+    values[:, :10, :] = np.abs(values[:, :10, :])
+    return values
+
+
+def point_velocities(velocities):
+    '''Time steps giving each point its own velocity, for the velocity_grid fixture.'''
+    return [lambda pointId, point, step=step: velocities[step][pointId] for step in range(velocities.shape[0])]
+
+
+def point_array(output, name):
+    return numpy_support.vtk_to_numpy(output.GetPointData().GetArray(name))
+
+
+def check_statistics(output, velocities):
+    assert np.allclose(point_array(output, 'AVGVelocity'), velocities.mean(axis=0), atol=1e-12)
+    assert np.allclose(point_array(output, 'RMSVelocity'), velocities.std(axis=0), atol=1e-12)
+    magnitudes = np.linalg.norm(velocities, axis=2)
+    osi = 0.5 * (1.0 - np.linalg.norm(velocities.mean(axis=0), axis=1) / magnitudes.mean(axis=0))
+    assert np.allclose(point_array(output, 'OSIVelocity'), osi, atol=1e-12)
+    assert np.allclose(point_array(output, 'MINVelocityMagnitude'), magnitudes.min(axis=0), atol=1e-12)
+    assert np.allclose(point_array(output, 'MAXVelocityMagnitude'), magnitudes.max(axis=0), atol=1e-12)
+
+
+def test_statistics_of_velocity_arrays(velocity_grid, velocities):
+    mesh = velocity_grid(point_velocities(velocities), tetrahedralize=True, dimensions=(5, 5, 2))
+    arrayIds = vtk.vtkIdList()
+    for step in range(velocities.shape[0]):
+        arrayIds.InsertNextId(step)
+
+    statistics = vtkvmtk.vtkvmtkMeshVelocityStatistics()
+    statistics.SetInputData(mesh)
+    statistics.SetVelocityArrayIds(arrayIds)
+    statistics.ComputeOscillatoryIndexOn()
+    statistics.ComputeMagnitudeRangeOn()
+    statistics.Update()
+
+    assert statistics.GetNumberOfTimeSteps() == velocities.shape[0]
+    check_statistics(statistics.GetOutput(), velocities)
+
+
+def test_statistics_of_added_time_steps(velocity_grid, velocities):
+    mesh = velocity_grid([], tetrahedralize=True, dimensions=(5, 5, 2))
+
+    statistics = vtkvmtk.vtkvmtkMeshVelocityStatistics()
+    statistics.SetInputData(mesh)
+    statistics.ComputeOscillatoryIndexOn()
+    statistics.ComputeMagnitudeRangeOn()
+    for step in range(velocities.shape[0]):
+        # float arrays, released once added
+        array = numpy_support.numpy_to_vtk(velocities[step].astype(np.float32), deep=1)
+        assert statistics.AddTimeStep(array) == 1
+    statistics.Update()
+
+    assert statistics.GetNumberOfTimeSteps() == velocities.shape[0]
+    check_statistics(statistics.GetOutput(), velocities.astype(np.float32).astype(np.float64))
+
+    # time steps of a different size are rejected
+    wrongSize = numpy_support.numpy_to_vtk(np.zeros((3, 3)), deep=1)
+    assert statistics.AddTimeStep(wrongSize) == 0
+
+    statistics.InitializeTimeSteps()
+    assert statistics.GetNumberOfTimeSteps() == 0
+
+
+def test_added_time_steps_are_kept_apart_from_velocity_arrays(velocity_grid, velocities):
+    mesh = velocity_grid(point_velocities(velocities), tetrahedralize=True, dimensions=(5, 5, 2))
+    arrayIds = vtk.vtkIdList()
+    for step in range(velocities.shape[0]):
+        arrayIds.InsertNextId(step)
+
+    statistics = vtkvmtk.vtkvmtkMeshVelocityStatistics()
+    statistics.SetInputData(mesh)
+    statistics.SetVelocityArrayIds(arrayIds)
+    statistics.ComputeOscillatoryIndexOn()
+    statistics.ComputeMagnitudeRangeOn()
+    statistics.Update()
+    check_statistics(statistics.GetOutput(), velocities)
+
+    # time steps added after an execution on the arrays start from scratch
+    statistics.SetVelocityArrayIds(None)
+    added = velocities[:4][::-1]
+    for step in range(added.shape[0]):
+        assert statistics.AddTimeStep(numpy_support.numpy_to_vtk(added[step], deep=1)) == 1
+    statistics.Update()
+    assert statistics.GetNumberOfTimeSteps() == added.shape[0]
+    check_statistics(statistics.GetOutput(), added)
+
+    # an execution on the arrays leaves the added time steps in place
+    statistics.SetVelocityArrayIds(arrayIds)
+    statistics.Update()
+    check_statistics(statistics.GetOutput(), velocities)
+    statistics.SetVelocityArrayIds(None)
+    assert statistics.AddTimeStep(numpy_support.numpy_to_vtk(velocities[6], deep=1)) == 1
+    statistics.Update()
+    assert statistics.GetNumberOfTimeSteps() == added.shape[0] + 1
+    check_statistics(statistics.GetOutput(), np.concatenate([added, velocities[6:7]]))
@@ -0,0 +1,68 @@
+## Program: VMTK
+## Language:  Python
+
+##   Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+##   See LICENSE file for details.
+
+##      This software is distributed WITHOUT ANY WARRANTY; without even
+##      the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+##      PURPOSE.  See the above copyright notices for more information.
+
+## Tests for vtkvmtkRBFInterpolation: the interpolant takes the interpolated
+## value (1) at every source point, whether its coefficients come from the
+## sparse Wendland system or the dense system, and whether it is evaluated
+## exactly or through the treecode.
+
+import math
+import pytest
+import vtk
+from vmtk import vtkvmtk
+
+
+def make_source(numberOfPoints=200, radius=10.0):
+    '''Points spread evenly over a sphere (Fibonacci lattice).'''
+    points = vtk.vtkPoints()
+    for i in range(numberOfPoints):
+        phi = math.acos(1.0 - 2.0 * (i + 0.5) / numberOfPoints)
+        theta = math.pi * (1.0 + math.sqrt(5.0)) * (i + 0.5)
+        points.InsertNextPoint(radius * math.cos(theta) * math.sin(phi),
+                               radius * math.sin(theta) * math.sin(phi),
+                               radius * math.cos(phi))
+    source = vtk.vtkPolyData()
+    source.SetPoints(points)
+    return source
+
+
+def node_values(interpolation, source):
+    # EvaluateFunction returns the interpolant minus the interpolated value
+    return [interpolation.EvaluateFunction(source.GetPoint(i)) + 1.0 for i in range(source.GetNumberOfPoints())]
+
+
+def test_wendland_interpolant_reproduces_node_values():
+    source = make_source()
+    interpolation = vtkvmtk.vtkvmtkRBFInterpolation()
+    interpolation.SetSource(source)
+    interpolation.SetRBFTypeToWendland()
+    interpolation.ComputeCoefficients()
+
+    for value in node_values(interpolation, source):
+        assert value == pytest.approx(1.0, abs=1e-6)
+
+    # the parallel evaluation gives the same values
+    values = vtk.vtkDoubleArray()
+    interpolation.EvaluateFunctionOnDataSet(source, values)
+    for i, value in enumerate(node_values(interpolation, source)):
+        assert values.GetValue(i) + 1.0 == pytest.approx(value, abs=1e-12)
+
+
+@pytest.mark.parametrize('openingRatio,tolerance', [(0.0, 1e-6), (0.2, 2e-2)])
+def test_treecode_interpolant_reproduces_node_values(openingRatio, tolerance):
+    source = make_source()
+    interpolation = vtkvmtk.vtkvmtkRBFInterpolation()
+    interpolation.SetSource(source)
+    interpolation.SetRBFTypeToBiharmonic()
+    interpolation.SetTreecodeOpeningRatio(openingRatio)
+    interpolation.ComputeCoefficients()
+
+    for value in node_values(interpolation, source):
+        assert value == pytest.approx(1.0, abs=tolerance)
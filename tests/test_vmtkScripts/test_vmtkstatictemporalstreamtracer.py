@@ -14,72 +14,12 @@
 
 import numpy as np
 import pytest
-import vtk
-from vmtk import vtkvmtk
-
-
-def make_velocity_grid(velocity_per_timestep):
-    '''An 11x11x11 unit-spacing grid centered on the origin, with one uniform
-    vector array "Velocity_<i>" per requested time step.'''
-    grid = vtk.vtkImageData()
-    grid.SetDimensions(11, 11, 11)
-    grid.SetSpacing(1.0, 1.0, 1.0)
-    grid.SetOrigin(-5.0, -5.0, -5.0)
-    numberOfPoints = grid.GetNumberOfPoints()
-    for index, velocity in enumerate(velocity_per_timestep):
-        array = vtk.vtkDoubleArray()
-        array.SetName('Velocity_%d' % index)
-        array.SetNumberOfComponents(3)
-        array.SetNumberOfTuples(numberOfPoints)
-        for i in range(numberOfPoints):
-            array.SetTuple3(i, *velocity)
-        grid.GetPointData().AddArray(array)
-    return grid
-
-
-def make_time_steps_table(times):
-    table = vtk.vtkTable()
-    indexColumn = vtk.vtkIntArray()
-    indexColumn.SetName('index')
-    timeColumn = vtk.vtkDoubleArray()
-    timeColumn.SetName('time')
-    for i, t in enumerate(times):
-        indexColumn.InsertNextValue(i)
-        timeColumn.InsertNextValue(t)
-    table.AddColumn(indexColumn)
-    table.AddColumn(timeColumn)
-    return table
-
-
-def make_seed(point):
-    seedPoints = vtk.vtkPoints()
-    seedPoints.InsertNextPoint(point)
-    seed = vtk.vtkPolyData()
-    seed.SetPoints(seedPoints)
-    return seed
-
-
-def run_tracer(grid, table, seed, maximum_propagation):
-    tracer = vtkvmtk.vtkvmtkStaticTemporalStreamTracer()
-    tracer.SetInputData(grid)
-    tracer.SetSourceData(seed)
-    tracer.SetTimeStepsTable(table)
-    tracer.SetVectorPrefix('Velocity_')
-    tracer.SetSeedTime(0.0)
-    tracer.SetIntegrationDirectionToForward()
-    tracer.SetIntegratorTypeToRungeKutta4()
-    tracer.SetMaximumPropagation(maximum_propagation)
-    tracer.SetMaximumNumberOfSteps(10000)
-    tracer.SetIntegrationStepUnit(1)  # LENGTH_UNIT: steps in arc length, not cell lengths
-    tracer.SetInitialIntegrationStep(0.05)
-    tracer.Update()
-    return tracer.GetOutput()
-
-
-def test_uniform_steady_flow_traces_straight_line():
-    grid = make_velocity_grid([(1.0, 0.0, 0.0), (1.0, 0.0, 0.0)])
-    table = make_time_steps_table([0.0, 1.0])
-    streamline = run_tracer(grid, table, make_seed((-4.0, 0.0, 0.0)), 8.0)
+
+
+def test_uniform_steady_flow_traces_straight_line(velocity_grid, time_steps_table, seed_points, run_tracer):
+    grid = velocity_grid([(1.0, 0.0, 0.0), (1.0, 0.0, 0.0)])
+    table = time_steps_table([0.0, 1.0])
+    streamline = run_tracer(grid, seed_points([(-4.0, 0.0, 0.0)]), 8.0, table=table).GetOutput()
 
     assert streamline.GetNumberOfCells() == 1
     points = np.array([streamline.GetPoint(i) for i in range(streamline.GetNumberOfPoints())])
@@ -95,14 +35,14 @@ def test_uniform_steady_flow_traces_straight_line():
     assert timeArray.GetValue(streamline.GetNumberOfPoints() - 1) == pytest.approx(8.0, abs=1e-6)
 
 
-def test_time_varying_flow_blends_velocity_between_timesteps():
+def test_time_varying_flow_blends_velocity_between_timesteps(velocity_grid, time_steps_table, seed_points, run_tracer):
     # The velocity field turns from +x at t=0 to +y at t=1, so at any time in
     # between the temporally interpolated field is ((1-t), t, 0) everywhere.
     # The propagation length keeps the trace inside the [0, 1] time interval
     # (the full turn has an arc length of ~0.81).
-    grid = make_velocity_grid([(1.0, 0.0, 0.0), (0.0, 1.0, 0.0)])
-    table = make_time_steps_table([0.0, 1.0])
-    streamline = run_tracer(grid, table, make_seed((0.0, 0.0, 0.0)), 0.6)
+    grid = velocity_grid([(1.0, 0.0, 0.0), (0.0, 1.0, 0.0)])
+    table = time_steps_table([0.0, 1.0])
+    streamline = run_tracer(grid, seed_points([(0.0, 0.0, 0.0)]), 0.6, table=table).GetOutput()
 
     points = np.array([streamline.GetPoint(i) for i in range(streamline.GetNumberOfPoints())])
     timeArray = streamline.GetPointData().GetArray('IntegrationTime')
@@ -127,3 +67,78 @@ def test_time_varying_flow_blends_velocity_between_timesteps():
     assert (steps[1:, 1] > 0.0).all()
     assert np.allclose(points[:, 0], times - times ** 2 / 2.0, atol=0.05)
     assert np.allclose(points[:, 1], times ** 2 / 2.0, atol=0.05)
+
+
+def test_multithreaded_tracing_matches_serial_tracing(velocity_grid, time_steps_table, seed_points, run_tracer):
+    grid = velocity_grid([(1.0, 0.0, 0.0), (0.0, 1.0, 0.0)])
+    table = time_steps_table([0.0, 1.0])
+    seeds = seed_points([(-4.0 + 0.3 * i, -4.0 + 0.2 * i, 0.1 * (i % 5)) for i in range(25)])
+
+    def trace(multithreading):
+        return run_tracer(grid, seeds, 2.0, table=table, multithreading=multithreading,
+                          seed_batch_size=3).GetOutput()
+
+    serial = trace(0)
+    parallel = trace(1)
+
+    # lines are appended in seed order, whatever the number of threads
+    assert serial.GetNumberOfCells() == 25
+    assert parallel.GetNumberOfCells() == serial.GetNumberOfCells()
+    assert parallel.GetNumberOfPoints() == serial.GetNumberOfPoints()
+    for cellId in range(serial.GetNumberOfCells()):
+        assert parallel.GetCell(cellId).GetNumberOfPoints() == serial.GetCell(cellId).GetNumberOfPoints()
+    serialPoints = np.array([serial.GetPoint(i) for i in range(serial.GetNumberOfPoints())])
+    parallelPoints = np.array([parallel.GetPoint(i) for i in range(parallel.GetNumberOfPoints())])
+    assert np.array_equal(serialPoints, parallelPoints)
+    serialTimes = serial.GetPointData().GetArray('IntegrationTime')
+    parallelTimes = parallel.GetPointData().GetArray('IntegrationTime')
+    for i in range(serial.GetNumberOfPoints()):
+        assert parallelTimes.GetValue(i) == serialTimes.GetValue(i)
+
+
+def test_multithreaded_tracing_on_fresh_unstructured_grid(velocity_grid, time_steps_table, seed_points, run_tracer):
+    # The multithreaded trace runs first, on a mesh whose cell links have not
+    # been built yet by a serial search, and is compared with a serial trace
+    # of an identical, separate mesh.
+    def make_mesh():
+        return velocity_grid([(1.0, 0.2, 0.1), (0.3, 1.0, -0.2)], tetrahedralize=True)
+
+    table = time_steps_table([0.0, 1.0])
+    seeds = seed_points([(-4.0 + 0.2 * i, -3.0 + 0.15 * i, 0.1 * (i % 7)) for i in range(40)])
+
+    def trace(mesh, multithreading):
+        return run_tracer(mesh, seeds, 3.0, table=table, multithreading=multithreading,
+                          seed_batch_size=1)
+
+    parallelTracer = trace(make_mesh(), 1)
+    parallel = parallelTracer.GetOutput()
+    serial = trace(make_mesh(), 0).GetOutput()
+
+    # without the cell walk, no adjacency tables or locators are built for the threads
+    assert parallelTracer.GetCellLocatorBuildTime() == 0.0
+
+    assert parallel.GetNumberOfCells() == serial.GetNumberOfCells() == 40
+    assert parallel.GetNumberOfPoints() == serial.GetNumberOfPoints()
+    serialPoints = np.array([serial.GetPoint(i) for i in range(serial.GetNumberOfPoints())])
+    parallelPoints = np.array([parallel.GetPoint(i) for i in range(parallel.GetNumberOfPoints())])
+    assert np.array_equal(serialPoints, parallelPoints)
+
+
+def test_cell_walk_matches_global_search_on_tetrahedra(velocity_grid, time_steps_table, seed_points, run_tracer):
+    mesh = velocity_grid([(1.0, 0.2, 0.1), (0.3, 1.0, -0.2)], tetrahedralize=True)
+    table = time_steps_table([0.0, 1.0])
+    seeds = seed_points([(-4.0 + 0.5 * i, -3.0 + 0.3 * i, 0.25 * (i % 3)) for i in range(10)])
+
+    searched = run_tracer(mesh, seeds, 3.0, table=table, cell_walk=0).GetOutput()
+    tracer = run_tracer(mesh, seeds, 3.0, table=table, cell_walk=1)
+    walked = tracer.GetOutput()
+
+    assert walked.GetNumberOfCells() == searched.GetNumberOfCells()
+    assert walked.GetNumberOfPoints() == searched.GetNumberOfPoints()
+    searchedPoints = np.array([searched.GetPoint(i) for i in range(searched.GetNumberOfPoints())])
+    walkedPoints = np.array([walked.GetPoint(i) for i in range(walked.GetNumberOfPoints())])
+    assert np.allclose(walkedPoints, searchedPoints, atol=1e-6)
+
+    # most points are found in the cached cell or by walking
+    assert tracer.GetNumberOfCachedCellHits() + tracer.GetNumberOfWalkHits() > tracer.GetNumberOfLocatorSearches()
+    assert tracer.GetNumberOfLocatorSearches() >= seeds.GetNumberOfPoints()
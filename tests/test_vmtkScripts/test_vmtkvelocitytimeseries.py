@@ -0,0 +1,194 @@
+## Program: VMTK
+## Language:  Python
+
+##   Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+##   See LICENSE file for details.
+
+##      This software is distributed WITHOUT ANY WARRANTY; without even
+##      the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+##      PURPOSE.  See the above copyright notices for more information.
+
+## Tests for vtkvmtkVelocityTimeSeries: time steps written to a file are read
+## back, and the filters reading them give the same results as with the
+## velocity arrays of the mesh.
+
+import numpy as np
+import pytest
+import vtk
+from vmtk import vtkvmtk
+import vmtk.vmtkparticletracer as particletracer
+
+
+def varying_velocity(numberOfTimeSteps):
+    '''Time steps of a velocity field varying in space and time, for the
+    velocity_grid fixture.'''
+    return [lambda pointId, point, step=step: (1.0 + 0.1 * point[1] * step, 0.2 * point[0] - 0.05 * step, 0.1 * point[2])
+            for step in range(numberOfTimeSteps)]
+
+
+def write_time_series(fileName, mesh, times, storageType):
+    series = vtkvmtk.vtkvmtkVelocityTimeSeries()
+    series.SetFileName(fileName)
+    series.SetStorageType(storageType)
+    assert series.BeginWrite(mesh.GetNumberOfPoints()) == 1
+    for step, time in enumerate(times):
+        assert series.AppendTimeStep(time, mesh.GetPointData().GetArray('Velocity_%d' % step)) == 1
+    assert series.EndWrite() == 1
+    series.SetMaximumNumberOfCachedTimeSteps(2)
+    assert series.Open() == 1
+    return series
+
+
+def velocity_array(array):
+    return np.array([array.GetTuple3(i) for i in range(array.GetNumberOfTuples())])
+
+
+@pytest.mark.parametrize('storageType,tolerance', [(0, 1e-6), (1, 1e-4)])
+def test_time_steps_are_read_back(velocity_grid, tmp_path, storageType, tolerance):
+    mesh = velocity_grid(varying_velocity(4), tetrahedralize=True, dimensions=(6, 6, 6))
+    times = [0.0, 0.25, 0.5, 1.0]
+    series = write_time_series(str(tmp_path / 'velocity.vts'), mesh, times, storageType)
+
+    assert series.GetNumberOfPoints() == mesh.GetNumberOfPoints()
+    assert series.GetNumberOfTimeSteps() == 4
+    for step, time in enumerate(times):
+        assert series.GetTime(step) == time
+
+    # the cache holds two time steps: going back to the first one rereads it
+    for step in [0, 1, 2, 3, 0]:
+        values = vtk.vtkFloatArray()
+        assert series.CopyTimeStep(step, values) == 1
+        expected = velocity_array(mesh.GetPointData().GetArray('Velocity_%d' % step))
+        assert np.allclose(velocity_array(values), expected, atol=tolerance)
+    assert series.GetNumberOfTimeStepReads() == 5
+
+    # copies read the same file through the same cache
+    copy = vtkvmtk.vtkvmtkVelocityTimeSeries()
+    copy.CopyFileInformation(series)
+    assert copy.GetNumberOfTimeSteps() == 4
+    values = vtk.vtkFloatArray()
+    assert copy.CopyTimeStep(0, values) == 1
+    assert copy.GetNumberOfTimeStepReads() == 5
+    assert series.GetNumberOfTimeStepReads() == 5
+
+
+def test_files_of_the_other_byte_order_are_rejected(velocity_grid, tmp_path):
+    fileName = str(tmp_path / 'velocity.vts')
+    mesh = velocity_grid(varying_velocity(2), tetrahedralize=True, dimensions=(6, 6, 6))
+    write_time_series(fileName, mesh, [0.0, 1.0], 0)
+
+    # the byte order mark follows the magic string and the storage type
+    with open(fileName, 'r+b') as f:
+        f.seek(12)
+        mark = f.read(4)
+        f.seek(12)
+        f.write(mark[::-1])
+
+    series = vtkvmtk.vtkvmtkVelocityTimeSeries()
+    series.SetFileName(fileName)
+    series.GlobalWarningDisplayOff()
+    assert series.Open() == 0
+
+
+def test_statistics_match_velocity_arrays(velocity_grid, tmp_path):
+    mesh = velocity_grid(varying_velocity(5), tetrahedralize=True, dimensions=(6, 6, 6))
+    series = write_time_series(str(tmp_path / 'velocity.vts'), mesh, [0.0, 0.2, 0.4, 0.6, 0.8], 0)
+
+    arrayIds = vtk.vtkIdList()
+    for step in range(5):
+        arrayIds.InsertNextId(step)
+    fromArrays = vtkvmtk.vtkvmtkMeshVelocityStatistics()
+    fromArrays.SetInputData(mesh)
+    fromArrays.SetVelocityArrayIds(arrayIds)
+    fromArrays.Update()
+
+    fromSeries = vtkvmtk.vtkvmtkMeshVelocityStatistics()
+    fromSeries.SetInputData(mesh)
+    fromSeries.SetVelocityTimeSeries(series)
+    fromSeries.Update()
+
+    for name in ['AVGVelocity', 'RMSVelocity']:
+        expected = velocity_array(fromArrays.GetOutput().GetPointData().GetArray(name))
+        computed = velocity_array(fromSeries.GetOutput().GetPointData().GetArray(name))
+        assert np.allclose(computed, expected, atol=1e-6)
+    # a single pass over the time steps
+    assert series.GetNumberOfTimeStepReads() == 5
+
+
+def test_tracer_matches_velocity_arrays(velocity_grid, tmp_path, time_steps_table, seed_points, run_tracer):
+    mesh = velocity_grid(varying_velocity(3), tetrahedralize=True, dimensions=(6, 6, 6))
+    times = [0.0, 0.5, 1.0]
+    series = write_time_series(str(tmp_path / 'velocity.vts'), mesh, times, 0)
+    table = time_steps_table(times)
+    seeds = seed_points([(-2.0 + 0.3 * i, -1.0 + 0.2 * i, 0.1 * i) for i in range(6)])
+
+    def trace(timeSeries, multithreading):
+        return run_tracer(mesh, seeds, 2.0, table=table, time_series=timeSeries,
+                          multithreading=multithreading, seed_batch_size=2).GetOutput()
+
+    fromArrays = trace(None, 0)
+    expected = np.array([fromArrays.GetPoint(i) for i in range(fromArrays.GetNumberOfPoints())])
+    for multithreading in [0, 1]:
+        fromSeries = trace(series, multithreading)
+        assert fromSeries.GetNumberOfCells() == fromArrays.GetNumberOfCells()
+        assert fromSeries.GetNumberOfPoints() == fromArrays.GetNumberOfPoints()
+        computed = np.array([fromSeries.GetPoint(i) for i in range(fromSeries.GetNumberOfPoints())])
+        assert np.allclose(computed, expected, atol=1e-5)
+
+
+def test_tracer_reads_each_time_step_once(velocity_grid, tmp_path, seed_points, run_tracer):
+    # the lines pass through more time steps than the series caches
+    mesh = velocity_grid(varying_velocity(10), tetrahedralize=True, dimensions=(6, 6, 6))
+    times = [0.2 * step for step in range(10)]
+    fileName = str(tmp_path / 'velocity.vts')
+    write_time_series(fileName, mesh, times, 0)
+    seeds = seed_points([(-2.2, -1.0 + 0.4 * i, -0.5 + 0.2 * i) for i in range(6)])
+
+    def trace(cachedTimeSteps, multithreading):
+        series = vtkvmtk.vtkvmtkVelocityTimeSeries()
+        series.SetFileName(fileName)
+        series.SetMaximumNumberOfCachedTimeSteps(cachedTimeSteps)
+        assert series.Open() == 1
+        tracer = run_tracer(mesh, seeds, 3.0, time_series=series, multithreading=multithreading)
+        return tracer.GetOutput(), series.GetNumberOfTimeStepReads()
+
+    # with two cached time steps, the lines are traced one after the other
+    oneByOne, oneByOneReads = trace(2, 0)
+    expected = np.array([oneByOne.GetPoint(i) for i in range(oneByOne.GetNumberOfPoints())])
+    assert oneByOne.GetNumberOfCells() == 6
+    assert oneByOne.GetPointData().GetArray('IntegrationTime').GetRange()[1] > times[5]
+    assert oneByOneReads > 2 * len(times)
+
+    for multithreading in [0, 1]:
+        together, reads = trace(4, multithreading)
+        assert together.GetNumberOfPoints() == oneByOne.GetNumberOfPoints()
+        computed = np.array([together.GetPoint(i) for i in range(together.GetNumberOfPoints())])
+        assert np.allclose(computed, expected, atol=1e-9)
+        assert reads <= len(times)
+
+
+def test_particle_tracer_script_reads_time_series(velocity_grid, tmp_path):
+    # no timesteps field data on the mesh and no velocity arrays on the source:
+    # times and seed speeds come from the series
+    mesh = velocity_grid(varying_velocity(3), tetrahedralize=True, dimensions=(6, 6, 6))
+    fileName = str(tmp_path / 'velocity.vts')
+    write_time_series(fileName, mesh, [0.0, 0.5, 1.0], 0)
+
+    plane = vtk.vtkPlaneSource()
+    plane.SetOrigin(-1.0, -1.0, 0.0)
+    plane.SetPoint1(1.0, -1.0, 0.0)
+    plane.SetPoint2(-1.0, 1.0, 0.0)
+    plane.SetResolution(2, 2)
+    plane.Update()
+
+    tracer = particletracer.vmtkParticleTracer()
+    tracer.Mesh = mesh
+    tracer.Source = plane.GetOutput()
+    tracer.TimeSeriesFileName = fileName
+    tracer.MinSpeed = 0.1
+    tracer.SeedTime = 0.25
+    tracer.MaximumPropagation = 5
+    tracer.Execute()
+
+    assert tracer.Source.GetNumberOfPoints() == 9
+    assert tracer.Traces.GetNumberOfCells() > 0
@@ -51,6 +51,7 @@ class vmtkImageVesselEnhancement(pypes.pypeScript):
         self.Sensitivity = 5.0
         self.NumberOfIterations = 0
         self.NumberOfDiffusionSubIterations = 0
+        self.UseNarrowBand = 0
         self.BrightObject = True
 
         self.SetScriptName('vmtkimagevesselenhancement')
@@ -75,7 +76,8 @@ class vmtkImageVesselEnhancement(pypes.pypeScript):
             ['WStrength','wstrength','float',1,'(0.0,)','(ved, vedm)'],
             ['Sensitivity','sensitivity','float',1,'(0.0,)','(ved, vedm)'],
             ['NumberOfIterations','iterations','int',1,'(0,)','(ved, vedm)'],
-            ['NumberOfDiffusionSubIterations','subiterations','int',1,'(1,)','(ved, vedm)']
+            ['NumberOfDiffusionSubIterations','subiterations','int',1,'(1,)','(ved, vedm)'],
+            ['UseNarrowBand','narrowband','bool',1,'','restrict vesselness recalculations to a band around the vessels (vedm)']
             ])
         self.SetOutputMembers([
             ['Image','o','vtkImageData',1,'','the output image','vmtkimagewriter']
@@ -162,6 +164,7 @@ class vmtkImageVesselEnhancement(pypes.pypeScript):
         vesselness.SetSensitivity(self.Sensitivity)
         vesselness.SetNumberOfIterations(self.NumberOfIterations)
         vesselness.SetRecalculateVesselness(self.NumberOfDiffusionSubIterations)
+        vesselness.SetUseNarrowBand(self.UseNarrowBand)
         if self.SigmaStepMethod == 'equispaced':
             vesselness.SetSigmaStepMethodToEquispaced()
         elif self.SigmaStepMethod == 'logarithmic':
@@ -67,10 +67,8 @@ class vmtkMeshPolyBallEvaluation(pypes.pypeScript):
         polyball.SetInputData(self.PolyBall)
         polyball.SetPolyBallRadiusArrayName(self.RadiusArrayName)
 
-        for i in range(self.Mesh.GetNumberOfPoints()):
-            point = self.Mesh.GetPoint(i)
-            value = polyball.EvaluateFunction(point)
-            evaluationArray.SetValue(i,value)
+        if self.Mesh.GetNumberOfPoints() > 0:
+            polyball.EvaluateFunction(self.Mesh.GetPoints().GetData(),evaluationArray)
 
         self.Mesh.GetPointData().AddArray(evaluationArray)
 
@@ -51,6 +51,10 @@ class vmtkParticleTracer(pypes.pypeScript):
         self.VectorComponents = 1
         self.Periodic = 1
         self.Vorticity = 1
+        self.Multithreading = 0
+        self.SeedBatchSize = 64
+        self.CellWalk = 0
+        self.TimeSeriesFileName = None
         self.Component0Prefix = "u_"
         self.Component1Prefix = "v_"
         self.Component2Prefix = "w_"
@@ -60,7 +64,7 @@ class vmtkParticleTracer(pypes.pypeScript):
         self.SetInputMembers([
             ['Mesh','i','vtkUnstructuredGrid',1,'','the input mesh','vmtkmeshreader'],
             ['Source','s','vtkPolyData',1,'','source points', 'vmtksurfacereader'],
-            ['SeedTime','seedtime','float',1,'(0.0,)'],
+            ['SeedTime','seedtime','float',1,'(0.0,)','seed time, in the time units of the time series file if one is given, else normalized so that consecutive time steps are 1/(n-1) apart'],
             ['MinSpeed','minspeed','float',1,'(0.0,)','lower speed threshold'],
             ['Subdivide','subdivide','bool',1,'','Subdivide input polydata'],
             ['MaximumPropagation','maximumpropagation','int',1,'(0,)'],
@@ -73,6 +77,10 @@ class vmtkParticleTracer(pypes.pypeScript):
             ['VectorComponents','vectorcomponents','bool',1,''],
             ['Periodic','periodic','bool',1,''],
             ['Vorticity','vorticity','bool',1,''],
+            ['Multithreading','multithreading','bool',1,'','trace the seeds in parallel'],
+            ['SeedBatchSize','seedbatchsize','int',1,'(1,)','number of seeds traced as one unit of work when multithreading'],
+            ['CellWalk','cellwalk','bool',1,'','locate points in tetrahedral meshes by walking across cell faces'],
+            ['TimeSeriesFileName','timeseriesfile','str',1,'','read the velocity and the time of all time steps from this vtkvmtkVelocityTimeSeries file instead of the mesh arrays and the timesteps field data'],
             ['Component0Prefix','component0prefix','str',1,''],
             ['Component1Prefix','component1prefix','str',1,''],
             ['Component2Prefix','component2prefix','str',1,''],
@@ -84,6 +92,31 @@ class vmtkParticleTracer(pypes.pypeScript):
             ['Traces','o','vtkPolyData',1,'','the output traces','vmtksurfacewriter']
             ])
 
+    def TimeSeriesSpeed(self, timeSeries):
+        # speed of the first time step of the series at the source points
+        velocity = vtk.vtkFloatArray()
+        velocity.SetName('velocity')
+        timeSeries.CopyTimeStep(0,velocity)
+        mesh = vtk.vtkUnstructuredGrid()
+        mesh.CopyStructure(self.Mesh)
+        mesh.GetPointData().AddArray(velocity)
+
+        probe = vtk.vtkProbeFilter()
+        probe.SetInputData(self.Source)
+        probe.SetSourceData(mesh)
+        probe.Update()
+        sourceVelocity = probe.GetOutput().GetPointData().GetArray('velocity')
+
+        speed = vtk.vtkFloatArray()
+        speed.SetNumberOfComponents(1)
+        speed.SetNumberOfTuples(sourceVelocity.GetNumberOfTuples())
+        speed.SetName('speed')
+        i=0
+        while i<sourceVelocity.GetNumberOfTuples():
+            speed.SetTuple1(i, vtk.vtkMath.Norm(sourceVelocity.GetTuple3(i)))
+            i+=1
+        return speed
+
     def Execute(self):
 
         if (self.Mesh == None):
@@ -92,52 +125,64 @@ class vmtkParticleTracer(pypes.pypeScript):
         if (self.Source == None):
             self.PrintError('Error: no Source surface.')
 
-        if (self.FirstTimeStep == None or self.LastTimeStep == None or self.IntervalTimeStep == None):
-            timesteps = self.Mesh.GetFieldData().GetArray("timesteps")
-            if (timesteps == None):
-                self.PrintError('Error: no Timesteps.')
-            indexList = []
-            i = 0
-            while i < self.Mesh.GetFieldData().GetArray("timesteps").GetNumberOfTuples():
-                indexList.append(int(timesteps.GetTuple(i)[0]))
-                i+=1
-            firstTimeStep = indexList[0]
-        else:
-            indexList = list(range(self.FirstTimeStep,self.LastTimeStep+1,self.IntervalTimeStep))
-            firstTimeStep = self.FirstTimeStep
-
-        indexColumn = vtk.vtkIntArray()
-        indexColumn.SetName("index")
-        timeColumn = vtk.vtkDoubleArray()
-        timeColumn.SetName("time")
-
-        time = 0
-        timeStepsTable = vtk.vtkTable()
-        timeStepsTable.AddColumn(indexColumn)
-        timeStepsTable.AddColumn(timeColumn)
-
-        for index in indexList:
-            time+=(1./(len(indexList)-1))
-            indexColumn.InsertNextValue(index)
-            timeColumn.InsertNextValue(time)
-
-        u = self.Source.GetPointData().GetArray("u")
-        if u:
-            v = self.Source.GetPointData().GetArray("v")
-            w = self.Source.GetPointData().GetArray("w")
+        timeSeries = None
+        timeStepsTable = None
+        if self.TimeSeriesFileName:
+            # the series holds the time of every time step, so no time steps table is needed
+            timeSeries = vtkvmtk.vtkvmtkVelocityTimeSeries()
+            timeSeries.SetFileName(self.TimeSeriesFileName)
+            if not timeSeries.Open():
+                self.PrintError('Error: cannot read ' + self.TimeSeriesFileName)
+            if timeSeries.GetNumberOfPoints() != self.Mesh.GetNumberOfPoints():
+                self.PrintError('Error: ' + self.TimeSeriesFileName + ' does not match the mesh.')
+            speed = self.TimeSeriesSpeed(timeSeries)
         else:
-            u = self.Source.GetPointData().GetArray("u_"+str(firstTimeStep))
-            v = self.Source.GetPointData().GetArray("v_"+str(firstTimeStep))
-            w = self.Source.GetPointData().GetArray("w_"+str(firstTimeStep))
-
-        speed = vtk.vtkFloatArray()
-        speed.SetNumberOfComponents(u.GetNumberOfComponents())
-        speed.SetNumberOfTuples(u.GetNumberOfTuples())
-        speed.SetName('speed')
-        i=0
-        while i<u.GetNumberOfTuples():
-            speed.InsertTuple1(i, vtk.vtkMath.Norm((u.GetTuple(i)[0],v.GetTuple(i)[0],w.GetTuple(i)[0])))
-            i+=1
+            if (self.FirstTimeStep == None or self.LastTimeStep == None or self.IntervalTimeStep == None):
+                timesteps = self.Mesh.GetFieldData().GetArray("timesteps")
+                if (timesteps == None):
+                    self.PrintError('Error: no Timesteps.')
+                indexList = []
+                i = 0
+                while i < self.Mesh.GetFieldData().GetArray("timesteps").GetNumberOfTuples():
+                    indexList.append(int(timesteps.GetTuple(i)[0]))
+                    i+=1
+                firstTimeStep = indexList[0]
+            else:
+                indexList = list(range(self.FirstTimeStep,self.LastTimeStep+1,self.IntervalTimeStep))
+                firstTimeStep = self.FirstTimeStep
+
+            indexColumn = vtk.vtkIntArray()
+            indexColumn.SetName("index")
+            timeColumn = vtk.vtkDoubleArray()
+            timeColumn.SetName("time")
+
+            time = 0
+            timeStepsTable = vtk.vtkTable()
+            timeStepsTable.AddColumn(indexColumn)
+            timeStepsTable.AddColumn(timeColumn)
+
+            for index in indexList:
+                time+=(1./(len(indexList)-1))
+                indexColumn.InsertNextValue(index)
+                timeColumn.InsertNextValue(time)
+
+            u = self.Source.GetPointData().GetArray("u")
+            if u:
+                v = self.Source.GetPointData().GetArray("v")
+                w = self.Source.GetPointData().GetArray("w")
+            else:
+                u = self.Source.GetPointData().GetArray("u_"+str(firstTimeStep))
+                v = self.Source.GetPointData().GetArray("v_"+str(firstTimeStep))
+                w = self.Source.GetPointData().GetArray("w_"+str(firstTimeStep))
+
+            speed = vtk.vtkFloatArray()
+            speed.SetNumberOfComponents(u.GetNumberOfComponents())
+            speed.SetNumberOfTuples(u.GetNumberOfTuples())
+            speed.SetName('speed')
+            i=0
+            while i<u.GetNumberOfTuples():
+                speed.InsertTuple1(i, vtk.vtkMath.Norm((u.GetTuple(i)[0],v.GetTuple(i)[0],w.GetTuple(i)[0])))
+                i+=1
 
         self.Source.GetPointData().AddArray(speed)
 
@@ -159,7 +204,10 @@ class vmtkParticleTracer(pypes.pypeScript):
         tracer = vtkvmtk.vtkvmtkStaticTemporalStreamTracer()
         tracer.SetInputData(self.Mesh)
         tracer.SetIntegratorTypeToRungeKutta45()
-        tracer.SetTimeStepsTable(timeStepsTable)
+        if timeSeries:
+            tracer.SetVelocityTimeSeries(timeSeries)
+        else:
+            tracer.SetTimeStepsTable(timeStepsTable)
         tracer.SetSeedTime(self.SeedTime)
         tracer.SetMaximumPropagation(self.MaximumPropagation)
         tracer.SetInitialIntegrationStep(self.InitialIntegrationStep)
@@ -179,7 +227,17 @@ class vmtkParticleTracer(pypes.pypeScript):
         tracer.SetComponent2Prefix(self.Component2Prefix)
         if self.Periodic:
             tracer.PeriodicOn()
+        if self.Multithreading:
+            tracer.UseMultithreadingOn()
+        tracer.SetSeedBatchSize(self.SeedBatchSize)
+        if self.CellWalk:
+            tracer.UseCellWalkOn()
         tracer.Update()
+        if self.CellWalk:
+            self.PrintLog('Cell locator build time: %f s' % tracer.GetCellLocatorBuildTime())
+            self.PrintLog('Cached cell hits: %d, walk hits: %d (%d steps), locator searches: %d (%d misses)' % (
+                tracer.GetNumberOfCachedCellHits(), tracer.GetNumberOfWalkHits(), tracer.GetNumberOfWalkSteps(),
+                tracer.GetNumberOfLocatorSearches(), tracer.GetNumberOfLocatorMisses()))
 
         self.Traces = tracer.GetOutput()
 
@@ -29,6 +29,8 @@ class vmtkRBFInterpolation(pypes.pypeScript):
 
         self.Seeds = None
         self.RBFType = 'biharmonic'
+        self.SupportRadius = 0.0
+        self.TreecodeOpeningRatio = 0.0
 
         self.Image = None
 
@@ -42,8 +44,9 @@ class vmtkRBFInterpolation(pypes.pypeScript):
             ['Image','r','vtkImageData',1,'','the reference image','vmtkimagereader'],
             ['Dimensions','dimensions','int',3,''],
             ['Bounds','bounds','float',6,''],
-            ['RBFType','rbftype','str',1,'["thinplatespline","biharmonic","triharmonic"]','the type of RBF interpolation']
-
+            ['RBFType','rbftype','str',1,'["thinplatespline","biharmonic","triharmonic","wendland"]','the type of RBF interpolation'],
+            ['SupportRadius','supportradius','float',1,'(0.0,)','radius of the compactly supported wendland kernel (0: a quarter of the diagonal of the seed bounding box)'],
+            ['TreecodeOpeningRatio','treecoderatio','float',1,'(0.0,)','approximate far clusters of seeds whose radius is below this fraction of their distance, for global kernels (0: exact)']
             ])
         self.SetOutputMembers([
             ['Image','o','vtkImageData',1,'','the output image','vmtkimagewriter']
@@ -62,6 +65,10 @@ class vmtkRBFInterpolation(pypes.pypeScript):
             rbf.SetRBFTypeToBiharmonic()
         elif self.RBFType == "triharmonic":
             rbf.SetRBFTypeToTriharmonic()
+        elif self.RBFType == "wendland":
+            rbf.SetRBFTypeToWendland()
+        rbf.SetSupportRadius(self.SupportRadius)
+        rbf.SetTreecodeOpeningRatio(self.TreecodeOpeningRatio)
         rbf.ComputeCoefficients()
 
         if self.Image:
@@ -80,16 +87,23 @@ class vmtkRBFInterpolation(pypes.pypeScript):
             dimensions = self.Dimensions
             modelBounds = self.Bounds
 
-        sampleFunction = vtk.vtkSampleFunction()
-        sampleFunction.SetImplicitFunction(rbf)
-        sampleFunction.SetOutputScalarTypeToDouble()
-        sampleFunction.SetSampleDimensions(dimensions)
-        sampleFunction.SetModelBounds(modelBounds)
-        sampleFunction.CappingOff()
-        sampleFunction.ComputeNormalsOff()
-        sampleFunction.Update()
+        # same sampling as vtkSampleFunction, evaluated in parallel
+        spacing = [1.0, 1.0, 1.0]
+        for i in range(3):
+            if dimensions[i] > 1:
+                spacing[i] = (modelBounds[2*i+1] - modelBounds[2*i]) / (dimensions[i] - 1)
+
+        image = vtk.vtkImageData()
+        image.SetDimensions(dimensions)
+        image.SetOrigin(modelBounds[0], modelBounds[2], modelBounds[4])
+        image.SetSpacing(spacing)
+
+        values = vtk.vtkDoubleArray()
+        values.SetName('scalars')
+        rbf.EvaluateFunctionOnDataSet(image, values)
+        image.GetPointData().SetScalars(values)
 
-        self.Image = sampleFunction.GetOutput()
+        self.Image = image
 
 
 if __name__=='__main__':
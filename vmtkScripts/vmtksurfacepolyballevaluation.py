@@ -67,10 +67,8 @@ class vmtkSurfacePolyBallEvaluation(pypes.pypeScript):
         polyball.SetInputData(self.PolyBall)
         polyball.SetPolyBallRadiusArrayName(self.RadiusArrayName)
 
-        for i in range(self.Surface.GetNumberOfPoints()):
-            point = self.Surface.GetPoint(i)
-            value = polyball.EvaluateFunction(point)
-            evaluationArray.SetValue(i,value)
+        if self.Surface.GetNumberOfPoints() > 0:
+            polyball.EvaluateFunction(self.Surface.GetPoints().GetData(),evaluationArray)
 
         self.Surface.GetPointData().AddArray(evaluationArray)
 
@@ -51,6 +51,7 @@ class vmtkSurfaceRemeshing(pypes.pypeScript):
         self.CollapseAngleThreshold = 0.2
         self.Relaxation = 0.5
         self.PreserveBoundaryEdges = 0
+        self.UseOperationQueue = 0
         self.ExcludeEntityIds = []
         self.CleanOutput = 0
 
@@ -79,6 +80,7 @@ class vmtkSurfaceRemeshing(pypes.pypeScript):
             ['Relaxation','relaxation','float',1,'(0.5,)'],
             ['ExcludeEntityIds','exclude','int',-1,''],
             ['PreserveBoundaryEdges','preserveboundary','bool',1],
+            ['UseOperationQueue','operationqueue','bool',1,'','collapse and split the worst triangles first from a priority queue instead of sweeping all triangles'],
             ['CleanOutput','cleanoutput','bool',1,'','toggle cleaning the unused points']
             ])
         self.SetOutputMembers([
@@ -143,6 +145,7 @@ class vmtkSurfaceRemeshing(pypes.pypeScript):
         surfaceRemeshing.SetNormalAngleTolerance(self.NormalAngleTolerance)
         surfaceRemeshing.SetCollapseAngleThreshold(self.CollapseAngleThreshold)
         surfaceRemeshing.SetPreserveBoundaryEdges(self.PreserveBoundaryEdges)
+        surfaceRemeshing.SetUseOperationQueue(self.UseOperationQueue)
         surfaceRemeshing.SetExcludedEntityIds(excludedIds)
         surfaceRemeshing.Update()
 
@@ -0,0 +1,266 @@
+/*=========================================================================
+
+Program:   VMTK
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENSE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/**
+ * @class   vtkvmtkIndexedHeap
+ * @brief   Indexed d-ary min heap with decrease-key, stored in contiguous arrays.
+ * @ingroup ComputationalGeometry
+ *
+ * Keeps a set of ids in [0,N) ordered by a key of type TKey, so that the id with the minimum key is
+ * retrieved in constant time and removed in O(d log_d N). Keys are stored next to the ids in heap
+ * order, and a position array maps every id to its location in the heap, so that the key of an id
+ * already in the heap can be changed in place (DecreaseKey/UpdateKey) without searching for it.
+ * Sifting moves a hole instead of swapping elements, and no virtual call or vtkObject indirection is
+ * involved. With TArity = 4 (the default) the tree is half as deep as a binary heap and the children
+ * of a node share a cache line, which pays off when, as in fast marching, decrease-key operations
+ * outnumber removals.
+ *
+ * This is a plain C++ template, not a vtkObject; vtkvmtkMinHeap wraps it behind the VTK interface
+ * used by vtkvmtkNonManifoldFastMarching.
+ *
+ * @sa
+ * vtkvmtkMinHeap, vtkvmtkNonManifoldFastMarching
+ */
+
+#ifndef __vtkvmtkIndexedHeap_h
+#define __vtkvmtkIndexedHeap_h
+
+#include "vtkType.h"
+
+#include <vector>
+
+template <class TKey, int TArity = 4>
+class vtkvmtkIndexedHeap
+{
+  public:
+
+  /**
+   * Empties the heap and prepares it for ids in [0,numberOfIds).
+   */
+  void Initialize(vtkIdType numberOfIds)
+    {
+    this->Keys.clear();
+    this->Ids.clear();
+    this->Positions.assign(numberOfIds,-1);
+    }
+
+  /**
+   * Extends the range of admissible ids to [0,numberOfIds), keeping the heap contents.
+   */
+  void Resize(vtkIdType numberOfIds)
+    {
+    if (numberOfIds > static_cast<vtkIdType>(this->Positions.size()))
+      {
+      this->Positions.resize(numberOfIds,-1);
+      }
+    }
+
+  /**
+   * Preallocates storage for size elements.
+   */
+  void Reserve(vtkIdType size)
+    {
+    this->Keys.reserve(size);
+    this->Ids.reserve(size);
+    }
+
+  vtkIdType GetSize() const
+    { return static_cast<vtkIdType>(this->Ids.size()); }
+
+  bool IsEmpty() const
+    { return this->Ids.empty(); }
+
+  vtkIdType GetNumberOfIds() const
+    { return static_cast<vtkIdType>(this->Positions.size()); }
+
+  /**
+   * Tells whether id is currently in the heap.
+   */
+  bool Contains(vtkIdType id) const
+    { return this->Positions[id] != -1; }
+
+  /**
+   * Gets the id with the minimum key. The heap must not be empty.
+   */
+  vtkIdType GetMin() const
+    { return this->Ids[0]; }
+
+  /**
+   * Gets the minimum key. The heap must not be empty.
+   */
+  TKey GetMinKey() const
+    { return this->Keys[0]; }
+
+  /**
+   * Gets the key of an id in the heap.
+   */
+  TKey GetKey(vtkIdType id) const
+    { return this->Keys[this->Positions[id]]; }
+
+  /**
+   * Inserts id with the given key. id must not be in the heap already.
+   */
+  void Insert(vtkIdType id, TKey key)
+    {
+    this->Keys.push_back(key);
+    this->Ids.push_back(id);
+    this->SiftUp(static_cast<vtkIdType>(this->Ids.size())-1,id,key);
+    }
+
+  /**
+   * Lowers the key of an id in the heap. key must not be larger than the current key.
+   */
+  void DecreaseKey(vtkIdType id, TKey key)
+    {
+    this->SiftUp(this->Positions[id],id,key);
+    }
+
+  /**
+   * Changes the key of an id in the heap in either direction.
+   */
+  void UpdateKey(vtkIdType id, TKey key)
+    {
+    vtkIdType position = this->Positions[id];
+    if (key < this->Keys[position])
+      {
+      this->SiftUp(position,id,key);
+      }
+    else
+      {
+      this->SiftDown(position,id,key);
+      }
+    }
+
+  /**
+   * Inserts id, or updates its key if it is already in the heap.
+   */
+  void InsertOrUpdate(vtkIdType id, TKey key)
+    {
+    if (this->Contains(id))
+      {
+      this->UpdateKey(id,key);
+      }
+    else
+      {
+      this->Insert(id,key);
+      }
+    }
+
+  /**
+   * Removes the id with the minimum key and returns it. The heap must not be empty.
+   */
+  vtkIdType RemoveMin()
+    {
+    vtkIdType minId = this->Ids[0];
+    this->RemoveAt(0);
+    return minId;
+    }
+
+  /**
+   * Removes id from the heap, if present.
+   */
+  void Remove(vtkIdType id)
+    {
+    if (this->Contains(id))
+      {
+      this->RemoveAt(this->Positions[id]);
+      }
+    }
+
+  protected:
+
+  void RemoveAt(vtkIdType position)
+    {
+    this->Positions[this->Ids[position]] = -1;
+    vtkIdType lastPosition = static_cast<vtkIdType>(this->Ids.size()) - 1;
+    TKey lastKey = this->Keys[lastPosition];
+    vtkIdType lastId = this->Ids[lastPosition];
+    this->Keys.pop_back();
+    this->Ids.pop_back();
+    if (position == lastPosition)
+      {
+      return;
+      }
+    if (position > 0 && lastKey < this->Keys[(position-1)/TArity])
+      {
+      this->SiftUp(position,lastId,lastKey);
+      }
+    else
+      {
+      this->SiftDown(position,lastId,lastKey);
+      }
+    }
+
+  // Moves the hole at position towards the root until key fits, then stores (id,key) there.
+  void SiftUp(vtkIdType position, vtkIdType id, TKey key)
+    {
+    while (position > 0)
+      {
+      vtkIdType parent = (position - 1) / TArity;
+      if (!(key < this->Keys[parent]))
+        {
+        break;
+        }
+      this->Keys[position] = this->Keys[parent];
+      this->Ids[position] = this->Ids[parent];
+      this->Positions[this->Ids[position]] = position;
+      position = parent;
+      }
+    this->Keys[position] = key;
+    this->Ids[position] = id;
+    this->Positions[id] = position;
+    }
+
+  // Moves the hole at position towards the leaves until key fits, then stores (id,key) there.
+  void SiftDown(vtkIdType position, vtkIdType id, TKey key)
+    {
+    vtkIdType size = static_cast<vtkIdType>(this->Ids.size());
+    while (true)
+      {
+      vtkIdType firstChild = TArity * position + 1;
+      if (firstChild >= size)
+        {
+        break;
+        }
+      vtkIdType lastChild = firstChild + TArity < size ? firstChild + TArity : size;
+      vtkIdType minChild = firstChild;
+      for (vtkIdType child=firstChild+1; child<lastChild; child++)
+        {
+        if (this->Keys[child] < this->Keys[minChild])
+          {
+          minChild = child;
+          }
+        }
+      if (!(this->Keys[minChild] < key))
+        {
+        break;
+        }
+      this->Keys[position] = this->Keys[minChild];
+      this->Ids[position] = this->Ids[minChild];
+      this->Positions[this->Ids[position]] = position;
+      position = minChild;
+      }
+    this->Keys[position] = key;
+    this->Ids[position] = id;
+    this->Positions[id] = position;
+    }
+
+  std::vector<TKey> Keys;
+  std::vector<vtkIdType> Ids;
+  std::vector<vtkIdType> Positions;
+};
+
+#endif
@@ -31,10 +31,179 @@ Version:   $Revision: 1.5 $
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkIdTypeArray.h"
+#include "vtkSMPTools.h"
+
+#include <vector>
 
 
 vtkStandardNewMacro(vtkvmtkInternalTetrahedraExtractor);
 
+static const vtkIdType VTK_VMTK_TETRAHEDRA_BLOCK_SIZE = 4096;
+
+// Evaluates the retention inequality on a range of tetrahedra and writes the result in the keep mask.
+class vtkvmtkInternalTetrahedraExtractorClassifyFunctor
+{
+public:
+  vtkUnstructuredGrid* Input;
+  vtkDataArray* OutwardPointNormals;
+  const vtkIdType* TetraPointIds;
+  const char* IsCapCenter;
+  double Tolerance;
+  int* KeepCell;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    double circumcenter[3];
+    double p0[3], p1[3], p2[3], p3[3];
+    double v0[3], v1[3], v2[3], v3[3], n0[3], n1[3], n2[3], n3[3];
+    double dot0, dot1, dot2, dot3;
+    bool boundaryTetra;
+    bool allDotPositive, allDotMinusOnePositive;
+    vtkIdType i;
+    int j;
+
+    double tolerance = this->Tolerance;
+
+    for (i=begin; i<end; i++)
+      {
+      const vtkIdType* pts = this->TetraPointIds + 4*i;
+
+      this->KeepCell[i] = 0;
+
+      if (pts[0] == -1)
+        {
+        continue;
+        }
+
+      boundaryTetra = false;
+      if (this->IsCapCenter)
+        {
+        for (j=0; j<4; j++)
+          {
+          if (this->IsCapCenter[pts[j]])
+            {
+            boundaryTetra = true;
+            }
+          }
+        }
+
+      this->Input->GetPoint(pts[0],p0);
+      this->Input->GetPoint(pts[1],p1);
+      this->Input->GetPoint(pts[2],p2);
+      this->Input->GetPoint(pts[3],p3);
+      vtkTetra::Circumsphere(p0,p1,p2,p3,circumcenter);
+
+      for (j=0; j<3; j++)
+        {
+        v0[j] = p0[j] - circumcenter[j];
+        v1[j] = p1[j] - circumcenter[j];
+        v2[j] = p2[j] - circumcenter[j];
+        v3[j] = p3[j] - circumcenter[j];
+        }
+
+      this->OutwardPointNormals->GetTuple(pts[0],n0);
+      this->OutwardPointNormals->GetTuple(pts[1],n1);
+      this->OutwardPointNormals->GetTuple(pts[2],n2);
+      this->OutwardPointNormals->GetTuple(pts[3],n3);
+
+      dot0 = vtkMath::Dot(v0,n0);
+      dot1 = vtkMath::Dot(v1,n1);
+      dot2 = vtkMath::Dot(v2,n2);
+      dot3 = vtkMath::Dot(v3,n3);
+
+      allDotPositive = false;
+      allDotMinusOnePositive = false;
+
+      if ((dot0>tolerance)&&(dot1>tolerance)&&(dot2>tolerance)&&(dot3>tolerance))
+        {
+        allDotPositive = true;
+        }
+      else if (((dot0>tolerance)&&(dot1>tolerance)&&(dot2>tolerance))||
+               ((dot0>tolerance)&&(dot1>tolerance)&&(dot3>tolerance))||
+               ((dot0>tolerance)&&(dot2>tolerance)&&(dot3>tolerance))||
+               ((dot1>tolerance)&&(dot2>tolerance)&&(dot3>tolerance)))
+        {
+        allDotMinusOnePositive = true;
+        }
+
+      if (allDotPositive)
+        {
+        this->KeepCell[i] = 1;
+        }
+      else if (boundaryTetra)
+        {
+        if (allDotMinusOnePositive)
+          {
+          this->KeepCell[i] = 1;
+          }
+        }
+      }
+    }
+};
+
+// Counts the retained tetrahedra of each block of VTK_VMTK_TETRAHEDRA_BLOCK_SIZE cells.
+class vtkvmtkInternalTetrahedraExtractorCountFunctor
+{
+public:
+  const int* KeepCell;
+  vtkIdType NumberOfCells;
+  vtkIdType* BlockCounts;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType b=begin; b<end; b++)
+      {
+      vtkIdType firstCellId = b * VTK_VMTK_TETRAHEDRA_BLOCK_SIZE;
+      vtkIdType lastCellId = firstCellId + VTK_VMTK_TETRAHEDRA_BLOCK_SIZE < this->NumberOfCells ? firstCellId + VTK_VMTK_TETRAHEDRA_BLOCK_SIZE : this->NumberOfCells;
+      vtkIdType count = 0;
+      for (vtkIdType i=firstCellId; i<lastCellId; i++)
+        {
+        if (this->KeepCell[i])
+          {
+          count++;
+          }
+        }
+      this->BlockCounts[b] = count;
+      }
+    }
+};
+
+// Writes the retained tetrahedra of each block from the block offset on, in (npts,ids) cell array layout.
+class vtkvmtkInternalTetrahedraExtractorCompactFunctor
+{
+public:
+  const int* KeepCell;
+  const vtkIdType* TetraPointIds;
+  vtkIdType NumberOfCells;
+  const vtkIdType* BlockOffsets;
+  vtkIdType* Cells;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType b=begin; b<end; b++)
+      {
+      vtkIdType firstCellId = b * VTK_VMTK_TETRAHEDRA_BLOCK_SIZE;
+      vtkIdType lastCellId = firstCellId + VTK_VMTK_TETRAHEDRA_BLOCK_SIZE < this->NumberOfCells ? firstCellId + VTK_VMTK_TETRAHEDRA_BLOCK_SIZE : this->NumberOfCells;
+      vtkIdType* cell = this->Cells + 5*this->BlockOffsets[b];
+      for (vtkIdType i=firstCellId; i<lastCellId; i++)
+        {
+        if (!this->KeepCell[i])
+          {
+          continue;
+          }
+        cell[0] = 4;
+        cell[1] = this->TetraPointIds[4*i];
+        cell[2] = this->TetraPointIds[4*i+1];
+        cell[3] = this->TetraPointIds[4*i+2];
+        cell[4] = this->TetraPointIds[4*i+3];
+        cell += 5;
+        }
+      }
+    }
+};
+
+
 vtkvmtkInternalTetrahedraExtractor::vtkvmtkInternalTetrahedraExtractor()
 {
   this->UseCaps = 0;
@@ -81,13 +250,11 @@ int vtkvmtkInternalTetrahedraExtractor::RequestData(
   // Declare
   double circumcenter[3];
   double p0[3], p1[3], p2[3], p3[3];
-  double v0[3], v1[3], v2[3], v3[3], n0[3], n1[3], n2[3], n3[3];
-  double dot0, dot1, dot2, dot3;
-  bool boundaryTetra;
-  bool allDotPositive, allDotMinusOnePositive;
   vtkIdType i, j;
+  vtkIdType npts;
+  const vtkIdType *pts;
   vtkCellArray* newTetras;
-  vtkIdList* newCellTypes;
+  vtkIdTypeArray* newTetrasData;
   vtkIntArray* keepCell;
   vtkDataArray* outwardPointNormals;
   vtkTetra* tetra;
@@ -137,93 +304,58 @@ int vtkvmtkInternalTetrahedraExtractor::RequestData(
     }
 
   // Allocate
+  vtkIdType numberOfCells = input->GetNumberOfCells();
   newTetras = vtkCellArray::New();
-  newCellTypes = vtkIdList::New();
   keepCell = vtkIntArray::New();
-  keepCell->SetNumberOfTuples(input->GetNumberOfCells());
+  keepCell->SetNumberOfTuples(numberOfCells);
 
   // Execute 
 
   //skeleton: dual of inner delaunay tets (Attali, Sk0)(not necessarily internal) or inner voronoi elements (Sk2)(not necessarily homotpic).
   //actual choice: Sk2. 
 
-  double tolerance = this->Tolerance;
-
-  for (i=0; i<input->GetNumberOfCells(); i++)
+  // connectivity is copied serially, since cell access is not thread safe; -1 marks cells other than tetrahedra
+  std::vector<vtkIdType> tetraPointIds(4*numberOfCells);
+  for (i=0; i<numberOfCells; i++)
     {
-    tetra = vtkTetra::SafeDownCast(input->GetCell(i));
-
-    if (!tetra)
+    if (input->GetCellType(i) != VTK_TETRA)
       {
+      tetraPointIds[4*i] = -1;
       continue;
       }
-
-    boundaryTetra = false;
-    if (this->UseCaps)
-      {
-      for (j=0; j<tetra->GetNumberOfPoints(); j++)
-        {
-        if (this->CapCenterIds->IsId(tetra->GetPointId(j))!=-1)
-          {
-          boundaryTetra = true;
-          }
-        }
-      } 
-
-    tetra->GetPoints()->GetPoint(0,p0);
-    tetra->GetPoints()->GetPoint(1,p1);
-    tetra->GetPoints()->GetPoint(2,p2);
-    tetra->GetPoints()->GetPoint(3,p3);
-    vtkTetra::Circumsphere(p0,p1,p2,p3,circumcenter);
-
-    for (j=0; j<3; j++)
+    input->GetCellPoints(i,npts,pts);
+    for (j=0; j<4; j++)
       {
-      v0[j] = p0[j] - circumcenter[j];
-      v1[j] = p1[j] - circumcenter[j];
-      v2[j] = p2[j] - circumcenter[j];
-      v3[j] = p3[j] - circumcenter[j];
+      tetraPointIds[4*i+j] = pts[j];
       }
-    
-    outwardPointNormals->GetTuple(tetra->GetPointId(0),n0);
-    outwardPointNormals->GetTuple(tetra->GetPointId(1),n1);
-    outwardPointNormals->GetTuple(tetra->GetPointId(2),n2);
-    outwardPointNormals->GetTuple(tetra->GetPointId(3),n3);
-
-    dot0 = vtkMath::Dot(v0,n0);
-    dot1 = vtkMath::Dot(v1,n1);
-    dot2 = vtkMath::Dot(v2,n2);
-    dot3 = vtkMath::Dot(v3,n3);
-
-    allDotPositive = false;
-    allDotMinusOnePositive = false;
-
-    if ((dot0>tolerance)&&(dot1>tolerance)&&(dot2>tolerance)&&(dot3>tolerance))
-      {
-      allDotPositive = true;
-      }
-    else if (((dot0>tolerance)&&(dot1>tolerance)&&(dot2>tolerance))||
-             ((dot0>tolerance)&&(dot1>tolerance)&&(dot3>tolerance))||
-             ((dot0>tolerance)&&(dot2>tolerance)&&(dot3>tolerance))||
-             ((dot1>tolerance)&&(dot2>tolerance)&&(dot3>tolerance)))
-      {
-      allDotMinusOnePositive = true;
-      }
-
-    keepCell->SetValue(i,0);
+    }
 
-    if (allDotPositive)
-      {
-      keepCell->SetValue(i,1);
-      }
-    else if (boundaryTetra)
+  std::vector<char> isCapCenter;
+  if (this->UseCaps)
+    {
+    isCapCenter.assign(input->GetNumberOfPoints(),0);
+    for (i=0; i<this->CapCenterIds->GetNumberOfIds(); i++)
       {
-      if (allDotMinusOnePositive)
+      vtkIdType capCenterId = this->CapCenterIds->GetId(i);
+      if (capCenterId >= 0 && capCenterId < input->GetNumberOfPoints())
         {
-        keepCell->SetValue(i,1);
+        isCapCenter[capCenterId] = 1;
         }
       }
     }
-    
+
+  if (numberOfCells > 0)
+    {
+    vtkvmtkInternalTetrahedraExtractorClassifyFunctor classifyFunctor;
+    classifyFunctor.Input = input;
+    classifyFunctor.OutwardPointNormals = outwardPointNormals;
+    classifyFunctor.TetraPointIds = &tetraPointIds[0];
+    classifyFunctor.IsCapCenter = isCapCenter.empty() ? NULL : &isCapCenter[0];
+    classifyFunctor.Tolerance = this->Tolerance;
+    classifyFunctor.KeepCell = keepCell->GetPointer(0);
+    vtkSMPTools::For(0,numberOfCells,classifyFunctor);
+    }
+
   if (this->RemoveSubresolutionTetrahedra)
     {
     double pt0[3], pt1[3], pt2[3];
@@ -296,37 +428,59 @@ int vtkvmtkInternalTetrahedraExtractor::RequestData(
       }
     cellNeighbors->Delete();
     }
- 
-  for (i=0; i<input->GetNumberOfCells(); i++)
+
+  // parallel compaction of the retained tetrahedra, in input order
+  vtkIdType numberOfBlocks = (numberOfCells + VTK_VMTK_TETRAHEDRA_BLOCK_SIZE - 1) / VTK_VMTK_TETRAHEDRA_BLOCK_SIZE;
+  std::vector<vtkIdType> blockOffsets(numberOfBlocks+1,0);
+
+  vtkvmtkInternalTetrahedraExtractorCountFunctor countFunctor;
+  countFunctor.KeepCell = keepCell->GetPointer(0);
+  countFunctor.NumberOfCells = numberOfCells;
+  countFunctor.BlockCounts = &blockOffsets[1];
+  vtkSMPTools::For(0,numberOfBlocks,countFunctor);
+
+  for (i=0; i<numberOfBlocks; i++)
     {
-    if (keepCell->GetValue(i))
-      {
-      newCellTypes->InsertNextId(VTK_TETRA);
-      newTetras->InsertNextCell(input->GetCell(i));
-      }
+    blockOffsets[i+1] += blockOffsets[i];
     }
+  vtkIdType numberOfNewTetras = blockOffsets[numberOfBlocks];
+
+  newTetrasData = vtkIdTypeArray::New();
+  newTetrasData->SetNumberOfValues(5*numberOfNewTetras);
 
-  int* newCellTypesInt = new int[newCellTypes->GetNumberOfIds()];
-  for (i=0; i<newCellTypes->GetNumberOfIds(); i++)
+  if (numberOfNewTetras > 0)
     {
-    newCellTypesInt[i] = newCellTypes->GetId(i);
+    vtkvmtkInternalTetrahedraExtractorCompactFunctor compactFunctor;
+    compactFunctor.KeepCell = keepCell->GetPointer(0);
+    compactFunctor.TetraPointIds = &tetraPointIds[0];
+    compactFunctor.NumberOfCells = numberOfCells;
+    compactFunctor.BlockOffsets = &blockOffsets[0];
+    compactFunctor.Cells = newTetrasData->GetPointer(0);
+    vtkSMPTools::For(0,numberOfBlocks,compactFunctor);
     }
 
+  newTetras->SetCells(numberOfNewTetras,newTetrasData);
+
+  std::vector<int> newCellTypesInt(numberOfNewTetras+1,VTK_TETRA);
+
   output->SetPoints(input->GetPoints());
   output->GetPointData()->PassData(input->GetPointData());
-  output->SetCells(newCellTypesInt,newTetras);
+  output->SetCells(&newCellTypesInt[0],newTetras);
 
   // Destroy
   newTetras->Delete();
-  newCellTypes->Delete();
+  newTetrasData->Delete();
   keepCell->Delete();
 
-  delete[] newCellTypesInt;
-
   return 1;
 }
 
 void vtkvmtkInternalTetrahedraExtractor::PrintSelf(std::ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "UseCaps: " << this->UseCaps << "\n";
+  os << indent << "Tolerance: " << this->Tolerance << "\n";
+  os << indent << "RemoveSubresolutionTetrahedra: " << this->RemoveSubresolutionTetrahedra << "\n";
+  os << indent << "SubresolutionFactor: " << this->SubresolutionFactor << "\n";
 }
@@ -21,6 +21,8 @@ Program:   VMTK
  *
  * This class takes in input the Delaunay tessellation of a point set and extracts internal tetrahedra based on outward oriented point normals (to be provided as input point data array). A tetrahedron \f$T_i\f$ is retained if \f[(x_j - c_i) \cdot n_j \geq 0  \qquad  \forall x_j \in T_i \f] where \f$x_i\f$ are the vertices of \f$T_i\f$, \f$c_i\f$ its circumcenter and \f$n_j\f$ the normals at the vertices. It is possible to properly handle capped regions (generated with vtkCapPolyData) by activating UseCaps and providing the ids of cap centers.
  *
+ * Tetrahedra are classified in parallel (vtkSMPTools) into a keep mask, and the retained ones are compacted into the output in parallel, preserving their input order. The optional removal of sub-resolution tetrahedra (RemoveSubresolutionTetrahedra, off by default) depends on the order cells are visited and runs serially on the mask; leave it off when surface slivers need not be removed.
+ *
  * @sa
  * vtkCapPolyData
  */
@@ -23,13 +23,15 @@ Program:   VMTK
  *
  * In the present implementation, values are provided in a vtkDoubleArray, and element ids are inserted in the heap. Backpointers are used to access the heap by id. This class is optimized for working in conjunction with vtkNonManifoldFastMarching.
  *
+ * The heap itself is a vtkvmtkIndexedHeap (4-ary, contiguous storage): the value of an id is read from MinHeapScalars when the id is inserted or updated and kept next to it in the heap, so sifting does not go through the array. UpdateId performs a decrease-key (or increase-key) in place.
+ *
  * For more insight see J.A. Sethian, Level Set Methods and Fast Marching Methods, Cambridge University Press, 2nd Edition, 1999.
  *
  * @warning
  * Be sure to call Initialize() after defining MinHeapScalars.
  *
  * @sa
- * vtkNonManifoldFastMarching
+ * vtkNonManifoldFastMarching vtkvmtkIndexedHeap
  */
 
 #ifndef __vtkvmtkMinHeap_h
@@ -37,6 +39,7 @@ Program:   VMTK
 
 #include "vtkObject.h"
 #include "vtkDoubleArray.h"
+#include "vtkvmtkIndexedHeap.h"
 //#include "vtkvmtkComputationalGeometryWin32Header.h"
 #include "vtkvmtkWin32Header.h"
 
@@ -78,12 +81,13 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkMinHeap : public vtkObject
   void UpdateId(vtkIdType id);
 
   /**
-   * Gets the id of the minimum value in the min heap.
+   * Gets the id of the minimum value in the min heap, or -1 if the heap is empty.
    */
   vtkIdType GetMin();
 
   /**
-   * Gets the id of the minimum value in the min heap and removes it from the min heap.
+   * Gets the id of the minimum value in the min heap and removes it from the min heap. Returns -1 if
+   * the heap is empty.
    */
   vtkIdType RemoveMin();
 
@@ -91,17 +95,7 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkMinHeap : public vtkObject
   vtkvmtkMinHeap();
   ~vtkvmtkMinHeap();  
 
-  void Swap(vtkIdType loc0, vtkIdType loc1);
-  int IsLeaf(vtkIdType loc);
-  vtkIdType GetLeftChild(vtkIdType loc);
-  vtkIdType GetRightChild(vtkIdType loc);
-  vtkIdType GetParent(vtkIdType loc);
-  void SiftUp(vtkIdType loc);
-  void SiftDown(vtkIdType loc);
-  vtkIdType RemoveAt(vtkIdType loc);
-
-  vtkIdList* Heap;
-  vtkIdList* BackPointers;
+  vtkvmtkIndexedHeap<double> Heap;
 
   vtkDoubleArray* MinHeapScalars;
 
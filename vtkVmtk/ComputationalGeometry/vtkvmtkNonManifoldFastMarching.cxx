@@ -44,6 +44,11 @@ vtkvmtkNonManifoldFastMarching::vtkvmtkNonManifoldFastMarching()
   this->StatusScalars = vtkCharArray::New();
   this->ConsideredMinHeap = vtkvmtkMinHeap::New();
 
+  this->Adjacency = NULL;
+  this->InternalAdjacency = vtkvmtkPolyDataAdjacency::New();
+  this->CurrentAdjacency = NULL;
+  this->CostFunctionArray = NULL;
+
   this->Regularization = 0.0;
   this->StopTravelTime = VTK_VMTK_LARGE_DOUBLE;
   this->StopNumberOfPoints = VTK_VMTK_LARGE_INTEGER;
@@ -97,6 +102,14 @@ vtkvmtkNonManifoldFastMarching::~vtkvmtkNonManifoldFastMarching()
     this->StopSeedId->Delete();
     this->StopSeedId = NULL;
     }
+
+  if (this->Adjacency)
+    {
+    this->Adjacency->Delete();
+    this->Adjacency = NULL;
+    }
+
+  this->InternalAdjacency->Delete();
   this->TScalars->Delete();
   this->StatusScalars->Delete();
   this->ConsideredMinHeap->Delete();
@@ -110,7 +123,7 @@ void vtkvmtkNonManifoldFastMarching::InitPropagation(vtkPolyData* input)
   const vtkIdType *pts;
   vtkIdType ncells;
   vtkIdType intersectedEdge[2];
-  vtkDataArray* initializationArray, *costFunctionArray, *intersectedEdgesArray;
+  vtkDataArray* initializationArray, *intersectedEdgesArray;
   vtkIdList* neighborCells;
   vtkIdList* neighborIds;
   vtkIdList* boundaryPointIds;
@@ -134,13 +147,25 @@ void vtkvmtkNonManifoldFastMarching::InitPropagation(vtkPolyData* input)
     initializationArray = input->GetPointData()->GetArray(this->InitializationArrayName);
     }
 
+  this->CostFunctionArray = NULL;
   if (!this->UnitSpeed)
     {
-    costFunctionArray = input->GetPointData()->GetArray(this->CostFunctionArrayName);
+    this->CostFunctionArray = input->GetPointData()->GetArray(this->CostFunctionArrayName);
     }
 
-  input->BuildCells();
-  input->BuildLinks();
+  if (this->Adjacency)
+    {
+    this->CurrentAdjacency = this->Adjacency;
+    if (!this->CurrentAdjacency->IsBuiltFor(input))
+      {
+      this->CurrentAdjacency->Build(input);
+      }
+    }
+  else
+    {
+    this->CurrentAdjacency = this->InternalAdjacency;
+    this->CurrentAdjacency->Build(input);
+    }
 
   this->StatusScalars->SetNumberOfTuples(input->GetNumberOfPoints());
   this->StatusScalars->FillComponent(0,VTK_VMTK_FAR_STATUS);
@@ -172,6 +197,8 @@ void vtkvmtkNonManifoldFastMarching::InitPropagation(vtkPolyData* input)
   
   if (this->PolyDataBoundaryConditions)
     {
+    input->BuildCells();
+    input->BuildLinks();
     this->BoundaryPolyData->BuildCells();
     this->BoundaryPolyData->BuildLinks();
     intersectedEdgesArray = this->BoundaryPolyData->GetPointData()->GetArray(this->IntersectedEdgesArrayName);
@@ -252,27 +279,6 @@ void vtkvmtkNonManifoldFastMarching::InitPropagation(vtkPolyData* input)
   neighborIds->Delete();
 }
 
-void vtkvmtkNonManifoldFastMarching::GetNeighbors(vtkPolyData* input, vtkIdType pointId, vtkIdList* neighborIds)
-{
-  vtkIdType i, j;
-  vtkIdType npts, *cells;
-  const vtkIdType *pts;
-  vtkIdType ncells;
-
-  input->GetPointCells(pointId,ncells,cells);
-  for (i=0; i<ncells; i++)
-    {
-    input->GetCellPoints(cells[i],npts,pts);
-    for (j=0; j<npts; j++)
-      {
-      if (pts[j]!=pointId)
-        {
-        neighborIds->InsertUniqueId(pts[j]);
-        }
-      }
-    }
-}
-
 void vtkvmtkNonManifoldFastMarching::SolveQuadratic(double a, double b, double c, char &nSol, double &x0, double &x1)
 {
   double delta, q;
@@ -345,14 +351,9 @@ double vtkvmtkNonManifoldFastMarching::ComputeUpdateFromCellNeighbor(vtkPolyData
   char nSol;
   double bEq, aEq, cEq, uEq, FEq, tEq, tCompEq, t0Eq, t1Eq, t0CompEq, tCompEqLower, tCompEqHigher;
   double edgeLength;
-  vtkDataArray* costFunctionArray;
 
   pointIdForLineUpdate = -1;
   tCompEq = 0.0;
-  if (!this->UnitSpeed)
-    {
-    costFunctionArray = input->GetPointData()->GetArray(this->CostFunctionArrayName);
-    }
 
   if (this->UnitSpeed)
     {
@@ -360,7 +361,7 @@ double vtkvmtkNonManifoldFastMarching::ComputeUpdateFromCellNeighbor(vtkPolyData
     }
   else
     {
-    fScalar = costFunctionArray->GetTuple1(neighborId);
+    fScalar = this->CostFunctionArray->GetTuple1(neighborId);
     }
         
   neighborT = this->TScalars->GetValue(neighborId);
@@ -535,11 +536,10 @@ double vtkvmtkNonManifoldFastMarching::ComputeUpdateFromCellNeighbor(vtkPolyData
 void vtkvmtkNonManifoldFastMarching::UpdateNeighbor(vtkPolyData* input, vtkIdType neighborId)
 {
   vtkIdType i, j, k;
-  vtkIdType npts;
-  const vtkIdType *pts;
+  vtkIdType npts, ncells;
+  const vtkIdType *pts, *cells;
   vtkIdType trianglePts[3];
   double tMin, tScalar;
-  vtkIdList* neighborCellNeighborIds;
 
   if ((neighborId<0)||(neighborId>=this->TScalars->GetNumberOfTuples()))
     {
@@ -547,16 +547,14 @@ void vtkvmtkNonManifoldFastMarching::UpdateNeighbor(vtkPolyData* input, vtkIdTyp
     return;
     }
 
-  neighborCellNeighborIds = vtkIdList::New();
-
-  input->GetPointCells(neighborId,neighborCellNeighborIds);
+  this->CurrentAdjacency->GetPointCells(neighborId,ncells,cells);
 
   tMin = this->TScalars->GetValue(neighborId);
   trianglePts[0] = neighborId;
-  for (i=0; i<neighborCellNeighborIds->GetNumberOfIds(); i++)
+  for (i=0; i<ncells; i++)
     {
     // virtual triangulation
-    input->GetCellPoints(neighborCellNeighborIds->GetId(i),npts,pts);
+    this->CurrentAdjacency->GetCellPoints(cells[i],npts,pts);
     for (j=0; j<npts; j++)
       {
       if (pts[j]!=neighborId)
@@ -576,21 +574,17 @@ void vtkvmtkNonManifoldFastMarching::UpdateNeighbor(vtkPolyData* input, vtkIdTyp
     }
 
   this->TScalars->SetValue(neighborId,tMin);
-
-  neighborCellNeighborIds->Delete();
 }
 
 void vtkvmtkNonManifoldFastMarching::UpdateNeighborhood(vtkPolyData* input, vtkIdType pointId)
 {
-  vtkIdList* neighborIds;
-  vtkIdType i, neighborId;
-
-  neighborIds = vtkIdList::New();
+  vtkIdType i, neighborId, numberOfNeighbors;
+  const vtkIdType* neighborIds;
 
-  this->GetNeighbors(input,pointId,neighborIds);
-  for (i=0; i<neighborIds->GetNumberOfIds(); i++)
+  this->CurrentAdjacency->GetPointNeighbors(pointId,numberOfNeighbors,neighborIds);
+  for (i=0; i<numberOfNeighbors; i++)
     {
-    neighborId = neighborIds->GetId(i);
+    neighborId = neighborIds[i];
     if (this->StatusScalars->GetValue(neighborId)!=VTK_VMTK_ACCEPTED_STATUS)
       {
       this->UpdateNeighbor(input,neighborId);
@@ -605,8 +599,6 @@ void vtkvmtkNonManifoldFastMarching::UpdateNeighborhood(vtkPolyData* input, vtkI
         }
       }
     }
-
-  neighborIds->Delete();
 }
 
 void vtkvmtkNonManifoldFastMarching::Propagate(vtkPolyData* input)
@@ -702,7 +694,7 @@ int vtkvmtkNonManifoldFastMarching::RequestData(
       }
     for (i=0; i<this->Seeds->GetNumberOfIds(); i++)
       {
-      if ((this->Seeds->GetId(i)<0) || (this->Seeds->GetId(i)>input->GetNumberOfPoints()))
+      if ((this->Seeds->GetId(i)<0) || (this->Seeds->GetId(i)>=input->GetNumberOfPoints()))
         {
         vtkErrorMacro(<<"Seed id exceeds input number of points!");
         return 1;
@@ -737,6 +729,10 @@ int vtkvmtkNonManifoldFastMarching::RequestData(
 
   this->Propagate(input);
 
+  this->CurrentAdjacency = NULL;
+  this->CostFunctionArray = NULL;
+  this->InternalAdjacency->Initialize();
+
   int naccepted = 0, nconsidered = 0, nfar = 0;
   for (i=0; i<input->GetNumberOfPoints(); i++)
     {
@@ -788,4 +784,6 @@ int vtkvmtkNonManifoldFastMarching::RequestData(
 void vtkvmtkNonManifoldFastMarching::PrintSelf(std::ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "Adjacency: " << this->Adjacency << "\n";
 }
@@ -27,9 +27,11 @@ Program:   VMTK
  *
  * The Regularization value adds a constant term to F(x), which acts as a regularization term for the minimal cost paths (see L.D. Cohen and R. Kimmel. Global minimum of active contour models: a minimal path approach. IJCV, 24(1): 57-78, Aug 1997).
  *
+ * The propagation runs on a compressed (CSR) point-to-point and point-to-cell adjacency of the input (see vtkvmtkPolyDataAdjacency), which is built once at initialization. When the filter is run several times on the same poly data (e.g. with different seeds), a vtkvmtkPolyDataAdjacency can be set with SetAdjacency: it is built at the first execution and reused as long as the cells of the input are not modified (see vtkvmtkPolyDataAdjacency::IsBuiltFor).
+ *
  *
  * @sa
- * vtkVoronoiDiagram3D vtkMinHeap
+ * vtkVoronoiDiagram3D vtkMinHeap vtkvmtkPolyDataAdjacency
  */
 
 #ifndef __vtkvmtkNonManifoldFastMarching_h
@@ -40,6 +42,7 @@ Program:   VMTK
 #include "vtkIntArray.h"
 #include "vtkPolyData.h"
 #include "vtkvmtkMinHeap.h"
+#include "vtkvmtkPolyDataAdjacency.h"
 #include "vtkvmtkConstants.h"
 //#include "vtkvmtkComputationalGeometryWin32Header.h"
 #include "vtkvmtkWin32Header.h"
@@ -48,6 +51,7 @@ const char VTK_VMTK_ACCEPTED_STATUS = 0x01;
 const char VTK_VMTK_CONSIDERED_STATUS = 0x02;
 const char VTK_VMTK_FAR_STATUS = 0x04;
 
+class vtkDataArray;
 class vtkDoubleArray;
 class vtkCharArray;
 
@@ -182,6 +186,14 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkNonManifoldFastMarching : pu
   vtkGetStringMacro(SolutionArrayName);
   ///@}
 
+  ///@{
+  /**
+   * Set/Get the adjacency of the input to be used for the propagation. If not built for the input, it is built at the next execution and kept for the following ones, so that repeated runs on the same poly data skip the setup. If NULL (the default), a temporary adjacency is built at every execution.
+   */
+  vtkSetObjectMacro(Adjacency,vtkvmtkPolyDataAdjacency);
+  vtkGetObjectMacro(Adjacency,vtkvmtkPolyDataAdjacency);
+  ///@}
+
   protected:
   vtkvmtkNonManifoldFastMarching();
   ~vtkvmtkNonManifoldFastMarching();
@@ -192,7 +204,6 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkNonManifoldFastMarching : pu
 
   void SolveQuadratic(double a, double b, double c, char &nSol, double &x0, double &x1);
 
-  void GetNeighbors(vtkPolyData* input, vtkIdType pointId, vtkIdList* neighborIds);
   double ComputeUpdateFromCellNeighbor(vtkPolyData* input, vtkIdType neighborId, vtkIdType* trianglePts);
   void UpdateNeighbor(vtkPolyData* input, vtkIdType neighborId);
   void UpdateNeighborhood(vtkPolyData* input, vtkIdType pointId);
@@ -208,6 +219,11 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkNonManifoldFastMarching : pu
   vtkCharArray* StatusScalars;
   vtkvmtkMinHeap* ConsideredMinHeap;
 
+  vtkvmtkPolyDataAdjacency* Adjacency;
+  vtkvmtkPolyDataAdjacency* InternalAdjacency;
+  vtkvmtkPolyDataAdjacency* CurrentAdjacency;
+  vtkDataArray* CostFunctionArray;
+
   vtkIdList* Seeds;
   vtkIdList* StopSeedId;
   vtkPolyData* BoundaryPolyData;
@@ -20,6 +20,7 @@ Version:   $Revision: 1.4 $
 =========================================================================*/
 
 #include "vtkvmtkNonManifoldSteepestDescent.h"
+#include "vtkvmtkPolyDataAdjacency.h"
 #include "vtkPolyData.h"
 #include "vtkPointData.h"
 #include "vtkDoubleArray.h"
@@ -37,6 +38,7 @@ vtkvmtkNonManifoldSteepestDescent::vtkvmtkNonManifoldSteepestDescent()
 {
   this->DescentArrayName = NULL;
   this->DescentArray = NULL;
+  this->Adjacency = NULL;
   this->NumberOfEdgeSubdivisions = 250;
   this->Direction = VTK_VMTK_DOWNWARD;
 }
@@ -79,19 +81,26 @@ double vtkvmtkNonManifoldSteepestDescent::GetSteepestDescentInCell(vtkPolyData*
   currentPoint[0] = edgePoint0[0] * (1.0 - s) +  edgePoint1[0] * s;
   currentPoint[1] = edgePoint0[1] * (1.0 - s) +  edgePoint1[1] * s;
   currentPoint[2] = edgePoint0[2] * (1.0 - s) +  edgePoint1[2] * s;
-  currentScalar = this->DescentArray->GetTuple1(edge[0]) * (1.0 - s) +  this->DescentArray->GetTuple1(edge[1]) * s;
+  currentScalar = this->DescentArray->GetComponent(edge[0],0) * (1.0 - s) +  this->DescentArray->GetComponent(edge[1],0) * s;
 
   steepestDescent = - VTK_VMTK_LARGE_DOUBLE * directionFactor;
   steepestDescentLength = VTK_VMTK_LARGE_DOUBLE;
 
-  input->GetCellPoints(cellId,npts,pts);
+  if (this->Adjacency)
+    {
+    this->Adjacency->GetCellPoints(cellId,npts,pts);
+    }
+  else
+    {
+    input->GetCellPoints(cellId,npts,pts);
+    }
         
   for (i=0; i<npts; i++)
     {
     input->GetPoint(pts[i],point0);
     input->GetPoint(pts[(i+1)%npts],point1);
-    scalar0 = this->DescentArray->GetTuple1(pts[i]);
-    scalar1 = this->DescentArray->GetTuple1(pts[(i+1)%npts]);
+    scalar0 = this->DescentArray->GetComponent(pts[i],0);
+    scalar1 = this->DescentArray->GetComponent(pts[(i+1)%npts],0);
 
     if (edge[0]==edge[1])
       {
@@ -182,7 +191,7 @@ double vtkvmtkNonManifoldSteepestDescent::GetSteepestDescent(vtkPolyData* input,
 
   neighborCells = vtkIdList::New();
   
-  input->GetCellEdgeNeighbors(-1,edge[0],edge[1],neighborCells);
+  this->GetEdgeNeighborCells(input,edge,neighborCells);
 
   if (this->Direction==VTK_VMTK_DOWNWARD)
     {
@@ -216,6 +225,35 @@ double vtkvmtkNonManifoldSteepestDescent::GetSteepestDescent(vtkPolyData* input,
   return steepestDescent;
 }
 
+void vtkvmtkNonManifoldSteepestDescent::GetEdgeNeighborCells(vtkPolyData* input, vtkIdType* edge, vtkIdList* neighborCells)
+{
+  vtkIdType i, j;
+  vtkIdType ncells, npts;
+  const vtkIdType *cells, *pts;
+
+  if (!this->Adjacency)
+    {
+    input->GetCellEdgeNeighbors(-1,edge[0],edge[1],neighborCells);
+    return;
+    }
+
+  // same cells, in the same order, as vtkPolyData::GetCellEdgeNeighbors
+  neighborCells->Reset();
+  this->Adjacency->GetPointCells(edge[0],ncells,cells);
+  for (i=0; i<ncells; i++)
+    {
+    this->Adjacency->GetCellPoints(cells[i],npts,pts);
+    for (j=0; j<npts; j++)
+      {
+      if (pts[j]==edge[1])
+        {
+        neighborCells->InsertNextId(cells[i]);
+        break;
+        }
+      }
+    }
+}
+
 int vtkvmtkNonManifoldSteepestDescent::RequestData(
   vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector,
@@ -21,6 +21,8 @@ Program:   VMTK
  *
  * This class is an abstract filter used as base class for performing steepest descent on a non-manifold surface made of convex polygons (such as the Voronoi diagram) on the basis of a given scalar field. Steepest descent is performed on the edges of input polygons with a first order approximation.
  *
+ * The descent queries only read the input, so they can be issued concurrently by subclasses, provided that the topology is taken from a prebuilt vtkvmtkPolyDataAdjacency (Adjacency member) rather than from the cell links of the input.
+ *
  *
  * @sa
  * vtkSteepestDescentLineTracer vtkSurfaceToCenterlines vtkVoronoiDiagram3D
@@ -37,6 +39,9 @@ Program:   VMTK
 #define VTK_VMTK_DOWNWARD 0
 #define VTK_VMTK_UPWARD 1
 
+class vtkIdList;
+class vtkvmtkPolyDataAdjacency;
+
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkNonManifoldSteepestDescent : public vtkPolyDataAlgorithm
 {
   public:
@@ -85,9 +90,17 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkNonManifoldSteepestDescent :
   double GetSteepestDescentInCell(vtkPolyData* input, vtkIdType cellId, vtkIdType* edge, double s, vtkIdType* steepestDescentEdge, double &steepestDescentS, double &steepestDescentLength);
   ///@}
 
+  /**
+   * Get the cells sharing edge (a point id pair, or the same id twice for a vertex), from Adjacency if set, from the cell links of input otherwise.
+   */
+  void GetEdgeNeighborCells(vtkPolyData* input, vtkIdType* edge, vtkIdList* neighborCells);
+
   vtkDataArray* DescentArray;
   char* DescentArrayName;
 
+  // not owned, set by subclasses for the duration of an execution
+  vtkvmtkPolyDataAdjacency* Adjacency;
+
   int NumberOfEdgeSubdivisions;
   int Direction;
 
@@ -21,8 +21,61 @@ Version:   $Revision: 1.2 $
 #include "vtkvmtkPolyBall.h"
 #include "vtkvmtkConstants.h"
 #include "vtkPointData.h"
+#include "vtkDataArray.h"
+#include "vtkIdTypeArray.h"
 #include "vtkObjectFactory.h"
 
+#include <algorithm>
+#include <vector>
+
+// Structure-of-arrays copy of the ball centers and squared radii. Function values are computed a
+// block at a time in a branch-free loop the compiler can vectorize, and the minimum is then selected
+// with the same sequential rule used by the original point-by-point scan.
+class vtkvmtkPolyBallCenters
+{
+public:
+  enum
+    {
+    BlockSize = 256
+    };
+
+  std::vector<double> X;
+  std::vector<double> Y;
+  std::vector<double> Z;
+  std::vector<double> Radius2;
+
+  double Evaluate(const double x[3], vtkIdType& centerId) const
+    {
+    double block[BlockSize];
+    double minSphereFunctionValue = VTK_VMTK_LARGE_DOUBLE;
+    vtkIdType numberOfCenters = static_cast<vtkIdType>(this->X.size());
+    const double x0 = x[0];
+    const double x1 = x[1];
+    const double x2 = x[2];
+    for (vtkIdType start=0; start<numberOfCenters; start+=BlockSize)
+      {
+      int blockSize = static_cast<int>(std::min(static_cast<vtkIdType>(BlockSize),numberOfCenters-start));
+      const double* px = &this->X[start];
+      const double* py = &this->Y[start];
+      const double* pz = &this->Z[start];
+      const double* pr2 = &this->Radius2[start];
+      int i;
+      for (i=0; i<blockSize; i++)
+        {
+        block[i] = ((x0 - px[i]) * (x0 - px[i]) + (x1 - py[i]) * (x1 - py[i]) + (x2 - pz[i]) * (x2 - pz[i])) - pr2[i];
+        }
+      for (i=0; i<blockSize; i++)
+        {
+        if (block[i] - minSphereFunctionValue < VTK_VMTK_DOUBLE_TOL)
+          {
+          minSphereFunctionValue = block[i];
+          centerId = start + i;
+          }
+        }
+      }
+    return minSphereFunctionValue;
+    }
+};
 
 vtkStandardNewMacro(vtkvmtkPolyBall);
 
@@ -31,6 +84,7 @@ vtkvmtkPolyBall::vtkvmtkPolyBall()
   this->Input = NULL;
   this->PolyBallRadiusArrayName = NULL;
   this->LastPolyBallCenterId = -1;
+  this->Centers = NULL;
 }
 
 vtkvmtkPolyBall::~vtkvmtkPolyBall()
@@ -46,19 +100,30 @@ vtkvmtkPolyBall::~vtkvmtkPolyBall()
     delete[] this->PolyBallRadiusArrayName;
     this->PolyBallRadiusArrayName = NULL;
     }
+
+  if (this->Centers)
+    {
+    delete this->Centers;
+    this->Centers = NULL;
+    }
 }
 
-double vtkvmtkPolyBall::EvaluateFunction(double x[3])
+int vtkvmtkPolyBall::BuildCenters()
 {
-  double px[3], pr;
-  int i;
-  double sphereFunctionValue, minSphereFunctionValue;
-  vtkDataArray* polyballRadiusArray;
-
   if (!this->Input)
     {
     vtkErrorMacro("No Input specified!");
-    return 0.0;
+    return 0;
+    }
+
+  if (!this->Centers)
+    {
+    this->Centers = new vtkvmtkPolyBallCenters;
+    }
+
+  if (this->CentersBuildTime > this->GetMTime() && this->CentersBuildTime > this->Input->GetMTime())
+    {
+    return 1;
     }
 
   if (this->Input->GetNumberOfPoints()==0)
@@ -69,35 +134,94 @@ double vtkvmtkPolyBall::EvaluateFunction(double x[3])
   if (!this->PolyBallRadiusArrayName)
     {
     vtkErrorMacro("No PolyBallRadiusArrayName specified!");
-    return 0.0;
+    return 0;
     }
 
-  if (!this->Input->GetPointData()->GetArray(this->PolyBallRadiusArrayName))
+  vtkDataArray* polyballRadiusArray = this->Input->GetPointData()->GetArray(this->PolyBallRadiusArrayName);
+
+  if (!polyballRadiusArray)
     {
     vtkErrorMacro("PolyBallRadiusArray with name specified does not exist!");
-    return 0.0;
+    return 0;
     }
 
-  polyballRadiusArray = this->Input->GetPointData()->GetArray(this->PolyBallRadiusArrayName);
-  minSphereFunctionValue = VTK_VMTK_LARGE_DOUBLE;
-  for (i=0; i<this->Input->GetNumberOfPoints(); i++)
+  vtkIdType numberOfCenters = this->Input->GetNumberOfPoints();
+  this->Centers->X.resize(numberOfCenters);
+  this->Centers->Y.resize(numberOfCenters);
+  this->Centers->Z.resize(numberOfCenters);
+  this->Centers->Radius2.resize(numberOfCenters);
+
+  double px[3], pr;
+  for (vtkIdType i=0; i<numberOfCenters; i++)
     {
-    // this next line actually copies the xyz location of point i into px[3].
-    // luca reports that odd bug happened when only retrieving pointers.
     this->Input->GetPoint(i,px);
     pr = polyballRadiusArray->GetComponent(i,0);
-    // x, y, z -> location of query point in R3
-    // px, py, pz => location of point with sphere radius == pr
-    // f = ((x - px)^2 + (y - py)^2 + (z - pz)^2) - pr^2
-    sphereFunctionValue = ((x[0] - px[0]) * (x[0] - px[0]) + (x[1] - px[1]) * (x[1] - px[1]) + (x[2] - px[2]) * (x[2] - px[2])) - pr*pr;
-    if (sphereFunctionValue - minSphereFunctionValue < VTK_VMTK_DOUBLE_TOL)
+    this->Centers->X[i] = px[0];
+    this->Centers->Y[i] = px[1];
+    this->Centers->Z[i] = px[2];
+    this->Centers->Radius2[i] = pr*pr;
+    }
+
+  this->CentersBuildTime.Modified();
+
+  return 1;
+}
+
+double vtkvmtkPolyBall::EvaluateFunction(double x[3])
+{
+  if (!this->BuildCenters())
+    {
+    return 0.0;
+    }
+
+  // sphere function f = ((x - px)^2 + (y - py)^2 + (z - pz)^2) - pr^2, minimized over all balls
+  return this->Centers->Evaluate(x,this->LastPolyBallCenterId);
+}
+
+void vtkvmtkPolyBall::EvaluatePoints(vtkDataArray* points, vtkDataArray* values, vtkIdTypeArray* centerIds)
+{
+  if (!points || !values)
+    {
+    vtkErrorMacro("No points or values array specified!");
+    return;
+    }
+
+  if (points->GetNumberOfComponents() != 3)
+    {
+    vtkErrorMacro("Points array must have 3 components!");
+    return;
+    }
+
+  vtkIdType numberOfPoints = points->GetNumberOfTuples();
+  values->SetNumberOfComponents(1);
+  values->SetNumberOfTuples(numberOfPoints);
+  if (centerIds)
+    {
+    centerIds->SetNumberOfComponents(1);
+    centerIds->SetNumberOfTuples(numberOfPoints);
+    }
+
+  if (!this->BuildCenters())
+    {
+    values->FillComponent(0,0.0);
+    if (centerIds)
       {
-      minSphereFunctionValue = sphereFunctionValue;
-      this->LastPolyBallCenterId = i;
+      centerIds->FillComponent(0,-1);
       }
+    return;
     }
 
-  return minSphereFunctionValue;
+  double x[3];
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    points->GetTuple(i,x);
+    vtkIdType centerId = -1;
+    values->SetTuple1(i,this->Centers->Evaluate(x,centerId));
+    if (centerIds)
+      {
+      centerIds->SetValue(i,centerId);
+      }
+    }
 }
 
 void vtkvmtkPolyBall::EvaluateGradient(double x[3], double n[3])
@@ -29,9 +29,14 @@ Program:   VMTK
 
 #include "vtkImplicitFunction.h"
 #include "vtkPolyData.h"
+#include "vtkTimeStamp.h"
 //#include "vtkvmtkComputationalGeometryWin32Header.h"
 #include "vtkvmtkWin32Header.h"
 
+class vtkDataArray;
+class vtkIdTypeArray;
+class vtkvmtkPolyBallCenters;
+
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyBall : public vtkImplicitFunction
 {
   public:
@@ -47,8 +52,18 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyBall : public vtkImplici
   double EvaluateFunction(double x[3]) override;
   double EvaluateFunction(double x, double y, double z) override
   {return this->vtkImplicitFunction::EvaluateFunction(x, y, z); } ;
+  void EvaluateFunction(vtkDataArray* input, vtkDataArray* output) override
+  { this->EvaluatePoints(input, output, NULL); } ;
   ///@}
 
+  /**
+   * Evaluate polyball at every 3-component tuple of points. Function values are stored in values
+   * and, if not NULL, the ids of the nearest poly ball centers in centerIds; both are resized to
+   * the number of points. Ball centers and squared radii are cached in contiguous arrays that are
+   * refreshed only when Input or the radius array name change.
+   */
+  void EvaluatePoints(vtkDataArray* points, vtkDataArray* values, vtkIdTypeArray* centerIds);
+
   /**
    * Evaluate polyball gradient.
    */
@@ -88,6 +103,11 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyBall : public vtkImplici
   char* PolyBallRadiusArrayName;
   vtkIdType LastPolyBallCenterId;
 
+  int BuildCenters();
+
+  vtkvmtkPolyBallCenters* Centers;
+  vtkTimeStamp CentersBuildTime;
+
   private:
   vtkvmtkPolyBall(const vtkvmtkPolyBall&);  // Not implemented.
   void operator=(const vtkvmtkPolyBall&);  // Not implemented.
@@ -21,10 +21,308 @@ Version:   $Revision: 1.5 $
 #include "vtkvmtkPolyBallLine.h"
 #include "vtkvmtkConstants.h"
 #include "vtkPointData.h"
+#include "vtkDataArray.h"
+#include "vtkIdTypeArray.h"
 #include "vtkPolyLine.h"
 #include "vtkObjectFactory.h"
 #include "vtkVersion.h"
 
+#include <algorithm>
+#include <vector>
+
+// Flat copy of the selected centerline segments organized in a bounding volume hierarchy. Each node
+// stores the box enclosing the endpoints of its segments and the largest squared radius among them:
+// since any sphere (c,r) interpolated along a segment has |x-c|^2 - r^2 >= dist(x,box)^2 - maxRadius^2,
+// nodes whose bound exceeds the current minimum cannot contain the closest sphere and are skipped.
+class vtkvmtkPolyBallLineSegmentTree
+{
+public:
+  struct Segment
+    {
+    double Point0[3];
+    double Point1[3];
+    double Vector0[4];
+    double Radius0;
+    double Radius1;
+    double Den;
+    vtkIdType CellId;
+    vtkIdType SubId;
+    };
+
+  struct Node
+    {
+    double Bounds[6];
+    double MaxRadius2;
+    vtkIdType First;
+    vtkIdType Count;
+    vtkIdType Right;
+    };
+
+  enum
+    {
+    MaximumSegmentsPerLeaf = 4,
+    StackSize = 128
+    };
+
+  // Segments are stored in the order the exhaustive search visits them, so that ties can be broken
+  // in favour of the segment the exhaustive search would have picked.
+  std::vector<Segment> Segments;
+  std::vector<vtkIdType> Order;
+  std::vector<Node> Nodes;
+
+  // Cell selection the tree was built for.
+  std::vector<vtkIdType> CellIds;
+  int AllCells;
+
+  vtkvmtkPolyBallLineSegmentTree()
+    {
+    this->AllCells = 0;
+    }
+
+  void Initialize()
+    {
+    this->Segments.clear();
+    this->Order.clear();
+    this->Nodes.clear();
+    this->CellIds.clear();
+    this->AllCells = 0;
+    }
+
+  int MatchesSelection(vtkPolyData* input, vtkIdList* inputCellIds, vtkIdType inputCellId) const
+    {
+    if (inputCellIds)
+      {
+      if (this->AllCells || static_cast<vtkIdType>(this->CellIds.size()) != inputCellIds->GetNumberOfIds())
+        {
+        return 0;
+        }
+      return std::equal(this->CellIds.begin(),this->CellIds.end(),inputCellIds->GetPointer(0));
+      }
+    else if (inputCellId != -1)
+      {
+      return !this->AllCells && this->CellIds.size() == 1 && this->CellIds[0] == inputCellId;
+      }
+    return this->AllCells && static_cast<vtkIdType>(this->CellIds.size()) == input->GetNumberOfCells();
+    }
+
+  static inline double EvaluateSegment(const Segment& segment, const double x[3], double closestPoint[4], double& t)
+    {
+    double vector1[4];
+    vector1[0] = x[0] - segment.Point0[0];
+    vector1[1] = x[1] - segment.Point0[1];
+    vector1[2] = x[2] - segment.Point0[2];
+    vector1[3] = 0.0 - segment.Radius0;
+
+    const double* vector0 = segment.Vector0;
+    double num = vector0[0]*vector1[0] + vector0[1]*vector1[1] + vector0[2]*vector1[2] - vector0[3]*vector1[3];
+
+    t = num / segment.Den;
+
+    if (t<VTK_VMTK_DOUBLE_TOL)
+      {
+      t = 0.0;
+      closestPoint[0] = segment.Point0[0];
+      closestPoint[1] = segment.Point0[1];
+      closestPoint[2] = segment.Point0[2];
+      closestPoint[3] = segment.Radius0;
+      }
+    else if (1.0-t<VTK_VMTK_DOUBLE_TOL)
+      {
+      t = 1.0;
+      closestPoint[0] = segment.Point1[0];
+      closestPoint[1] = segment.Point1[1];
+      closestPoint[2] = segment.Point1[2];
+      closestPoint[3] = segment.Radius1;
+      }
+    else
+      {
+      closestPoint[0] = segment.Point0[0] + t * vector0[0];
+      closestPoint[1] = segment.Point0[1] + t * vector0[1];
+      closestPoint[2] = segment.Point0[2] + t * vector0[2];
+      closestPoint[3] = segment.Radius0 + t * vector0[3];
+      }
+
+    return (x[0]-closestPoint[0])*(x[0]-closestPoint[0]) + (x[1]-closestPoint[1])*(x[1]-closestPoint[1]) + (x[2]-closestPoint[2])*(x[2]-closestPoint[2]) - closestPoint[3]*closestPoint[3];
+    }
+
+  inline double NodeLowerBound(vtkIdType nodeId, const double x[3]) const
+    {
+    const Node& node = this->Nodes[nodeId];
+    double dist2 = 0.0;
+    for (int j=0; j<3; j++)
+      {
+      double d = 0.0;
+      if (x[j] < node.Bounds[2*j])
+        {
+        d = node.Bounds[2*j] - x[j];
+        }
+      else if (x[j] > node.Bounds[2*j+1])
+        {
+        d = x[j] - node.Bounds[2*j+1];
+        }
+      dist2 += d * d;
+      }
+    return dist2 - node.MaxRadius2;
+    }
+
+  void Build()
+    {
+    this->Nodes.clear();
+    this->Order.resize(this->Segments.size());
+    for (size_t i=0; i<this->Segments.size(); i++)
+      {
+      this->Order[i] = static_cast<vtkIdType>(i);
+      }
+    if (this->Segments.empty())
+      {
+      return;
+      }
+    this->Nodes.reserve(2 * this->Segments.size() / MaximumSegmentsPerLeaf + 1);
+    this->BuildNode(0,static_cast<vtkIdType>(this->Segments.size()));
+    }
+
+  vtkIdType BuildNode(vtkIdType first, vtkIdType count)
+    {
+    vtkIdType nodeId = static_cast<vtkIdType>(this->Nodes.size());
+    this->Nodes.push_back(Node());
+
+    Node node;
+    node.Bounds[0] = node.Bounds[2] = node.Bounds[4] = VTK_VMTK_LARGE_DOUBLE;
+    node.Bounds[1] = node.Bounds[3] = node.Bounds[5] = -VTK_VMTK_LARGE_DOUBLE;
+    node.MaxRadius2 = 0.0;
+    node.First = first;
+    node.Count = count;
+    node.Right = -1;
+
+    double centerBounds[6];
+    centerBounds[0] = centerBounds[2] = centerBounds[4] = VTK_VMTK_LARGE_DOUBLE;
+    centerBounds[1] = centerBounds[3] = centerBounds[5] = -VTK_VMTK_LARGE_DOUBLE;
+
+    vtkIdType i;
+    int j;
+    for (i=first; i<first+count; i++)
+      {
+      const Segment& segment = this->Segments[this->Order[i]];
+      for (j=0; j<3; j++)
+        {
+        node.Bounds[2*j] = std::min(node.Bounds[2*j],std::min(segment.Point0[j],segment.Point1[j]));
+        node.Bounds[2*j+1] = std::max(node.Bounds[2*j+1],std::max(segment.Point0[j],segment.Point1[j]));
+        double center = 0.5 * (segment.Point0[j] + segment.Point1[j]);
+        centerBounds[2*j] = std::min(centerBounds[2*j],center);
+        centerBounds[2*j+1] = std::max(centerBounds[2*j+1],center);
+        }
+      node.MaxRadius2 = std::max(node.MaxRadius2,std::max(segment.Radius0*segment.Radius0,segment.Radius1*segment.Radius1));
+      }
+
+    int axis = 0;
+    for (j=1; j<3; j++)
+      {
+      if (centerBounds[2*j+1] - centerBounds[2*j] > centerBounds[2*axis+1] - centerBounds[2*axis])
+        {
+        axis = j;
+        }
+      }
+
+    if (count <= MaximumSegmentsPerLeaf || centerBounds[2*axis+1] - centerBounds[2*axis] <= 0.0)
+      {
+      this->Nodes[nodeId] = node;
+      return nodeId;
+      }
+
+    vtkIdType middle = first + count / 2;
+    const std::vector<Segment>& segments = this->Segments;
+    std::nth_element(this->Order.begin()+first,this->Order.begin()+middle,this->Order.begin()+first+count,
+      [&segments,axis](vtkIdType a, vtkIdType b)
+        {
+        return segments[a].Point0[axis] + segments[a].Point1[axis] < segments[b].Point0[axis] + segments[b].Point1[axis];
+        });
+
+    node.Count = 0;
+    this->Nodes[nodeId] = node;
+    this->BuildNode(first,middle-first);
+    vtkIdType right = this->BuildNode(middle,first+count-middle);
+    this->Nodes[nodeId].Right = right;
+
+    return nodeId;
+    }
+
+  double Evaluate(const double x[3], vtkIdType& closestSegmentId, double closestPoint[4], double& closestT) const
+    {
+    double minValue = VTK_VMTK_LARGE_DOUBLE;
+    closestSegmentId = -1;
+
+    if (this->Nodes.empty())
+      {
+      return minValue;
+      }
+
+    vtkIdType stack[StackSize];
+    double stackBounds[StackSize];
+    int top = 0;
+    stack[top] = 0;
+    stackBounds[top] = this->NodeLowerBound(0,x);
+    top++;
+
+    double point[4];
+    double t;
+    while (top > 0)
+      {
+      top--;
+      if (stackBounds[top] > minValue)
+        {
+        continue;
+        }
+
+      vtkIdType nodeId = stack[top];
+      const Node& node = this->Nodes[nodeId];
+
+      if (node.Count > 0)
+        {
+        for (vtkIdType i=node.First; i<node.First+node.Count; i++)
+          {
+          vtkIdType segmentId = this->Order[i];
+          double value = EvaluateSegment(this->Segments[segmentId],x,point,t);
+          if (value < minValue || (value == minValue && segmentId < closestSegmentId))
+            {
+            minValue = value;
+            closestSegmentId = segmentId;
+            closestT = t;
+            closestPoint[0] = point[0];
+            closestPoint[1] = point[1];
+            closestPoint[2] = point[2];
+            closestPoint[3] = point[3];
+            }
+          }
+        continue;
+        }
+
+      // Push the farther child first so that the nearer one is visited next.
+      vtkIdType leftId = nodeId + 1;
+      vtkIdType rightId = node.Right;
+      double leftBound = this->NodeLowerBound(leftId,x);
+      double rightBound = this->NodeLowerBound(rightId,x);
+      if (leftBound > rightBound)
+        {
+        std::swap(leftId,rightId);
+        std::swap(leftBound,rightBound);
+        }
+      if (rightBound <= minValue && top < StackSize)
+        {
+        stack[top] = rightId;
+        stackBounds[top] = rightBound;
+        top++;
+        }
+      if (leftBound <= minValue && top < StackSize)
+        {
+        stack[top] = leftId;
+        stackBounds[top] = leftBound;
+        top++;
+        }
+      }
+
+    return minValue;
+    }
+};
 
 vtkStandardNewMacro(vtkvmtkPolyBallLine);
 
@@ -40,6 +338,8 @@ vtkvmtkPolyBallLine::vtkvmtkPolyBallLine()
   this->LastPolyBallCenter[0] = this->LastPolyBallCenter[1] = this->LastPolyBallCenter[2] = 0.0;
   this->LastPolyBallCenterRadius = 0.0;
   this->UseRadiusInformation = 1;
+  this->UseSpatialIndex = 0;
+  this->SpatialIndex = NULL;
 }
 
 vtkvmtkPolyBallLine::~vtkvmtkPolyBallLine()
@@ -61,6 +361,12 @@ vtkvmtkPolyBallLine::~vtkvmtkPolyBallLine()
     delete[] this->PolyBallRadiusArrayName;
     this->PolyBallRadiusArrayName = NULL;
     }
+
+  if (this->SpatialIndex)
+    {
+    delete this->SpatialIndex;
+    this->SpatialIndex = NULL;
+    }
 }
 
 double vtkvmtkPolyBallLine::ComplexDot(double x[4], double y[4])
@@ -68,6 +374,131 @@ double vtkvmtkPolyBallLine::ComplexDot(double x[4], double y[4])
   return x[0]*y[0] + x[1]*y[1] + x[2]*y[2] - x[3]*y[3];
 }
 
+int vtkvmtkPolyBallLine::BuildSpatialIndex()
+{
+  if (!this->Input)
+    {
+    vtkErrorMacro(<<"No Input specified!");
+    return 0;
+    }
+
+  if (!this->SpatialIndex)
+    {
+    this->SpatialIndex = new vtkvmtkPolyBallLineSegmentTree;
+    }
+
+  if (this->SpatialIndexBuildTime > this->GetMTime() && this->SpatialIndexBuildTime > this->Input->GetMTime() &&
+      this->SpatialIndex->MatchesSelection(this->Input,this->InputCellIds,this->InputCellId))
+    {
+    return 1;
+    }
+
+  this->SpatialIndex->Initialize();
+
+  if (this->Input->GetNumberOfPoints()==0)
+    {
+    vtkWarningMacro(<<"Empty Input specified!");
+    return 0;
+    }
+
+  vtkDataArray *polyballRadiusArray = NULL;
+  if (this->UseRadiusInformation)
+    {
+    if (!this->PolyBallRadiusArrayName)
+      {
+      vtkErrorMacro(<<"No PolyBallRadiusArrayName specified!");
+      return 0;
+      }
+
+    polyballRadiusArray = this->Input->GetPointData()->GetArray(this->PolyBallRadiusArrayName);
+
+    if (polyballRadiusArray==NULL)
+      {
+      vtkErrorMacro(<<"PolyBallRadiusArray with name specified does not exist!");
+      return 0;
+      }
+    }
+
+  if (this->Input->GetLines()==NULL)
+    {
+    vtkWarningMacro(<<"No lines in Input dataset.");
+    return 0;
+    }
+
+  this->Input->BuildCells();
+
+  std::vector<vtkIdType>& cellIds = this->SpatialIndex->CellIds;
+  vtkIdType k;
+  if (this->InputCellIds)
+    {
+    cellIds.assign(this->InputCellIds->GetPointer(0),this->InputCellIds->GetPointer(0)+this->InputCellIds->GetNumberOfIds());
+    }
+  else if (this->InputCellId != -1)
+    {
+    cellIds.push_back(this->InputCellId);
+    }
+  else
+    {
+    this->SpatialIndex->AllCells = 1;
+    cellIds.resize(this->Input->GetNumberOfCells());
+    for (k=0; k<this->Input->GetNumberOfCells(); k++)
+      {
+      cellIds[k] = k;
+      }
+    }
+
+  vtkIdType npts;
+  const vtkIdType *pts;
+  vtkvmtkPolyBallLineSegmentTree::Segment segment;
+  for (k=0; k<static_cast<vtkIdType>(cellIds.size()); k++)
+    {
+    vtkIdType cellId = cellIds[k];
+
+    if (this->Input->GetCellType(cellId)!=VTK_LINE && this->Input->GetCellType(cellId)!=VTK_POLY_LINE)
+      {
+      continue;
+      }
+
+    this->Input->GetCellPoints(cellId,npts,pts);
+
+    for (vtkIdType i=0; i<npts-1; i++)
+      {
+      this->Input->GetPoint(pts[i],segment.Point0);
+      this->Input->GetPoint(pts[i+1],segment.Point1);
+      if (this->UseRadiusInformation)
+        {
+        segment.Radius0 = polyballRadiusArray->GetComponent(pts[i],0);
+        segment.Radius1 = polyballRadiusArray->GetComponent(pts[i+1],0);
+        }
+      else
+        {
+        segment.Radius0 = 0.0;
+        segment.Radius1 = 0.0;
+        }
+      segment.Vector0[0] = segment.Point1[0] - segment.Point0[0];
+      segment.Vector0[1] = segment.Point1[1] - segment.Point0[1];
+      segment.Vector0[2] = segment.Point1[2] - segment.Point0[2];
+      segment.Vector0[3] = segment.Radius1 - segment.Radius0;
+      segment.Den = this->ComplexDot(segment.Vector0,segment.Vector0);
+
+      if (fabs(segment.Den)<VTK_VMTK_DOUBLE_TOL)
+        {
+        continue;
+        }
+
+      segment.CellId = cellId;
+      segment.SubId = i;
+      this->SpatialIndex->Segments.push_back(segment);
+      }
+    }
+
+  this->SpatialIndex->Build();
+
+  this->SpatialIndexBuildTime.Modified();
+
+  return 1;
+}
+
 double vtkvmtkPolyBallLine::EvaluateFunction(double x[3])
 {
   vtkIdType i, k;
@@ -81,6 +512,40 @@ double vtkvmtkPolyBallLine::EvaluateFunction(double x[3])
   double num, den;
   vtkDataArray *polyballRadiusArray = NULL;
 
+  if (this->UseSpatialIndex)
+    {
+    if (!this->BuildSpatialIndex())
+      {
+      return 0.0;
+      }
+
+    vtkIdType segmentId;
+    double center[4];
+    double pcoord = 0.0;
+    minPolyBallFunctionValue = this->SpatialIndex->Evaluate(x,segmentId,center,pcoord);
+
+    if (segmentId == -1)
+      {
+      this->LastPolyBallCellId = -1;
+      this->LastPolyBallCellSubId = -1;
+      this->LastPolyBallCellPCoord = 0.0;
+      this->LastPolyBallCenter[0] = this->LastPolyBallCenter[1] = this->LastPolyBallCenter[2] = 0.0;
+      this->LastPolyBallCenterRadius = 0.0;
+      return minPolyBallFunctionValue;
+      }
+
+    const vtkvmtkPolyBallLineSegmentTree::Segment& segment = this->SpatialIndex->Segments[segmentId];
+    this->LastPolyBallCellId = segment.CellId;
+    this->LastPolyBallCellSubId = segment.SubId;
+    this->LastPolyBallCellPCoord = pcoord;
+    this->LastPolyBallCenter[0] = center[0];
+    this->LastPolyBallCenter[1] = center[1];
+    this->LastPolyBallCenter[2] = center[2];
+    this->LastPolyBallCenterRadius = center[3];
+
+    return minPolyBallFunctionValue;
+    }
+
   if (!this->Input)
     {
     vtkErrorMacro(<<"No Input specified!");
@@ -238,6 +703,86 @@ double vtkvmtkPolyBallLine::EvaluateFunction(double x[3])
   return minPolyBallFunctionValue;
 }
 
+void vtkvmtkPolyBallLine::EvaluatePoints(vtkDataArray* points, vtkDataArray* values, vtkIdTypeArray* cellIds, vtkIdTypeArray* subIds, vtkDataArray* pcoords)
+{
+  if (!points || !values)
+    {
+    vtkErrorMacro(<<"No points or values array specified!");
+    return;
+    }
+
+  if (points->GetNumberOfComponents() != 3)
+    {
+    vtkErrorMacro(<<"Points array must have 3 components!");
+    return;
+    }
+
+  vtkIdType numberOfPoints = points->GetNumberOfTuples();
+  values->SetNumberOfComponents(1);
+  values->SetNumberOfTuples(numberOfPoints);
+  if (cellIds)
+    {
+    cellIds->SetNumberOfComponents(1);
+    cellIds->SetNumberOfTuples(numberOfPoints);
+    }
+  if (subIds)
+    {
+    subIds->SetNumberOfComponents(1);
+    subIds->SetNumberOfTuples(numberOfPoints);
+    }
+  if (pcoords)
+    {
+    pcoords->SetNumberOfComponents(1);
+    pcoords->SetNumberOfTuples(numberOfPoints);
+    }
+
+  if (!this->BuildSpatialIndex())
+    {
+    values->FillComponent(0,0.0);
+    if (cellIds)
+      {
+      cellIds->FillComponent(0,-1);
+      }
+    if (subIds)
+      {
+      subIds->FillComponent(0,-1);
+      }
+    if (pcoords)
+      {
+      pcoords->FillComponent(0,0.0);
+      }
+    return;
+    }
+
+  double x[3], center[4];
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    points->GetTuple(i,x);
+    vtkIdType segmentId;
+    double pcoord = 0.0;
+    values->SetTuple1(i,this->SpatialIndex->Evaluate(x,segmentId,center,pcoord));
+    vtkIdType cellId = -1;
+    vtkIdType subId = -1;
+    if (segmentId != -1)
+      {
+      cellId = this->SpatialIndex->Segments[segmentId].CellId;
+      subId = this->SpatialIndex->Segments[segmentId].SubId;
+      }
+    if (cellIds)
+      {
+      cellIds->SetValue(i,cellId);
+      }
+    if (subIds)
+      {
+      subIds->SetValue(i,subId);
+      }
+    if (pcoords)
+      {
+      pcoords->SetTuple1(i,pcoord);
+      }
+    }
+}
+
 void vtkvmtkPolyBallLine::EvaluateGradient(double x[3], double n[3])
 {
   vtkWarningMacro("Poly ball gradient computation not yet implemented!");
@@ -248,4 +793,7 @@ void vtkvmtkPolyBallLine::PrintSelf(std::ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
 
+  os << indent << "UseRadiusInformation: " << this->UseRadiusInformation << "\n";
+  os << indent << "UseSpatialIndex: " << this->UseSpatialIndex << "\n";
+
 }
@@ -49,9 +49,14 @@ Program:   VMTK
 #include "vtkImplicitFunction.h"
 #include "vtkPolyData.h"
 #include "vtkIdList.h"
+#include "vtkTimeStamp.h"
 //#include "vtkvmtkComputationalGeometryWin32Header.h"
 #include "vtkvmtkWin32Header.h"
 
+class vtkDataArray;
+class vtkIdTypeArray;
+class vtkvmtkPolyBallLineSegmentTree;
+
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyBallLine : public vtkImplicitFunction
 {
   public:
@@ -71,6 +76,22 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyBallLine : public vtkImp
   double EvaluateFunction(double x, double y, double z) override
   {return this->vtkImplicitFunction::EvaluateFunction(x, y, z); } ;
 
+  /*! Evaluate the polyball-line function at every 3-component tuple of input, storing the values in
+      output. Equivalent to EvaluatePoints(input, output, NULL, NULL, NULL). */
+  void EvaluateFunction(vtkDataArray* input, vtkDataArray* output) override
+  { this->EvaluatePoints(input, output, NULL, NULL, NULL); } ;
+
+  /*! Evaluate the polyball-line function at every 3-component tuple of points in a single call.
+      Function values are stored in values and, for each array that is not NULL, the closest cell id,
+      segment sub-id and parametric coordinate along the segment (see GetLastPolyBallCellId,
+      GetLastPolyBallCellSubId and GetLastPolyBallCellPCoord) in cellIds, subIds and pcoords; all
+      arrays are resized to the number of points. Input arrays are validated and the segments are
+      flattened once per call (or reused from a previous call if nothing changed), and the segment
+      hierarchy described in UseSpatialIndex is always used. The Last* members are not updated, so
+      once BuildSpatialIndex has succeeded, concurrent calls with distinct output arrays are safe as
+      long as the function and its Input are not modified meanwhile. */
+  void EvaluatePoints(vtkDataArray* points, vtkDataArray* values, vtkIdTypeArray* cellIds, vtkIdTypeArray* subIds, vtkDataArray* pcoords);
+
   /*! Evaluate the gradient of the polyball-line function at point x. Not implemented: calling this
       currently only emits a warning and leaves n unchanged. */
   void EvaluateGradient(double x[3], double n[3]) override;
@@ -81,6 +102,8 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyBallLine : public vtkImp
       named PolyBallRadiusArrayName when UseRadiusInformation is on. */
   vtkSetObjectMacro(Input,vtkPolyData);
   vtkGetObjectMacro(Input,vtkPolyData);
+  void SetInputData(vtkPolyData* input) { SetInput(input); }
+  vtkPolyData* GetInputData() { return GetInput(); }
   ///@}
 
   ///@{
@@ -140,6 +163,25 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyBallLine : public vtkImp
   vtkBooleanMacro(UseRadiusInformation,int);
   ///@}
 
+  ///@{
+  /*! Toggle use of a cached bounding volume hierarchy over the centerline segments. When on,
+      EvaluateFunction only visits the segments whose bounding box, inflated by their largest radius,
+      can still improve on the current minimum, and performs no memory allocation per call. The
+      hierarchy is built on first evaluation and rebuilt only when Input, the cell selection
+      (InputCellIds/InputCellId), PolyBallRadiusArrayName or UseRadiusInformation change; Input
+      points or radii edited in place must be followed by a call to Input->Modified(). Results are
+      identical to the exhaustive search. Default: off. */
+  vtkSetMacro(UseSpatialIndex,int);
+  vtkGetMacro(UseSpatialIndex,int);
+  vtkBooleanMacro(UseSpatialIndex,int);
+  ///@}
+
+  /*! Build the segment hierarchy used when UseSpatialIndex is on, unless it is already up to date.
+      EvaluateFunction calls this automatically; calling it explicitly moves the construction cost
+      out of the first evaluation. Returns 1 on success, 0 if Input or the radius array are
+      missing. */
+  int BuildSpatialIndex();
+
   /*! Dot product in Minkowski (3+1)-D space: the sum of the products of the first three (spatial)
       components minus the product of the fourth (radius) components, i.e.
       x[0]*y[0] + x[1]*y[1] + x[2]*y[2] - x[3]*y[3]. Used internally to project the query point onto
@@ -164,6 +206,10 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyBallLine : public vtkImp
 
   int UseRadiusInformation;
 
+  int UseSpatialIndex;
+  vtkvmtkPolyBallLineSegmentTree* SpatialIndex;
+  vtkTimeStamp SpatialIndexBuildTime;
+
   private:
   vtkvmtkPolyBallLine(const vtkvmtkPolyBallLine&);  // Not implemented.
   void operator=(const vtkvmtkPolyBallLine&);  // Not implemented.
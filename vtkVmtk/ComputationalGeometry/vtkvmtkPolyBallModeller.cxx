@@ -24,6 +24,7 @@ Version:   $Revision: 1.4 $
 #include "vtkvmtkPolyBallLine.h"
 #include "vtkPolyData.h"
 #include "vtkDoubleArray.h"
+#include "vtkIdTypeArray.h"
 #include "vtkImageData.h"
 #include "vtkMath.h"
 #include "vtkvmtkConstants.h"
@@ -33,7 +34,238 @@ Version:   $Revision: 1.4 $
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkPointData.h"
 #include "vtkVersion.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocalObject.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Voxel coordinates along each axis of the output image, indexed relative to its extent, and the
+// conversion from a coordinate range to the (clamped) range of voxel indices it covers.
+class vtkvmtkPolyBallModellerGrid
+{
+public:
+  int Extent[6];
+  int Dimensions[3];
+  double Origin[3];
+  double Spacing[3];
+  std::vector<double> Coordinates[3];
+
+  void Initialize(vtkImageData* image)
+    {
+    image->GetExtent(this->Extent);
+    image->GetDimensions(this->Dimensions);
+    image->GetOrigin(this->Origin);
+    image->GetSpacing(this->Spacing);
+    for (int d=0; d<3; d++)
+      {
+      this->Coordinates[d].resize(this->Dimensions[d]);
+      for (int i=0; i<this->Dimensions[d]; i++)
+        {
+        this->Coordinates[d][i] = this->Origin[d] + (this->Extent[2*d] + i) * this->Spacing[d];
+        }
+      }
+    }
+
+  // Returns 0 if [x0,x1] misses the image along axis d.
+  int ComputeIndexRange(int d, double x0, double x1, int range[2]) const
+    {
+    double lower = std::floor((x0 - this->Origin[d]) / this->Spacing[d]);
+    double upper = std::floor((x1 - this->Origin[d]) / this->Spacing[d]);
+    if (upper < this->Extent[2*d] || lower > this->Extent[2*d+1])
+      {
+      return 0;
+      }
+    range[0] = lower < this->Extent[2*d] ? 0 : static_cast<int>(lower) - this->Extent[2*d];
+    range[1] = upper > this->Extent[2*d+1] ? this->Dimensions[d] - 1 : static_cast<int>(upper) - this->Extent[2*d];
+    return 1;
+    }
+};
+
+// Rasterizes the union of balls one z slab at a time. Every slab owns its voxels, so the minimum over
+// overlapping balls is taken in place without synchronization.
+class vtkvmtkPolyBallModellerBallsFunctor
+{
+public:
+  const vtkvmtkPolyBallModellerGrid* Grid;
+  // ball centers and radii, and the voxel index ranges covered by their inflated boxes
+  const std::vector<double>* Balls;
+  const std::vector<int>* BallRanges;
+  double* FunctionValues;
+
+  void operator()(vtkIdType kBegin, vtkIdType kEnd)
+    {
+    const vtkvmtkPolyBallModellerGrid& grid = *this->Grid;
+    const std::vector<double>& balls = *this->Balls;
+    const std::vector<int>& ballRanges = *this->BallRanges;
+    const double* xs = &grid.Coordinates[0][0];
+    const double* ys = &grid.Coordinates[1][0];
+    const double* zs = &grid.Coordinates[2][0];
+    vtkIdType rowSize = grid.Dimensions[0];
+    vtkIdType sliceSize = rowSize * grid.Dimensions[1];
+
+    double* slab = this->FunctionValues + kBegin * sliceSize;
+    std::fill(slab,slab+(kEnd-kBegin)*sliceSize,VTK_VMTK_LARGE_DOUBLE);
+
+    vtkIdType numberOfBalls = static_cast<vtkIdType>(balls.size() / 4);
+    for (vtkIdType n=0; n<numberOfBalls; n++)
+      {
+      const int* range = &ballRanges[6*n];
+      int k0 = range[4] > kBegin ? range[4] : static_cast<int>(kBegin);
+      int k1 = range[5] < kEnd-1 ? range[5] : static_cast<int>(kEnd-1);
+      if (k0 > k1)
+        {
+        continue;
+        }
+      const double* p = &balls[4*n];
+      double r2 = p[3] * p[3];
+      for (int k=k0; k<=k1; k++)
+        {
+        double dz2 = (zs[k] - p[2]) * (zs[k] - p[2]);
+        for (int j=range[2]; j<=range[3]; j++)
+          {
+          double dy2 = (ys[j] - p[1]) * (ys[j] - p[1]);
+          double* row = this->FunctionValues + k * sliceSize + j * rowSize;
+          for (int i=range[0]; i<=range[1]; i++)
+            {
+            double sphereFunctionValue = ((xs[i] - p[0]) * (xs[i] - p[0]) + dy2 + dz2) - r2;
+            if (sphereFunctionValue < row[i])
+              {
+              row[i] = sphereFunctionValue;
+              }
+            }
+          }
+        }
+      }
+    }
+};
+
+// Evaluates the polyball line one z slice at a time through the batch interface, restricted to the
+// voxels within the inflated segment boxes when a narrow band is requested. The polyball line must
+// be built before the functor runs, so that concurrent evaluations only read it.
+class vtkvmtkPolyBallModellerPolyBallLineFunctor
+{
+public:
+  const vtkvmtkPolyBallModellerGrid* Grid;
+  vtkvmtkPolyBallLine* PolyBallLine;
+  // voxel index ranges of the inflated segment boxes, NULL to evaluate every voxel
+  const std::vector<int>* BandRanges;
+  double* FunctionValues;
+
+  vtkSMPThreadLocalObject<vtkDoubleArray> Points;
+  vtkSMPThreadLocalObject<vtkDoubleArray> Values;
+  vtkSMPThreadLocalObject<vtkIdTypeArray> VoxelIds;
+
+  void Initialize()
+    {
+    this->Points.Local()->SetNumberOfComponents(3);
+    }
+
+  void operator()(vtkIdType kBegin, vtkIdType kEnd)
+    {
+    const vtkvmtkPolyBallModellerGrid& grid = *this->Grid;
+    vtkDoubleArray* points = this->Points.Local();
+    vtkDoubleArray* values = this->Values.Local();
+    vtkIdTypeArray* voxelIds = this->VoxelIds.Local();
+    vtkIdType rowSize = grid.Dimensions[0];
+    vtkIdType sliceSize = rowSize * grid.Dimensions[1];
+    const double* xs = &grid.Coordinates[0][0];
+    const double* ys = &grid.Coordinates[1][0];
+
+    for (vtkIdType k=kBegin; k<kEnd; k++)
+      {
+      double z = grid.Coordinates[2][k];
+      double* slice = this->FunctionValues + k * sliceSize;
+      double point[3];
+      point[2] = z;
+      vtkIdType i, j, n;
+
+      if (!this->BandRanges)
+        {
+        points->SetNumberOfTuples(sliceSize);
+        double* pointer = points->GetPointer(0);
+        for (j=0; j<grid.Dimensions[1]; j++)
+          {
+          for (i=0; i<rowSize; i++)
+            {
+            *pointer++ = xs[i];
+            *pointer++ = ys[j];
+            *pointer++ = z;
+            }
+          }
+        this->PolyBallLine->EvaluatePoints(points,values,NULL,NULL,NULL);
+        std::copy(values->GetPointer(0),values->GetPointer(0)+sliceSize,slice);
+        continue;
+        }
+
+      // mark the voxels of the slice covered by at least one inflated segment box with 0.0,
+      // evaluate those and leave the others at the large value
+      std::fill(slice,slice+sliceSize,VTK_VMTK_LARGE_DOUBLE);
+      const std::vector<int>& bandRanges = *this->BandRanges;
+      vtkIdType numberOfBoxes = static_cast<vtkIdType>(bandRanges.size() / 6);
+      for (n=0; n<numberOfBoxes; n++)
+        {
+        const int* range = &bandRanges[6*n];
+        if (k < range[4] || k > range[5])
+          {
+          continue;
+          }
+        for (j=range[2]; j<=range[3]; j++)
+          {
+          std::fill(slice+j*rowSize+range[0],slice+j*rowSize+range[1]+1,0.0);
+          }
+        }
+
+      voxelIds->SetNumberOfTuples(0);
+      points->SetNumberOfTuples(0);
+      for (j=0; j<grid.Dimensions[1]; j++)
+        {
+        point[1] = ys[j];
+        for (i=0; i<rowSize; i++)
+          {
+          if (slice[j*rowSize+i] == 0.0)
+            {
+            point[0] = xs[i];
+            points->InsertNextTuple(point);
+            voxelIds->InsertNextValue(j*rowSize+i);
+            }
+          }
+        }
+
+      vtkIdType numberOfBandPoints = voxelIds->GetNumberOfTuples();
+      if (numberOfBandPoints == 0)
+        {
+        continue;
+        }
+      this->PolyBallLine->EvaluatePoints(points,values,NULL,NULL,NULL);
+      const double* valuePointer = values->GetPointer(0);
+      const vtkIdType* voxelIdPointer = voxelIds->GetPointer(0);
+      for (n=0; n<numberOfBandPoints; n++)
+        {
+        slice[voxelIdPointer[n]] = valuePointer[n];
+        }
+      }
+    }
+
+  void Reduce()
+    {
+    }
+};
+
+class vtkvmtkPolyBallModellerNegateFunctor
+{
+public:
+  double* FunctionValues;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      this->FunctionValues[i] *= -1.0;
+      }
+    }
+};
 
 vtkStandardNewMacro(vtkvmtkPolyBallModeller);
 
@@ -55,6 +287,8 @@ vtkvmtkPolyBallModeller::vtkvmtkPolyBallModeller()
 
   this->UsePolyBallLine = 0;
   this->NegateFunction = 0;
+  this->UseNarrowBand = 0;
+  this->NarrowBandRadiusFactor = 2.0;
 }
 
 vtkvmtkPolyBallModeller::~vtkvmtkPolyBallModeller()
@@ -193,121 +427,112 @@ int vtkvmtkPolyBallModeller::RequestData(
 
   int numberOfOutputPoints = output->GetNumberOfPoints();
 
-#if 0
-  vtkImplicitFunction* function;
-  if (!this->UsePolyBallLine)
-    {
-    vtkvmtkPolyBall* polyBall = vtkvmtkPolyBall::New();
-    polyBall->SetInput(input);
-    polyBall->SetPolyBallRadiusArrayName(this->RadiusArrayName);
-    function = polyBall;
-    }
-  else
+  if (numberOfOutputPoints == 0)
     {
-    vtkvmtkPolyBallLine* polyBall = vtkvmtkPolyBallLine::New();
-    polyBall->SetInput(input);
-    polyBall->SetPolyBallRadiusArrayName(this->RadiusArrayName);
-    function = polyBall;
+    return 1;
     }
 
-  double point[3];
-  int i;
-  for (i=0; i<numberOfOutputPoints; i++)
-    {
-    output->GetPoint(i,point);
-    double polyBallFunction = function->EvaluateFunction(point);
-    functionArray->SetComponent(i,0,polyBallFunction);
-    }
+  vtkDataArray* radiusArray = input->GetPointData()->GetArray(this->RadiusArrayName);
+  double* functionValues = functionArray->GetPointer(0);
 
-  function->Delete();
-#endif
+  vtkvmtkPolyBallModellerGrid grid;
+  grid.Initialize(output);
 
   if (!this->UsePolyBallLine)
     {
-    functionArray->FillComponent(0,VTK_VMTK_LARGE_DOUBLE);
-    vtkDoubleArray* radiusArray = vtkDoubleArray::SafeDownCast(input->GetPointData()->GetArray(this->RadiusArrayName));
     int numberOfInputPoints = input->GetNumberOfPoints();
-    int extent[6];
-    double x[3], p[3], r;
-    double boundingBox0[3], boundingBox1[3];
-    int ijk0[3], ijk1[3], ijk[3];
-    int ijkExtent[6];
-    double pcoords[3];
-    int inBounds0, inBounds1;
-    double radiusFactor = 2.0;
-    output->GetExtent(extent);
-    double sphereFunctionValue, currentSphereFunctionValue;
+    std::vector<double> balls;
+    std::vector<int> ballRanges;
+    balls.reserve(4*numberOfInputPoints);
+    ballRanges.reserve(6*numberOfInputPoints);
+    double p[3], r;
+    int range[6];
     int n;
-    int i, j, k;
-    vtkIdType outputId;
     for (n=0; n<numberOfInputPoints; n++)
       {
       input->GetPoint(n,p);
-      r = radiusArray->GetValue(n);
-      boundingBox0[0] = p[0] - radiusFactor * r;
-      boundingBox0[1] = p[1] - radiusFactor * r;
-      boundingBox0[2] = p[2] - radiusFactor * r;
-      boundingBox1[0] = p[0] + radiusFactor * r;
-      boundingBox1[1] = p[1] + radiusFactor * r;
-      boundingBox1[2] = p[2] + radiusFactor * r;
-      inBounds0 = output->ComputeStructuredCoordinates(boundingBox0,ijk0,pcoords);
-      inBounds1 = output->ComputeStructuredCoordinates(boundingBox1,ijk1,pcoords);
-      if (!inBounds0 && !inBounds1)
+      r = radiusArray->GetComponent(n,0);
+      double halfWidth = this->NarrowBandRadiusFactor * r;
+      if (!grid.ComputeIndexRange(0,p[0]-halfWidth,p[0]+halfWidth,range) ||
+          !grid.ComputeIndexRange(1,p[1]-halfWidth,p[1]+halfWidth,range+2) ||
+          !grid.ComputeIndexRange(2,p[2]-halfWidth,p[2]+halfWidth,range+4))
         {
         continue;
         }
-      ijkExtent[0] = ijk0[0] < extent[0] ? extent[0] : ijk0[0];
-      ijkExtent[1] = ijk1[0] > extent[1] ? extent[1] : ijk1[0];
-      ijkExtent[2] = ijk0[1] < extent[2] ? extent[2] : ijk0[1];
-      ijkExtent[3] = ijk1[1] > extent[3] ? extent[3] : ijk1[1];
-      ijkExtent[4] = ijk0[2] < extent[4] ? extent[4] : ijk0[2];
-      ijkExtent[5] = ijk1[2] > extent[5] ? extent[5] : ijk1[2];
-      for (k=ijkExtent[4]; k<=ijkExtent[5]; k++)
-        {
-        for (j=ijkExtent[2]; j<=ijkExtent[3]; j++)
-          {
-          for (i=ijkExtent[0]; i<=ijkExtent[1]; i++)
-            {
-            ijk[0] = i;
-            ijk[1] = j;
-            ijk[2] = k;
-            outputId = output->ComputePointId(ijk);
-            output->GetPoint(outputId,x);
-            sphereFunctionValue = ((x[0] - p[0]) * (x[0] - p[0]) + (x[1] - p[1]) * (x[1] - p[1]) + (x[2] - p[2]) * (x[2] - p[2])) - r * r; 
-            currentSphereFunctionValue = functionArray->GetComponent(outputId,0);
-            if (sphereFunctionValue < currentSphereFunctionValue)
-              {
-              functionArray->SetComponent(outputId,0,sphereFunctionValue);
-              }
-            }
-          }
-        }
+      balls.push_back(p[0]);
+      balls.push_back(p[1]);
+      balls.push_back(p[2]);
+      balls.push_back(r);
+      ballRanges.insert(ballRanges.end(),range,range+6);
       }
+
+    vtkvmtkPolyBallModellerBallsFunctor ballsFunctor;
+    ballsFunctor.Grid = &grid;
+    ballsFunctor.Balls = &balls;
+    ballsFunctor.BallRanges = &ballRanges;
+    ballsFunctor.FunctionValues = functionValues;
+    vtkSMPTools::For(0,grid.Dimensions[2],ballsFunctor);
     }
   else
     {
     vtkvmtkPolyBallLine* polyBallLine = vtkvmtkPolyBallLine::New();
     polyBallLine->SetInput(input);
     polyBallLine->SetPolyBallRadiusArrayName(this->RadiusArrayName);
-    double point[3];
-    int i;
-    for (i=0; i<numberOfOutputPoints; i++)
+    if (!polyBallLine->BuildSpatialIndex())
       {
-      output->GetPoint(i,point);
-      double polyBallLineValue = polyBallLine->EvaluateFunction(point);
-      functionArray->SetComponent(i,0,polyBallLineValue);
+      functionArray->FillComponent(0,0.0);
+      polyBallLine->Delete();
+      return 1;
+      }
+
+    std::vector<int> bandRanges;
+    if (this->UseNarrowBand)
+      {
+      input->BuildCells();
+      vtkIdType npts;
+      const vtkIdType *pts;
+      double point0[3], point1[3];
+      int range[6];
+      for (vtkIdType cellId=0; cellId<input->GetNumberOfCells(); cellId++)
+        {
+        if (input->GetCellType(cellId)!=VTK_LINE && input->GetCellType(cellId)!=VTK_POLY_LINE)
+          {
+          continue;
+          }
+        input->GetCellPoints(cellId,npts,pts);
+        for (vtkIdType i=0; i<npts-1; i++)
+          {
+          input->GetPoint(pts[i],point0);
+          input->GetPoint(pts[i+1],point1);
+          double halfWidth = this->NarrowBandRadiusFactor * std::max(radiusArray->GetComponent(pts[i],0),radiusArray->GetComponent(pts[i+1],0));
+          int inBounds = 1;
+          for (int d=0; d<3 && inBounds; d++)
+            {
+            inBounds = grid.ComputeIndexRange(d,std::min(point0[d],point1[d])-halfWidth,std::max(point0[d],point1[d])+halfWidth,range+2*d);
+            }
+          if (inBounds)
+            {
+            bandRanges.insert(bandRanges.end(),range,range+6);
+            }
+          }
+        }
       }
+
+    vtkvmtkPolyBallModellerPolyBallLineFunctor polyBallLineFunctor;
+    polyBallLineFunctor.Grid = &grid;
+    polyBallLineFunctor.PolyBallLine = polyBallLine;
+    polyBallLineFunctor.BandRanges = this->UseNarrowBand ? &bandRanges : NULL;
+    polyBallLineFunctor.FunctionValues = functionValues;
+    vtkSMPTools::For(0,grid.Dimensions[2],polyBallLineFunctor);
+
+    polyBallLine->Delete();
     }
 
   if (this->NegateFunction)
     {
-    int i;
-    for (i=0; i<numberOfOutputPoints; i++)
-      {
-      double functionValue = functionArray->GetComponent(i,0);
-      functionValue *= -1.0;
-      functionArray->SetComponent(i,0,functionValue);
-      }
+    vtkvmtkPolyBallModellerNegateFunctor negateFunctor;
+    negateFunctor.FunctionValues = functionValues;
+    vtkSMPTools::For(0,numberOfOutputPoints,negateFunctor);
     }
 
   return 1;
@@ -321,6 +546,11 @@ void vtkvmtkPolyBallModeller::PrintSelf(std::ostream& os, vtkIndent indent)
      << this->SampleDimensions[1] << ", "
      << this->SampleDimensions[2] << ")\n";
 
+  os << indent << "UsePolyBallLine: " << this->UsePolyBallLine << "\n";
+  os << indent << "NegateFunction: " << this->NegateFunction << "\n";
+  os << indent << "UseNarrowBand: " << this->UseNarrowBand << "\n";
+  os << indent << "NarrowBandRadiusFactor: " << this->NarrowBandRadiusFactor << "\n";
+
   os << indent << "ModelBounds: \n";
   os << indent << "  Xmin,Xmax: (" << this->ModelBounds[0] << ", " << this->ModelBounds[1] << ")\n";
   os << indent << "  Ymin,Ymax: (" << this->ModelBounds[2] << ", " << this->ModelBounds[3] << ")\n";
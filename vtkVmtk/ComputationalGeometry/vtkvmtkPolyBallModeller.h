@@ -103,6 +103,27 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyBallModeller : public vt
   vtkBooleanMacro(NegateFunction,int);
   ///@}
 
+  ///@{
+  /**
+   * Toggle narrow band evaluation of the polyball line: when on, only voxels lying within the box
+   * around a centerline segment inflated by NarrowBandRadiusFactor times its largest radius are
+   * evaluated, the others are set to a large positive value. Ignored when UsePolyBallLine is off,
+   * as balls are always rasterized over their own inflated box. Default: off.
+   */
+  vtkSetMacro(UseNarrowBand,int);
+  vtkGetMacro(UseNarrowBand,int);
+  vtkBooleanMacro(UseNarrowBand,int);
+  ///@}
+
+  ///@{
+  /**
+   * Set/Get the multiple of the ball (or segment) radius defining the box around each ball (or
+   * segment) over which the function is evaluated. Default: 2.0.
+   */
+  vtkSetMacro(NarrowBandRadiusFactor,double);
+  vtkGetMacro(NarrowBandRadiusFactor,double);
+  ///@}
+
 
   protected:
   vtkvmtkPolyBallModeller();
@@ -121,6 +142,9 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyBallModeller : public vt
 
   int NegateFunction;
 
+  int UseNarrowBand;
+  double NarrowBandRadiusFactor;
+
   vtkImageData* ReferenceImage;
 
   private:
@@ -0,0 +1,287 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkPolyDataAdjacency.cxx,v $
+Language:  C++
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENSE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "vtkvmtkPolyDataAdjacency.h"
+#include "vtkCellArray.h"
+#include "vtkIdList.h"
+#include "vtkPolyData.h"
+#include "vtkObjectFactory.h"
+
+#include <vector>
+
+
+vtkStandardNewMacro(vtkvmtkPolyDataAdjacency);
+
+vtkvmtkPolyDataAdjacency::vtkvmtkPolyDataAdjacency()
+{
+  this->PointNeighborOffsets = vtkIdTypeArray::New();
+  this->PointNeighborIds = vtkIdTypeArray::New();
+  this->PointCellOffsets = vtkIdTypeArray::New();
+  this->PointCellIds = vtkIdTypeArray::New();
+  this->CellOffsets = vtkIdTypeArray::New();
+  this->CellPointIds = vtkIdTypeArray::New();
+
+  this->NumberOfPoints = 0;
+  this->NumberOfCells = 0;
+  this->BuiltInput = NULL;
+  for (int i=0; i<4; i++)
+    {
+    this->BuiltCells[i] = NULL;
+    }
+  this->Built = 0;
+}
+
+vtkvmtkPolyDataAdjacency::~vtkvmtkPolyDataAdjacency()
+{
+  this->PointNeighborOffsets->Delete();
+  this->PointNeighborIds->Delete();
+  this->PointCellOffsets->Delete();
+  this->PointCellIds->Delete();
+  this->CellOffsets->Delete();
+  this->CellPointIds->Delete();
+}
+
+void vtkvmtkPolyDataAdjacency::Initialize()
+{
+  this->PointNeighborOffsets->Initialize();
+  this->PointNeighborIds->Initialize();
+  this->PointCellOffsets->Initialize();
+  this->PointCellIds->Initialize();
+  this->CellOffsets->Initialize();
+  this->CellPointIds->Initialize();
+
+  this->NumberOfPoints = 0;
+  this->NumberOfCells = 0;
+  this->BuiltInput = NULL;
+  for (int i=0; i<4; i++)
+    {
+    this->BuiltCells[i] = NULL;
+    }
+  this->Built = 0;
+
+  this->Modified();
+}
+
+void vtkvmtkPolyDataAdjacency::Build(vtkPolyData* input)
+{
+  vtkIdType i, j, k, l;
+  vtkIdType npts, cellId;
+  const vtkIdType *pts;
+
+  this->Initialize();
+
+  if (!input)
+    {
+    vtkErrorMacro(<<"No input poly data.");
+    return;
+    }
+
+  vtkIdType numberOfPoints = input->GetNumberOfPoints();
+  vtkIdType numberOfCells = input->GetNumberOfCells();
+
+  input->BuildCells();
+
+  // cell-to-point
+  this->CellOffsets->SetNumberOfValues(numberOfCells+1);
+  vtkIdType* cellOffsets = this->CellOffsets->GetPointer(0);
+  cellOffsets[0] = 0;
+  for (i=0; i<numberOfCells; i++)
+    {
+    input->GetCellPoints(i,npts,pts);
+    cellOffsets[i+1] = cellOffsets[i] + npts;
+    }
+
+  this->CellPointIds->SetNumberOfValues(cellOffsets[numberOfCells]);
+  vtkIdType* cellPointIds = this->CellPointIds->GetPointer(0);
+  for (i=0; i<numberOfCells; i++)
+    {
+    input->GetCellPoints(i,npts,pts);
+    for (j=0; j<npts; j++)
+      {
+      cellPointIds[cellOffsets[i]+j] = pts[j];
+      }
+    }
+
+  // point-to-cell, cells in increasing id order as in vtkCellLinks
+  this->PointCellOffsets->SetNumberOfValues(numberOfPoints+1);
+  vtkIdType* pointCellOffsets = this->PointCellOffsets->GetPointer(0);
+  for (i=0; i<=numberOfPoints; i++)
+    {
+    pointCellOffsets[i] = 0;
+    }
+  for (i=0; i<cellOffsets[numberOfCells]; i++)
+    {
+    pointCellOffsets[cellPointIds[i]+1]++;
+    }
+  for (i=0; i<numberOfPoints; i++)
+    {
+    pointCellOffsets[i+1] += pointCellOffsets[i];
+    }
+
+  this->PointCellIds->SetNumberOfValues(pointCellOffsets[numberOfPoints]);
+  vtkIdType* pointCellIds = this->PointCellIds->GetPointer(0);
+  std::vector<vtkIdType> insertPositions(pointCellOffsets,pointCellOffsets+numberOfPoints);
+  for (i=0; i<numberOfCells; i++)
+    {
+    for (j=cellOffsets[i]; j<cellOffsets[i+1]; j++)
+      {
+      pointCellIds[insertPositions[cellPointIds[j]]++] = i;
+      }
+    }
+
+  // point-to-point, neighbors in order of first appearance in the point cells
+  std::vector<vtkIdType> neighborIds;
+  neighborIds.reserve(cellOffsets[numberOfCells]);
+  this->PointNeighborOffsets->SetNumberOfValues(numberOfPoints+1);
+  vtkIdType* pointNeighborOffsets = this->PointNeighborOffsets->GetPointer(0);
+  for (i=0; i<numberOfPoints; i++)
+    {
+    vtkIdType firstNeighbor = static_cast<vtkIdType>(neighborIds.size());
+    pointNeighborOffsets[i] = firstNeighbor;
+    for (j=pointCellOffsets[i]; j<pointCellOffsets[i+1]; j++)
+      {
+      cellId = pointCellIds[j];
+      for (k=cellOffsets[cellId]; k<cellOffsets[cellId+1]; k++)
+        {
+        vtkIdType neighborId = cellPointIds[k];
+        if (neighborId == i)
+          {
+          continue;
+          }
+        vtkIdType numberOfNeighbors = static_cast<vtkIdType>(neighborIds.size());
+        for (l=firstNeighbor; l<numberOfNeighbors; l++)
+          {
+          if (neighborIds[l] == neighborId)
+            {
+            break;
+            }
+          }
+        if (l == numberOfNeighbors)
+          {
+          neighborIds.push_back(neighborId);
+          }
+        }
+      }
+    }
+  pointNeighborOffsets[numberOfPoints] = static_cast<vtkIdType>(neighborIds.size());
+
+  this->PointNeighborIds->SetNumberOfValues(static_cast<vtkIdType>(neighborIds.size()));
+  vtkIdType* pointNeighborIds = this->PointNeighborIds->GetPointer(0);
+  for (i=0; i<static_cast<vtkIdType>(neighborIds.size()); i++)
+    {
+    pointNeighborIds[i] = neighborIds[i];
+    }
+
+  this->NumberOfPoints = numberOfPoints;
+  this->NumberOfCells = numberOfCells;
+  this->BuiltInput = input;
+  vtkCellArray* cells[4] = {input->GetVerts(), input->GetLines(), input->GetPolys(), input->GetStrips()};
+  for (i=0; i<4; i++)
+    {
+    // empty cell arrays may be placeholders owned by each poly data, they are not compared
+    this->BuiltCells[i] = cells[i]->GetNumberOfCells() > 0 ? cells[i] : NULL;
+    }
+  this->Built = 1;
+  this->BuildTime.Modified();
+
+  this->Modified();
+}
+
+int vtkvmtkPolyDataAdjacency::IsBuiltFor(vtkPolyData* input)
+{
+  if (!this->Built || !input)
+    {
+    return 0;
+    }
+
+  if (input->GetNumberOfPoints() != this->NumberOfPoints || input->GetNumberOfCells() != this->NumberOfCells)
+    {
+    return 0;
+    }
+
+  // neither the input nor its cell arrays are referenced, a different object allocated at the
+  // same address is caught by its modification time, later than the build time
+  if (input == this->BuiltInput && input->GetMTime() <= this->BuildTime.GetMTime())
+    {
+    return 1;
+    }
+
+  vtkCellArray* cells[4] = {input->GetVerts(), input->GetLines(), input->GetPolys(), input->GetStrips()};
+  for (int i=0; i<4; i++)
+    {
+    if (cells[i]->GetNumberOfCells() == 0 && !this->BuiltCells[i])
+      {
+      continue;
+      }
+    if (cells[i] != this->BuiltCells[i] || cells[i]->GetMTime() > this->BuildTime.GetMTime())
+      {
+      return 0;
+      }
+    }
+
+  return 1;
+}
+
+void vtkvmtkPolyDataAdjacency::GetPointNeighbors(vtkIdType pointId, vtkIdList* neighborIds)
+{
+  vtkIdType i, numberOfNeighbors;
+  const vtkIdType* ids;
+
+  neighborIds->Initialize();
+  if (!this->Built || pointId < 0 || pointId >= this->NumberOfPoints)
+    {
+    return;
+    }
+
+  this->GetPointNeighbors(pointId,numberOfNeighbors,ids);
+  neighborIds->SetNumberOfIds(numberOfNeighbors);
+  for (i=0; i<numberOfNeighbors; i++)
+    {
+    neighborIds->SetId(i,ids[i]);
+    }
+}
+
+void vtkvmtkPolyDataAdjacency::GetPointCells(vtkIdType pointId, vtkIdList* cellIds)
+{
+  vtkIdType i, numberOfCells;
+  const vtkIdType* ids;
+
+  cellIds->Initialize();
+  if (!this->Built || pointId < 0 || pointId >= this->NumberOfPoints)
+    {
+    return;
+    }
+
+  this->GetPointCells(pointId,numberOfCells,ids);
+  cellIds->SetNumberOfIds(numberOfCells);
+  for (i=0; i<numberOfCells; i++)
+    {
+    cellIds->SetId(i,ids[i]);
+    }
+}
+
+void vtkvmtkPolyDataAdjacency::PrintSelf(std::ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "NumberOfPoints: " << this->NumberOfPoints << "\n";
+  os << indent << "NumberOfCells: " << this->NumberOfCells << "\n";
+  os << indent << "NumberOfPointNeighborIds: " << this->PointNeighborIds->GetNumberOfValues() << "\n";
+  os << indent << "NumberOfPointCellIds: " << this->PointCellIds->GetNumberOfValues() << "\n";
+}
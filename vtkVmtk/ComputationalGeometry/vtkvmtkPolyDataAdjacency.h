@@ -0,0 +1,140 @@
+/*=========================================================================
+
+Program:   VMTK
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENSE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/**
+ * @class   vtkvmtkPolyDataAdjacency
+ * @brief   Compressed point-to-point, point-to-cell and cell-to-point adjacency of a poly data.
+ * @ingroup ComputationalGeometry
+ *
+ * Stores the topology of a vtkPolyData in compressed sparse row (CSR) form: for every point, the ids of the cells using it and the ids of the points sharing a cell with it; for every cell, its point ids. Each relation is kept as an offset array of size N+1 and a flat id array, so that the entries of item i are ids[offsets[i]] to ids[offsets[i+1]-1]. Point cells are listed in increasing cell id order, and point neighbors in the order they are first met visiting the point cells, as vtkPolyData::GetPointCells followed by vtkIdList::InsertUniqueId would give.
+ *
+ * Once built, the adjacency can be queried without allocation and without going through the cell links of the poly data, and it can be shared among filters working on the same poly data (e.g. several vtkvmtkNonManifoldFastMarching runs on one Voronoi diagram). Only the topology is stored: point coordinates and point data may change between uses, but the adjacency is rebuilt when the cells of the poly data are modified (see IsBuiltFor).
+ *
+ * @sa
+ * vtkvmtkNonManifoldFastMarching
+ */
+
+#ifndef __vtkvmtkPolyDataAdjacency_h
+#define __vtkvmtkPolyDataAdjacency_h
+
+#include "vtkObject.h"
+#include "vtkIdTypeArray.h"
+#include "vtkTimeStamp.h"
+//#include "vtkvmtkComputationalGeometryWin32Header.h"
+#include "vtkvmtkWin32Header.h"
+
+class vtkCellArray;
+class vtkIdList;
+class vtkPolyData;
+
+class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataAdjacency : public vtkObject
+{
+  public:
+  vtkTypeMacro(vtkvmtkPolyDataAdjacency,vtkObject);
+  void PrintSelf(std::ostream& os, vtkIndent indent) override;
+
+  static vtkvmtkPolyDataAdjacency *New();
+
+  /**
+   * Builds the adjacency of input. All cells of input (vertices, lines, polygons and strips) are considered.
+   */
+  void Build(vtkPolyData* input);
+
+  /**
+   * Releases the adjacency.
+   */
+  void Initialize();
+
+  /**
+   * Returns 1 if the adjacency has been built for input and input has not been modified since, 0 otherwise. A poly data sharing the cell arrays of the built one (e.g. a shallow copy, or the output of a filter only adding point data) is also accepted, as long as the cell arrays have not been modified since the build and the number of points is the same.
+   */
+  int IsBuiltFor(vtkPolyData* input);
+
+  vtkGetMacro(NumberOfPoints,vtkIdType);
+  vtkGetMacro(NumberOfCells,vtkIdType);
+
+  ///@{
+  /**
+   * Get the CSR arrays. Offset arrays have one more entry than the number of points (cells).
+   */
+  vtkGetObjectMacro(PointNeighborOffsets,vtkIdTypeArray);
+  vtkGetObjectMacro(PointNeighborIds,vtkIdTypeArray);
+  vtkGetObjectMacro(PointCellOffsets,vtkIdTypeArray);
+  vtkGetObjectMacro(PointCellIds,vtkIdTypeArray);
+  vtkGetObjectMacro(CellOffsets,vtkIdTypeArray);
+  vtkGetObjectMacro(CellPointIds,vtkIdTypeArray);
+  ///@}
+
+  /**
+   * Fills neighborIds with the ids of the points sharing a cell with pointId.
+   */
+  void GetPointNeighbors(vtkIdType pointId, vtkIdList* neighborIds);
+
+  /**
+   * Fills cellIds with the ids of the cells using pointId.
+   */
+  void GetPointCells(vtkIdType pointId, vtkIdList* cellIds);
+
+  ///@{
+  /**
+   * Direct access to the adjacency lists, without copy. The returned pointers are valid until the next Build or Initialize.
+   */
+  void GetPointNeighbors(vtkIdType pointId, vtkIdType& numberOfNeighbors, const vtkIdType*& neighborIds)
+    {
+    const vtkIdType* offsets = this->PointNeighborOffsets->GetPointer(0);
+    numberOfNeighbors = offsets[pointId+1] - offsets[pointId];
+    neighborIds = this->PointNeighborIds->GetPointer(0) + offsets[pointId];
+    }
+
+  void GetPointCells(vtkIdType pointId, vtkIdType& numberOfCells, const vtkIdType*& cellIds)
+    {
+    const vtkIdType* offsets = this->PointCellOffsets->GetPointer(0);
+    numberOfCells = offsets[pointId+1] - offsets[pointId];
+    cellIds = this->PointCellIds->GetPointer(0) + offsets[pointId];
+    }
+
+  void GetCellPoints(vtkIdType cellId, vtkIdType& numberOfPoints, const vtkIdType*& pointIds)
+    {
+    const vtkIdType* offsets = this->CellOffsets->GetPointer(0);
+    numberOfPoints = offsets[cellId+1] - offsets[cellId];
+    pointIds = this->CellPointIds->GetPointer(0) + offsets[cellId];
+    }
+  ///@}
+
+  protected:
+  vtkvmtkPolyDataAdjacency();
+  ~vtkvmtkPolyDataAdjacency();
+
+  vtkIdTypeArray* PointNeighborOffsets;
+  vtkIdTypeArray* PointNeighborIds;
+  vtkIdTypeArray* PointCellOffsets;
+  vtkIdTypeArray* PointCellIds;
+  vtkIdTypeArray* CellOffsets;
+  vtkIdTypeArray* CellPointIds;
+
+  vtkIdType NumberOfPoints;
+  vtkIdType NumberOfCells;
+  vtkPolyData* BuiltInput;
+  vtkCellArray* BuiltCells[4];
+  vtkTimeStamp BuildTime;
+  int Built;
+
+  private:
+  vtkvmtkPolyDataAdjacency(const vtkvmtkPolyDataAdjacency&);  // Not implemented.
+  void operator=(const vtkvmtkPolyDataAdjacency&);  // Not implemented.
+};
+
+#endif
@@ -208,11 +208,13 @@ int vtkvmtkPolyDataCenterlineGroupsClipper::RequestData(
   groupTubes->SetInput(this->Centerlines);
   groupTubes->SetPolyBallRadiusArrayName(this->CenterlineRadiusArrayName);
   groupTubes->SetUseRadiusInformation(this->UseRadiusInformation);
+  groupTubes->UseSpatialIndexOn();
 
   vtkvmtkPolyBallLine* nonGroupTubes = vtkvmtkPolyBallLine::New();
   nonGroupTubes->SetInput(this->Centerlines);
   nonGroupTubes->SetPolyBallRadiusArrayName(this->CenterlineRadiusArrayName);
   nonGroupTubes->SetUseRadiusInformation(this->UseRadiusInformation);
+  nonGroupTubes->UseSpatialIndexOn();
 
   int numberOfPoints = input->GetNumberOfPoints();
 
@@ -232,7 +234,9 @@ int vtkvmtkPolyDataCenterlineGroupsClipper::RequestData(
   vtkIdList* groupTubesGroupIds = vtkIdList::New();
   vtkIdList* nonGroupTubesGroupIds = vtkIdList::New();
 
-  double point[3];
+  vtkDoubleArray* groupTubeValues = vtkDoubleArray::New();
+  vtkDoubleArray* nonGroupTubeValues = vtkDoubleArray::New();
+
   double groupTubeValue, nonGroupTubeValue, tubeDifferenceValue;
 
   vtkIdType groupId;
@@ -287,15 +291,20 @@ int vtkvmtkPolyDataCenterlineGroupsClipper::RequestData(
     groupTubes->SetInputCellIds(groupTubesGroupIds);
     nonGroupTubes->SetInputCellIds(nonGroupTubesGroupIds);
 
+    if (numberOfPoints > 0)
+      {
+      groupTubes->EvaluateFunction(input->GetPoints()->GetData(),groupTubeValues);
+      nonGroupTubes->EvaluateFunction(input->GetPoints()->GetData(),nonGroupTubeValues);
+      }
+
     for (int k=0; k<numberOfPoints; k++)
       {
-      input->GetPoint(k,point);
-      groupTubeValue = groupTubes->EvaluateFunction(point);
+      groupTubeValue = groupTubeValues->GetValue(k);
       if (groupTubeValue > this->CutoffRadiusFactor * this->CutoffRadiusFactor - 1)
         {
         groupTubeValue = VTK_VMTK_LARGE_DOUBLE;
         }
-      nonGroupTubeValue = nonGroupTubes->EvaluateFunction(point);
+      nonGroupTubeValue = nonGroupTubeValues->GetValue(k);
       tubeDifferenceValue = nonGroupTubeValue - groupTubeValue;
       clippingArray->SetValue(k,tubeDifferenceValue);
       }
@@ -348,6 +357,8 @@ int vtkvmtkPolyDataCenterlineGroupsClipper::RequestData(
     }
 
   clippingArray->Delete();
+  groupTubeValues->Delete();
+  nonGroupTubeValues->Delete();
   clippingInput->Delete();
   appendBranches->Delete();
   groupTubes->Delete();
@@ -28,6 +28,7 @@ Version:   $Revision: 1.6 $
 #include "vtkvmtkSimplifyVoronoiDiagram.h"
 #include "vtkArrayCalculator.h"
 #include "vtkvmtkNonManifoldFastMarching.h"
+#include "vtkvmtkPolyDataAdjacency.h"
 #include "vtkvmtkSteepestDescentLineTracer.h"
 #include "vtkMath.h"
 #include "vtkPolyData.h"
@@ -39,8 +40,114 @@ Version:   $Revision: 1.6 $
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkTimeStamp.h"
 #include "vtkVersion.h"
 
+#include <string>
+#include <vector>
+
+// State of the previous execution kept when CacheEikonalSolution is on. Object pointers are only
+// compared for identity, the objects themselves are owned by the filter.
+class vtkvmtkPolyDataCenterlinesCache
+{
+  public:
+  vtkvmtkPolyDataCenterlinesCache()
+    {
+    this->VoronoiSeeds = vtkIdList::New();
+    this->Adjacency = vtkvmtkPolyDataAdjacency::New();
+    this->Invalidate();
+    }
+
+  ~vtkvmtkPolyDataCenterlinesCache()
+    {
+    this->VoronoiSeeds->Delete();
+    this->Adjacency->Delete();
+    }
+
+  void Invalidate()
+    {
+    this->VoronoiDiagramValid = 0;
+    this->EikonalSolutionValid = 0;
+    this->DelaunayTessellation = NULL;
+    this->VoronoiDiagram = NULL;
+    this->PoleIds = NULL;
+    this->FlipNormals = 0;
+    this->SimplifyVoronoi = 0;
+    this->GenerateDelaunayTessellation = 0;
+    this->GenerateVoronoiDiagram = 0;
+    this->DelaunayTolerance = 0.0;
+    this->HasCapCenterIds = 0;
+    this->CapCenterIds.clear();
+    this->SourceSeedIds.clear();
+    this->VoronoiSeeds->Initialize();
+    this->Adjacency->Initialize();
+    }
+
+  static std::string ToString(const char* string)
+    {
+    return string ? std::string(string) : std::string();
+    }
+
+  static int CopyIds(vtkIdList* ids, std::vector<vtkIdType>& copy)
+    {
+    copy.clear();
+    if (!ids)
+      {
+      return 0;
+      }
+    for (vtkIdType i=0; i<ids->GetNumberOfIds(); i++)
+      {
+      copy.push_back(ids->GetId(i));
+      }
+    return 1;
+    }
+
+  static int SameIds(vtkIdList* ids, int hadIds, const std::vector<vtkIdType>& copy)
+    {
+    if (!ids || !hadIds)
+      {
+      return !ids && !hadIds;
+      }
+    if (ids->GetNumberOfIds() != static_cast<vtkIdType>(copy.size()))
+      {
+      return 0;
+      }
+    for (vtkIdType i=0; i<ids->GetNumberOfIds(); i++)
+      {
+      if (ids->GetId(i) != copy[i])
+        {
+        return 0;
+        }
+      }
+    return 1;
+    }
+
+  int VoronoiDiagramValid;
+  int EikonalSolutionValid;
+  vtkTimeStamp BuildTime;
+
+  vtkUnstructuredGrid* DelaunayTessellation;
+  vtkPolyData* VoronoiDiagram;
+  vtkIdList* PoleIds;
+
+  int FlipNormals;
+  int SimplifyVoronoi;
+  int GenerateDelaunayTessellation;
+  int GenerateVoronoiDiagram;
+  double DelaunayTolerance;
+  std::string RadiusArrayName;
+  int HasCapCenterIds;
+  std::vector<vtkIdType> CapCenterIds;
+  vtkIdList* VoronoiSeeds;
+
+  std::vector<vtkIdType> SourceSeedIds;
+  std::string CostFunction;
+  std::string CostFunctionArrayName;
+  std::string EikonalSolutionArrayName;
+
+  vtkvmtkPolyDataAdjacency* Adjacency;
+};
+
 vtkStandardNewMacro(vtkvmtkPolyDataCenterlines);
 
 vtkCxxSetObjectMacro(vtkvmtkPolyDataCenterlines,SourceSeedIds,vtkIdList);
@@ -85,6 +192,9 @@ vtkvmtkPolyDataCenterlines::vtkvmtkPolyDataCenterlines()
   this->StopFastMarchingOnReachingTarget = 0;
   this->VoronoiDiagram = NULL;
   this->PoleIds = NULL;
+
+  this->CacheEikonalSolution = 0;
+  this->Cache = new vtkvmtkPolyDataCenterlinesCache;
 }
 
 vtkvmtkPolyDataCenterlines::~vtkvmtkPolyDataCenterlines()
@@ -161,6 +271,8 @@ vtkvmtkPolyDataCenterlines::~vtkvmtkPolyDataCenterlines()
     this->PoleIds = NULL;
   }
 
+  delete this->Cache;
+  this->Cache = NULL;
 }
 
 int vtkvmtkPolyDataCenterlines::RequestData(
@@ -175,7 +287,7 @@ int vtkvmtkPolyDataCenterlines::RequestData(
     inInfo->Get(vtkDataObject::DATA_OBJECT()));
   vtkPolyData *output = vtkPolyData::SafeDownCast(
     outInfo->Get(vtkDataObject::DATA_OBJECT()));
-  
+
   if (!this->SourceSeedIds)
     {
     vtkErrorMacro(<< "No SourceSeedIds set.");
@@ -212,6 +324,129 @@ int vtkvmtkPolyDataCenterlines::RequestData(
     return 1;
   }
 
+  int useCachedVoronoiDiagram = this->CacheEikonalSolution && this->IsVoronoiDiagramCacheValid(input);
+  int useCachedEikonalSolution = useCachedVoronoiDiagram && this->IsEikonalSolutionCacheValid();
+
+  vtkIdList* voronoiSeeds = vtkIdList::New();
+
+  if (useCachedVoronoiDiagram)
+  {
+    voronoiSeeds->DeepCopy(this->Cache->VoronoiSeeds);
+  }
+  else
+  {
+    this->Cache->Invalidate();
+    if (!this->ComputeVoronoiDiagram(input,voronoiSeeds))
+    {
+      voronoiSeeds->Delete();
+      return 1;
+    }
+  }
+
+  vtkIdList* voronoiSourceSeedIds = vtkIdList::New();
+  vtkIdList* voronoiTargetSeedIds = vtkIdList::New();
+
+  int i;
+  if (this->CapCenterIds)
+  {
+    for (i=0; i<this->SourceSeedIds->GetNumberOfIds(); i++)
+    {
+      voronoiSourceSeedIds->InsertNextId(voronoiSeeds->GetId(this->SourceSeedIds->GetId(i)));
+    }
+    for (i=0; i<this->TargetSeedIds->GetNumberOfIds(); i++)
+    {
+      voronoiTargetSeedIds->InsertNextId(voronoiSeeds->GetId(this->TargetSeedIds->GetId(i)));
+    }
+  }
+  else
+  {
+    for (i=0; i<this->SourceSeedIds->GetNumberOfIds(); i++)
+    {
+      voronoiSourceSeedIds->InsertNextId(this->PoleIds->GetId(this->SourceSeedIds->GetId(i)));
+    }
+    for (i=0; i<this->TargetSeedIds->GetNumberOfIds(); i++)
+    {
+      voronoiTargetSeedIds->InsertNextId(this->PoleIds->GetId(this->TargetSeedIds->GetId(i)));
+    }
+  }
+
+  if (!useCachedEikonalSolution)
+  {
+    this->ComputeEikonalSolution(voronoiSourceSeedIds,voronoiTargetSeedIds);
+  }
+
+  vtkvmtkSteepestDescentLineTracer* centerlineBacktracing = vtkvmtkSteepestDescentLineTracer::New();
+  centerlineBacktracing->SetInputData(this->VoronoiDiagram);
+  centerlineBacktracing->SetDataArrayName(this->RadiusArrayName);
+  centerlineBacktracing->SetDescentArrayName(this->EikonalSolutionArrayName);
+  centerlineBacktracing->SetEdgeArrayName(this->EdgeArrayName);
+  centerlineBacktracing->SetEdgePCoordArrayName(this->EdgePCoordArrayName);
+  centerlineBacktracing->SetSeeds(voronoiTargetSeedIds);
+  centerlineBacktracing->MergePathsOff();
+  centerlineBacktracing->ParallelTracingOn();
+  centerlineBacktracing->StopOnTargetsOn();
+  centerlineBacktracing->SetTargets(voronoiSourceSeedIds);
+  centerlineBacktracing->Update();
+
+  output->ShallowCopy(centerlineBacktracing->GetOutput());
+
+  vtkIdList* hitTargets = centerlineBacktracing->GetHitTargets();
+
+  vtkPoints* endPointPairs = vtkPoints::New();
+
+  const vtkIdType numTargetSeedIds = this->TargetSeedIds->GetNumberOfIds();
+  const vtkIdType numHitTargets = hitTargets->GetNumberOfIds();
+  if(numHitTargets == numTargetSeedIds) {
+  if (this->AppendEndPointsToCenterlines)
+    {
+    for (i=0; i<numTargetSeedIds; i++)
+      {
+      if (this->CapCenterIds)
+        {
+        vtkIdType endPointId1 = this->CapCenterIds->GetId(this->TargetSeedIds->GetId(i));
+        vtkIdType hitTargetPointId = hitTargets->GetId(i);
+        vtkIdType targetId = voronoiSourceSeedIds->IsId(hitTargetPointId);
+        vtkIdType endPointId2 = this->CapCenterIds->GetId(this->SourceSeedIds->GetId(targetId));
+        endPointPairs->InsertNextPoint(input->GetPoint(endPointId1));
+        endPointPairs->InsertNextPoint(input->GetPoint(endPointId2));
+        }
+      else
+        {
+        vtkIdType endPointId1 = this->TargetSeedIds->GetId(i);
+        vtkIdType hitTargetPointId = hitTargets->GetId(i);
+        vtkIdType targetId = voronoiSourceSeedIds->IsId(hitTargetPointId);
+        vtkIdType endPointId2 = this->SourceSeedIds->GetId(targetId);
+        endPointPairs->InsertNextPoint(input->GetPoint(endPointId1));
+        endPointPairs->InsertNextPoint(input->GetPoint(endPointId2));
+        }
+      }
+
+    this->AppendEndPoints(endPointPairs);
+    }
+  }
+
+  if (this->CenterlineResampling)
+    {
+    this->ResampleCenterlines();
+    }
+  this->ReverseCenterlines();
+
+  if (this->CacheEikonalSolution)
+    {
+    this->UpdateCache(voronoiSeeds);
+    }
+
+  voronoiSeeds->Delete();
+  voronoiSourceSeedIds->Delete();
+  voronoiTargetSeedIds->Delete();
+  centerlineBacktracing->Delete();
+  endPointPairs->Delete();
+
+  return 1;
+}
+
+int vtkvmtkPolyDataCenterlines::ComputeVoronoiDiagram(vtkPolyData* input, vtkIdList* voronoiSeeds)
+{
   // Since VTK 9.4, vtkPolyDataNormals passes pre-existing normals through
   // unchanged instead of recomputing them, so inherited input normals would
   // bypass AutoOrientNormals and feed arbitrarily oriented normals to the
@@ -253,7 +488,10 @@ int vtkvmtkPolyDataCenterlines::RequestData(
       || !surfaceNormals->GetOutput()->GetPointData()->GetNormals()->GetName())
     {
       vtkErrorMacro(<< "Centerline extraction failed: could not compute surface normals");
-      return 1;
+      delaunayTessellator->Delete();
+      internalTetrahedraExtractor->Delete();
+      surfaceNormals->Delete();
+      return 0;
     }
 
     internalTetrahedraExtractor->SetOutwardNormalsArrayName(surfaceNormals->GetOutput()->GetPointData()->GetNormals()->GetName());
@@ -263,9 +501,13 @@ int vtkvmtkPolyDataCenterlines::RequestData(
       internalTetrahedraExtractor->UseCapsOn();
       internalTetrahedraExtractor->SetCapCenterIds(this->CapCenterIds);
     }
-    
+
     internalTetrahedraExtractor->Update();
 
+    if (this->DelaunayTessellation)
+    {
+      this->DelaunayTessellation->Delete();
+    }
     this->DelaunayTessellation = internalTetrahedraExtractor->GetOutput();
     this->DelaunayTessellation->Register(this);
 
@@ -280,6 +522,10 @@ int vtkvmtkPolyDataCenterlines::RequestData(
     voronoiDiagramFilter->SetRadiusArrayName(this->RadiusArrayName);
     voronoiDiagramFilter->Update();
 
+    if (this->PoleIds)
+    {
+      this->PoleIds->Delete();
+    }
     this->PoleIds = vtkIdList::New();
     this->PoleIds->DeepCopy(voronoiDiagramFilter->GetPoleIds());
 
@@ -295,11 +541,27 @@ int vtkvmtkPolyDataCenterlines::RequestData(
       voronoiDiagram->Register(this);
       voronoiDiagramSimplifier->Delete();
     }
+    if (this->VoronoiDiagram)
+    {
+      this->VoronoiDiagram->Delete();
+    }
     this->VoronoiDiagram = vtkPolyData::New();
     this->VoronoiDiagram->DeepCopy(voronoiDiagram);
     voronoiDiagramFilter->Delete();
   }
 
+  if (this->CapCenterIds)
+  {
+    this->FindVoronoiSeeds(this->DelaunayTessellation,this->CapCenterIds,surfaceNormals->GetOutput()->GetPointData()->GetNormals(),voronoiSeeds);
+  }
+
+  surfaceNormals->Delete();
+
+  return 1;
+}
+
+void vtkvmtkPolyDataCenterlines::ComputeEikonalSolution(vtkIdList* voronoiSourceSeedIds, vtkIdList* voronoiTargetSeedIds)
+{
   #if defined(__EMSCRIPTEN__)
     vtkNew<vtkDoubleArray> array;
     array->SetName(this->CostFunctionArrayName);
@@ -311,7 +573,7 @@ int vtkvmtkPolyDataCenterlines::RequestData(
       array->InsertNextValue(1 / outputArray->GetValue(i));
     }
     this->VoronoiDiagram->GetPointData()->AddArray(array);
-  #else 
+  #else
     vtkArrayCalculator *voronoiCostFunctionCalculator = vtkArrayCalculator::New();
     voronoiCostFunctionCalculator->SetInputData(this->VoronoiDiagram);
     voronoiCostFunctionCalculator->SetAttributeTypeToPointData();
@@ -321,123 +583,147 @@ int vtkvmtkPolyDataCenterlines::RequestData(
     voronoiCostFunctionCalculator->Update();
   #endif
 
-  vtkIdList* voronoiSourceSeedIds = vtkIdList::New();
-  vtkIdList* voronoiTargetSeedIds = vtkIdList::New();
-
-  vtkIdList* voronoiSeeds = vtkIdList::New();
-
-  int i;
-  if (this->CapCenterIds)
-  {
-    this->FindVoronoiSeeds(this->DelaunayTessellation,this->CapCenterIds,surfaceNormals->GetOutput()->GetPointData()->GetNormals(),voronoiSeeds);
-    for (i=0; i<this->SourceSeedIds->GetNumberOfIds(); i++)
-    {
-      voronoiSourceSeedIds->InsertNextId(voronoiSeeds->GetId(this->SourceSeedIds->GetId(i)));
-    }
-    for (i=0; i<this->TargetSeedIds->GetNumberOfIds(); i++)
-    {
-      voronoiTargetSeedIds->InsertNextId(voronoiSeeds->GetId(this->TargetSeedIds->GetId(i)));
-    }
-  }
-  else
-  { 
-    for (i=0; i<this->SourceSeedIds->GetNumberOfIds(); i++)
-    {
-      voronoiSourceSeedIds->InsertNextId(this->PoleIds->GetId(this->SourceSeedIds->GetId(i)));
-    }
-    for (i=0; i<this->TargetSeedIds->GetNumberOfIds(); i++)
-    {
-      voronoiTargetSeedIds->InsertNextId(this->PoleIds->GetId(this->TargetSeedIds->GetId(i)));
-    }
-  }
-
   vtkvmtkNonManifoldFastMarching* voronoiFastMarching = vtkvmtkNonManifoldFastMarching::New();
   #if defined(__EMSCRIPTEN__)
-     voronoiFastMarching->SetInputData(this->VoronoiDiagram); 
+     voronoiFastMarching->SetInputData(this->VoronoiDiagram);
   #else
      voronoiFastMarching->SetInputConnection(voronoiCostFunctionCalculator->GetOutputPort());
   #endif
   voronoiFastMarching->SetCostFunctionArrayName(this->CostFunctionArrayName);
   voronoiFastMarching->SetSolutionArrayName(this->EikonalSolutionArrayName);
-  if (this->StopFastMarchingOnReachingTarget == 1)
+  if (this->StopFastMarchingOnReachingTarget == 1 && !this->CacheEikonalSolution)
   {
   voronoiFastMarching->SetStopSeedId(voronoiTargetSeedIds);
   }
+  if (this->CacheEikonalSolution)
+  {
+    // the adjacency only depends on the Voronoi diagram, new source seeds reuse it
+    voronoiFastMarching->SetAdjacency(this->Cache->Adjacency);
+  }
   voronoiFastMarching->SeedsBoundaryConditionsOn();
   voronoiFastMarching->SetSeeds(voronoiSourceSeedIds);
   voronoiFastMarching->Update();
 
   this->VoronoiDiagram->ShallowCopy(voronoiFastMarching->GetOutput());
 
-  vtkvmtkSteepestDescentLineTracer* centerlineBacktracing = vtkvmtkSteepestDescentLineTracer::New();
-  centerlineBacktracing->SetInputConnection(voronoiFastMarching->GetOutputPort());
-  centerlineBacktracing->SetDataArrayName(this->RadiusArrayName);
-  centerlineBacktracing->SetDescentArrayName(this->EikonalSolutionArrayName);
-  centerlineBacktracing->SetEdgeArrayName(this->EdgeArrayName);
-  centerlineBacktracing->SetEdgePCoordArrayName(this->EdgePCoordArrayName);
-  centerlineBacktracing->SetSeeds(voronoiTargetSeedIds);
-  centerlineBacktracing->MergePathsOff();
-  centerlineBacktracing->StopOnTargetsOn();
-  centerlineBacktracing->SetTargets(voronoiSourceSeedIds);
-  centerlineBacktracing->Update();
+  #if !defined(__EMSCRIPTEN__)
+  voronoiCostFunctionCalculator->Delete();
+  #endif
+  voronoiFastMarching->Delete();
+}
 
-  output->ShallowCopy(centerlineBacktracing->GetOutput());
+int vtkvmtkPolyDataCenterlines::IsVoronoiDiagramCacheValid(vtkPolyData* input)
+{
+  vtkvmtkPolyDataCenterlinesCache* cache = this->Cache;
 
-  vtkIdList* hitTargets = centerlineBacktracing->GetHitTargets();
+  if (!cache->VoronoiDiagramValid)
+    {
+    return 0;
+    }
 
-  vtkPoints* endPointPairs = vtkPoints::New();
+  if (!this->DelaunayTessellation || !this->VoronoiDiagram || !this->PoleIds)
+    {
+    return 0;
+    }
 
-  const vtkIdType numTargetSeedIds = this->TargetSeedIds->GetNumberOfIds();
-  const vtkIdType numHitTargets = hitTargets->GetNumberOfIds();
-  if(numHitTargets == numTargetSeedIds) {
-  if (this->AppendEndPointsToCenterlines)
+  if (this->DelaunayTessellation != cache->DelaunayTessellation ||
+      this->VoronoiDiagram != cache->VoronoiDiagram ||
+      this->PoleIds != cache->PoleIds)
     {
-    for (i=0; i<numTargetSeedIds; i++)
-      {
-      if (this->CapCenterIds)
-        {
-        vtkIdType endPointId1 = this->CapCenterIds->GetId(this->TargetSeedIds->GetId(i));
-        vtkIdType hitTargetPointId = hitTargets->GetId(i);
-        vtkIdType targetId = voronoiSourceSeedIds->IsId(hitTargetPointId);
-        vtkIdType endPointId2 = this->CapCenterIds->GetId(this->SourceSeedIds->GetId(targetId));
-        endPointPairs->InsertNextPoint(input->GetPoint(endPointId1));
-        endPointPairs->InsertNextPoint(input->GetPoint(endPointId2));
-        }
-      else
-        {
-        vtkIdType endPointId1 = this->TargetSeedIds->GetId(i);
-        vtkIdType hitTargetPointId = hitTargets->GetId(i);
-        vtkIdType targetId = voronoiSourceSeedIds->IsId(hitTargetPointId);
-        vtkIdType endPointId2 = this->SourceSeedIds->GetId(targetId);
-        endPointPairs->InsertNextPoint(input->GetPoint(endPointId1));
-        endPointPairs->InsertNextPoint(input->GetPoint(endPointId2));
-        }
-      }
-    
-    this->AppendEndPoints(endPointPairs);
+    return 0;
     }
-  }
 
-  if (this->CenterlineResampling)
+  if (input->GetMTime() > cache->BuildTime ||
+      this->DelaunayTessellation->GetMTime() > cache->BuildTime ||
+      this->VoronoiDiagram->GetMTime() > cache->BuildTime)
     {
-    this->ResampleCenterlines();
+    return 0;
+    }
+
+  if (this->FlipNormals != cache->FlipNormals ||
+      this->SimplifyVoronoi != cache->SimplifyVoronoi ||
+      this->GenerateDelaunayTessellation != cache->GenerateDelaunayTessellation ||
+      this->GenerateVoronoiDiagram != cache->GenerateVoronoiDiagram ||
+      this->DelaunayTolerance != cache->DelaunayTolerance)
+    {
+    return 0;
+    }
+
+  if (vtkvmtkPolyDataCenterlinesCache::ToString(this->RadiusArrayName) != cache->RadiusArrayName)
+    {
+    return 0;
+    }
+
+  if (!vtkvmtkPolyDataCenterlinesCache::SameIds(this->CapCenterIds,cache->HasCapCenterIds,cache->CapCenterIds))
+    {
+    return 0;
+    }
+
+  return 1;
+}
+
+int vtkvmtkPolyDataCenterlines::IsEikonalSolutionCacheValid()
+{
+  vtkvmtkPolyDataCenterlinesCache* cache = this->Cache;
+
+  if (!cache->EikonalSolutionValid)
+    {
+    return 0;
+    }
+
+  if (!vtkvmtkPolyDataCenterlinesCache::SameIds(this->SourceSeedIds,1,cache->SourceSeedIds))
+    {
+    return 0;
+    }
+
+  if (vtkvmtkPolyDataCenterlinesCache::ToString(this->CostFunction) != cache->CostFunction ||
+      vtkvmtkPolyDataCenterlinesCache::ToString(this->CostFunctionArrayName) != cache->CostFunctionArrayName ||
+      vtkvmtkPolyDataCenterlinesCache::ToString(this->EikonalSolutionArrayName) != cache->EikonalSolutionArrayName)
+    {
+    return 0;
+    }
+
+  if (!this->EikonalSolutionArrayName || !this->VoronoiDiagram->GetPointData()->GetArray(this->EikonalSolutionArrayName))
+    {
+    return 0;
     }
-  this->ReverseCenterlines();
 
-  surfaceNormals->Delete();
-  #if !defined(__EMSCRIPTEN__)
-  voronoiCostFunctionCalculator->Delete();
-  #endif
-  voronoiSeeds->Delete();
-  voronoiSourceSeedIds->Delete();
-  voronoiTargetSeedIds->Delete();
-  voronoiFastMarching->Delete();
-  centerlineBacktracing->Delete();
-  endPointPairs->Delete();
-  
   return 1;
 }
 
+void vtkvmtkPolyDataCenterlines::UpdateCache(vtkIdList* voronoiSeeds)
+{
+  vtkvmtkPolyDataCenterlinesCache* cache = this->Cache;
+
+  cache->DelaunayTessellation = this->DelaunayTessellation;
+  cache->VoronoiDiagram = this->VoronoiDiagram;
+  cache->PoleIds = this->PoleIds;
+
+  cache->FlipNormals = this->FlipNormals;
+  cache->SimplifyVoronoi = this->SimplifyVoronoi;
+  cache->GenerateDelaunayTessellation = this->GenerateDelaunayTessellation;
+  cache->GenerateVoronoiDiagram = this->GenerateVoronoiDiagram;
+  cache->DelaunayTolerance = this->DelaunayTolerance;
+  cache->RadiusArrayName = vtkvmtkPolyDataCenterlinesCache::ToString(this->RadiusArrayName);
+  cache->HasCapCenterIds = vtkvmtkPolyDataCenterlinesCache::CopyIds(this->CapCenterIds,cache->CapCenterIds);
+  cache->VoronoiSeeds->DeepCopy(voronoiSeeds);
+
+  vtkvmtkPolyDataCenterlinesCache::CopyIds(this->SourceSeedIds,cache->SourceSeedIds);
+  cache->CostFunction = vtkvmtkPolyDataCenterlinesCache::ToString(this->CostFunction);
+  cache->CostFunctionArrayName = vtkvmtkPolyDataCenterlinesCache::ToString(this->CostFunctionArrayName);
+  cache->EikonalSolutionArrayName = vtkvmtkPolyDataCenterlinesCache::ToString(this->EikonalSolutionArrayName);
+
+  cache->VoronoiDiagramValid = 1;
+  cache->EikonalSolutionValid = 1;
+  cache->BuildTime.Modified();
+}
+
+void vtkvmtkPolyDataCenterlines::InvalidateCache()
+{
+  this->Cache->Invalidate();
+  this->Modified();
+}
+
 void vtkvmtkPolyDataCenterlines::FindVoronoiSeeds(vtkUnstructuredGrid *delaunay, vtkIdList *boundaryBaricenterIds, vtkDataArray *normals, vtkIdList *seedIds)
 {
   vtkIdType i, j;
@@ -708,4 +994,6 @@ void vtkvmtkPolyDataCenterlines::ReverseCenterlines()
 void vtkvmtkPolyDataCenterlines::PrintSelf(std::ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "CacheEikonalSolution: " << this->CacheEikonalSolution << "\n";
 }
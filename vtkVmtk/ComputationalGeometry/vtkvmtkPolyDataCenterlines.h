@@ -30,6 +30,10 @@ Program:   VMTK
  * seed, and the resulting paths become the output centerlines. This is the filter behind the
  * vmtkcenterlines pype script, the foundation of most other centerline-based analysis in vmtk.
  *
+ * When the filter is updated several times on the same surface with different target seeds (e.g.
+ * one outlet at a time), turn CacheEikonalSolution on: the tessellation, the Voronoi diagram and the
+ * Eikonal solution of the previous execution are then kept and only the backtracing is repeated.
+ *
  * @sa
  * vtkvmtkVoronoiDiagram3D, vtkvmtkNonManifoldFastMarching, vtkvmtkSteepestDescentLineTracer
  */
@@ -47,6 +51,7 @@ class vtkPolyData;
 class vtkPoints;
 class vtkIdList;
 class vtkDataArray;
+class vtkvmtkPolyDataCenterlinesCache;
 
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataCenterlines : public vtkPolyDataAlgorithm
 {
@@ -269,6 +274,26 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataCenterlines : public
   vtkGetMacro(DelaunayTolerance,double);
   ///@}
 
+  ///@{
+  /**
+   * Toggle keeping the Delaunay tessellation, the Voronoi diagram and the Eikonal solution between
+   * executions. When on, a new execution only repeats the centerline backtracing, unless the input
+   * surface, the source seeds, the cap centers or a parameter affecting the Voronoi diagram or the
+   * cost function have changed since the previous one; changing TargetSeedIds alone does not
+   * trigger any recomputation. StopFastMarchingOnReachingTarget is ignored in this mode, since the
+   * Eikonal solution must cover every possible target. Default: off.
+   */
+  vtkSetMacro(CacheEikonalSolution,int);
+  vtkGetMacro(CacheEikonalSolution,int);
+  vtkBooleanMacro(CacheEikonalSolution,int);
+  ///@}
+
+  /**
+   * Discard the cached Voronoi diagram and Eikonal solution, so that the next execution recomputes
+   * them (see CacheEikonalSolution).
+   */
+  void InvalidateCache();
+
 
   protected:
   vtkvmtkPolyDataCenterlines();
@@ -276,6 +301,12 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataCenterlines : public
 
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
 
+  int ComputeVoronoiDiagram(vtkPolyData* input, vtkIdList* voronoiSeeds);
+  void ComputeEikonalSolution(vtkIdList* voronoiSourceSeedIds, vtkIdList* voronoiTargetSeedIds);
+  int IsVoronoiDiagramCacheValid(vtkPolyData* input);
+  int IsEikonalSolutionCacheValid();
+  void UpdateCache(vtkIdList* voronoiSeeds);
+
   void FindVoronoiSeeds(vtkUnstructuredGrid *delaunay, vtkIdList *boundaryBaricenterIds, vtkDataArray *normals, vtkIdList *seedIds);
   void AppendEndPoints(vtkPoints* endPointPairs);
   void ResampleCenterlines();
@@ -311,6 +342,9 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataCenterlines : public
   int GenerateDelaunayTessellation;
   double DelaunayTolerance;
 
+  int CacheEikonalSolution;
+  vtkvmtkPolyDataCenterlinesCache* Cache;
+
   private:
   vtkvmtkPolyDataCenterlines(const vtkvmtkPolyDataCenterlines&);  // Not implemented.
   void operator=(const vtkvmtkPolyDataCenterlines&);  // Not implemented.
@@ -140,6 +140,7 @@ int vtkvmtkPolyDataDistanceToCenterlines::RequestData(
   vtkvmtkPolyBallLine* tube = vtkvmtkPolyBallLine::New();
   tube->SetInput(this->Centerlines);
   tube->SetUseRadiusInformation(this->UseRadiusInformation);
+  tube->UseSpatialIndexOn();
   if (this->UseRadiusInformation)
     {
     tube->SetPolyBallRadiusArrayName(this->CenterlineRadiusArrayName);
@@ -0,0 +1,472 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkPolyDataGraphGeodesicDistance.cxx,v $
+Language:  C++
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENSE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "vtkvmtkPolyDataGraphGeodesicDistance.h"
+#include "vtkvmtkConstants.h"
+#include "vtkIdList.h"
+#include "vtkPolyData.h"
+#include "vtkPoints.h"
+#include "vtkCellType.h"
+#include "vtkMath.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
+#include "vtkObjectFactory.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+
+vtkStandardNewMacro(vtkvmtkPolyDataGraphGeodesicDistance);
+
+// Appends the edges of a cell to edges as pairs of point ids.
+static void vtkvmtkPolyDataGraphGeodesicDistanceGetCellEdges(int cellType, vtkIdType npts, const vtkIdType* pts, std::vector<vtkIdType>& edges)
+{
+  vtkIdType j;
+  edges.clear();
+  switch (cellType)
+    {
+    case VTK_TRIANGLE:
+    case VTK_QUAD:
+    case VTK_POLYGON:
+      for (j=0; j<npts; j++)
+        {
+        edges.push_back(pts[j]);
+        edges.push_back(pts[(j+1)%npts]);
+        }
+      break;
+    case VTK_PIXEL:
+      if (npts == 4)
+        {
+        vtkIdType pixelEdges[8] = {pts[0], pts[1], pts[1], pts[3], pts[3], pts[2], pts[2], pts[0]};
+        edges.assign(pixelEdges,pixelEdges+8);
+        }
+      break;
+    case VTK_TRIANGLE_STRIP:
+      for (j=0; j+1<npts; j++)
+        {
+        edges.push_back(pts[j]);
+        edges.push_back(pts[j+1]);
+        if (j+2<npts)
+          {
+          edges.push_back(pts[j]);
+          edges.push_back(pts[j+2]);
+          }
+        }
+      break;
+    case VTK_LINE:
+    case VTK_POLY_LINE:
+      for (j=0; j+1<npts; j++)
+        {
+        edges.push_back(pts[j]);
+        edges.push_back(pts[j+1]);
+        }
+      break;
+    default:
+      break;
+    }
+}
+
+// Sorts the neighbors of every point and removes the duplicates (edges shared by two cells).
+// The unique neighbors stay at the front of the point range, their number goes to Counts.
+class vtkvmtkPolyDataGraphGeodesicDistanceUniqueFunctor
+{
+public:
+  const vtkIdType* Offsets;
+  vtkIdType* PointIds;
+  vtkIdType* Counts;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      vtkIdType* first = this->PointIds + this->Offsets[i];
+      vtkIdType* last = this->PointIds + this->Offsets[i+1];
+      std::sort(first,last);
+      this->Counts[i] = static_cast<vtkIdType>(std::unique(first,last) - first);
+      }
+    }
+};
+
+class vtkvmtkPolyDataGraphGeodesicDistanceLengthFunctor
+{
+public:
+  vtkPoints* Points;
+  const vtkIdType* Offsets;
+  const vtkIdType* PointIds;
+  double* Lengths;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    double point[3], neighbor[3];
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      this->Points->GetPoint(i,point);
+      for (vtkIdType j=this->Offsets[i]; j<this->Offsets[i+1]; j++)
+        {
+        this->Points->GetPoint(this->PointIds[j],neighbor);
+        this->Lengths[j] = sqrt(vtkMath::Distance2BetweenPoints(point,neighbor));
+        }
+      }
+    }
+};
+
+// Dijkstra sweep from a set of seeds, with lazy deletion of the queue entries superseded by a
+// shorter path.
+static void vtkvmtkPolyDataGraphGeodesicDistanceSweep(vtkIdType numberOfPoints, const vtkIdType* offsets, const vtkIdType* pointIds, const double* lengths, const vtkIdType* seedIds, vtkIdType numberOfSeeds, double maximumDistance, double* distances, vtkIdType* closestSeeds)
+{
+  typedef std::pair<double,vtkIdType> QueueEntry;
+  std::priority_queue<QueueEntry,std::vector<QueueEntry>,std::greater<QueueEntry> > queue;
+
+  vtkIdType i, j;
+  for (i=0; i<numberOfPoints; i++)
+    {
+    distances[i] = VTK_VMTK_LARGE_DOUBLE;
+    }
+  if (closestSeeds)
+    {
+    for (i=0; i<numberOfPoints; i++)
+      {
+      closestSeeds[i] = -1;
+      }
+    }
+
+  for (i=0; i<numberOfSeeds; i++)
+    {
+    vtkIdType seedId = seedIds[i];
+    if (seedId < 0 || seedId >= numberOfPoints || distances[seedId] == 0.0)
+      {
+      continue;
+      }
+    distances[seedId] = 0.0;
+    if (closestSeeds)
+      {
+      closestSeeds[seedId] = i;
+      }
+    queue.push(QueueEntry(0.0,seedId));
+    }
+
+  while (!queue.empty())
+    {
+    QueueEntry entry = queue.top();
+    queue.pop();
+    vtkIdType pointId = entry.second;
+    if (entry.first > distances[pointId])
+      {
+      continue;
+      }
+    for (j=offsets[pointId]; j<offsets[pointId+1]; j++)
+      {
+      double distance = entry.first + lengths[j];
+      vtkIdType neighborId = pointIds[j];
+      if (distance > maximumDistance || distance >= distances[neighborId])
+        {
+        continue;
+        }
+      distances[neighborId] = distance;
+      if (closestSeeds)
+        {
+        closestSeeds[neighborId] = closestSeeds[pointId];
+        }
+      queue.push(QueueEntry(distance,neighborId));
+      }
+    }
+}
+
+class vtkvmtkPolyDataGraphGeodesicDistanceSeedFunctor
+{
+public:
+  vtkIdType NumberOfPoints;
+  const vtkIdType* Offsets;
+  const vtkIdType* PointIds;
+  const double* Lengths;
+  const vtkIdType* SeedIds;
+  vtkIdType NumberOfSeeds;
+  double MaximumDistance;
+  double* Distances;
+
+  // each sweep runs on a contiguous per-thread buffer and is copied to its component of Distances
+  // once done, instead of updating interleaved values shared with the sweeps of other threads
+  vtkSMPThreadLocal<std::vector<double> > SweepDistances;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    std::vector<double>& sweepDistances = this->SweepDistances.Local();
+    sweepDistances.resize(this->NumberOfPoints);
+    for (vtkIdType k=begin; k<end; k++)
+      {
+      vtkvmtkPolyDataGraphGeodesicDistanceSweep(this->NumberOfPoints,this->Offsets,this->PointIds,this->Lengths,this->SeedIds+k,1,this->MaximumDistance,&sweepDistances[0],NULL);
+      double* distances = this->Distances + k;
+      for (vtkIdType i=0; i<this->NumberOfPoints; i++)
+        {
+        distances[i*this->NumberOfSeeds] = sweepDistances[i];
+        }
+      }
+    }
+};
+
+vtkvmtkPolyDataGraphGeodesicDistance::vtkvmtkPolyDataGraphGeodesicDistance()
+{
+  this->EdgeOffsets = vtkIdTypeArray::New();
+  this->EdgePointIds = vtkIdTypeArray::New();
+  this->EdgeLengths = vtkDoubleArray::New();
+
+  this->NumberOfPoints = 0;
+  this->MaximumDistance = VTK_VMTK_LARGE_DOUBLE;
+
+  this->BuiltInput = NULL;
+  this->Built = 0;
+}
+
+vtkvmtkPolyDataGraphGeodesicDistance::~vtkvmtkPolyDataGraphGeodesicDistance()
+{
+  this->EdgeOffsets->Delete();
+  this->EdgePointIds->Delete();
+  this->EdgeLengths->Delete();
+}
+
+void vtkvmtkPolyDataGraphGeodesicDistance::Initialize()
+{
+  this->EdgeOffsets->Initialize();
+  this->EdgePointIds->Initialize();
+  this->EdgeLengths->Initialize();
+
+  this->NumberOfPoints = 0;
+  this->BuiltInput = NULL;
+  this->Built = 0;
+
+  this->Modified();
+}
+
+int vtkvmtkPolyDataGraphGeodesicDistance::IsBuiltFor(vtkPolyData* input)
+{
+  if (!this->Built || !input || input != this->BuiltInput)
+    {
+    return 0;
+    }
+
+  // the input is not referenced, a different poly data allocated at the same address is caught
+  // by its modification time, later than the build time
+  if (input->GetNumberOfPoints() != this->NumberOfPoints || input->GetMTime() > this->BuildTime.GetMTime())
+    {
+    return 0;
+    }
+
+  return 1;
+}
+
+void vtkvmtkPolyDataGraphGeodesicDistance::Build(vtkPolyData* input)
+{
+  vtkIdType i, j;
+  vtkIdType npts;
+  const vtkIdType *pts;
+
+  if (this->IsBuiltFor(input))
+    {
+    return;
+    }
+
+  this->Initialize();
+
+  if (!input)
+    {
+    vtkErrorMacro(<<"No input poly data.");
+    return;
+    }
+
+  vtkIdType numberOfPoints = input->GetNumberOfPoints();
+  vtkIdType numberOfCells = input->GetNumberOfCells();
+
+  input->BuildCells();
+
+  // every edge is stored in both directions, duplicates from neighboring cells included
+  this->EdgeOffsets->SetNumberOfValues(numberOfPoints+1);
+  vtkIdType* offsets = this->EdgeOffsets->GetPointer(0);
+  for (i=0; i<=numberOfPoints; i++)
+    {
+    offsets[i] = 0;
+    }
+
+  std::vector<vtkIdType> cellEdges;
+  for (i=0; i<numberOfCells; i++)
+    {
+    input->GetCellPoints(i,npts,pts);
+    vtkvmtkPolyDataGraphGeodesicDistanceGetCellEdges(input->GetCellType(i),npts,pts,cellEdges);
+    for (j=0; j<static_cast<vtkIdType>(cellEdges.size()); j+=2)
+      {
+      if (cellEdges[j] != cellEdges[j+1])
+        {
+        offsets[cellEdges[j]+1]++;
+        offsets[cellEdges[j+1]+1]++;
+        }
+      }
+    }
+  for (i=0; i<numberOfPoints; i++)
+    {
+    offsets[i+1] += offsets[i];
+    }
+
+  std::vector<vtkIdType> edgePointIds(offsets[numberOfPoints]);
+  std::vector<vtkIdType> insertPositions(offsets,offsets+numberOfPoints);
+  for (i=0; i<numberOfCells; i++)
+    {
+    input->GetCellPoints(i,npts,pts);
+    vtkvmtkPolyDataGraphGeodesicDistanceGetCellEdges(input->GetCellType(i),npts,pts,cellEdges);
+    for (j=0; j<static_cast<vtkIdType>(cellEdges.size()); j+=2)
+      {
+      if (cellEdges[j] != cellEdges[j+1])
+        {
+        edgePointIds[insertPositions[cellEdges[j]]++] = cellEdges[j+1];
+        edgePointIds[insertPositions[cellEdges[j+1]]++] = cellEdges[j];
+        }
+      }
+    }
+
+  std::vector<vtkIdType> counts(numberOfPoints);
+  if (numberOfPoints > 0 && !edgePointIds.empty())
+    {
+    vtkvmtkPolyDataGraphGeodesicDistanceUniqueFunctor uniqueFunctor;
+    uniqueFunctor.Offsets = offsets;
+    uniqueFunctor.PointIds = &edgePointIds[0];
+    uniqueFunctor.Counts = &counts[0];
+    vtkSMPTools::For(0,numberOfPoints,1024,uniqueFunctor);
+    }
+
+  // compact the unique neighbors
+  vtkIdType numberOfEdges = 0;
+  for (i=0; i<numberOfPoints; i++)
+    {
+    numberOfEdges += counts[i];
+    }
+  this->EdgePointIds->SetNumberOfValues(numberOfEdges);
+  vtkIdType* pointIds = this->EdgePointIds->GetPointer(0);
+  vtkIdType position = 0;
+  for (i=0; i<numberOfPoints; i++)
+    {
+    vtkIdType first = offsets[i];
+    offsets[i] = position;
+    for (j=0; j<counts[i]; j++)
+      {
+      pointIds[position++] = edgePointIds[first+j];
+      }
+    }
+  offsets[numberOfPoints] = position;
+
+  this->EdgeLengths->SetNumberOfValues(numberOfEdges);
+  if (numberOfEdges > 0)
+    {
+    vtkvmtkPolyDataGraphGeodesicDistanceLengthFunctor lengthFunctor;
+    lengthFunctor.Points = input->GetPoints();
+    lengthFunctor.Offsets = offsets;
+    lengthFunctor.PointIds = pointIds;
+    lengthFunctor.Lengths = this->EdgeLengths->GetPointer(0);
+    vtkSMPTools::For(0,numberOfPoints,1024,lengthFunctor);
+    }
+
+  this->NumberOfPoints = numberOfPoints;
+  this->BuiltInput = input;
+  this->Built = 1;
+  this->BuildTime.Modified();
+
+  this->Modified();
+}
+
+void vtkvmtkPolyDataGraphGeodesicDistance::ComputeDistances(vtkIdList* seedIds, vtkDoubleArray* distances, vtkIdTypeArray* closestSeeds)
+{
+  if (!this->Built)
+    {
+    vtkErrorMacro(<<"Graph not built.");
+    return;
+    }
+
+  if (!seedIds || !distances)
+    {
+    vtkErrorMacro(<<"Seed ids or distance array not set.");
+    return;
+    }
+
+  distances->SetNumberOfComponents(1);
+  distances->SetNumberOfTuples(this->NumberOfPoints);
+  vtkIdType* closestSeedPointer = NULL;
+  if (closestSeeds)
+    {
+    closestSeeds->SetNumberOfComponents(1);
+    closestSeeds->SetNumberOfTuples(this->NumberOfPoints);
+    closestSeedPointer = closestSeeds->GetPointer(0);
+    }
+
+  if (this->NumberOfPoints == 0)
+    {
+    return;
+    }
+
+  vtkvmtkPolyDataGraphGeodesicDistanceSweep(this->NumberOfPoints,this->EdgeOffsets->GetPointer(0),this->EdgePointIds->GetPointer(0),this->EdgeLengths->GetPointer(0),seedIds->GetPointer(0),seedIds->GetNumberOfIds(),this->MaximumDistance,distances->GetPointer(0),closestSeedPointer);
+}
+
+void vtkvmtkPolyDataGraphGeodesicDistance::ComputeSeedDistances(vtkIdList* seedIds, vtkDoubleArray* distances)
+{
+  if (!this->Built)
+    {
+    vtkErrorMacro(<<"Graph not built.");
+    return;
+    }
+
+  if (!seedIds || !distances)
+    {
+    vtkErrorMacro(<<"Seed ids or distance array not set.");
+    return;
+    }
+
+  vtkIdType numberOfSeeds = seedIds->GetNumberOfIds();
+  if (numberOfSeeds == 0)
+    {
+    distances->Initialize();
+    return;
+    }
+
+  distances->SetNumberOfComponents(static_cast<int>(numberOfSeeds));
+  distances->SetNumberOfTuples(this->NumberOfPoints);
+
+  if (this->NumberOfPoints == 0)
+    {
+    return;
+    }
+
+  vtkvmtkPolyDataGraphGeodesicDistanceSeedFunctor seedFunctor;
+  seedFunctor.NumberOfPoints = this->NumberOfPoints;
+  seedFunctor.Offsets = this->EdgeOffsets->GetPointer(0);
+  seedFunctor.PointIds = this->EdgePointIds->GetPointer(0);
+  seedFunctor.Lengths = this->EdgeLengths->GetPointer(0);
+  seedFunctor.SeedIds = seedIds->GetPointer(0);
+  seedFunctor.NumberOfSeeds = numberOfSeeds;
+  seedFunctor.MaximumDistance = this->MaximumDistance;
+  seedFunctor.Distances = distances->GetPointer(0);
+  vtkSMPTools::For(0,numberOfSeeds,1,seedFunctor);
+}
+
+void vtkvmtkPolyDataGraphGeodesicDistance::PrintSelf(std::ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "NumberOfPoints: " << this->NumberOfPoints << "\n";
+  os << indent << "NumberOfEdgePointIds: " << this->EdgePointIds->GetNumberOfValues() << "\n";
+  os << indent << "MaximumDistance: " << this->MaximumDistance << "\n";
+}
@@ -0,0 +1,119 @@
+/*=========================================================================
+
+Program:   VMTK
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENSE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/**
+ * @class   vtkvmtkPolyDataGraphGeodesicDistance
+ * @brief   Shortest path distances along the edges of a poly data, from one or many seeds.
+ * @ingroup ComputationalGeometry
+ *
+ * Stores the edge graph of a vtkPolyData in compressed sparse row (CSR) form: for every point, the ids of the points it shares a cell edge with and the lengths of those edges. The entries of point i are ids[offsets[i]] to ids[offsets[i+1]-1]. Edges are the sides of polygons, triangles and quads, the segments of lines and polylines, and the sides of the triangles of strips. On meshes of polygons and triangles, the graph and the distances are the same as those of vtkDijkstraGraphGeodesicPath; on strips, polylines and pixels they differ, since vtkDijkstraGraphGeodesicPath joins consecutive cell points (closing polylines, and missing the diagonals of strips and following the zigzag point order of pixels).
+ *
+ * Once built, the graph is kept until Build is called for a different poly data, or for the same poly data after it has been modified, so that distances from different seed sets on the same surface are computed without building the graph again. Distances are computed with Dijkstra's algorithm:
+ *    - ComputeDistances runs a single sweep from all seeds at once, giving the distance of every point to its closest seed (and, optionally, the index of that seed);
+ *    - ComputeSeedDistances runs one sweep per seed, in parallel over the seeds, giving the distance of every point to every seed.
+ *
+ * Sweeps stop at MaximumDistance: points farther than that from the seeds are given a distance of VTK_VMTK_LARGE_DOUBLE.
+ *
+ * @sa
+ * vtkvmtkPolyDataAdjacency, vtkvmtkPolyDataDijkstraDistanceToPoints, vtkvmtkPolyDataGeodesicRBFInterpolation
+ */
+
+#ifndef __vtkvmtkPolyDataGraphGeodesicDistance_h
+#define __vtkvmtkPolyDataGraphGeodesicDistance_h
+
+#include "vtkObject.h"
+#include "vtkTimeStamp.h"
+#include "vtkIdTypeArray.h"
+#include "vtkDoubleArray.h"
+//#include "vtkvmtkComputationalGeometryWin32Header.h"
+#include "vtkvmtkWin32Header.h"
+
+class vtkIdList;
+class vtkPolyData;
+
+class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataGraphGeodesicDistance : public vtkObject
+{
+  public:
+  vtkTypeMacro(vtkvmtkPolyDataGraphGeodesicDistance,vtkObject);
+  void PrintSelf(std::ostream& os, vtkIndent indent) override;
+
+  static vtkvmtkPolyDataGraphGeodesicDistance *New();
+
+  /**
+   * Builds the edge graph of input, unless it is already built for it (see IsBuiltFor).
+   */
+  void Build(vtkPolyData* input);
+
+  /**
+   * Releases the graph.
+   */
+  void Initialize();
+
+  /**
+   * Returns 1 if the graph has been built for input and input has not been modified since, 0 otherwise.
+   */
+  int IsBuiltFor(vtkPolyData* input);
+
+  vtkGetMacro(NumberOfPoints,vtkIdType);
+
+  ///@{
+  /**
+   * Set/Get the distance at which sweeps stop. Default: VTK_VMTK_LARGE_DOUBLE.
+   */
+  vtkSetMacro(MaximumDistance,double);
+  vtkGetMacro(MaximumDistance,double);
+  ///@}
+
+  /**
+   * Fills distances (one component, one tuple per point) with the distance of every point to the closest of seedIds, in a single sweep. If closestSeeds is not NULL, it is filled with the index in seedIds of the closest seed of every point, or -1 for points not reached.
+   */
+  void ComputeDistances(vtkIdList* seedIds, vtkDoubleArray* distances, vtkIdTypeArray* closestSeeds=NULL);
+
+  /**
+   * Fills distances (one component per seed, one tuple per point) with the distance of every point to every seed of seedIds. The sweeps from different seeds run in parallel.
+   */
+  void ComputeSeedDistances(vtkIdList* seedIds, vtkDoubleArray* distances);
+
+  ///@{
+  /**
+   * Get the CSR arrays. The offset array has one more entry than the number of points.
+   */
+  vtkGetObjectMacro(EdgeOffsets,vtkIdTypeArray);
+  vtkGetObjectMacro(EdgePointIds,vtkIdTypeArray);
+  vtkGetObjectMacro(EdgeLengths,vtkDoubleArray);
+  ///@}
+
+  protected:
+  vtkvmtkPolyDataGraphGeodesicDistance();
+  ~vtkvmtkPolyDataGraphGeodesicDistance();
+
+  vtkIdTypeArray* EdgeOffsets;
+  vtkIdTypeArray* EdgePointIds;
+  vtkDoubleArray* EdgeLengths;
+
+  vtkIdType NumberOfPoints;
+  double MaximumDistance;
+
+  vtkPolyData* BuiltInput;
+  vtkTimeStamp BuildTime;
+  int Built;
+
+  private:
+  vtkvmtkPolyDataGraphGeodesicDistance(const vtkvmtkPolyDataGraphGeodesicDistance&);  // Not implemented.
+  void operator=(const vtkvmtkPolyDataGraphGeodesicDistance&);  // Not implemented.
+};
+
+#endif
@@ -27,6 +27,10 @@ Version:   $Revision: 1.5 $
 #include "vtkCell.h"
 #include "vtkMath.h"
 #include "vtkDoubleArray.h"
+#include "vtkIntArray.h"
+#include "vtkPoints.h"
+#include "vtkSMPTools.h"
+#include "vtkTimeStamp.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
@@ -34,9 +38,163 @@ Version:   $Revision: 1.5 $
 
 #include "vtkvmtkConstants.h"
 
+#include <algorithm>
+#include <vector>
+
 
 vtkStandardNewMacro(vtkvmtkPolyDataLocalGeometry);
 
+class vtkvmtkPolyDataLocalGeometryInternals
+{
+public:
+  vtkvmtkPolyDataLocalGeometryInternals()
+    {
+    this->PoleInput = NULL;
+    this->PoleVoronoiDiagram = NULL;
+    this->PoleVectorsBuilt = 0;
+    this->NumberOfInvalidPoles = 0;
+    this->BoundaryInput = NULL;
+    this->BoundaryVectorsBuilt = 0;
+    }
+
+  // vectors from the surface points to their poles, with the input, Voronoi diagram and pole ids
+  // they were gathered for (the inputs are not referenced, a different object allocated at the
+  // same address is caught by its modification time, later than the gather time)
+  vtkPolyData* PoleInput;
+  vtkPolyData* PoleVoronoiDiagram;
+  std::vector<vtkIdType> PoleIds;
+  vtkTimeStamp PoleTime;
+  int PoleVectorsBuilt;
+  std::vector<double> PoleVectors;
+  vtkIdType NumberOfInvalidPoles;
+
+  // boundary points of the input, and vectors from them to the barycenter of their boundary
+  vtkPolyData* BoundaryInput;
+  vtkTimeStamp BoundaryTime;
+  int BoundaryVectorsBuilt;
+  std::vector<vtkIdType> BoundaryPointIds;
+  std::vector<double> BoundaryVectors;
+};
+
+class vtkvmtkPolyDataLocalGeometryPoleVectorsFunctor
+{
+public:
+  vtkPoints* SurfacePoints;
+  vtkPoints* VoronoiPoints;
+  const vtkIdType* PoleIds;
+  double* PoleVectors;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    double surfacePoint[3], polePoint[3];
+    vtkIdType numberOfVoronoiPoints = this->VoronoiPoints->GetNumberOfPoints();
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      double* poleVector = this->PoleVectors + 3*i;
+      vtkIdType poleId = this->PoleIds[i];
+      if (poleId < 0 || poleId >= numberOfVoronoiPoints)
+        {
+        poleVector[0] = poleVector[1] = poleVector[2] = 0.0;
+        continue;
+        }
+      this->SurfacePoints->GetPoint(i,surfacePoint);
+      this->VoronoiPoints->GetPoint(poleId,polePoint);
+      poleVector[0] = polePoint[0] - surfacePoint[0];
+      poleVector[1] = polePoint[1] - surfacePoint[1];
+      poleVector[2] = polePoint[2] - surfacePoint[2];
+      }
+    }
+};
+
+// Evaluates the requested quantities at every surface point from its pole vector and the Voronoi
+// diagram arrays at its pole. Output pointers of quantities not requested are NULL.
+class vtkvmtkPolyDataLocalGeometryFunctor
+{
+public:
+  const vtkIdType* PoleIds;
+  const double* PoleVectors;
+  vtkIdType NumberOfVoronoiPoints;
+
+  vtkDataArray* VoronoiGeodesicDistanceArray;
+  vtkDataArray* VoronoiPoleVectorsArray;
+  vtkDataArray* VoronoiCellIdsArray;
+  vtkDataArray* VoronoiPCoordsArray;
+
+  double* PoleVectorsOutput;
+  double* GeodesicDistances;
+  double* NormalizedTangencyDeviations;
+  double* EuclideanDistances;
+  double* CenterlineVectors;
+  int* CellIds;
+  double* PCoords;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    double voronoiPoleVector[3], centerlineVector[3];
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      vtkIdType poleId = this->PoleIds[i];
+      if (poleId < 0 || poleId >= this->NumberOfVoronoiPoints)
+        {
+        continue;
+        }
+
+      const double* poleVector = this->PoleVectors + 3*i;
+
+      if (this->PoleVectorsOutput)
+        {
+        this->PoleVectorsOutput[3*i] = poleVector[0];
+        this->PoleVectorsOutput[3*i+1] = poleVector[1];
+        this->PoleVectorsOutput[3*i+2] = poleVector[2];
+        }
+
+      if (this->GeodesicDistances || this->NormalizedTangencyDeviations)
+        {
+        double voronoiRadius = vtkMath::Norm(poleVector);
+        double voronoiGeodesicDistance = this->VoronoiGeodesicDistanceArray->GetComponent(poleId,0);
+        double geodesicDistance = voronoiGeodesicDistance + voronoiRadius;
+        if (this->GeodesicDistances)
+          {
+          this->GeodesicDistances[i] = geodesicDistance;
+          }
+        if (this->NormalizedTangencyDeviations)
+          {
+          this->NormalizedTangencyDeviations[i] = geodesicDistance > VTK_VMTK_DOUBLE_TOL ? voronoiGeodesicDistance / geodesicDistance : 1.0;
+          }
+        }
+
+      if (this->EuclideanDistances || this->CenterlineVectors)
+        {
+        this->VoronoiPoleVectorsArray->GetTuple(poleId,voronoiPoleVector);
+        centerlineVector[0] = poleVector[0] + voronoiPoleVector[0];
+        centerlineVector[1] = poleVector[1] + voronoiPoleVector[1];
+        centerlineVector[2] = poleVector[2] + voronoiPoleVector[2];
+        if (this->EuclideanDistances)
+          {
+          this->EuclideanDistances[i] = vtkMath::Norm(centerlineVector);
+          }
+        if (this->CenterlineVectors)
+          {
+          this->CenterlineVectors[3*i] = centerlineVector[0];
+          this->CenterlineVectors[3*i+1] = centerlineVector[1];
+          this->CenterlineVectors[3*i+2] = centerlineVector[2];
+          }
+        }
+
+      if (this->CellIds)
+        {
+        this->CellIds[2*i] = static_cast<int>(this->VoronoiCellIdsArray->GetComponent(poleId,0));
+        this->CellIds[2*i+1] = static_cast<int>(this->VoronoiCellIdsArray->GetComponent(poleId,1));
+        }
+
+      if (this->PCoords)
+        {
+        this->PCoords[i] = this->VoronoiPCoordsArray->GetComponent(poleId,0);
+        }
+      }
+    }
+};
+
 vtkvmtkPolyDataLocalGeometry::vtkvmtkPolyDataLocalGeometry()
 {
   this->ComputePoleVectors = 0;
@@ -63,6 +221,8 @@ vtkvmtkPolyDataLocalGeometry::vtkvmtkPolyDataLocalGeometry()
   this->VoronoiPCoordsArrayName = NULL;
   this->VoronoiDiagram = NULL;
   this->PoleIds = NULL;
+
+  this->Internals = new vtkvmtkPolyDataLocalGeometryInternals;
 }
 
 vtkvmtkPolyDataLocalGeometry::~vtkvmtkPolyDataLocalGeometry()
@@ -113,6 +273,50 @@ vtkvmtkPolyDataLocalGeometry::~vtkvmtkPolyDataLocalGeometry()
     {
     delete[] this->PCoordsArrayName;
     }
+
+  delete this->Internals;
+}
+
+void vtkvmtkPolyDataLocalGeometry::BuildPoleVectors(vtkPolyData* input)
+{
+  vtkvmtkPolyDataLocalGeometryInternals* internals = this->Internals;
+  vtkIdType numberOfPoints = input->GetNumberOfPoints();
+  const vtkIdType* poleIds = this->PoleIds->GetPointer(0);
+
+  if (internals->PoleVectorsBuilt && internals->PoleInput == input && internals->PoleVoronoiDiagram == this->VoronoiDiagram &&
+      input->GetMTime() <= internals->PoleTime.GetMTime() && this->VoronoiDiagram->GetMTime() <= internals->PoleTime.GetMTime() &&
+      static_cast<vtkIdType>(internals->PoleIds.size()) == numberOfPoints && std::equal(internals->PoleIds.begin(),internals->PoleIds.end(),poleIds))
+    {
+    return;
+    }
+
+  internals->PoleIds.assign(poleIds,poleIds+numberOfPoints);
+  internals->PoleVectors.resize(3*numberOfPoints);
+
+  vtkIdType numberOfVoronoiPoints = this->VoronoiDiagram->GetNumberOfPoints();
+  internals->NumberOfInvalidPoles = 0;
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    if (poleIds[i] < 0 || poleIds[i] >= numberOfVoronoiPoints)
+      {
+      internals->NumberOfInvalidPoles++;
+      }
+    }
+
+  if (numberOfPoints > 0)
+    {
+    vtkvmtkPolyDataLocalGeometryPoleVectorsFunctor poleVectorsFunctor;
+    poleVectorsFunctor.SurfacePoints = input->GetPoints();
+    poleVectorsFunctor.VoronoiPoints = this->VoronoiDiagram->GetPoints();
+    poleVectorsFunctor.PoleIds = &internals->PoleIds[0];
+    poleVectorsFunctor.PoleVectors = &internals->PoleVectors[0];
+    vtkSMPTools::For(0,numberOfPoints,poleVectorsFunctor);
+    }
+
+  internals->PoleInput = input;
+  internals->PoleVoronoiDiagram = this->VoronoiDiagram;
+  internals->PoleVectorsBuilt = 1;
+  internals->PoleTime.Modified();
 }
 
 int vtkvmtkPolyDataLocalGeometry::RequestData(
@@ -128,11 +332,6 @@ int vtkvmtkPolyDataLocalGeometry::RequestData(
   vtkPolyData *output = vtkPolyData::SafeDownCast(
     outInfo->Get(vtkDataObject::DATA_OBJECT()));
 
-  vtkIdType i, poleId;
-  double surfacePoint[3], polePoint[3], poleVector[3], voronoiPoleVector[3], centerlinePoint[3], centerlineVector[3];
-  double voronoiRadius, voronoiGeodesicDistance;
-  double geodesicDistance, normalizedTangencyDeviation;
-  double euclideanDistance;
   vtkDataArray* voronoiGeodesicDistanceArray = NULL;
   vtkDataArray* voronoiPoleVectorsArray = NULL;
   vtkDataArray* voronoiCellIdsArray = NULL;
@@ -157,6 +356,12 @@ int vtkvmtkPolyDataLocalGeometry::RequestData(
     return 1;
     }
 
+  if (this->PoleIds->GetNumberOfIds() < input->GetNumberOfPoints())
+    {
+    vtkErrorMacro(<< "Fewer poleIds than input points!");
+    return 1;
+    }
+
   if (this->ComputeGeodesicDistance || this->ComputeNormalizedTangencyDeviation)
     {
     if (!this->VoronoiGeodesicDistanceArrayName)
@@ -342,85 +547,32 @@ int vtkvmtkPolyDataLocalGeometry::RequestData(
     pcoordsArray->FillComponent(0,0.0);
     }
 
-  for (i=0; i<input->GetNumberOfPoints(); i++)
-    {
-    poleId = this->PoleIds->GetId(i);
-
-    if (poleId == -1)
-      {
-      vtkWarningMacro(<<"Invalid PoleId found");
-      }
+  this->BuildPoleVectors(input);
 
-    if (this->ComputePoleVectors)
-      {
-      input->GetPoint(i,surfacePoint);
-      this->VoronoiDiagram->GetPoint(poleId,polePoint);
-      poleVector[0] = polePoint[0] - surfacePoint[0];
-      poleVector[1] = polePoint[1] - surfacePoint[1];
-      poleVector[2] = polePoint[2] - surfacePoint[2];
-      poleVectorsArray->SetTuple(i,poleVector);
-      }
-
-    if (this->ComputeGeodesicDistance || this->ComputeNormalizedTangencyDeviation)
-      {
-      input->GetPoint(i,surfacePoint);
-      this->VoronoiDiagram->GetPoint(poleId,polePoint);
-
-      voronoiRadius = sqrt(vtkMath::Distance2BetweenPoints(surfacePoint,polePoint));
-      voronoiGeodesicDistance = voronoiGeodesicDistanceArray->GetTuple1(poleId);
-
-      geodesicDistance = voronoiGeodesicDistance + voronoiRadius;
-      if (geodesicDistance > VTK_VMTK_DOUBLE_TOL)
-        {
-        normalizedTangencyDeviation = voronoiGeodesicDistance / geodesicDistance;
-        }
-      else
-        {
-        normalizedTangencyDeviation = 1.0;
-        }
-
-      if (this->ComputeGeodesicDistance)
-        {
-        geodesicDistanceArray->SetComponent(i,0,geodesicDistance);
-        }
-
-      if (this->ComputeNormalizedTangencyDeviation)
-        {
-        normalizedTangencyDeviationArray->SetComponent(i,0,normalizedTangencyDeviation);
-        }
-      }
-    
-    if (this->ComputeEuclideanDistance || this->ComputeCenterlineVectors)
-      {
-      input->GetPoint(i,surfacePoint);
-      this->VoronoiDiagram->GetPoint(poleId,polePoint);
-      voronoiPoleVectorsArray->GetTuple(poleId,voronoiPoleVector);
-      centerlinePoint[0] = polePoint[0] + voronoiPoleVector[0];
-      centerlinePoint[1] = polePoint[1] + voronoiPoleVector[1];
-      centerlinePoint[2] = polePoint[2] + voronoiPoleVector[2];
-      centerlineVector[0] = centerlinePoint[0] - surfacePoint[0];
-      centerlineVector[1] = centerlinePoint[1] - surfacePoint[1];
-      centerlineVector[2] = centerlinePoint[2] - surfacePoint[2];
-      if (this->ComputeEuclideanDistance)
-        {
-        euclideanDistance = sqrt(vtkMath::Distance2BetweenPoints(surfacePoint,centerlinePoint));
-        euclideanDistanceArray->SetComponent(i,0,euclideanDistance);
-        }
-      if (this->ComputeCenterlineVectors)
-        {
-        centerlineVectorsArray->SetTuple(i,centerlineVector);
-        }
-      }
-
-    if (this->ComputeCellIds)
-      {
-      cellIdsArray->SetTuple(i,voronoiCellIdsArray->GetTuple(poleId));
-      }
+  if (this->Internals->NumberOfInvalidPoles > 0)
+    {
+    vtkWarningMacro(<<"Invalid PoleId found");
+    }
 
-    if (this->ComputePCoords)
-      {
-      pcoordsArray->SetTuple(i,voronoiPCoordsArray->GetTuple(poleId));
-      }
+  vtkIdType numberOfPoints = input->GetNumberOfPoints();
+  if (numberOfPoints > 0)
+    {
+    vtkvmtkPolyDataLocalGeometryFunctor localGeometryFunctor;
+    localGeometryFunctor.PoleIds = &this->Internals->PoleIds[0];
+    localGeometryFunctor.PoleVectors = &this->Internals->PoleVectors[0];
+    localGeometryFunctor.NumberOfVoronoiPoints = this->VoronoiDiagram->GetNumberOfPoints();
+    localGeometryFunctor.VoronoiGeodesicDistanceArray = voronoiGeodesicDistanceArray;
+    localGeometryFunctor.VoronoiPoleVectorsArray = voronoiPoleVectorsArray;
+    localGeometryFunctor.VoronoiCellIdsArray = voronoiCellIdsArray;
+    localGeometryFunctor.VoronoiPCoordsArray = voronoiPCoordsArray;
+    localGeometryFunctor.PoleVectorsOutput = poleVectorsArray ? poleVectorsArray->GetPointer(0) : NULL;
+    localGeometryFunctor.GeodesicDistances = geodesicDistanceArray ? geodesicDistanceArray->GetPointer(0) : NULL;
+    localGeometryFunctor.NormalizedTangencyDeviations = normalizedTangencyDeviationArray ? normalizedTangencyDeviationArray->GetPointer(0) : NULL;
+    localGeometryFunctor.EuclideanDistances = euclideanDistanceArray ? euclideanDistanceArray->GetPointer(0) : NULL;
+    localGeometryFunctor.CenterlineVectors = centerlineVectorsArray ? centerlineVectorsArray->GetPointer(0) : NULL;
+    localGeometryFunctor.CellIds = cellIdsArray ? cellIdsArray->GetPointer(0) : NULL;
+    localGeometryFunctor.PCoords = pcoordsArray ? pcoordsArray->GetPointer(0) : NULL;
+    vtkSMPTools::For(0,numberOfPoints,localGeometryFunctor);
     }
 
    output->CopyStructure(input);
@@ -471,21 +623,29 @@ int vtkvmtkPolyDataLocalGeometry::RequestData(
 
   if (this->AdjustBoundaryValues)
     {
-    this->AdjustBoundaryQuantities(output);
+    this->AdjustBoundaryQuantities(input,output);
     }
 
   return 1;
 }
 
-void vtkvmtkPolyDataLocalGeometry::AdjustBoundaryQuantities(vtkPolyData* output)
+void vtkvmtkPolyDataLocalGeometry::BuildBoundaryVectors(vtkPolyData* input)
 {
-  vtkDataArray* poleVectorsArray = NULL;
-  vtkDataArray* geodesicDistanceArray = NULL;
-  vtkDataArray* euclideanDistanceArray = NULL;
-  vtkDataArray* centerlineVectorsArray = NULL;
+  vtkvmtkPolyDataLocalGeometryInternals* internals = this->Internals;
+
+  if (internals->BoundaryVectorsBuilt && internals->BoundaryInput == input && input->GetMTime() <= internals->BoundaryTime.GetMTime())
+    {
+    return;
+    }
+
+  internals->BoundaryPointIds.clear();
+  internals->BoundaryVectors.clear();
+
+  vtkPolyData* surface = vtkPolyData::New();
+  surface->CopyStructure(input);
 
   vtkTriangleFilter* triangleFilter = vtkTriangleFilter::New();
-  triangleFilter->SetInputData(output);
+  triangleFilter->SetInputData(surface);
   triangleFilter->Update();
 
   vtkvmtkPolyDataBoundaryExtractor* boundaryExtractor = vtkvmtkPolyDataBoundaryExtractor::New();
@@ -496,6 +656,53 @@ void vtkvmtkPolyDataLocalGeometry::AdjustBoundaryQuantities(vtkPolyData* output)
 
   double point[3], barycenter[3];
   int numberOfBoundaryPoints;
+  vtkIdType boundaryPointId;
+
+  int i, j;
+  for (i=0; i<boundaries->GetNumberOfCells(); i++)
+    {
+    vtkCell* boundary = boundaries->GetCell(i);
+    numberOfBoundaryPoints = boundary->GetPoints()->GetNumberOfPoints();
+    barycenter[0] = barycenter[1] = barycenter[2] = 0.0;
+    for (j=0; j<numberOfBoundaryPoints; j++)
+      {
+      boundary->GetPoints()->GetPoint(j,point);
+      barycenter[0] += point[0];
+      barycenter[1] += point[1];
+      barycenter[2] += point[2];
+      }
+    barycenter[0] /= numberOfBoundaryPoints;
+    barycenter[1] /= numberOfBoundaryPoints;
+    barycenter[2] /= numberOfBoundaryPoints;
+
+    for (j=0; j<numberOfBoundaryPoints; j++)
+      {
+      boundaryPointId = static_cast<vtkIdType>(boundaries->GetPointData()->GetScalars()->GetTuple1(boundary->GetPointId(j)));
+      input->GetPoint(boundaryPointId,point);
+      internals->BoundaryPointIds.push_back(boundaryPointId);
+      internals->BoundaryVectors.push_back(barycenter[0] - point[0]);
+      internals->BoundaryVectors.push_back(barycenter[1] - point[1]);
+      internals->BoundaryVectors.push_back(barycenter[2] - point[2]);
+      }
+    }
+
+  surface->Delete();
+  triangleFilter->Delete();
+  boundaryExtractor->Delete();
+
+  internals->BoundaryInput = input;
+  internals->BoundaryVectorsBuilt = 1;
+  internals->BoundaryTime.Modified();
+}
+
+void vtkvmtkPolyDataLocalGeometry::AdjustBoundaryQuantities(vtkPolyData* input, vtkPolyData* output)
+{
+  vtkDataArray* poleVectorsArray = NULL;
+  vtkDataArray* geodesicDistanceArray = NULL;
+  vtkDataArray* euclideanDistanceArray = NULL;
+  vtkDataArray* centerlineVectorsArray = NULL;
+
+  this->BuildBoundaryVectors(input);
 
   if (this->ComputePoleVectors)
     {
@@ -520,56 +727,35 @@ void vtkvmtkPolyDataLocalGeometry::AdjustBoundaryQuantities(vtkPolyData* output)
   double radialVector[3], radialVectorModulus;
   vtkIdType boundaryPointId;
 
-  int i, j;
-  for (i=0; i<boundaries->GetNumberOfCells(); i++)
+  vtkIdType numberOfBoundaryPoints = static_cast<vtkIdType>(this->Internals->BoundaryPointIds.size());
+  for (vtkIdType j=0; j<numberOfBoundaryPoints; j++)
     {
-    vtkCell* boundary = boundaries->GetCell(i);
-    numberOfBoundaryPoints = boundary->GetPoints()->GetNumberOfPoints();
-    barycenter[0] = barycenter[1] = barycenter[2] = 0.0;
-    for (j=0; j<numberOfBoundaryPoints; j++)
+    boundaryPointId = this->Internals->BoundaryPointIds[j];
+    radialVector[0] = this->Internals->BoundaryVectors[3*j];
+    radialVector[1] = this->Internals->BoundaryVectors[3*j+1];
+    radialVector[2] = this->Internals->BoundaryVectors[3*j+2];
+    radialVectorModulus = vtkMath::Norm(radialVector);
+
+    if (this->ComputePoleVectors)
       {
-      boundary->GetPoints()->GetPoint(j,point);
-      barycenter[0] += point[0];
-      barycenter[1] += point[1];
-      barycenter[2] += point[2];
+      poleVectorsArray->SetTuple(boundaryPointId,radialVector);
       }
-    barycenter[0] /= numberOfBoundaryPoints;
-    barycenter[1] /= numberOfBoundaryPoints;
-    barycenter[2] /= numberOfBoundaryPoints;
-
-    for (j=0; j<numberOfBoundaryPoints; j++)
+    
+    if (this->ComputeGeodesicDistance)
       {
-      boundaryPointId = static_cast<vtkIdType>(boundaries->GetPointData()->GetScalars()->GetTuple1(boundary->GetPointId(j)));
-      output->GetPoint(boundaryPointId,point);
-      radialVector[0] = barycenter[0] - point[0];
-      radialVector[1] = barycenter[1] - point[1];
-      radialVector[2] = barycenter[2] - point[2];
-      radialVectorModulus = vtkMath::Norm(radialVector);
-
-      if (this->ComputePoleVectors)
-        {
-        poleVectorsArray->SetTuple(boundaryPointId,radialVector);
-        }
-      
-      if (this->ComputeGeodesicDistance)
-        {
-        geodesicDistanceArray->SetTuple1(boundaryPointId,radialVectorModulus);
-        }
-      
-      if (this->ComputeEuclideanDistance)
-        {
-        euclideanDistanceArray->SetTuple1(boundaryPointId,radialVectorModulus);
-        }
-      
-      if (this->ComputeCenterlineVectors)
-        {
-        centerlineVectorsArray->SetTuple(boundaryPointId,radialVector);
-        }
+      geodesicDistanceArray->SetTuple1(boundaryPointId,radialVectorModulus);
+      }
+    
+    if (this->ComputeEuclideanDistance)
+      {
+      euclideanDistanceArray->SetTuple1(boundaryPointId,radialVectorModulus);
+      }
+    
+    if (this->ComputeCenterlineVectors)
+      {
+      centerlineVectorsArray->SetTuple(boundaryPointId,radialVector);
       }
     }
-
-  triangleFilter->Delete();
-  boundaryExtractor->Delete();
 }
 
 void vtkvmtkPolyDataLocalGeometry::PrintSelf(std::ostream& os, vtkIndent indent)
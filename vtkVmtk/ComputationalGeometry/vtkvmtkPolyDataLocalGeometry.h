@@ -31,6 +31,8 @@ Program:   VMTK
  *
  * The description given here is particularly suited for the description of tubular surfaces in terms of centerlines, but this class can be used without this assumption. Whenever a geodesic distance field is computed over the Voronoi diagram associated with a shape from a subset of the Voronoi diagram itself (in this context, the centerlines), the surface geodesic distance field and the normalized tangency deviation can be defined, and this class can be used to compute them.
  *
+ * Quantities are evaluated in parallel over the surface points. The surface-to-pole vectors, and the boundary points and radial vectors used by AdjustBoundaryValues, are kept between executions as long as the input, the Voronoi diagram and the pole ids do not change, so that turning on a different output array does not gather them again.
+ *
  *
  * @sa
  * vtkNonManifoldFastMarching vtkVoronoiDiagram3D
@@ -45,6 +47,8 @@ Program:   VMTK
 //#include "vtkvmtkComputationalGeometryWin32Header.h"
 #include "vtkvmtkWin32Header.h"
 
+class vtkvmtkPolyDataLocalGeometryInternals;
+
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataLocalGeometry : public vtkPolyDataAlgorithm
 {
   public: 
@@ -270,7 +274,9 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataLocalGeometry : publ
 
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
 
-  void AdjustBoundaryQuantities(vtkPolyData* output);
+  void BuildPoleVectors(vtkPolyData* input);
+  void BuildBoundaryVectors(vtkPolyData* input);
+  void AdjustBoundaryQuantities(vtkPolyData* input, vtkPolyData* output);
 
   int ComputePoleVectors;
   int ComputeGeodesicDistance;
@@ -297,6 +303,8 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataLocalGeometry : publ
   vtkPolyData* VoronoiDiagram;
   vtkIdList* PoleIds;
 
+  vtkvmtkPolyDataLocalGeometryInternals* Internals;
+
   private:
   vtkvmtkPolyDataLocalGeometry(const vtkvmtkPolyDataLocalGeometry&);  // Not implemented.
   void operator=(const vtkvmtkPolyDataLocalGeometry&);  // Not implemented.
@@ -29,11 +29,52 @@ Version:   $Revision: 1.4 $
 #include "vtkObjectFactory.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
 #include "vtkvmtkConstants.h"
+#include "vtkvmtkPolyDataAdjacency.h"
+
+#include <vector>
 
 
 vtkStandardNewMacro(vtkvmtkSteepestDescentLineTracer);
 
+// Path traced from one seed in ParallelTracing mode, with point ids local to the path.
+class vtkvmtkSteepestDescentLineTracerPath
+{
+public:
+  vtkSmartPointer<vtkPoints> Points;
+  vtkSmartPointer<vtkDoubleArray> Scalars;
+  vtkSmartPointer<vtkIntArray> Edges;
+  vtkSmartPointer<vtkDoubleArray> EdgeParCoords;
+  vtkSmartPointer<vtkIdList> LineIds;
+  vtkIdType HitTargetId;
+  int Status;
+};
+
+class vtkvmtkSteepestDescentLineTracerFunctor
+{
+public:
+  vtkvmtkSteepestDescentLineTracer* Tracer;
+  vtkPolyData* Input;
+  std::vector<vtkvmtkSteepestDescentLineTracerPath>* Paths;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      vtkvmtkSteepestDescentLineTracerPath& path = (*this->Paths)[i];
+      path.Points = vtkSmartPointer<vtkPoints>::New();
+      path.Scalars = vtkSmartPointer<vtkDoubleArray>::New();
+      path.Edges = vtkSmartPointer<vtkIntArray>::New();
+      path.Edges->SetNumberOfComponents(2);
+      path.EdgeParCoords = vtkSmartPointer<vtkDoubleArray>::New();
+      path.LineIds = vtkSmartPointer<vtkIdList>::New();
+      path.Status = this->Tracer->Backtrace(this->Input,this->Tracer->Seeds->GetId(i),path.Points,path.Scalars,path.Edges,path.EdgeParCoords,path.LineIds,path.HitTargetId);
+      }
+    }
+};
+
 vtkvmtkSteepestDescentLineTracer::vtkvmtkSteepestDescentLineTracer()
 {
   this->Seeds = NULL;
@@ -48,6 +89,8 @@ vtkvmtkSteepestDescentLineTracer::vtkvmtkSteepestDescentLineTracer()
 
   this->LineDataArray = NULL;
 
+  this->ParallelTracing = 0;
+
   this->HitTargets = vtkIdList::New();
 }
 
@@ -93,7 +136,7 @@ vtkvmtkSteepestDescentLineTracer::~vtkvmtkSteepestDescentLineTracer()
 
 }
 
-void vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType seedId)
+int vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType seedId, vtkPoints* newPoints, vtkDataArray* newScalars, vtkIntArray* edges, vtkDoubleArray* edgeParCoords, vtkIdList* lineIds, vtkIdType& hitTargetId)
 {
   bool done;
   double startingPoint[3], endingPoint[3], currentPoint[3], currentScalar;
@@ -104,20 +147,11 @@ void vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType s
   double previousS, previousS2;
   double previousPoint[3];
   double directionFactor;
-  vtkIdList* neighborCells;
   vtkIdType pointId, j, targetId;
-  vtkIdList* lineIds;
-
-  vtkPoints* newPoints;
-  vtkDataArray* newScalars;
-  vtkCellArray* newLines;
-
-  newPoints = this->GetOutput()->GetPoints();
-  newScalars = this->GetOutput()->GetPointData()->GetArray(this->DataArrayName);
-  newLines = this->GetOutput()->GetLines();
+  int status;
 
-  neighborCells = vtkIdList::New();
-  lineIds = vtkIdList::New();
+  status = VTK_VMTK_BACKTRACE_OK;
+  hitTargetId = -1;
 
   directionFactor = 0.0;
   if (this->Direction==VTK_VMTK_DOWNWARD)
@@ -139,8 +173,8 @@ void vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType s
 
   pointId = newPoints->InsertNextPoint(startingPoint);          
 
-  currentScalar = this->DescentArray->GetTuple1(seedId);
-  currentRadius = this->LineDataArray->GetTuple1(seedId);
+  currentScalar = this->DescentArray->GetComponent(seedId,0);
+  currentRadius = this->LineDataArray->GetComponent(seedId,0);
   lineIds->InsertNextId(pointId);       
 
   currentEdge[0] = seedId;
@@ -151,9 +185,9 @@ void vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType s
   previousS2 = 0.0;
 
   newScalars->InsertComponent(pointId,0,currentRadius);
-  this->Edges->InsertComponent(pointId,0,currentEdge[0]);
-  this->Edges->InsertComponent(pointId,1,currentEdge[1]);
-  this->EdgeParCoords->InsertValue(pointId,currentS);
+  edges->InsertComponent(pointId,0,currentEdge[0]);
+  edges->InsertComponent(pointId,1,currentEdge[1]);
+  edgeParCoords->InsertValue(pointId,currentS);
 
   std::size_t numIterations = 0;
 
@@ -180,8 +214,8 @@ void vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType s
       if (vtkMath::Distance2BetweenPoints(currentPoint,endingPoint) > VTK_VMTK_DOUBLE_TOL)
         {
         pointId = newPoints->InsertNextPoint(endingPoint);
-        currentScalar = this->DescentArray->GetTuple1(targetId);
-        currentRadius = this->LineDataArray->GetTuple1(targetId);
+        currentScalar = this->DescentArray->GetComponent(targetId,0);
+        currentRadius = this->LineDataArray->GetComponent(targetId,0);
         lineIds->InsertNextId(pointId);
       
         currentEdge[0] = targetId;
@@ -189,12 +223,12 @@ void vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType s
         currentS = 0.0;
       
         newScalars->InsertTuple1(pointId,currentRadius);
-        this->Edges->InsertComponent(pointId,0,currentEdge[0]);
-        this->Edges->InsertComponent(pointId,1,currentEdge[1]);
-        this->EdgeParCoords->InsertValue(pointId,currentS);
+        edges->InsertComponent(pointId,0,currentEdge[0]);
+        edges->InsertComponent(pointId,1,currentEdge[1]);
+        edgeParCoords->InsertValue(pointId,currentS);
         }
 
-      this->HitTargets->InsertNextId(targetId);
+      hitTargetId = targetId;
 
       done = true;
       break;
@@ -204,13 +238,11 @@ void vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType s
       break;
       }
 
-    input->GetCellEdgeNeighbors(-1,currentEdge[0],currentEdge[1],neighborCells);
-
     steepestDescent = this->GetSteepestDescent(input,currentEdge,currentS,steepestDescentEdge,steepestDescentS);
 
     if (steepestDescentEdge[0] == -1 || steepestDescentEdge[1] == -1)
       {
-      vtkWarningMacro(<<"Can't find a steepest descent edge. Target not reached.");
+      status = VTK_VMTK_BACKTRACE_NO_DESCENT_EDGE;
       done = true;
       break;
       }
@@ -220,7 +252,7 @@ void vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType s
       if (!this->StopOnTargets)
       //if (!this->StopOnTargets || (previousEdge[0] == currentEdge[0] && previousEdge[1] == currentEdge[1]))
         {
-        vtkWarningMacro(<<"Target not reached.");
+        status = VTK_VMTK_BACKTRACE_TARGET_NOT_REACHED;
         done = true; // these two lines were outside the if (!this->StopOnTarget), but that may lead to unnecessary failure.
         break;       // Need of better detection of stall.
         }
@@ -237,7 +269,7 @@ void vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType s
 			)
 		)
       {
-      vtkWarningMacro(<<"Degenerate descent detected. Target not reached.");
+      status = VTK_VMTK_BACKTRACE_DEGENERATE_DESCENT;
       done = true;
       break;
       }
@@ -258,15 +290,15 @@ void vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType s
     currentPoint[2] = edgePoint0[2] * (1.0 - currentS) + edgePoint1[2] * currentS;
     }
                 
-    currentScalar = this->DescentArray->GetTuple1(currentEdge[0]) * (1.0 - currentS) + this->DescentArray->GetTuple1(currentEdge[1]) * currentS;
-    currentRadius = this->LineDataArray->GetTuple1(currentEdge[0]) * (1.0 - currentS) + this->LineDataArray->GetTuple1(currentEdge[1]) * currentS;
+    currentScalar = this->DescentArray->GetComponent(currentEdge[0],0) * (1.0 - currentS) + this->DescentArray->GetComponent(currentEdge[1],0) * currentS;
+    currentRadius = this->LineDataArray->GetComponent(currentEdge[0],0) * (1.0 - currentS) + this->LineDataArray->GetComponent(currentEdge[1],0) * currentS;
 
     if (this->MergePaths)
       {
       for (j=newPoints->GetNumberOfPoints()-1; j>=0; j--)
         {
-        if (((this->Edges->GetComponent(j,0)==currentEdge[0])&&(this->Edges->GetComponent(j,1)==currentEdge[1]))||
-            ((this->Edges->GetComponent(j,0)==currentEdge[1])&&(this->Edges->GetComponent(j,1)==currentEdge[0])))
+        if (((edges->GetComponent(j,0)==currentEdge[0])&&(edges->GetComponent(j,1)==currentEdge[1]))||
+            ((edges->GetComponent(j,0)==currentEdge[1])&&(edges->GetComponent(j,1)==currentEdge[0])))
           {
           double newPoint[3];
           newPoints->GetPoint(j,newPoint);
@@ -287,9 +319,9 @@ void vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType s
     lineIds->InsertNextId(pointId);
     
     newScalars->InsertTuple1(pointId,currentRadius);
-    this->Edges->InsertComponent(pointId,0,currentEdge[0]);
-    this->Edges->InsertComponent(pointId,1,currentEdge[1]);
-    this->EdgeParCoords->InsertValue(pointId,currentS);
+    edges->InsertComponent(pointId,0,currentEdge[0]);
+    edges->InsertComponent(pointId,1,currentEdge[1]);
+    edgeParCoords->InsertValue(pointId,currentS);
 
     previousEdge2[0] = previousEdge[0];
     previousEdge2[1] = previousEdge[1];
@@ -313,15 +345,30 @@ void vtkvmtkSteepestDescentLineTracer::Backtrace(vtkPolyData* input, vtkIdType s
     pointId = newPoints->InsertNextPoint(currentPoint);
     lineIds->InsertNextId(pointId);
     newScalars->InsertTuple1(pointId, currentRadius);
-    this->Edges->InsertComponent(pointId, 0, currentEdge[0]);
-    this->Edges->InsertComponent(pointId, 1, currentEdge[1]);
-    this->EdgeParCoords->InsertValue(pointId, currentS);
+    edges->InsertComponent(pointId, 0, currentEdge[0]);
+    edges->InsertComponent(pointId, 1, currentEdge[1]);
+    edgeParCoords->InsertValue(pointId, currentS);
     }
 
-  newLines->InsertNextCell(lineIds);
+  return status;
+}
 
-  neighborCells->Delete();
-  lineIds->Delete();
+void vtkvmtkSteepestDescentLineTracer::ReportBacktraceStatus(int status)
+{
+  switch (status)
+    {
+    case VTK_VMTK_BACKTRACE_NO_DESCENT_EDGE:
+      vtkWarningMacro(<<"Can't find a steepest descent edge. Target not reached.");
+      break;
+    case VTK_VMTK_BACKTRACE_TARGET_NOT_REACHED:
+      vtkWarningMacro(<<"Target not reached.");
+      break;
+    case VTK_VMTK_BACKTRACE_DEGENERATE_DESCENT:
+      vtkWarningMacro(<<"Degenerate descent detected. Target not reached.");
+      break;
+    default:
+      break;
+    }
 }
 
 int vtkvmtkSteepestDescentLineTracer::RequestData(
@@ -368,7 +415,7 @@ int vtkvmtkSteepestDescentLineTracer::RequestData(
 
   for (i=0; i<this->Seeds->GetNumberOfIds(); i++)
     {
-    if ((this->Seeds->GetId(i)<0) || (this->Seeds->GetId(i)>input->GetNumberOfPoints()))
+    if ((this->Seeds->GetId(i)<0) || (this->Seeds->GetId(i)>=input->GetNumberOfPoints()))
       {
       vtkErrorMacro("Seed id invalid or exceeds input number of points.");
       return 1;
@@ -379,7 +426,7 @@ int vtkvmtkSteepestDescentLineTracer::RequestData(
     {
     for (i=0; i<this->Targets->GetNumberOfIds(); i++)
       {
-      if ((this->Targets->GetId(i)<0) || (this->Targets->GetId(i) > input->GetNumberOfPoints()))
+      if ((this->Targets->GetId(i)<0) || (this->Targets->GetId(i) >= input->GetNumberOfPoints()))
         {
         vtkErrorMacro("Invalid target id.");
         return 1;
@@ -448,14 +495,78 @@ int vtkvmtkSteepestDescentLineTracer::RequestData(
   newLines->Delete();
   newScalars->Delete();
 
-  input->BuildCells();
-  input->BuildLinks();
-
   this->HitTargets->Initialize();
 
-  for (i=0; i<this->Seeds->GetNumberOfIds(); i++)
+  vtkIdType numberOfSeeds = this->Seeds->GetNumberOfIds();
+  vtkIdType hitTargetId;
+  int status;
+
+  if (this->ParallelTracing && !this->MergePaths && numberOfSeeds > 1)
     {
-    this->Backtrace(input,this->Seeds->GetId(i));
+    vtkvmtkPolyDataAdjacency* adjacency = vtkvmtkPolyDataAdjacency::New();
+    adjacency->Build(input);
+    this->Adjacency = adjacency;
+
+    std::vector<vtkvmtkSteepestDescentLineTracerPath> paths(numberOfSeeds);
+
+    vtkvmtkSteepestDescentLineTracerFunctor functor;
+    functor.Tracer = this;
+    functor.Input = input;
+    functor.Paths = &paths;
+    vtkSMPTools::For(0,numberOfSeeds,1,functor);
+
+    this->Adjacency = NULL;
+    adjacency->Delete();
+
+    // merge in seed order, so that output is the same as in the serial case
+    vtkIdList* lineIds = vtkIdList::New();
+    double point[3];
+    vtkIdType j, pointOffset;
+    for (i=0; i<numberOfSeeds; i++)
+      {
+      vtkvmtkSteepestDescentLineTracerPath& path = paths[i];
+      this->ReportBacktraceStatus(path.Status);
+      pointOffset = newPoints->GetNumberOfPoints();
+      for (j=0; j<path.Points->GetNumberOfPoints(); j++)
+        {
+        path.Points->GetPoint(j,point);
+        newPoints->InsertNextPoint(point);
+        newScalars->InsertTuple1(pointOffset+j,path.Scalars->GetValue(j));
+        this->Edges->InsertComponent(pointOffset+j,0,path.Edges->GetComponent(j,0));
+        this->Edges->InsertComponent(pointOffset+j,1,path.Edges->GetComponent(j,1));
+        this->EdgeParCoords->InsertValue(pointOffset+j,path.EdgeParCoords->GetValue(j));
+        }
+      lineIds->SetNumberOfIds(path.LineIds->GetNumberOfIds());
+      for (j=0; j<path.LineIds->GetNumberOfIds(); j++)
+        {
+        lineIds->SetId(j,pointOffset+path.LineIds->GetId(j));
+        }
+      newLines->InsertNextCell(lineIds);
+      if (path.HitTargetId != -1)
+        {
+        this->HitTargets->InsertNextId(path.HitTargetId);
+        }
+      }
+    lineIds->Delete();
+    }
+  else
+    {
+    input->BuildCells();
+    input->BuildLinks();
+
+    vtkIdList* lineIds = vtkIdList::New();
+    for (i=0; i<numberOfSeeds; i++)
+      {
+      lineIds->Initialize();
+      status = this->Backtrace(input,this->Seeds->GetId(i),newPoints,newScalars,this->Edges,this->EdgeParCoords,lineIds,hitTargetId);
+      this->ReportBacktraceStatus(status);
+      if (hitTargetId != -1)
+        {
+        this->HitTargets->InsertNextId(hitTargetId);
+        }
+      newLines->InsertNextCell(lineIds);
+      }
+    lineIds->Delete();
     }
 
   output->GetPointData()->AddArray(this->Edges);
@@ -472,4 +583,7 @@ int vtkvmtkSteepestDescentLineTracer::RequestData(
 void vtkvmtkSteepestDescentLineTracer::PrintSelf(std::ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "MergePaths: " << this->MergePaths << "\n";
+  os << indent << "ParallelTracing: " << this->ParallelTracing << "\n";
 }
@@ -32,6 +32,8 @@ Program:   VMTK
  *
  * If 1) EdgeArrayName and/or 2) EdgePCoordArrayName are provided, the output will contain 1) a 2-component vtkIntArray in which the point ids of the edges intersected by the paths are stored and 2) a 1-component vtkDoubleArray in which the parametric coordinate of the intersection is stored.
  *
+ * If ParallelTracing is on and MergePaths is off, the paths from different seeds are traced concurrently (with vtkSMPTools) and appended to the output in seed order, so that the output is identical to the one obtained by tracing serially.
+ *
  *
  * @sa
  * vtkNonManifoldFastMarching vtkVoronoiDiagram3D
@@ -47,6 +49,13 @@ Program:   VMTK
 //#include "vtkvmtkComputationalGeometryWin32Header.h"
 #include "vtkvmtkWin32Header.h"
 
+#define VTK_VMTK_BACKTRACE_OK 0
+#define VTK_VMTK_BACKTRACE_NO_DESCENT_EDGE 1
+#define VTK_VMTK_BACKTRACE_TARGET_NOT_REACHED 2
+#define VTK_VMTK_BACKTRACE_DEGENERATE_DESCENT 3
+
+class vtkPoints;
+
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkSteepestDescentLineTracer : public vtkvmtkNonManifoldSteepestDescent
 {
 public:
@@ -137,13 +146,30 @@ public:
   vtkGetMacro(MergeTolerance,double);
   ///@}
 
+  ///@{
+  /**
+   * Turn on/off tracing the paths from different seeds in parallel. Ignored if MergePaths is on, since
+   * merging makes each path depend on the previous ones. Default: off.
+   */
+  vtkSetMacro(ParallelTracing,int);
+  vtkGetMacro(ParallelTracing,int);
+  vtkBooleanMacro(ParallelTracing,int);
+  ///@}
+
 protected:
   vtkvmtkSteepestDescentLineTracer();
   ~vtkvmtkSteepestDescentLineTracer();
 
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
 
-  void Backtrace(vtkPolyData* input, vtkIdType seedId);
+  /**
+   * Trace the path from seedId, appending its points to newPoints, newScalars, edges and edgeParCoords and
+   * their ids to lineIds. hitTargetId is set to the target reached, or -1. Returns one of the
+   * VTK_VMTK_BACKTRACE_* status codes. Only reads the filter state, so that different seeds can be traced
+   * concurrently into different containers when MergePaths is off.
+   */
+  int Backtrace(vtkPolyData* input, vtkIdType seedId, vtkPoints* newPoints, vtkDataArray* newScalars, vtkIntArray* edges, vtkDoubleArray* edgeParCoords, vtkIdList* lineIds, vtkIdType& hitTargetId);
+  void ReportBacktraceStatus(int status);
 
   vtkIdList* Seeds;
   vtkIdList* Targets;
@@ -161,6 +187,8 @@ protected:
   int MergePaths;
   double MergeTolerance;
 
+  int ParallelTracing;
+
   vtkIntArray* Edges;
   vtkDoubleArray* EdgeParCoords;
 
@@ -178,6 +206,8 @@ protected:
   vtkIntArray* ExistingPathsEdges;
   vtkDoubleArray* ExistingPathsEdgeParCoords;
 
+  friend class vtkvmtkSteepestDescentLineTracerFunctor;
+
   private:
   vtkvmtkSteepestDescentLineTracer(const vtkvmtkSteepestDescentLineTracer&);  // Not implemented.
   void operator=(const vtkvmtkSteepestDescentLineTracer&);  // Not implemented.
@@ -210,11 +210,13 @@ int vtkvmtkUnstructuredGridCenterlineGroupsClipper::RequestData(
   groupTubes->SetInput(this->Centerlines);
   groupTubes->SetPolyBallRadiusArrayName(this->CenterlineRadiusArrayName);
   groupTubes->SetUseRadiusInformation(this->UseRadiusInformation);
+  groupTubes->UseSpatialIndexOn();
 
   vtkvmtkPolyBallLine* nonGroupTubes = vtkvmtkPolyBallLine::New();
   nonGroupTubes->SetInput(this->Centerlines);
   nonGroupTubes->SetPolyBallRadiusArrayName(this->CenterlineRadiusArrayName);
   nonGroupTubes->SetUseRadiusInformation(this->UseRadiusInformation);
+  nonGroupTubes->UseSpatialIndexOn();
 
   int numberOfPoints = input->GetNumberOfPoints();
 
@@ -234,7 +236,9 @@ int vtkvmtkUnstructuredGridCenterlineGroupsClipper::RequestData(
   vtkIdList* groupTubesGroupIds = vtkIdList::New();
   vtkIdList* nonGroupTubesGroupIds = vtkIdList::New();
 
-  double point[3];
+  vtkDoubleArray* groupTubeValues = vtkDoubleArray::New();
+  vtkDoubleArray* nonGroupTubeValues = vtkDoubleArray::New();
+
   double groupTubeValue, nonGroupTubeValue, tubeDifferenceValue;
 
   vtkIdType groupId;
@@ -289,15 +293,20 @@ int vtkvmtkUnstructuredGridCenterlineGroupsClipper::RequestData(
     groupTubes->SetInputCellIds(groupTubesGroupIds);
     nonGroupTubes->SetInputCellIds(nonGroupTubesGroupIds);
 
+    if (numberOfPoints > 0)
+      {
+      groupTubes->EvaluateFunction(input->GetPoints()->GetData(),groupTubeValues);
+      nonGroupTubes->EvaluateFunction(input->GetPoints()->GetData(),nonGroupTubeValues);
+      }
+
     for (int k=0; k<numberOfPoints; k++)
       {
-      input->GetPoint(k,point);
-      groupTubeValue = groupTubes->EvaluateFunction(point);
+      groupTubeValue = groupTubeValues->GetValue(k);
       if (groupTubeValue > this->CutoffRadiusFactor * this->CutoffRadiusFactor - 1)
         {
         groupTubeValue = VTK_VMTK_LARGE_DOUBLE;
         }
-      nonGroupTubeValue = nonGroupTubes->EvaluateFunction(point);
+      nonGroupTubeValue = nonGroupTubeValues->GetValue(k);
       tubeDifferenceValue = nonGroupTubeValue - groupTubeValue;
       clippingArray->SetValue(k,tubeDifferenceValue);
       }
@@ -350,6 +359,8 @@ int vtkvmtkUnstructuredGridCenterlineGroupsClipper::RequestData(
     }
 
   clippingArray->Delete();
+  groupTubeValues->Delete();
+  nonGroupTubeValues->Delete();
   clippingInput->Delete();
   appendBranches->Delete();
   groupTubes->Delete();
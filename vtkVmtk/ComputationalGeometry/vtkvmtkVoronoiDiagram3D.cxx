@@ -21,24 +21,379 @@ Version:   $Revision: 1.5 $
 
 #include "vtkvmtkVoronoiDiagram3D.h"
 #include "vtkUnstructuredGrid.h"
-#include "vtkTetra.h"
 #include "vtkDoubleArray.h"
-#include "vtkIntArray.h"
+#include "vtkFloatArray.h"
 #include "vtkPointData.h"
 #include "vtkPolyData.h"
 #include "vtkObjectFactory.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
+#include "vtkSMPTools.h"
 #include "vtkvmtkConstants.h"
 
+#include <cmath>
+#include <vector>
+
 
 vtkStandardNewMacro(vtkvmtkVoronoiDiagram3D);
 
+// Flat copy of the tetrahedra of the input: four point ids per tetrahedron, and for every point the ids
+// of the tetrahedra using it, in increasing order as in vtkCellLinks.
+class vtkvmtkVoronoiDiagram3DTopology
+{
+public:
+  vtkIdType NumberOfPoints;
+  vtkIdType NumberOfTetras;
+  std::vector<double> Coordinates;
+  std::vector<vtkIdType> TetraPointIds;
+  std::vector<vtkIdType> PointTetraOffsets;
+  std::vector<vtkIdType> PointTetraIds;
+
+  int Build(vtkUnstructuredGrid* input)
+    {
+    vtkIdType i, j;
+    vtkIdType npts;
+    const vtkIdType *pts;
+
+    this->NumberOfPoints = input->GetNumberOfPoints();
+    this->NumberOfTetras = input->GetNumberOfCells();
+
+    this->TetraPointIds.resize(4*this->NumberOfTetras);
+    for (i=0; i<this->NumberOfTetras; i++)
+      {
+      input->GetCellPoints(i,npts,pts);
+      if (npts != 4)
+        {
+        return 0;
+        }
+      for (j=0; j<4; j++)
+        {
+        this->TetraPointIds[4*i+j] = pts[j];
+        }
+      }
+
+    this->Coordinates.resize(3*this->NumberOfPoints);
+    for (i=0; i<this->NumberOfPoints; i++)
+      {
+      input->GetPoint(i,&this->Coordinates[3*i]);
+      }
+
+    this->PointTetraOffsets.assign(this->NumberOfPoints+1,0);
+    for (i=0; i<4*this->NumberOfTetras; i++)
+      {
+      this->PointTetraOffsets[this->TetraPointIds[i]+1]++;
+      }
+    for (i=0; i<this->NumberOfPoints; i++)
+      {
+      this->PointTetraOffsets[i+1] += this->PointTetraOffsets[i];
+      }
+    this->PointTetraIds.resize(4*this->NumberOfTetras);
+    std::vector<vtkIdType> insertPositions(this->PointTetraOffsets.begin(),this->PointTetraOffsets.end()-1);
+    for (i=0; i<4*this->NumberOfTetras; i++)
+      {
+      this->PointTetraIds[insertPositions[this->TetraPointIds[i]]++] = i/4;
+      }
+
+    return 1;
+    }
+
+  void ReleaseCoordinates()
+    {
+    std::vector<double>().swap(this->Coordinates);
+    }
+
+  bool TetraHasPoint(vtkIdType tetraId, vtkIdType pointId) const
+    {
+    const vtkIdType* tetraPts = &this->TetraPointIds[4*tetraId];
+    return tetraPts[0] == pointId || tetraPts[1] == pointId || tetraPts[2] == pointId || tetraPts[3] == pointId;
+    }
+
+  // Same semantics and order as vtkUnstructuredGrid::GetCellNeighbors: the tetrahedra other than tetraId
+  // using all the given points, found among the tetrahedra of the point used by the fewest. Returns their
+  // number and the first one.
+  vtkIdType GetTetraNeighbors(vtkIdType tetraId, int numberOfPoints, const vtkIdType* pts, vtkIdType& firstNeighborId) const
+    {
+    int j;
+    vtkIdType k;
+    vtkIdType minPointId = pts[0];
+    vtkIdType minNumberOfTetras = this->PointTetraOffsets[pts[0]+1] - this->PointTetraOffsets[pts[0]];
+    for (j=1; j<numberOfPoints; j++)
+      {
+      vtkIdType numberOfTetras = this->PointTetraOffsets[pts[j]+1] - this->PointTetraOffsets[pts[j]];
+      if (numberOfTetras < minNumberOfTetras)
+        {
+        minPointId = pts[j];
+        minNumberOfTetras = numberOfTetras;
+        }
+      }
+
+    vtkIdType numberOfNeighbors = 0;
+    firstNeighborId = -1;
+    for (k=this->PointTetraOffsets[minPointId]; k<this->PointTetraOffsets[minPointId+1]; k++)
+      {
+      vtkIdType candidateId = this->PointTetraIds[k];
+      if (candidateId == tetraId)
+        {
+        continue;
+        }
+      bool match = true;
+      for (j=0; j<numberOfPoints && match; j++)
+        {
+        if (pts[j] != minPointId)
+          {
+          match = this->TetraHasPoint(candidateId,pts[j]);
+          }
+        }
+      if (match)
+        {
+        if (numberOfNeighbors == 0)
+          {
+          firstNeighborId = candidateId;
+          }
+        numberOfNeighbors++;
+        }
+      }
+    return numberOfNeighbors;
+    }
+
+  // Walks the ring of tetrahedra around edge (edgePointId0,edgePointId1) across shared faces. Returns
+  // false if the ring is open, i.e. the edge lies on the boundary of the tessellation.
+  bool BuildEdgePolygon(vtkIdType edgePointId0, vtkIdType edgePointId1, std::vector<vtkIdType>& polyIds) const
+    {
+    vtkIdType k, l;
+    int h, numberOfTrianglePoints;
+    vtkIdType edgePts[2], trianglePts[3];
+    vtkIdType tetraId, neighborId;
+
+    polyIds.clear();
+
+    edgePts[0] = edgePointId0;
+    edgePts[1] = edgePointId1;
+    vtkIdType numberOfEdgeTetras = this->GetTetraNeighbors(-1,2,edgePts,tetraId);
+
+    trianglePts[0] = edgePointId0;
+    trianglePts[1] = edgePointId1;
+    numberOfTrianglePoints = 2;
+
+    polyIds.push_back(tetraId);
+    for (k=0; k<numberOfEdgeTetras; k++)
+      {
+      const vtkIdType* tetraPts = &this->TetraPointIds[4*tetraId];
+      for (h=0; h<4; h++)
+        {
+        if (tetraPts[h] == trianglePts[0] || tetraPts[h] == trianglePts[1] || (numberOfTrianglePoints == 3 && tetraPts[h] == trianglePts[2]))
+          {
+          continue;
+          }
+        trianglePts[2] = tetraPts[h];
+        numberOfTrianglePoints = 3;
+        vtkIdType numberOfNeighbors = this->GetTetraNeighbors(tetraId,3,trianglePts,neighborId);
+        if (numberOfNeighbors == 0)
+          {
+          return false;
+          }
+        else if (numberOfNeighbors == 1)
+          {
+          tetraId = neighborId;
+          for (l=0; l<static_cast<vtkIdType>(polyIds.size()); l++)
+            {
+            if (polyIds[l] == tetraId)
+              {
+              break;
+              }
+            }
+          if (l == static_cast<vtkIdType>(polyIds.size()))
+            {
+            polyIds.push_back(tetraId);
+            }
+          break;
+          }
+        }
+      }
+    return true;
+    }
+};
+
+// Voronoi polygons of a block of Delaunay points, in CSR form.
+class vtkvmtkVoronoiDiagram3DPolys
+{
+public:
+  std::vector<vtkIdType> Offsets;
+  std::vector<vtkIdType> Ids;
+};
+
+static const vtkIdType VTK_VMTK_VORONOI_TETRA_BLOCK_SIZE = 256;
+static const vtkIdType VTK_VMTK_VORONOI_POINT_BLOCK_SIZE = 1024;
+
+// Circumsphere of a block of tetrahedra, with coordinates relative to the first point of each tetrahedron
+// stored as structure of arrays. The loop has no branch nor call, so that compilers can vectorize it.
+// Degenerate tetrahedra get the same result as in vtkTetra::Circumsphere: center at the origin and
+// VTK_DOUBLE_MAX squared radius.
+static void vtkvmtkVoronoiDiagram3DCircumsphereKernel(vtkIdType n,
+  const double* x0, const double* y0, const double* z0,
+  const double* ax, const double* ay, const double* az,
+  const double* bx, const double* by, const double* bz,
+  const double* cx, const double* cy, const double* cz,
+  double* ox, double* oy, double* oz, double* r2)
+{
+  for (vtkIdType t=0; t<n; t++)
+    {
+    double a2 = ax[t]*ax[t] + ay[t]*ay[t] + az[t]*az[t];
+    double b2 = bx[t]*bx[t] + by[t]*by[t] + bz[t]*bz[t];
+    double c2 = cx[t]*cx[t] + cy[t]*cy[t] + cz[t]*cz[t];
+
+    double bcx = by[t]*cz[t] - bz[t]*cy[t];
+    double bcy = bz[t]*cx[t] - bx[t]*cz[t];
+    double bcz = bx[t]*cy[t] - by[t]*cx[t];
+    double cax = cy[t]*az[t] - cz[t]*ay[t];
+    double cay = cz[t]*ax[t] - cx[t]*az[t];
+    double caz = cx[t]*ay[t] - cy[t]*ax[t];
+    double abx = ay[t]*bz[t] - az[t]*by[t];
+    double aby = az[t]*bx[t] - ax[t]*bz[t];
+    double abz = ax[t]*by[t] - ay[t]*bx[t];
+
+    double det = ax[t]*bcx + ay[t]*bcy + az[t]*bcz;
+    bool degenerate = (det == 0.0);
+    double scale = degenerate ? 0.0 : 0.5 / det;
+
+    double px = (a2*bcx + b2*cax + c2*abx) * scale;
+    double py = (a2*bcy + b2*cay + c2*aby) * scale;
+    double pz = (a2*bcz + b2*caz + c2*abz) * scale;
+
+    // average of the squared distances from the four points, as in vtkTetra::Circumsphere
+    double d0 = px*px + py*py + pz*pz;
+    double d1 = (ax[t]-px)*(ax[t]-px) + (ay[t]-py)*(ay[t]-py) + (az[t]-pz)*(az[t]-pz);
+    double d2 = (bx[t]-px)*(bx[t]-px) + (by[t]-py)*(by[t]-py) + (bz[t]-pz)*(bz[t]-pz);
+    double d3 = (cx[t]-px)*(cx[t]-px) + (cy[t]-py)*(cy[t]-py) + (cz[t]-pz)*(cz[t]-pz);
+    double sum = 0.25 * (d0 + d1 + d2 + d3);
+
+    ox[t] = degenerate ? 0.0 : x0[t] + px;
+    oy[t] = degenerate ? 0.0 : y0[t] + py;
+    oz[t] = degenerate ? 0.0 : z0[t] + pz;
+    r2[t] = degenerate || !(sum <= VTK_DOUBLE_MAX) ? VTK_DOUBLE_MAX : sum;
+    }
+}
+
+class vtkvmtkVoronoiDiagram3DCircumsphereFunctor
+{
+public:
+  const vtkvmtkVoronoiDiagram3DTopology* Topology;
+  float* Centers;
+  double* Radii;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    const vtkIdType blockSize = VTK_VMTK_VORONOI_TETRA_BLOCK_SIZE;
+    double x0[blockSize], y0[blockSize], z0[blockSize];
+    double ax[blockSize], ay[blockSize], az[blockSize];
+    double bx[blockSize], by[blockSize], bz[blockSize];
+    double cx[blockSize], cy[blockSize], cz[blockSize];
+    double ox[blockSize], oy[blockSize], oz[blockSize], r2[blockSize];
+
+    const double* coordinates = &this->Topology->Coordinates[0];
+    const vtkIdType* tetraPointIds = &this->Topology->TetraPointIds[0];
+
+    for (vtkIdType blockBegin=begin; blockBegin<end; blockBegin+=blockSize)
+      {
+      vtkIdType n = end - blockBegin < blockSize ? end - blockBegin : blockSize;
+      vtkIdType t;
+      for (t=0; t<n; t++)
+        {
+        const vtkIdType* pts = tetraPointIds + 4*(blockBegin+t);
+        const double* p0 = coordinates + 3*pts[0];
+        const double* p1 = coordinates + 3*pts[1];
+        const double* p2 = coordinates + 3*pts[2];
+        const double* p3 = coordinates + 3*pts[3];
+        x0[t] = p0[0]; y0[t] = p0[1]; z0[t] = p0[2];
+        ax[t] = p1[0] - p0[0]; ay[t] = p1[1] - p0[1]; az[t] = p1[2] - p0[2];
+        bx[t] = p2[0] - p0[0]; by[t] = p2[1] - p0[1]; bz[t] = p2[2] - p0[2];
+        cx[t] = p3[0] - p0[0]; cy[t] = p3[1] - p0[1]; cz[t] = p3[2] - p0[2];
+        }
+
+      vtkvmtkVoronoiDiagram3DCircumsphereKernel(n,x0,y0,z0,ax,ay,az,bx,by,bz,cx,cy,cz,ox,oy,oz,r2);
+
+      for (t=0; t<n; t++)
+        {
+        float* center = this->Centers + 3*(blockBegin+t);
+        center[0] = static_cast<float>(ox[t]);
+        center[1] = static_cast<float>(oy[t]);
+        center[2] = static_cast<float>(oz[t]);
+        this->Radii[blockBegin+t] = sqrt(r2[t]);
+        }
+      }
+    }
+};
+
+class vtkvmtkVoronoiDiagram3DPolysFunctor
+{
+public:
+  const vtkvmtkVoronoiDiagram3DTopology* Topology;
+  std::vector<vtkvmtkVoronoiDiagram3DPolys>* Blocks;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    vtkIdType i, j, k, l;
+    std::vector<vtkIdType> edgePointIds;
+    std::vector<vtkIdType> polyIds;
+
+    for (vtkIdType b=begin; b<end; b++)
+      {
+      vtkvmtkVoronoiDiagram3DPolys& polys = (*this->Blocks)[b];
+      polys.Offsets.assign(1,0);
+      polys.Ids.clear();
+
+      vtkIdType firstPointId = b * VTK_VMTK_VORONOI_POINT_BLOCK_SIZE;
+      vtkIdType lastPointId = firstPointId + VTK_VMTK_VORONOI_POINT_BLOCK_SIZE;
+      if (lastPointId > this->Topology->NumberOfPoints)
+        {
+        lastPointId = this->Topology->NumberOfPoints;
+        }
+
+      for (i=firstPointId; i<lastPointId; i++)
+        {
+        // edges (i,j) with j > i, in order of first appearance in the tetrahedra of i
+        edgePointIds.clear();
+        for (j=this->Topology->PointTetraOffsets[i]; j<this->Topology->PointTetraOffsets[i+1]; j++)
+          {
+          const vtkIdType* tetraPts = &this->Topology->TetraPointIds[4*this->Topology->PointTetraIds[j]];
+          for (k=0; k<4; k++)
+            {
+            vtkIdType pointId = tetraPts[k];
+            if (pointId <= i)
+              {
+              continue;
+              }
+            for (l=0; l<static_cast<vtkIdType>(edgePointIds.size()); l++)
+              {
+              if (edgePointIds[l] == pointId)
+                {
+                break;
+                }
+              }
+            if (l < static_cast<vtkIdType>(edgePointIds.size()))
+              {
+              continue;
+              }
+            edgePointIds.push_back(pointId);
+
+            if (this->Topology->BuildEdgePolygon(i,pointId,polyIds))
+              {
+              polys.Ids.insert(polys.Ids.end(),polyIds.begin(),polyIds.end());
+              polys.Offsets.push_back(static_cast<vtkIdType>(polys.Ids.size()));
+              }
+            }
+          }
+        }
+      }
+    }
+};
+
 vtkvmtkVoronoiDiagram3D::vtkvmtkVoronoiDiagram3D()
 {
   this->BuildLines = 0;
   this->PoleIds = vtkIdList::New();
   this->RadiusArrayName = NULL;
+  this->ReleaseInputData = 0;
 }
 
 vtkvmtkVoronoiDiagram3D::~vtkvmtkVoronoiDiagram3D()
@@ -58,135 +413,75 @@ int vtkvmtkVoronoiDiagram3D::FillInputPortInformation(int, vtkInformation *info)
   return 1;
 }
 
-void vtkvmtkVoronoiDiagram3D::ExtractUniqueEdges(vtkUnstructuredGrid* input, vtkCellArray* edgeArray)  // could be a class
+void vtkvmtkVoronoiDiagram3D::ComputeCircumspheres(vtkvmtkVoronoiDiagram3DTopology* topology, vtkPoints* centers, vtkDoubleArray* radii)
 {
-  int isVisited;
-  vtkIdType i, j, k;
-  vtkIdType edgePts[2];
-  vtkIdType npts;
-  const vtkIdType *pts;
-  vtkIntArray* visited;
-  vtkIdList* pointCells;
-  vtkIdList* insertedLoopPoints;
-
-  visited = vtkIntArray::New();
-  visited->SetNumberOfTuples(input->GetNumberOfPoints());
-  visited->FillComponent(0,0);
-
-  pointCells = vtkIdList::New();
-  insertedLoopPoints = vtkIdList::New();
-
-  for (i=0; i<input->GetNumberOfPoints(); i++)
-    {           
-    visited->SetValue(i,1);
-    edgePts[0] = i;
-    pointCells->Initialize();
-    insertedLoopPoints->Initialize();
-    input->GetPointCells(i,pointCells);
-    for (j=0; j<pointCells->GetNumberOfIds(); j++)
-      {
-      input->GetCellPoints(pointCells->GetId(j),npts,pts);
-      for (k=0; k<npts; k++)
-        {
-        isVisited = visited->GetValue(pts[k]);
-        if (!isVisited)
-          if (insertedLoopPoints->IsId(pts[k])==-1)
-            {
-            edgePts[1] = pts[k];
-            insertedLoopPoints->InsertNextId(pts[k]);
-            edgeArray->InsertNextCell(2,edgePts);
-            }
-        }
-      }
-    }
+  centers->SetDataTypeToFloat();
+  centers->SetNumberOfPoints(topology->NumberOfTetras);
+  radii->SetNumberOfTuples(topology->NumberOfTetras);
 
-  visited->Delete();
-  pointCells->Delete();
-  insertedLoopPoints->Delete();
+  if (topology->NumberOfTetras == 0)
+    {
+    return;
+    }
 
+  vtkvmtkVoronoiDiagram3DCircumsphereFunctor functor;
+  functor.Topology = topology;
+  functor.Centers = static_cast<vtkFloatArray*>(centers->GetData())->GetPointer(0);
+  functor.Radii = radii->GetPointer(0);
+  vtkSMPTools::For(0,topology->NumberOfTetras,4*VTK_VMTK_VORONOI_TETRA_BLOCK_SIZE,functor);
 }
 
-void vtkvmtkVoronoiDiagram3D::BuildVoronoiPolys(vtkUnstructuredGrid* input, vtkCellArray* voronoiPolys)
+void vtkvmtkVoronoiDiagram3D::ComputePoles(vtkvmtkVoronoiDiagram3DTopology* topology, vtkDoubleArray* radii)
 {
-  bool boundaryTetra;
-  vtkIdType npts;
-  const vtkIdType *pts;
-  pts = NULL;
-  vtkIdType neighborTetraId;
-  vtkIdType i, k, h;
-  vtkCellArray* edgeArray;
-  vtkIdList* polyIds;
-  vtkIdList* neighborCells;
-  vtkIdList* neighborTrianglePointIds;
-  vtkIdList* neighborNeighborCells;
-  vtkIdList* linePointIds;
-  vtkTetra* neighborTetra;
-
-  edgeArray = vtkCellArray::New();
-  polyIds = vtkIdList::New();
-  neighborCells = vtkIdList::New();
-  neighborTrianglePointIds = vtkIdList::New();
-  neighborNeighborCells = vtkIdList::New();
-  linePointIds = vtkIdList::New();
-
-  this->ExtractUniqueEdges(input,edgeArray);
-
-  edgeArray->InitTraversal();
-  for (i=0; i<edgeArray->GetNumberOfCells(); i++)
+  vtkIdType i, j, id, poleId;
+  double tetraRadius, currentRadius;
+
+  const double* radiusValues = radii->GetPointer(0);
+
+  this->PoleIds->SetNumberOfIds(topology->NumberOfPoints);
+
+  // as in previous versions, a point with no tetrahedron inherits the pole of the previous point
+  poleId = -1;
+  for (i=0; i<topology->NumberOfPoints; i++)
     {
-    edgeArray->GetNextCell(npts,pts);
-    linePointIds->Initialize();
-    linePointIds->InsertNextId(pts[0]);
-    linePointIds->InsertNextId(pts[1]);
-                
-    boundaryTetra = false;
-    neighborCells->Initialize();
-    neighborTrianglePointIds->Initialize();
-    polyIds->Initialize();
-    input->GetCellNeighbors(-1,linePointIds,neighborCells);
-
-    neighborTrianglePointIds->InsertNextId(linePointIds->GetId(0));
-    neighborTrianglePointIds->InsertNextId(linePointIds->GetId(1));
-
-    neighborTetraId = neighborCells->GetId(0);
-    neighborTetra = vtkTetra::SafeDownCast(input->GetCell(neighborTetraId));
-    polyIds->InsertNextId(neighborTetraId);
-    for (k=0; k<neighborCells->GetNumberOfIds(); k++)
+    currentRadius = 0.0;
+    for (j=topology->PointTetraOffsets[i]; j<topology->PointTetraOffsets[i+1]; j++)
       {
-      neighborNeighborCells->Initialize();
-      for (h=0; h<neighborTetra->GetNumberOfPoints(); h++)
+      id = topology->PointTetraIds[j];
+      tetraRadius = radiusValues[id];
+      if (tetraRadius - currentRadius > VTK_VMTK_DOUBLE_TOL)
         {
-        if (neighborTrianglePointIds->IsId(neighborTetra->GetPointId(h))==-1)
-          {
-          neighborTrianglePointIds->InsertId(2,neighborTetra->GetPointId(h));
-          input->GetCellNeighbors(neighborTetraId,neighborTrianglePointIds,neighborNeighborCells);
-          if (neighborNeighborCells->GetNumberOfIds()==0)
-            {
-            boundaryTetra = true;
-            break;
-            }
-          else if (neighborNeighborCells->GetNumberOfIds()==1)
-            {
-            neighborTetraId = neighborNeighborCells->GetId(0);
-            neighborTetra = vtkTetra::SafeDownCast(input->GetCell(neighborTetraId));
-            polyIds->InsertUniqueId(neighborTetraId);
-            break;
-            }
-          }
+        poleId = id;
+        currentRadius = tetraRadius;
         }
-      if (boundaryTetra)
-        break;
       }
-    if (!boundaryTetra)
-      voronoiPolys->InsertNextCell(polyIds);
+    this->PoleIds->SetId(i,poleId);
     }
+}
+
+void vtkvmtkVoronoiDiagram3D::BuildVoronoiPolys(vtkvmtkVoronoiDiagram3DTopology* topology, vtkCellArray* voronoiPolys)
+{
+  vtkIdType b, i;
+
+  vtkIdType numberOfBlocks = (topology->NumberOfPoints + VTK_VMTK_VORONOI_POINT_BLOCK_SIZE - 1) / VTK_VMTK_VORONOI_POINT_BLOCK_SIZE;
+  std::vector<vtkvmtkVoronoiDiagram3DPolys> blocks(numberOfBlocks);
+
+  vtkvmtkVoronoiDiagram3DPolysFunctor functor;
+  functor.Topology = topology;
+  functor.Blocks = &blocks;
+  vtkSMPTools::For(0,numberOfBlocks,1,functor);
 
-  edgeArray->Delete();
-  polyIds->Delete();
-  neighborCells->Delete();
-  neighborTrianglePointIds->Delete();
-  neighborNeighborCells->Delete();
-  linePointIds->Delete();
+  for (b=0; b<numberOfBlocks; b++)
+    {
+    vtkvmtkVoronoiDiagram3DPolys& polys = blocks[b];
+    vtkIdType numberOfPolys = static_cast<vtkIdType>(polys.Offsets.size()) - 1;
+    for (i=0; i<numberOfPolys; i++)
+      {
+      voronoiPolys->InsertNextCell(polys.Offsets[i+1]-polys.Offsets[i],&polys.Ids[polys.Offsets[i]]);
+      }
+    std::vector<vtkIdType>().swap(polys.Offsets);
+    std::vector<vtkIdType>().swap(polys.Ids);
+    }
 }
 
 int vtkvmtkVoronoiDiagram3D::RequestData(
@@ -202,78 +497,37 @@ int vtkvmtkVoronoiDiagram3D::RequestData(
   vtkPolyData *output = vtkPolyData::SafeDownCast(
     outInfo->Get(vtkDataObject::DATA_OBJECT()));
 
+  vtkvmtkVoronoiDiagram3DTopology topology;
+  if (!topology.Build(input))
+    {
+    vtkErrorMacro(<<"Input contains cells other than tetrahedra.");
+    return 1;
+    }
+
+  if (this->ReleaseInputData)
+    {
+    input->ReleaseData();
+    }
+
   // Declare
-  double p0[3], p1[3], p2[3], p3[3];
-  double tetraCenter[3], tetraRadius;
-  double currentRadius;
-  vtkIdType i, j, id, poleId;
   vtkPoints* newPoints;
   vtkCellArray* newPolys;
   vtkCellArray* newLines;
   vtkDoubleArray* newScalars;
-  vtkDoubleArray* thicknessScalars;
-  vtkIdList* cellIds;
-  vtkTetra* tetra;
-
-  poleId = -1;
 
   // Allocate
   newPoints = vtkPoints::New();
-  newPoints->SetNumberOfPoints(input->GetNumberOfCells());
   newScalars = vtkDoubleArray::New();
-  newScalars->SetNumberOfTuples(input->GetNumberOfCells());
   newPolys = vtkCellArray::New();
   newLines = vtkCellArray::New();
-  thicknessScalars = vtkDoubleArray::New();
-  thicknessScalars->SetNumberOfTuples(input->GetNumberOfPoints());
-  thicknessScalars->FillComponent(0,0.0);
-
-  cellIds = vtkIdList::New();
-
-  this->PoleIds->SetNumberOfIds(input->GetNumberOfPoints());
 
   // Execute
+  this->ComputeCircumspheres(&topology,newPoints,newScalars);
+  topology.ReleaseCoordinates();
 
-  for (i=0; i<input->GetNumberOfPoints(); i++)
-    {
-    this->PoleIds->SetId(i,-1);
-    }
+  this->ComputePoles(&topology,newScalars);
 
-  for (i=0; i<input->GetNumberOfCells(); i++)
-    {
-    tetra = (vtkTetra*) input->GetCell(i);
-    tetra->GetPoints()->GetPoint(0,p0);
-    tetra->GetPoints()->GetPoint(1,p1);
-    tetra->GetPoints()->GetPoint(2,p2);
-    tetra->GetPoints()->GetPoint(3,p3);
-    tetraRadius = sqrt(vtkTetra::Circumsphere(p0,p1,p2,p3,tetraCenter));
-
-    newPoints->SetPoint(i,tetraCenter);
-    newScalars->SetValue(i,(double)tetraRadius);
-    }
-
-  // compute poles
-  input->BuildLinks();
-  for (i=0; i<input->GetNumberOfPoints(); i++)
-    {
-    cellIds->Initialize();
-    input->GetPointCells(i,cellIds);
-    currentRadius = thicknessScalars->GetValue(i);
-    for (j=0; j<cellIds->GetNumberOfIds(); j++)
-      {
-      id = cellIds->GetId(j);
-      tetraRadius = newScalars->GetValue(id);
-      if (tetraRadius - currentRadius > VTK_VMTK_DOUBLE_TOL)
-        {
-        poleId = id;
-        currentRadius = tetraRadius;
-        }
-      }
-    this->PoleIds->SetId(i,poleId);
-    thicknessScalars->SetValue(i,currentRadius);
-    }  
-
-  this->BuildVoronoiPolys(input,newPolys);
+  this->BuildVoronoiPolys(&topology,newPolys);
 
   if (this->BuildLines)
     {
@@ -304,8 +558,6 @@ int vtkvmtkVoronoiDiagram3D::RequestData(
   newPolys->Delete();
   newLines->Delete();
   newScalars->Delete();
-  thicknessScalars->Delete();
-  cellIds->Delete();
 
   return 1;
 }
@@ -313,4 +565,6 @@ int vtkvmtkVoronoiDiagram3D::RequestData(
 void vtkvmtkVoronoiDiagram3D::PrintSelf(std::ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "ReleaseInputData: " << this->ReleaseInputData << "\n";
 }
@@ -20,6 +20,8 @@ Program:   VMTK
  * @ingroup ComputationalGeometry
  *
  * This class computes the Voronoi diagram of a set of points given their Delaunay tessellation. Basically, the output points are Delaunay tetrahedra circumcenters, and the cells are convex polygons constructed by connecting circumcenters of tetrahedra sharing a face. The radius of the circumsphere associated with each circumcenter is stored in a point data array with name specified by RadiusArrayName. The id list of poles is also provided. Poles are the farthest inner and outer Voronoi points associated with a Delaunay point. Since this class is meant to deal with Delaunay tessellations which are internal to a given surface, only the internal pole is considered for each input point.
+ *
+ * The input must be made of tetrahedra only. Its connectivity is copied once into flat arrays (tetrahedron points and point-to-tetrahedra lists), and the input cell links are not built. Circumspheres are computed in blocks of tetrahedra with a branch-free kernel, and Voronoi polygons are built in blocks of Delaunay points, each Delaunay edge being visited from its lower point id only, so that the edge set is never stored. Both steps run in parallel with vtkSMPTools; polygons are appended in Delaunay point order, so the output does not depend on the number of threads. If ReleaseInputData is on, the input is released (vtkDataObject::ReleaseData) as soon as its connectivity has been copied, which lowers peak memory when the Delaunay tessellation is not needed afterwards.
  */
 
 #ifndef __vtkvmtkVoronoiDiagram3D_h
@@ -32,6 +34,8 @@ Program:   VMTK
 #include "vtkvmtkWin32Header.h"
 
 class vtkUnstructuredGrid;
+class vtkDoubleArray;
+class vtkvmtkVoronoiDiagram3DTopology;
 
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkVoronoiDiagram3D : public vtkPolyDataAlgorithm
 {
@@ -62,6 +66,16 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkVoronoiDiagram3D : public vt
   vtkGetObjectMacro(PoleIds,vtkIdList);
   ///@}
 
+  ///@{
+  /**
+   * Turn on/off releasing the input Delaunay tessellation once its connectivity has been copied (off by default).
+   * The input is emptied by the filter, so this must only be turned on when nobody else needs it.
+   */
+  vtkSetMacro(ReleaseInputData,int);
+  vtkGetMacro(ReleaseInputData,int);
+  vtkBooleanMacro(ReleaseInputData,int);
+  ///@}
+
   protected:
   vtkvmtkVoronoiDiagram3D();
   ~vtkvmtkVoronoiDiagram3D();  
@@ -70,13 +84,15 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkVoronoiDiagram3D : public vt
 
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
 
-  void ExtractUniqueEdges(vtkUnstructuredGrid* input, vtkCellArray* edgeArray);
-  void BuildVoronoiPolys(vtkUnstructuredGrid* input, vtkCellArray* voronoiPolys);
+  void ComputeCircumspheres(vtkvmtkVoronoiDiagram3DTopology* topology, vtkPoints* centers, vtkDoubleArray* radii);
+  void ComputePoles(vtkvmtkVoronoiDiagram3DTopology* topology, vtkDoubleArray* radii);
+  void BuildVoronoiPolys(vtkvmtkVoronoiDiagram3DTopology* topology, vtkCellArray* voronoiPolys);
   void BuildVoronoiLines() {};   // not yet implemented
 
   int BuildLines;
   vtkIdList* PoleIds;
   char* RadiusArrayName;
+  int ReleaseInputData;
 
   private:
   vtkvmtkVoronoiDiagram3D(const vtkvmtkVoronoiDiagram3D&);  // Not implemented.
@@ -37,7 +37,7 @@
 
 #include "vtkvmtkConstants.h"
 
-#include "vtkDijkstraGraphGeodesicPath.h"
+#include "vtkvmtkPolyDataGraphGeodesicDistance.h"
 
 vtkStandardNewMacro(vtkvmtkPolyDataDijkstraDistanceToPoints);
 
@@ -51,6 +51,8 @@ vtkvmtkPolyDataDijkstraDistanceToPoints::vtkvmtkPolyDataDijkstraDistanceToPoints
   this->DistanceScale = 1.;
   this->MinDistance = 0.;
   this->MaxDistance = -1.;
+
+  this->GeodesicDistance = vtkvmtkPolyDataGraphGeodesicDistance::New();
 }
 
 vtkvmtkPolyDataDijkstraDistanceToPoints::~vtkvmtkPolyDataDijkstraDistanceToPoints()
@@ -66,6 +68,8 @@ vtkvmtkPolyDataDijkstraDistanceToPoints::~vtkvmtkPolyDataDijkstraDistanceToPoint
     this->SeedIds->Delete();
     this->SeedIds = NULL;
     }
+
+  this->GeodesicDistance->Delete();
 }
 
 int vtkvmtkPolyDataDijkstraDistanceToPoints::RequestData(
@@ -114,29 +118,45 @@ int vtkvmtkPolyDataDijkstraDistanceToPoints::RequestData(
     }
 
   int numberOfSeeds = this->SeedIds->GetNumberOfIds();
-  
-  vtkDijkstraGraphGeodesicPath *dijkstraAlgo = vtkDijkstraGraphGeodesicPath::New();
-  dijkstraAlgo->SetInputData(input);
-  dijkstraAlgo->StopWhenEndReachedOff();
-  dijkstraAlgo->UseScalarWeightsOff();
-  
+
+  // the graph is only rebuilt when the input has changed since the last update
+  this->GeodesicDistance->Build(input);
+
   double maxd = this->MaxDistance > 0 ? this->MaxDistance : VTK_VMTK_LARGE_DOUBLE;
-  
-  for (int i=0; i<numberOfSeeds; i++)
+
+  vtkDoubleArray *seedDistances = vtkDoubleArray::New();
+  int numberOfSweeps = numberOfSeeds;
+  if (this->DistanceScale > 0.0)
+    {
+    // the transformed distance increases with the raw distance, so the closest seed gives the
+    // smallest value, and points beyond the raw distance mapped to maxd are clamped anyway
+    double maximumDistance = VTK_VMTK_LARGE_DOUBLE;
+    if (this->MaxDistance > 0)
+      {
+      maximumDistance = (maxd - this->DistanceOffset) / this->DistanceScale;
+      }
+    this->GeodesicDistance->SetMaximumDistance(maximumDistance);
+    this->GeodesicDistance->ComputeDistances(this->SeedIds,seedDistances);
+    numberOfSweeps = numberOfSeeds > 0 ? 1 : 0;
+    }
+  else
+    {
+    this->GeodesicDistance->SetMaximumDistance(VTK_VMTK_LARGE_DOUBLE);
+    this->GeodesicDistance->ComputeSeedDistances(this->SeedIds,seedDistances);
+    }
+
+  for (int j=0; j<numberOfSweeps; j++)
     {
-    dijkstraAlgo->SetStartVertex(SeedIds->GetId(i));
-    dijkstraAlgo->Update();
-    vtkDoubleArray *seedDistances = vtkDoubleArray::New();
-    dijkstraAlgo->GetCumulativeWeights(seedDistances);
     for (int i=0;i<numberOfInputPoints;i++)
       {
-      double newDist = this->DistanceOffset + this->DistanceScale*seedDistances->GetValue(i);
+      double seedDistance = seedDistances->GetComponent(i,j);
+      double newDist = seedDistance < VTK_VMTK_LARGE_DOUBLE ? this->DistanceOffset + this->DistanceScale*seedDistance : maxd;
       if (newDist<this->MinDistance) newDist = this->MinDistance;
       if (newDist>maxd) newDist = maxd;
       if (newDist<distanceToPointsArray->GetComponent(i,0)) distanceToPointsArray->SetComponent(i,0,newDist);
       }
-    seedDistances->Delete();
     }
+  seedDistances->Delete();
 
 
   if (createArray) distanceToPointsArray->Delete();
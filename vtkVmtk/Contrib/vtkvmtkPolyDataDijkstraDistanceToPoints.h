@@ -32,6 +32,12 @@
  * (DistanceOffset + DistanceScale * rawDistance), clamped from below by
  * MinDistance and, if MaxDistance is positive, from above by MaxDistance
  * (a non-positive MaxDistance, the default, means unbounded).
+ *
+ * Distances are computed by a vtkvmtkPolyDataGraphGeodesicDistance, which
+ * keeps the edge graph of the input between updates. With a positive
+ * DistanceScale, the closest seed of every point is found in a single sweep
+ * from all seeds, which stops where MaxDistance is reached; otherwise one
+ * sweep per seed is run, in parallel over the seeds.
  */
 
 #ifndef __vtkvmtkPolyDataDijkstraDistanceToPoints_h
@@ -44,6 +50,8 @@
 #include "vtkPolyData.h"
 #include "vtkIdList.h"
 
+class vtkvmtkPolyDataGraphGeodesicDistance;
+
 class VTK_VMTK_CONTRIB_EXPORT vtkvmtkPolyDataDijkstraDistanceToPoints : public vtkPolyDataAlgorithm
 {
 public:
@@ -120,6 +128,8 @@ protected:
   double MinDistance;
   double MaxDistance;
 
+  vtkvmtkPolyDataGraphGeodesicDistance* GeodesicDistance;
+
 private:
   vtkvmtkPolyDataDijkstraDistanceToPoints(const vtkvmtkPolyDataDijkstraDistanceToPoints&);  // Not implemented.
   void operator=(const vtkvmtkPolyDataDijkstraDistanceToPoints&);  // Not implemented.
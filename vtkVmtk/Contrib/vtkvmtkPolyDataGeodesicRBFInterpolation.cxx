@@ -32,18 +32,43 @@
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
 #include "vtkIOStream.h"
-#include <iostream>
 #include "vtkFloatArray.h"
 #include "vtkDoubleArray.h"
+#include "vtkSMPTools.h"
 
 #include <vector>
 
 #include "vtkvmtkConstants.h"
 
-#include "vtkDijkstraGraphGeodesicPath.h"
+#include "vtkvmtkPolyDataGraphGeodesicDistance.h"
 
 vtkStandardNewMacro(vtkvmtkPolyDataGeodesicRBFInterpolation);
 
+class vtkvmtkPolyDataGeodesicRBFInterpolationEvaluateFunctor
+{
+public:
+  vtkvmtkPolyDataGeodesicRBFInterpolation* Interpolation;
+  // one tuple per point, one component per seed
+  const double* SeedDistances;
+  const double* Coefficients;
+  int NumberOfSeeds;
+  double* Values;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      const double* distances = this->SeedDistances + i*this->NumberOfSeeds;
+      double rbfValue = 0.;
+      for (int j=0; j<this->NumberOfSeeds; j++)
+        {
+        rbfValue += this->Coefficients[j]*this->Interpolation->EvaluateRBF(distances[j]);
+        }
+      this->Values[i] = rbfValue;
+      }
+    }
+};
+
 vtkvmtkPolyDataGeodesicRBFInterpolation::vtkvmtkPolyDataGeodesicRBFInterpolation() 
 {
   this->InterpolatedArrayName = NULL;
@@ -52,6 +77,8 @@ vtkvmtkPolyDataGeodesicRBFInterpolation::vtkvmtkPolyDataGeodesicRBFInterpolation
   this->SeedValues = NULL;
   
   this->RBFType = THIN_PLATE_SPLINE;
+
+  this->GeodesicDistance = vtkvmtkPolyDataGraphGeodesicDistance::New();
 }
 
 vtkvmtkPolyDataGeodesicRBFInterpolation::~vtkvmtkPolyDataGeodesicRBFInterpolation()
@@ -73,6 +100,8 @@ vtkvmtkPolyDataGeodesicRBFInterpolation::~vtkvmtkPolyDataGeodesicRBFInterpolatio
     this->SeedValues->Delete();
     this->SeedValues = NULL;
     }
+
+  this->GeodesicDistance->Delete();
 }
 
 double vtkvmtkPolyDataGeodesicRBFInterpolation::EvaluateRBF(double r)
@@ -143,6 +172,12 @@ int vtkvmtkPolyDataGeodesicRBFInterpolation::RequestData(
     vtkErrorMacro(<<"Incorrect number of seed values");
     return 1;
     }
+
+  if (this->RBFType != THIN_PLATE_SPLINE && this->RBFType != BIHARMONIC && this->RBFType != TRIHARMONIC)
+    {
+    vtkErrorMacro(<<"Error: Unsupported RBFType!");
+    return 1;
+    }
   
   output->DeepCopy(input);
 
@@ -163,23 +198,11 @@ int vtkvmtkPolyDataGeodesicRBFInterpolation::RequestData(
 
   
   
-  vtkDijkstraGraphGeodesicPath *dijkstraAlgo = vtkDijkstraGraphGeodesicPath::New();
-  dijkstraAlgo->SetInputData(input);
-  dijkstraAlgo->StopWhenEndReachedOff();
-  dijkstraAlgo->UseScalarWeightsOff();
-  
-  std::vector<vtkDoubleArray *> geodesicDistances;
-  
-  
-  //Compute the geodesic distances
-  for (int i=0; i<numberOfSeeds; i++)
-    {
-    dijkstraAlgo->SetStartVertex(SeedIds->GetId(i));
-    dijkstraAlgo->Update();
-    vtkDoubleArray *seedDistances = vtkDoubleArray::New();
-    dijkstraAlgo->GetCumulativeWeights(seedDistances);
-    geodesicDistances.push_back(seedDistances);
-    }
+  //Compute the geodesic distances, one component per seed
+  this->GeodesicDistance->Build(input);
+  this->GeodesicDistance->SetMaximumDistance(VTK_VMTK_LARGE_DOUBLE);
+  vtkDoubleArray* geodesicDistances = vtkDoubleArray::New();
+  this->GeodesicDistance->ComputeSeedDistances(this->SeedIds,geodesicDistances);
     
   //Compute the coefficients  
   double **A, *x;
@@ -198,30 +221,12 @@ int vtkvmtkPolyDataGeodesicRBFInterpolation::RequestData(
     {
     for (j=0; j<numberOfSeeds; j++)
       {
-      double dist = geodesicDistances[i]->GetValue(this->SeedIds->GetId(j));
+      double dist = geodesicDistances->GetComponent(this->SeedIds->GetId(j),i);
       A[i][j] = this->EvaluateRBF(dist);
       }
     } 
 
-  std::cout << "A " << std::endl;
-  for (int i=0;i<numberOfSeeds;i++) {
-    for (int j=0;j<numberOfSeeds;j++) {
-      std::cout << A[i][j] << " ";
-    }
-    std::cout << std::endl;
-  }
-
-  std::cout << "b " << std::endl;
-  for (int i=0;i<numberOfSeeds;i++) {
-    std::cout << x[i] << std::endl;
-  }
-
   int ret = vtkMath::SolveLinearSystem(A,x,numberOfSeeds);
-
-  std::cout << "x " << std::endl;
-  for (int i=0;i<numberOfSeeds;i++) {
-    std::cout << x[i] << std::endl;
-  }
   
   if (!ret)
     {
@@ -237,23 +242,25 @@ int vtkvmtkPolyDataGeodesicRBFInterpolation::RequestData(
   
   
   //Interpolate the values at all points using the coefficients
-  for (int i=0;i<numberOfInputPoints;i++) 
+  std::vector<double> values(numberOfInputPoints);
+  if (numberOfInputPoints > 0)
     {
-    double rbfValue = 0.;
-    for (int j=0;j<numberOfSeeds;j++) {
-      double dist = geodesicDistances[j]->GetValue(i);
-      rbfValue += x[j]*this->EvaluateRBF(dist);
-    }
-    interpolatedArray->SetComponent(i,0,rbfValue);
+    vtkvmtkPolyDataGeodesicRBFInterpolationEvaluateFunctor evaluateFunctor;
+    evaluateFunctor.Interpolation = this;
+    evaluateFunctor.SeedDistances = geodesicDistances->GetPointer(0);
+    evaluateFunctor.Coefficients = x;
+    evaluateFunctor.NumberOfSeeds = numberOfSeeds;
+    evaluateFunctor.Values = &values[0];
+    vtkSMPTools::For(0,numberOfInputPoints,evaluateFunctor);
     }
-  
-  delete[] x;
-  for (int i=0;i<numberOfSeeds;i++)
+
+  for (i=0; i<numberOfInputPoints; i++)
     {
-    geodesicDistances[i]->Delete();
+    interpolatedArray->SetComponent(i,0,values[i]);
     }
   
-  geodesicDistances.clear();
+  delete[] x;
+  geodesicDistances->Delete();
 
 
   if (createArray) interpolatedArray->Delete();
@@ -32,6 +32,10 @@
  * surface and writes the result to a point data array named
  * InterpolatedArrayName. At least two seed points are required.
  *
+ * The distances from all seeds are computed at once by a
+ * vtkvmtkPolyDataGraphGeodesicDistance, one sweep per seed in parallel, on
+ * an edge graph kept between updates as long as the input does not change.
+ *
  * @sa vtkvmtkRBFInterpolation2
  */
 
@@ -46,6 +50,8 @@
 #include "vtkIdList.h"
 #include "vtkDoubleArray.h"
 
+class vtkvmtkPolyDataGraphGeodesicDistance;
+
 class VTK_VMTK_CONTRIB_EXPORT vtkvmtkPolyDataGeodesicRBFInterpolation : public vtkPolyDataAlgorithm
 {
 public:
@@ -119,7 +125,11 @@ protected:
   vtkDataArray* SeedValues;
 
   int RBFType;
-  
+
+  vtkvmtkPolyDataGraphGeodesicDistance* GeodesicDistance;
+
+  friend class vtkvmtkPolyDataGeodesicRBFInterpolationEvaluateFunctor;
+
 private:
   vtkvmtkPolyDataGeodesicRBFInterpolation(const vtkvmtkPolyDataGeodesicRBFInterpolation&);  // Not implemented.
   void operator=(const vtkvmtkPolyDataGeodesicRBFInterpolation&);  // Not implemented.
@@ -23,24 +23,239 @@
 
 #include "vtkObjectFactory.h"
 #include "vtkvmtkDataSetItem.h"
+#include "vtkvmtkNeighborhood.h"
+#include "vtkvmtkStencil.h"
+#include "vtkIdList.h"
+#include "vtkPolyData.h"
+#include "vtkCellArray.h"
+#include "vtkSMPTools.h"
+#include "vtkVersion.h"
 
+#include <vector>
 
+// Builds the items of one or more blocks of points into per-block buffers, using a scratch item
+// instantiated for every call so that no item is shared between threads. Per-point counts,
+// boundary flags and center weights are written straight into the arrays of the collection.
+class vtkvmtkDataSetItemsBuildFunctor
+{
+public:
+  vtkvmtkDataSetItems* Items;
+  vtkIdType NumberOfPoints;
+  vtkIdType BlockSize;
+  vtkIdType NumberOfComponents;
+  vtkIdType* Counts;
+  std::vector<std::vector<vtkIdType> > BlockPointIds;
+  std::vector<std::vector<double> > BlockWeights;
 
-void vtkvmtkDataSetItems::Build()
+  void operator()(vtkIdType beginBlock, vtkIdType endBlock)
+    {
+    vtkvmtkItem* item = this->Items->InstantiateNewItem(this->Items->ItemType);
+    vtkvmtkNeighborhood* neighborhood = vtkvmtkNeighborhood::SafeDownCast(item);
+    vtkvmtkStencil* stencil = vtkvmtkStencil::SafeDownCast(item);
+    neighborhood->SetDataSet(this->Items->DataSet);
+    neighborhood->SetReallocateOnBuild(1);
+
+    for (vtkIdType block=beginBlock; block<endBlock; block++)
+      {
+      std::vector<vtkIdType>& pointIds = this->BlockPointIds[block];
+      std::vector<double>& weights = this->BlockWeights[block];
+      pointIds.clear();
+      weights.clear();
+      vtkIdType endPointId = (block+1)*this->BlockSize < this->NumberOfPoints ? (block+1)*this->BlockSize : this->NumberOfPoints;
+      for (vtkIdType pointId=block*this->BlockSize; pointId<endPointId; pointId++)
+        {
+        neighborhood->SetDataSetPointId(pointId);
+        neighborhood->Build();
+        vtkIdType numberOfPoints = neighborhood->GetNumberOfPoints();
+        this->Counts[pointId] = numberOfPoints;
+        this->Items->ItemBoundaryFlags[pointId] = neighborhood->GetIsBoundary() ? 1 : 0;
+        for (vtkIdType j=0; j<numberOfPoints; j++)
+          {
+          pointIds.push_back(neighborhood->GetPointId(j));
+          }
+        if (stencil)
+          {
+          for (vtkIdType j=0; j<numberOfPoints; j++)
+            {
+            for (vtkIdType c=0; c<this->NumberOfComponents; c++)
+              {
+              weights.push_back(stencil->GetWeight(j,c));
+              }
+            }
+          const double* centerWeight = stencil->GetCenterWeightTuple();
+          for (vtkIdType c=0; c<this->NumberOfComponents; c++)
+            {
+            this->Items->ItemCenterWeights[this->NumberOfComponents*pointId+c] = centerWeight ? centerWeight[c] : 0.0;
+            }
+          }
+        }
+      }
+
+    item->UnRegister(this->Items);
+    }
+};
+
+// Copies the per-block buffers into the flat arrays once the offsets are known.
+class vtkvmtkDataSetItemsCopyFunctor
+{
+public:
+  vtkvmtkDataSetItemsBuildFunctor* Build;
+  const vtkIdType* Offsets;
+  vtkIdType* PointIds;
+  double* Weights;
+
+  void operator()(vtkIdType beginBlock, vtkIdType endBlock)
+    {
+    for (vtkIdType block=beginBlock; block<endBlock; block++)
+      {
+      vtkIdType offset = this->Offsets[block*this->Build->BlockSize];
+      const std::vector<vtkIdType>& pointIds = this->Build->BlockPointIds[block];
+      if (!pointIds.empty())
+        {
+        memcpy(this->PointIds+offset,&pointIds[0],pointIds.size()*sizeof(vtkIdType));
+        }
+      const std::vector<double>& weights = this->Build->BlockWeights[block];
+      if (this->Weights && !weights.empty())
+        {
+        memcpy(this->Weights+this->Build->NumberOfComponents*offset,&weights[0],weights.size()*sizeof(double));
+        }
+      }
+    }
+};
+
+// Builds again the items of a list of points (of all points if PointIds is NULL) straight into
+// the flat arrays of the collection, which already have room for them. Items whose number of
+// points has changed are left untouched and flagged in Mismatches.
+class vtkvmtkDataSetItemsRebuildFunctor
+{
+public:
+  vtkvmtkDataSetItems* Items;
+  const vtkIdType* PointIds;
+  unsigned char* Mismatches;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    vtkvmtkItem* item = this->Items->InstantiateNewItem(this->Items->ItemType);
+    vtkvmtkNeighborhood* neighborhood = vtkvmtkNeighborhood::SafeDownCast(item);
+    vtkvmtkStencil* stencil = vtkvmtkStencil::SafeDownCast(item);
+    neighborhood->SetDataSet(this->Items->DataSet);
+    neighborhood->SetReallocateOnBuild(1);
+
+    vtkIdType numberOfComponents = this->Items->ItemNumberOfComponents;
+    for (vtkIdType k=begin; k<end; k++)
+      {
+      vtkIdType pointId = this->PointIds ? this->PointIds[k] : k;
+      neighborhood->SetDataSetPointId(pointId);
+      neighborhood->Build();
+      vtkIdType offset = this->Items->ItemOffsets[pointId];
+      vtkIdType numberOfPoints = neighborhood->GetNumberOfPoints();
+      if (numberOfPoints != this->Items->ItemOffsets[pointId+1] - offset)
+        {
+        this->Mismatches[k] = 1;
+        continue;
+        }
+      this->Mismatches[k] = 0;
+      this->Items->ItemBoundaryFlags[pointId] = neighborhood->GetIsBoundary() ? 1 : 0;
+      for (vtkIdType j=0; j<numberOfPoints; j++)
+        {
+        this->Items->ItemPointIds[offset+j] = neighborhood->GetPointId(j);
+        }
+      if (stencil)
+        {
+        for (vtkIdType j=0; j<numberOfPoints; j++)
+          {
+          for (vtkIdType c=0; c<numberOfComponents; c++)
+            {
+            this->Items->ItemWeights[numberOfComponents*(offset+j)+c] = stencil->GetWeight(j,c);
+            }
+          }
+        const double* centerWeight = stencil->GetCenterWeightTuple();
+        for (vtkIdType c=0; c<numberOfComponents; c++)
+          {
+          this->Items->ItemCenterWeights[numberOfComponents*pointId+c] = centerWeight ? centerWeight[c] : 0.0;
+          }
+        }
+      }
+
+    item->UnRegister(this->Items);
+    }
+};
+
+vtkvmtkDataSetItems::vtkvmtkDataSetItems()
   {
-  vtkIdType numPts;
-  vtkIdType pointId;
-  vtkvmtkDataSetItem *dataSetItem;
+  this->DataSet = NULL;
+  this->ReallocateOnBuild = 0;
+  this->StorageMode = VTK_VMTK_DATASET_ITEMS_COMPACT;
+  this->ItemOffsets = NULL;
+  this->ItemPointIds = NULL;
+  this->ItemBoundaryFlags = NULL;
+  this->ItemWeights = NULL;
+  this->ItemCenterWeights = NULL;
+  this->ItemNumberOfComponents = 0;
+  }
+
+vtkvmtkDataSetItems::~vtkvmtkDataSetItems()
+  {
+  this->ReleaseCompactStorage();
+  }
+
+void vtkvmtkDataSetItems::ReleaseCompactStorage()
+  {
+  if (this->ItemOffsets)
+    {
+    delete[] this->ItemOffsets;
+    this->ItemOffsets = NULL;
+    }
+  if (this->ItemPointIds)
+    {
+    delete[] this->ItemPointIds;
+    this->ItemPointIds = NULL;
+    }
+  if (this->ItemBoundaryFlags)
+    {
+    delete[] this->ItemBoundaryFlags;
+    this->ItemBoundaryFlags = NULL;
+    }
+  if (this->ItemWeights)
+    {
+    delete[] this->ItemWeights;
+    this->ItemWeights = NULL;
+    }
+  if (this->ItemCenterWeights)
+    {
+    delete[] this->ItemCenterWeights;
+    this->ItemCenterWeights = NULL;
+    }
+  this->ItemNumberOfComponents = 0;
+  }
 
+void vtkvmtkDataSetItems::Build()
+  {
   if (this->DataSet==NULL)
     {
     vtkErrorMacro(<<"No DataSet specified.");
     return;
     }
 
+  if (this->StorageMode == VTK_VMTK_DATASET_ITEMS_COMPACT)
+    {
+    this->BuildCompact();
+    }
+  else
+    {
+    this->BuildObjects();
+    }
+  }
+
+void vtkvmtkDataSetItems::BuildObjects()
+  {
+  vtkIdType numPts;
+  vtkIdType pointId;
+  vtkvmtkDataSetItem *dataSetItem;
+
   numPts = this->DataSet->GetNumberOfPoints();
 
-  if (!this->Array || (this->Array && this->ReallocateOnBuild))
+  if (!this->Array || this->ReallocateOnBuild || this->GetIsCompact())
     {
     this->Allocate(numPts);
     this->MaxId = numPts - 1;
@@ -61,3 +276,225 @@ void vtkvmtkDataSetItems::Build()
     }
   }
 
+int vtkvmtkDataSetItems::PrepareParallelBuild()
+  {
+  // links (and cells) are built here, serially, so that items can query them from any thread
+  vtkIdList* cellIds = vtkIdList::New();
+  if (this->DataSet->GetNumberOfPoints() > 0)
+    {
+    this->DataSet->GetPointCells(0,cellIds);
+    }
+  cellIds->Delete();
+
+  int parallel = 1;
+#if VTK_MAJOR_VERSION >= 9
+  // cell arrays that cannot share their storage hand out connectivity through a buffer held by
+  // the data set, which items built concurrently would overwrite
+  vtkPolyData* polyData = vtkPolyData::SafeDownCast(this->DataSet);
+  if (polyData)
+    {
+    vtkCellArray* cellArrays[4] = {polyData->GetVerts(), polyData->GetLines(), polyData->GetPolys(), polyData->GetStrips()};
+    for (int k=0; k<4; k++)
+      {
+      if (cellArrays[k] && !cellArrays[k]->IsStorageShareable())
+        {
+        parallel = 0;
+        }
+      }
+    }
+#endif
+  return parallel;
+  }
+
+void vtkvmtkDataSetItems::BuildCompact()
+  {
+  vtkIdType numPts = this->DataSet->GetNumberOfPoints();
+
+  if (this->GetIsCompact() && !this->ReallocateOnBuild && this->GetReuseBuiltItems() && this->MaxId == numPts - 1)
+    {
+    // the flat arrays are kept and the items, with their weights, are built again into them for
+    // the current point coordinates, unless the number of points of an item has changed
+    if (this->RebuildCompact(NULL,numPts))
+      {
+      return;
+      }
+    }
+
+  if (this->Array != NULL)
+    {
+    this->ReleaseArray();
+    delete [] this->Array;
+    this->Array = NULL;
+    }
+  this->ReleaseCompactStorage();
+  this->Size = 0;
+  this->MaxId = -1;
+
+  vtkvmtkItem* probeItem = this->InstantiateNewItem(this->ItemType);
+  if (vtkvmtkNeighborhood::SafeDownCast(probeItem)==NULL)
+    {
+    if (probeItem)
+      {
+      probeItem->UnRegister(this);
+      }
+    vtkErrorMacro(<<"Compact storage requires vtkvmtkNeighborhood items; use SetStorageModeToObjects.");
+    return;
+    }
+  vtkvmtkStencil* probeStencil = vtkvmtkStencil::SafeDownCast(probeItem);
+  this->ItemNumberOfComponents = probeStencil ? probeStencil->GetNumberOfComponents() : 0;
+  probeItem->UnRegister(this);
+
+  bool parallel = this->PrepareParallelBuild() != 0;
+
+  this->ItemOffsets = new vtkIdType[numPts+1];
+  this->ItemBoundaryFlags = new unsigned char[numPts > 0 ? numPts : 1];
+  if (this->ItemNumberOfComponents > 0)
+    {
+    this->ItemCenterWeights = new double[numPts > 0 ? this->ItemNumberOfComponents*numPts : 1];
+    }
+
+  const vtkIdType blockSize = 1024;
+  vtkIdType numberOfBlocks = (numPts + blockSize - 1) / blockSize;
+
+  vtkvmtkDataSetItemsBuildFunctor buildFunctor;
+  buildFunctor.Items = this;
+  buildFunctor.NumberOfPoints = numPts;
+  buildFunctor.BlockSize = blockSize;
+  buildFunctor.NumberOfComponents = this->ItemNumberOfComponents;
+  buildFunctor.Counts = this->ItemOffsets + 1;
+  buildFunctor.BlockPointIds.resize(numberOfBlocks);
+  buildFunctor.BlockWeights.resize(numberOfBlocks);
+  if (parallel)
+    {
+    vtkSMPTools::For(0,numberOfBlocks,1,buildFunctor);
+    }
+  else
+    {
+    buildFunctor(0,numberOfBlocks);
+    }
+
+  this->ItemOffsets[0] = 0;
+  for (vtkIdType pointId=0; pointId<numPts; pointId++)
+    {
+    this->ItemOffsets[pointId+1] += this->ItemOffsets[pointId];
+    }
+
+  vtkIdType numberOfIds = this->ItemOffsets[numPts];
+  this->ItemPointIds = new vtkIdType[numberOfIds > 0 ? numberOfIds : 1];
+  if (this->ItemNumberOfComponents > 0)
+    {
+    this->ItemWeights = new double[numberOfIds > 0 ? this->ItemNumberOfComponents*numberOfIds : 1];
+    }
+
+  vtkvmtkDataSetItemsCopyFunctor copyFunctor;
+  copyFunctor.Build = &buildFunctor;
+  copyFunctor.Offsets = this->ItemOffsets;
+  copyFunctor.PointIds = this->ItemPointIds;
+  copyFunctor.Weights = this->ItemWeights;
+  vtkSMPTools::For(0,numberOfBlocks,1,copyFunctor);
+
+  // item objects are created on demand by BuildItemView
+  this->Size = numPts;
+  this->Array = new vtkvmtkItem*[numPts > 0 ? numPts : 1];
+  for (vtkIdType pointId=0; pointId<numPts; pointId++)
+    {
+    this->Array[pointId] = NULL;
+    }
+  this->MaxId = numPts - 1;
+  }
+
+int vtkvmtkDataSetItems::Rebuild(vtkIdList* pointIds)
+  {
+  if (this->DataSet==NULL)
+    {
+    vtkErrorMacro(<<"No DataSet specified.");
+    return 0;
+    }
+
+  vtkIdType numberOfIds = pointIds->GetNumberOfIds();
+  if (!this->GetIsCompact())
+    {
+    if (this->Array==NULL)
+      {
+      vtkErrorMacro(<<"Items have not been built.");
+      return 0;
+      }
+    for (vtkIdType k=0; k<numberOfIds; k++)
+      {
+      vtkvmtkDataSetItem* dataSetItem = vtkvmtkDataSetItem::SafeDownCast(this->Array[pointIds->GetId(k)]);
+      if (dataSetItem)
+        {
+        dataSetItem->Build();
+        }
+      }
+    return 1;
+    }
+
+  return this->RebuildCompact(pointIds->GetPointer(0),numberOfIds);
+  }
+
+int vtkvmtkDataSetItems::RebuildCompact(const vtkIdType* pointIds, vtkIdType numberOfIds)
+  {
+  if (numberOfIds == 0)
+    {
+    return 1;
+    }
+
+  std::vector<unsigned char> mismatches(numberOfIds,0);
+
+  vtkvmtkDataSetItemsRebuildFunctor rebuildFunctor;
+  rebuildFunctor.Items = this;
+  rebuildFunctor.PointIds = pointIds;
+  rebuildFunctor.Mismatches = &mismatches[0];
+  if (this->PrepareParallelBuild())
+    {
+    vtkSMPTools::For(0,numberOfIds,64,rebuildFunctor);
+    }
+  else
+    {
+    rebuildFunctor(0,numberOfIds);
+    }
+
+  for (vtkIdType k=0; k<numberOfIds; k++)
+    {
+    if (mismatches[k])
+      {
+      return 0;
+      }
+    }
+  return 1;
+  }
+
+void vtkvmtkDataSetItems::BuildItemView(vtkIdType id)
+  {
+  if (!this->GetIsCompact())
+    {
+    return;
+    }
+
+  vtkvmtkItem* item = this->InstantiateNewItem(this->ItemType);
+  vtkvmtkNeighborhood* neighborhood = vtkvmtkNeighborhood::SafeDownCast(item);
+  if (neighborhood==NULL)
+    {
+    return;
+    }
+
+  neighborhood->SetDataSet(this->DataSet);
+  neighborhood->SetDataSetPointId(id);
+
+  vtkIdType offset = this->ItemOffsets[id];
+  vtkIdType numberOfPoints = this->ItemOffsets[id+1] - offset;
+  bool isBoundary = this->ItemBoundaryFlags[id] != 0;
+
+  vtkvmtkStencil* stencil = vtkvmtkStencil::SafeDownCast(item);
+  if (stencil)
+    {
+    stencil->SetView(numberOfPoints,this->ItemPointIds+offset,isBoundary,this->ItemNumberOfComponents,this->ItemWeights+this->ItemNumberOfComponents*offset,this->ItemCenterWeights+this->ItemNumberOfComponents*id);
+    }
+  else
+    {
+    neighborhood->SetView(numberOfPoints,this->ItemPointIds+offset,isBoundary);
+    }
+
+  this->Array[id] = item;
+  }
@@ -27,6 +27,16 @@
  * neighborhood item appropriate to the data set type (poly data, unstructured grid, manifold
  * surface, ...).
  *
+ * By default (StorageMode compact) the built items are not kept as one object per point: the point
+ * ids, boundary flags and, for stencils, the weights of all items are stored in flat arrays indexed
+ * by point through an offset array (GetItemOffsets(), GetItemPointIds(), ...), and the items are
+ * built in parallel over blocks of points, each thread building into its own scratch item.
+ * GetItem() still returns a vtkvmtkNeighborhood/vtkvmtkStencil for any point, created on first
+ * access as a view on the flat arrays; views share the storage of the collection, must not be
+ * built again and are invalidated by the next Build(). Since views are created lazily, code
+ * running on several threads should read the flat arrays instead of calling GetItem(). StorageMode
+ * objects keeps the original one-object-per-point storage.
+ *
  * @sa
  * vtkvmtkItems, vtkvmtkDataSetItem, vtkvmtkNeighborhoods
  */
@@ -40,6 +50,11 @@
 //#include "vtkvmtkDifferentialGeometryWin32Header.h"
 #include "vtkvmtkWin32Header.h"
 
+class vtkIdList;
+
+#define VTK_VMTK_DATASET_ITEMS_OBJECTS 0
+#define VTK_VMTK_DATASET_ITEMS_COMPACT 1
+
 class VTK_VMTK_DIFFERENTIAL_GEOMETRY_EXPORT vtkvmtkDataSetItems : public vtkvmtkItems 
 {
 public:
@@ -60,10 +75,60 @@ public:
   /**
    * Allocate (if not already allocated, or if ReallocateOnBuild is on) one item per point of
    * DataSet, then build each item in turn by assigning it DataSet and its point id and calling its
-   * Build() method.
+   * Build() method. In compact storage mode, the items are built in parallel and stored in the
+   * flat arrays described above; when ReallocateOnBuild is off and the collection keeps built
+   * items (as vtkvmtkStencils does), later calls reuse the flat arrays and only build the items
+   * again into them, so that stencil weights follow the current point coordinates.
    */
   void Build();
 
+  /**
+   * Build again, in place, the items of the points listed in pointIds, e.g. after those points or
+   * their neighbors have moved. The mesh connectivity must not have changed since the last
+   * Build(): in compact storage mode, the items are rebuilt in parallel into the existing flat
+   * arrays, and 0 is returned without completing the update if an item no longer has the number
+   * of points it had (Build() must then be called with ReallocateOnBuild on). Returns 1 on
+   * success.
+   */
+  int Rebuild(vtkIdList* pointIds);
+
+  ///@{
+  /**
+   * Set/get how built items are stored: VTK_VMTK_DATASET_ITEMS_COMPACT (flat arrays shared by all
+   * points, items returned by GetItem() are views) or VTK_VMTK_DATASET_ITEMS_OBJECTS (one item
+   * object per point, built serially). Takes effect at the next Build(). Default: compact.
+   */
+  vtkSetClampMacro(StorageMode,int,VTK_VMTK_DATASET_ITEMS_OBJECTS,VTK_VMTK_DATASET_ITEMS_COMPACT);
+  vtkGetMacro(StorageMode,int);
+  void SetStorageModeToObjects()
+    {this->SetStorageMode(VTK_VMTK_DATASET_ITEMS_OBJECTS);};
+  void SetStorageModeToCompact()
+    {this->SetStorageMode(VTK_VMTK_DATASET_ITEMS_COMPACT);};
+  ///@}
+
+  /**
+   * Return 1 if the collection currently holds compact items, i.e. if it was last built in compact
+   * storage mode and the flat arrays below are valid.
+   */
+  int GetIsCompact() {return this->ItemOffsets != NULL;};
+
+  ///@{
+  /**
+   * Get the flat arrays of a compact collection (NULL otherwise). The point ids of the item of
+   * point i are ItemPointIds[ItemOffsets[i]] to ItemPointIds[ItemOffsets[i+1]-1]; for stencils,
+   * the weights of the j-th of those points are the ItemNumberOfComponents values starting at
+   * ItemWeights[ItemNumberOfComponents*j] and the center weights of point i start at
+   * ItemCenterWeights[ItemNumberOfComponents*i]. ItemWeights and ItemCenterWeights are NULL for
+   * neighborhoods. ItemBoundaryFlags[i] is 1 if point i lies on the boundary.
+   */
+  const vtkIdType* GetItemOffsets() {return this->ItemOffsets;};
+  const vtkIdType* GetItemPointIds() {return this->ItemPointIds;};
+  const unsigned char* GetItemBoundaryFlags() {return this->ItemBoundaryFlags;};
+  const double* GetItemWeights() {return this->ItemWeights;};
+  const double* GetItemCenterWeights() {return this->ItemCenterWeights;};
+  vtkIdType GetItemNumberOfComponents() {return this->ItemNumberOfComponents;};
+  ///@}
+
   ///@{
   /**
    * Toggle whether Build() is forced to reallocate the item array even if it has already been
@@ -76,13 +141,45 @@ public:
   ///@}
 
 protected:
-  vtkvmtkDataSetItems() {}
-  ~vtkvmtkDataSetItems() {}
+  vtkvmtkDataSetItems();
+  ~vtkvmtkDataSetItems();
+
+  void BuildObjects();
+  void BuildCompact();
+
+  // Whether items can be built concurrently on DataSet. Builds the links of DataSet, so that items
+  // can then query them from any thread.
+  int PrepareParallelBuild();
+
+  // Builds again, in parallel, the items of numberOfIds points (of points 0 to numberOfIds-1 if
+  // pointIds is NULL) into the existing flat arrays. Returns 0 if the number of points of an item
+  // has changed.
+  int RebuildCompact(const vtkIdType* pointIds, vtkIdType numberOfIds);
+
+  virtual void BuildItemView(vtkIdType id) override;
+  virtual void ReleaseCompactStorage() override;
+
+  // Whether the storage of items already built for the current data set can be kept when Build()
+  // is called again with ReallocateOnBuild off, as vtkvmtkStencil::Build() does for its own
+  // storage. The items themselves are always built again.
+  virtual int GetReuseBuiltItems() {return 0;};
 
   vtkDataSet *DataSet;
 
   int ReallocateOnBuild;
 
+  int StorageMode;
+
+  vtkIdType* ItemOffsets;
+  vtkIdType* ItemPointIds;
+  unsigned char* ItemBoundaryFlags;
+  double* ItemWeights;
+  double* ItemCenterWeights;
+  vtkIdType ItemNumberOfComponents;
+
+  friend class vtkvmtkDataSetItemsBuildFunctor;
+  friend class vtkvmtkDataSetItemsRebuildFunctor;
+
 private:
   vtkvmtkDataSetItems(const vtkvmtkDataSetItems&);  // Not implemented.
   void operator=(const vtkvmtkDataSetItems&);  // Not implemented.
@@ -54,6 +54,9 @@ protected:
   vtkvmtkDirichletBoundaryConditions() {};
   ~vtkvmtkDirichletBoundaryConditions() {};
 
+  // Apply on a compressed system matrix, working on its arrays instead of its rows.
+  void ApplyCompressed(vtkvmtkSparseMatrix* systemMatrix, vtkvmtkDoubleVector* rhsVector);
+
 private:
   vtkvmtkDirichletBoundaryConditions(const vtkvmtkDirichletBoundaryConditions&);  // Not implemented.
   void operator=(const vtkvmtkDirichletBoundaryConditions&);  // Not implemented.
@@ -22,8 +22,150 @@
 #include "vtkvmtkFEAssembler.h"
 #include "vtkvmtkGaussQuadrature.h"
 #include "vtkvmtkFEShapeFunctions.h"
+#include "vtkCell.h"
+#include "vtkCellType.h"
+#include "vtkIdList.h"
+#include "vtkSMPTools.h"
 #include "vtkObjectFactory.h"
 
+#include <vector>
+
+// Quadrature rule and shape functions of one cell type on the parametric cell, evaluated once per
+// cell type and quadrature order.
+class vtkvmtkFEReferenceElement
+{
+public:
+  int CellType;
+  int Order;
+  int CellDimension;
+  int NumberOfPoints;
+  int NumberOfQuadraturePoints;
+  std::vector<double> QuadratureWeights;
+  // NumberOfQuadraturePoints x NumberOfPoints shape function values
+  std::vector<double> Phi;
+  // NumberOfQuadraturePoints x CellDimension x NumberOfPoints parametric derivatives, laid out as
+  // returned by vtkvmtkFEShapeFunctions::GetInterpolationDerivs at each quadrature point
+  std::vector<double> Derivs;
+};
+
+class vtkvmtkFEAssemblerInternals
+{
+public:
+  std::vector<vtkvmtkFEReferenceElement> ReferenceElements;
+
+  // Elements of the current AssembleElements() call: cell id, reference element and point ids
+  // (offsets into ElementPointIds, NumberOfElements+1 entries)
+  std::vector<vtkIdType> ElementCellIds;
+  std::vector<int> ElementReferences;
+  std::vector<vtkIdType> ElementPointOffsets;
+  std::vector<vtkIdType> ElementPointIds;
+
+  int GetReferenceElement(vtkCell* cell, int cellType, int order)
+    {
+    int numberOfReferenceElements = static_cast<int>(this->ReferenceElements.size());
+    int r;
+    for (r=0; r<numberOfReferenceElements; r++)
+      {
+      if (this->ReferenceElements[r].CellType == cellType && this->ReferenceElements[r].Order == order)
+        {
+        return r;
+        }
+      }
+
+    vtkvmtkFEReferenceElement referenceElement;
+    referenceElement.CellType = cellType;
+    referenceElement.Order = order;
+    referenceElement.CellDimension = cell->GetCellDimension();
+    referenceElement.NumberOfPoints = cell->GetNumberOfPoints();
+    referenceElement.NumberOfQuadraturePoints = 0;
+
+    // shape function gradients are only defined for surface and volume elements
+    if (referenceElement.CellDimension == 2 || referenceElement.CellDimension == 3)
+      {
+      vtkvmtkGaussQuadrature* gaussQuadrature = vtkvmtkGaussQuadrature::New();
+      gaussQuadrature->SetOrder(order);
+      gaussQuadrature->Initialize(cellType);
+
+      int numberOfPoints = referenceElement.NumberOfPoints;
+      int numberOfDerivs = referenceElement.CellDimension * numberOfPoints;
+      int numberOfQuadraturePoints = gaussQuadrature->GetNumberOfQuadraturePoints();
+      referenceElement.NumberOfQuadraturePoints = numberOfQuadraturePoints;
+      referenceElement.QuadratureWeights.resize(numberOfQuadraturePoints);
+      referenceElement.Phi.resize(numberOfQuadraturePoints*numberOfPoints);
+      referenceElement.Derivs.resize(numberOfQuadraturePoints*numberOfDerivs);
+
+      int q;
+      for (q=0; q<numberOfQuadraturePoints; q++)
+        {
+        double* quadraturePCoords = gaussQuadrature->GetQuadraturePoint(q);
+        referenceElement.QuadratureWeights[q] = gaussQuadrature->GetQuadratureWeight(q);
+        vtkvmtkFEShapeFunctions::GetInterpolationFunctions(cell,quadraturePCoords,&referenceElement.Phi[q*numberOfPoints]);
+        vtkvmtkFEShapeFunctions::GetInterpolationDerivs(cell,quadraturePCoords,&referenceElement.Derivs[q*numberOfDerivs]);
+        }
+
+      gaussQuadrature->Delete();
+      }
+
+    this->ReferenceElements.push_back(referenceElement);
+    return numberOfReferenceElements;
+    }
+};
+
+// Maps the reference element to each physical element of a range and hands it to
+// vtkvmtkFEAssembler::AssembleElement. vtkDataSet::GetPoint(vtkIdType,double*) is thread-safe.
+class vtkvmtkFEAssemblerElementsFunctor
+{
+public:
+  vtkvmtkFEAssembler* Assembler;
+  vtkvmtkFEAssemblerInternals* Internals;
+  const vtkIdType* ElementIds;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    vtkDataSet* dataSet = this->Assembler->DataSet;
+    std::vector<double> cellPoints;
+    std::vector<double> dphi;
+    std::vector<double> jacobians;
+    vtkvmtkFEElement element;
+
+    vtkIdType n;
+    for (n=begin; n<end; n++)
+      {
+      vtkIdType elementId = this->ElementIds ? this->ElementIds[n] : n;
+      const vtkvmtkFEReferenceElement& referenceElement = this->Internals->ReferenceElements[this->Internals->ElementReferences[elementId]];
+      int numberOfPoints = referenceElement.NumberOfPoints;
+      int numberOfQuadraturePoints = referenceElement.NumberOfQuadraturePoints;
+      int numberOfDerivs = referenceElement.CellDimension * numberOfPoints;
+      const vtkIdType* pointIds = &this->Internals->ElementPointIds[this->Internals->ElementPointOffsets[elementId]];
+
+      cellPoints.resize(3*numberOfPoints);
+      dphi.resize(3*numberOfQuadraturePoints*numberOfPoints);
+      jacobians.resize(numberOfQuadraturePoints);
+
+      int i, q;
+      for (i=0; i<numberOfPoints; i++)
+        {
+        dataSet->GetPoint(pointIds[i],&cellPoints[3*i]);
+        }
+      for (q=0; q<numberOfQuadraturePoints; q++)
+        {
+        jacobians[q] = vtkvmtkFEShapeFunctions::ComputeDPhi(referenceElement.CellDimension,numberOfPoints,&cellPoints[0],&referenceElement.Derivs[q*numberOfDerivs],&dphi[3*q*numberOfPoints]);
+        }
+
+      element.CellId = this->Internals->ElementCellIds[elementId];
+      element.NumberOfPoints = numberOfPoints;
+      element.PointIds = pointIds;
+      element.NumberOfQuadraturePoints = numberOfQuadraturePoints;
+      element.QuadratureWeights = &referenceElement.QuadratureWeights[0];
+      element.Phi = &referenceElement.Phi[0];
+      element.DPhi = &dphi[0];
+      element.Jacobians = &jacobians[0];
+
+      this->Assembler->AssembleElement(&element);
+      }
+    }
+};
+
 
 
 vtkvmtkFEAssembler::vtkvmtkFEAssembler()
@@ -34,6 +176,8 @@ vtkvmtkFEAssembler::vtkvmtkFEAssembler()
   this->SolutionVector = NULL;
   this->NumberOfVariables = 1;
   this->QuadratureOrder = 1;
+  this->ParallelAssembly = 1;
+  this->Internals = new vtkvmtkFEAssemblerInternals;
 }
 
 vtkvmtkFEAssembler::~vtkvmtkFEAssembler()
@@ -58,6 +202,7 @@ vtkvmtkFEAssembler::~vtkvmtkFEAssembler()
     this->SolutionVector->Delete();
     this->SolutionVector = NULL;
     }
+  delete this->Internals;
 }
 
 void vtkvmtkFEAssembler::Initialize(int numberOfVariables)
@@ -73,6 +218,143 @@ void vtkvmtkFEAssembler::Initialize(int numberOfVariables)
   this->SolutionVector->Fill(0.0);
 }
 
+void vtkvmtkFEAssembler::AssembleElements(int cellDimension)
+{
+  vtkvmtkFEAssemblerInternals* internals = this->Internals;
+  internals->ElementCellIds.clear();
+  internals->ElementReferences.clear();
+  internals->ElementPointOffsets.clear();
+  internals->ElementPointIds.clear();
+
+  // Gather the elements serially (GetCell and GetCellPoints are not thread-safe), looking up the
+  // reference element once per cell type.
+  std::vector<int> referenceElementIds(VTK_NUMBER_OF_CELL_TYPES,-1);
+  vtkIdList* cellPointIds = vtkIdList::New();
+  internals->ElementPointOffsets.push_back(0);
+  vtkIdType numberOfCells = this->DataSet->GetNumberOfCells();
+  vtkIdType k;
+  for (k=0; k<numberOfCells; k++)
+    {
+    int cellType = this->DataSet->GetCellType(k);
+    int r = referenceElementIds[cellType];
+    if (r == -1)
+      {
+      r = internals->GetReferenceElement(this->DataSet->GetCell(k),cellType,this->QuadratureOrder);
+      referenceElementIds[cellType] = r;
+      }
+    const vtkvmtkFEReferenceElement& referenceElement = internals->ReferenceElements[r];
+    if (referenceElement.CellDimension != cellDimension || referenceElement.NumberOfQuadraturePoints == 0)
+      {
+      continue;
+      }
+    this->DataSet->GetCellPoints(k,cellPointIds);
+    vtkIdType numberOfCellPoints = cellPointIds->GetNumberOfIds();
+    if (numberOfCellPoints != referenceElement.NumberOfPoints)
+      {
+      continue;
+      }
+    internals->ElementCellIds.push_back(k);
+    internals->ElementReferences.push_back(r);
+    internals->ElementPointIds.insert(internals->ElementPointIds.end(),cellPointIds->GetPointer(0),cellPointIds->GetPointer(0)+numberOfCellPoints);
+    internals->ElementPointOffsets.push_back(static_cast<vtkIdType>(internals->ElementPointIds.size()));
+    }
+  cellPointIds->Delete();
+
+  vtkIdType numberOfElements = static_cast<vtkIdType>(internals->ElementCellIds.size());
+
+  vtkvmtkFEAssemblerElementsFunctor functor;
+  functor.Assembler = this;
+  functor.Internals = internals;
+  functor.ElementIds = NULL;
+
+  if (!this->ParallelAssembly)
+    {
+    functor(0,numberOfElements);
+    return;
+    }
+
+  // Greedy coloring: each element takes the first color not used by any element sharing one of its
+  // points, tracked with a 128-bit mask per point. Elements of one color write to disjoint rows of
+  // Matrix and entries of RHSVector. The few elements for which all colors are taken (only on very
+  // irregular meshes) end up in a last batch that is assembled serially.
+  const int numberOfColors = 128;
+  const int numberOfMaskWords = numberOfColors / 64;
+  vtkIdType numberOfPoints = this->DataSet->GetNumberOfPoints();
+  std::vector<vtkTypeUInt64> pointColorMasks(numberOfMaskWords*numberOfPoints,0);
+  std::vector<int> elementColors(numberOfElements);
+  std::vector<vtkIdType> colorOffsets(numberOfColors+2,0);
+  vtkIdType e;
+  for (e=0; e<numberOfElements; e++)
+    {
+    const vtkIdType* pointIds = &internals->ElementPointIds[internals->ElementPointOffsets[e]];
+    vtkIdType numberOfElementPoints = internals->ElementPointOffsets[e+1] - internals->ElementPointOffsets[e];
+    vtkTypeUInt64 usedColors[numberOfMaskWords] = { 0 };
+    vtkIdType i;
+    int w;
+    for (i=0; i<numberOfElementPoints; i++)
+      {
+      for (w=0; w<numberOfMaskWords; w++)
+        {
+        usedColors[w] |= pointColorMasks[numberOfMaskWords*pointIds[i]+w];
+        }
+      }
+    int color = numberOfColors;
+    for (w=0; w<numberOfMaskWords && color==numberOfColors; w++)
+      {
+      if (usedColors[w] != ~static_cast<vtkTypeUInt64>(0))
+        {
+        int bit = 0;
+        while (usedColors[w] & (static_cast<vtkTypeUInt64>(1) << bit))
+          {
+          bit++;
+          }
+        color = 64*w + bit;
+        }
+      }
+    if (color < numberOfColors)
+      {
+      for (i=0; i<numberOfElementPoints; i++)
+        {
+        pointColorMasks[numberOfMaskWords*pointIds[i]+color/64] |= static_cast<vtkTypeUInt64>(1) << (color%64);
+        }
+      }
+    elementColors[e] = color;
+    colorOffsets[color+1]++;
+    }
+
+  int c;
+  for (c=0; c<numberOfColors+1; c++)
+    {
+    colorOffsets[c+1] += colorOffsets[c];
+    }
+  std::vector<vtkIdType> elementIds(numberOfElements);
+  std::vector<vtkIdType> colorPositions(colorOffsets.begin(),colorOffsets.end()-1);
+  for (e=0; e<numberOfElements; e++)
+    {
+    elementIds[colorPositions[elementColors[e]]++] = e;
+    }
+
+  if (numberOfElements > 0)
+    {
+    functor.ElementIds = &elementIds[0];
+    }
+  for (c=0; c<numberOfColors+1; c++)
+    {
+    if (colorOffsets[c] == colorOffsets[c+1])
+      {
+      continue;
+      }
+    if (c == numberOfColors)
+      {
+      functor(colorOffsets[c],colorOffsets[c+1]);
+      }
+    else
+      {
+      vtkSMPTools::For(colorOffsets[c],colorOffsets[c+1],256,functor);
+      }
+    }
+}
+
 void vtkvmtkFEAssembler::DeepCopy(vtkvmtkFEAssembler *src)
 {
   this->DataSet->DeepCopy(src->DataSet);
@@ -81,6 +363,7 @@ void vtkvmtkFEAssembler::DeepCopy(vtkvmtkFEAssembler *src)
   this->SolutionVector->DeepCopy(src->SolutionVector);
   this->NumberOfVariables = src->NumberOfVariables;
   this->QuadratureOrder = src->QuadratureOrder;
+  this->ParallelAssembly = src->ParallelAssembly;
 }
  
 void vtkvmtkFEAssembler::ShallowCopy(vtkvmtkFEAssembler *src)
@@ -95,5 +378,6 @@ void vtkvmtkFEAssembler::ShallowCopy(vtkvmtkFEAssembler *src)
   this->SolutionVector->Register(this);
   this->NumberOfVariables = src->NumberOfVariables;
   this->QuadratureOrder = src->QuadratureOrder;
+  this->ParallelAssembly = src->ParallelAssembly;
 }
 
@@ -30,6 +30,12 @@
  * that subclasses call from their constructor/Build() to allocate Matrix and the vectors for a
  * given number of variables.
  *
+ * Subclasses may instead implement AssembleElement() and call AssembleElements() from Build(). The
+ * quadrature rule, shape functions and parametric shape function derivatives are then computed once
+ * per cell type (a reference element, kept between Build() calls), so that only the mapping to the
+ * physical cell is computed per element. With ParallelAssembly on, elements are split into batches
+ * that share no point, and the elements of a batch are assembled concurrently with vtkSMPTools.
+ *
  * @sa
  * vtkvmtkGaussQuadrature, vtkvmtkFEShapeFunctions, vtkvmtkLinearSystem, vtkvmtkDoubleVector
  */
@@ -41,8 +47,11 @@
 #include "vtkPolyData.h"
 #include "vtkvmtkSparseMatrix.h"
 #include "vtkvmtkDoubleVector.h"
+#include "vtkvmtkFEElement.h"
 #include "vtkvmtkWin32Header.h"
 
+class vtkvmtkFEAssemblerInternals;
+
 class VTK_VMTK_DIFFERENTIAL_GEOMETRY_EXPORT vtkvmtkFEAssembler : public vtkObject
 {
 public:
@@ -95,6 +104,18 @@ public:
   vtkGetMacro(QuadratureOrder,int);
   ///@}
 
+  ///@{
+  /**
+   * Set/get whether AssembleElements() assembles elements concurrently. Elements sharing no point
+   * are grouped in batches (by greedy coloring) and each batch is assembled in parallel, so that
+   * contributions are summed into Matrix and RHSVector in batch order rather than in cell order;
+   * results may then differ from serial assembly in the last digits. Default: on.
+   */
+  vtkSetMacro(ParallelAssembly,int);
+  vtkGetMacro(ParallelAssembly,int);
+  vtkBooleanMacro(ParallelAssembly,int);
+  ///@}
+
   /**
    * Assemble the finite-element system (Matrix and RHSVector) from DataSet. Implemented by
    * subclasses for a specific PDE/discretization.
@@ -102,14 +123,14 @@ public:
   virtual void Build() = 0;
 
   /**
-   * Deep-copy DataSet, Matrix, RHSVector, SolutionVector, NumberOfVariables and QuadratureOrder
-   * from src into this assembler.
+   * Deep-copy DataSet, Matrix, RHSVector, SolutionVector, NumberOfVariables, QuadratureOrder and
+   * ParallelAssembly from src into this assembler.
    */
   void DeepCopy(vtkvmtkFEAssembler *src);
 
   /**
    * Share (reference-count, without copying) DataSet, Matrix, RHSVector and SolutionVector with
-   * src, and copy NumberOfVariables and QuadratureOrder.
+   * src, and copy NumberOfVariables, QuadratureOrder and ParallelAssembly.
    */
   void ShallowCopy(vtkvmtkFEAssembler *src);
 
@@ -119,6 +140,19 @@ protected:
 
   void Initialize(int numberOfVariables);
 
+  /**
+   * Call AssembleElement() on every cell of DataSet of the given dimension, serially in cell order
+   * or in parallel batches depending on ParallelAssembly. Cells of unsupported types are skipped.
+   */
+  void AssembleElements(int cellDimension);
+
+  /**
+   * Add the contributions of one element to Matrix and RHSVector. Called concurrently on elements
+   * sharing no point when ParallelAssembly is on, so implementations must only write to the
+   * entries of the element points and must not modify the state of the assembler.
+   */
+  virtual void AssembleElement(vtkvmtkFEElement* vtkNotUsed(element)) {}
+
   vtkDataSet* DataSet;
   vtkvmtkSparseMatrix* Matrix;
   vtkvmtkDoubleVector* RHSVector;
@@ -126,8 +160,13 @@ protected:
 
   int NumberOfVariables;
   int QuadratureOrder;
+  int ParallelAssembly;
+
+  vtkvmtkFEAssemblerInternals* Internals;
 
 private:
+  friend class vtkvmtkFEAssemblerElementsFunctor;
+
   vtkvmtkFEAssembler(const vtkvmtkFEAssembler&);  // Not implemented.
   void operator=(const vtkvmtkFEAssembler&);  // Not implemented.
 };
@@ -0,0 +1,72 @@
+/*=========================================================================
+
+  Program:   VMTK
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENSE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/**
+ * @class   vtkvmtkFEElement
+ * @brief   Shape functions of one finite element evaluated at its quadrature points.
+ * @ingroup DifferentialGeometry
+ *
+ * vtkvmtkFEElement is what vtkvmtkFEAssembler::AssembleElements hands to the AssembleElement method
+ * of its subclasses for every cell: the cell id and point ids, the quadrature weights, and, at every
+ * quadrature point q, the values Phi and physical-space gradients DPhi of the shape function of
+ * every cell point i, together with the Jacobian of the parametric-to-physical mapping. It holds the
+ * same quantities as vtkvmtkGaussQuadrature and vtkvmtkFEShapeFunctions after their Initialize()
+ * calls, as plain arrays that are valid only during the AssembleElement call.
+ *
+ * This is a plain C++ class, not a vtkObject.
+ *
+ * @sa
+ * vtkvmtkFEAssembler, vtkvmtkFEShapeFunctions, vtkvmtkGaussQuadrature
+ */
+
+#ifndef __vtkvmtkFEElement_h
+#define __vtkvmtkFEElement_h
+
+#include "vtkType.h"
+
+class vtkvmtkFEElement
+{
+  public:
+
+  vtkIdType GetCellId() const { return this->CellId; }
+  int GetNumberOfPoints() const { return this->NumberOfPoints; }
+  vtkIdType GetPointId(int i) const { return this->PointIds[i]; }
+  int GetNumberOfQuadraturePoints() const { return this->NumberOfQuadraturePoints; }
+  double GetQuadratureWeight(int q) const { return this->QuadratureWeights[q]; }
+  double GetJacobian(int q) const { return this->Jacobians[q]; }
+
+  /**
+   * Value of the shape function of the i-th cell point at the q-th quadrature point.
+   */
+  double GetPhi(int q, int i) const { return this->Phi[q*this->NumberOfPoints+i]; }
+
+  /**
+   * Physical-space gradient (3 components) of the shape function of the i-th cell point at the q-th
+   * quadrature point.
+   */
+  const double* GetDPhi(int q, int i) const { return this->DPhi + 3*(q*this->NumberOfPoints+i); }
+
+  vtkIdType CellId;
+  int NumberOfPoints;
+  const vtkIdType* PointIds;
+  int NumberOfQuadraturePoints;
+  const double* QuadratureWeights;
+  const double* Phi;
+  const double* DPhi;
+  const double* Jacobians;
+};
+
+#endif
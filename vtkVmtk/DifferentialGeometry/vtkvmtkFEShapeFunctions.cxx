@@ -78,57 +78,151 @@ void vtkvmtkFEShapeFunctions::Initialize(vtkCell* cell, vtkDoubleArray* pcoords)
   this->Jacobians->Initialize();
   this->Jacobians->SetNumberOfTuples(numberOfPCoords);
 
-  int i;
+  int i, j;
+
+  double* cellPoints = new double[3*numberOfCellPoints];
+  for (j=0; j<numberOfCellPoints; j++)
+  {
+    cell->GetPoints()->GetPoint(j,cellPoints+3*j);
+  }
+
+  double* sf = new double[numberOfCellPoints];
+  double* derivs = new double[3*numberOfCellPoints];
+  double* dphi = new double[3*numberOfCellPoints];
 
-  //Phi
   for (i=0; i<numberOfPCoords; i++)
   {
-    double* sf = new double[numberOfCellPoints];
+    //Phi
     this->GetInterpolationFunctions(cell,pcoords->GetTuple(i),sf);
-    int j;
     for (j=0; j<numberOfCellPoints; j++)
     {
       this->Phi->SetValue(i*numberOfCellPoints+j,sf[j]);
     }
-    delete[] sf;
 
-    //DPhi
-    double* derivs = new double[cellDimension*numberOfCellPoints];
+    //DPhi and Jacobians
     this->GetInterpolationDerivs(cell,pcoords->GetTuple(i),derivs);
-    if (cellDimension == 2)
+    double jacobian = this->ComputeDPhi(cellDimension,numberOfCellPoints,cellPoints,derivs,dphi);
+    if (cellDimension == 2 || cellDimension == 3)
     {
-      double inverseJacobianMatrix[2][3];
-      this->ComputeInverseJacobianMatrix2D(cell,pcoords->GetTuple(i),inverseJacobianMatrix);
       for (j=0; j<numberOfCellPoints; j++)
       {
-        int k;
-        for (k=0; k<3; k++)
-        {
-          double dphik = derivs[j] * inverseJacobianMatrix[0][k] + derivs[j+numberOfCellPoints] * inverseJacobianMatrix[1][k];
-          this->DPhi->SetComponent(i*numberOfCellPoints+j,k,dphik);
-        }
+        this->DPhi->SetTuple(i*numberOfCellPoints+j,dphi+3*j);
       }
     }
-    else if (cellDimension == 3)
+    this->Jacobians->SetValue(i,jacobian);
+  }
+
+  delete[] cellPoints;
+  delete[] sf;
+  delete[] derivs;
+  delete[] dphi;
+}
+
+double vtkvmtkFEShapeFunctions::ComputeDPhi(int cellDimension, vtkIdType numberOfCellPoints, const double* cellPoints, const double* derivs, double* dphi)
+{
+  int i, j, k;
+  double jacobian = 0.0;
+
+  if (cellDimension == 2)
+  {
+    double jacobianMatrixTr[2][3];
+    for (i=0; i<3; i++)
     {
-      double inverseJacobianMatrix[3][3];
-      this->ComputeInverseJacobianMatrix3D(cell,pcoords->GetTuple(i),inverseJacobianMatrix);
-      for (j=0; j<numberOfCellPoints; j++)
+      jacobianMatrixTr[0][i] = jacobianMatrixTr[1][i] = 0.0;
+    }
+    for (j=0; j<numberOfCellPoints; j++)
+    {
+      const double* x = cellPoints + 3*j;
+      for (i=0; i<3; i++)
       {
-        int k;
-        for (k=0; k<3; k++)
-        {
-          double dphik = derivs[j] * inverseJacobianMatrix[0][k] + derivs[j+numberOfCellPoints] * inverseJacobianMatrix[1][k] + derivs[j+2*numberOfCellPoints] * inverseJacobianMatrix[2][k];
-          this->DPhi->SetComponent(i*numberOfCellPoints+j,k,dphik);
-        }
+        jacobianMatrixTr[0][i] += x[i] * derivs[j];
+        jacobianMatrixTr[1][i] += x[i] * derivs[numberOfCellPoints+j];
       }
     }
-    delete[] derivs;
 
-    //Jacobians
-    double jacobian = this->ComputeJacobian(cell,pcoords->GetTuple(i));
-    this->Jacobians->SetValue(i,jacobian);
+    double jacobianMatrixSquared[2][2];
+    jacobianMatrixSquared[0][0] = vtkMath::Dot(jacobianMatrixTr[0],jacobianMatrixTr[0]);
+    jacobianMatrixSquared[0][1] = vtkMath::Dot(jacobianMatrixTr[0],jacobianMatrixTr[1]);
+    jacobianMatrixSquared[1][0] = vtkMath::Dot(jacobianMatrixTr[1],jacobianMatrixTr[0]);
+    jacobianMatrixSquared[1][1] = vtkMath::Dot(jacobianMatrixTr[1],jacobianMatrixTr[1]);
+
+    double jacobianSquared = vtkMath::Determinant2x2(jacobianMatrixSquared[0],jacobianMatrixSquared[1]);
+
+    if (jacobianSquared < 0.0)
+    {
+#ifdef VTKVMTKFESHAPEFUNCTIONS_NEGATIVE_JACOBIAN_WARNING 
+      vtkGenericWarningMacro("Warning: negative determinant of squared Jacobian, taking absolute value.");
+#endif
+      jacobianSquared = fabs(jacobianSquared);
+    }
+
+    double inverseJacobianSquared = 1.0 / jacobianSquared;
+
+    double inverseJacobianMatrixSquared[2][2];
+    inverseJacobianMatrixSquared[0][0] =  jacobianMatrixSquared[1][1] * inverseJacobianSquared;
+    inverseJacobianMatrixSquared[0][1] = -jacobianMatrixSquared[0][1] * inverseJacobianSquared;
+    inverseJacobianMatrixSquared[1][0] = -jacobianMatrixSquared[1][0] * inverseJacobianSquared;
+    inverseJacobianMatrixSquared[1][1] =  jacobianMatrixSquared[0][0] * inverseJacobianSquared;
+
+    double inverseJacobianMatrix[2][3];
+    for (k=0; k<3; k++)
+    {
+      inverseJacobianMatrix[0][k] = inverseJacobianMatrixSquared[0][0] * jacobianMatrixTr[0][k] + inverseJacobianMatrixSquared[0][1] * jacobianMatrixTr[1][k];
+      inverseJacobianMatrix[1][k] = inverseJacobianMatrixSquared[1][0] * jacobianMatrixTr[0][k] + inverseJacobianMatrixSquared[1][1] * jacobianMatrixTr[1][k];
+    }
+
+    for (j=0; j<numberOfCellPoints; j++)
+    {
+      for (k=0; k<3; k++)
+      {
+        dphi[3*j+k] = derivs[j] * inverseJacobianMatrix[0][k] + derivs[j+numberOfCellPoints] * inverseJacobianMatrix[1][k];
+      }
+    }
+
+    jacobian = sqrt(jacobianSquared);
   }
+  else if (cellDimension == 3)
+  {
+    double jacobianMatrix[3][3];
+    for (i=0; i<3; i++)
+    {
+      jacobianMatrix[0][i] = jacobianMatrix[1][i] = jacobianMatrix[2][i] = 0.0;
+    }
+    for (j=0; j<numberOfCellPoints; j++)
+    {
+      const double* x = cellPoints + 3*j;
+      for (i=0; i<3; i++)
+      {
+        jacobianMatrix[0][i] += x[i] * derivs[j];
+        jacobianMatrix[1][i] += x[i] * derivs[numberOfCellPoints+j];
+        jacobianMatrix[2][i] += x[i] * derivs[2*numberOfCellPoints+j];
+      }
+    }
+
+    double inverseJacobianMatrix[3][3];
+    vtkMath::Invert3x3(jacobianMatrix,inverseJacobianMatrix);
+    vtkMath::Transpose3x3(inverseJacobianMatrix,inverseJacobianMatrix);
+
+    for (j=0; j<numberOfCellPoints; j++)
+    {
+      for (k=0; k<3; k++)
+      {
+        dphi[3*j+k] = derivs[j] * inverseJacobianMatrix[0][k] + derivs[j+numberOfCellPoints] * inverseJacobianMatrix[1][k] + derivs[j+2*numberOfCellPoints] * inverseJacobianMatrix[2][k];
+      }
+    }
+
+    jacobian = vtkMath::Determinant3x3(jacobianMatrix);
+
+    if (jacobian < 0.0)
+    {
+#ifdef VTKVMTKFESHAPEFUNCTIONS_NEGATIVE_JACOBIAN_WARNING 
+      vtkGenericWarningMacro("Warning: negative Jacobian, taking absolute value.");
+#endif
+      jacobian = fabs(jacobian);
+    }
+  }
+
+  return jacobian;
 }
 
 void vtkvmtkFEShapeFunctions::ComputeInverseJacobianMatrix2D(vtkCell* cell, double* pcoords, double inverseJacobianMatrix[2][3])
@@ -116,6 +116,16 @@ public:
    */
   static double ComputeJacobian(vtkCell* cell, double* pcoords);
 
+  /**
+   * Compute, into dphi (3 components per node), the physical-space gradients of the shape functions
+   * of a 2D or 3D cell with numberOfCellPoints nodes at cellPoints (3 coordinates per node), given
+   * their parametric derivatives derivs at one parametric point, laid out as returned by
+   * GetInterpolationDerivs. Returns the Jacobian of the mapping at that point, as ComputeJacobian
+   * does. Only plain arrays are accessed, so the method can be called concurrently; derivs can be
+   * computed once per cell type and parametric point and reused for every cell.
+   */
+  static double ComputeDPhi(int cellDimension, vtkIdType numberOfCellPoints, const double* cellPoints, const double* derivs, double* dphi);
+
 protected:
   vtkvmtkFEShapeFunctions();
   ~vtkvmtkFEShapeFunctions();
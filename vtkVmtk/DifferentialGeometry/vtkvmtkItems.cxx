@@ -46,6 +46,7 @@ void vtkvmtkItems::Allocate(vtkIdType sz, vtkIdType ext)
     delete [] this->Array;
     this->Array = NULL;
     }
+  this->ReleaseCompactStorage();
 
   this->Size = sz;
   this->Array = new vtkvmtkItem*[sz];
@@ -60,7 +61,10 @@ void vtkvmtkItems::Allocate(vtkIdType sz, vtkIdType ext)
 
 void vtkvmtkItems::AllocateItem(vtkIdType i, vtkIdType itemType)
   {
-  this->Array[i]->Delete();
+  if (this->Array[i])
+    {
+    this->Array[i]->UnRegister(this);
+    }
   this->Array[i] = InstantiateNewItem(itemType);
   }
 
@@ -68,7 +72,10 @@ void vtkvmtkItems::ReleaseArray()
   {
   for (vtkIdType i=0; i<this->Size; i++)
     {
-    this->Array[i]->UnRegister(this);
+    if (this->Array[i])
+      {
+      this->Array[i]->UnRegister(this);
+      }
     }
   }
 
@@ -145,13 +152,17 @@ void vtkvmtkItems::ShallowCopy(vtkvmtkItems *src)
     delete [] this->Array;
     this->Array = NULL;
     }
+  this->ReleaseCompactStorage();
 
   this->Array = new vtkvmtkItem*[src->Size];
 
   for (vtkIdType i=0; i<src->Size; i++)
     {
-    this->Array[i] = src->Array[i];
-    this->Array[i]->Register(this);
+    this->Array[i] = i<=src->MaxId ? src->GetItem(i) : src->Array[i];
+    if (this->Array[i])
+      {
+      this->Array[i]->Register(this);
+      }
     }
 
   this->MaxId = src->MaxId;
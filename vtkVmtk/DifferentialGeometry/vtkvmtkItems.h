@@ -61,9 +61,17 @@ public:
   void Allocate(vtkIdType numItems, vtkIdType ext=1000);
 
   /**
-   * Get the item stored at index id.
+   * Get the item stored at index id. Collections holding their items in compact form (see
+   * vtkvmtkDataSetItems::StorageMode) create the item as a view on first access.
    */
-  vtkvmtkItem* GetItem(vtkIdType id) {return this->Array[id];};
+  vtkvmtkItem* GetItem(vtkIdType id)
+    {
+    if (!this->Array[id])
+      {
+      this->BuildItemView(id);
+      }
+    return this->Array[id];
+    };
 
   ///@{
   /**
@@ -106,7 +114,9 @@ public:
   void DeepCopy(vtkvmtkItems *src);
 
   /**
-   * Standard ShallowCopy method.
+   * Standard ShallowCopy method. Items of src that are views on compact storage (see
+   * vtkvmtkDataSetItems::StorageMode) stay valid only as long as src is not built again or
+   * destroyed.
    */
   void ShallowCopy(vtkvmtkItems *src);
 
@@ -116,6 +126,11 @@ protected:
 
   virtual vtkvmtkItem* InstantiateNewItem(int itemType) = 0;
 
+  // Creates Array[id] for a collection whose items are stored in compact form, and frees that
+  // compact storage once the items are stored as objects again; no-ops by default.
+  virtual void BuildItemView(vtkIdType vtkNotUsed(id)) {};
+  virtual void ReleaseCompactStorage() {};
+
   vtkvmtkItem** Array;   // pointer to data
   vtkIdType Size;       // allocated size of data
   vtkIdType MaxId;     // maximum index inserted thus far
@@ -0,0 +1,999 @@
+/*=========================================================================
+
+  Program:   VMTK
+  Module:    $RCSfile: vtkvmtkKrylovLinearSystemSolver.cxx,v $
+  Language:  C++
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENSE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "vtkvmtkKrylovLinearSystemSolver.h"
+#include "vtkvmtkSparseMatrix.h"
+#include "vtkvmtkSparseMatrixRow.h"
+#include "vtkvmtkDoubleVector.h"
+#include "vtkvmtkConstants.h"
+#include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#define VTK_VMTK_KRYLOV_GRAIN 1024
+#define VTK_VMTK_KRYLOV_DOT_BLOCK_SIZE 4096
+#define VTK_VMTK_KRYLOV_JACOBI_DAMPING (2.0/3.0)
+#define VTK_VMTK_KRYLOV_AMG_MAXIMUM_NUMBER_OF_LEVELS 10
+#define VTK_VMTK_KRYLOV_AMG_COARSE_SIZE 128
+#define VTK_VMTK_KRYLOV_AMG_MAXIMUM_DIRECT_SIZE 1024
+
+
+// Row-sorted compressed sparse rows, diagonal included (possibly as an explicit zero).
+class vtkvmtkKrylovMatrix
+{
+public:
+  vtkvmtkKrylovMatrix() : NumberOfRows(0) {}
+
+  void Initialize()
+    {
+    this->NumberOfRows = 0;
+    this->Offsets.assign(1,0);
+    this->Ids.clear();
+    this->Values.clear();
+    this->DiagonalPositions.clear();
+    }
+
+  // Appends row NumberOfRows from unsorted (column, value) entries: duplicates are summed and a
+  // diagonal entry is added if missing.
+  void AppendRow(std::vector<std::pair<vtkIdType,double> >& entries)
+    {
+    vtkIdType rowId = this->NumberOfRows;
+    entries.push_back(std::make_pair(rowId,0.0));
+    std::sort(entries.begin(),entries.end());
+    size_t k = 0;
+    while (k < entries.size())
+      {
+      vtkIdType columnId = entries[k].first;
+      double value = 0.0;
+      while (k < entries.size() && entries[k].first == columnId)
+        {
+        value += entries[k].second;
+        k++;
+        }
+      if (columnId == rowId)
+        {
+        this->DiagonalPositions.push_back(static_cast<vtkIdType>(this->Ids.size()));
+        }
+      this->Ids.push_back(columnId);
+      this->Values.push_back(value);
+      }
+    this->Offsets.push_back(static_cast<vtkIdType>(this->Ids.size()));
+    this->NumberOfRows++;
+    }
+
+  vtkIdType NumberOfRows;
+  std::vector<vtkIdType> Offsets;
+  std::vector<vtkIdType> Ids;
+  std::vector<double> Values;
+  std::vector<vtkIdType> DiagonalPositions;
+};
+
+class vtkvmtkKrylovAMGLevel
+{
+public:
+  vtkvmtkKrylovMatrix A;
+  std::vector<double> InverseDiagonal;
+  // coarse unknown of every unknown on this level, -1 for isolated unknowns; empty on the coarsest level
+  std::vector<vtkIdType> Aggregates;
+  std::vector<double> X;
+  std::vector<double> B;
+  std::vector<double> R;
+};
+
+class vtkvmtkKrylovLinearSystemSolverInternals
+{
+public:
+  vtkvmtkKrylovLinearSystemSolverInternals()
+    {
+    this->BuiltPreconditionerType = -1;
+    this->BuiltNumberOfRows = 0;
+    this->BuiltNumberOfNonZeros = 0;
+    }
+
+  void Initialize()
+    {
+    this->A.Initialize();
+    this->InverseDiagonal.clear();
+    this->Factors.clear();
+    this->Levels.clear();
+    this->CoarseFactors.clear();
+    this->CoarsePivots.clear();
+    this->BuiltPreconditionerType = -1;
+    this->BuiltNumberOfRows = 0;
+    this->BuiltNumberOfNonZeros = 0;
+    }
+
+  vtkvmtkKrylovMatrix A;
+
+  int BuiltPreconditionerType;
+  vtkIdType BuiltNumberOfRows;
+  vtkIdType BuiltNumberOfNonZeros;
+
+  // Jacobi
+  std::vector<double> InverseDiagonal;
+
+  // ILU(0), L (unit diagonal, not stored) and U on the pattern of A
+  std::vector<double> Factors;
+
+  // AMG
+  std::vector<vtkvmtkKrylovAMGLevel> Levels;
+  std::vector<double> CoarseFactors;
+  std::vector<vtkIdType> CoarsePivots;
+};
+
+class vtkvmtkKrylovMultiplyFunctor
+{
+public:
+  const vtkvmtkKrylovMatrix* A;
+  const double* X;
+  double* Y;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    const vtkIdType* offsets = &this->A->Offsets[0];
+    const vtkIdType* ids = &this->A->Ids[0];
+    const double* values = &this->A->Values[0];
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      double yValue = 0.0;
+      for (vtkIdType k=offsets[i]; k<offsets[i+1]; k++)
+        {
+        yValue += values[k] * this->X[ids[k]];
+        }
+      this->Y[i] = yValue;
+      }
+    }
+};
+
+// Partial sums over fixed blocks of VTK_VMTK_KRYLOV_DOT_BLOCK_SIZE elements, so that the result
+// does not depend on how blocks are distributed among threads.
+class vtkvmtkKrylovDotFunctor
+{
+public:
+  vtkIdType NumberOfElements;
+  const double* X;
+  const double* Y;
+  double* PartialSums;
+
+  void operator()(vtkIdType beginBlock, vtkIdType endBlock)
+    {
+    for (vtkIdType block=beginBlock; block<endBlock; block++)
+      {
+      vtkIdType begin = block * VTK_VMTK_KRYLOV_DOT_BLOCK_SIZE;
+      vtkIdType end = std::min(begin + VTK_VMTK_KRYLOV_DOT_BLOCK_SIZE,this->NumberOfElements);
+      double sum = 0.0;
+      for (vtkIdType i=begin; i<end; i++)
+        {
+        sum += this->X[i] * this->Y[i];
+        }
+      this->PartialSums[block] = sum;
+      }
+    }
+};
+
+// One damped Jacobi sweep, XNew = X + w D^-1 (B - A X).
+class vtkvmtkKrylovJacobiFunctor
+{
+public:
+  const vtkvmtkKrylovMatrix* A;
+  const double* InverseDiagonal;
+  const double* B;
+  const double* X;
+  double* XNew;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    const vtkIdType* offsets = &this->A->Offsets[0];
+    const vtkIdType* ids = &this->A->Ids[0];
+    const double* values = &this->A->Values[0];
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      double residual = this->B[i];
+      for (vtkIdType k=offsets[i]; k<offsets[i+1]; k++)
+        {
+        residual -= values[k] * this->X[ids[k]];
+        }
+      this->XNew[i] = this->X[i] + VTK_VMTK_KRYLOV_JACOBI_DAMPING * this->InverseDiagonal[i] * residual;
+      }
+    }
+};
+
+static void vtkvmtkKrylovMultiply(const vtkvmtkKrylovMatrix& a, const double* x, double* y)
+{
+  if (a.NumberOfRows == 0)
+    {
+    return;
+    }
+  vtkvmtkKrylovMultiplyFunctor functor;
+  functor.A = &a;
+  functor.X = x;
+  functor.Y = y;
+  vtkSMPTools::For(0,a.NumberOfRows,VTK_VMTK_KRYLOV_GRAIN,functor);
+}
+
+static double vtkvmtkKrylovDot(vtkIdType n, const double* x, const double* y)
+{
+  if (n == 0)
+    {
+    return 0.0;
+    }
+  vtkIdType numberOfBlocks = (n + VTK_VMTK_KRYLOV_DOT_BLOCK_SIZE - 1) / VTK_VMTK_KRYLOV_DOT_BLOCK_SIZE;
+  std::vector<double> partialSums(numberOfBlocks);
+  vtkvmtkKrylovDotFunctor functor;
+  functor.NumberOfElements = n;
+  functor.X = x;
+  functor.Y = y;
+  functor.PartialSums = &partialSums[0];
+  vtkSMPTools::For(0,numberOfBlocks,1,functor);
+  double dot = 0.0;
+  for (vtkIdType block=0; block<numberOfBlocks; block++)
+    {
+    dot += partialSums[block];
+    }
+  return dot;
+}
+
+static void vtkvmtkKrylovComputeInverseDiagonal(const vtkvmtkKrylovMatrix& a, std::vector<double>& inverseDiagonal)
+{
+  inverseDiagonal.resize(a.NumberOfRows);
+  for (vtkIdType i=0; i<a.NumberOfRows; i++)
+    {
+    double diagonal = a.Values[a.DiagonalPositions[i]];
+    inverseDiagonal[i] = fabs(diagonal) > VTK_VMTK_PIVOTING_TOL ? 1.0 / diagonal : 1.0;
+    }
+}
+
+// Aggregates the unknowns of a through their strong connections (plain aggregation: new
+// aggregates made of a point and all its free strong neighbors, then remaining points attached to
+// the aggregate of their strongest aggregated neighbor, then leftovers grouped). Unknowns without
+// strong connections (e.g. Dirichlet rows) are left out of the coarse level. Returns the number of
+// aggregates.
+static vtkIdType vtkvmtkKrylovAggregate(const vtkvmtkKrylovMatrix& a, double threshold, std::vector<vtkIdType>& aggregates)
+{
+  vtkIdType i, k;
+  vtkIdType n = a.NumberOfRows;
+
+  std::vector<double> diagonal(n);
+  for (i=0; i<n; i++)
+    {
+    diagonal[i] = fabs(a.Values[a.DiagonalPositions[i]]);
+    }
+
+  std::vector<vtkIdType> strongOffsets(n+1,0);
+  std::vector<vtkIdType> strongIds;
+  std::vector<double> strongValues;
+  for (i=0; i<n; i++)
+    {
+    for (k=a.Offsets[i]; k<a.Offsets[i+1]; k++)
+      {
+      vtkIdType j = a.Ids[k];
+      double value = fabs(a.Values[k]);
+      if (j != i && value > 0.0 && value >= threshold * sqrt(diagonal[i] * diagonal[j]))
+        {
+        strongIds.push_back(j);
+        strongValues.push_back(value);
+        }
+      }
+    strongOffsets[i+1] = static_cast<vtkIdType>(strongIds.size());
+    }
+
+  const vtkIdType isolated = -2;
+  aggregates.assign(n,-1);
+  for (i=0; i<n; i++)
+    {
+    if (strongOffsets[i+1] == strongOffsets[i])
+      {
+      aggregates[i] = isolated;
+      }
+    }
+
+  vtkIdType numberOfAggregates = 0;
+  for (i=0; i<n; i++)
+    {
+    if (aggregates[i] != -1)
+      {
+      continue;
+      }
+    bool isFree = true;
+    for (k=strongOffsets[i]; k<strongOffsets[i+1]; k++)
+      {
+      if (aggregates[strongIds[k]] != -1)
+        {
+        isFree = false;
+        break;
+        }
+      }
+    if (!isFree)
+      {
+      continue;
+      }
+    aggregates[i] = numberOfAggregates;
+    for (k=strongOffsets[i]; k<strongOffsets[i+1]; k++)
+      {
+      aggregates[strongIds[k]] = numberOfAggregates;
+      }
+    numberOfAggregates++;
+    }
+
+  std::vector<vtkIdType> firstPassAggregates(aggregates);
+  for (i=0; i<n; i++)
+    {
+    if (aggregates[i] != -1)
+      {
+      continue;
+      }
+    double maximumStrength = 0.0;
+    for (k=strongOffsets[i]; k<strongOffsets[i+1]; k++)
+      {
+      vtkIdType aggregate = firstPassAggregates[strongIds[k]];
+      if (aggregate >= 0 && strongValues[k] > maximumStrength)
+        {
+        maximumStrength = strongValues[k];
+        aggregates[i] = aggregate;
+        }
+      }
+    }
+
+  for (i=0; i<n; i++)
+    {
+    if (aggregates[i] != -1)
+      {
+      continue;
+      }
+    aggregates[i] = numberOfAggregates;
+    for (k=strongOffsets[i]; k<strongOffsets[i+1]; k++)
+      {
+      if (aggregates[strongIds[k]] == -1)
+        {
+        aggregates[strongIds[k]] = numberOfAggregates;
+        }
+      }
+    numberOfAggregates++;
+    }
+
+  for (i=0; i<n; i++)
+    {
+    if (aggregates[i] == isolated)
+      {
+      aggregates[i] = -1;
+      }
+    }
+
+  return numberOfAggregates;
+}
+
+// Galerkin coarse operator P^T A P for the piecewise constant prolongation defined by aggregates.
+static void vtkvmtkKrylovBuildCoarseMatrix(const vtkvmtkKrylovMatrix& a, const std::vector<vtkIdType>& aggregates, vtkIdType numberOfAggregates, vtkvmtkKrylovMatrix& coarse)
+{
+  vtkIdType i, k;
+  vtkIdType n = a.NumberOfRows;
+
+  std::vector<vtkIdType> memberOffsets(numberOfAggregates+1,0);
+  for (i=0; i<n; i++)
+    {
+    if (aggregates[i] >= 0)
+      {
+      memberOffsets[aggregates[i]+1]++;
+      }
+    }
+  for (i=0; i<numberOfAggregates; i++)
+    {
+    memberOffsets[i+1] += memberOffsets[i];
+    }
+  std::vector<vtkIdType> memberIds(memberOffsets[numberOfAggregates]);
+  std::vector<vtkIdType> insertPositions(memberOffsets.begin(),memberOffsets.end()-1);
+  for (i=0; i<n; i++)
+    {
+    if (aggregates[i] >= 0)
+      {
+      memberIds[insertPositions[aggregates[i]]++] = i;
+      }
+    }
+
+  coarse.Initialize();
+  std::vector<std::pair<vtkIdType,double> > entries;
+  for (vtkIdType aggregate=0; aggregate<numberOfAggregates; aggregate++)
+    {
+    entries.clear();
+    for (vtkIdType m=memberOffsets[aggregate]; m<memberOffsets[aggregate+1]; m++)
+      {
+      i = memberIds[m];
+      for (k=a.Offsets[i]; k<a.Offsets[i+1]; k++)
+        {
+        vtkIdType coarseId = aggregates[a.Ids[k]];
+        if (coarseId >= 0)
+          {
+          entries.push_back(std::make_pair(coarseId,a.Values[k]));
+          }
+        }
+      }
+    coarse.AppendRow(entries);
+    }
+}
+
+vtkStandardNewMacro(vtkvmtkKrylovLinearSystemSolver);
+
+vtkvmtkKrylovLinearSystemSolver::vtkvmtkKrylovLinearSystemSolver()
+{
+  this->SolverType = VTK_VMTK_KRYLOV_SOLVER_CG;
+  this->PreconditionerType = VTK_VMTK_KRYLOV_PRECONDITIONER_ILU0;
+  this->UseInitialGuess = 1;
+  this->ReusePreconditioner = 0;
+  this->AMGStrengthThreshold = 0.08;
+  this->AMGNumberOfSmoothingSweeps = 2;
+
+  this->Internals = new vtkvmtkKrylovLinearSystemSolverInternals;
+}
+
+vtkvmtkKrylovLinearSystemSolver::~vtkvmtkKrylovLinearSystemSolver()
+{
+  delete this->Internals;
+  this->Internals = NULL;
+}
+
+void vtkvmtkKrylovLinearSystemSolver::ReleasePreconditioner()
+{
+  this->Internals->Initialize();
+}
+
+void vtkvmtkKrylovLinearSystemSolver::BuildPreconditioner()
+{
+  vtkIdType i, j, k, q;
+  vtkvmtkKrylovLinearSystemSolverInternals* internals = this->Internals;
+  const vtkvmtkKrylovMatrix& a = internals->A;
+  vtkIdType n = a.NumberOfRows;
+
+  internals->InverseDiagonal.clear();
+  internals->Factors.clear();
+  internals->Levels.clear();
+  internals->CoarseFactors.clear();
+  internals->CoarsePivots.clear();
+
+  switch (this->PreconditionerType)
+    {
+    case VTK_VMTK_KRYLOV_PRECONDITIONER_JACOBI:
+      vtkvmtkKrylovComputeInverseDiagonal(a,internals->InverseDiagonal);
+      break;
+    case VTK_VMTK_KRYLOV_PRECONDITIONER_ILU0:
+      {
+      std::vector<double>& factors = internals->Factors;
+      factors = a.Values;
+      std::vector<vtkIdType> positions(n,-1);
+      for (i=0; i<n; i++)
+        {
+        for (k=a.Offsets[i]; k<a.Offsets[i+1]; k++)
+          {
+          positions[a.Ids[k]] = k;
+          }
+        for (k=a.Offsets[i]; k<a.DiagonalPositions[i]; k++)
+          {
+          j = a.Ids[k];
+          factors[k] /= factors[a.DiagonalPositions[j]];
+          for (q=a.DiagonalPositions[j]+1; q<a.Offsets[j+1]; q++)
+            {
+            if (positions[a.Ids[q]] != -1)
+              {
+              factors[positions[a.Ids[q]]] -= factors[k] * factors[q];
+              }
+            }
+          }
+        if (fabs(factors[a.DiagonalPositions[i]]) < VTK_VMTK_PIVOTING_TOL)
+          {
+          factors[a.DiagonalPositions[i]] = 1.0;
+          }
+        for (k=a.Offsets[i]; k<a.Offsets[i+1]; k++)
+          {
+          positions[a.Ids[k]] = -1;
+          }
+        }
+      }
+      break;
+    case VTK_VMTK_KRYLOV_PRECONDITIONER_AMG:
+      {
+      std::vector<vtkvmtkKrylovAMGLevel>& levels = internals->Levels;
+      levels.resize(1);
+      levels[0].A = a;
+      while (true)
+        {
+        vtkvmtkKrylovAMGLevel& level = levels.back();
+        vtkIdType levelSize = level.A.NumberOfRows;
+        vtkvmtkKrylovComputeInverseDiagonal(level.A,level.InverseDiagonal);
+        level.X.assign(levelSize,0.0);
+        level.B.assign(levelSize,0.0);
+        level.R.assign(levelSize,0.0);
+        if (levelSize <= VTK_VMTK_KRYLOV_AMG_COARSE_SIZE || static_cast<int>(levels.size()) == VTK_VMTK_KRYLOV_AMG_MAXIMUM_NUMBER_OF_LEVELS)
+          {
+          break;
+          }
+        std::vector<vtkIdType> aggregates;
+        vtkIdType numberOfAggregates = vtkvmtkKrylovAggregate(level.A,this->AMGStrengthThreshold,aggregates);
+        if (numberOfAggregates == 0 || numberOfAggregates > 0.9 * levelSize)
+          {
+          break;
+          }
+        level.Aggregates.swap(aggregates);
+        vtkvmtkKrylovAMGLevel coarseLevel;
+        vtkvmtkKrylovBuildCoarseMatrix(level.A,level.Aggregates,numberOfAggregates,coarseLevel.A);
+        levels.push_back(coarseLevel);
+        }
+
+      // dense LU with partial pivoting of the coarsest operator; if coarsening stalled on a large
+      // level, the coarsest level is smoothed instead
+      const vtkvmtkKrylovMatrix& coarse = levels.back().A;
+      vtkIdType m = coarse.NumberOfRows;
+      if (m > 0 && m <= VTK_VMTK_KRYLOV_AMG_MAXIMUM_DIRECT_SIZE)
+        {
+        std::vector<double>& lu = internals->CoarseFactors;
+        std::vector<vtkIdType>& pivots = internals->CoarsePivots;
+        lu.assign(m*m,0.0);
+        pivots.resize(m);
+        for (i=0; i<m; i++)
+          {
+          for (k=coarse.Offsets[i]; k<coarse.Offsets[i+1]; k++)
+            {
+            lu[i*m+coarse.Ids[k]] = coarse.Values[k];
+            }
+          }
+        for (k=0; k<m; k++)
+          {
+          vtkIdType pivot = k;
+          for (i=k+1; i<m; i++)
+            {
+            if (fabs(lu[i*m+k]) > fabs(lu[pivot*m+k]))
+              {
+              pivot = i;
+              }
+            }
+          pivots[k] = pivot;
+          if (pivot != k)
+            {
+            std::swap_ranges(lu.begin()+k*m,lu.begin()+(k+1)*m,lu.begin()+pivot*m);
+            }
+          if (fabs(lu[k*m+k]) < VTK_VMTK_PIVOTING_TOL)
+            {
+            lu[k*m+k] = 1.0;
+            }
+          for (i=k+1; i<m; i++)
+            {
+            double factor = lu[i*m+k] /= lu[k*m+k];
+            for (j=k+1; j<m; j++)
+              {
+              lu[i*m+j] -= factor * lu[k*m+j];
+              }
+            }
+          }
+        }
+      }
+      break;
+    }
+
+  internals->BuiltPreconditionerType = this->PreconditionerType;
+  internals->BuiltNumberOfRows = n;
+  internals->BuiltNumberOfNonZeros = static_cast<vtkIdType>(a.Ids.size());
+}
+
+// One V-cycle on level levelId, approximately solving A_level x = b from x = 0.
+static void vtkvmtkKrylovVCycle(vtkvmtkKrylovLinearSystemSolverInternals* internals, size_t levelId, int numberOfSweeps, const double* b, double* x)
+{
+  vtkIdType i, k;
+  vtkvmtkKrylovAMGLevel& level = internals->Levels[levelId];
+  vtkIdType n = level.A.NumberOfRows;
+  if (n == 0)
+    {
+    return;
+    }
+
+  bool coarsest = levelId + 1 == internals->Levels.size();
+  if (coarsest && !internals->CoarseFactors.empty())
+    {
+    const std::vector<double>& lu = internals->CoarseFactors;
+    const std::vector<vtkIdType>& pivots = internals->CoarsePivots;
+    std::copy(b,b+n,x);
+    for (k=0; k<n; k++)
+      {
+      std::swap(x[k],x[pivots[k]]);
+      }
+    for (i=0; i<n; i++)
+      {
+      for (k=0; k<i; k++)
+        {
+        x[i] -= lu[i*n+k] * x[k];
+        }
+      }
+    for (i=n-1; i>=0; i--)
+      {
+      for (k=i+1; k<n; k++)
+        {
+        x[i] -= lu[i*n+k] * x[k];
+        }
+      x[i] /= lu[i*n+i];
+      }
+    return;
+    }
+
+  vtkvmtkKrylovJacobiFunctor jacobiFunctor;
+  jacobiFunctor.A = &level.A;
+  jacobiFunctor.InverseDiagonal = &level.InverseDiagonal[0];
+  jacobiFunctor.B = b;
+
+  std::fill(x,x+n,0.0);
+  int preSweeps = coarsest ? 4*numberOfSweeps : numberOfSweeps;
+  for (int sweep=0; sweep<preSweeps; sweep++)
+    {
+    jacobiFunctor.X = x;
+    jacobiFunctor.XNew = &level.R[0];
+    vtkSMPTools::For(0,n,VTK_VMTK_KRYLOV_GRAIN,jacobiFunctor);
+    std::copy(level.R.begin(),level.R.end(),x);
+    }
+  if (coarsest)
+    {
+    return;
+    }
+
+  double* r = &level.R[0];
+  vtkvmtkKrylovMultiply(level.A,x,r);
+  for (i=0; i<n; i++)
+    {
+    r[i] = b[i] - r[i];
+    }
+
+  vtkvmtkKrylovAMGLevel& coarseLevel = internals->Levels[levelId+1];
+  std::fill(coarseLevel.B.begin(),coarseLevel.B.end(),0.0);
+  for (i=0; i<n; i++)
+    {
+    if (level.Aggregates[i] >= 0)
+      {
+      coarseLevel.B[level.Aggregates[i]] += r[i];
+      }
+    }
+  vtkvmtkKrylovVCycle(internals,levelId+1,numberOfSweeps,&coarseLevel.B[0],&coarseLevel.X[0]);
+  for (i=0; i<n; i++)
+    {
+    if (level.Aggregates[i] >= 0)
+      {
+      x[i] += coarseLevel.X[level.Aggregates[i]];
+      }
+    }
+
+  for (int sweep=0; sweep<numberOfSweeps; sweep++)
+    {
+    jacobiFunctor.X = x;
+    jacobiFunctor.XNew = &level.R[0];
+    vtkSMPTools::For(0,n,VTK_VMTK_KRYLOV_GRAIN,jacobiFunctor);
+    std::copy(level.R.begin(),level.R.end(),x);
+    }
+}
+
+void vtkvmtkKrylovLinearSystemSolver::ApplyPreconditioner(const double* r, double* z)
+{
+  vtkIdType i, k;
+  vtkvmtkKrylovLinearSystemSolverInternals* internals = this->Internals;
+  const vtkvmtkKrylovMatrix& a = internals->A;
+  vtkIdType n = a.NumberOfRows;
+
+  switch (internals->BuiltPreconditionerType)
+    {
+    case VTK_VMTK_KRYLOV_PRECONDITIONER_JACOBI:
+      for (i=0; i<n; i++)
+        {
+        z[i] = internals->InverseDiagonal[i] * r[i];
+        }
+      break;
+    case VTK_VMTK_KRYLOV_PRECONDITIONER_ILU0:
+      {
+      const std::vector<double>& factors = internals->Factors;
+      for (i=0; i<n; i++)
+        {
+        double value = r[i];
+        for (k=a.Offsets[i]; k<a.DiagonalPositions[i]; k++)
+          {
+          value -= factors[k] * z[a.Ids[k]];
+          }
+        z[i] = value;
+        }
+      for (i=n-1; i>=0; i--)
+        {
+        double value = z[i];
+        for (k=a.DiagonalPositions[i]+1; k<a.Offsets[i+1]; k++)
+          {
+          value -= factors[k] * z[a.Ids[k]];
+          }
+        z[i] = value / factors[a.DiagonalPositions[i]];
+        }
+      }
+      break;
+    case VTK_VMTK_KRYLOV_PRECONDITIONER_AMG:
+      vtkvmtkKrylovVCycle(internals,0,this->AMGNumberOfSmoothingSweeps,r,z);
+      break;
+    default:
+      std::copy(r,r+n,z);
+      break;
+    }
+}
+
+int vtkvmtkKrylovLinearSystemSolver::SolveCG(const double* b, double* x)
+{
+  vtkIdType i;
+  const vtkvmtkKrylovMatrix& a = this->Internals->A;
+  vtkIdType n = a.NumberOfRows;
+
+  std::vector<double> r(n), z(n), p(n), q(n);
+
+  double bNorm = sqrt(vtkvmtkKrylovDot(n,b,b));
+  if (bNorm == 0.0)
+    {
+    std::fill(x,x+n,0.0);
+    this->Residual = 0.0;
+    return 0;
+    }
+
+  vtkvmtkKrylovMultiply(a,x,&r[0]);
+  for (i=0; i<n; i++)
+    {
+    r[i] = b[i] - r[i];
+    }
+  this->Residual = sqrt(vtkvmtkKrylovDot(n,&r[0],&r[0])) / bNorm;
+  if (this->Residual <= this->ConvergenceTolerance)
+    {
+    return 0;
+    }
+
+  this->ApplyPreconditioner(&r[0],&z[0]);
+  p = z;
+  double rz = vtkvmtkKrylovDot(n,&r[0],&z[0]);
+
+  for (int iteration=1; iteration<=this->MaximumNumberOfIterations; iteration++)
+    {
+    vtkvmtkKrylovMultiply(a,&p[0],&q[0]);
+    double pq = vtkvmtkKrylovDot(n,&p[0],&q[0]);
+    if (pq == 0.0)
+      {
+      vtkWarningMacro(<<"CG breakdown at iteration "<<iteration<<".");
+      return -1;
+      }
+    double alpha = rz / pq;
+    for (i=0; i<n; i++)
+      {
+      x[i] += alpha * p[i];
+      r[i] -= alpha * q[i];
+      }
+
+    this->NumberOfIterations = iteration;
+    this->Residual = sqrt(vtkvmtkKrylovDot(n,&r[0],&r[0])) / bNorm;
+    if (this->Residual <= this->ConvergenceTolerance)
+      {
+      break;
+      }
+
+    this->ApplyPreconditioner(&r[0],&z[0]);
+    double rzNew = vtkvmtkKrylovDot(n,&r[0],&z[0]);
+    double beta = rzNew / rz;
+    rz = rzNew;
+    for (i=0; i<n; i++)
+      {
+      p[i] = z[i] + beta * p[i];
+      }
+    }
+
+  return 0;
+}
+
+int vtkvmtkKrylovLinearSystemSolver::SolveBiCGStab(const double* b, double* x)
+{
+  vtkIdType i;
+  const vtkvmtkKrylovMatrix& a = this->Internals->A;
+  vtkIdType n = a.NumberOfRows;
+
+  std::vector<double> r(n), rHat(n), p(n, 0.0), v(n, 0.0), pHat(n), s(n), sHat(n), t(n);
+
+  double bNorm = sqrt(vtkvmtkKrylovDot(n,b,b));
+  if (bNorm == 0.0)
+    {
+    std::fill(x,x+n,0.0);
+    this->Residual = 0.0;
+    return 0;
+    }
+
+  vtkvmtkKrylovMultiply(a,x,&r[0]);
+  for (i=0; i<n; i++)
+    {
+    r[i] = b[i] - r[i];
+    }
+  this->Residual = sqrt(vtkvmtkKrylovDot(n,&r[0],&r[0])) / bNorm;
+  if (this->Residual <= this->ConvergenceTolerance)
+    {
+    return 0;
+    }
+  rHat = r;
+
+  double rho = 1.0, alpha = 1.0, omega = 1.0;
+  for (int iteration=1; iteration<=this->MaximumNumberOfIterations; iteration++)
+    {
+    double rhoNew = vtkvmtkKrylovDot(n,&rHat[0],&r[0]);
+    if (rhoNew == 0.0)
+      {
+      vtkWarningMacro(<<"BiCGStab breakdown at iteration "<<iteration<<".");
+      return -1;
+      }
+    double beta = (rhoNew / rho) * (alpha / omega);
+    rho = rhoNew;
+    for (i=0; i<n; i++)
+      {
+      p[i] = r[i] + beta * (p[i] - omega * v[i]);
+      }
+
+    this->ApplyPreconditioner(&p[0],&pHat[0]);
+    vtkvmtkKrylovMultiply(a,&pHat[0],&v[0]);
+    double rHatV = vtkvmtkKrylovDot(n,&rHat[0],&v[0]);
+    if (rHatV == 0.0)
+      {
+      vtkWarningMacro(<<"BiCGStab breakdown at iteration "<<iteration<<".");
+      return -1;
+      }
+    alpha = rho / rHatV;
+    for (i=0; i<n; i++)
+      {
+      s[i] = r[i] - alpha * v[i];
+      }
+
+    this->NumberOfIterations = iteration;
+    double sNorm = sqrt(vtkvmtkKrylovDot(n,&s[0],&s[0])) / bNorm;
+    if (sNorm <= this->ConvergenceTolerance)
+      {
+      for (i=0; i<n; i++)
+        {
+        x[i] += alpha * pHat[i];
+        }
+      this->Residual = sNorm;
+      break;
+      }
+
+    this->ApplyPreconditioner(&s[0],&sHat[0]);
+    vtkvmtkKrylovMultiply(a,&sHat[0],&t[0]);
+    double tt = vtkvmtkKrylovDot(n,&t[0],&t[0]);
+    omega = tt != 0.0 ? vtkvmtkKrylovDot(n,&t[0],&s[0]) / tt : 0.0;
+    for (i=0; i<n; i++)
+      {
+      x[i] += alpha * pHat[i] + omega * sHat[i];
+      r[i] = s[i] - omega * t[i];
+      }
+
+    this->Residual = sqrt(vtkvmtkKrylovDot(n,&r[0],&r[0])) / bNorm;
+    if (this->Residual <= this->ConvergenceTolerance)
+      {
+      break;
+      }
+
+    if (omega == 0.0)
+      {
+      vtkWarningMacro(<<"BiCGStab breakdown at iteration "<<iteration<<".");
+      return -1;
+      }
+    }
+
+  return 0;
+}
+
+int vtkvmtkKrylovLinearSystemSolver::Solve()
+{
+  vtkIdType i, j;
+
+  if (this->Superclass::Solve()==-1)
+    {
+    return -1;
+    }
+
+  vtkvmtkSparseMatrix* system = this->LinearSystem->GetA();
+  vtkvmtkDoubleVector* rhs = this->LinearSystem->GetB();
+  vtkvmtkDoubleVector* solution = this->LinearSystem->GetX();
+
+  this->NumberOfIterations = 0;
+  this->Residual = VTK_VMTK_LARGE_DOUBLE;
+
+  vtkIdType numberOfRows = system->GetNumberOfRows();
+  if (numberOfRows == 0)
+    {
+    this->Residual = 0.0;
+    return 0;
+    }
+
+  vtkvmtkKrylovMatrix& a = this->Internals->A;
+  a.Initialize();
+  std::vector<std::pair<vtkIdType,double> > entries;
+  if (system->GetIsCompressed())
+    {
+    const vtkIdType* rowOffsets = system->GetRowOffsets();
+    const vtkIdType* columnIds = system->GetColumnIds();
+    const double* values = system->GetValues();
+    const double* diagonalValues = system->GetDiagonalValues();
+    a.Ids.reserve(rowOffsets[numberOfRows] + numberOfRows);
+    a.Values.reserve(rowOffsets[numberOfRows] + numberOfRows);
+    for (i=0; i<numberOfRows; i++)
+      {
+      entries.clear();
+      for (j=rowOffsets[i]; j<rowOffsets[i+1]; j++)
+        {
+        entries.push_back(std::make_pair(columnIds[j],values[j]));
+        }
+      entries.push_back(std::make_pair(i,diagonalValues[i]));
+      a.AppendRow(entries);
+      }
+    }
+  else
+    {
+    for (i=0; i<numberOfRows; i++)
+      {
+      vtkvmtkSparseMatrixRow* row = system->GetRow(i);
+      entries.clear();
+      for (j=0; j<row->GetNumberOfElements(); j++)
+        {
+        entries.push_back(std::make_pair(row->GetElementId(j),row->GetElement(j)));
+        }
+      entries.push_back(std::make_pair(i,row->GetDiagonalElement()));
+      a.AppendRow(entries);
+      }
+    }
+
+  if (!this->ReusePreconditioner ||
+      this->Internals->BuiltPreconditionerType != this->PreconditionerType ||
+      this->Internals->BuiltNumberOfRows != numberOfRows ||
+      this->Internals->BuiltNumberOfNonZeros != static_cast<vtkIdType>(a.Ids.size()))
+    {
+    this->BuildPreconditioner();
+    }
+
+  std::vector<double> b(rhs->GetArray(),rhs->GetArray()+numberOfRows);
+  std::vector<double> x(numberOfRows,0.0);
+  if (this->UseInitialGuess)
+    {
+    std::copy(solution->GetArray(),solution->GetArray()+numberOfRows,x.begin());
+    }
+
+  int result;
+  if (this->SolverType == VTK_VMTK_KRYLOV_SOLVER_BICGSTAB)
+    {
+    result = this->SolveBiCGStab(&b[0],&x[0]);
+    }
+  else
+    {
+    result = this->SolveCG(&b[0],&x[0]);
+    }
+
+  solution->Assign(numberOfRows,&x[0]);
+
+  return result;
+}
+
+void vtkvmtkKrylovLinearSystemSolver::PrintSelf(std::ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "SolverType: " << this->SolverType << "\n";
+  os << indent << "PreconditionerType: " << this->PreconditionerType << "\n";
+  os << indent << "UseInitialGuess: " << this->UseInitialGuess << "\n";
+  os << indent << "ReusePreconditioner: " << this->ReusePreconditioner << "\n";
+  os << indent << "AMGStrengthThreshold: " << this->AMGStrengthThreshold << "\n";
+  os << indent << "AMGNumberOfSmoothingSweeps: " << this->AMGNumberOfSmoothingSweeps << "\n";
+  os << indent << "NumberOfIterations: " << this->NumberOfIterations << "\n";
+  os << indent << "Residual: " << this->Residual << "\n";
+}
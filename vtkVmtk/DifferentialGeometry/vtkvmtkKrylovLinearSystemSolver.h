@@ -0,0 +1,194 @@
+/*=========================================================================
+
+  Program:   VMTK
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENSE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/**
+ * @class   vtkvmtkKrylovLinearSystemSolver
+ * @brief   Solve a linear system of equations with a preconditioned Krylov method.
+ * @ingroup DifferentialGeometry
+ *
+ * vtkvmtkKrylovLinearSystemSolver implements vtkvmtkLinearSystemSolver::Solve() directly on the
+ * vtkvmtkSparseMatrix / vtkvmtkDoubleVector held by LinearSystem, without going through an
+ * external library. The matrix is copied once per Solve() into a row-sorted compressed form
+ * (straight from the compressed arrays when the matrix is compressed, see
+ * vtkvmtkSparseMatrix::GetIsCompressed); matrix-vector products, dot products and Jacobi sweeps
+ * then run in parallel with vtkSMPTools. Dot products are accumulated over fixed blocks, so the
+ * result does not depend on the number of threads.
+ *
+ * Iterations start from the current content of the solution vector (X) when UseInitialGuess is
+ * on, so that a system solved again after a small change converges in a few iterations. When
+ * ReusePreconditioner is on, the preconditioner built by the previous Solve() is kept as long as
+ * the size and number of nonzeros of the matrix do not change. Convergence is reached when the
+ * residual norm relative to the norm of the right-hand side falls below ConvergenceTolerance.
+ *
+ * There are two solver types:
+ *    - VTK_VMTK_KRYLOV_SOLVER_CG = conjugate gradient, for symmetric positive definite systems
+ *    - VTK_VMTK_KRYLOV_SOLVER_BICGSTAB = biconjugate gradient stabilized method
+ *
+ * and four preconditioner types:
+ *    - VTK_VMTK_KRYLOV_PRECONDITIONER_NONE = no preconditioning
+ *    - VTK_VMTK_KRYLOV_PRECONDITIONER_JACOBI = Jacobi (diagonal) preconditioning
+ *    - VTK_VMTK_KRYLOV_PRECONDITIONER_ILU0 = zero fill-in incomplete LU factorization; on a
+ *      symmetric matrix this is the incomplete Cholesky factorization IC(0) written as L D L^T
+ *    - VTK_VMTK_KRYLOV_PRECONDITIONER_AMG = one V-cycle of aggregation algebraic multigrid, with
+ *      damped Jacobi smoothing and a direct solve on the coarsest level
+ *
+ * @sa vtkvmtkLinearSystemSolver, vtkvmtkOpenNLLinearSystemSolver
+ */
+
+#ifndef __vtkvmtkKrylovLinearSystemSolver_h
+#define __vtkvmtkKrylovLinearSystemSolver_h
+
+#include "vtkObject.h"
+#include "vtkvmtkLinearSystemSolver.h"
+#include "vtkvmtkWin32Header.h"
+
+class vtkvmtkKrylovLinearSystemSolverInternals;
+
+class VTK_VMTK_DIFFERENTIAL_GEOMETRY_EXPORT vtkvmtkKrylovLinearSystemSolver : public vtkvmtkLinearSystemSolver
+{
+public:
+  static vtkvmtkKrylovLinearSystemSolver* New();
+  vtkTypeMacro(vtkvmtkKrylovLinearSystemSolver,vtkvmtkLinearSystemSolver);
+  void PrintSelf(std::ostream& os, vtkIndent indent) override;
+
+  /**
+   * Solve the linear system currently set on LinearSystem with the solver and preconditioner
+   * selected by SolverType and PreconditionerType. Returns 0 on success, -1 if no linear system
+   * (or an incomplete one) has been set, or if the iteration broke down. Reaching
+   * MaximumNumberOfIterations without converging is not a failure: the last iterate is stored in
+   * the solution vector, and NumberOfIterations and Residual can be checked by the caller.
+   */
+  int Solve() override;
+
+  ///@{
+  /**
+   * Set/get the Krylov method used by Solve(): VTK_VMTK_KRYLOV_SOLVER_CG (the default) or
+   * VTK_VMTK_KRYLOV_SOLVER_BICGSTAB. CG requires the system matrix (and the preconditioner) to be
+   * symmetric positive definite; use BiCGStab for non-symmetric systems.
+   */
+  vtkSetMacro(SolverType,int);
+  vtkGetMacro(SolverType,int);
+  void SetSolverTypeToCG()
+    { this->SetSolverType(VTK_VMTK_KRYLOV_SOLVER_CG); }
+  void SetSolverTypeToBiCGStab()
+    { this->SetSolverType(VTK_VMTK_KRYLOV_SOLVER_BICGSTAB); }
+  ///@}
+
+  ///@{
+  /**
+   * Set/get the preconditioner applied by Solve(): VTK_VMTK_KRYLOV_PRECONDITIONER_NONE,
+   * VTK_VMTK_KRYLOV_PRECONDITIONER_JACOBI, VTK_VMTK_KRYLOV_PRECONDITIONER_ILU0 (the default) or
+   * VTK_VMTK_KRYLOV_PRECONDITIONER_AMG.
+   */
+  vtkSetMacro(PreconditionerType,int);
+  vtkGetMacro(PreconditionerType,int);
+  void SetPreconditionerTypeToNone()
+    { this->SetPreconditionerType(VTK_VMTK_KRYLOV_PRECONDITIONER_NONE); }
+  void SetPreconditionerTypeToJacobi()
+    { this->SetPreconditionerType(VTK_VMTK_KRYLOV_PRECONDITIONER_JACOBI); }
+  void SetPreconditionerTypeToILU0()
+    { this->SetPreconditionerType(VTK_VMTK_KRYLOV_PRECONDITIONER_ILU0); }
+  void SetPreconditionerTypeToAMG()
+    { this->SetPreconditionerType(VTK_VMTK_KRYLOV_PRECONDITIONER_AMG); }
+  ///@}
+
+  ///@{
+  /**
+   * Set/get whether iterations start from the current content of the solution vector instead of
+   * from zero. Default: on.
+   */
+  vtkSetMacro(UseInitialGuess,int);
+  vtkGetMacro(UseInitialGuess,int);
+  vtkBooleanMacro(UseInitialGuess,int);
+  ///@}
+
+  ///@{
+  /**
+   * Set/get whether the preconditioner built by the previous Solve() is reused when the matrix has
+   * the same number of rows and nonzeros. Only valid if the matrix values have changed little since
+   * the preconditioner was built. Default: off.
+   */
+  vtkSetMacro(ReusePreconditioner,int);
+  vtkGetMacro(ReusePreconditioner,int);
+  vtkBooleanMacro(ReusePreconditioner,int);
+  ///@}
+
+  ///@{
+  /**
+   * Set/get the strength threshold used by the AMG preconditioner to aggregate unknowns: a_ij is a
+   * strong connection if |a_ij| >= AMGStrengthThreshold * sqrt(|a_ii a_jj|). Default: 0.08.
+   */
+  vtkSetMacro(AMGStrengthThreshold,double);
+  vtkGetMacro(AMGStrengthThreshold,double);
+  ///@}
+
+  ///@{
+  /**
+   * Set/get the number of damped Jacobi sweeps performed before and after the coarse-grid
+   * correction on every AMG level. Default: 2.
+   */
+  vtkSetMacro(AMGNumberOfSmoothingSweeps,int);
+  vtkGetMacro(AMGNumberOfSmoothingSweeps,int);
+  ///@}
+
+  /**
+   * Release the preconditioner and the internal copy of the matrix.
+   */
+  void ReleasePreconditioner();
+
+  //BTX
+  enum
+    {
+      VTK_VMTK_KRYLOV_SOLVER_CG,
+      VTK_VMTK_KRYLOV_SOLVER_BICGSTAB
+    };
+  //ETX
+
+  //BTX
+  enum
+    {
+      VTK_VMTK_KRYLOV_PRECONDITIONER_NONE,
+      VTK_VMTK_KRYLOV_PRECONDITIONER_JACOBI,
+      VTK_VMTK_KRYLOV_PRECONDITIONER_ILU0,
+      VTK_VMTK_KRYLOV_PRECONDITIONER_AMG
+    };
+  //ETX
+
+protected:
+  vtkvmtkKrylovLinearSystemSolver();
+  ~vtkvmtkKrylovLinearSystemSolver();
+
+  void BuildPreconditioner();
+  void ApplyPreconditioner(const double* r, double* z);
+
+  int SolveCG(const double* b, double* x);
+  int SolveBiCGStab(const double* b, double* x);
+
+  int SolverType;
+  int PreconditionerType;
+  int UseInitialGuess;
+  int ReusePreconditioner;
+  double AMGStrengthThreshold;
+  int AMGNumberOfSmoothingSweeps;
+
+  vtkvmtkKrylovLinearSystemSolverInternals* Internals;
+
+private:
+  vtkvmtkKrylovLinearSystemSolver(const vtkvmtkKrylovLinearSystemSolver&);  // Not implemented.
+  void operator=(const vtkvmtkKrylovLinearSystemSolver&);  // Not implemented.
+};
+
+#endif
@@ -76,6 +76,16 @@ public:
    */
   virtual int Solve();
 
+  /**
+   * Get the number of iterations performed by the last Solve().
+   */
+  vtkGetMacro(NumberOfIterations,int);
+
+  /**
+   * Get the residual reached by the last Solve(), as computed by the solver subclass.
+   */
+  vtkGetMacro(Residual,double);
+
 protected:
   vtkvmtkLinearSystemSolver();
   ~vtkvmtkLinearSystemSolver();
@@ -29,10 +29,16 @@ vtkvmtkNeighborhood::vtkvmtkNeighborhood()
   this->NPoints = 0;
   this->PointIds = NULL;
   this->IsBoundary = false;
+  this->IsView = 0;
   }
 
 vtkvmtkNeighborhood::~vtkvmtkNeighborhood()
   {
+  if (this->IsView)
+    {
+    return;
+    }
+
   if (this->PointIds != NULL)
     {
     delete [] this->PointIds;
@@ -40,6 +46,19 @@ vtkvmtkNeighborhood::~vtkvmtkNeighborhood()
     }
   }
 
+void vtkvmtkNeighborhood::SetView(vtkIdType numberOfPoints, vtkIdType* pointIds, bool isBoundary)
+  {
+  if (!this->IsView && this->PointIds != NULL)
+    {
+    delete [] this->PointIds;
+    }
+
+  this->NPoints = numberOfPoints;
+  this->PointIds = pointIds;
+  this->IsBoundary = isBoundary;
+  this->IsView = 1;
+  }
+
 void vtkvmtkNeighborhood::ResizePointList(vtkIdType ptId, int size)
   {
   int newSize;
@@ -69,11 +88,11 @@ void vtkvmtkNeighborhood::DeepCopy(vtkvmtkItem *src)
 
   this->NPoints = neighborhoodSrc->NPoints;
 
-  if (this->PointIds != NULL)
+  if (this->PointIds != NULL && !this->IsView)
     {
     delete [] this->PointIds;
-    this->PointIds = NULL;
     }
+  this->PointIds = NULL;
 
   if (neighborhoodSrc->NPoints>0)
     {
@@ -82,5 +101,6 @@ void vtkvmtkNeighborhood::DeepCopy(vtkvmtkItem *src)
     }
 
   this->IsBoundary = neighborhoodSrc->IsBoundary;
+  this->IsView = 0;
   }
 
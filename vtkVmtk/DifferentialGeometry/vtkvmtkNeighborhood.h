@@ -70,6 +70,12 @@ public:
    */
   vtkIdType *GetPointer(vtkIdType i) {return this->PointIds+i;};
 
+  /**
+   * Get whether this neighborhood is a view over the compact storage of a vtkvmtkDataSetItems
+   * collection (see vtkvmtkDataSetItems::StorageMode). A view must not be built again.
+   */
+  vtkGetMacro(IsView,int);
+
   /**
    * Build the neighborhood.
    */
@@ -86,9 +92,16 @@ protected:
 
   void ResizePointList(vtkIdType ptId, int size);
 
+  // Makes the neighborhood a view over numberOfPoints point ids owned by a compact
+  // vtkvmtkDataSetItems collection.
+  void SetView(vtkIdType numberOfPoints, vtkIdType* pointIds, bool isBoundary);
+
   vtkIdType NPoints;
   vtkIdType* PointIds;
   bool IsBoundary;
+  int IsView;
+
+  friend class vtkvmtkDataSetItems;
 
 private:
   vtkvmtkNeighborhood(const vtkvmtkNeighborhood&);  // Not implemented.
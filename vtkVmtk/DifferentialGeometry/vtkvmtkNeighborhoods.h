@@ -27,7 +27,8 @@
  * instantiated for each point; Build() (inherited from vtkvmtkDataSetItems) then computes every
  * point's neighborhood. This is the standard way vmtk filters (e.g. non-manifold edge detection,
  * centerline resampling) obtain, for every point of a surface or volume mesh, the ids of its
- * topological neighbors.
+ * topological neighbors. Neighborhoods are built in parallel and stored in compact form by
+ * default (see vtkvmtkDataSetItems::StorageMode).
  *
  * @sa
  * vtkvmtkDataSetItems, vtkvmtkNeighborhood
@@ -75,7 +76,7 @@ public:
    * Get the neighborhood item built for the point with the given id. Valid only after Build() has
    * been called.
    */
-  vtkvmtkNeighborhood* GetNeighborhood(vtkIdType ptId) {return (vtkvmtkNeighborhood*)this->Array[ptId];};
+  vtkvmtkNeighborhood* GetNeighborhood(vtkIdType ptId) {return (vtkvmtkNeighborhood*)this->GetItem(ptId);};
 
   ///@{
   /**
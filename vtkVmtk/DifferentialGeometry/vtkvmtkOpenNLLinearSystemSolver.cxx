@@ -90,17 +90,38 @@ int vtkvmtkOpenNLLinearSystemSolver::Solve()
   nlBegin(NL_MATRIX);
 
   int i, j;
-  for (i=0; i<system->GetNumberOfRows(); i++)
+  if (system->GetIsCompressed())
     {
-    nlRowParameterd(NL_RIGHT_HAND_SIDE,-rhs->GetElement(i));
-    vtkvmtkSparseMatrixRow* row = system->GetRow(i);
-    nlBegin(NL_ROW);
-    for (j=0; j<row->GetNumberOfElements(); j++)
+    const vtkIdType* rowOffsets = system->GetRowOffsets();
+    const vtkIdType* columnIds = system->GetColumnIds();
+    const double* values = system->GetValues();
+    const double* diagonalValues = system->GetDiagonalValues();
+    for (i=0; i<system->GetNumberOfRows(); i++)
       {
-      nlCoefficient(row->GetElementId(j),row->GetElement(j));
+      nlRowParameterd(NL_RIGHT_HAND_SIDE,-rhs->GetElement(i));
+      nlBegin(NL_ROW);
+      for (vtkIdType k=rowOffsets[i]; k<rowOffsets[i+1]; k++)
+        {
+        nlCoefficient(columnIds[k],values[k]);
+        }
+      nlCoefficient(i,diagonalValues[i]);
+      nlEnd(NL_ROW);
+      }
+    }
+  else
+    {
+    for (i=0; i<system->GetNumberOfRows(); i++)
+      {
+      nlRowParameterd(NL_RIGHT_HAND_SIDE,-rhs->GetElement(i));
+      vtkvmtkSparseMatrixRow* row = system->GetRow(i);
+      nlBegin(NL_ROW);
+      for (j=0; j<row->GetNumberOfElements(); j++)
+        {
+        nlCoefficient(row->GetElementId(j),row->GetElement(j));
+        }
+      nlCoefficient(i,row->GetDiagonalElement());
+      nlEnd(NL_ROW);
       }
-    nlCoefficient(i,row->GetDiagonalElement());
-    nlEnd(NL_ROW);
     }
 
   nlEnd(NL_MATRIX);
@@ -20,11 +20,8 @@
 =========================================================================*/
 
 #include "vtkvmtkPolyDataFEGradientAssembler.h"
-#include "vtkvmtkGaussQuadrature.h"
-#include "vtkvmtkFEShapeFunctions.h"
 #include "vtkPointData.h"
 #include "vtkDataArray.h"
-#include "vtkCell.h"
 #include "vtkMath.h"
 #include "vtkObjectFactory.h"
 
@@ -35,6 +32,7 @@ vtkvmtkPolyDataFEGradientAssembler::vtkvmtkPolyDataFEGradientAssembler()
 {
   this->ScalarsArrayName = NULL;
   this->ScalarsComponent = 0;
+  this->ScalarsArray = NULL;
 }
 
 vtkvmtkPolyDataFEGradientAssembler::~vtkvmtkPolyDataFEGradientAssembler()
@@ -65,72 +63,55 @@ void vtkvmtkPolyDataFEGradientAssembler::Build()
   int numberOfVariables = 3;
   this->Initialize(numberOfVariables);
 
-  vtkvmtkGaussQuadrature* gaussQuadrature = vtkvmtkGaussQuadrature::New();
-  gaussQuadrature->SetOrder(this->QuadratureOrder);
-
-  vtkvmtkFEShapeFunctions* feShapeFunctions = vtkvmtkFEShapeFunctions::New();
-
   int dimension = 2;
 
-  int numberOfCells = this->DataSet->GetNumberOfCells();
-  int numberOfPoints = this->DataSet->GetNumberOfPoints();
-  int k;
-  for (k=0; k<numberOfCells; k++)
+  this->ScalarsArray = scalarsArray;
+  this->AssembleElements(dimension);
+  this->ScalarsArray = NULL;
+}
+
+void vtkvmtkPolyDataFEGradientAssembler::AssembleElement(vtkvmtkFEElement* element)
+{
+  vtkIdType numberOfPoints = this->DataSet->GetNumberOfPoints();
+  int numberOfQuadraturePoints = element->GetNumberOfQuadraturePoints();
+  int numberOfCellPoints = element->GetNumberOfPoints();
+  int i, j;
+  int q;
+  for (q=0; q<numberOfQuadraturePoints; q++)
     {
-    vtkCell* cell = this->DataSet->GetCell(k);
-    if (cell->GetCellDimension() != dimension)
+    double quadratureWeight = element->GetQuadratureWeight(q);
+    double jacobian = element->GetJacobian(q);
+    double phii, phij;
+    double gradientValue[3];
+    gradientValue[0] = gradientValue[1] = gradientValue[2] = 0.0;
+    for (i=0; i<numberOfCellPoints; i++)
       {
-      continue;
-      } 
-    gaussQuadrature->Initialize(cell->GetCellType());
-    feShapeFunctions->Initialize(cell,gaussQuadrature->GetQuadraturePoints());
-    int numberOfQuadraturePoints = gaussQuadrature->GetNumberOfQuadraturePoints();
-    double quadraturePCoords[3];
-    int numberOfCellPoints = cell->GetNumberOfPoints();
-    int i, j;
-    int q;
-    for (q=0; q<numberOfQuadraturePoints; q++)
+      vtkIdType iId = element->GetPointId(i);
+      const double* dphii = element->GetDPhi(q,i);
+      double nodalValue = this->ScalarsArray->GetComponent(iId,this->ScalarsComponent);
+      gradientValue[0] += nodalValue * dphii[0];
+      gradientValue[1] += nodalValue * dphii[1];
+      gradientValue[2] += nodalValue * dphii[2];
+      }
+    for (i=0; i<numberOfCellPoints; i++)
       {
-      gaussQuadrature->GetQuadraturePoint(q,quadraturePCoords);
-      double quadratureWeight = gaussQuadrature->GetQuadratureWeight(q);
-      double jacobian = feShapeFunctions->GetJacobian(q);
-      double phii, phij;
-      double dphii[3];
-      double gradientValue[3];
-      gradientValue[0] = gradientValue[1] = gradientValue[2] = 0.0;
-      for (i=0; i<numberOfCellPoints; i++)
-        {
-        vtkIdType iId = cell->GetPointId(i);
-        feShapeFunctions->GetDPhi(q,i,dphii);
-        double nodalValue = scalarsArray->GetComponent(iId,this->ScalarsComponent);
-        gradientValue[0] += nodalValue * dphii[0];
-        gradientValue[1] += nodalValue * dphii[1];
-        gradientValue[2] += nodalValue * dphii[2];
-        }
-      for (i=0; i<numberOfCellPoints; i++)
+      vtkIdType iId = element->GetPointId(i);
+      phii = element->GetPhi(q,i);
+      double value0 = jacobian * quadratureWeight * gradientValue[0] * phii;
+      double value1 = jacobian * quadratureWeight * gradientValue[1] * phii;
+      double value2 = jacobian * quadratureWeight * gradientValue[2] * phii;
+      this->RHSVector->AddElement(iId,value0);
+      this->RHSVector->AddElement(iId+numberOfPoints,value1);
+      this->RHSVector->AddElement(iId+2*numberOfPoints,value2);
+      for (j=0; j<numberOfCellPoints; j++)
         {
-        vtkIdType iId = cell->GetPointId(i);
-        phii = feShapeFunctions->GetPhi(q,i);
-        double value0 = jacobian * quadratureWeight * gradientValue[0] * phii;
-        double value1 = jacobian * quadratureWeight * gradientValue[1] * phii;
-        double value2 = jacobian * quadratureWeight * gradientValue[2] * phii;
-        this->RHSVector->AddElement(iId,value0);
-        this->RHSVector->AddElement(iId+numberOfPoints,value1);
-        this->RHSVector->AddElement(iId+2*numberOfPoints,value2);
-        for (j=0; j<numberOfCellPoints; j++)
-          {
-          vtkIdType jId = cell->GetPointId(j);
-          phij = feShapeFunctions->GetPhi(q,j);
-          double value = jacobian * quadratureWeight * phii * phij;
-          this->Matrix->AddElement(iId,jId,value);
-          this->Matrix->AddElement(iId+numberOfPoints,jId+numberOfPoints,value);
-          this->Matrix->AddElement(iId+2*numberOfPoints,jId+2*numberOfPoints,value);
-          }
+        vtkIdType jId = element->GetPointId(j);
+        phij = element->GetPhi(q,j);
+        double value = jacobian * quadratureWeight * phii * phij;
+        this->Matrix->AddElement(iId,jId,value);
+        this->Matrix->AddElement(iId+numberOfPoints,jId+numberOfPoints,value);
+        this->Matrix->AddElement(iId+2*numberOfPoints,jId+2*numberOfPoints,value);
         }
       }
     }
-
-  gaussQuadrature->Delete();
-  feShapeFunctions->Delete();
 }
-
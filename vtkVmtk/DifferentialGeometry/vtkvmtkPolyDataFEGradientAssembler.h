@@ -39,6 +39,8 @@
 #include "vtkvmtkFEAssembler.h"
 #include "vtkvmtkWin32Header.h"
 
+class vtkDataArray;
+
 class VTK_VMTK_DIFFERENTIAL_GEOMETRY_EXPORT vtkvmtkPolyDataFEGradientAssembler : public vtkvmtkFEAssembler
 {
 public:
@@ -70,8 +72,11 @@ protected:
   vtkvmtkPolyDataFEGradientAssembler();
   ~vtkvmtkPolyDataFEGradientAssembler();
 
+  void AssembleElement(vtkvmtkFEElement* element) override;
+
   char* ScalarsArrayName;
   int ScalarsComponent;
+  vtkDataArray* ScalarsArray;
 
 private:
   vtkvmtkPolyDataFEGradientAssembler(const vtkvmtkPolyDataFEGradientAssembler&);  // Not implemented.
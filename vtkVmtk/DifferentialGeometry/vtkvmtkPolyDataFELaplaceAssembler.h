@@ -50,6 +50,8 @@ protected:
   vtkvmtkPolyDataFELaplaceAssembler();
   ~vtkvmtkPolyDataFELaplaceAssembler();
 
+  void AssembleElement(vtkvmtkFEElement* element) override;
+
 private:
   vtkvmtkPolyDataFELaplaceAssembler(const vtkvmtkPolyDataFELaplaceAssembler&);  // Not implemented.
   void operator=(const vtkvmtkPolyDataFELaplaceAssembler&);  // Not implemented.
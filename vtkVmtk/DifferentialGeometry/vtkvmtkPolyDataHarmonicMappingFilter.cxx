@@ -29,7 +29,7 @@
 #include "vtkvmtkSparseMatrix.h"
 #include "vtkvmtkSparseMatrixRow.h"
 #include "vtkvmtkLinearSystem.h"
-#include "vtkvmtkOpenNLLinearSystemSolver.h"
+#include "vtkvmtkKrylovLinearSystemSolver.h"
 
 #include "vtkvmtkDirichletBoundaryConditions.h"
 #include "vtkInformation.h"
@@ -48,6 +48,8 @@ vtkvmtkPolyDataHarmonicMappingFilter::vtkvmtkPolyDataHarmonicMappingFilter()
   this->ConvergenceTolerance = 1E-6;
   this->SetAssemblyModeToFiniteElements();
   this->QuadratureOrder = 1;
+  this->WarmStart = 1;
+  this->PreviousSolution = NULL;
 }
 
 vtkvmtkPolyDataHarmonicMappingFilter::~vtkvmtkPolyDataHarmonicMappingFilter()
@@ -69,6 +71,12 @@ vtkvmtkPolyDataHarmonicMappingFilter::~vtkvmtkPolyDataHarmonicMappingFilter()
     delete[] this->HarmonicMappingArrayName;
     this->HarmonicMappingArrayName = NULL;
     }
+
+  if (this->PreviousSolution)
+    {
+    this->PreviousSolution->Delete();
+    this->PreviousSolution = NULL;
+    }
 }
 
 int vtkvmtkPolyDataHarmonicMappingFilter::RequestData(
@@ -153,14 +161,37 @@ int vtkvmtkPolyDataHarmonicMappingFilter::RequestData(
   dirichetBoundaryConditions->SetBoundaryValues(this->BoundaryValues);
   dirichetBoundaryConditions->Apply();
 
-  vtkvmtkOpenNLLinearSystemSolver* solver = vtkvmtkOpenNLLinearSystemSolver::New();
+  if (this->WarmStart && this->PreviousSolution && this->PreviousSolution->GetNumberOfElements() == solutionVector->GetNumberOfElements())
+    {
+    solutionVector->Assign(this->PreviousSolution);
+    }
+  else
+    {
+    int numberOfBoundaryPoints = this->BoundaryPointIds->GetNumberOfIds();
+    for (int i=0; i<numberOfBoundaryPoints; i++)
+      {
+      solutionVector->SetElement(this->BoundaryPointIds->GetId(i),this->BoundaryValues->GetComponent(i,0));
+      }
+    }
+
+  vtkvmtkKrylovLinearSystemSolver* solver = vtkvmtkKrylovLinearSystemSolver::New();
   solver->SetLinearSystem(linearSystem);
   solver->SetConvergenceTolerance(this->ConvergenceTolerance);
   solver->SetMaximumNumberOfIterations(numberOfInputPoints);
   solver->SetSolverTypeToCG();
-  solver->SetPreconditionerTypeToNone();
+  solver->SetPreconditionerTypeToILU0();
+  solver->UseInitialGuessOn();
   solver->Solve();
 
+  if (this->WarmStart)
+    {
+    if (!this->PreviousSolution)
+      {
+      this->PreviousSolution = vtkvmtkDoubleVector::New();
+      }
+    this->PreviousSolution->DeepCopy(solutionVector);
+    }
+
   vtkDoubleArray* harmonicMappingArray = vtkDoubleArray::New();
   harmonicMappingArray->SetName(this->HarmonicMappingArrayName);
   harmonicMappingArray->SetNumberOfComponents(1);
@@ -24,15 +24,18 @@
  * the finite-element Laplace-Beltrami stencil, or with true piecewise-linear finite elements, via
  * vtkvmtkPolyDataFELaplaceAssembler, according to AssemblyMode) is subjected to Dirichlet boundary
  * conditions (vtkvmtkDirichletBoundaryConditions) that pin the points listed in BoundaryPointIds to
- * the corresponding values in BoundaryValues, then solved with vtkvmtkOpenNLLinearSystemSolver
- * (conjugate gradient, tolerance ConvergenceTolerance). The resulting harmonic scalar field is
- * written to the output as a point data array named HarmonicMappingArrayName. This is the core
+ * the corresponding values in BoundaryValues, then solved with vtkvmtkKrylovLinearSystemSolver
+ * (conjugate gradient preconditioned with an incomplete factorization, tolerance
+ * ConvergenceTolerance). Iterations start from the boundary values, or, with WarmStart on, from
+ * the solution of the previous update on an input with the same number of points. The resulting
+ * harmonic scalar field is written to the output as a point data array named
+ * HarmonicMappingArrayName. This is the core
  * computation behind vtkvmtkPolyDataCylinderHarmonicMappingFilter, and more generally is used to
  * build smooth surface parameterizations (e.g. longitudinal position along a vessel segment) that
  * remain well behaved near non-planar boundaries such as bifurcation insertion regions.
  *
  * @sa vtkvmtkPolyDataCylinderHarmonicMappingFilter, vtkvmtkPolyDataFELaplaceAssembler,
- *     vtkvmtkOpenNLLinearSystemSolver, vtkvmtkStencils
+ *     vtkvmtkKrylovLinearSystemSolver, vtkvmtkStencils
  */
 
 #ifndef __vtkvmtkPolyDataHarmonicMappingFilter_h
@@ -44,6 +47,8 @@
 #include "vtkIdList.h"
 #include "vtkDoubleArray.h"
 
+class vtkvmtkDoubleVector;
+
 class VTK_VMTK_DIFFERENTIAL_GEOMETRY_EXPORT vtkvmtkPolyDataHarmonicMappingFilter : public vtkPolyDataAlgorithm
 {
 public:
@@ -82,12 +87,23 @@ public:
   ///@{
   /**
    * Set/get the convergence tolerance of the iterative linear solver (see
-   * vtkvmtkOpenNLLinearSystemSolver) used to solve the harmonic problem. Default: 1E-6.
+   * vtkvmtkKrylovLinearSystemSolver) used to solve the harmonic problem. Default: 1E-6.
    */
   vtkSetMacro(ConvergenceTolerance,double);
   vtkGetMacro(ConvergenceTolerance,double);
   ///@}
 
+  ///@{
+  /**
+   * Set/get whether the solution of the previous update is used as the initial guess of the linear
+   * solver when the input has the same number of points. The result still satisfies
+   * ConvergenceTolerance; only the number of iterations changes. Default: on.
+   */
+  vtkSetMacro(WarmStart,int);
+  vtkGetMacro(WarmStart,int);
+  vtkBooleanMacro(WarmStart,int);
+  ///@}
+
   ///@{
   /**
    * Set/get how the discrete Laplace system is assembled: VTK_VMTK_ASSEMBLY_STENCILS uses the
@@ -134,6 +150,9 @@ protected:
   double ConvergenceTolerance;
   int AssemblyMode;
   int QuadratureOrder;
+  int WarmStart;
+
+  vtkvmtkDoubleVector* PreviousSolution;
 
 private:
   vtkvmtkPolyDataHarmonicMappingFilter(const vtkvmtkPolyDataHarmonicMappingFilter&);  // Not implemented.
@@ -37,7 +37,6 @@ void vtkvmtkPolyDataManifoldExtendedNeighborhood::Build()
   double outerPoint[3], point1[3], point2[3];
   double edgeVector[3], outerVector1[3], outerVector2[3];
   vtkIdList *cellIds, *ptIds, *extendedStencilIds;
-  vtkCell* cell;
   vtkPolyData* pdata = vtkPolyData::SafeDownCast(this->DataSet);
 
   if (pdata==NULL)
@@ -69,10 +68,10 @@ void vtkvmtkPolyDataManifoldExtendedNeighborhood::Build()
           outerP = -1;
           for (j=0; j<2; j++)
             {
-            cell = pdata->GetCell(cellIds->GetId(j));
+            pdata->GetCellPoints(cellIds->GetId(j),ptIds);
             for (k=0; k<3; k++)
               {
-              p = cell->GetPointId(k);
+              p = ptIds->GetId(k);
               if (p!=pointId  && p!=p1 && p!=p2)
                 {
                 outerP = p;
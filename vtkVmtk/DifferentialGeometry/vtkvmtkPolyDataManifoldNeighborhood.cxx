@@ -39,7 +39,6 @@ void vtkvmtkPolyDataManifoldNeighborhood::Build()
   vtkIdType K;
   vtkIdType pointId;
   vtkIdList *cellIds, *ptIds, *stencilIds;
-  vtkCell* cell;
   vtkPolyData* pdata = vtkPolyData::SafeDownCast(this->DataSet);
 
   if (pdata==NULL)
@@ -50,6 +49,7 @@ void vtkvmtkPolyDataManifoldNeighborhood::Build()
   pointId = this->DataSetPointId;
 
   this->NPoints = 0;
+  this->IsBoundary = false;
 
   cellIds = vtkIdList::New();
   ptIds = vtkIdList::New();
@@ -93,11 +93,11 @@ void vtkvmtkPolyDataManifoldNeighborhood::Build()
   // walk around the stencil counter-clockwise and get cells
   for (j=0; j<numCellsInStencil; j++)
     {
-    cell = pdata->GetCell(nextCell);
+    pdata->GetCellPoints(nextCell,ptIds);
     p1 = -1;
     for (i = 0; i < 3; i++)
       {
-      if ((p1 = cell->GetPointId(i)) != pointId && cell->GetPointId(i) != p2)
+      if ((p1 = ptIds->GetId(i)) != pointId && ptIds->GetId(i) != p2)
         {
         break;
         }
@@ -121,11 +121,11 @@ void vtkvmtkPolyDataManifoldNeighborhood::Build()
   p2 = bp1;
   for (; j<numCellsInStencil && startCell!=-1; j++)
     {
-    cell = pdata->GetCell(nextCell);
+    pdata->GetCellPoints(nextCell,ptIds);
     p1 = -1;
     for (i=0; i<3; i++)
       {
-      if ((p1=cell->GetPointId(i))!=pointId && cell->GetPointId(i)!=p2)
+      if ((p1=ptIds->GetId(i))!=pointId && ptIds->GetId(i)!=p2)
         {
         break;
         }
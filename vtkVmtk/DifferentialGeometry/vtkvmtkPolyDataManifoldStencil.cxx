@@ -130,6 +130,11 @@ void vtkvmtkPolyDataManifoldStencil::Build()
     {
     this->Weights[i] = 0.0;
     }
+  if (this->CenterWeight!=NULL)
+    {
+    delete[] this->CenterWeight;
+    this->CenterWeight = NULL;
+    }
   this->CenterWeight = new double[this->NumberOfComponents];
   for (i=0; i<this->NumberOfComponents; i++)
     {
@@ -71,20 +71,44 @@ void vtkvmtkPolyDataMeanCurvature::ComputePointMeanCurvatureVector(vtkPolyData*
 
   input->GetPoint(pointId,point);
 
-  stencil = this->Stencils->GetStencil(pointId);
-
-  for (j=0; j<stencil->GetNumberOfPoints(); j++)
+  if (this->Stencils->GetIsCompact())
     {
-    input->GetPoint(stencil->GetPointId(j),stencilPoint);
+    const vtkIdType* offsets = this->Stencils->GetItemOffsets();
+    const vtkIdType* pointIds = this->Stencils->GetItemPointIds() + offsets[pointId];
+    vtkIdType numberOfComponents = this->Stencils->GetItemNumberOfComponents();
+    const double* weights = this->Stencils->GetItemWeights() + numberOfComponents*offsets[pointId];
+    double centerWeight = this->Stencils->GetItemCenterWeights()[numberOfComponents*pointId];
+
+    for (j=0; j<offsets[pointId+1]-offsets[pointId]; j++)
+      {
+      input->GetPoint(pointIds[j],stencilPoint);
 
-    meanCurvatureVector[0] += stencil->GetWeight(j) * stencilPoint[0];
-    meanCurvatureVector[1] += stencil->GetWeight(j) * stencilPoint[1];
-    meanCurvatureVector[2] += stencil->GetWeight(j) * stencilPoint[2];
+      meanCurvatureVector[0] += weights[j] * stencilPoint[0];
+      meanCurvatureVector[1] += weights[j] * stencilPoint[1];
+      meanCurvatureVector[2] += weights[j] * stencilPoint[2];
+      }
+
+    meanCurvatureVector[0] += centerWeight * point[0];
+    meanCurvatureVector[1] += centerWeight * point[1];
+    meanCurvatureVector[2] += centerWeight * point[2];
     }
+  else
+    {
+    stencil = this->Stencils->GetStencil(pointId);
 
-  meanCurvatureVector[0] += stencil->GetCenterWeight() * point[0];
-  meanCurvatureVector[1] += stencil->GetCenterWeight() * point[1];
-  meanCurvatureVector[2] += stencil->GetCenterWeight() * point[2];
+    for (j=0; j<stencil->GetNumberOfPoints(); j++)
+      {
+      input->GetPoint(stencil->GetPointId(j),stencilPoint);
+
+      meanCurvatureVector[0] += stencil->GetWeight(j) * stencilPoint[0];
+      meanCurvatureVector[1] += stencil->GetWeight(j) * stencilPoint[1];
+      meanCurvatureVector[2] += stencil->GetWeight(j) * stencilPoint[2];
+      }
+
+    meanCurvatureVector[0] += stencil->GetCenterWeight() * point[0];
+    meanCurvatureVector[1] += stencil->GetCenterWeight() * point[1];
+    meanCurvatureVector[2] += stencil->GetCenterWeight() * point[2];
+    }
 
   meanCurvatureVector[0] *= 0.5;
   meanCurvatureVector[1] *= 0.5;
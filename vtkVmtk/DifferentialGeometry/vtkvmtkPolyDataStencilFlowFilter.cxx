@@ -25,18 +25,196 @@
 #include "vtkIdList.h"
 #include "vtkCell.h"
 #include "vtkCellLocator.h"
+#include "vtkGenericCell.h"
 #include "vtkPolyData.h"
 #include "vtkPointData.h"
 #include "vtkCellData.h"
 #include "vtkFieldData.h"
+#include "vtkDoubleArray.h"
 #include "vtkMath.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+#include "vtkVersion.h"
+
+#include <vector>
 
 
 vtkStandardNewMacro(vtkvmtkPolyDataStencilFlowFilter);
 
+// Moves the points in [begin,end) towards the stencil-weighted combination of their neighbors,
+// reading coordinates from Source and writing them to Target (the same array for Gauss-Seidel
+// updates). Without a Locator, points that leave their constraint cell keep their unprojected
+// position and are flagged in Unconstrained, to be projected serially.
+class vtkvmtkPolyDataStencilFlowFilterDisplacementFunctor
+{
+public:
+  vtkvmtkStencils* Stencils;
+  vtkPolyData* Input;
+  vtkCellLocator* Locator;
+  vtkPoints* Points;
+  const double* Source;
+  double* Target;
+  double* DisplacementNorms;
+  vtkIdType* ConstrainCellIds;
+  unsigned char* Unconstrained;
+  double RelaxationFactor;
+  double MaximumDisplacement;
+  int ProcessBoundary;
+  int ConstrainOnSurface;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    vtkGenericCell* cell = NULL;
+    double* weights = NULL;
+    if (this->ConstrainOnSurface)
+      {
+      cell = vtkGenericCell::New();
+      weights = new double[this->Input->GetMaxCellSize()];
+      }
+
+    // compact stencils are read straight from the flat arrays, without creating stencil views
+    const vtkIdType* stencilOffsets = this->Stencils->GetItemOffsets();
+    const vtkIdType* stencilPointIds = this->Stencils->GetItemPointIds();
+    const unsigned char* stencilBoundaryFlags = this->Stencils->GetItemBoundaryFlags();
+    const double* stencilWeights = this->Stencils->GetItemWeights();
+    const double* stencilCenterWeights = this->Stencils->GetItemCenterWeights();
+    vtkIdType numberOfComponents = this->Stencils->GetItemNumberOfComponents();
+
+    double displacement[3], point[3], newPoint[3], weight;
+    for (vtkIdType pointId=begin; pointId<end; pointId++)
+      {
+      point[0] = this->Source[3*pointId];
+      point[1] = this->Source[3*pointId+1];
+      point[2] = this->Source[3*pointId+2];
+      this->DisplacementNorms[pointId] = 0.0;
+
+      vtkvmtkStencil* stencil = stencilOffsets ? NULL : this->Stencils->GetStencil(pointId);
+      bool isBoundary = stencil ? stencil->GetIsBoundary() : stencilBoundaryFlags[pointId] != 0;
+      if (isBoundary && (!this->ProcessBoundary))
+        {
+        this->Target[3*pointId] = point[0];
+        this->Target[3*pointId+1] = point[1];
+        this->Target[3*pointId+2] = point[2];
+        continue;
+        }
+      displacement[0] = displacement[1] = displacement[2] = 0.0;
+      int numberOfStencilPoints = stencil ? stencil->GetNumberOfPoints() : stencilOffsets[pointId+1] - stencilOffsets[pointId];
+      for (int j=0; j<numberOfStencilPoints; j++)
+        {
+        const double* stencilPoint;
+        if (stencil)
+          {
+          stencilPoint = this->Source + 3*stencil->GetPointId(j);
+          weight = stencil->GetWeight(j);
+          }
+        else
+          {
+          stencilPoint = this->Source + 3*stencilPointIds[stencilOffsets[pointId]+j];
+          weight = stencilWeights[numberOfComponents*stencilOffsets[pointId]+j];
+          }
+        displacement[0] += weight * stencilPoint[0];
+        displacement[1] += weight * stencilPoint[1];
+        displacement[2] += weight * stencilPoint[2];
+        }
+      weight = stencil ? stencil->GetCenterWeight() : stencilCenterWeights[numberOfComponents*pointId];
+      displacement[0] -= weight * point[0];
+      displacement[1] -= weight * point[1];
+      displacement[2] -= weight * point[2];
+
+      if (vtkMath::Norm(displacement) > this->MaximumDisplacement)
+        {
+        vtkMath::Normalize(displacement);
+        displacement[0] *= this->MaximumDisplacement;
+        displacement[1] *= this->MaximumDisplacement;
+        displacement[2] *= this->MaximumDisplacement;
+        }
+
+      newPoint[0] = point[0] + this->RelaxationFactor * displacement[0];
+      newPoint[1] = point[1] + this->RelaxationFactor * displacement[1];
+      newPoint[2] = point[2] + this->RelaxationFactor * displacement[2];
+
+      if (this->ConstrainOnSurface)
+        {
+        double closestPoint[3];
+        vtkIdType cellId;
+        int subId;
+        double dist2, pcoords[3];
+        this->Input->GetCell(this->ConstrainCellIds[pointId],cell);
+        if (cell->EvaluatePosition(newPoint,closestPoint,subId,pcoords,dist2,weights)==0)
+          {
+          if (this->Locator)
+            {
+            this->Locator->FindClosestPoint(newPoint,closestPoint,cellId,subId,dist2);
+            this->ConstrainCellIds[pointId] = cellId;
+            }
+          else
+            {
+            this->Unconstrained[pointId] = 1;
+            closestPoint[0] = newPoint[0];
+            closestPoint[1] = newPoint[1];
+            closestPoint[2] = newPoint[2];
+            }
+          }
+        newPoint[0] = closestPoint[0];
+        newPoint[1] = closestPoint[1];
+        newPoint[2] = closestPoint[2];
+        }
+
+      this->Target[3*pointId] = newPoint[0];
+      this->Target[3*pointId+1] = newPoint[1];
+      this->Target[3*pointId+2] = newPoint[2];
+      this->DisplacementNorms[pointId] = sqrt(vtkMath::Distance2BetweenPoints(point,newPoint));
+
+      if (this->Points)
+        {
+        this->Points->SetPoint(pointId,newPoint);
+        }
+      }
+
+    if (cell)
+      {
+      cell->Delete();
+      }
+    if (weights)
+      {
+      delete[] weights;
+      }
+    }
+};
+
+// Adds to the accumulated displacement of the stencil of every point in [begin,end) the largest
+// displacement of the point and of its stencil points in the last iteration.
+class vtkvmtkPolyDataStencilFlowFilterStencilDisplacementFunctor
+{
+public:
+  vtkvmtkStencils* Stencils;
+  const double* DisplacementNorms;
+  double* StencilDisplacements;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    const vtkIdType* stencilOffsets = this->Stencils->GetItemOffsets();
+    const vtkIdType* stencilPointIds = this->Stencils->GetItemPointIds();
+    for (vtkIdType pointId=begin; pointId<end; pointId++)
+      {
+      vtkvmtkStencil* stencil = stencilOffsets ? NULL : this->Stencils->GetStencil(pointId);
+      double maximumDisplacement = this->DisplacementNorms[pointId];
+      int numberOfStencilPoints = stencil ? stencil->GetNumberOfPoints() : stencilOffsets[pointId+1] - stencilOffsets[pointId];
+      for (int j=0; j<numberOfStencilPoints; j++)
+        {
+        vtkIdType stencilPointId = stencil ? stencil->GetPointId(j) : stencilPointIds[stencilOffsets[pointId]+j];
+        if (this->DisplacementNorms[stencilPointId] > maximumDisplacement)
+          {
+          maximumDisplacement = this->DisplacementNorms[stencilPointId];
+          }
+        }
+      this->StencilDisplacements[pointId] += maximumDisplacement;
+      }
+    }
+};
+
 vtkvmtkPolyDataStencilFlowFilter::vtkvmtkPolyDataStencilFlowFilter() 
 {
   this->StencilType = VTK_VMTK_UMBRELLA_STENCIL;
@@ -47,11 +225,20 @@ vtkvmtkPolyDataStencilFlowFilter::vtkvmtkPolyDataStencilFlowFilter()
   this->MaximumDisplacement = VTK_VMTK_LARGE_DOUBLE;
   this->ProcessBoundary = 0;
   this->ConstrainOnSurface = 0;
+
+  this->ConvergenceTolerance = 0.0;
+  this->ConvergenceCriterion = VTK_VMTK_STENCIL_FLOW_MAXIMUM_DISPLACEMENT;
+  this->JacobiUpdate = 0;
+  this->StencilUpdateThreshold = 0.0;
+
+  this->Residuals = vtkDoubleArray::New();
+  this->Residuals->SetNumberOfComponents(2);
 }
 
 vtkvmtkPolyDataStencilFlowFilter::~vtkvmtkPolyDataStencilFlowFilter()
 {
   this->ReleaseStencils();
+  this->Residuals->Delete();
 }
 
 void vtkvmtkPolyDataStencilFlowFilter::ReleaseStencils()
@@ -92,93 +279,182 @@ int vtkvmtkPolyDataStencilFlowFilter::RequestData(
   this->Stencils->ReallocateOnBuildOff();
   this->Stencils->WeightScalingOn();
 
+  this->Residuals->Initialize();
+  this->Residuals->SetNumberOfComponents(2);
+
+  vtkIdType numberOfPoints = input->GetNumberOfPoints();
+
   vtkCellLocator *cellLocator = NULL;
-  double* weights = NULL;
   if (this->ConstrainOnSurface)
     {
-    weights = new double[input->GetMaxCellSize()];
     cellLocator = vtkCellLocator::New();
     cellLocator->SetDataSet(input);
     cellLocator->BuildLocator();
     }
-  
-  vtkIdType numberOfPoints = input->GetNumberOfPoints();
 
-  double displacement[3], stencilPoint[3], weight;
-  double point[3], newPoint[3];
+  bool parallel = this->JacobiUpdate != 0;
+  if (parallel && this->ConstrainOnSurface)
+    {
+    // cells are built here, serially, so that they can be queried from any thread
+    vtkIdList* cellIds = vtkIdList::New();
+    if (numberOfPoints > 0)
+      {
+      input->GetPointCells(0,cellIds);
+      }
+    cellIds->Delete();
+#if VTK_MAJOR_VERSION >= 9
+    // cell arrays that cannot share their storage hand out connectivity through a buffer held by
+    // the cell array, which concurrent cell queries would overwrite
+    if (!input->GetPolys()->IsStorageShareable())
+      {
+      parallel = false;
+      }
+#endif
+    }
 
-  vtkIdList* constrainCellIds = vtkIdList::New();
-  constrainCellIds->SetNumberOfIds(input->GetNumberOfPoints());
+  // points are moved in a flat copy of their coordinates, written back to the output (whose
+  // points the stencils are built on) at every iteration
+  std::vector<double> coordinates(3*numberOfPoints);
   for (vtkIdType pointId=0; pointId<numberOfPoints; pointId++)
     {
-    constrainCellIds->SetId(pointId,0);
+    output->GetPoint(pointId,&coordinates[3*pointId]);
     }
- 
-  for (int iteration=0; iteration<this->NumberOfIterations; iteration++)
+  std::vector<double> newCoordinates;
+  if (this->JacobiUpdate)
     {
-    this->Stencils->Build();
-    for (vtkIdType pointId=0; pointId<numberOfPoints; pointId++)
+    newCoordinates.resize(3*numberOfPoints);
+    }
+
+  std::vector<double> displacementNorms(numberOfPoints,0.0);
+  std::vector<double> stencilDisplacements(numberOfPoints,0.0);
+  std::vector<vtkIdType> constrainCellIds(numberOfPoints,0);
+  std::vector<unsigned char> unconstrained(numberOfPoints,0);
+
+  vtkvmtkPolyDataStencilFlowFilterDisplacementFunctor displacementFunctor;
+  displacementFunctor.Stencils = this->Stencils;
+  displacementFunctor.Input = input;
+  displacementFunctor.Locator = this->JacobiUpdate ? NULL : cellLocator;
+  displacementFunctor.Points = this->JacobiUpdate ? NULL : output->GetPoints();
+  displacementFunctor.DisplacementNorms = numberOfPoints > 0 ? &displacementNorms[0] : NULL;
+  displacementFunctor.ConstrainCellIds = numberOfPoints > 0 ? &constrainCellIds[0] : NULL;
+  displacementFunctor.Unconstrained = numberOfPoints > 0 ? &unconstrained[0] : NULL;
+  displacementFunctor.RelaxationFactor = this->RelaxationFactor;
+  displacementFunctor.MaximumDisplacement = this->MaximumDisplacement;
+  displacementFunctor.ProcessBoundary = this->ProcessBoundary;
+  displacementFunctor.ConstrainOnSurface = this->ConstrainOnSurface;
+
+  vtkvmtkPolyDataStencilFlowFilterStencilDisplacementFunctor stencilDisplacementFunctor;
+  stencilDisplacementFunctor.Stencils = this->Stencils;
+  stencilDisplacementFunctor.DisplacementNorms = numberOfPoints > 0 ? &displacementNorms[0] : NULL;
+  stencilDisplacementFunctor.StencilDisplacements = numberOfPoints > 0 ? &stencilDisplacements[0] : NULL;
+
+  vtkIdList* rebuildPointIds = vtkIdList::New();
+
+  for (int iteration=0; iteration<this->NumberOfIterations && numberOfPoints>0; iteration++)
+    {
+    if (iteration == 0)
       {
-      vtkvmtkStencil* stencil = this->Stencils->GetStencil(pointId);
-      if (stencil->GetIsBoundary() && (!this->ProcessBoundary))
+      this->Stencils->Build();
+      }
+    else
+      {
+      rebuildPointIds->Reset();
+      for (vtkIdType pointId=0; pointId<numberOfPoints; pointId++)
         {
-        continue;
-        }      
-      displacement[0] = displacement[1] = displacement[2] = 0.0;
-      int numberOfStencilPoints = stencil->GetNumberOfPoints();
-      for (int j=0; j<numberOfStencilPoints; j++)
+        if (stencilDisplacements[pointId] > this->StencilUpdateThreshold)
+          {
+          rebuildPointIds->InsertNextId(pointId);
+          stencilDisplacements[pointId] = 0.0;
+          }
+        }
+      if (rebuildPointIds->GetNumberOfIds() > 0 && !this->Stencils->Rebuild(rebuildPointIds))
         {
-        output->GetPoint(stencil->GetPointId(j),stencilPoint);
-        weight = stencil->GetWeight(j);
-        displacement[0] += weight * stencilPoint[0];
-        displacement[1] += weight * stencilPoint[1];
-        displacement[2] += weight * stencilPoint[2];
+        this->Stencils->ReallocateOnBuildOn();
+        this->Stencils->Build();
+        this->Stencils->ReallocateOnBuildOff();
         }
-      weight = stencil->GetCenterWeight();
-      output->GetPoint(pointId,point);
-      displacement[0] -= weight * point[0];
-      displacement[1] -= weight * point[1];
-      displacement[2] -= weight * point[2];
-      
-      if (vtkMath::Norm(displacement) > this->MaximumDisplacement)
+      }
+
+    if (this->JacobiUpdate)
+      {
+      displacementFunctor.Source = &coordinates[0];
+      displacementFunctor.Target = &newCoordinates[0];
+      if (parallel)
         {
-        vtkMath::Normalize(displacement);
-        displacement[0] *= this->MaximumDisplacement;
-        displacement[1] *= this->MaximumDisplacement;
-        displacement[2] *= this->MaximumDisplacement;
+        vtkSMPTools::For(0,numberOfPoints,256,displacementFunctor);
+        }
+      else
+        {
+        displacementFunctor(0,numberOfPoints);
         }
-      
-      newPoint[0] = point[0] + this->RelaxationFactor * displacement[0];
-      newPoint[1] = point[1] + this->RelaxationFactor * displacement[1];
-      newPoint[2] = point[2] + this->RelaxationFactor * displacement[2];
 
+      // the cell locator is not safe to query concurrently
       if (this->ConstrainOnSurface)
         {
-        double closestPoint[3];
-        vtkIdType cellId;
-        int subId;
-        double dist2, pcoords[3];
-        if (input->GetCell(constrainCellIds->GetId(pointId))->EvaluatePosition(newPoint,closestPoint,subId,pcoords,dist2,weights)==0)
+        for (vtkIdType pointId=0; pointId<numberOfPoints; pointId++)
           {
+          if (!unconstrained[pointId])
+            {
+            continue;
+            }
+          unconstrained[pointId] = 0;
+          double* newPoint = &newCoordinates[3*pointId];
+          double closestPoint[3];
+          vtkIdType cellId;
+          int subId;
+          double dist2;
           cellLocator->FindClosestPoint(newPoint,closestPoint,cellId,subId,dist2);
-          constrainCellIds->SetId(pointId,cellId);
+          constrainCellIds[pointId] = cellId;
+          newPoint[0] = closestPoint[0];
+          newPoint[1] = closestPoint[1];
+          newPoint[2] = closestPoint[2];
+          displacementNorms[pointId] = sqrt(vtkMath::Distance2BetweenPoints(&coordinates[3*pointId],newPoint));
           }
-        newPoint[0] = closestPoint[0];
-        newPoint[1] = closestPoint[1];
-        newPoint[2] = closestPoint[2];
         }
-      
-      output->GetPoints()->SetPoint(pointId,newPoint);
+
+      coordinates.swap(newCoordinates);
+      for (vtkIdType pointId=0; pointId<numberOfPoints; pointId++)
+        {
+        output->GetPoints()->SetPoint(pointId,&coordinates[3*pointId]);
+        }
+      }
+    else
+      {
+      // Gauss-Seidel updates read the points moved before them, so they run serially
+      displacementFunctor.Source = &coordinates[0];
+      displacementFunctor.Target = &coordinates[0];
+      displacementFunctor(0,numberOfPoints);
+      }
+
+    double maximumDisplacement = 0.0;
+    double sumOfSquaredDisplacements = 0.0;
+    for (vtkIdType pointId=0; pointId<numberOfPoints; pointId++)
+      {
+      if (displacementNorms[pointId] > maximumDisplacement)
+        {
+        maximumDisplacement = displacementNorms[pointId];
+        }
+      sumOfSquaredDisplacements += displacementNorms[pointId] * displacementNorms[pointId];
+      }
+    double rmsDisplacement = sqrt(sumOfSquaredDisplacements / numberOfPoints);
+    this->Residuals->InsertNextTuple2(maximumDisplacement,rmsDisplacement);
+
+    if (this->ConvergenceTolerance > 0.0)
+      {
+      double residual = this->ConvergenceCriterion == VTK_VMTK_STENCIL_FLOW_RMS_DISPLACEMENT ? rmsDisplacement : maximumDisplacement;
+      if (residual < this->ConvergenceTolerance)
+        {
+        break;
+        }
+      }
+
+    if (iteration < this->NumberOfIterations - 1)
+      {
+      vtkSMPTools::For(0,numberOfPoints,1024,stencilDisplacementFunctor);
       }
     }
 
-  constrainCellIds->Delete();
-  
-  if (weights)
-  {
-    delete[] weights;
-    weights = NULL;
-  }
+  rebuildPointIds->Delete();
   
   if (cellLocator)
     {
@@ -31,6 +31,15 @@
  * underlies mesh-relaxation / smoothing steps used internally by higher-level vmtk surface
  * processing (no direct pype script wraps it).
  *
+ * Iterations can stop early once the displacement of the points falls below ConvergenceTolerance,
+ * measured as the maximum or the root mean square displacement over all points
+ * (ConvergenceCriterion); the values of both at every iteration performed by the last update are
+ * stored in Residuals. By default points are updated one after the other, each from the already
+ * updated positions of its neighbors (Gauss-Seidel); with JacobiUpdate on, all points are updated
+ * in parallel from the positions of the previous iteration. After the first iteration, the stencil
+ * of a point is built again only once the point or its neighbors have moved by more than
+ * StencilUpdateThreshold since it was last built.
+ *
  * @sa vtkvmtkStencils, vtkvmtkStencil, vtkvmtkPolyDataUmbrellaStencil
  */
 
@@ -43,6 +52,7 @@
 #include "vtkvmtkWin32Header.h"
 
 class vtkvmtkStencils;
+class vtkDoubleArray;
 
 class VTK_VMTK_DIFFERENTIAL_GEOMETRY_EXPORT vtkvmtkPolyDataStencilFlowFilter : public vtkPolyDataAlgorithm
 {
@@ -121,6 +131,64 @@ public:
   vtkGetMacro(MaximumDisplacement,double);
   ///@}
 
+  ///@{
+  /**
+   * Set/get the displacement below which iterations stop before NumberOfIterations is reached, as
+   * measured by ConvergenceCriterion. Zero disables the test. Default: 0.0.
+   */
+  vtkSetMacro(ConvergenceTolerance,double);
+  vtkGetMacro(ConvergenceTolerance,double);
+  ///@}
+
+  ///@{
+  /**
+   * Set/get the displacement compared to ConvergenceTolerance: the maximum
+   * (VTK_VMTK_STENCIL_FLOW_MAXIMUM_DISPLACEMENT, the default) or the root mean square
+   * (VTK_VMTK_STENCIL_FLOW_RMS_DISPLACEMENT) of the displacements of all points in one iteration.
+   */
+  vtkSetMacro(ConvergenceCriterion,int);
+  vtkGetMacro(ConvergenceCriterion,int);
+  void SetConvergenceCriterionToMaximumDisplacement()
+    {this->SetConvergenceCriterion(VTK_VMTK_STENCIL_FLOW_MAXIMUM_DISPLACEMENT);};
+  void SetConvergenceCriterionToRMSDisplacement()
+    {this->SetConvergenceCriterion(VTK_VMTK_STENCIL_FLOW_RMS_DISPLACEMENT);};
+  ///@}
+
+  ///@{
+  /**
+   * Toggle parallel (Jacobi) updates, in which every point is moved using the positions of its
+   * neighbors at the previous iteration. When off, points are moved one after the other, each
+   * using the positions already updated in the current iteration. Default: off.
+   */
+  vtkSetMacro(JacobiUpdate,int);
+  vtkGetMacro(JacobiUpdate,int);
+  vtkBooleanMacro(JacobiUpdate,int);
+  ///@}
+
+  ///@{
+  /**
+   * Set/get how far (summed over iterations) a point and its neighbors may move before the stencil
+   * of the point is built again. With the default of 0.0, every stencil whose neighborhood has moved
+   * is rebuilt at every iteration.
+   */
+  vtkSetMacro(StencilUpdateThreshold,double);
+  vtkGetMacro(StencilUpdateThreshold,double);
+  ///@}
+
+  /**
+   * Get the displacements of the last update, one tuple per iteration performed holding the
+   * maximum and the root mean square displacement of the points in that iteration.
+   */
+  vtkGetObjectMacro(Residuals,vtkDoubleArray);
+
+  //BTX
+  enum
+    {
+      VTK_VMTK_STENCIL_FLOW_MAXIMUM_DISPLACEMENT,
+      VTK_VMTK_STENCIL_FLOW_RMS_DISPLACEMENT
+    };
+  //ETX
+
 protected:
   vtkvmtkPolyDataStencilFlowFilter();
   ~vtkvmtkPolyDataStencilFlowFilter();
@@ -139,6 +207,13 @@ protected:
 
   int ProcessBoundary;
   int ConstrainOnSurface;
+
+  double ConvergenceTolerance;
+  int ConvergenceCriterion;
+  int JacobiUpdate;
+  double StencilUpdateThreshold;
+
+  vtkDoubleArray* Residuals;
   
 private:
   vtkvmtkPolyDataStencilFlowFilter(const vtkvmtkPolyDataStencilFlowFilter&);  // Not implemented.
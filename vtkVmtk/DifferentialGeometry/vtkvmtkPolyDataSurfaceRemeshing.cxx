@@ -28,6 +28,7 @@
 #include "vtkCellArray.h"
 #include "vtkMeshQuality.h"
 #include "vtkCellLocator.h"
+#include "vtkGenericCell.h"
 #include "vtkTriangle.h"
 #include "vtkPointData.h"
 #include "vtkCellData.h"
@@ -35,11 +36,81 @@
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
 #include "vtkVersion.h"
+#include "vtkSMPTools.h"
 
 #include <iostream>
+#include <queue>
+#include <vector>
 
 vtkStandardNewMacro(vtkvmtkPolyDataSurfaceRemeshing);
 
+// Relocates the points of one color, writing new positions and pending projections to buffers
+// indexed like PointIds. Each call builds stencils and walks projection hints with scratch objects
+// of its own.
+class vtkvmtkPolyDataSurfaceRemeshingRelocationFunctor
+{
+public:
+  vtkvmtkPolyDataSurfaceRemeshing* Remeshing;
+  const vtkIdType* PointIds;
+  double* RelocatedPoints;
+  int* Projections;
+  bool ProjectToSurface;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    vtkvmtkPolyDataUmbrellaStencil* stencil = vtkvmtkPolyDataUmbrellaStencil::New();
+    stencil->SetDataSet(this->Remeshing->Mesh);
+    stencil->NegateWeightsOff();
+    stencil->ReallocateOnBuildOn();
+    vtkGenericCell* cell = vtkGenericCell::New();
+    vtkIdList* cellPointIds = vtkIdList::New();
+    int maxCellSize = this->Remeshing->ProjectionSurface->GetMaxCellSize();
+    std::vector<double> weights(maxCellSize > 0 ? maxCellSize : 1);
+
+    for (vtkIdType k=begin; k<end; k++)
+      {
+      vtkIdType pointId = this->PointIds[k];
+      double* relocatedPoint = this->RelocatedPoints + 3*k;
+      int projection = this->Remeshing->ComputeRelocatedPoint(pointId,stencil,relocatedPoint);
+      if (projection == vtkvmtkPolyDataSurfaceRemeshing::PROJECTION_SURFACE)
+        {
+        if (!this->ProjectToSurface)
+          {
+          projection = vtkvmtkPolyDataSurfaceRemeshing::PROJECTION_NONE;
+          }
+        else if (this->Remeshing->UseProjectionHints && this->Remeshing->ProjectPointFromHint(pointId,stencil,relocatedPoint,cell,cellPointIds,&weights[0]))
+          {
+          projection = vtkvmtkPolyDataSurfaceRemeshing::PROJECTION_NONE;
+          }
+        }
+      this->Projections[k] = projection;
+      }
+
+    stencil->Delete();
+    cell->Delete();
+    cellPointIds->Delete();
+    }
+};
+
+// Entry of the edge operation queue. Stamp is compared to the current stamp of the cell when the
+// entry is popped, so entries pushed before the cell was last modified are skipped.
+class vtkvmtkPolyDataSurfaceRemeshingQueueEntry
+{
+public:
+  double Priority;
+  vtkIdType CellId;
+  int Stamp;
+
+  bool operator<(const vtkvmtkPolyDataSurfaceRemeshingQueueEntry& other) const
+    {
+    if (this->Priority != other.Priority)
+      {
+      return this->Priority < other.Priority;
+      }
+    return this->CellId > other.CellId;
+    }
+};
+
 vtkvmtkPolyDataSurfaceRemeshing::vtkvmtkPolyDataSurfaceRemeshing()
 {
   this->AspectRatioThreshold = 1.2;
@@ -70,6 +141,16 @@ vtkvmtkPolyDataSurfaceRemeshing::vtkvmtkPolyDataSurfaceRemeshing()
   this->EntityBoundaryLocator = NULL;
 
   this->ExcludedEntityIds = NULL;
+
+  this->ProjectionSurface = NULL;
+  this->ProjectionCellIds = NULL;
+  this->ProjectionCell = NULL;
+  this->ProjectionCellPointIds = NULL;
+  this->ProjectionWeights = NULL;
+
+  this->ParallelRelocation = 1;
+  this->UseProjectionHints = 1;
+  this->UseOperationQueue = 0;
 }
 
 vtkvmtkPolyDataSurfaceRemeshing::~vtkvmtkPolyDataSurfaceRemeshing()
@@ -133,6 +214,36 @@ vtkvmtkPolyDataSurfaceRemeshing::~vtkvmtkPolyDataSurfaceRemeshing()
     this->ExcludedEntityIds->Delete();
     this->ExcludedEntityIds = NULL;
     }
+
+  if (this->ProjectionSurface)
+    {
+    this->ProjectionSurface->Delete();
+    this->ProjectionSurface = NULL;
+    }
+
+  if (this->ProjectionCellIds)
+    {
+    this->ProjectionCellIds->Delete();
+    this->ProjectionCellIds = NULL;
+    }
+
+  if (this->ProjectionCell)
+    {
+    this->ProjectionCell->Delete();
+    this->ProjectionCell = NULL;
+    }
+
+  if (this->ProjectionCellPointIds)
+    {
+    this->ProjectionCellPointIds->Delete();
+    this->ProjectionCellPointIds = NULL;
+    }
+
+  if (this->ProjectionWeights)
+    {
+    delete[] this->ProjectionWeights;
+    this->ProjectionWeights = NULL;
+    }
 }
 
 int vtkvmtkPolyDataSurfaceRemeshing::RequestData(
@@ -267,6 +378,45 @@ int vtkvmtkPolyDataSurfaceRemeshing::RequestData(
   this->Locator->CacheCellBoundsOn();
   this->Locator->BuildLocator();
 
+  // projection hints walk over the cells of the input surface through links of their own, so the
+  // input itself is left untouched
+  if (this->ProjectionSurface)
+    {
+    this->ProjectionSurface->Delete();
+    this->ProjectionSurface = NULL;
+    }
+  this->ProjectionSurface = vtkPolyData::New();
+  this->ProjectionSurface->ShallowCopy(input);
+  this->ProjectionSurface->BuildLinks();
+
+  if (this->ProjectionCellIds)
+    {
+    this->ProjectionCellIds->Delete();
+    this->ProjectionCellIds = NULL;
+    }
+  this->ProjectionCellIds = vtkIdList::New();
+
+  if (this->ProjectionCell)
+    {
+    this->ProjectionCell->Delete();
+    this->ProjectionCell = NULL;
+    }
+  this->ProjectionCell = vtkGenericCell::New();
+
+  if (this->ProjectionCellPointIds)
+    {
+    this->ProjectionCellPointIds->Delete();
+    this->ProjectionCellPointIds = NULL;
+    }
+  this->ProjectionCellPointIds = vtkIdList::New();
+
+  if (this->ProjectionWeights)
+    {
+    delete[] this->ProjectionWeights;
+    this->ProjectionWeights = NULL;
+    }
+  this->ProjectionWeights = new double[input->GetMaxCellSize() > 0 ? input->GetMaxCellSize() : 1];
+
   if (this->InputBoundary)
     {
     this->InputBoundary->Delete();
@@ -321,10 +471,18 @@ int vtkvmtkPolyDataSurfaceRemeshing::RequestData(
   for (int n=0; n<this->NumberOfIterations; n++)
     {
     std::cout<<"Iteration "<<n+1<<"/"<<this->NumberOfIterations<<endl;
-    this->EdgeCollapseIteration();
-    this->EdgeFlipIteration();
-    this->EdgeSplitIteration();
-    this->EdgeFlipIteration();
+    int numberOfChanges = 1;
+    if (this->UseOperationQueue)
+      {
+      numberOfChanges = this->EdgeOperationQueueIteration();
+      }
+    else
+      {
+      this->EdgeCollapseIteration();
+      this->EdgeFlipIteration();
+      this->EdgeSplitIteration();
+      this->EdgeFlipIteration();
+      }
     relocationSuccess = this->PointRelocationIteration();
     if (relocationSuccess == RELOCATE_FAILURE)
       {
@@ -334,7 +492,16 @@ int vtkvmtkPolyDataSurfaceRemeshing::RequestData(
 
     for (int i=0; i<this->NumberOfConnectivityOptimizationIterations; i++)
       {
-      this->EdgeFlipConnectivityOptimizationIteration();
+      // a sweep that flips nothing leaves the mesh as it found it, so further sweeps would too
+      if (this->EdgeFlipConnectivityOptimizationIteration() == 0)
+        {
+        break;
+        }
+      }
+
+    if (numberOfChanges == 0)
+      {
+      break;
       }
     }
 
@@ -606,6 +773,190 @@ int vtkvmtkPolyDataSurfaceRemeshing::EdgeSplitIteration()
   return numberOfChanges;
 }
 
+int vtkvmtkPolyDataSurfaceRemeshing::EdgeOperationQueueIteration()
+{
+  std::priority_queue<vtkvmtkPolyDataSurfaceRemeshingQueueEntry> queue;
+  std::vector<int> cellStamps;
+
+  vtkIdType numberOfCells = this->Mesh->GetNumberOfCells();
+  cellStamps.resize(numberOfCells,0);
+  vtkvmtkPolyDataSurfaceRemeshingQueueEntry entry;
+  for (vtkIdType i=0; i<numberOfCells; i++)
+    {
+    entry.Priority = this->ComputeOperationPriority(i);
+    if (entry.Priority > 0.0)
+      {
+      entry.CellId = i;
+      entry.Stamp = 0;
+      queue.push(entry);
+      }
+    }
+
+  // a split can make a triangle collapsible and the other way around: bound the number of
+  // operations so that a target area that cannot be met does not keep the queue busy
+  vtkIdType maximumNumberOfChanges = 4 * numberOfCells;
+  int numberOfChanges = 0;
+  vtkIdList* cellIds = vtkIdList::New();
+  vtkIdList* pointCellIds = vtkIdList::New();
+  while (!queue.empty() && numberOfChanges < maximumNumberOfChanges)
+    {
+    entry = queue.top();
+    queue.pop();
+    if (entry.Stamp != cellStamps[entry.CellId] || this->Mesh->GetCellType(entry.CellId) != VTK_TRIANGLE)
+      {
+      continue;
+      }
+    vtkIdType numberOfPoints = this->Mesh->GetNumberOfPoints();
+    vtkIdType pt1, pt2;
+    int result = EDGE_LOCKED;
+    if (this->TestAspectRatioCollapseEdge(entry.CellId,pt1,pt2) == DO_CHANGE)
+      {
+      result = this->CollapseEdge(pt1,pt2);
+      }
+    else if (this->TestAreaSplitEdge(entry.CellId,pt1,pt2) == DO_CHANGE)
+      {
+      result = this->SplitEdge(pt1,pt2);
+      }
+    if (result != SUCCESS)
+      {
+      continue;
+      }
+    numberOfChanges++;
+
+    // the cells around the points of the edge (the collapsed point has none left) and around the
+    // point a split has inserted
+    cellIds->Reset();
+    vtkIdType modifiedPointIds[3];
+    modifiedPointIds[0] = pt1;
+    modifiedPointIds[1] = pt2;
+    modifiedPointIds[2] = this->Mesh->GetNumberOfPoints() > numberOfPoints ? numberOfPoints : -1;
+    for (int j=0; j<3; j++)
+      {
+      if (modifiedPointIds[j] == -1)
+        {
+        continue;
+        }
+      this->Mesh->GetPointCells(modifiedPointIds[j],pointCellIds);
+      for (vtkIdType k=0; k<pointCellIds->GetNumberOfIds(); k++)
+        {
+        cellIds->InsertUniqueId(pointCellIds->GetId(k));
+        }
+      }
+
+    this->FlipEdgesOfCells(cellIds);
+
+    cellStamps.resize(this->Mesh->GetNumberOfCells(),0);
+    for (vtkIdType k=0; k<cellIds->GetNumberOfIds(); k++)
+      {
+      vtkIdType cellId = cellIds->GetId(k);
+      cellStamps[cellId]++;
+      entry.Priority = this->ComputeOperationPriority(cellId);
+      if (entry.Priority > 0.0)
+        {
+        entry.CellId = cellId;
+        entry.Stamp = cellStamps[cellId];
+        queue.push(entry);
+        }
+      }
+    }
+
+  cellIds->Delete();
+  pointCellIds->Delete();
+
+  return numberOfChanges;
+}
+
+double vtkvmtkPolyDataSurfaceRemeshing::ComputeOperationPriority(vtkIdType cellId)
+{
+  if (this->Mesh->GetCellType(cellId) != VTK_TRIANGLE)
+    {
+    return 0.0;
+    }
+
+  vtkIdType npts;
+  const vtkIdType *pts;
+  this->Mesh->GetCellPoints(cellId,npts,pts);
+
+  double point1[3], point2[3], point3[3];
+  this->Mesh->GetPoint(pts[0],point1);
+  this->Mesh->GetPoint(pts[1],point2);
+  this->Mesh->GetPoint(pts[2],point3);
+
+  double area = vtkTriangle::TriangleArea(point1,point2,point3);
+
+  double targetArea = this->ComputeTriangleTargetArea(cellId);
+
+  if (targetArea <= 0.0)
+    {
+    return 0.0;
+    }
+
+  if (area >= targetArea)
+    {
+    return area / targetArea;
+    }
+
+  if (area <= 0.0)
+    {
+    return VTK_DOUBLE_MAX;
+    }
+
+  // same criteria as TestAspectRatioCollapseEdge
+  double side1Squared = vtkMath::Distance2BetweenPoints(point1,point2);
+  double side2Squared = vtkMath::Distance2BetweenPoints(point2,point3);
+  double side3Squared = vtkMath::Distance2BetweenPoints(point3,point1);
+
+  double frobeniusAspectRatio = (side1Squared + side2Squared + side3Squared) / (4.0 * sqrt(3.0) * area);
+
+  double priority = 0.0;
+  if (frobeniusAspectRatio >= this->AspectRatioThreshold)
+    {
+    priority = frobeniusAspectRatio / this->AspectRatioThreshold;
+    }
+  if (area <= targetArea * this->MinAreaFactor && targetArea / area > priority)
+    {
+    priority = targetArea / area;
+    }
+
+  return priority;
+}
+
+void vtkvmtkPolyDataSurfaceRemeshing::FlipEdgesOfCells(vtkIdList* cellIds)
+{
+  // Delaunay flips terminate, the bound only guards against cycles between nearly cocircular points
+  const vtkIdType maximumNumberOfCells = 16 * cellIds->GetNumberOfIds() + 64;
+  for (vtkIdType i=0; i<cellIds->GetNumberOfIds() && i<maximumNumberOfCells; i++)
+    {
+    vtkIdType cellId = cellIds->GetId(i);
+    if (this->Mesh->GetCellType(cellId) != VTK_TRIANGLE)
+      {
+      continue;
+      }
+    vtkIdType npts;
+    const vtkIdType *pts;
+    this->Mesh->GetCellPoints(cellId,npts,pts);
+    vtkIdType tripts[3];
+    tripts[0] = pts[0];
+    tripts[1] = pts[1];
+    tripts[2] = pts[2];
+    for (int j=0; j<3; j++)
+      {
+      int test = this->TestDelaunayFlipEdge(tripts[j],tripts[(j+1)%3]);
+      if (test == DO_NOTHING)
+        {
+        continue;
+        }
+      vtkIdType numberOfCells = this->Mesh->GetNumberOfCells();
+      this->FlipEdge(tripts[j],tripts[(j+1)%3]);
+      for (vtkIdType newCellId=numberOfCells; newCellId<this->Mesh->GetNumberOfCells(); newCellId++)
+        {
+        cellIds->InsertNextId(newCellId);
+        }
+      break;
+      }
+    }
+}
+
 int vtkvmtkPolyDataSurfaceRemeshing::TriangleSplitIteration()
 {
   int numberOfChanges = 0;
@@ -630,15 +981,103 @@ int vtkvmtkPolyDataSurfaceRemeshing::TriangleSplitIteration()
 int vtkvmtkPolyDataSurfaceRemeshing::PointRelocationIteration(bool projectToSurface)
 {
   int numberOfPoints = this->Mesh->GetNumberOfPoints();
-  int success = RELOCATE_SUCCESS;
-  for (int i=0; i<numberOfPoints; i++)
+
+  // points added by splits have no projection hint yet
+  for (vtkIdType i=this->ProjectionCellIds->GetNumberOfIds(); i<numberOfPoints; i++)
+    {
+    this->ProjectionCellIds->InsertNextId(-1);
+    }
+
+  bool parallel = this->ParallelRelocation != 0;
+#if VTK_MAJOR_VERSION >= 9
+  // cell arrays that cannot share their storage hand out connectivity through a buffer held by
+  // the cell array, which concurrent stencil builds would overwrite
+  if (!this->Mesh->GetPolys()->IsStorageShareable() || !this->ProjectionSurface->GetPolys()->IsStorageShareable())
     {
-    success = this->RelocatePoint(i,projectToSurface);
-    if (success == RELOCATE_FAILURE)
+    parallel = false;
+    }
+#endif
+
+  if (!parallel)
+    {
+    int success = RELOCATE_SUCCESS;
+    for (int i=0; i<numberOfPoints; i++)
+      {
+      success = this->RelocatePoint(i,projectToSurface);
+      if (success == RELOCATE_FAILURE)
+        {
+        return RELOCATE_FAILURE;
+        }
+      } 
+    return RELOCATE_SUCCESS;
+    }
+
+  // greedy coloring: a point gets the lowest color not used by the points it shares a triangle
+  // with, so the points of one color do not appear in each other's stencils
+  std::vector<int> pointColors(numberOfPoints,-1);
+  std::vector<vtkIdType> colorMarks;
+  std::vector<std::vector<vtkIdType> > colorPointIds;
+  for (vtkIdType pointId=0; pointId<numberOfPoints; pointId++)
+    {
+    vtkIdType ncells;
+    vtkIdType* cells;
+    this->Mesh->GetPointCells(pointId,ncells,cells);
+    for (vtkIdType i=0; i<ncells; i++)
+      {
+      vtkIdType npts;
+      const vtkIdType *pts;
+      this->Mesh->GetCellPoints(cells[i],npts,pts);
+      for (vtkIdType j=0; j<npts; j++)
+        {
+        if (pts[j] != pointId && pointColors[pts[j]] != -1)
+          {
+          colorMarks[pointColors[pts[j]]] = pointId;
+          }
+        }
+      }
+    int color = 0;
+    while (color < static_cast<int>(colorMarks.size()) && colorMarks[color] == pointId)
       {
-      return RELOCATE_FAILURE;
+      color++;
       }
-    } 
+    if (color == static_cast<int>(colorMarks.size()))
+      {
+      colorMarks.push_back(-1);
+      colorPointIds.push_back(std::vector<vtkIdType>());
+      }
+    pointColors[pointId] = color;
+    colorPointIds[color].push_back(pointId);
+    }
+
+  std::vector<double> relocatedPoints;
+  std::vector<int> projections;
+  for (size_t color=0; color<colorPointIds.size(); color++)
+    {
+    const std::vector<vtkIdType>& pointIds = colorPointIds[color];
+    vtkIdType numberOfColorPoints = static_cast<vtkIdType>(pointIds.size());
+    relocatedPoints.resize(3*numberOfColorPoints);
+    projections.resize(numberOfColorPoints);
+
+    vtkvmtkPolyDataSurfaceRemeshingRelocationFunctor functor;
+    functor.Remeshing = this;
+    functor.PointIds = &pointIds[0];
+    functor.RelocatedPoints = &relocatedPoints[0];
+    functor.Projections = &projections[0];
+    functor.ProjectToSurface = projectToSurface;
+    vtkSMPTools::For(0,numberOfColorPoints,64,functor);
+
+    // locator queries and point updates are done serially once the whole color is relocated
+    for (vtkIdType k=0; k<numberOfColorPoints; k++)
+      {
+      if (projections[k] == RELOCATION_SKIPPED)
+        {
+        continue;
+        }
+      this->ProjectRelocatedPoint(pointIds[k],projections[k],&relocatedPoints[3*k]);
+      this->Mesh->GetPoints()->SetPoint(pointIds[k],&relocatedPoints[3*k]);
+      }
+    }
+
   return RELOCATE_SUCCESS;
 }
 
@@ -687,6 +1126,7 @@ int vtkvmtkPolyDataSurfaceRemeshing::IsPointOnEntityBoundary(vtkIdType pointId)
 
   if (!uniformCellEntityIds)
     {
+    ptCells->Delete();
     return 1;
     }
 
@@ -819,8 +1259,42 @@ int vtkvmtkPolyDataSurfaceRemeshing::FindOneRingNeighbors(vtkIdType pointId, vtk
 
   return pointLocation;
 }
-#define USE_STENCIL
 int vtkvmtkPolyDataSurfaceRemeshing::RelocatePoint(vtkIdType pointId, bool projectToSurface)
+{
+  vtkvmtkPolyDataUmbrellaStencil* stencil = vtkvmtkPolyDataUmbrellaStencil::New();
+  stencil->SetDataSet(this->Mesh);
+  stencil->NegateWeightsOff();
+
+  double relocatedPoint[3];
+  int projection = this->ComputeRelocatedPoint(pointId,stencil,relocatedPoint);
+
+  if (projection == PROJECTION_SURFACE && !projectToSurface)
+    {
+    projection = PROJECTION_NONE;
+    }
+
+  if (projection == PROJECTION_SURFACE && this->UseProjectionHints)
+    {
+    if (this->ProjectPointFromHint(pointId,stencil,relocatedPoint,this->ProjectionCell,this->ProjectionCellPointIds,this->ProjectionWeights))
+      {
+      projection = PROJECTION_NONE;
+      }
+    }
+
+  stencil->Delete();
+
+  if (projection == RELOCATION_SKIPPED)
+    {
+    return RELOCATE_SUCCESS;
+    }
+
+  this->ProjectRelocatedPoint(pointId,projection,relocatedPoint);
+  this->Mesh->GetPoints()->SetPoint(pointId,relocatedPoint);
+
+  return RELOCATE_SUCCESS;
+}
+
+int vtkvmtkPolyDataSurfaceRemeshing::ComputeRelocatedPoint(vtkIdType pointId, vtkvmtkPolyDataUmbrellaStencil* stencil, double relocatedPoint[3])
 {
   vtkIdList* cellIds = vtkIdList::New();
   this->Mesh->GetPointCells(pointId,cellIds);
@@ -836,138 +1310,158 @@ int vtkvmtkPolyDataSurfaceRemeshing::RelocatePoint(vtkIdType pointId, bool proje
 
   if (pointOnExcludedEntity)
     {
-    return RELOCATE_SUCCESS;
+    return RELOCATION_SKIPPED;
     }
 
-#ifndef USE_STENCIL
-  vtkIdList* neighborIds = vtkIdList::New();
-  int pointLocation = this->FindOneRingNeighbors(pointId,neighborIds);
-#else
-  vtkvmtkPolyDataUmbrellaStencil* stencil = vtkvmtkPolyDataUmbrellaStencil::New();
-  stencil->SetDataSet(this->Mesh);
   stencil->SetDataSetPointId(pointId);
-  stencil->NegateWeightsOff();
   stencil->Build();
-#endif
 
-#ifndef USE_STENCIL
-  if (!pointLocation == INTERNAL_POINT)
-#else
+  double targetPoint[3];
+  targetPoint[0] = targetPoint[1] = targetPoint[2] = 0.0;
+  double stencilPoint[3];
+
+  int projection;
   if (!stencil->GetIsBoundary())
-#endif
     { 
-    double targetPoint[3];
-    targetPoint[0] = targetPoint[1] = targetPoint[2] = 0.0;
-#ifndef USE_STENCIL 
-    int numberOfNeighbors = neighborIds->GetNumberOfIds();
-    double stencilWeight = 1.0 / numberOfNeighbors;
-    for (int i=0; i<numberOfNeighbors; i++)
-      {
-      double stencilPoint[3];
-      this->Mesh->GetPoint(neighborIds->GetId(i),stencilPoint);
-      targetPoint[0] += stencilWeight * stencilPoint[0];
-      targetPoint[1] += stencilWeight * stencilPoint[1];
-      targetPoint[2] += stencilWeight * stencilPoint[2];
-      }
-#else
     for (int i=0; i<stencil->GetNumberOfPoints(); i++)
       {
-      double stencilPoint[3];
       this->Mesh->GetPoint((stencil->GetPointId(i)),stencilPoint);
       double stencilWeight = stencil->GetWeight(i);
       targetPoint[0] += stencilWeight * stencilPoint[0];
       targetPoint[1] += stencilWeight * stencilPoint[1];
       targetPoint[2] += stencilWeight * stencilPoint[2];
       }
-#endif
-    double point[3];
-    this->Mesh->GetPoint(pointId,point);
-  
-    double relocatedPoint[3];
-    relocatedPoint[0] = point[0] + this->Relaxation * (targetPoint[0] - point[0]);
-    relocatedPoint[1] = point[1] + this->Relaxation * (targetPoint[1] - point[1]);
-    relocatedPoint[2] = point[2] + this->Relaxation * (targetPoint[2] - point[2]);
- 
-    double projectedRelocatedPoint[3];
-    vtkIdType cellId;
-    int subId;
-    double dist2;
-    if (this->IsPointOnEntityBoundary(pointId))
-      {
-      this->EntityBoundaryLocator->FindClosestPoint(relocatedPoint,projectedRelocatedPoint,cellId,subId,dist2);
-      }
-    else
-      {
-      if (projectToSurface)
-        {
-        this->Locator->FindClosestPoint(relocatedPoint,projectedRelocatedPoint,cellId,subId,dist2);
-        }
-      else
-        {
-        projectedRelocatedPoint[0] = relocatedPoint[0];
-        projectedRelocatedPoint[1] = relocatedPoint[1];
-        projectedRelocatedPoint[2] = relocatedPoint[2];
-        }
-      }
-    this->Mesh->GetPoints()->SetPoint(pointId,projectedRelocatedPoint);
+    projection = this->IsPointOnEntityBoundary(pointId) ? PROJECTION_ENTITY_BOUNDARY : PROJECTION_SURFACE;
     }
   else
     {
-    double targetPoint[3];
-    targetPoint[0] = targetPoint[1] = targetPoint[2] = 0.0;
-
-    double stencilPoint[3];
-#ifndef USE_STENCIL
-    this->Mesh->GetPoint(neighborIds->GetId(0),stencilPoint);
-#else
-    this->Mesh->GetPoint((stencil->GetPointId(0)),stencilPoint);
-#endif
     double stencilWeight = 0.5;
+    this->Mesh->GetPoint((stencil->GetPointId(0)),stencilPoint);
     targetPoint[0] += stencilWeight * stencilPoint[0];
     targetPoint[1] += stencilWeight * stencilPoint[1];
     targetPoint[2] += stencilWeight * stencilPoint[2];
-#ifndef USE_STENCIL
-    this->Mesh->GetPoint(neighborIds->GetId(neighborIds->GetNumberOfIds()-1),stencilPoint);
-#else
     this->Mesh->GetPoint((stencil->GetPointId(stencil->GetNumberOfPoints()-1)),stencilPoint);
-#endif
     targetPoint[0] += stencilWeight * stencilPoint[0];
     targetPoint[1] += stencilWeight * stencilPoint[1];
     targetPoint[2] += stencilWeight * stencilPoint[2];
+    projection = PROJECTION_BOUNDARY;
+    }
 
-    double point[3];
-    this->Mesh->GetPoint(pointId,point);
+  double point[3];
+  this->Mesh->GetPoint(pointId,point);
   
-    double relocatedPoint[3];
-    relocatedPoint[0] = point[0] + this->Relaxation * (targetPoint[0] - point[0]);
-    relocatedPoint[1] = point[1] + this->Relaxation * (targetPoint[1] - point[1]);
-    relocatedPoint[2] = point[2] + this->Relaxation * (targetPoint[2] - point[2]);
-  
-    double projectedRelocatedPoint[3];
-    vtkIdType cellId;
-    int subId;
-    double dist2;
-    if (this->BoundaryLocator)
+  relocatedPoint[0] = point[0] + this->Relaxation * (targetPoint[0] - point[0]);
+  relocatedPoint[1] = point[1] + this->Relaxation * (targetPoint[1] - point[1]);
+  relocatedPoint[2] = point[2] + this->Relaxation * (targetPoint[2] - point[2]);
+
+  return projection;
+}
+
+void vtkvmtkPolyDataSurfaceRemeshing::ProjectRelocatedPoint(vtkIdType pointId, int projection, double point[3])
+{
+  vtkCellLocator* locator = NULL;
+  switch (projection)
+    {
+    case PROJECTION_SURFACE:
+      locator = this->Locator;
+      break;
+    case PROJECTION_ENTITY_BOUNDARY:
+      locator = this->EntityBoundaryLocator;
+      break;
+    case PROJECTION_BOUNDARY:
+      locator = this->BoundaryLocator;
+      break;
+    default:
+      break;
+    }
+
+  if (!locator)
+    {
+    return;
+    }
+
+  double projectedPoint[3];
+  vtkIdType cellId;
+  int subId;
+  double dist2;
+  locator->FindClosestPoint(point,projectedPoint,cellId,subId,dist2);
+  point[0] = projectedPoint[0];
+  point[1] = projectedPoint[1];
+  point[2] = projectedPoint[2];
+
+  if (projection == PROJECTION_SURFACE)
+    {
+    this->ProjectionCellIds->SetId(pointId,cellId);
+    }
+}
+
+int vtkvmtkPolyDataSurfaceRemeshing::ProjectPointFromHint(vtkIdType pointId, vtkvmtkPolyDataUmbrellaStencil* stencil, double point[3], vtkGenericCell* cell, vtkIdList* cellPointIds, double* weights)
+{
+  const int maximumNumberOfSteps = 32;
+
+  vtkIdType cellId = this->ProjectionCellIds->GetId(pointId);
+  for (vtkIdType i=0; i<stencil->GetNumberOfPoints() && cellId == -1; i++)
+    {
+    cellId = this->ProjectionCellIds->GetId(stencil->GetPointId(i));
+    }
+  if (cellId == -1)
+    {
+    return 0;
+    }
+
+  double closestPoint[3], projectedPoint[3], pcoords[3];
+  double dist2, minDist2;
+  int subId;
+
+  this->ProjectionSurface->GetCell(cellId,cell);
+  if (cell->EvaluatePosition(point,projectedPoint,subId,pcoords,minDist2,weights) == -1)
+    {
+    return 0;
+    }
+
+  // descend to the closest cell among those sharing a point with the current one
+  for (int step=0; step<maximumNumberOfSteps; step++)
+    {
+    vtkIdType closestCellId = cellId;
+    this->ProjectionSurface->GetCellPoints(cellId,cellPointIds);
+    for (vtkIdType i=0; i<cellPointIds->GetNumberOfIds(); i++)
       {
-      this->BoundaryLocator->FindClosestPoint(relocatedPoint,projectedRelocatedPoint,cellId,subId,dist2);
+      vtkIdType ncells;
+      vtkIdType* cells;
+      this->ProjectionSurface->GetPointCells(cellPointIds->GetId(i),ncells,cells);
+      for (vtkIdType j=0; j<ncells; j++)
+        {
+        if (cells[j] == cellId || cells[j] == closestCellId)
+          {
+          continue;
+          }
+        this->ProjectionSurface->GetCell(cells[j],cell);
+        if (cell->EvaluatePosition(point,closestPoint,subId,pcoords,dist2,weights) == -1)
+          {
+          continue;
+          }
+        if (dist2 < minDist2)
+          {
+          minDist2 = dist2;
+          closestCellId = cells[j];
+          projectedPoint[0] = closestPoint[0];
+          projectedPoint[1] = closestPoint[1];
+          projectedPoint[2] = closestPoint[2];
+          }
+        }
       }
-    else
+    if (closestCellId == cellId)
       {
-//      vtkErrorMacro(<<"Something's wrong: point on boundary but no BoundaryLocator is allocated.");
-      projectedRelocatedPoint[0] = relocatedPoint[0];
-      projectedRelocatedPoint[1] = relocatedPoint[1];
-      projectedRelocatedPoint[2] = relocatedPoint[2];
-//      return RELOCATE_FAILURE;
+      point[0] = projectedPoint[0];
+      point[1] = projectedPoint[1];
+      point[2] = projectedPoint[2];
+      this->ProjectionCellIds->SetId(pointId,cellId);
+      return 1;
       }
-  
-    this->Mesh->GetPoints()->SetPoint(pointId,projectedRelocatedPoint);
+    cellId = closestCellId;
     }
-#ifndef USE_STENCIL
-  neighborIds->Delete();
-#else
-  stencil->Delete();
-#endif
-  return RELOCATE_SUCCESS;
+
+  return 0;
 }
 
 int vtkvmtkPolyDataSurfaceRemeshing::GetEdgeCellsAndOppositeEdge(vtkIdType pt1, vtkIdType pt2, vtkIdType& cell1, vtkIdType& cell2, vtkIdType& pt3, vtkIdType& pt4)
@@ -1904,5 +2398,8 @@ int vtkvmtkPolyDataSurfaceRemeshing::TestAreaSplitEdge(vtkIdType cellId, vtkIdTy
 void vtkvmtkPolyDataSurfaceRemeshing::PrintSelf(std::ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+  os << indent << "ParallelRelocation: " << this->ParallelRelocation << endl;
+  os << indent << "UseProjectionHints: " << this->UseProjectionHints << endl;
+  os << indent << "UseOperationQueue: " << this->UseOperationQueue << endl;
 }
 
@@ -34,6 +34,22 @@
  * filter behind the vmtksurfaceremeshing pype script, commonly used to prepare a surface with
  * well-shaped elements prior to volumetric mesh generation.
  *
+ * With ParallelRelocation on, each point relocation pass colors the mesh points so that no two
+ * points of the same color share a triangle, then relocates the points of one color at a time in
+ * parallel: new positions are computed from the current ones into a separate buffer and copied
+ * back once the whole color is done. The result is that of a serial pass visiting the points color
+ * by color. With UseProjectionHints on, the cell of the input surface each point was last
+ * projected onto is remembered, and the next projection walks from that cell across neighboring
+ * cells instead of querying the cell locator; points without a usable hint fall back to the
+ * locator, queried serially after each color.
+ *
+ * With UseOperationQueue on, the edge collapse, flip and split sweeps over all cells of every
+ * iteration are replaced by a priority queue of the triangles that violate the area or aspect
+ * ratio criteria, worst first. Each collapse or split is followed by Delaunay flips around the
+ * modified region, and only the triangles of that region are tested and queued again. An
+ * iteration ends when the queue is empty, and remeshing stops at the first iteration that
+ * changes nothing (NumberOfIterations then only bounds the number of iterations).
+ *
  * @sa vtkvmtkPolyDataUmbrellaStencil, vtkvmtkCapPolyData
  */
 
@@ -46,7 +62,9 @@
 #include "vtkIdList.h"
 
 class vtkCellLocator;
+class vtkGenericCell;
 class vtkIntArray;
+class vtkvmtkPolyDataUmbrellaStencil;
 
 class VTK_VMTK_DIFFERENTIAL_GEOMETRY_EXPORT vtkvmtkPolyDataSurfaceRemeshing : public vtkPolyDataAlgorithm
 {
@@ -244,6 +262,38 @@ public:
   vtkGetObjectMacro(ExcludedEntityIds,vtkIdList);
   ///@}
 
+  ///@{
+  /**
+   * Toggle whether point relocation passes process independent sets of points in parallel (see
+   * above). When off, points are relocated serially, in place, in point id order. Default: on.
+   */
+  vtkSetMacro(ParallelRelocation,int);
+  vtkGetMacro(ParallelRelocation,int);
+  vtkBooleanMacro(ParallelRelocation,int);
+  ///@}
+
+  ///@{
+  /**
+   * Toggle whether projections of relocated points onto the input surface start from the cell
+   * found by the previous projection of the same point (or of one of its neighbors) and walk to
+   * the closest neighboring cell, instead of always querying the cell locator. Default: on.
+   */
+  vtkSetMacro(UseProjectionHints,int);
+  vtkGetMacro(UseProjectionHints,int);
+  vtkBooleanMacro(UseProjectionHints,int);
+  ///@}
+
+  ///@{
+  /**
+   * Toggle whether edge collapses and splits are driven by a priority queue of the triangles that
+   * need them, re-queueing only the triangles around each change, instead of by sweeps over all
+   * cells (see above). Default: off.
+   */
+  vtkSetMacro(UseOperationQueue,int);
+  vtkGetMacro(UseOperationQueue,int);
+  vtkBooleanMacro(UseOperationQueue,int);
+  ///@}
+
   //BTX
   enum {
     SUCCESS = 0,
@@ -277,6 +327,14 @@ public:
     POINT_ON_BOUNDARY,
     NO_NEIGHBORS
   };
+
+  enum {
+    RELOCATION_SKIPPED,
+    PROJECTION_NONE,
+    PROJECTION_SURFACE,
+    PROJECTION_BOUNDARY,
+    PROJECTION_ENTITY_BOUNDARY
+  };
   //ETX
 
 protected:
@@ -293,6 +351,15 @@ protected:
   int TriangleSplitIteration();
   int EdgeSplitIteration();
   int PointRelocationIteration(bool projectToSurface=true);
+  int EdgeOperationQueueIteration();
+
+  // Returns how far cellId is from the collapse (area below the target or aspect ratio above
+  // AspectRatioThreshold) or split (area above the target) criteria, as a ratio larger than 1, or
+  // 0 if the cell needs neither.
+  double ComputeOperationPriority(vtkIdType cellId);
+  // Flips the edges of the cells in cellIds that fail the Delaunay test, appending the cells the
+  // flips create to cellIds.
+  void FlipEdgesOfCells(vtkIdList* cellIds);
 
   int TestFlipEdgeValidity(vtkIdType pt1, vtkIdType pt2, vtkIdType cell1, vtkIdType cell2, vtkIdType pt3, vtkIdType pt4);
   int TestConnectivityFlipEdge(vtkIdType pt1, vtkIdType pt2);
@@ -313,6 +380,17 @@ protected:
 
   int RelocatePoint(vtkIdType pointId, bool projectToSurface);
 
+  // Computes the relocated position of pointId from the current point positions and returns the
+  // projection it still needs (one of the PROJECTION_* values, or RELOCATION_SKIPPED). Only reads
+  // the mesh, so it can run concurrently for different points given one stencil per thread.
+  int ComputeRelocatedPoint(vtkIdType pointId, vtkvmtkPolyDataUmbrellaStencil* stencil, double relocatedPoint[3]);
+  // Projects point with the locator matching projection, recording the projection cell for the
+  // surface. Not thread safe.
+  void ProjectRelocatedPoint(vtkIdType pointId, int projection, double point[3]);
+  // Projects point onto the input surface by walking from the projection hint of pointId (or of
+  // one of the stencil points); returns 0 if there is no hint or the walk does not converge.
+  int ProjectPointFromHint(vtkIdType pointId, vtkvmtkPolyDataUmbrellaStencil* stencil, double point[3], vtkGenericCell* cell, vtkIdList* cellPointIds, double* weights);
+
   int IsPointOnBoundary(vtkIdType pointId);
   int IsPointOnEntityBoundary(vtkIdType pointId);
 
@@ -332,6 +410,12 @@ protected:
   vtkDataArray* TargetAreaArray;
   vtkIdList* ExcludedEntityIds;
 
+  vtkPolyData* ProjectionSurface;
+  vtkIdList* ProjectionCellIds;
+  vtkGenericCell* ProjectionCell;
+  vtkIdList* ProjectionCellPointIds;
+  double* ProjectionWeights;
+
   double AspectRatioThreshold;
   double InternalAngleTolerance;
   double NormalAngleTolerance;
@@ -353,6 +437,12 @@ protected:
 
   char* CellEntityIdsArrayName;
 
+  int ParallelRelocation;
+  int UseProjectionHints;
+  int UseOperationQueue;
+
+  friend class vtkvmtkPolyDataSurfaceRemeshingRelocationFunctor;
+
 private:
   vtkvmtkPolyDataSurfaceRemeshing(const vtkvmtkPolyDataSurfaceRemeshing&);  // Not implemented.
   void operator=(const vtkvmtkPolyDataSurfaceRemeshing&);  // Not implemented.
@@ -25,64 +25,271 @@
 #include "vtkvmtkDoubleVector.h"
 #include "vtkvmtkConstants.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+
+#include <cstring>
+#include <vector>
 
 
 vtkStandardNewMacro(vtkvmtkSparseMatrix);
 
-vtkvmtkSparseMatrix::vtkvmtkSparseMatrix()
+static double vtkvmtkSparseMatrixClampValue(double value)
 {
-  this->NumberOfRows = 0;
-  this->Array = NULL;
+  if (fabs(value)<VTK_VMTK_PIVOTING_TOL)
+    {
+    return 0.0;
+    }
+  else if (value>VTK_VMTK_LARGE_DOUBLE)
+    {
+    return VTK_VMTK_LARGE_DOUBLE;
+    }
+  else if (value<-VTK_VMTK_LARGE_DOUBLE)
+    {
+    return -VTK_VMTK_LARGE_DOUBLE;
+    }
+  return value;
 }
 
-vtkvmtkSparseMatrix::~vtkvmtkSparseMatrix()
+// Fills the column ids of a range of compressed rows from point neighbor lists, with the layout of
+// AllocateRowsFromNeighborhoods: for every variable block, the neighbors of the point followed by
+// the point itself, except in the block of the row variable, where the point is the diagonal.
+class vtkvmtkSparseMatrixNeighborRowsFunctor
 {
-  if (this->Array)
+public:
+  vtkIdType NumberOfPoints;
+  int NumberOfVariables;
+  const vtkIdType* PointOffsets;
+  const vtkIdType* PointIds;
+  const vtkIdType* RowOffsets;
+  vtkIdType* ColumnIds;
+
+  void operator()(vtkIdType begin, vtkIdType end)
     {
-    for (int i=0; i<this->NumberOfRows; i++)
+    for (vtkIdType i=begin; i<end; i++)
       {
-      this->Array[i]->Delete();
+      vtkIdType pointId = i % this->NumberOfPoints;
+      vtkIdType variableId = i / this->NumberOfPoints;
+      vtkIdType* columnIds = this->ColumnIds + this->RowOffsets[i];
+      vtkIdType index = 0;
+      for (int n=0; n<this->NumberOfVariables; n++)
+        {
+        for (vtkIdType j=this->PointOffsets[pointId]; j<this->PointOffsets[pointId+1]; j++)
+          {
+          columnIds[index++] = this->PointIds[j] + n*this->NumberOfPoints;
+          }
+        if (n != variableId)
+          {
+          columnIds[index++] = pointId + n*this->NumberOfPoints;
+          }
+        }
       }
-    delete[] this->Array;
-    this->Array = NULL;
     }
-}
+};
 
-void vtkvmtkSparseMatrix::Initialize()
+// Copies the point ids, weights and center weight of a range of stencils into compressed rows.
+class vtkvmtkSparseMatrixStencilRowsFunctor
 {
-  if (this->Array)
+public:
+  vtkvmtkStencils* Stencils;
+  const vtkIdType* RowOffsets;
+  vtkIdType* ColumnIds;
+  double* Values;
+  double* DiagonalValues;
+
+  void operator()(vtkIdType begin, vtkIdType end)
     {
-    for (int i=0; i<this->NumberOfRows; i++)
+    if (this->Stencils->GetIsCompact())
       {
-      this->Array[i]->Delete();
+      // compact stencils are laid out like the rows (see CopyRowsFromStencils)
+      const vtkIdType* pointIds = this->Stencils->GetItemPointIds();
+      const double* weights = this->Stencils->GetItemWeights();
+      const double* centerWeights = this->Stencils->GetItemCenterWeights();
+      vtkIdType numberOfComponents = this->Stencils->GetItemNumberOfComponents();
+      for (vtkIdType i=begin; i<end; i++)
+        {
+        vtkIdType offset = this->RowOffsets[i];
+        for (vtkIdType k=offset; k<this->RowOffsets[i+1]; k++)
+          {
+          this->ColumnIds[k] = pointIds[k];
+          this->Values[k] = weights[numberOfComponents*offset+k-offset];
+          }
+        this->DiagonalValues[i] = centerWeights[numberOfComponents*i];
+        }
+      return;
+      }
+
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      vtkvmtkStencil* stencil = this->Stencils->GetStencil(i);
+      vtkIdType offset = this->RowOffsets[i];
+      vtkIdType numberOfPoints = this->RowOffsets[i+1] - offset;
+      for (vtkIdType j=0; j<numberOfPoints; j++)
+        {
+        this->ColumnIds[offset+j] = stencil->GetPointId(j);
+        this->Values[offset+j] = stencil->GetWeight(j);
+        }
+      this->DiagonalValues[i] = stencil->GetCenterWeight();
       }
-    delete[] this->Array;
-    this->Array = NULL;
     }
+};
+
+class vtkvmtkSparseMatrixMultiplyFunctor
+{
+public:
+  const vtkIdType* RowOffsets;
+  const vtkIdType* ColumnIds;
+  const double* Values;
+  const double* DiagonalValues;
+  vtkvmtkDoubleVector* X;
+  vtkvmtkDoubleVector* Y;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      double yValue = 0.0;
+      for (vtkIdType k=this->RowOffsets[i]; k<this->RowOffsets[i+1]; k++)
+        {
+        yValue += this->Values[k] * this->X->GetElement(this->ColumnIds[k]);
+        }
+      yValue += this->DiagonalValues[i] * this->X->GetElement(i);
+      this->Y->SetElement(i,vtkvmtkSparseMatrixClampValue(yValue));
+      }
+    }
+};
+
+vtkvmtkSparseMatrix::vtkvmtkSparseMatrix()
+{
   this->NumberOfRows = 0;
+  this->Array = NULL;
+  this->StorageMode = VTK_VMTK_SPARSE_MATRIX_COMPRESSED_ROWS;
+  this->RowOffsets = NULL;
+  this->ColumnIds = NULL;
+  this->Values = NULL;
+  this->DiagonalValues = NULL;
 }
 
-void vtkvmtkSparseMatrix::SetNumberOfRows(vtkIdType numberOfRows)
+vtkvmtkSparseMatrix::~vtkvmtkSparseMatrix()
+{
+  this->ReleaseRows();
+}
+
+void vtkvmtkSparseMatrix::ReleaseRows()
 {
-  //deallocate previous rows, allocate new ones
   if (this->Array)
     {
-    for (int i=0; i<this->NumberOfRows; i++)
+    for (vtkIdType i=0; i<this->NumberOfRows; i++)
       {
-      this->Array[i]->Delete();
+      if (this->Array[i])
+        {
+        this->Array[i]->Delete();
+        }
       }
     delete[] this->Array;
     this->Array = NULL;
     }
 
+  if (this->RowOffsets)
+    {
+    delete[] this->RowOffsets;
+    delete[] this->ColumnIds;
+    delete[] this->Values;
+    delete[] this->DiagonalValues;
+    this->RowOffsets = NULL;
+    this->ColumnIds = NULL;
+    this->Values = NULL;
+    this->DiagonalValues = NULL;
+    }
+
+  this->NumberOfRows = 0;
+}
+
+void vtkvmtkSparseMatrix::Initialize()
+{
+  this->ReleaseRows();
+}
+
+void vtkvmtkSparseMatrix::SetNumberOfRows(vtkIdType numberOfRows)
+{
+  //deallocate previous rows, allocate new ones
+  this->ReleaseRows();
+
   this->NumberOfRows = numberOfRows;
   this->Array = new vtkvmtkSparseMatrixRow*[numberOfRows];
-  for (int i=0; i<this->NumberOfRows; i++)
+  for (vtkIdType i=0; i<this->NumberOfRows; i++)
     {
     this->Array[i] = vtkvmtkSparseMatrixRow::New();
     }
 }
 
+void vtkvmtkSparseMatrix::AllocateCompressedRows(vtkIdType numberOfRows, const vtkIdType* rowOffsets)
+{
+  vtkIdType i;
+
+  this->ReleaseRows();
+
+  vtkIdType numberOfElements = rowOffsets[numberOfRows];
+
+  this->NumberOfRows = numberOfRows;
+  this->Array = new vtkvmtkSparseMatrixRow*[numberOfRows];
+  this->RowOffsets = new vtkIdType[numberOfRows+1];
+  this->ColumnIds = new vtkIdType[numberOfElements];
+  this->Values = new double[numberOfElements];
+  this->DiagonalValues = new double[numberOfRows];
+
+  for (i=0; i<numberOfRows; i++)
+    {
+    this->Array[i] = NULL;
+    this->DiagonalValues[i] = 0.0;
+    }
+  memcpy(this->RowOffsets,rowOffsets,(numberOfRows+1)*sizeof(vtkIdType));
+  for (i=0; i<numberOfElements; i++)
+    {
+    this->ColumnIds[i] = 0;
+    this->Values[i] = 0.0;
+    }
+}
+
+void vtkvmtkSparseMatrix::BuildRowView(vtkIdType i)
+{
+  vtkvmtkSparseMatrixRow* row = vtkvmtkSparseMatrixRow::New();
+  if (this->RowOffsets)
+    {
+    vtkIdType offset = this->RowOffsets[i];
+    row->SetView(this->RowOffsets[i+1]-offset,this->ColumnIds+offset,this->Values+offset,this->DiagonalValues+i);
+    }
+  this->Array[i] = row;
+}
+
+void vtkvmtkSparseMatrix::AllocateCompressedRowsFromPointNeighbors(vtkIdType numberOfPoints, const vtkIdType* pointOffsets, const vtkIdType* pointIds, int numberOfVariables)
+{
+  vtkIdType i;
+
+  vtkIdType numberOfRows = numberOfVariables*numberOfPoints;
+
+  // symbolic phase: row lengths, in row order
+  std::vector<vtkIdType> rowOffsets(numberOfRows+1);
+  rowOffsets[0] = 0;
+  for (i=0; i<numberOfRows; i++)
+    {
+    vtkIdType pointId = i % numberOfPoints;
+    vtkIdType numberOfNeighborhoodPoints = pointOffsets[pointId+1] - pointOffsets[pointId];
+    vtkIdType numberOfElements = numberOfNeighborhoodPoints + (numberOfVariables-1)*(numberOfNeighborhoodPoints+1);
+    rowOffsets[i+1] = rowOffsets[i] + numberOfElements;
+    }
+
+  this->AllocateCompressedRows(numberOfRows,&rowOffsets[0]);
+
+  vtkvmtkSparseMatrixNeighborRowsFunctor functor;
+  functor.NumberOfPoints = numberOfPoints;
+  functor.NumberOfVariables = numberOfVariables;
+  functor.PointOffsets = pointOffsets;
+  functor.PointIds = pointIds;
+  functor.RowOffsets = this->RowOffsets;
+  functor.ColumnIds = this->ColumnIds;
+  vtkSMPTools::For(0,numberOfRows,functor);
+}
+
 void vtkvmtkSparseMatrix::CopyRowsFromStencils(vtkvmtkStencils *stencils)
 {
   vtkIdType i;
@@ -97,6 +304,34 @@ void vtkvmtkSparseMatrix::CopyRowsFromStencils(vtkvmtkStencils *stencils)
   numberOfStencils = stencils->GetNumberOfStencils();
 
   this->Initialize();
+
+  if (this->StorageMode == VTK_VMTK_SPARSE_MATRIX_COMPRESSED_ROWS)
+    {
+    if (stencils->GetIsCompact())
+      {
+      this->AllocateCompressedRows(numberOfStencils,stencils->GetItemOffsets());
+      }
+    else
+      {
+      std::vector<vtkIdType> rowOffsets(numberOfStencils+1);
+      rowOffsets[0] = 0;
+      for (i=0; i<numberOfStencils; i++)
+        {
+        rowOffsets[i+1] = rowOffsets[i] + stencils->GetStencil(i)->GetNumberOfPoints();
+        }
+      this->AllocateCompressedRows(numberOfStencils,&rowOffsets[0]);
+      }
+
+    vtkvmtkSparseMatrixStencilRowsFunctor functor;
+    functor.Stencils = stencils;
+    functor.RowOffsets = this->RowOffsets;
+    functor.ColumnIds = this->ColumnIds;
+    functor.Values = this->Values;
+    functor.DiagonalValues = this->DiagonalValues;
+    vtkSMPTools::For(0,numberOfStencils,functor);
+    return;
+    }
+
   this->SetNumberOfRows(numberOfStencils);
 
   for (i=0; i<numberOfStencils; i++)
@@ -118,6 +353,31 @@ void vtkvmtkSparseMatrix::AllocateRowsFromNeighborhoods(vtkvmtkNeighborhoods *ne
   int numberOfRows = numberOfVariables*numberOfNeighborhoods;
 
   this->Initialize();
+
+  if (this->StorageMode == VTK_VMTK_SPARSE_MATRIX_COMPRESSED_ROWS && neighborhoods->GetIsCompact())
+    {
+    this->AllocateCompressedRowsFromPointNeighbors(numberOfNeighborhoods,neighborhoods->GetItemOffsets(),neighborhoods->GetItemPointIds(),numberOfVariables);
+    return;
+    }
+
+  if (this->StorageMode == VTK_VMTK_SPARSE_MATRIX_COMPRESSED_ROWS)
+    {
+    std::vector<vtkIdType> pointOffsets(numberOfNeighborhoods+1);
+    std::vector<vtkIdType> pointIds;
+    pointOffsets[0] = 0;
+    for (vtkIdType pointId=0; pointId<numberOfNeighborhoods; pointId++)
+      {
+      vtkvmtkNeighborhood* neighborhood = neighborhoods->GetNeighborhood(pointId);
+      for (vtkIdType j=0; j<neighborhood->GetNumberOfPoints(); j++)
+        {
+        pointIds.push_back(neighborhood->GetPointId(j));
+        }
+      pointOffsets[pointId+1] = static_cast<vtkIdType>(pointIds.size());
+      }
+    this->AllocateCompressedRowsFromPointNeighbors(numberOfNeighborhoods,&pointOffsets[0],pointIds.empty() ? NULL : &pointIds[0],numberOfVariables);
+    return;
+    }
+
   this->SetNumberOfRows(numberOfRows);
 
   int i;
@@ -179,6 +439,28 @@ void vtkvmtkSparseMatrix::AllocateRowsFromDataSet(vtkDataSet* dataSet, int numbe
   int numberOfRows = numberOfVariables*numberOfNeighborhoods;
 
   this->Initialize();
+
+  if (this->StorageMode == VTK_VMTK_SPARSE_MATRIX_COMPRESSED_ROWS)
+    {
+    // neighborhoods are built once per point, serially since they query the data set links
+    std::vector<vtkIdType> pointOffsets(numberOfNeighborhoods+1);
+    std::vector<vtkIdType> pointIds;
+    pointOffsets[0] = 0;
+    for (vtkIdType pointId=0; pointId<numberOfNeighborhoods; pointId++)
+      {
+      neighborhood->SetDataSetPointId(pointId);
+      neighborhood->Build();
+      for (vtkIdType j=0; j<neighborhood->GetNumberOfPoints(); j++)
+        {
+        pointIds.push_back(neighborhood->GetPointId(j));
+        }
+      pointOffsets[pointId+1] = static_cast<vtkIdType>(pointIds.size());
+      }
+    neighborhood->Delete();
+    this->AllocateCompressedRowsFromPointNeighbors(numberOfNeighborhoods,&pointOffsets[0],pointIds.empty() ? NULL : &pointIds[0],numberOfVariables);
+    return;
+    }
+
   this->SetNumberOfRows(numberOfRows);
 
   int i;
@@ -214,32 +496,71 @@ void vtkvmtkSparseMatrix::AllocateRowsFromDataSet(vtkDataSet* dataSet, int numbe
 
 double vtkvmtkSparseMatrix::GetElement(vtkIdType i, vtkIdType j)
 {
+  if (i == j)
+    {
+    return this->RowOffsets ? this->DiagonalValues[i] : this->GetRow(i)->GetDiagonalElement();
+    }
+  if (this->RowOffsets)
+    {
+    vtkIdType position = this->GetElementPosition(i,j);
+    if (position == -1)
+      {
+      vtkErrorMacro("Error: ElementId not in sparse matrix");
+      return 0.0;
+      }
+    return this->Values[position];
+    }
   vtkvmtkSparseMatrixRow* row = this->GetRow(i);
-  if (i != j)
-  {
-    return row->GetElement(row->GetElementIndex(j));
-  }
-  else
-  {
-    return row->GetDiagonalElement();
-  }
+  return row->GetElement(row->GetElementIndex(j));
 }
 
 void vtkvmtkSparseMatrix::SetElement(vtkIdType i, vtkIdType j, double value)
 {
+  if (i == j)
+    {
+    if (this->RowOffsets)
+      {
+      this->DiagonalValues[i] = value;
+      }
+    else
+      {
+      this->GetRow(i)->SetDiagonalElement(value);
+      }
+    return;
+    }
+  if (this->RowOffsets)
+    {
+    vtkIdType position = this->GetElementPosition(i,j);
+    if (position == -1)
+      {
+      vtkErrorMacro("Error: ElementId not in sparse matrix");
+      return;
+      }
+    this->Values[position] = value;
+    return;
+    }
   vtkvmtkSparseMatrixRow* row = this->GetRow(i);
-  if (i != j)
-  {
-    return row->SetElement(row->GetElementIndex(j),value);
-  }
-  else
-  {
-    return row->SetDiagonalElement(value);
-  }
+  row->SetElement(row->GetElementIndex(j),value);
 }
 
 void vtkvmtkSparseMatrix::AddElement(vtkIdType i, vtkIdType j, double value)
 {
+  if (this->RowOffsets)
+    {
+    if (i == j)
+      {
+      this->DiagonalValues[i] += value;
+      return;
+      }
+    vtkIdType position = this->GetElementPosition(i,j);
+    if (position == -1)
+      {
+      vtkErrorMacro("Error: ElementId not in sparse matrix");
+      return;
+      }
+    this->Values[position] += value;
+    return;
+    }
   double currentValue = this->GetElement(i,j);
   this->SetElement(i,j,currentValue+value);
 }
@@ -250,6 +571,20 @@ void vtkvmtkSparseMatrix::Multiply(vtkvmtkDoubleVector* x, vtkvmtkDoubleVector*
   double yValue, xValue;
 
   numberOfRows = this->GetNumberOfRows();
+
+  if (this->RowOffsets)
+    {
+    vtkvmtkSparseMatrixMultiplyFunctor functor;
+    functor.RowOffsets = this->RowOffsets;
+    functor.ColumnIds = this->ColumnIds;
+    functor.Values = this->Values;
+    functor.DiagonalValues = this->DiagonalValues;
+    functor.X = x;
+    functor.Y = y;
+    vtkSMPTools::For(0,numberOfRows,1024,functor);
+    return;
+    }
+
   for (i=0; i<numberOfRows; i++)
   {
     yValue = 0.0;
@@ -262,66 +597,66 @@ void vtkvmtkSparseMatrix::Multiply(vtkvmtkDoubleVector* x, vtkvmtkDoubleVector*
     xValue = x->GetElement(i);
     yValue += this->GetRow(i)->GetDiagonalElement() * xValue;
 
-    if (fabs(yValue)<VTK_VMTK_PIVOTING_TOL)
-      {
-      yValue = 0.0;
-      }
-    else if (yValue>VTK_VMTK_LARGE_DOUBLE)
-      {
-      yValue = VTK_VMTK_LARGE_DOUBLE;
-      }
-    else if (yValue<-VTK_VMTK_LARGE_DOUBLE)
-      {
-      yValue = -VTK_VMTK_LARGE_DOUBLE;
-      }
-
-    y->SetElement(i,yValue);
+    y->SetElement(i,vtkvmtkSparseMatrixClampValue(yValue));
   }
 }
 
 void vtkvmtkSparseMatrix::TransposeMultiply(vtkvmtkDoubleVector* x, vtkvmtkDoubleVector* y)
 {
   vtkIdType i, j, id, numberOfRows, numberOfRowElements;
-  double xValue, yValue;
+  double xValue;
 
-  yValue = 0.0;
-  
   y->Fill(0.0);
 
   numberOfRows = this->GetNumberOfRows();
   for (i=0; i<numberOfRows; i++)
     {
-    numberOfRowElements = this->GetRow(i)->GetNumberOfElements();
     xValue = x->GetElement(i);
-    for (j=0; j<numberOfRowElements; j++)
+    if (this->RowOffsets)
       {
-      id = this->GetRow(i)->GetElementId(j);
-      yValue = y->GetElement(id);
-      yValue += this->GetRow(i)->GetElement(j) * xValue;
-      y->SetElement(id,yValue);
-      }
-    xValue = x->GetElement(i);
-    yValue += this->GetRow(i)->GetDiagonalElement() * xValue; 
-
-    if (fabs(yValue)<VTK_VMTK_PIVOTING_TOL)
-      {
-      yValue = 0.0;
-      }
-    else if (yValue>VTK_VMTK_LARGE_DOUBLE)
-      {
-      yValue = VTK_VMTK_LARGE_DOUBLE;
+      for (j=this->RowOffsets[i]; j<this->RowOffsets[i+1]; j++)
+        {
+        y->AddElement(this->ColumnIds[j],this->Values[j] * xValue);
+        }
+      y->AddElement(i,this->DiagonalValues[i] * xValue);
+      continue;
       }
-    else if (yValue<-VTK_VMTK_LARGE_DOUBLE)
+    vtkvmtkSparseMatrixRow* row = this->GetRow(i);
+    numberOfRowElements = row->GetNumberOfElements();
+    for (j=0; j<numberOfRowElements; j++)
       {
-      yValue = -VTK_VMTK_LARGE_DOUBLE;
+      id = row->GetElementId(j);
+      y->AddElement(id,row->GetElement(j) * xValue);
       }
+    y->AddElement(i,row->GetDiagonalElement() * xValue);
+    }
 
-    y->SetElement(i,yValue);
+  for (i=0; i<y->GetNumberOfElements(); i++)
+    {
+    y->SetElement(i,vtkvmtkSparseMatrixClampValue(y->GetElement(i)));
     }
 }
 
 void vtkvmtkSparseMatrix::DeepCopy(vtkvmtkSparseMatrix *src)
 {   
+  if (src->RowOffsets)
+    {
+    vtkIdType numberOfElements = src->RowOffsets[src->NumberOfRows];
+    this->AllocateCompressedRows(src->NumberOfRows,src->RowOffsets);
+    memcpy(this->ColumnIds,src->ColumnIds,numberOfElements*sizeof(vtkIdType));
+    memcpy(this->Values,src->Values,numberOfElements*sizeof(double));
+    memcpy(this->DiagonalValues,src->DiagonalValues,src->NumberOfRows*sizeof(double));
+    // rows emptied through their views keep zero values in the storage and a shorter length
+    for (vtkIdType i=0; i<src->NumberOfRows; i++)
+      {
+      if (src->Array[i] && src->Array[i]->GetNumberOfElements() != src->RowOffsets[i+1]-src->RowOffsets[i])
+        {
+        this->GetRow(i)->AllocateElements(src->Array[i]->GetNumberOfElements());
+        }
+      }
+    return;
+    }
+
   this->SetNumberOfRows(src->NumberOfRows);
 
   for (int i=0; i<this->NumberOfRows; i++)
@@ -329,4 +664,3 @@ void vtkvmtkSparseMatrix::DeepCopy(vtkvmtkSparseMatrix *src)
     this->Array[i]->DeepCopy(src->GetRow(i));
     }
 }
-
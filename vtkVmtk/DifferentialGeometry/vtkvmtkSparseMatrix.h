@@ -32,6 +32,16 @@
  * (vtkvmtkFEAssembler subclasses) throughout vmtk's harmonic mapping, gradient, and vorticity
  * filters.
  *
+ * With StorageMode set to compressed rows (the default), the matrix built by the Allocate.../
+ * CopyRowsFromStencils/DeepCopy methods is stored in compressed sparse row (CSR) form: row offsets,
+ * column ids and values in three contiguous arrays, plus one array of diagonal values. The sparsity
+ * pattern is computed first (symbolic phase, in row order) and the rows are then filled in parallel
+ * with vtkSMPTools (numeric phase); Multiply also runs in parallel over rows. In this mode GetRow()
+ * returns a vtkvmtkSparseMatrixRow view, created on first access, that reads and writes the
+ * compressed arrays in place; GetRow() is therefore not thread safe, and concurrent code should use
+ * the raw arrays (GetRowOffsets, GetColumnIds, GetValues, GetDiagonalValues) instead. SetNumberOfRows
+ * always creates independent rows, as in earlier versions.
+ *
  * @sa vtkvmtkSparseMatrixRow, vtkvmtkDoubleVector, vtkvmtkLinearSystem, vtkvmtkFEAssembler
  */
 
@@ -46,6 +56,9 @@
 #include "vtkDataSet.h"
 #include "vtkvmtkWin32Header.h"
 
+#define VTK_VMTK_SPARSE_MATRIX_ROWS 0
+#define VTK_VMTK_SPARSE_MATRIX_COMPRESSED_ROWS 1
+
 class VTK_VMTK_DIFFERENTIAL_GEOMETRY_EXPORT vtkvmtkSparseMatrix : public vtkObject
 {
 public:
@@ -56,20 +69,92 @@ public:
   /**
    * Compute y = A*x, the matrix-vector product of this sparse matrix with x, storing the result
    * in y. Values are clamped to +/-VTK_VMTK_LARGE_DOUBLE and snapped to zero below
-   * VTK_VMTK_PIVOTING_TOL to guard against overflow/underflow.
+   * VTK_VMTK_PIVOTING_TOL to guard against overflow/underflow. Rows are processed in parallel when
+   * the matrix is compressed.
    */
   void Multiply(vtkvmtkDoubleVector* x, vtkvmtkDoubleVector* y);
 
   /**
    * Compute y = A^T*x, the matrix-vector product of this sparse matrix's transpose with x,
-   * storing the result in y. Values are clamped/snapped the same way as Multiply().
+   * storing the result in y. Values are clamped/snapped the same way as Multiply(). Unlike Multiply,
+   * this runs serially, since rows scatter into shared entries of y.
    */
   void TransposeMultiply(vtkvmtkDoubleVector* x, vtkvmtkDoubleVector* y);
 
   /**
-   * Get a row given a row id.
+   * Get a row given a row id. For a compressed matrix the row is a view over the compressed arrays,
+   * created on first access.
+   */
+  vtkvmtkSparseMatrixRow* GetRow(vtkIdType i)
+    {
+    if (!this->Array[i])
+      {
+      this->BuildRowView(i);
+      }
+    return this->Array[i];
+    }
+
+  ///@{
+  /**
+   * Set/Get the storage used by the Allocate.../CopyRowsFromStencils/DeepCopy methods:
+   * VTK_VMTK_SPARSE_MATRIX_COMPRESSED_ROWS (default) or VTK_VMTK_SPARSE_MATRIX_ROWS, one
+   * independently allocated vtkvmtkSparseMatrixRow per row.
+   */
+  vtkSetClampMacro(StorageMode,int,VTK_VMTK_SPARSE_MATRIX_ROWS,VTK_VMTK_SPARSE_MATRIX_COMPRESSED_ROWS);
+  vtkGetMacro(StorageMode,int);
+  void SetStorageModeToRows() { this->SetStorageMode(VTK_VMTK_SPARSE_MATRIX_ROWS); }
+  void SetStorageModeToCompressedRows() { this->SetStorageMode(VTK_VMTK_SPARSE_MATRIX_COMPRESSED_ROWS); }
+  ///@}
+
+  /**
+   * Get whether the matrix is currently held in compressed sparse row form.
+   */
+  int GetIsCompressed() { return this->RowOffsets != NULL; }
+
+  /**
+   * Initialize the matrix as a compressed matrix with numberOfRows rows, row i having
+   * rowOffsets[i+1]-rowOffsets[i] off-diagonal elements (rowOffsets has numberOfRows+1 entries,
+   * starting at 0). Column ids, values and diagonal values are set to 0; column ids are then to be
+   * filled through GetColumnIds() (symbolic phase) and values through GetValues()/GetDiagonalValues()
+   * or SetElement/AddElement (numeric phase).
    */
-  vtkvmtkSparseMatrixRow* GetRow(vtkIdType i) { return this->Array[i]; }
+  void AllocateCompressedRows(vtkIdType numberOfRows, const vtkIdType* rowOffsets);
+
+  ///@{
+  /**
+   * Direct access to the compressed arrays (NULL if the matrix is not compressed): the
+   * off-diagonal elements of row i are ColumnIds/Values[RowOffsets[i]] to
+   * ColumnIds/Values[RowOffsets[i+1]-1], its diagonal is DiagonalValues[i].
+   */
+  vtkIdType* GetRowOffsets() { return this->RowOffsets; }
+  vtkIdType* GetColumnIds() { return this->ColumnIds; }
+  double* GetValues() { return this->Values; }
+  double* GetDiagonalValues() { return this->DiagonalValues; }
+  ///@}
+
+  /**
+   * For a compressed matrix, get the position in GetValues() of the off-diagonal element at row i,
+   * column j, or -1 if the element is not in the sparsity pattern (or the matrix is not compressed).
+   * Positions stay valid until the matrix is reallocated, so they can be computed once and reused
+   * across numeric assemblies.
+   */
+  vtkIdType GetElementPosition(vtkIdType i, vtkIdType j)
+    {
+    if (!this->RowOffsets)
+      {
+      return -1;
+      }
+    // a row emptied through its view (vtkvmtkSparseMatrixRow::Initialize) keeps its slots, unused
+    vtkIdType end = this->Array[i] ? this->RowOffsets[i] + this->Array[i]->NElements : this->RowOffsets[i+1];
+    for (vtkIdType k=this->RowOffsets[i]; k<end; k++)
+      {
+      if (this->ColumnIds[k] == j)
+        {
+        return k;
+        }
+      }
+    return -1;
+    }
 
   /**
    * Get the number of rows currently allocated in the matrix. Use SetNumberOfRows() to change it.
@@ -133,7 +218,8 @@ public:
   void AddElement(vtkIdType i, vtkIdType j, double value);
 
   /**
-   * Standard DeepCopy method: copies the number of rows and the contents of every row from src.
+   * Standard DeepCopy method: copies the number of rows and the contents of every row from src. A
+   * compressed src is copied as a compressed matrix.
    */
   void DeepCopy(vtkvmtkSparseMatrix *src);
 
@@ -141,9 +227,23 @@ protected:
   vtkvmtkSparseMatrix();
   ~vtkvmtkSparseMatrix();
 
+  void BuildRowView(vtkIdType i);
+
+  // Fills a compressed matrix with numberOfVariables blocks of rows from point neighbor lists
+  // given in CSR form, as AllocateRowsFromNeighborhoods does.
+  void AllocateCompressedRowsFromPointNeighbors(vtkIdType numberOfPoints, const vtkIdType* pointOffsets, const vtkIdType* pointIds, int numberOfVariables);
+
+  void ReleaseRows();
+
   vtkvmtkSparseMatrixRow** Array;
   vtkIdType NumberOfRows;
 
+  int StorageMode;
+  vtkIdType* RowOffsets;
+  vtkIdType* ColumnIds;
+  double* Values;
+  double* DiagonalValues;
+
 private:
   vtkvmtkSparseMatrix(const vtkvmtkSparseMatrix&);  // Not implemented.
   void operator=(const vtkvmtkSparseMatrix&);  // Not implemented.
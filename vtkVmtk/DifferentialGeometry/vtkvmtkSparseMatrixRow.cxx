@@ -29,13 +29,21 @@ vtkStandardNewMacro(vtkvmtkSparseMatrixRow);
 vtkvmtkSparseMatrixRow::vtkvmtkSparseMatrixRow()
 {
   this->NElements = 0;
+  this->Capacity = 0;
   this->ElementIds = NULL;
   this->Elements = NULL;
   this->DiagonalElement = 0.0;
+  this->Diagonal = &this->DiagonalElement;
+  this->IsView = 0;
 }
 
 vtkvmtkSparseMatrixRow::~vtkvmtkSparseMatrixRow()
 {
+  if (this->IsView)
+    {
+    return;
+    }
+
   if (this->ElementIds!=NULL)
     {
     delete[] this->ElementIds;
@@ -49,9 +57,49 @@ vtkvmtkSparseMatrixRow::~vtkvmtkSparseMatrixRow()
     }
 }
 
-void vtkvmtkSparseMatrixRow::Initialize()
+void vtkvmtkSparseMatrixRow::SetView(vtkIdType numberOfElements, vtkIdType* elementIds, double* elements, double* diagonal)
 {
-  this->NElements = 0;
+  if (!this->IsView)
+    {
+    if (this->ElementIds!=NULL)
+      {
+      delete[] this->ElementIds;
+      }
+    if (this->Elements!=NULL)
+      {
+      delete[] this->Elements;
+      }
+    }
+
+  this->NElements = numberOfElements;
+  this->Capacity = numberOfElements;
+  this->ElementIds = elementIds;
+  this->Elements = elements;
+  this->Diagonal = diagonal;
+  this->IsView = 1;
+}
+
+int vtkvmtkSparseMatrixRow::AllocateElements(vtkIdType numberOfElements)
+{
+  vtkIdType i;
+
+  if (this->IsView)
+    {
+    if (numberOfElements > this->Capacity)
+      {
+      vtkErrorMacro(<<"Cannot grow a row of a compressed sparse matrix beyond "<<this->Capacity<<" elements.");
+      return 0;
+      }
+    // unused slots stay in the compressed storage, with zero values
+    for (i=numberOfElements; i<this->Capacity; i++)
+      {
+      this->Elements[i] = 0.0;
+      }
+    this->NElements = numberOfElements;
+    return 1;
+    }
+
+  this->NElements = numberOfElements;
 
   if (this->ElementIds!=NULL)
     {
@@ -59,20 +107,29 @@ void vtkvmtkSparseMatrixRow::Initialize()
     this->ElementIds = NULL;
     }
 
+  this->ElementIds = new vtkIdType[this->NElements];
+
   if (this->Elements!=NULL)
     {
     delete[] this->Elements;
     this->Elements = NULL;
     }
 
-  this->DiagonalElement = 0.0;
+  this->Elements = new double[this->NElements];
+
+  return 1;
 }
 
-void vtkvmtkSparseMatrixRow::SetNumberOfElements(vtkIdType numberOfElements)
+void vtkvmtkSparseMatrixRow::Initialize()
 {
-  vtkIdType i;
+  if (this->IsView)
+    {
+    this->AllocateElements(0);
+    *this->Diagonal = 0.0;
+    return;
+    }
 
-  this->NElements = numberOfElements;
+  this->NElements = 0;
 
   if (this->ElementIds!=NULL)
     {
@@ -80,27 +137,35 @@ void vtkvmtkSparseMatrixRow::SetNumberOfElements(vtkIdType numberOfElements)
     this->ElementIds = NULL;
     }
 
-  this->ElementIds = new vtkIdType[this->NElements];
-
-  for (i=0; i<this->NElements; i++)
-    {
-    this->ElementIds[i] = 0;
-    }
-
   if (this->Elements!=NULL)
     {
     delete[] this->Elements;
     this->Elements = NULL;
     }
 
-  this->Elements = new double[this->NElements];
+  *this->Diagonal = 0.0;
+}
+
+void vtkvmtkSparseMatrixRow::SetNumberOfElements(vtkIdType numberOfElements)
+{
+  vtkIdType i;
+
+  if (!this->AllocateElements(numberOfElements))
+    {
+    return;
+    }
+
+  for (i=0; i<this->NElements; i++)
+    {
+    this->ElementIds[i] = 0;
+    }
 
   for (i=0; i<this->NElements; i++)
     {
     this->Elements[i] = 0.0;
     }
 
-  this->DiagonalElement = 0.0;
+  *this->Diagonal = 0.0;
 }
 
 vtkIdType vtkvmtkSparseMatrixRow::GetElementIndex(vtkIdType id)
@@ -127,35 +192,22 @@ void vtkvmtkSparseMatrixRow::CopyStencil(vtkvmtkStencil* stencil)
 {
   vtkIdType i;
 
-  this->NElements = stencil->GetNumberOfPoints();
-
-  if (this->ElementIds!=NULL)
+  if (!this->AllocateElements(stencil->GetNumberOfPoints()))
     {
-    delete[] this->ElementIds;
-    this->ElementIds = NULL;
+    return;
     }
 
-  this->ElementIds = new vtkIdType[this->NElements];
-
   for (i=0; i<this->NElements; i++)
     {
     this->ElementIds[i] = stencil->GetPointId(i);
     }
 
-  if (this->Elements!=NULL)
-    {
-    delete[] this->Elements;
-    this->Elements = NULL;
-    }
-
-  this->Elements = new double[this->NElements];
-
   for (i=0; i<this->NElements; i++)
     {
     this->Elements[i] = stencil->GetWeight(i);
     }
 
-  this->DiagonalElement = stencil->GetCenterWeight();
+  *this->Diagonal = stencil->GetCenterWeight();
 }
 
 void vtkvmtkSparseMatrixRow::CopyNeighborhood(vtkvmtkNeighborhood* neighborhood)
@@ -166,6 +218,11 @@ void vtkvmtkSparseMatrixRow::CopyNeighborhood(vtkvmtkNeighborhood* neighborhood)
 
   this->SetNumberOfElements(numberOfNeighborhoodPoints);
 
+  if (this->NElements != numberOfNeighborhoodPoints)
+    {
+    return;
+    }
+
   for (i=0; i<numberOfNeighborhoodPoints; i++)
     {
     this->ElementIds[i] = neighborhood->GetPointId(i);
@@ -174,28 +231,41 @@ void vtkvmtkSparseMatrixRow::CopyNeighborhood(vtkvmtkNeighborhood* neighborhood)
 
 void vtkvmtkSparseMatrixRow::DeepCopy(vtkvmtkSparseMatrixRow *src)
 {
-  if (this->ElementIds != NULL)
+  if (this->IsView)
     {
-    delete[] this->ElementIds;
-    this->ElementIds = NULL;
+    if (!this->AllocateElements(src->NElements))
+      {
+      return;
+      }
     }
-
-  if (this->Elements != NULL)
+  else
     {
-    delete[] this->Elements;
-    this->Elements = NULL;
-    }
+    if (this->ElementIds != NULL)
+      {
+      delete[] this->ElementIds;
+      this->ElementIds = NULL;
+      }
+
+    if (this->Elements != NULL)
+      {
+      delete[] this->Elements;
+      this->Elements = NULL;
+      }
 
-  this->NElements = src->NElements;
+    this->NElements = src->NElements;
+
+    if (src->NElements > 0)
+      {
+      this->ElementIds = new vtkIdType[src->NElements];
+      this->Elements = new double[src->NElements];
+      }
+    }
 
   if (src->NElements > 0)
     {
-    this->ElementIds = new vtkIdType[src->NElements];
     memcpy(this->ElementIds, src->ElementIds, this->NElements * sizeof(vtkIdType));
-    this->Elements = new double[src->NElements];
     memcpy(this->Elements, src->Elements, this->NElements * sizeof(double));
     }
 
-  this->DiagonalElement = src->DiagonalElement;
+  *this->Diagonal = *src->Diagonal;
 }
-
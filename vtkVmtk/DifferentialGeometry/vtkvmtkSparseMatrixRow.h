@@ -27,6 +27,12 @@
  * point ids of a vtkvmtkNeighborhood (CopyNeighborhood). It is the building block used by
  * vtkvmtkSparseMatrix.
  *
+ * A row either owns its arrays or is a view over the compressed (CSR) storage of a
+ * vtkvmtkSparseMatrix, in which case ids, values and diagonal are read and written in place in the
+ * matrix arrays. A view cannot grow beyond the number of elements it was created with: Initialize()
+ * zeroes its values instead of releasing them, and SetNumberOfElements/CopyStencil/CopyNeighborhood/
+ * DeepCopy fail with an error if more elements are requested.
+ *
  * @sa vtkvmtkSparseMatrix, vtkvmtkStencil, vtkvmtkNeighborhood
  */
 
@@ -85,10 +91,15 @@ public:
    * Set/get the diagonal value of this matrix row, stored separately from the off-diagonal
    * entries. Default: 0.0.
    */
-  vtkSetMacro(DiagonalElement,double);
-  vtkGetMacro(DiagonalElement,double);
+  void SetDiagonalElement(double value) { *this->Diagonal = value; }
+  double GetDiagonalElement() { return *this->Diagonal; }
   ///@}
 
+  /**
+   * Get whether this row is a view over the compressed storage of a vtkvmtkSparseMatrix.
+   */
+  vtkGetMacro(IsView,int);
+
   /**
    * Release the row's element arrays, reset the number of elements to zero, and reset the
    * diagonal element to 0.0.
@@ -118,10 +129,23 @@ protected:
   vtkvmtkSparseMatrixRow();
   ~vtkvmtkSparseMatrixRow();
 
+  // Makes the row a view over numberOfElements ids and values and one diagonal value owned by a
+  // compressed vtkvmtkSparseMatrix.
+  void SetView(vtkIdType numberOfElements, vtkIdType* elementIds, double* elements, double* diagonal);
+
+  // Prepares room for numberOfElements elements, reallocating owned arrays or checking the capacity
+  // of a view. Returns 0 if a view is too small.
+  int AllocateElements(vtkIdType numberOfElements);
+
   vtkIdType* ElementIds;
   double* Elements;
   double DiagonalElement;
+  double* Diagonal;
   vtkIdType NElements;
+  vtkIdType Capacity;
+  int IsView;
+
+  friend class vtkvmtkSparseMatrix;
 
 private:
   vtkvmtkSparseMatrixRow(const vtkvmtkSparseMatrixRow&);  // Not implemented.
@@ -37,6 +37,11 @@ vtkvmtkStencil::vtkvmtkStencil()
 
 vtkvmtkStencil::~vtkvmtkStencil()
   {
+  if (this->IsView)
+    {
+    return;
+    }
+
   if (this->CenterWeight != NULL)
     {
     delete[] this->CenterWeight;
@@ -50,6 +55,27 @@ vtkvmtkStencil::~vtkvmtkStencil()
     }
   }
 
+void vtkvmtkStencil::SetView(vtkIdType numberOfPoints, vtkIdType* pointIds, bool isBoundary, vtkIdType numberOfComponents, double* weights, double* centerWeight)
+  {
+  if (!this->IsView)
+    {
+    if (this->CenterWeight != NULL)
+      {
+      delete[] this->CenterWeight;
+      }
+    if (this->Weights != NULL)
+      {
+      delete[] this->Weights;
+      }
+    }
+
+  this->Superclass::SetView(numberOfPoints,pointIds,isBoundary);
+
+  this->NumberOfComponents = numberOfComponents;
+  this->Weights = weights;
+  this->CenterWeight = centerWeight;
+  }
+
 void vtkvmtkStencil::ChangeWeightSign()
 {
   if (!this->NegateWeights)
@@ -131,6 +157,8 @@ void vtkvmtkStencil::ScaleWeights(double factor)
 
 void vtkvmtkStencil::DeepCopy(vtkvmtkItem *src)
   {
+  int isView = this->IsView;
+
   this->Superclass::DeepCopy(src);
 
   vtkvmtkStencil* stencilSrc = vtkvmtkStencil::SafeDownCast(src);
@@ -140,17 +168,17 @@ void vtkvmtkStencil::DeepCopy(vtkvmtkItem *src)
     vtkErrorMacro(<<"Trying to deep copy a non-stencil item");
     }
 
-  if (this->CenterWeight != NULL)
+  if (this->CenterWeight != NULL && !isView)
     {
     delete[] this->CenterWeight;
-    this->CenterWeight = NULL;
     }
+  this->CenterWeight = NULL;
 
-  if (this->Weights != NULL)
+  if (this->Weights != NULL && !isView)
     {
     delete[] this->Weights;
-    this->Weights = NULL;
     }
+  this->Weights = NULL;
 
   this->NumberOfComponents = stencilSrc->NumberOfComponents;
 
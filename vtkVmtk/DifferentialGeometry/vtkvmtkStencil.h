@@ -154,6 +154,10 @@ protected:
 
   void ChangeWeightSign();
 
+  // Makes the stencil a view over point ids, weights and center weights owned by a compact
+  // vtkvmtkDataSetItems collection.
+  void SetView(vtkIdType numberOfPoints, vtkIdType* pointIds, bool isBoundary, vtkIdType numberOfComponents, double* weights, double* centerWeight);
+
   vtkIdType NumberOfComponents;
   double* Weights;
   double* CenterWeight;
@@ -161,6 +165,8 @@ protected:
   int WeightScaling;
 
   int NegateWeights;
+
+  friend class vtkvmtkDataSetItems;
   
 private:
   vtkvmtkStencil(const vtkvmtkStencil&);  // Not implemented.
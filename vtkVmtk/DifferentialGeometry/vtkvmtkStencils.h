@@ -23,7 +23,10 @@
  * vtkvmtkDataSetItems::SetDataSet), instantiating the concrete stencil subclass requested by
  * SetItemType (or the SetStencilTypeTo* convenience methods) for each point. WeightScaling and
  * NegateWeights are propagated to every stencil instantiated afterwards, mirroring the
- * like-named flags on vtkvmtkStencil itself.
+ * like-named flags on vtkvmtkStencil itself. Stencils are stored in compact form by default (see
+ * vtkvmtkDataSetItems::StorageMode), in which case the weights of all stencils can be read from
+ * the flat GetItemWeights()/GetItemCenterWeights() arrays; with ReallocateOnBuild off, Build()
+ * keeps the stencils already built for a data set with the same number of points.
  *
  * @sa vtkvmtkStencil, vtkvmtkDataSetItems
  */
@@ -86,7 +89,7 @@ public:
   /**
    * Get a stencil given a point id.
    */
-  vtkvmtkStencil* GetStencil(vtkIdType ptId) {return (vtkvmtkStencil*)this->Array[ptId];};
+  vtkvmtkStencil* GetStencil(vtkIdType ptId) {return (vtkvmtkStencil*)this->GetItem(ptId);};
 
   ///@{
   /**
@@ -130,6 +133,8 @@ protected:
 
   virtual vtkvmtkItem* InstantiateNewItem(int itemType) override;
 
+  virtual int GetReuseBuiltItems() override {return 1;};
+
   int WeightScaling;
 
   int NegateWeights;
@@ -20,11 +20,8 @@
 =========================================================================*/
 
 #include "vtkvmtkUnstructuredGridFEGradientAssembler.h"
-#include "vtkvmtkGaussQuadrature.h"
-#include "vtkvmtkFEShapeFunctions.h"
 #include "vtkPointData.h"
 #include "vtkDataArray.h"
-#include "vtkCell.h"
 #include "vtkMath.h"
 #include "vtkObjectFactory.h"
 
@@ -35,6 +32,7 @@ vtkvmtkUnstructuredGridFEGradientAssembler::vtkvmtkUnstructuredGridFEGradientAss
 {
   this->ScalarsArrayName = NULL;
   this->ScalarsComponent = 0;
+  this->ScalarsArray = NULL;
   this->AssemblyMode = VTKVMTK_GRADIENTASSEMBLY;
   this->Direction = 0;
 }
@@ -83,73 +81,11 @@ void vtkvmtkUnstructuredGridFEGradientAssembler::BuildGradient()
   int numberOfVariables = 3;
   this->Initialize(numberOfVariables);
 
-  vtkvmtkGaussQuadrature* gaussQuadrature = vtkvmtkGaussQuadrature::New();
-  gaussQuadrature->SetOrder(this->QuadratureOrder);
-
-  vtkvmtkFEShapeFunctions* feShapeFunctions = vtkvmtkFEShapeFunctions::New();
-
   int dimension = 3;
 
-  int numberOfCells = this->DataSet->GetNumberOfCells();
-  int numberOfPoints = this->DataSet->GetNumberOfPoints();
-  int k;
-  for (k=0; k<numberOfCells; k++)
-    {
-    vtkCell* cell = this->DataSet->GetCell(k);
-    if (cell->GetCellDimension() != dimension)
-      {
-      continue;
-      } 
-    gaussQuadrature->Initialize(cell->GetCellType());
-    feShapeFunctions->Initialize(cell,gaussQuadrature->GetQuadraturePoints());
-    int numberOfQuadraturePoints = gaussQuadrature->GetNumberOfQuadraturePoints();
-    double quadraturePCoords[3];
-    int numberOfCellPoints = cell->GetNumberOfPoints();
-    int i, j;
-    int q;
-    for (q=0; q<numberOfQuadraturePoints; q++)
-      {
-      gaussQuadrature->GetQuadraturePoint(q,quadraturePCoords);
-      double quadratureWeight = gaussQuadrature->GetQuadratureWeight(q);
-      double jacobian = feShapeFunctions->GetJacobian(q);
-      double phii, phij;
-      double dphii[3];
-      double gradientValue[3];
-      gradientValue[0] = gradientValue[1] = gradientValue[2] = 0.0;
-      for (i=0; i<numberOfCellPoints; i++)
-        {
-        vtkIdType iId = cell->GetPointId(i);
-        feShapeFunctions->GetDPhi(q,i,dphii);
-        double nodalValue = scalarsArray->GetComponent(iId,this->ScalarsComponent);
-        gradientValue[0] += nodalValue * dphii[0];
-        gradientValue[1] += nodalValue * dphii[1];
-        gradientValue[2] += nodalValue * dphii[2];
-        }
-      for (i=0; i<numberOfCellPoints; i++)
-        {
-        vtkIdType iId = cell->GetPointId(i);
-        phii = feShapeFunctions->GetPhi(q,i);
-        double value0 = jacobian * quadratureWeight * gradientValue[0] * phii;
-        double value1 = jacobian * quadratureWeight * gradientValue[1] * phii;
-        double value2 = jacobian * quadratureWeight * gradientValue[2] * phii;
-        this->RHSVector->AddElement(iId,value0);
-        this->RHSVector->AddElement(iId+numberOfPoints,value1);
-        this->RHSVector->AddElement(iId+2*numberOfPoints,value2);
-        for (j=0; j<numberOfCellPoints; j++)
-          {
-          vtkIdType jId = cell->GetPointId(j);
-          phij = feShapeFunctions->GetPhi(q,j);
-          double value = jacobian * quadratureWeight * phii * phij;
-          this->Matrix->AddElement(iId,jId,value);
-          this->Matrix->AddElement(iId+numberOfPoints,jId+numberOfPoints,value);
-          this->Matrix->AddElement(iId+2*numberOfPoints,jId+2*numberOfPoints,value);
-          }
-        }
-      }
-    }
-
-  gaussQuadrature->Delete();
-  feShapeFunctions->Delete();
+  this->ScalarsArray = scalarsArray;
+  this->AssembleElements(dimension);
+  this->ScalarsArray = NULL;
 }
 
 void vtkvmtkUnstructuredGridFEGradientAssembler::BuildPartialDerivative()
@@ -171,62 +107,101 @@ void vtkvmtkUnstructuredGridFEGradientAssembler::BuildPartialDerivative()
   int numberOfVariables = 1;
   this->Initialize(numberOfVariables);
 
-  vtkvmtkGaussQuadrature* gaussQuadrature = vtkvmtkGaussQuadrature::New();
-  gaussQuadrature->SetOrder(this->QuadratureOrder);
+  int dimension = 3;
 
-  vtkvmtkFEShapeFunctions* feShapeFunctions = vtkvmtkFEShapeFunctions::New();
+  this->ScalarsArray = scalarsArray;
+  this->AssembleElements(dimension);
+  this->ScalarsArray = NULL;
+}
 
-  int dimension = 3;
+void vtkvmtkUnstructuredGridFEGradientAssembler::AssembleElement(vtkvmtkFEElement* element)
+{
+  if (this->AssemblyMode == VTKVMTK_PARTIALDERIVATIVEASSEMBLY)
+    {
+    this->AssemblePartialDerivativeElement(element);
+    return;
+    }
+  this->AssembleGradientElement(element);
+}
 
-  int numberOfCells = this->DataSet->GetNumberOfCells();
-  int k;
-  for (k=0; k<numberOfCells; k++)
+void vtkvmtkUnstructuredGridFEGradientAssembler::AssembleGradientElement(vtkvmtkFEElement* element)
+{
+  vtkIdType numberOfPoints = this->DataSet->GetNumberOfPoints();
+  int numberOfQuadraturePoints = element->GetNumberOfQuadraturePoints();
+  int numberOfCellPoints = element->GetNumberOfPoints();
+  int i, j;
+  int q;
+  for (q=0; q<numberOfQuadraturePoints; q++)
     {
-    vtkCell* cell = this->DataSet->GetCell(k);
-    if (cell->GetCellDimension() != dimension)
+    double quadratureWeight = element->GetQuadratureWeight(q);
+    double jacobian = element->GetJacobian(q);
+    double phii, phij;
+    double gradientValue[3];
+    gradientValue[0] = gradientValue[1] = gradientValue[2] = 0.0;
+    for (i=0; i<numberOfCellPoints; i++)
       {
-      continue;
-      } 
-    gaussQuadrature->Initialize(cell->GetCellType());
-    feShapeFunctions->Initialize(cell,gaussQuadrature->GetQuadraturePoints());
-    int numberOfQuadraturePoints = gaussQuadrature->GetNumberOfQuadraturePoints();
-    double quadraturePCoords[3];
-    int numberOfCellPoints = cell->GetNumberOfPoints();
-    int i, j;
-    int q;
-    for (q=0; q<numberOfQuadraturePoints; q++)
+      vtkIdType iId = element->GetPointId(i);
+      const double* dphii = element->GetDPhi(q,i);
+      double nodalValue = this->ScalarsArray->GetComponent(iId,this->ScalarsComponent);
+      gradientValue[0] += nodalValue * dphii[0];
+      gradientValue[1] += nodalValue * dphii[1];
+      gradientValue[2] += nodalValue * dphii[2];
+      }
+    for (i=0; i<numberOfCellPoints; i++)
       {
-      gaussQuadrature->GetQuadraturePoint(q,quadraturePCoords);
-      double quadratureWeight = gaussQuadrature->GetQuadratureWeight(q);
-      double jacobian = feShapeFunctions->GetJacobian(q);
-      double phii, phij;
-      double dphii[3];
-      double partialDerivativeValue = 0.0;
-      for (i=0; i<numberOfCellPoints; i++)
+      vtkIdType iId = element->GetPointId(i);
+      phii = element->GetPhi(q,i);
+      double value0 = jacobian * quadratureWeight * gradientValue[0] * phii;
+      double value1 = jacobian * quadratureWeight * gradientValue[1] * phii;
+      double value2 = jacobian * quadratureWeight * gradientValue[2] * phii;
+      this->RHSVector->AddElement(iId,value0);
+      this->RHSVector->AddElement(iId+numberOfPoints,value1);
+      this->RHSVector->AddElement(iId+2*numberOfPoints,value2);
+      for (j=0; j<numberOfCellPoints; j++)
         {
-        vtkIdType iId = cell->GetPointId(i);
-        feShapeFunctions->GetDPhi(q,i,dphii);
-        double nodalValue = scalarsArray->GetComponent(iId,this->ScalarsComponent);
-        partialDerivativeValue += nodalValue * dphii[this->Direction];
+        vtkIdType jId = element->GetPointId(j);
+        phij = element->GetPhi(q,j);
+        double value = jacobian * quadratureWeight * phii * phij;
+        this->Matrix->AddElement(iId,jId,value);
+        this->Matrix->AddElement(iId+numberOfPoints,jId+numberOfPoints,value);
+        this->Matrix->AddElement(iId+2*numberOfPoints,jId+2*numberOfPoints,value);
         }
-      for (i=0; i<numberOfCellPoints; i++)
+      }
+    }
+}
+
+void vtkvmtkUnstructuredGridFEGradientAssembler::AssemblePartialDerivativeElement(vtkvmtkFEElement* element)
+{
+  int numberOfQuadraturePoints = element->GetNumberOfQuadraturePoints();
+  int numberOfCellPoints = element->GetNumberOfPoints();
+  int i, j;
+  int q;
+  for (q=0; q<numberOfQuadraturePoints; q++)
+    {
+    double quadratureWeight = element->GetQuadratureWeight(q);
+    double jacobian = element->GetJacobian(q);
+    double phii, phij;
+    double partialDerivativeValue = 0.0;
+    for (i=0; i<numberOfCellPoints; i++)
+      {
+      vtkIdType iId = element->GetPointId(i);
+      const double* dphii = element->GetDPhi(q,i);
+      double nodalValue = this->ScalarsArray->GetComponent(iId,this->ScalarsComponent);
+      partialDerivativeValue += nodalValue * dphii[this->Direction];
+      }
+    for (i=0; i<numberOfCellPoints; i++)
+      {
+      vtkIdType iId = element->GetPointId(i);
+      phii = element->GetPhi(q,i);
+      double value = jacobian * quadratureWeight * partialDerivativeValue * phii;
+      this->RHSVector->AddElement(iId,value);
+      for (j=0; j<numberOfCellPoints; j++)
         {
-        vtkIdType iId = cell->GetPointId(i);
-        phii = feShapeFunctions->GetPhi(q,i);
-        double value = jacobian * quadratureWeight * partialDerivativeValue * phii;
-        this->RHSVector->AddElement(iId,value);
-        for (j=0; j<numberOfCellPoints; j++)
-          {
-          vtkIdType jId = cell->GetPointId(j);
-          phij = feShapeFunctions->GetPhi(q,j);
-          double value = jacobian * quadratureWeight * phii * phij;
-          this->Matrix->AddElement(iId,jId,value);
-          }
+        vtkIdType jId = element->GetPointId(j);
+        phij = element->GetPhi(q,j);
+        double value = jacobian * quadratureWeight * phii * phij;
+        this->Matrix->AddElement(iId,jId,value);
         }
       }
     }
-
-  gaussQuadrature->Delete();
-  feShapeFunctions->Delete();
 }
-
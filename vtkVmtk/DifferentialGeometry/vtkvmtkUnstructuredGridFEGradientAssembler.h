@@ -35,6 +35,8 @@
 #include "vtkvmtkFEAssembler.h"
 #include "vtkvmtkWin32Header.h"
 
+class vtkDataArray;
+
 class VTK_VMTK_DIFFERENTIAL_GEOMETRY_EXPORT vtkvmtkUnstructuredGridFEGradientAssembler : public vtkvmtkFEAssembler
 {
 public:
@@ -106,11 +108,16 @@ protected:
   vtkvmtkUnstructuredGridFEGradientAssembler();
   ~vtkvmtkUnstructuredGridFEGradientAssembler();
 
+  void AssembleElement(vtkvmtkFEElement* element) override;
+  void AssembleGradientElement(vtkvmtkFEElement* element);
+  void AssemblePartialDerivativeElement(vtkvmtkFEElement* element);
+
   void BuildGradient();
   void BuildPartialDerivative();
 
   char* ScalarsArrayName;
   int ScalarsComponent;
+  vtkDataArray* ScalarsArray;
   int AssemblyMode;
   int Direction;
 
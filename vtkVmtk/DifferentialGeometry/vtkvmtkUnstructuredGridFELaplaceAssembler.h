@@ -48,6 +48,8 @@ protected:
   vtkvmtkUnstructuredGridFELaplaceAssembler();
   ~vtkvmtkUnstructuredGridFELaplaceAssembler();
 
+  void AssembleElement(vtkvmtkFEElement* element) override;
+
 private:
   vtkvmtkUnstructuredGridFELaplaceAssembler(const vtkvmtkUnstructuredGridFELaplaceAssembler&);  // Not implemented.
   void operator=(const vtkvmtkUnstructuredGridFELaplaceAssembler&);  // Not implemented.
@@ -32,6 +32,8 @@
 #include "vtkvmtkFEAssembler.h"
 #include "vtkvmtkWin32Header.h"
 
+class vtkDataArray;
+
 class VTK_VMTK_DIFFERENTIAL_GEOMETRY_EXPORT vtkvmtkUnstructuredGridFEVorticityAssembler : public vtkvmtkFEAssembler
 {
 public:
@@ -64,8 +66,11 @@ protected:
   vtkvmtkUnstructuredGridFEVorticityAssembler();
   ~vtkvmtkUnstructuredGridFEVorticityAssembler();
 
+  void AssembleElement(vtkvmtkFEElement* element) override;
+
   char* VelocityArrayName;
   int Direction;
+  vtkDataArray* VelocityArray;
 
 private:
   vtkvmtkUnstructuredGridFEVorticityAssembler(const vtkvmtkUnstructuredGridFEVorticityAssembler&);  // Not implemented.
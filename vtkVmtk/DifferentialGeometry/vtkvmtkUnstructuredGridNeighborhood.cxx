@@ -24,6 +24,7 @@ Version:   $Revision: 1.3 $
 #include "vtkObjectFactory.h"
 #include "vtkIdList.h"
 #include "vtkCell.h"
+#include "vtkGenericCell.h"
 
 
 vtkStandardNewMacro(vtkvmtkUnstructuredGridNeighborhood);
@@ -33,6 +34,7 @@ void vtkvmtkUnstructuredGridNeighborhood::Build()
   vtkIdType i, j;
   vtkIdType numCellsInStencil;
   vtkIdList *cellIds, *ptIds, *stencilIds;
+  vtkGenericCell* cell;
   vtkUnstructuredGrid* ugdata = vtkUnstructuredGrid::SafeDownCast(this->DataSet);
 
   if (ugdata==NULL)
@@ -47,6 +49,7 @@ void vtkvmtkUnstructuredGridNeighborhood::Build()
   cellIds = vtkIdList::New();
   ptIds = vtkIdList::New();
   stencilIds = vtkIdList::New();
+  cell = vtkGenericCell::New();
 
   ugdata->GetPointCells (pointId, cellIds);
   numCellsInStencil = cellIds->GetNumberOfIds();
@@ -56,13 +59,15 @@ void vtkvmtkUnstructuredGridNeighborhood::Build()
     cellIds->Delete();
     ptIds->Delete();
     stencilIds->Delete();
+    cell->Delete();
     return;
     }
 
   vtkIdType cellPointId;
   for (i=0; i<numCellsInStencil; i++)
     {
-    if (ugdata->GetCell(cellIds->GetId(i))->GetCellDimension() != 3)
+    ugdata->GetCell(cellIds->GetId(i),cell);
+    if (cell->GetCellDimension() != 3)
       {
       continue;
       } 
@@ -89,5 +94,6 @@ void vtkvmtkUnstructuredGridNeighborhood::Build()
   cellIds->Delete();
   ptIds->Delete();
   stencilIds->Delete();
+  cell->Delete();
 }
 
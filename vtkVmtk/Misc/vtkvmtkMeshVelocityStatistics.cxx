@@ -20,22 +20,141 @@ Version:   $Revision: 1.1 $
 =========================================================================*/
 
 #include "vtkvmtkMeshVelocityStatistics.h"
+#include "vtkvmtkVelocityTimeSeries.h"
 
 #include "vtkUnstructuredGrid.h"
 #include "vtkPointData.h"
 #include "vtkCellData.h"
 #include "vtkDoubleArray.h"
+#include "vtkFloatArray.h"
 #include "vtkMath.h"
+#include "vtkSMPTools.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
 
+#include <vector>
+
+// Running statistics of every point: the mean and the sum of squared
+// deviations from it (Welford), and optionally the sum, minimum and maximum
+// of the velocity magnitude. The filter keeps one for the time steps added
+// with AddTimeStep across executions, and each execution reading
+// VelocityTimeSeries or VelocityArrayIds uses one of its own.
+class vtkvmtkMeshVelocityStatisticsInternals
+{
+public:
+  vtkvmtkMeshVelocityStatisticsInternals()
+  {
+    this->NumberOfPoints = 0;
+    this->NumberOfTimeSteps = 0;
+  }
+
+  void Initialize(vtkIdType numberOfPoints, int computeOscillatoryIndex, int computeMagnitudeRange);
+  void AccumulateTimeStep(const float* floatData, const double* doubleData, vtkDataArray* velocity);
+  void AddStatisticsArrays(vtkUnstructuredGrid* output);
+
+  vtkIdType NumberOfPoints;
+  int NumberOfTimeSteps;
+  std::vector<double> Mean;
+  std::vector<double> SquaredDeviationSum;
+  std::vector<double> MagnitudeSum;
+  std::vector<double> MinimumMagnitude;
+  std::vector<double> MaximumMagnitude;
+};
+
+// Adds one time step to the statistics of a range of points. The velocity is
+// read from FloatData or DoubleData (3 values per point) if set, or else from
+// Velocity with GetTuple, which only reads the array.
+class vtkvmtkMeshVelocityStatisticsFunctor
+{
+public:
+  const float* FloatData;
+  const double* DoubleData;
+  vtkDataArray* Velocity;
+
+  // number of time steps including this one
+  int NumberOfTimeSteps;
+
+  double* Mean;
+  double* SquaredDeviationSum;
+  double* MagnitudeSum;
+  double* MinimumMagnitude;
+  double* MaximumMagnitude;
+
+  void Initialize()
+    {
+    }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    double velocity[3];
+    double weight = 1.0 / double(this->NumberOfTimeSteps);
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      if (this->FloatData)
+        {
+        velocity[0] = this->FloatData[3*i];
+        velocity[1] = this->FloatData[3*i+1];
+        velocity[2] = this->FloatData[3*i+2];
+        }
+      else if (this->DoubleData)
+        {
+        velocity[0] = this->DoubleData[3*i];
+        velocity[1] = this->DoubleData[3*i+1];
+        velocity[2] = this->DoubleData[3*i+2];
+        }
+      else
+        {
+        this->Velocity->GetTuple(i,velocity);
+        }
+
+      double* mean = this->Mean + 3*i;
+      double* squaredDeviationSum = this->SquaredDeviationSum + 3*i;
+      for (int j=0; j<3; j++)
+        {
+        double deviation = velocity[j] - mean[j];
+        mean[j] += weight * deviation;
+        squaredDeviationSum[j] += deviation * (velocity[j] - mean[j]);
+        }
+
+      if (this->MagnitudeSum || this->MinimumMagnitude)
+        {
+        double magnitude = vtkMath::Norm(velocity);
+        if (this->MagnitudeSum)
+          {
+          this->MagnitudeSum[i] += magnitude;
+          }
+        if (this->MinimumMagnitude)
+          {
+          if (this->NumberOfTimeSteps == 1 || magnitude < this->MinimumMagnitude[i])
+            {
+            this->MinimumMagnitude[i] = magnitude;
+            }
+          if (this->NumberOfTimeSteps == 1 || magnitude > this->MaximumMagnitude[i])
+            {
+            this->MaximumMagnitude[i] = magnitude;
+            }
+          }
+        }
+      }
+    }
+
+  void Reduce()
+    {
+    }
+};
 
 vtkStandardNewMacro(vtkvmtkMeshVelocityStatistics);
+vtkCxxSetObjectMacro(vtkvmtkMeshVelocityStatistics,VelocityTimeSeries,vtkvmtkVelocityTimeSeries);
 
 vtkvmtkMeshVelocityStatistics::vtkvmtkMeshVelocityStatistics()
 {
   this->VelocityArrayIds = NULL;
+  this->VelocityTimeSeries = NULL;
+  this->ComputeOscillatoryIndex = 0;
+  this->ComputeMagnitudeRange = 0;
+  this->NumberOfTimeSteps = 0;
+  this->Internals = new vtkvmtkMeshVelocityStatisticsInternals;
 }
 
 vtkvmtkMeshVelocityStatistics::~vtkvmtkMeshVelocityStatistics()
@@ -45,6 +164,163 @@ vtkvmtkMeshVelocityStatistics::~vtkvmtkMeshVelocityStatistics()
     this->VelocityArrayIds->Delete();
     this->VelocityArrayIds = NULL;
     }
+  this->SetVelocityTimeSeries(NULL);
+  delete this->Internals;
+  this->Internals = NULL;
+}
+
+void vtkvmtkMeshVelocityStatisticsInternals::Initialize(vtkIdType numberOfPoints, int computeOscillatoryIndex, int computeMagnitudeRange)
+{
+  this->NumberOfPoints = numberOfPoints;
+  this->NumberOfTimeSteps = 0;
+  this->Mean.assign(3*numberOfPoints,0.0);
+  this->SquaredDeviationSum.assign(3*numberOfPoints,0.0);
+  this->MagnitudeSum.assign(computeOscillatoryIndex ? numberOfPoints : 0,0.0);
+  this->MinimumMagnitude.assign(computeMagnitudeRange ? numberOfPoints : 0,0.0);
+  this->MaximumMagnitude.assign(computeMagnitudeRange ? numberOfPoints : 0,0.0);
+}
+
+void vtkvmtkMeshVelocityStatisticsInternals::AccumulateTimeStep(const float* floatData, const double* doubleData, vtkDataArray* velocity)
+{
+  this->NumberOfTimeSteps++;
+
+  vtkvmtkMeshVelocityStatisticsFunctor functor;
+  functor.FloatData = floatData;
+  functor.DoubleData = doubleData;
+  functor.Velocity = velocity;
+  functor.NumberOfTimeSteps = this->NumberOfTimeSteps;
+  functor.Mean = this->Mean.empty() ? NULL : &this->Mean[0];
+  functor.SquaredDeviationSum = this->SquaredDeviationSum.empty() ? NULL : &this->SquaredDeviationSum[0];
+  functor.MagnitudeSum = this->MagnitudeSum.empty() ? NULL : &this->MagnitudeSum[0];
+  functor.MinimumMagnitude = this->MinimumMagnitude.empty() ? NULL : &this->MinimumMagnitude[0];
+  functor.MaximumMagnitude = this->MaximumMagnitude.empty() ? NULL : &this->MaximumMagnitude[0];
+
+  vtkSMPTools::For(0,this->NumberOfPoints,functor);
+}
+
+void vtkvmtkMeshVelocityStatistics::InitializeTimeSteps()
+{
+  this->Internals->Initialize(0,0,0);
+  this->NumberOfTimeSteps = 0;
+  this->Modified();
+}
+
+static void vtkvmtkGetVelocityPointers(vtkDataArray* velocity, const float*& floatData, const double*& doubleData)
+{
+  floatData = NULL;
+  doubleData = NULL;
+  if (velocity->GetNumberOfTuples() == 0)
+    {
+    return;
+    }
+  if (vtkFloatArray::SafeDownCast(velocity))
+    {
+    floatData = vtkFloatArray::SafeDownCast(velocity)->GetPointer(0);
+    }
+  else if (vtkDoubleArray::SafeDownCast(velocity))
+    {
+    doubleData = vtkDoubleArray::SafeDownCast(velocity)->GetPointer(0);
+    }
+}
+
+int vtkvmtkMeshVelocityStatistics::AddTimeStep(vtkDataArray* velocity)
+{
+  if (!velocity || velocity->GetNumberOfComponents() != 3)
+    {
+    vtkErrorMacro("Velocity array must have 3 components.");
+    return 0;
+    }
+
+  if (this->Internals->NumberOfTimeSteps == 0)
+    {
+    this->Internals->Initialize(velocity->GetNumberOfTuples(),this->ComputeOscillatoryIndex,this->ComputeMagnitudeRange);
+    }
+  else if (velocity->GetNumberOfTuples() != this->Internals->NumberOfPoints)
+    {
+    vtkErrorMacro("Velocity array has "<<velocity->GetNumberOfTuples()<<" tuples, previous time steps have "<<this->Internals->NumberOfPoints);
+    return 0;
+    }
+
+  const float* floatData;
+  const double* doubleData;
+  vtkvmtkGetVelocityPointers(velocity,floatData,doubleData);
+  this->Internals->AccumulateTimeStep(floatData,doubleData,velocity);
+  this->NumberOfTimeSteps = this->Internals->NumberOfTimeSteps;
+
+  this->Modified();
+
+  return 1;
+}
+
+void vtkvmtkMeshVelocityStatisticsInternals::AddStatisticsArrays(vtkUnstructuredGrid* output)
+{
+  vtkIdType numberOfPoints = this->NumberOfPoints;
+  double weight = 1.0 / double(this->NumberOfTimeSteps);
+
+  vtkDoubleArray* avgVelocityArray = vtkDoubleArray::New();
+  avgVelocityArray->SetName("AVGVelocity");
+  avgVelocityArray->SetNumberOfComponents(3);
+  avgVelocityArray->SetNumberOfTuples(numberOfPoints);
+
+  vtkDoubleArray* rmsVelocityArray = vtkDoubleArray::New();
+  rmsVelocityArray->SetName("RMSVelocity");
+  rmsVelocityArray->SetNumberOfComponents(3);
+  rmsVelocityArray->SetNumberOfTuples(numberOfPoints);
+
+  vtkIdType i;
+  for (i=0; i<3*numberOfPoints; i++)
+    {
+    avgVelocityArray->SetValue(i,this->Mean[i]);
+    rmsVelocityArray->SetValue(i,sqrt(weight * this->SquaredDeviationSum[i]));
+    }
+
+  output->GetPointData()->AddArray(avgVelocityArray);
+  output->GetPointData()->AddArray(rmsVelocityArray);
+
+  avgVelocityArray->Delete();
+  rmsVelocityArray->Delete();
+
+  if (!this->MagnitudeSum.empty())
+    {
+    vtkDoubleArray* osiVelocityArray = vtkDoubleArray::New();
+    osiVelocityArray->SetName("OSIVelocity");
+    osiVelocityArray->SetNumberOfTuples(numberOfPoints);
+    for (i=0; i<numberOfPoints; i++)
+      {
+      double meanMagnitude = weight * this->MagnitudeSum[i];
+      double osi = 0.0;
+      if (meanMagnitude > 0.0)
+        {
+        osi = 0.5 * (1.0 - vtkMath::Norm(&this->Mean[3*i]) / meanMagnitude);
+        }
+      osiVelocityArray->SetValue(i,osi);
+      }
+    output->GetPointData()->AddArray(osiVelocityArray);
+    osiVelocityArray->Delete();
+    }
+
+  if (!this->MinimumMagnitude.empty())
+    {
+    vtkDoubleArray* minVelocityMagnitudeArray = vtkDoubleArray::New();
+    minVelocityMagnitudeArray->SetName("MINVelocityMagnitude");
+    minVelocityMagnitudeArray->SetNumberOfTuples(numberOfPoints);
+
+    vtkDoubleArray* maxVelocityMagnitudeArray = vtkDoubleArray::New();
+    maxVelocityMagnitudeArray->SetName("MAXVelocityMagnitude");
+    maxVelocityMagnitudeArray->SetNumberOfTuples(numberOfPoints);
+
+    for (i=0; i<numberOfPoints; i++)
+      {
+      minVelocityMagnitudeArray->SetValue(i,this->MinimumMagnitude[i]);
+      maxVelocityMagnitudeArray->SetValue(i,this->MaximumMagnitude[i]);
+      }
+
+    output->GetPointData()->AddArray(minVelocityMagnitudeArray);
+    output->GetPointData()->AddArray(maxVelocityMagnitudeArray);
+
+    minVelocityMagnitudeArray->Delete();
+    maxVelocityMagnitudeArray->Delete();
+    }
 }
 
 int vtkvmtkMeshVelocityStatistics::RequestData(
@@ -63,104 +339,108 @@ int vtkvmtkMeshVelocityStatistics::RequestData(
   output->CopyStructure(input);
   output->GetPointData()->PassData(input->GetPointData());
   output->GetCellData()->PassData(input->GetCellData());
- 
+
   vtkPointData* inputPointData = input->GetPointData();
-  
-  if (this->VelocityArrayIds == NULL)
-    {
-    vtkErrorMacro("No VelocityArrayIds specified");
-    return 1;
-    }
-  
-  int numberOfArrayIds = this->VelocityArrayIds->GetNumberOfIds();
-  
-  if (numberOfArrayIds < 2)
+
+  vtkIdType numberOfPoints = input->GetNumberOfPoints();
+
+  // time steps read here are accumulated apart from the added ones, which
+  // are left as they are for later executions and AddTimeStep calls
+  vtkvmtkMeshVelocityStatisticsInternals executionStatistics;
+  vtkvmtkMeshVelocityStatisticsInternals* statistics = &executionStatistics;
+
+  if (this->VelocityTimeSeries)
     {
-    vtkWarningMacro("Only 1 VelocityArrayIds specified. No point in computing statistics.");
-    return 1;
+    vtkvmtkVelocityTimeSeries* series = this->VelocityTimeSeries;
+    if (series->GetNumberOfPoints() != numberOfPoints)
+      {
+      vtkErrorMacro("VelocityTimeSeries has "<<series->GetNumberOfPoints()<<" points, input has "<<numberOfPoints);
+      return 1;
+      }
+
+    // a single pass, one time step in memory at a time
+    statistics->Initialize(numberOfPoints,this->ComputeOscillatoryIndex,this->ComputeMagnitudeRange);
+    int numberOfTimeSteps = series->GetNumberOfTimeSteps();
+    for (int step=0; step<numberOfTimeSteps; step++)
+      {
+      const float* velocity = series->GetTimeStep(step);
+      if (!velocity)
+        {
+        return 1;
+        }
+      statistics->AccumulateTimeStep(velocity,NULL,NULL);
+      }
     }
- 
-  int i;
-  for (i=0; i<numberOfArrayIds; i++)
+  else if (this->VelocityArrayIds)
     {
-    if (inputPointData->GetArray(this->VelocityArrayIds->GetId(i)) == NULL)
+    int numberOfArrayIds = this->VelocityArrayIds->GetNumberOfIds();
+
+    if (numberOfArrayIds < 2)
       {
-      vtkErrorMacro("Id in VelocityArrayIds is not a PointData array.");
+      vtkWarningMacro("Only 1 VelocityArrayIds specified. No point in computing statistics.");
       return 1;
       }
-    }
- 
-  int numberOfPoints = input->GetNumberOfPoints();
-  
-  vtkDoubleArray* avgVelocityArray = vtkDoubleArray::New();
-  avgVelocityArray->SetName("AVGVelocity");
-  avgVelocityArray->SetNumberOfComponents(3);
-  avgVelocityArray->SetNumberOfTuples(numberOfPoints);
-  avgVelocityArray->FillComponent(0,0.0);
-  avgVelocityArray->FillComponent(1,0.0);
-  avgVelocityArray->FillComponent(2,0.0);
 
-  vtkDoubleArray* rmsVelocityArray = vtkDoubleArray::New();
-  rmsVelocityArray->SetName("RMSVelocity");
-  rmsVelocityArray->SetNumberOfComponents(3);
-  rmsVelocityArray->SetNumberOfTuples(numberOfPoints);
-  rmsVelocityArray->FillComponent(0,0.0);
-  rmsVelocityArray->FillComponent(1,0.0);
-  rmsVelocityArray->FillComponent(2,0.0);
-
-  double avgVelocity[3], rmsVelocity[3], velocity[3];
-  
-  double weight = 1.0 / double(numberOfArrayIds);
-  
-  int j;
-  for (i=0; i<numberOfPoints; i++)
-    {
-    for (j=0; j<numberOfArrayIds; j++)
+    int i;
+    for (i=0; i<numberOfArrayIds; i++)
       {
-      vtkDataArray* velocityArray = inputPointData->GetArray(this->VelocityArrayIds->GetId(j));
-      avgVelocityArray->GetTuple(i,avgVelocity);
-      velocityArray->GetTuple(i,velocity);
-      avgVelocity[0] += weight * velocity[0];
-      avgVelocity[1] += weight * velocity[1];
-      avgVelocity[2] += weight * velocity[2];
-      avgVelocityArray->SetTuple(i,avgVelocity);
+      vtkDataArray* velocityArray = inputPointData->GetArray(this->VelocityArrayIds->GetId(i));
+      if (velocityArray == NULL)
+        {
+        vtkErrorMacro("Id in VelocityArrayIds is not a PointData array.");
+        return 1;
+        }
+      if (velocityArray->GetNumberOfComponents() != 3)
+        {
+        vtkErrorMacro("Velocity array "<<velocityArray->GetName()<<" does not have 3 components.");
+        return 1;
+        }
       }
-    }
 
-  for (i=0; i<numberOfPoints; i++)
-    {
-    for (j=0; j<numberOfArrayIds; j++)
+    statistics->Initialize(numberOfPoints,this->ComputeOscillatoryIndex,this->ComputeMagnitudeRange);
+    for (i=0; i<numberOfArrayIds; i++)
       {
-      vtkDataArray* velocityArray = inputPointData->GetArray(this->VelocityArrayIds->GetId(j));
-      rmsVelocityArray->GetTuple(i,rmsVelocity);
-      avgVelocityArray->GetTuple(i,avgVelocity);
-      velocityArray->GetTuple(i,velocity);
-      rmsVelocity[0] += weight * (velocity[0] - avgVelocity[0]) * (velocity[0] - avgVelocity[0]);
-      rmsVelocity[1] += weight * (velocity[1] - avgVelocity[1]) * (velocity[1] - avgVelocity[1]);
-      rmsVelocity[2] += weight * (velocity[2] - avgVelocity[2]) * (velocity[2] - avgVelocity[2]);
-      rmsVelocityArray->SetTuple(i,rmsVelocity);
+      vtkDataArray* velocityArray = inputPointData->GetArray(this->VelocityArrayIds->GetId(i));
+      const float* floatData;
+      const double* doubleData;
+      vtkvmtkGetVelocityPointers(velocityArray,floatData,doubleData);
+      statistics->AccumulateTimeStep(floatData,doubleData,velocityArray);
       }
     }
+  else if (this->Internals->NumberOfTimeSteps == 0)
+    {
+    vtkErrorMacro("No VelocityArrayIds specified");
+    return 1;
+    }
+  else if (this->Internals->NumberOfPoints != numberOfPoints)
+    {
+    vtkErrorMacro("Added time steps have "<<this->Internals->NumberOfPoints<<" points, input has "<<numberOfPoints);
+    return 1;
+    }
+  else
+    {
+    statistics = this->Internals;
+    }
 
-  for (i=0; i<numberOfPoints; i++)
+  this->NumberOfTimeSteps = statistics->NumberOfTimeSteps;
+
+  if (this->NumberOfTimeSteps < 2)
     {
-    rmsVelocityArray->GetTuple(i,rmsVelocity);
-    rmsVelocity[0] = sqrt(rmsVelocity[0]);
-    rmsVelocity[1] = sqrt(rmsVelocity[1]);
-    rmsVelocity[2] = sqrt(rmsVelocity[2]);
-    rmsVelocityArray->SetTuple(i,rmsVelocity);
+    vtkWarningMacro("Less than 2 time steps. No point in computing statistics.");
+    return 1;
     }
 
-  output->GetPointData()->AddArray(avgVelocityArray);
-  output->GetPointData()->AddArray(rmsVelocityArray);
-  
-  avgVelocityArray->Delete();
-  rmsVelocityArray->Delete();
-  
+  statistics->AddStatisticsArrays(output);
+
   return 1;
 }
 
 void vtkvmtkMeshVelocityStatistics::PrintSelf(std::ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "VelocityTimeSeries: " << this->VelocityTimeSeries << endl;
+  os << indent << "ComputeOscillatoryIndex: " << this->ComputeOscillatoryIndex << endl;
+  os << indent << "ComputeMagnitudeRange: " << this->ComputeMagnitudeRange << endl;
+  os << indent << "NumberOfTimeSteps: " << this->NumberOfTimeSteps << endl;
 }
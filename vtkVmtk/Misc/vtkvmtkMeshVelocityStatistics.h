@@ -23,6 +23,17 @@ Program:   VMTK
  * the input mesh, computes the time-average and RMS (root-mean-square) velocity vectors at each
  * point. Typically used to summarize unsteady/pulsatile CFD simulation results into cycle-averaged
  * and turbulence-like statistics.
+ *
+ * The time steps can instead be read from a vtkvmtkVelocityTimeSeries file matching the input mesh
+ * (see VelocityTimeSeries), or pushed one at a time with AddTimeStep (e.g. from a loop reading
+ * one simulation output file at a time), so that they never need to be held in memory together.
+ *
+ * Time steps are consumed in a single pass: the mean and variance of every point are updated with
+ * Welford's algorithm as each time step arrives, in parallel over the points. In the same pass,
+ * the filter can also compute an oscillatory index of the velocity, 0.5 * (1 - |mean(v)| /
+ * mean(|v|)), which is 0 for a velocity of constant direction and approaches 0.5 when the
+ * velocity reverses (see ComputeOscillatoryIndex), and the minimum and maximum velocity magnitude
+ * (see ComputeMagnitudeRange).
  */
 
 #ifndef __vtkvmtkMeshVelocityStatistics_h
@@ -34,6 +45,10 @@ Program:   VMTK
 
 #include "vtkIdList.h"
 
+class vtkDataArray;
+class vtkvmtkVelocityTimeSeries;
+class vtkvmtkMeshVelocityStatisticsInternals;
+
 class VTK_VMTK_MISC_EXPORT vtkvmtkMeshVelocityStatistics : public vtkUnstructuredGridAlgorithm
 {
   public: 
@@ -51,7 +66,57 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkMeshVelocityStatistics : public vtkUnstructure
   vtkSetObjectMacro(VelocityArrayIds,vtkIdList);
   vtkGetObjectMacro(VelocityArrayIds,vtkIdList);
   ///@}
-  
+
+  ///@{
+  /**
+   * Set/Get an opened vtkvmtkVelocityTimeSeries with one velocity per input point to compute the
+   * statistics of, in place of the arrays listed in VelocityArrayIds. Default: NULL.
+   */
+  virtual void SetVelocityTimeSeries(vtkvmtkVelocityTimeSeries*);
+  vtkGetObjectMacro(VelocityTimeSeries,vtkvmtkVelocityTimeSeries);
+  ///@}
+
+  ///@{
+  /**
+   * Toggle the computation of the oscillatory index of the velocity (OSIVelocity point data
+   * array). Set it before the first AddTimeStep. Default: off.
+   */
+  vtkSetMacro(ComputeOscillatoryIndex,int);
+  vtkGetMacro(ComputeOscillatoryIndex,int);
+  vtkBooleanMacro(ComputeOscillatoryIndex,int);
+  ///@}
+
+  ///@{
+  /**
+   * Toggle the computation of the minimum and maximum velocity magnitude over time
+   * (MINVelocityMagnitude and MAXVelocityMagnitude point data arrays). Set it before the first
+   * AddTimeStep. Default: off.
+   */
+  vtkSetMacro(ComputeMagnitudeRange,int);
+  vtkGetMacro(ComputeMagnitudeRange,int);
+  vtkBooleanMacro(ComputeMagnitudeRange,int);
+  ///@}
+
+  /**
+   * Discard the time steps added with AddTimeStep. Executions reading VelocityTimeSeries or
+   * VelocityArrayIds neither use nor discard the added time steps.
+   */
+  void InitializeTimeSteps();
+
+  /**
+   * Add the velocity of one time step, as a 3-component array with one tuple per input point, to
+   * the statistics. When time steps have been added and neither VelocityTimeSeries nor
+   * VelocityArrayIds is set, the output holds the statistics of the added time steps. The array
+   * is not kept and may be released or reused once this returns. Returns 1 on success.
+   */
+  int AddTimeStep(vtkDataArray* velocity);
+
+  /**
+   * Number of time steps added since InitializeTimeSteps, or that the last execution computed the
+   * statistics of.
+   */
+  vtkGetMacro(NumberOfTimeSteps,int);
+
   protected:
   vtkvmtkMeshVelocityStatistics();
   ~vtkvmtkMeshVelocityStatistics();  
@@ -59,6 +124,15 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkMeshVelocityStatistics : public vtkUnstructure
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
 
   vtkIdList* VelocityArrayIds;
+  vtkvmtkVelocityTimeSeries* VelocityTimeSeries;
+
+  int ComputeOscillatoryIndex;
+  int ComputeMagnitudeRange;
+
+  int NumberOfTimeSteps;
+
+  // statistics of the time steps added with AddTimeStep
+  vtkvmtkMeshVelocityStatisticsInternals* Internals;
 
   private:
   vtkvmtkMeshVelocityStatistics(const vtkvmtkMeshVelocityStatistics&);  // Not implemented.
@@ -20,11 +20,340 @@ Version:   $Revision: 1.2 $
 =========================================================================*/
 #include "vtkvmtkRBFInterpolation.h"
 #include "vtkvmtkConstants.h"
+#include "vtkvmtkSparseMatrix.h"
+#include "vtkvmtkDoubleVector.h"
+#include "vtkvmtkLinearSystem.h"
+#include "vtkvmtkKrylovLinearSystemSolver.h"
 #include "vtkPointData.h"
 #include "vtkMath.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
 #include "vtkVersion.h"
 
+#include <algorithm>
+#include <vector>
+
+// Cluster of source points used by the treecode. Charge and Dipole are the sum of the
+// coefficients and of the coefficients times the offsets of the points from Center.
+class vtkvmtkRBFInterpolationTreeNode
+{
+public:
+  double Center[3];
+  double Radius;
+  double Charge;
+  double Dipole[3];
+  vtkIdType FirstChild;
+  vtkIdType NumberOfChildren;
+  vtkIdType FirstPoint;
+  vtkIdType NumberOfPoints;
+};
+
+class vtkvmtkRBFInterpolationInternals
+{
+public:
+  vtkvmtkRBFInterpolationInternals()
+    {
+    this->SupportRadius = 0.0;
+    this->BucketSize = 1.0;
+    this->GridOrigin[0] = this->GridOrigin[1] = this->GridOrigin[2] = 0.0;
+    this->GridDimensions[0] = this->GridDimensions[1] = this->GridDimensions[2] = 0;
+    }
+
+  void Initialize()
+    {
+    this->Centers.clear();
+    this->BucketOffsets.clear();
+    this->BucketPointIds.clear();
+    this->Nodes.clear();
+    this->TreePointIds.clear();
+    }
+
+  // Uniform grid of buckets of the size of the support radius, so that the source points within
+  // the support of a point lie in the 27 buckets around it.
+  void BuildBuckets(double bucketSize)
+    {
+    vtkIdType numberOfPoints = this->Centers.size() / 3;
+    this->BucketSize = bucketSize;
+    double bounds[6] = {VTK_VMTK_LARGE_DOUBLE, -VTK_VMTK_LARGE_DOUBLE, VTK_VMTK_LARGE_DOUBLE, -VTK_VMTK_LARGE_DOUBLE, VTK_VMTK_LARGE_DOUBLE, -VTK_VMTK_LARGE_DOUBLE};
+    for (vtkIdType i=0; i<numberOfPoints; i++)
+      {
+      for (int k=0; k<3; k++)
+        {
+        bounds[2*k] = this->Centers[3*i+k] < bounds[2*k] ? this->Centers[3*i+k] : bounds[2*k];
+        bounds[2*k+1] = this->Centers[3*i+k] > bounds[2*k+1] ? this->Centers[3*i+k] : bounds[2*k+1];
+        }
+      }
+    // buckets larger than the support radius are still correct, so a small radius on a large
+    // source is not allowed to create many more buckets than points
+    double maximumNumberOfBuckets = 8.0 * numberOfPoints + 1.0;
+    while (((bounds[1] - bounds[0]) / bucketSize + 1.0) * ((bounds[3] - bounds[2]) / bucketSize + 1.0) * ((bounds[5] - bounds[4]) / bucketSize + 1.0) > maximumNumberOfBuckets)
+      {
+      bucketSize *= 2.0;
+      }
+    this->BucketSize = bucketSize;
+    vtkIdType numberOfBuckets = 1;
+    for (int k=0; k<3; k++)
+      {
+      this->GridOrigin[k] = bounds[2*k];
+      this->GridDimensions[k] = static_cast<int>((bounds[2*k+1] - bounds[2*k]) / bucketSize) + 1;
+      numberOfBuckets *= this->GridDimensions[k];
+      }
+    this->BucketOffsets.assign(numberOfBuckets+1,0);
+    std::vector<vtkIdType> pointBuckets(numberOfPoints);
+    for (vtkIdType i=0; i<numberOfPoints; i++)
+      {
+      int ijk[3];
+      this->GetBucket(&this->Centers[3*i],ijk);
+      pointBuckets[i] = ijk[0] + this->GridDimensions[0] * (ijk[1] + this->GridDimensions[1] * ijk[2]);
+      this->BucketOffsets[pointBuckets[i]+1]++;
+      }
+    for (vtkIdType b=0; b<numberOfBuckets; b++)
+      {
+      this->BucketOffsets[b+1] += this->BucketOffsets[b];
+      }
+    this->BucketPointIds.resize(numberOfPoints);
+    std::vector<vtkIdType> positions(this->BucketOffsets.begin(),this->BucketOffsets.end()-1);
+    for (vtkIdType i=0; i<numberOfPoints; i++)
+      {
+      this->BucketPointIds[positions[pointBuckets[i]]++] = i;
+      }
+    }
+
+  void GetBucket(const double x[3], int ijk[3]) const
+    {
+    for (int k=0; k<3; k++)
+      {
+      double t = (x[k] - this->GridOrigin[k]) / this->BucketSize;
+      ijk[k] = t < 0.0 ? -1 : (t >= this->GridDimensions[k] ? this->GridDimensions[k] : static_cast<int>(t));
+      }
+    }
+
+  // Splits the points in TreePointIds[begin,end) into octants, down to leaves of at most
+  // MaximumLeafSize points, and accumulates the expansion of every node from its children.
+  void BuildNode(vtkIdType nodeId, vtkIdType begin, vtkIdType end, const double* coefficients, int depth)
+    {
+    const vtkIdType maximumLeafSize = 16;
+    double bounds[6] = {VTK_VMTK_LARGE_DOUBLE, -VTK_VMTK_LARGE_DOUBLE, VTK_VMTK_LARGE_DOUBLE, -VTK_VMTK_LARGE_DOUBLE, VTK_VMTK_LARGE_DOUBLE, -VTK_VMTK_LARGE_DOUBLE};
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      const double* x = &this->Centers[3*this->TreePointIds[i]];
+      for (int k=0; k<3; k++)
+        {
+        bounds[2*k] = x[k] < bounds[2*k] ? x[k] : bounds[2*k];
+        bounds[2*k+1] = x[k] > bounds[2*k+1] ? x[k] : bounds[2*k+1];
+        }
+      }
+    double center[3];
+    for (int k=0; k<3; k++)
+      {
+      center[k] = 0.5 * (bounds[2*k] + bounds[2*k+1]);
+      }
+    double radius2 = 0.0;
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      double distance2 = vtkMath::Distance2BetweenPoints(center,&this->Centers[3*this->TreePointIds[i]]);
+      radius2 = distance2 > radius2 ? distance2 : radius2;
+      }
+
+    vtkvmtkRBFInterpolationTreeNode node;
+    node.Center[0] = center[0];
+    node.Center[1] = center[1];
+    node.Center[2] = center[2];
+    node.Radius = sqrt(radius2);
+    node.Charge = 0.0;
+    node.Dipole[0] = node.Dipole[1] = node.Dipole[2] = 0.0;
+    node.FirstChild = -1;
+    node.NumberOfChildren = 0;
+    node.FirstPoint = begin;
+    node.NumberOfPoints = end - begin;
+
+    if (end - begin <= maximumLeafSize || depth >= 32 || radius2 == 0.0)
+      {
+      for (vtkIdType i=begin; i<end; i++)
+        {
+        vtkIdType pointId = this->TreePointIds[i];
+        const double* x = &this->Centers[3*pointId];
+        node.Charge += coefficients[pointId];
+        for (int k=0; k<3; k++)
+          {
+          node.Dipole[k] += coefficients[pointId] * (x[k] - center[k]);
+          }
+        }
+      this->Nodes[nodeId] = node;
+      return;
+      }
+
+    // counting sort of the points by octant
+    std::vector<vtkIdType> octantPointIds(end-begin);
+    vtkIdType octantOffsets[9] = {0,0,0,0,0,0,0,0,0};
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      octantOffsets[this->GetOctant(center,this->TreePointIds[i])+1]++;
+      }
+    for (int o=0; o<8; o++)
+      {
+      octantOffsets[o+1] += octantOffsets[o];
+      }
+    vtkIdType positions[8];
+    for (int o=0; o<8; o++)
+      {
+      positions[o] = octantOffsets[o];
+      }
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      octantPointIds[positions[this->GetOctant(center,this->TreePointIds[i])]++] = this->TreePointIds[i];
+      }
+    std::copy(octantPointIds.begin(),octantPointIds.end(),this->TreePointIds.begin()+begin);
+
+    node.FirstChild = this->Nodes.size();
+    for (int o=0; o<8; o++)
+      {
+      if (octantOffsets[o+1] > octantOffsets[o])
+        {
+        node.NumberOfChildren++;
+        }
+      }
+    this->Nodes.resize(this->Nodes.size()+node.NumberOfChildren);
+    vtkIdType childId = node.FirstChild;
+    for (int o=0; o<8; o++)
+      {
+      if (octantOffsets[o+1] == octantOffsets[o])
+        {
+        continue;
+        }
+      this->BuildNode(childId,begin+octantOffsets[o],begin+octantOffsets[o+1],coefficients,depth+1);
+      const vtkvmtkRBFInterpolationTreeNode& child = this->Nodes[childId];
+      node.Charge += child.Charge;
+      for (int k=0; k<3; k++)
+        {
+        node.Dipole[k] += child.Dipole[k] + child.Charge * (child.Center[k] - center[k]);
+        }
+      childId++;
+      }
+    this->Nodes[nodeId] = node;
+    }
+
+  int GetOctant(const double center[3], vtkIdType pointId) const
+    {
+    const double* x = &this->Centers[3*pointId];
+    return (x[0] > center[0] ? 1 : 0) + (x[1] > center[1] ? 2 : 0) + (x[2] > center[2] ? 4 : 0);
+    }
+
+  std::vector<double> Centers;
+
+  double SupportRadius;
+  double BucketSize;
+  double GridOrigin[3];
+  int GridDimensions[3];
+  std::vector<vtkIdType> BucketOffsets;
+  std::vector<vtkIdType> BucketPointIds;
+
+  std::vector<vtkvmtkRBFInterpolationTreeNode> Nodes;
+  std::vector<vtkIdType> TreePointIds;
+};
+
+// Fills rows [begin,end) of the dense interpolation matrix.
+class vtkvmtkRBFInterpolationDenseMatrixFunctor
+{
+public:
+  vtkvmtkRBFInterpolation* Interpolation;
+  const double* Centers;
+  vtkIdType NumberOfPoints;
+  double** A;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      for (vtkIdType j=0; j<this->NumberOfPoints; j++)
+        {
+        this->A[i][j] = this->Interpolation->EvaluateKernel(sqrt(vtkMath::Distance2BetweenPoints(this->Centers+3*i,this->Centers+3*j)));
+        }
+      }
+    }
+};
+
+// Counts (when ColumnIds is NULL) or fills the off-diagonal entries of rows [begin,end) of the
+// sparse interpolation matrix: the source points within the support of the point of each row.
+class vtkvmtkRBFInterpolationSparseMatrixFunctor
+{
+public:
+  vtkvmtkRBFInterpolation* Interpolation;
+  const vtkvmtkRBFInterpolationInternals* Internals;
+  vtkIdType* Counts;
+  const vtkIdType* RowOffsets;
+  vtkIdType* ColumnIds;
+  double* Values;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    const vtkvmtkRBFInterpolationInternals* internals = this->Internals;
+    double radius = internals->SupportRadius;
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      const double* x = &internals->Centers[3*i];
+      int ijk[3];
+      internals->GetBucket(x,ijk);
+      vtkIdType count = 0;
+      for (int bk=ijk[2]-1; bk<=ijk[2]+1; bk++)
+        {
+        for (int bj=ijk[1]-1; bj<=ijk[1]+1; bj++)
+          {
+          for (int bi=ijk[0]-1; bi<=ijk[0]+1; bi++)
+            {
+            if (bi<0 || bj<0 || bk<0 || bi>=internals->GridDimensions[0] || bj>=internals->GridDimensions[1] || bk>=internals->GridDimensions[2])
+              {
+              continue;
+              }
+            vtkIdType bucket = bi + internals->GridDimensions[0] * (bj + internals->GridDimensions[1] * bk);
+            for (vtkIdType p=internals->BucketOffsets[bucket]; p<internals->BucketOffsets[bucket+1]; p++)
+              {
+              vtkIdType j = internals->BucketPointIds[p];
+              if (j == i)
+                {
+                continue;
+                }
+              double r = sqrt(vtkMath::Distance2BetweenPoints(x,&internals->Centers[3*j]));
+              if (r >= radius)
+                {
+                continue;
+                }
+              if (this->ColumnIds)
+                {
+                this->ColumnIds[this->RowOffsets[i]+count] = j;
+                this->Values[this->RowOffsets[i]+count] = this->Interpolation->EvaluateKernel(r);
+                }
+              count++;
+              }
+            }
+          }
+        }
+      if (this->Counts)
+        {
+        this->Counts[i] = count;
+        }
+      }
+    }
+};
+
+// Evaluates the interpolant at points [begin,end) of a data set.
+class vtkvmtkRBFInterpolationEvaluateFunctor
+{
+public:
+  vtkvmtkRBFInterpolation* Interpolation;
+  vtkDataSet* DataSet;
+  double* Values;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    double x[3];
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      this->DataSet->GetPoint(i,x);
+      this->Values[i] = this->Interpolation->EvaluateInterpolant(x) - this->Interpolation->RBFInterpolationValue;
+      }
+    }
+};
 
 vtkStandardNewMacro(vtkvmtkRBFInterpolation);
 
@@ -32,8 +361,11 @@ vtkvmtkRBFInterpolation::vtkvmtkRBFInterpolation()
 {
   this->Source = NULL;
   this->RBFType = THIN_PLATE_SPLINE;
+  this->SupportRadius = 0.0;
+  this->TreecodeOpeningRatio = 0.0;
   this->Coefficients = NULL;
   this->RBFInterpolationValue = 1.0;
+  this->Internals = new vtkvmtkRBFInterpolationInternals;
 }
 
 vtkvmtkRBFInterpolation::~vtkvmtkRBFInterpolation()
@@ -49,26 +381,36 @@ vtkvmtkRBFInterpolation::~vtkvmtkRBFInterpolation()
     this->Coefficients->Delete();
     this->Coefficients = NULL;
     }
+
+  delete this->Internals;
 }
 
-double vtkvmtkRBFInterpolation::EvaluateRBF(double c[3], double x[3])
+double vtkvmtkRBFInterpolation::EvaluateKernel(double r)
 {
   if (this->RBFType == THIN_PLATE_SPLINE)
     {
-    double r2 = vtkMath::Distance2BetweenPoints(c,x);
-    if (!r2)
+    if (!r)
       {
       return 0.0;
       }
-    return r2 * log(sqrt(r2));
+    return r * r * log(r);
     }
   else if (this->RBFType == BIHARMONIC)
     {
-    return sqrt(vtkMath::Distance2BetweenPoints(c,x));
+    return r;
     }
   else if (this->RBFType == TRIHARMONIC)
     {
-    return pow(vtkMath::Distance2BetweenPoints(c,x),1.5);
+    return r * r * r;
+    }
+  else if (this->RBFType == WENDLAND)
+    {
+    double t = r / this->Internals->SupportRadius;
+    if (t >= 1.0)
+      {
+      return 0.0;
+      }
+    return (1.0 - t) * (1.0 - t) * (1.0 - t) * (1.0 - t) * (4.0 * t + 1.0);
     }
   else
     {
@@ -77,6 +419,44 @@ double vtkvmtkRBFInterpolation::EvaluateRBF(double c[3], double x[3])
     }
 }
 
+double vtkvmtkRBFInterpolation::EvaluateKernelDerivative(double r)
+{
+  if (this->RBFType == THIN_PLATE_SPLINE)
+    {
+    if (!r)
+      {
+      return 0.0;
+      }
+    return 2.0 * r * log(r) + r;
+    }
+  else if (this->RBFType == BIHARMONIC)
+    {
+    return 1.0;
+    }
+  else if (this->RBFType == TRIHARMONIC)
+    {
+    return 3.0 * r * r;
+    }
+  else if (this->RBFType == WENDLAND)
+    {
+    double t = r / this->Internals->SupportRadius;
+    if (t >= 1.0)
+      {
+      return 0.0;
+      }
+    return -20.0 * t * (1.0 - t) * (1.0 - t) * (1.0 - t) / this->Internals->SupportRadius;
+    }
+  else
+    {
+    return 0.0;
+    }
+}
+
+double vtkvmtkRBFInterpolation::EvaluateRBF(double c[3], double x[3])
+{
+  return this->EvaluateKernel(sqrt(vtkMath::Distance2BetweenPoints(c,x)));
+}
+
 void vtkvmtkRBFInterpolation::ComputeCoefficients()
 {
   if (this->Coefficients)
@@ -85,43 +465,81 @@ void vtkvmtkRBFInterpolation::ComputeCoefficients()
     this->Coefficients = NULL;
     }
 
+  this->Internals->Initialize();
+
   if (!this->Source)
     {
     vtkErrorMacro("No Source specified!");
     return;
     }
 
-  int numberOfPoints = this->Source->GetNumberOfPoints();
+  vtkIdType numberOfPoints = this->Source->GetNumberOfPoints();
   if (!numberOfPoints)
     {
     vtkWarningMacro("Empty Source specified!");
     return;
     }
 
+  this->Internals->Centers.resize(3*numberOfPoints);
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    this->Source->GetPoint(i,&this->Internals->Centers[3*i]);
+    }
+
   this->Coefficients = vtkDoubleArray::New();
   this->Coefficients->SetNumberOfValues(numberOfPoints);
 
+  if (this->RBFType == WENDLAND)
+    {
+    this->Internals->SupportRadius = this->SupportRadius;
+    if (this->Internals->SupportRadius <= 0.0)
+      {
+      this->Internals->SupportRadius = 0.25 * this->Source->GetLength();
+      }
+    if (this->Internals->SupportRadius <= 0.0)
+      {
+      this->Internals->SupportRadius = 1.0;
+      }
+    this->Internals->BuildBuckets(this->Internals->SupportRadius);
+    this->ComputeSparseCoefficients();
+    }
+  else
+    {
+    this->ComputeDenseCoefficients();
+    if (this->TreecodeOpeningRatio > 0.0)
+      {
+      this->Internals->TreePointIds.resize(numberOfPoints);
+      for (vtkIdType i=0; i<numberOfPoints; i++)
+        {
+        this->Internals->TreePointIds[i] = i;
+        }
+      this->Internals->Nodes.resize(1);
+      this->Internals->BuildNode(0,0,numberOfPoints,this->Coefficients->GetPointer(0),0);
+      }
+    }
+}
+
+void vtkvmtkRBFInterpolation::ComputeDenseCoefficients()
+{
+  vtkIdType numberOfPoints = this->Source->GetNumberOfPoints();
+
   double **A, *x;
   x = new double[numberOfPoints];
   A = new double* [numberOfPoints];
 
-  int i;
+  vtkIdType i;
   for (i=0; i<numberOfPoints; i++)
     {
     A[i] = new double[numberOfPoints];
     x[i] = this->RBFInterpolationValue;
     }
 
-  double center[3];
-  int j;
-  for (i=0; i<numberOfPoints; i++)
-    {
-    this->Source->GetPoint(i,center);
-    for (j=0; j<numberOfPoints; j++)
-      {
-      A[i][j] = this->EvaluateRBF(center,this->Source->GetPoint(j));
-      }
-    } 
+  vtkvmtkRBFInterpolationDenseMatrixFunctor matrixFunctor;
+  matrixFunctor.Interpolation = this;
+  matrixFunctor.Centers = &this->Internals->Centers[0];
+  matrixFunctor.NumberOfPoints = numberOfPoints;
+  matrixFunctor.A = A;
+  vtkSMPTools::For(0,numberOfPoints,16,matrixFunctor);
 
   int ret = vtkMath::SolveLinearSystem(A,x,numberOfPoints);
 
@@ -143,6 +561,156 @@ void vtkvmtkRBFInterpolation::ComputeCoefficients()
   delete[] A;
 }
 
+void vtkvmtkRBFInterpolation::ComputeSparseCoefficients()
+{
+  vtkIdType numberOfPoints = this->Source->GetNumberOfPoints();
+
+  std::vector<vtkIdType> rowOffsets(numberOfPoints+1,0);
+
+  vtkvmtkRBFInterpolationSparseMatrixFunctor matrixFunctor;
+  matrixFunctor.Interpolation = this;
+  matrixFunctor.Internals = this->Internals;
+  matrixFunctor.Counts = &rowOffsets[1];
+  matrixFunctor.RowOffsets = NULL;
+  matrixFunctor.ColumnIds = NULL;
+  matrixFunctor.Values = NULL;
+  vtkSMPTools::For(0,numberOfPoints,256,matrixFunctor);
+
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    rowOffsets[i+1] += rowOffsets[i];
+    }
+
+  vtkvmtkSparseMatrix* matrix = vtkvmtkSparseMatrix::New();
+  matrix->AllocateCompressedRows(numberOfPoints,&rowOffsets[0]);
+  double* diagonalValues = matrix->GetDiagonalValues();
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    diagonalValues[i] = this->EvaluateKernel(0.0);
+    }
+
+  matrixFunctor.Counts = NULL;
+  matrixFunctor.RowOffsets = matrix->GetRowOffsets();
+  matrixFunctor.ColumnIds = matrix->GetColumnIds();
+  matrixFunctor.Values = matrix->GetValues();
+  vtkSMPTools::For(0,numberOfPoints,256,matrixFunctor);
+
+  vtkvmtkDoubleVector* rhs = vtkvmtkDoubleVector::New();
+  rhs->Allocate(numberOfPoints);
+  rhs->Fill(this->RBFInterpolationValue);
+
+  vtkvmtkDoubleVector* solution = vtkvmtkDoubleVector::New();
+  solution->Allocate(numberOfPoints);
+  solution->Fill(0.0);
+
+  vtkvmtkLinearSystem* linearSystem = vtkvmtkLinearSystem::New();
+  linearSystem->SetA(matrix);
+  linearSystem->SetB(rhs);
+  linearSystem->SetX(solution);
+
+  // the Wendland kernel is positive definite, and on its symmetric matrix the ILU(0)
+  // preconditioner is the incomplete Cholesky factorization IC(0)
+  vtkvmtkKrylovLinearSystemSolver* solver = vtkvmtkKrylovLinearSystemSolver::New();
+  solver->SetLinearSystem(linearSystem);
+  solver->SetSolverTypeToCG();
+  solver->SetPreconditionerTypeToILU0();
+  solver->UseInitialGuessOff();
+  solver->SetConvergenceTolerance(1E-10);
+  solver->SetMaximumNumberOfIterations(numberOfPoints > 1000 ? numberOfPoints : 1000);
+
+  if (solver->Solve() != 0)
+    {
+    vtkErrorMacro(<<"Cannot compute coefficients: error during linear system solve");
+    }
+
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    this->Coefficients->SetValue(i,solution->GetElement(i));
+    }
+
+  solver->Delete();
+  linearSystem->Delete();
+  solution->Delete();
+  rhs->Delete();
+  matrix->Delete();
+}
+
+double vtkvmtkRBFInterpolation::EvaluateInterpolant(const double x[3])
+{
+  const vtkvmtkRBFInterpolationInternals* internals = this->Internals;
+  const double* coefficients = this->Coefficients->GetPointer(0);
+  double rbfValue = 0.0;
+
+  if (this->RBFType == WENDLAND)
+    {
+    int ijk[3];
+    internals->GetBucket(x,ijk);
+    for (int bk=ijk[2]-1; bk<=ijk[2]+1; bk++)
+      {
+      for (int bj=ijk[1]-1; bj<=ijk[1]+1; bj++)
+        {
+        for (int bi=ijk[0]-1; bi<=ijk[0]+1; bi++)
+          {
+          if (bi<0 || bj<0 || bk<0 || bi>=internals->GridDimensions[0] || bj>=internals->GridDimensions[1] || bk>=internals->GridDimensions[2])
+            {
+            continue;
+            }
+          vtkIdType bucket = bi + internals->GridDimensions[0] * (bj + internals->GridDimensions[1] * bk);
+          for (vtkIdType p=internals->BucketOffsets[bucket]; p<internals->BucketOffsets[bucket+1]; p++)
+            {
+            vtkIdType j = internals->BucketPointIds[p];
+            rbfValue += coefficients[j] * this->EvaluateKernel(sqrt(vtkMath::Distance2BetweenPoints(x,&internals->Centers[3*j])));
+            }
+          }
+        }
+      }
+    return rbfValue;
+    }
+
+  vtkIdType numberOfPoints = internals->Centers.size() / 3;
+  if (internals->Nodes.empty())
+    {
+    for (vtkIdType i=0; i<numberOfPoints; i++)
+      {
+      rbfValue += coefficients[i] * this->EvaluateKernel(sqrt(vtkMath::Distance2BetweenPoints(x,&internals->Centers[3*i])));
+      }
+    return rbfValue;
+    }
+
+  // sum over the clusters small enough with respect to their distance, opening the others; the
+  // kernel about a cluster center z is expanded as phi(|x-y|) ~ phi(r) - phi'(r) (x-z).(y-z) / r
+  vtkIdType stack[512];
+  int stackSize = 0;
+  stack[stackSize++] = 0;
+  while (stackSize > 0)
+    {
+    const vtkvmtkRBFInterpolationTreeNode& node = internals->Nodes[stack[--stackSize]];
+    double r = sqrt(vtkMath::Distance2BetweenPoints(x,node.Center));
+    if (node.Radius < this->TreecodeOpeningRatio * r)
+      {
+      double offsetDotDipole = (x[0] - node.Center[0]) * node.Dipole[0] + (x[1] - node.Center[1]) * node.Dipole[1] + (x[2] - node.Center[2]) * node.Dipole[2];
+      rbfValue += node.Charge * this->EvaluateKernel(r) - this->EvaluateKernelDerivative(r) * offsetDotDipole / r;
+      }
+    else if (node.NumberOfChildren == 0 || stackSize + node.NumberOfChildren > 512)
+      {
+      for (vtkIdType i=node.FirstPoint; i<node.FirstPoint+node.NumberOfPoints; i++)
+        {
+        vtkIdType pointId = internals->TreePointIds[i];
+        rbfValue += coefficients[pointId] * this->EvaluateKernel(sqrt(vtkMath::Distance2BetweenPoints(x,&internals->Centers[3*pointId])));
+        }
+      }
+    else
+      {
+      for (vtkIdType c=0; c<node.NumberOfChildren; c++)
+        {
+        stack[stackSize++] = node.FirstChild + c;
+        }
+      }
+    }
+
+  return rbfValue;
+}
+
 double vtkvmtkRBFInterpolation::EvaluateFunction(double x[3])
 {
   if (!this->Source)
@@ -164,20 +732,47 @@ double vtkvmtkRBFInterpolation::EvaluateFunction(double x[3])
     this->ComputeCoefficients();
     }
 
-  double rbfValue = 0.0;
-  double center[3];
-  int i;
-  for (i=0; i<numberOfPoints; i++)
-    {
-    this->Source->GetPoint(i,center);
-    rbfValue += this->Coefficients->GetValue(i) * this->EvaluateRBF(center,x);
-    }
+  double rbfValue = this->EvaluateInterpolant(x);
 
   rbfValue -= this->RBFInterpolationValue;
 
   return rbfValue;
 }
 
+void vtkvmtkRBFInterpolation::EvaluateFunctionOnDataSet(vtkDataSet* dataSet, vtkDoubleArray* values)
+{
+  if (!this->Source)
+    {
+    vtkErrorMacro("No Source specified!");
+    return;
+    }
+
+  if (!this->Source->GetNumberOfPoints())
+    {
+    vtkWarningMacro("Empty Source specified!");
+    return;
+    }
+
+  if (!this->Coefficients)
+    {
+    this->ComputeCoefficients();
+    }
+
+  vtkIdType numberOfPoints = dataSet->GetNumberOfPoints();
+  values->SetNumberOfComponents(1);
+  values->SetNumberOfTuples(numberOfPoints);
+  if (!numberOfPoints)
+    {
+    return;
+    }
+
+  vtkvmtkRBFInterpolationEvaluateFunctor evaluateFunctor;
+  evaluateFunctor.Interpolation = this;
+  evaluateFunctor.DataSet = dataSet;
+  evaluateFunctor.Values = values->GetPointer(0);
+  vtkSMPTools::For(0,numberOfPoints,1024,evaluateFunctor);
+}
+
 void vtkvmtkRBFInterpolation::EvaluateGradient(double x[3], double n[3])
 {
   vtkWarningMacro("RBF gradient computation not implemented.");
@@ -201,4 +796,7 @@ void vtkvmtkRBFInterpolation::PrintSelf(std::ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
 
+  os << indent << "RBFType: " << this->RBFType << endl;
+  os << indent << "SupportRadius: " << this->SupportRadius << endl;
+  os << indent << "TreecodeOpeningRatio: " << this->TreecodeOpeningRatio << endl;
 }
@@ -28,7 +28,19 @@ Program:   VMTK
  * or triharmonic). Since all source points share the same target value, this does not directly
  * reconstruct a signed-distance-like implicit surface from on/off-surface samples; instead it is
  * used to build a smooth scalar field seeded at a set of points, e.g. by vmtkrbfinterpolation to
- * resample a set of seed points onto a regular image grid via vtkSampleFunction.
+ * resample a set of seed points onto a regular image grid.
+ *
+ * The global kernels (thin-plate spline, biharmonic, triharmonic) lead to a dense system, solved
+ * directly, and every evaluation involves all source points. With TreecodeOpeningRatio above zero,
+ * the contribution of clusters of source points that are far from the evaluation point (the
+ * radius of the cluster is smaller than TreecodeOpeningRatio times its distance) is approximated
+ * by a dipole expansion about the center of the cluster, which makes evaluation roughly
+ * logarithmic in the number of source points. The compactly supported Wendland kernel
+ * (1-r/R)^4 (4r/R+1), with R the SupportRadius, is positive definite and zero beyond R: its system
+ * is sparse, solved with conjugate gradients preconditioned by ILU(0) (on this symmetric matrix,
+ * the incomplete Cholesky factorization IC(0)), and only the source points closer than R are
+ * visited by an evaluation. EvaluateFunctionOnDataSet evaluates the interpolant at all points of
+ * an image or surface in parallel.
  */
 
 #ifndef __vtkvmtkRBFInterpolation_h
@@ -40,6 +52,9 @@ Program:   VMTK
 #include "vtkvmtkWin32Header.h"
 #include "vtkVersion.h"
 
+class vtkDataSet;
+class vtkvmtkRBFInterpolationInternals;
+
 class VTK_VMTK_MISC_EXPORT vtkvmtkRBFInterpolation : public vtkImplicitFunction
 {
   public:
@@ -70,6 +85,13 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkRBFInterpolation : public vtkImplicitFunction
    */
   void ComputeCoefficients();
 
+  /**
+   * Evaluate the function at every point of dataSet, in parallel, storing the values in values
+   * (resized to one component per point). Coefficients are computed first if needed. dataSet must
+   * support concurrent GetPoint calls, as image data and point sets do.
+   */
+  void EvaluateFunctionOnDataSet(vtkDataSet* dataSet, vtkDoubleArray* values);
+
   ///@{
   /**
    * Set / get source poly data.
@@ -81,8 +103,8 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkRBFInterpolation : public vtkImplicitFunction
   ///@{
   /**
    * Set/Get the radial basis kernel used to build the interpolant, one of the THIN_PLATE_SPLINE,
-   * BIHARMONIC, or TRIHARMONIC enum values (equivalently set through the SetRBFTypeTo... methods
-   * below). Default: THIN_PLATE_SPLINE.
+   * BIHARMONIC, TRIHARMONIC or WENDLAND enum values (equivalently set through the SetRBFTypeTo...
+   * methods below). Default: THIN_PLATE_SPLINE.
    */
   vtkSetMacro(RBFType,int);
   vtkGetMacro(RBFType,int);
@@ -92,6 +114,29 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkRBFInterpolation : public vtkImplicitFunction
   { this->SetRBFType(BIHARMONIC); }
   void SetRBFTypeToTriharmonic()
   { this->SetRBFType(TRIHARMONIC); }
+  void SetRBFTypeToWendland()
+  { this->SetRBFType(WENDLAND); }
+  ///@}
+
+  ///@{
+  /**
+   * Set/Get the radius beyond which the WENDLAND kernel vanishes. Larger radii give smoother
+   * interpolants at the cost of denser systems and slower evaluations. A value of zero (the
+   * default) uses a quarter of the diagonal of the bounding box of Source.
+   */
+  vtkSetMacro(SupportRadius,double);
+  vtkGetMacro(SupportRadius,double);
+  ///@}
+
+  ///@{
+  /**
+   * Set/Get the ratio between the radius of a cluster of source points and its distance from the
+   * evaluation point below which the cluster is approximated when evaluating global kernels.
+   * Smaller values are more accurate and slower; zero (the default) sums over all source points
+   * exactly. Values around 0.3 to 0.5 are typical.
+   */
+  vtkSetMacro(TreecodeOpeningRatio,double);
+  vtkGetMacro(TreecodeOpeningRatio,double);
   ///@}
 
 //BTX
@@ -99,7 +144,8 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkRBFInterpolation : public vtkImplicitFunction
   {
     THIN_PLATE_SPLINE,
     BIHARMONIC,
-    TRIHARMONIC
+    TRIHARMONIC,
+    WENDLAND
   };
 //ETX
 
@@ -111,12 +157,31 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkRBFInterpolation : public vtkImplicitFunction
 
   double EvaluateRBF(double c[3], double x[3]);
 
+  // Kernel value, and derivative with respect to r, at distance r.
+  double EvaluateKernel(double r);
+  double EvaluateKernelDerivative(double r);
+
+  // Sum of the weighted kernels at x, without checks; safe to call concurrently once the
+  // coefficients have been computed.
+  double EvaluateInterpolant(const double x[3]);
+
+  void ComputeDenseCoefficients();
+  void ComputeSparseCoefficients();
+
   vtkPolyData* Source;
   int RBFType;
+  double SupportRadius;
+  double TreecodeOpeningRatio;
 
   vtkDoubleArray* Coefficients;
   double RBFInterpolationValue;
 
+  vtkvmtkRBFInterpolationInternals* Internals;
+
+  friend class vtkvmtkRBFInterpolationDenseMatrixFunctor;
+  friend class vtkvmtkRBFInterpolationSparseMatrixFunctor;
+  friend class vtkvmtkRBFInterpolationEvaluateFunctor;
+
   private:
   vtkvmtkRBFInterpolation(const vtkvmtkRBFInterpolation&);  // Not implemented.
   void operator=(const vtkvmtkRBFInterpolation&);  // Not implemented.
@@ -13,34 +13,271 @@
 
 =========================================================================*/
 #include "vtkvmtkStaticTemporalInterpolatedVelocityField.h"
+#include "vtkvmtkVelocityTimeSeries.h"
 
 #include "vtkTable.h"
 #include "vtkDataSet.h"
 #include "vtkGenericCell.h"
 #include "vtkPointData.h"
 #include "vtkDataArray.h"
+#include "vtkFloatArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkIdList.h"
+#include "vtkIdTypeArray.h"
+#include "vtkUnstructuredGrid.h"
+#include "vtkStaticCellLocator.h"
+#include "vtkTetra.h"
+#include "vtkCellType.h"
 #include "vtkMath.h"
+#include "vtkSmartPointer.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocalObject.h"
+#include "vtkTimeStamp.h"
+#include "vtkTimerLog.h"
 #include "vtkObjectFactory.h"
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
 // The interpolated velocity fields were reworked in VTK 9.2: the DataSets
 // collection became DataSetsInfo, the GenCell/Cell scratch cells were removed
 // and the Weights member became a std::vector.
 #define VMTK_VTK_HAS_REWORKED_IVF \
   (VTK_MAJOR_VERSION > 9 || (VTK_MAJOR_VERSION == 9 && VTK_MINOR_VERSION >= 2))
 
+// One velocity component of one time step: the point data array and
+// component it is read from and, for float and double arrays, the raw
+// buffer starting at that component. Time steps read from a velocity time
+// series have a float buffer and no array.
+class vtkvmtkTemporalVelocityChannel
+{
+public:
+  vtkvmtkTemporalVelocityChannel()
+  {
+    this->Array = NULL;
+    this->Component = 0;
+    this->FloatData = NULL;
+    this->DoubleData = NULL;
+    this->Stride = 1;
+  }
+
+  void Set(vtkDataArray* array, int component)
+  {
+    this->Array = NULL;
+    this->Component = component;
+    this->FloatData = NULL;
+    this->DoubleData = NULL;
+    this->Stride = 1;
+    if (!array || component >= array->GetNumberOfComponents())
+      {
+      return;
+      }
+    this->Array = array;
+    this->Stride = array->GetNumberOfComponents();
+    vtkFloatArray* floatArray = vtkFloatArray::SafeDownCast(array);
+    vtkDoubleArray* doubleArray = vtkDoubleArray::SafeDownCast(array);
+    if (floatArray && floatArray->GetNumberOfTuples() > 0)
+      {
+      this->FloatData = floatArray->GetPointer(0) + component;
+      }
+    else if (doubleArray && doubleArray->GetNumberOfTuples() > 0)
+      {
+      this->DoubleData = doubleArray->GetPointer(0) + component;
+      }
+  }
+
+  void SetFloatData(const float* data, int component, vtkIdType stride)
+  {
+    this->Array = NULL;
+    this->Component = component;
+    this->FloatData = data ? data + component : NULL;
+    this->DoubleData = NULL;
+    this->Stride = stride;
+  }
+
+  int IsValid() const
+  {
+    return this->Array || this->FloatData;
+  }
+
+  double GetValue(vtkIdType id) const
+  {
+    if (this->FloatData)
+      {
+      return this->FloatData[id * this->Stride];
+      }
+    if (this->DoubleData)
+      {
+      return this->DoubleData[id * this->Stride];
+      }
+    return this->Array->GetComponent(id,this->Component);
+  }
+
+  vtkDataArray* Array;
+  int Component;
+  const float* FloatData;
+  const double* DoubleData;
+  vtkIdType Stride;
+};
+
+// The velocity channels of all time steps of one dataset, three per
+// row of the time steps table.
+class vtkvmtkTemporalVelocityArrays
+{
+public:
+  std::vector<vtkvmtkTemporalVelocityChannel> Channels;
+  vtkTimeStamp BuildTime;
+};
+
+// Face adjacency and cell locator of a tetrahedral mesh. Neighbors holds,
+// for every tetrahedron, the cell across the face opposite each of its
+// four points (-1 on the boundary); it is NULL for other datasets. Both
+// objects are reference counted, so copies of the table share them.
+class vtkvmtkCellWalkTable
+{
+public:
+  vtkvmtkCellWalkTable()
+  {
+    this->Built = 0;
+  }
+
+  vtkSmartPointer<vtkIdTypeArray> Neighbors;
+  vtkSmartPointer<vtkStaticCellLocator> Locator;
+  vtkTimeStamp BuildTime;
+  int Built;
+};
+
+class vtkvmtkCellWalkNeighborsFunctor
+{
+public:
+  vtkUnstructuredGrid* Grid;
+  vtkIdType* Neighbors;
+
+  vtkSMPThreadLocalObject<vtkIdList> CellPointIds;
+  vtkSMPThreadLocalObject<vtkIdList> FacePointIds;
+  vtkSMPThreadLocalObject<vtkIdList> NeighborCellIds;
+
+  void Initialize()
+    {
+    this->FacePointIds.Local()->SetNumberOfIds(3);
+    }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    vtkIdList* cellPointIds = this->CellPointIds.Local();
+    vtkIdList* facePointIds = this->FacePointIds.Local();
+    vtkIdList* neighborCellIds = this->NeighborCellIds.Local();
+    for (vtkIdType cellId=begin; cellId<end; cellId++)
+      {
+      this->Grid->GetCellPoints(cellId,cellPointIds);
+      for (int i=0; i<4; i++)
+        {
+        // the face opposite point i
+        for (int j=0, k=0; j<4; j++)
+          {
+          if (j != i)
+            {
+            facePointIds->SetId(k++,cellPointIds->GetId(j));
+            }
+          }
+        this->Grid->GetCellNeighbors(cellId,facePointIds,neighborCellIds);
+        this->Neighbors[4*cellId+i] = neighborCellIds->GetNumberOfIds() > 0 ? neighborCellIds->GetId(0) : -1;
+        }
+      }
+    }
+
+  void Reduce()
+    {
+    }
+};
+
+static void vtkvmtkBuildCellWalkTable(vtkDataSet* dataset, vtkvmtkCellWalkTable& table)
+{
+  table.Neighbors = NULL;
+  table.Locator = NULL;
+  table.Built = 1;
+
+  vtkUnstructuredGrid* grid = vtkUnstructuredGrid::SafeDownCast(dataset);
+  if (!grid || grid->GetNumberOfCells() == 0)
+    {
+    table.BuildTime.Modified();
+    return;
+    }
+
+  vtkIdType numberOfCells = grid->GetNumberOfCells();
+  for (vtkIdType cellId=0; cellId<numberOfCells; cellId++)
+    {
+    if (grid->GetCellType(cellId) != VTK_TETRA)
+      {
+      table.BuildTime.Modified();
+      return;
+      }
+    }
+
+  grid->BuildLinks();
+
+  table.Neighbors = vtkSmartPointer<vtkIdTypeArray>::New();
+  table.Neighbors->SetNumberOfValues(4*numberOfCells);
+
+  vtkvmtkCellWalkNeighborsFunctor neighborsFunctor;
+  neighborsFunctor.Grid = grid;
+  neighborsFunctor.Neighbors = table.Neighbors->GetPointer(0);
+  vtkSMPTools::For(0,numberOfCells,neighborsFunctor);
+
+  table.Locator = vtkSmartPointer<vtkStaticCellLocator>::New();
+  table.Locator->SetDataSet(grid);
+  table.Locator->BuildLocator();
+
+  table.BuildTime.Modified();
+}
+
+class vtkvmtkStaticTemporalInterpolatedVelocityFieldInternals
+{
+public:
+  vtkvmtkStaticTemporalInterpolatedVelocityFieldInternals()
+  {
+    this->Table = NULL;
+    this->Series = NULL;
+    this->CellPointIds = vtkSmartPointer<vtkIdList>::New();
+  }
+
+  vtkTable* Table;
+  vtkvmtkVelocityTimeSeries* Series;
+  vtkTimeStamp TimeStepsBuildTime;
+  std::vector<int> TimeIndices;
+  std::vector<double> Times;
+
+  std::map<vtkDataSet*,vtkvmtkTemporalVelocityArrays> Arrays;
+
+  std::map<vtkDataSet*,vtkvmtkCellWalkTable> CellWalkTables;
+  vtkSmartPointer<vtkIdList> CellPointIds;
+};
+
 vtkStandardNewMacro(vtkvmtkStaticTemporalInterpolatedVelocityField);
 vtkCxxSetObjectMacro(vtkvmtkStaticTemporalInterpolatedVelocityField, TimeStepsTable, vtkTable);
+vtkCxxSetObjectMacro(vtkvmtkStaticTemporalInterpolatedVelocityField, VelocityTimeSeries, vtkvmtkVelocityTimeSeries);
 
 vtkvmtkStaticTemporalInterpolatedVelocityField::vtkvmtkStaticTemporalInterpolatedVelocityField()
 {
   this->Periodic = 0;
   this->VelocityScale = 1.0;
   this->TimeStepsTable = NULL;
+  this->VelocityTimeSeries = NULL;
   this->UseVectorComponents = 0;
   this->VectorPrefix = NULL;
   this->Component0Prefix = NULL;
   this->Component1Prefix = NULL;
   this->Component2Prefix = NULL;
+  this->Internals = new vtkvmtkStaticTemporalInterpolatedVelocityFieldInternals;
+  this->UseCellWalk = 0;
+  this->MaximumNumberOfWalkSteps = 64;
+  this->CellLocatorBuildTime = 0.0;
+  this->NumberOfCachedCellHits = 0;
+  this->NumberOfWalkHits = 0;
+  this->NumberOfWalkSteps = 0;
+  this->NumberOfLocatorSearches = 0;
+  this->NumberOfLocatorMisses = 0;
 #if VMTK_VTK_HAS_REWORKED_IVF
   this->TemporalGenCell = vtkGenericCell::New();
   this->TemporalCell = vtkGenericCell::New();
@@ -70,6 +307,10 @@ vtkvmtkStaticTemporalInterpolatedVelocityField::~vtkvmtkStaticTemporalInterpolat
   }
 
   this->SetTimeStepsTable(NULL);
+  this->SetVelocityTimeSeries(NULL);
+
+  delete this->Internals;
+  this->Internals = NULL;
 
 #if VMTK_VTK_HAS_REWORKED_IVF
   this->TemporalGenCell->Delete();
@@ -103,70 +344,246 @@ void vtkvmtkStaticTemporalInterpolatedVelocityField::SetLastCellId( vtkIdType c,
   this->LastDataSetIndex = dataindex;
 }
 
+int vtkvmtkStaticTemporalInterpolatedVelocityField::UpdateTimeSteps()
+{
+  vtkvmtkStaticTemporalInterpolatedVelocityFieldInternals* internals = this->Internals;
+
+  vtkvmtkVelocityTimeSeries* series = this->VelocityTimeSeries;
+  vtkTable* table = series ? NULL : this->TimeStepsTable;
+  vtkObject* source = series ? static_cast<vtkObject*>(series) : static_cast<vtkObject*>(table);
+
+  if (internals->Table == table && internals->Series == series && source &&
+      source->GetMTime() <= internals->TimeStepsBuildTime.GetMTime())
+    {
+    return static_cast<int>(internals->Times.size());
+    }
+
+  internals->Table = table;
+  internals->Series = series;
+  internals->TimeIndices.clear();
+  internals->Times.clear();
+  // array rows refer to the rows of the previous table
+  internals->Arrays.clear();
+
+  if (series)
+    {
+    int numberOfTimeSteps = series->GetNumberOfTimeSteps();
+    internals->TimeIndices.resize(numberOfTimeSteps);
+    internals->Times.resize(numberOfTimeSteps);
+    for (int i=0; i<numberOfTimeSteps; i++)
+      {
+      internals->TimeIndices[i] = i;
+      internals->Times[i] = series->GetTime(i);
+      }
+    }
+  else if (table)
+    {
+    int numberOfRows = this->TimeStepsTable->GetNumberOfRows();
+    int hasTimes = this->TimeStepsTable->GetNumberOfColumns() >= 2;
+    internals->TimeIndices.resize(numberOfRows);
+    internals->Times.resize(numberOfRows);
+    for (int i=0; i<numberOfRows; i++)
+      {
+      internals->TimeIndices[i] = this->TimeStepsTable->GetValue(i,0).ToInt();
+      internals->Times[i] = hasTimes ? this->TimeStepsTable->GetValue(i,1).ToDouble() : 0.0;
+      }
+    }
+
+  internals->TimeStepsBuildTime.Modified();
+
+  return static_cast<int>(internals->Times.size());
+}
+
 void vtkvmtkStaticTemporalInterpolatedVelocityField::FindTimeRowId(double time, int& prevRowId, int& nextRowId, double& p)
 {
-  //cout<<"Time "<<time<<endl;
   prevRowId = 0;
   nextRowId = 0;
   p = 0.0;
-  if (this->TimeStepsTable == NULL)
+  if (this->TimeStepsTable == NULL && this->VelocityTimeSeries == NULL)
     {
     return;
     }
-  int numberOfRows = this->TimeStepsTable->GetNumberOfRows();
-  if (this->TimeStepsTable->GetNumberOfColumns() < 2 || numberOfRows == 1)
+  int numberOfRows = this->UpdateTimeSteps();
+  if (numberOfRows < 2 ||
+      (!this->VelocityTimeSeries && this->TimeStepsTable->GetNumberOfColumns() < 2))
     {
     return;
     }
-  int previousRowIndex = this->TimeStepsTable->GetValue(0,0).ToInt();
-  double previousRowTime = this->TimeStepsTable->GetValue(0,1).ToDouble();
-  if (numberOfRows < 2 || previousRowTime == time)
+  const std::vector<double>& times = this->Internals->Times;
+  double firstTime = times[0];
+  if (firstTime == time)
     {
     return;
     }
 
   double shiftedTime = time;
 
-  double period = this->TimeStepsTable->GetValue(numberOfRows-1,1).ToDouble() - previousRowTime;
+  double period = times[numberOfRows-1] - firstTime;
 
   if (this->Periodic)
     {
-    double ratio = (time - previousRowTime) / period;
-    shiftedTime = (ratio - floor(ratio)) * period + previousRowTime;
+    double ratio = (time - firstTime) / period;
+    shiftedTime = (ratio - floor(ratio)) * period + firstTime;
+    }
+
+  // first row with times[rowId] >= shiftedTime, so that
+  // times[rowId-1] < shiftedTime <= times[rowId]
+  int rowId = static_cast<int>(std::lower_bound(times.begin(),times.end(),shiftedTime) - times.begin());
+
+  if (rowId > 0 && rowId < numberOfRows)
+    {
+    prevRowId = rowId - 1;
+    nextRowId = rowId;
+    p = (shiftedTime - times[prevRowId]) / (times[nextRowId] - times[prevRowId]);
+    }
+  else
+    {
+    prevRowId = numberOfRows - 2;
+    nextRowId = numberOfRows - 2;
+    p = 1.0;
+    }
+}
+
+int vtkvmtkStaticTemporalInterpolatedVelocityField::FindTimeRow(double time)
+{
+  int prevRowId, nextRowId;
+  double p;
+  this->FindTimeRowId(time,prevRowId,nextRowId,p);
+  return prevRowId;
+}
+
+void vtkvmtkStaticTemporalInterpolatedVelocityField::ResetLocationStatistics()
+{
+  this->CellLocatorBuildTime = 0.0;
+  this->NumberOfCachedCellHits = 0;
+  this->NumberOfWalkHits = 0;
+  this->NumberOfWalkSteps = 0;
+  this->NumberOfLocatorSearches = 0;
+  this->NumberOfLocatorMisses = 0;
+}
+
+void vtkvmtkStaticTemporalInterpolatedVelocityField::BuildCellLocators()
+{
+  if (!this->UseCellWalk)
+    {
+    return;
+    }
+
+#if VMTK_VTK_HAS_REWORKED_IVF
+  size_t numberOfDataSets = this->DataSetsInfo.size();
+#else
+  size_t numberOfDataSets = this->DataSets->size();
+#endif
+  for (size_t i=0; i<numberOfDataSets; i++)
+    {
+#if VMTK_VTK_HAS_REWORKED_IVF
+    vtkDataSet* dataset = this->DataSetsInfo[i].DataSet;
+#else
+    vtkDataSet* dataset = (*this->DataSets)[i];
+#endif
+    vtkvmtkCellWalkTable& table = this->Internals->CellWalkTables[dataset];
+    if (table.Built && dataset->GetMTime() <= table.BuildTime.GetMTime())
+      {
+      continue;
+      }
+    double startTime = vtkTimerLog::GetUniversalTime();
+    vtkvmtkBuildCellWalkTable(dataset,table);
+    this->CellLocatorBuildTime += vtkTimerLog::GetUniversalTime() - startTime;
+    }
+}
+
+int vtkvmtkStaticTemporalInterpolatedVelocityField::WalkToCell(vtkDataSet* dataset, double* x, double tol2, vtkGenericCell* genCell, double* weights)
+{
+  vtkvmtkCellWalkTable& table = this->Internals->CellWalkTables[dataset];
+  if (!table.Built || dataset->GetMTime() > table.BuildTime.GetMTime())
+    {
+    double startTime = vtkTimerLog::GetUniversalTime();
+    vtkvmtkBuildCellWalkTable(dataset,table);
+    this->CellLocatorBuildTime += vtkTimerLog::GetUniversalTime() - startTime;
     }
 
-  bool found = false;
-  int pRowId = 0;
-  for (int i=1; i<numberOfRows; i++)
+  if (!table.Neighbors)
     {
-    int rowId = i;
-    //if (i == numberOfRows)
-    //  {
-    //  rowId = 0;
-    //  }
-    int rowIndex = this->TimeStepsTable->GetValue(rowId,0).ToInt();
-    double rowTime = this->TimeStepsTable->GetValue(rowId,1).ToDouble();
-    if (shiftedTime > previousRowTime && shiftedTime <= rowTime)
+    return -1;
+    }
+
+  const vtkIdType* neighbors = table.Neighbors->GetPointer(0);
+  vtkIdList* cellPointIds = this->Internals->CellPointIds;
+  double points[4][3];
+  double bcoords[4];
+
+  vtkIdType cellId = this->LastCellId;
+  if (cellId >= dataset->GetNumberOfCells())
+    {
+    cellId = -1;
+    }
+
+  int step = 0;
+  while (cellId >= 0 && step <= this->MaximumNumberOfWalkSteps)
+    {
+    dataset->GetCellPoints(cellId,cellPointIds);
+    for (int i=0; i<4; i++)
       {
-      prevRowId = pRowId;
-      nextRowId = rowId;
-      p = (shiftedTime - previousRowTime) / (rowTime - previousRowTime);
-      found = true;
+      dataset->GetPoint(cellPointIds->GetId(i),points[i]);
+      }
+    if (!vtkTetra::BarycentricCoords(x,points[0],points[1],points[2],points[3],bcoords))
+      {
+      // degenerate tetrahedron
       break;
       }
-    pRowId = rowId;
-    previousRowIndex = rowIndex;
-    previousRowTime = rowTime;
+
+    // leave through the face opposite the most negative coordinate
+    int exitFace = -1;
+    double minCoord = -1E-10;
+    for (int i=0; i<4; i++)
+      {
+      if (bcoords[i] < minCoord)
+        {
+        minCoord = bcoords[i];
+        exitFace = i;
+        }
+      }
+
+    if (exitFace == -1)
+      {
+      dataset->GetCell(cellId,genCell);
+      for (int i=0; i<4; i++)
+        {
+        weights[i] = bcoords[i];
+        }
+      this->LastPCoords[0] = bcoords[1];
+      this->LastPCoords[1] = bcoords[2];
+      this->LastPCoords[2] = bcoords[3];
+      this->LastCellId = cellId;
+      if (step == 0)
+        {
+        this->NumberOfCachedCellHits++;
+        }
+      else
+        {
+        this->NumberOfWalkHits++;
+        }
+      return 1;
+      }
+
+    cellId = neighbors[4*cellId+exitFace];
+    step++;
+    this->NumberOfWalkSteps++;
     }
 
-  //cout<<"Index "<<prevRowId<<" "<<nextRowId<<endl;
-  if (!found)
+  this->NumberOfLocatorSearches++;
+  double pcoords[3];
+  cellId = table.Locator->FindCell(x,tol2,genCell,pcoords,weights);
+  this->LastCellId = cellId;
+  if (cellId < 0)
     {
-    //cout<<"Shifted time "<<shiftedTime<<endl;
-    prevRowId = numberOfRows - 2;
-    nextRowId = numberOfRows - 2;
-    p = 1.0;
+    this->NumberOfLocatorMisses++;
+    return 0;
     }
+  this->LastPCoords[0] = pcoords[0];
+  this->LastPCoords[1] = pcoords[1];
+  this->LastPCoords[2] = pcoords[2];
+  return 1;
 }
 
 void vtkvmtkStaticTemporalInterpolatedVelocityField::BuildArrayName(char* prefix, int index, char* name)
@@ -177,14 +594,6 @@ void vtkvmtkStaticTemporalInterpolatedVelocityField::BuildArrayName(char* prefix
 int vtkvmtkStaticTemporalInterpolatedVelocityField::FunctionValues( vtkDataSet * dataset, double * x, double * f )
 {
   int i, j, subId , numPts, id;
-  vtkDataArray * vectorsPrev = NULL;
-  vtkDataArray * vectorsNext = NULL;
-  vtkDataArray * component0Prev = NULL;
-  vtkDataArray * component0Next = NULL;
-  vtkDataArray * component1Prev = NULL;
-  vtkDataArray * component1Next = NULL;
-  vtkDataArray * component2Prev = NULL;
-  vtkDataArray * component2Next = NULL;
   double vecPrev[3], vecNext[3];
   double dist2;
   int ret;
@@ -199,62 +608,117 @@ int vtkvmtkStaticTemporalInterpolatedVelocityField::FunctionValues( vtkDataSet *
     return 0;
     }
 
+  if ( (!this->TimeStepsTable && !this->VelocityTimeSeries) || this->UpdateTimeSteps() == 0 )
+    {
+    vtkErrorMacro( << "No time steps to evaluate!" );
+    return 0;
+    }
+
   double time = x[3];
 
   int prevRowId, nextRowId;
   double timeP;
   this->FindTimeRowId(time,prevRowId,nextRowId,timeP);
 
-  int prevTimeIndex = this->TimeStepsTable->GetValue(prevRowId,0).ToInt();
-  int nextTimeIndex = this->TimeStepsTable->GetValue(nextRowId,0).ToInt();
+  const std::vector<int>& timeIndices = this->Internals->TimeIndices;
+  int numberOfRows = static_cast<int>(timeIndices.size());
+  const vtkvmtkTemporalVelocityChannel* channelsPrev = NULL;
+  const vtkvmtkTemporalVelocityChannel* channelsNext = NULL;
+  vtkvmtkTemporalVelocityChannel seriesChannels[6];
 
-  if (this->UseVectorComponents)
+  if ( this->VelocityTimeSeries )
     {
-    this->BuildArrayName(this->Component0Prefix,prevTimeIndex,arrayName);
-    component0Prev = dataset->GetPointData()->GetArray(arrayName);
-    this->BuildArrayName(this->Component1Prefix,prevTimeIndex,arrayName);
-    component1Prev = dataset->GetPointData()->GetArray(arrayName);
-    this->BuildArrayName(this->Component2Prefix,prevTimeIndex,arrayName);
-    component2Prev = dataset->GetPointData()->GetArray(arrayName);
-
-    if (!component0Prev || !component1Prev || !component2Prev)
+    // read the bracketing time steps; the series caches at least two, so
+    // the previous one is still valid after reading the next
+    vtkvmtkVelocityTimeSeries* series = this->VelocityTimeSeries;
+    if ( series->GetNumberOfPoints() != dataset->GetNumberOfPoints() )
       {
-      vtkErrorMacro(<<"Component array not found for index "<<prevTimeIndex);
+      vtkErrorMacro(<<"Velocity time series has "<<series->GetNumberOfPoints()<<" points, dataset has "<<dataset->GetNumberOfPoints());
       return 0;
-      } 
-
-    this->BuildArrayName(this->Component0Prefix,nextTimeIndex,arrayName);
-    component0Next = dataset->GetPointData()->GetArray(arrayName);
-    this->BuildArrayName(this->Component1Prefix,nextTimeIndex,arrayName);
-    component1Next = dataset->GetPointData()->GetArray(arrayName);
-    this->BuildArrayName(this->Component2Prefix,nextTimeIndex,arrayName);
-    component2Next = dataset->GetPointData()->GetArray(arrayName);
-
-    if (timeP > 0.0 && (!component0Next || !component1Next || !component2Next))
+      }
+    const float* valuesPrev = series->GetTimeStep(prevRowId);
+    const float* valuesNext = timeP > 0.0 ? series->GetTimeStep(nextRowId) : NULL;
+    for ( i = 0; i < 3; i ++ )
       {
-      vtkErrorMacro(<<"Component array not found for index "<<nextTimeIndex);
-      return 0;
-      } 
+      seriesChannels[i].SetFloatData(valuesPrev,i,3);
+      seriesChannels[3+i].SetFloatData(valuesNext,i,3);
+      }
+    channelsPrev = seriesChannels;
+    channelsNext = seriesChannels + 3;
     }
   else
     {
-    this->BuildArrayName(this->VectorPrefix,prevTimeIndex,arrayName);
-    vectorsPrev = dataset->GetPointData()->GetArray(arrayName);
-
-    if (timeP > 0.0 && !vectorsPrev)
+    // resolve the velocity arrays of all time steps once per dataset
+    vtkvmtkTemporalVelocityArrays& arrays = this->Internals->Arrays[dataset];
+    if ( arrays.Channels.size() != static_cast<size_t>(3*numberOfRows) ||
+         dataset->GetMTime() > arrays.BuildTime.GetMTime() ||
+         this->GetMTime() > arrays.BuildTime.GetMTime() )
       {
-      vtkErrorMacro(<<"Vector array not found for index "<<prevTimeIndex);
-      return 0;
-      } 
+      arrays.Channels.assign(3*numberOfRows,vtkvmtkTemporalVelocityChannel());
+      char* componentPrefixes[3] = {this->Component0Prefix, this->Component1Prefix, this->Component2Prefix};
+      for ( int rowId = 0; rowId < numberOfRows; rowId ++ )
+        {
+        if (this->UseVectorComponents)
+          {
+          for ( i = 0; i < 3; i ++ )
+            {
+            this->BuildArrayName(componentPrefixes[i],timeIndices[rowId],arrayName);
+            arrays.Channels[3*rowId+i].Set(dataset->GetPointData()->GetArray(arrayName),0);
+            }
+          }
+        else
+          {
+          this->BuildArrayName(this->VectorPrefix,timeIndices[rowId],arrayName);
+          vtkDataArray* vectors = dataset->GetPointData()->GetArray(arrayName);
+          if (vectors && vectors->GetNumberOfComponents() < 3)
+            {
+            vectors = NULL;
+            }
+          for ( i = 0; i < 3; i ++ )
+            {
+            arrays.Channels[3*rowId+i].Set(vectors,i);
+            }
+          }
+        }
+      arrays.BuildTime.Modified();
+      }
 
-    this->BuildArrayName(this->VectorPrefix,nextTimeIndex,arrayName);
-    vectorsNext = dataset->GetPointData()->GetArray(arrayName);
+    channelsPrev = &arrays.Channels[3*prevRowId];
+    channelsNext = &arrays.Channels[3*nextRowId];
+    }
 
-    if (!vectorsNext)
+  if (!channelsPrev[0].IsValid() || !channelsPrev[1].IsValid() || !channelsPrev[2].IsValid())
+    {
+    if (this->VelocityTimeSeries)
       {
-      vtkErrorMacro(<<"Vector array not found for index "<<nextTimeIndex);
-      return 0;
-      } 
+      vtkErrorMacro(<<"Cannot read time step "<<prevRowId<<" of velocity time series");
+      }
+    else if (this->UseVectorComponents)
+      {
+      vtkErrorMacro(<<"Component array not found for index "<<timeIndices[prevRowId]);
+      }
+    else
+      {
+      vtkErrorMacro(<<"Vector array not found for index "<<timeIndices[prevRowId]);
+      }
+    return 0;
+    }
+
+  if (timeP > 0.0 && (!channelsNext[0].IsValid() || !channelsNext[1].IsValid() || !channelsNext[2].IsValid()))
+    {
+    if (this->VelocityTimeSeries)
+      {
+      vtkErrorMacro(<<"Cannot read time step "<<nextRowId<<" of velocity time series");
+      }
+    else if (this->UseVectorComponents)
+      {
+      vtkErrorMacro(<<"Component array not found for index "<<timeIndices[nextRowId]);
+      }
+    else
+      {
+      vtkErrorMacro(<<"Vector array not found for index "<<timeIndices[nextRowId]);
+      }
+    return 0;
     }
 
   double tol2 = dataset->GetLength() *
@@ -276,7 +740,18 @@ int vtkvmtkStaticTemporalInterpolatedVelocityField::FunctionValues( vtkDataSet *
 
   int found = 0;
 
-  if ( this->Caching )
+  if ( this->UseCellWalk )
+    {
+    // -1: not a tetrahedral mesh, search it as usual
+    int walked = this->WalkToCell( dataset, x, tol2, genCell, weights );
+    if ( walked == 0 )
+      {
+      return 0;
+      }
+    found = walked == 1;
+    }
+
+  if ( !found && this->Caching )
     {
     // See if the point is in the cached cell
     if ( this->LastCellId == -1 ||
@@ -338,39 +813,15 @@ int vtkvmtkStaticTemporalInterpolatedVelocityField::FunctionValues( vtkDataSet *
     for ( j = 0; j < numPts; j ++ )
       {
       id = genCell->PointIds->GetId( j );
-      if (this->UseVectorComponents)
+      for ( i = 0; i < 3; i ++ )
         {
-        vecPrev[0] = this->VelocityScale * component0Prev->GetTuple1(id);
-        vecPrev[1] = this->VelocityScale * component1Prev->GetTuple1(id);
-        vecPrev[2] = this->VelocityScale * component2Prev->GetTuple1(id);
-
-        if (timeP > 0.0)
-          {
-          vecNext[0] = this->VelocityScale * component0Next->GetTuple1(id);
-          vecNext[1] = this->VelocityScale * component1Next->GetTuple1(id);
-          vecNext[2] = this->VelocityScale * component2Next->GetTuple1(id);
-          }
-        }
-      else
-        {
-        vectorsPrev->GetTuple( id, vecPrev );
-        for ( i = 0; i < 3; i ++ )
-          {
-          vecPrev[i] *= this->VelocityScale;
-          }
-        if (timeP > 0.0)
-          {
-          vectorsNext->GetTuple( id, vecNext );
-          for ( i = 0; i < 3; i ++ )
-            {
-            vecNext[i] *= this->VelocityScale;
-            }
-          }
+        vecPrev[i] = this->VelocityScale * channelsPrev[i].GetValue(id);
         }
       if (timeP > 0.0)
         {
         for ( i = 0; i < 3; i ++ )
           {
+          vecNext[i] = this->VelocityScale * channelsNext[i].GetValue(id);
           f[i] +=  (timeP * vecNext[i] + (1.0 - timeP) * vecPrev[i]) * weights[j];
           }
         }
@@ -403,7 +854,10 @@ void vtkvmtkStaticTemporalInterpolatedVelocityField::CopyParameters( vtkAbstract
     {
     vtkvmtkStaticTemporalInterpolatedVelocityField* fromCast = vtkvmtkStaticTemporalInterpolatedVelocityField::SafeDownCast(from);
     vtkTable* timeStepsTable = vtkTable::New();
-    timeStepsTable->DeepCopy(fromCast->GetTimeStepsTable());
+    if (fromCast->GetTimeStepsTable())
+      {
+      timeStepsTable->DeepCopy(fromCast->GetTimeStepsTable());
+      }
     this->SetTimeStepsTable(timeStepsTable);
     this->SetPeriodic(fromCast->GetPeriodic());
     this->SetVelocityScale(fromCast->GetVelocityScale());
@@ -412,11 +866,37 @@ void vtkvmtkStaticTemporalInterpolatedVelocityField::CopyParameters( vtkAbstract
     this->SetComponent0Prefix(fromCast->Component0Prefix);
     this->SetComponent1Prefix(fromCast->Component1Prefix);
     this->SetComponent2Prefix(fromCast->Component2Prefix);
+    this->SetUseCellWalk(fromCast->UseCellWalk);
+    this->SetMaximumNumberOfWalkSteps(fromCast->MaximumNumberOfWalkSteps);
+    // the adjacency tables and locators are shared, not rebuilt
+    this->Internals->CellWalkTables = fromCast->Internals->CellWalkTables;
     timeStepsTable->Delete();
+    // read through a copy of the series, sharing its time step cache
+    if (fromCast->GetVelocityTimeSeries())
+      {
+      vtkvmtkVelocityTimeSeries* velocityTimeSeries = vtkvmtkVelocityTimeSeries::New();
+      velocityTimeSeries->CopyFileInformation(fromCast->GetVelocityTimeSeries());
+      this->SetVelocityTimeSeries(velocityTimeSeries);
+      velocityTimeSeries->Delete();
+      }
+    else
+      {
+      this->SetVelocityTimeSeries(NULL);
+      }
     }
 }
 
 void vtkvmtkStaticTemporalInterpolatedVelocityField::PrintSelf( std::ostream & os, vtkIndent indent )
 {
   this->Superclass::PrintSelf( os, indent );
+
+  os << indent << "Velocity time series: " << this->VelocityTimeSeries << endl;
+  os << indent << "Use cell walk: " << this->UseCellWalk << endl;
+  os << indent << "Maximum number of walk steps: " << this->MaximumNumberOfWalkSteps << endl;
+  os << indent << "Cell locator build time: " << this->CellLocatorBuildTime << endl;
+  os << indent << "Number of cached cell hits: " << this->NumberOfCachedCellHits << endl;
+  os << indent << "Number of walk hits: " << this->NumberOfWalkHits << endl;
+  os << indent << "Number of walk steps: " << this->NumberOfWalkSteps << endl;
+  os << indent << "Number of locator searches: " << this->NumberOfLocatorSearches << endl;
+  os << indent << "Number of locator misses: " << this->NumberOfLocatorMisses << endl;
 }
@@ -51,6 +51,27 @@ Program:   VMTK
  * it, the vmtkparticletracer pype script) to trace particle/streak lines through unsteady (e.g.
  * CFD) flow fields sampled at discrete time points on a fixed mesh.
  *
+ * The time values of TimeStepsTable are cached in a plain vector, rebuilt when the table is
+ * replaced or modified, and bracketing time steps are found by binary search. The velocity
+ * arrays of all time steps are looked up by name once per dataset (again after the dataset is
+ * modified) and kept in a table of raw float/double pointers, so FunctionValues does no string
+ * handling and reads the velocity samples straight from the array buffers.
+ *
+ * With UseCellWalk on, points are located in unstructured grids made only of tetrahedra by
+ * walking from the last cell across the face opposite the vertex with the most negative
+ * barycentric coordinate, using a face adjacency table, for at most MaximumNumberOfWalkSteps
+ * cells. When the walk leaves the mesh or does not converge, the point is looked up in a
+ * vtkStaticCellLocator. The adjacency table and the locator are built once per dataset (see
+ * BuildCellLocators) and shared by the copies made through CopyParameters, e.g. by the threads
+ * of vtkvmtkStaticTemporalStreamTracer. Other datasets are searched as without UseCellWalk. The
+ * time spent building and the outcome of every location are counted (see
+ * GetCellLocatorBuildTime, GetNumberOfWalkHits and related methods).
+ *
+ * Alternatively, the velocity of all time steps can be read from a vtkvmtkVelocityTimeSeries
+ * file (see VelocityTimeSeries) instead of point data arrays, so that only the two time steps
+ * bracketing the current time are held in memory. The time values are then taken from the file
+ * and TimeStepsTable and the array prefixes are ignored.
+ *
  * @sa
  * vtkvmtkStaticTemporalStreamTracer
  */
@@ -73,6 +94,8 @@ Program:   VMTK
 
 class vtkTable;
 class vtkGenericCell;
+class vtkvmtkVelocityTimeSeries;
+class vtkvmtkStaticTemporalInterpolatedVelocityFieldInternals;
 
 class VTK_VMTK_MISC_EXPORT vtkvmtkStaticTemporalInterpolatedVelocityField
   : public VMTK_STIVF_SUPERCLASS
@@ -101,6 +124,16 @@ public:
   virtual void SetTimeStepsTable(vtkTable*);
   ///@}
 
+  ///@{
+  /**
+   * Set/Get an opened vtkvmtkVelocityTimeSeries to read the velocity of every time step from,
+   * in place of the point data arrays named after TimeStepsTable. Its number of points must match
+   * the number of points of the datasets. Default: NULL.
+   */
+  vtkGetObjectMacro(VelocityTimeSeries,vtkvmtkVelocityTimeSeries);
+  virtual void SetVelocityTimeSeries(vtkvmtkVelocityTimeSeries*);
+  ///@}
+
   ///@{
   /**
    * Toggle whether time values are treated as periodic, i.e. wrapped modulo the span between the
@@ -113,6 +146,12 @@ public:
   vtkBooleanMacro(Periodic, int);
   ///@}
 
+  /**
+   * Return the row (of TimeStepsTable, or the time step of VelocityTimeSeries) of the first of
+   * the two time steps that the velocity at time is interpolated between.
+   */
+  int FindTimeRow(double time);
+
   ///@{
   /**
    * Set/Get a uniform scale factor applied to every interpolated velocity vector/component
@@ -174,6 +213,49 @@ public:
   vtkGetStringMacro(Component2Prefix);
   ///@}
 
+  ///@{
+  /**
+   * Toggle cell location by walking across the faces of tetrahedral meshes, with a shared static
+   * cell locator as fallback. Default: off.
+   */
+  vtkSetMacro(UseCellWalk, int);
+  vtkGetMacro(UseCellWalk, int);
+  vtkBooleanMacro(UseCellWalk, int);
+  ///@}
+
+  ///@{
+  /**
+   * Set/Get the number of cells a walk may cross before falling back to the cell locator.
+   * Default: 64.
+   */
+  vtkSetClampMacro(MaximumNumberOfWalkSteps, int, 0, VTK_INT_MAX);
+  vtkGetMacro(MaximumNumberOfWalkSteps, int);
+  ///@}
+
+  /**
+   * Build the face adjacency tables and cell locators of all datasets, unless they are already
+   * built or UseCellWalk is off. Called when the tables are first needed; call it before evaluating
+   * the field (or copies of it) from several threads, since building is not thread safe.
+   */
+  void BuildCellLocators();
+
+  ///@{
+  /**
+   * Location statistics since the last call to ResetLocationStatistics: the time spent building
+   * adjacency tables and locators (in seconds), the points found in the cached cell, the points
+   * found by walking and the total number of cells crossed, the locator searches and the locator
+   * searches that did not find a cell.
+   */
+  vtkGetMacro(CellLocatorBuildTime, double);
+  vtkGetMacro(NumberOfCachedCellHits, vtkIdType);
+  vtkGetMacro(NumberOfWalkHits, vtkIdType);
+  vtkGetMacro(NumberOfWalkSteps, vtkIdType);
+  vtkGetMacro(NumberOfLocatorSearches, vtkIdType);
+  vtkGetMacro(NumberOfLocatorMisses, vtkIdType);
+  ///@}
+
+  void ResetLocationStatistics();
+
   /**
    * Set the cell id cached by the last evaluation within a specified dataset.
    */
@@ -189,7 +271,9 @@ public:
 
   /**
    * Copy Periodic, VelocityScale, UseVectorComponents, VectorPrefix, Component0Prefix,
-   * Component1Prefix, Component2Prefix, and a deep copy of TimeStepsTable from another
+   * Component1Prefix, Component2Prefix, UseCellWalk, MaximumNumberOfWalkSteps, the (shared)
+   * adjacency tables and cell locators, a deep copy of TimeStepsTable and a
+   * vtkvmtkVelocityTimeSeries sharing the file and time step cache of VelocityTimeSeries from another
    * interpolated velocity field, provided it is (or derives from)
    * vtkvmtkStaticTemporalInterpolatedVelocityField. Used internally when this velocity field is
    * cloned, e.g. for multithreaded streamline integration.
@@ -210,10 +294,26 @@ protected:
 
   void FindTimeRowId(double time, int& prevRowId, int& nextRowId, double& p);
 
+  /**
+   * Cache the time step indices and time values of VelocityTimeSeries, if set, or else of
+   * TimeStepsTable, unless they are already cached for the current source. Returns the number of
+   * cached time steps.
+   */
+  int UpdateTimeSteps();
+
+  /**
+   * Locate x in dataset by walking from LastCellId, falling back to the cell locator. Returns 1
+   * if a cell was found (setting LastCellId, LastPCoords, genCell and weights), 0 if not, -1 if
+   * dataset is not a tetrahedral mesh and must be searched with FindCell.
+   */
+  int WalkToCell(vtkDataSet* dataset, double* x, double tol2, vtkGenericCell* genCell, double* weights);
+
   void BuildArrayName(char* prefix, int index, char* name);
 
   vtkTable* TimeStepsTable;
 
+  vtkvmtkVelocityTimeSeries* VelocityTimeSeries;
+
   int Periodic;
 
   double VelocityScale;
@@ -226,6 +326,18 @@ protected:
   char* Component2Prefix;
   int LastDataSetIndex;
 
+  int UseCellWalk;
+  int MaximumNumberOfWalkSteps;
+
+  double CellLocatorBuildTime;
+  vtkIdType NumberOfCachedCellHits;
+  vtkIdType NumberOfWalkHits;
+  vtkIdType NumberOfWalkSteps;
+  vtkIdType NumberOfLocatorSearches;
+  vtkIdType NumberOfLocatorMisses;
+
+  vtkvmtkStaticTemporalInterpolatedVelocityFieldInternals* Internals;
+
 #if VTK_MAJOR_VERSION > 9 || (VTK_MAJOR_VERSION == 9 && VTK_MINOR_VERSION >= 2)
   // The VTK 9.2 rework of the interpolated velocity fields removed the
   // GenCell/Cell scratch members from the base class; keep our own.
@@ -26,6 +26,13 @@ PURPOSE.  See the above copyright notice for more information.
 #include "vtkMath.h"
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
+#include "vtkPointSet.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkIntArray.h"
+#include "vtkUnstructuredGrid.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocal.h"
 #include "vtkSmartPointer.h"
 #include "vtkVersion.h"
 
@@ -33,10 +40,15 @@ PURPOSE.  See the above copyright notice for more information.
 // which replaced vtkInterpolatedVelocityField in the VTK 9.2 rework)
 #include "vtkvmtkStaticTemporalInterpolatedVelocityField.h"
 
+#include "vtkvmtkVelocityTimeSeries.h"
 #include "vtkTable.h"
 
+#include <algorithm>
+#include <vector>
+
 vtkStandardNewMacro(vtkvmtkStaticTemporalStreamTracer);
 vtkCxxSetObjectMacro(vtkvmtkStaticTemporalStreamTracer, TimeStepsTable, vtkTable);
+vtkCxxSetObjectMacro(vtkvmtkStaticTemporalStreamTracer, VelocityTimeSeries, vtkvmtkVelocityTimeSeries);
 
 #if VMTK_USE_LEGACY_INTERVAL_INFORMATION
   #define vmtkIntervalInformation IntervalInformation
@@ -51,11 +63,21 @@ vtkvmtkStaticTemporalStreamTracer::vtkvmtkStaticTemporalStreamTracer()
   this->Periodic = 0;
   this->VelocityScale = 1.0;
   this->TimeStepsTable = NULL;
+  this->VelocityTimeSeries = NULL;
   this->UseVectorComponents = 0;
   this->VectorPrefix = NULL;
   this->Component0Prefix = NULL;
   this->Component1Prefix = NULL;
   this->Component2Prefix = NULL;
+  this->UseMultithreading = 0;
+  this->SeedBatchSize = 64;
+  this->UseCellWalk = 0;
+  this->CellLocatorBuildTime = 0.0;
+  this->NumberOfCachedCellHits = 0;
+  this->NumberOfWalkHits = 0;
+  this->NumberOfWalkSteps = 0;
+  this->NumberOfLocatorSearches = 0;
+  this->NumberOfLocatorMisses = 0;
 }
 
 vtkvmtkStaticTemporalStreamTracer::~vtkvmtkStaticTemporalStreamTracer()
@@ -86,6 +108,7 @@ vtkvmtkStaticTemporalStreamTracer::~vtkvmtkStaticTemporalStreamTracer()
   }
 
   this->SetTimeStepsTable(NULL);
+  this->SetVelocityTimeSeries(NULL);
 }
 
 void vtkvmtkStaticTemporalStreamTracer::InitializeDefaultInterpolatorPrototype()
@@ -98,8 +121,10 @@ void vtkvmtkStaticTemporalStreamTracer::InitializeDefaultInterpolatorPrototype()
   staticTemporalInterpolator->SetComponent1Prefix(this->Component1Prefix);
   staticTemporalInterpolator->SetComponent2Prefix(this->Component2Prefix);
   staticTemporalInterpolator->SetTimeStepsTable(this->TimeStepsTable);
+  staticTemporalInterpolator->SetVelocityTimeSeries(this->VelocityTimeSeries);
   staticTemporalInterpolator->SetPeriodic(this->Periodic);
   staticTemporalInterpolator->SetVelocityScale(this->VelocityScale);
+  staticTemporalInterpolator->SetUseCellWalk(this->UseCellWalk);
 
   this->SetInterpolatorPrototype(staticTemporalInterpolator);
 
@@ -299,7 +324,389 @@ int vtkvmtkStaticTemporalStreamTracer::RequestData(
   return 1;
 }
 
-void vtkvmtkStaticTemporalStreamTracer::Integrate(vtkDataSet *input0,
+// The lines traced from a range of consecutive seeds, buffered until
+// they are appended to the output.
+class vtkvmtkStaticTemporalStreamTracerLines
+{
+public:
+  vtkvmtkStaticTemporalStreamTracerLines()
+  {
+    this->LastPoint[0] = this->LastPoint[1] = this->LastPoint[2] = 0.0;
+    this->HasLastPoint = 0;
+    this->LastUsedStepSize = 0.0;
+    this->HasLastUsedStepSize = 0;
+    this->Propagation = 0.0;
+    this->NumberOfSteps = 0;
+    this->Aborted = 0;
+  }
+
+  std::vector<double> Points;
+  std::vector<double> Times;
+  std::vector<double> Velocities;
+  std::vector<double> Speeds;
+  std::vector<double> Vorticities;
+  std::vector<double> Rotations;
+  std::vector<double> AngularVelocities;
+
+  // number of points and reason for termination of every traced seed
+  std::vector<vtkIdType> LinePointCounts;
+  std::vector<int> ReasonsForTermination;
+
+  double LastPoint[3];
+  int HasLastPoint;
+  double LastUsedStepSize;
+  int HasLastUsedStepSize;
+  double Propagation;
+  vtkIdType NumberOfSteps;
+  int Aborted;
+};
+
+// The integration state of a line, kept by AdvanceLine when it leaves a
+// window of time steps so that it can be resumed, possibly on another copy
+// of the velocity field, and the buffer of its points.
+class vtkvmtkStaticTemporalStreamTracerLineState
+{
+public:
+  enum
+  {
+    LINE_FINISHED,
+    LINE_SUSPENDED,
+    LINE_ABORTED
+  };
+
+  vtkvmtkStaticTemporalStreamTracerLineState()
+  {
+    this->Line = -1;
+    this->Direction = 1;
+    this->Point1[0] = this->Point1[1] = this->Point1[2] = 0.0;
+    this->Velocity[0] = this->Velocity[1] = this->Velocity[2] = 0.0;
+    this->AccumTime = 0.0;
+    this->Speed = 0.0;
+    this->CellLength = 0.0;
+    this->StepSize = 0.0;
+    this->MinStep = 0.0;
+    this->MaxStep = 0.0;
+    this->Propagation = 0.0;
+    this->NumberOfSteps = 0;
+    this->NumberOfPoints = 0;
+    this->ReasonForTermination = 0;
+    this->LastCellId = -1;
+    this->LastDataSetIndex = 0;
+    this->TimeRow = 0;
+    this->Status = LINE_SUSPENDED;
+  }
+
+  void StoreLastCell(vtkvmtkStaticTemporalInterpolatedVelocityField* func)
+  {
+    this->LastCellId = func->GetLastCellId();
+    this->LastDataSetIndex = func->GetLastDataSetIndex();
+  }
+
+  void RestoreLastCell(vtkvmtkStaticTemporalInterpolatedVelocityField* func)
+  {
+    func->SetLastCellId(this->LastCellId,this->LastDataSetIndex);
+  }
+
+  // record the number of points and the reason for termination of a line
+  void Finish(vtkvmtkStaticTemporalStreamTracerLines* lines)
+  {
+    lines->LinePointCounts.push_back(this->NumberOfPoints);
+    lines->ReasonsForTermination.push_back(this->ReasonForTermination);
+    lines->Propagation = this->Propagation;
+    lines->NumberOfSteps = this->NumberOfSteps;
+  }
+
+  vtkIdType Line;
+  int Direction;
+  double Point1[3];
+  double Velocity[3];
+  double AccumTime;
+  double Speed;
+  double CellLength;
+  double StepSize;
+  double MinStep;
+  double MaxStep;
+  double Propagation;
+  vtkIdType NumberOfSteps;
+  vtkIdType NumberOfPoints;
+  int ReasonForTermination;
+  vtkIdType LastCellId;
+  int LastDataSetIndex;
+  int TimeRow;
+  int Status;
+
+  vtkvmtkStaticTemporalStreamTracerLines Lines;
+};
+
+class vtkvmtkStaticTemporalStreamTracerThreadData
+{
+public:
+  vtkvmtkStaticTemporalStreamTracerThreadData()
+  {
+    this->Function = NULL;
+    this->Integrator = NULL;
+    this->Cell = NULL;
+  }
+
+  // every thread integrates with its own copy of the velocity field, so
+  // that the cached cell of one pathline is not overwritten by another
+  void Initialize(vtkAbstractInterpolatedVelocityField* function,
+                  vtkInitialValueProblemSolver* integrator,
+                  const std::vector<vtkDataSet*>& dataSets,
+                  int maxCellSize)
+  {
+    this->Function = function->NewInstance();
+    this->Function->CopyParameters(function);
+    for (size_t i=0; i<dataSets.size(); i++)
+      {
+      VMTK_STIVF_SUPERCLASS::SafeDownCast(this->Function)->AddDataSet(dataSets[i]);
+      }
+    this->Integrator = integrator->NewInstance();
+    this->Integrator->SetFunctionSet(this->Function);
+    this->Cell = vtkGenericCell::New();
+    this->Weights.resize(maxCellSize > 0 ? maxCellSize : 1);
+  }
+
+  void Release()
+  {
+    this->Integrator->Delete();
+    this->Function->Delete();
+    this->Cell->Delete();
+    this->Function = NULL;
+    this->Integrator = NULL;
+    this->Cell = NULL;
+  }
+
+  vtkAbstractInterpolatedVelocityField* Function;
+  vtkInitialValueProblemSolver* Integrator;
+  vtkGenericCell* Cell;
+  std::vector<double> Weights;
+};
+
+class vtkvmtkStaticTemporalStreamTracerFunctor
+{
+public:
+  vtkvmtkStaticTemporalStreamTracer* Tracer;
+  vtkAbstractInterpolatedVelocityField* Function;
+  const std::vector<vtkDataSet*>* DataSets;
+  int MaxCellSize;
+  vtkDataArray* SeedSource;
+  vtkIdList* SeedIds;
+  vtkDoubleArray* StartTimes;
+  vtkIntArray* IntegrationDirections;
+  vtkIdType NumberOfLines;
+  vtkIdType BatchSize;
+  double Propagation;
+  vtkIdType NumberOfSteps;
+  std::vector<vtkvmtkStaticTemporalStreamTracerLines>* Batches;
+
+  vtkSMPThreadLocal<vtkvmtkStaticTemporalStreamTracerThreadData> ThreadData;
+
+  void Initialize()
+    {
+    this->ThreadData.Local().Initialize(this->Function,this->Tracer->GetIntegrator(),*this->DataSets,this->MaxCellSize);
+    }
+
+  void operator()(vtkIdType batchBegin, vtkIdType batchEnd)
+    {
+    vtkvmtkStaticTemporalStreamTracerThreadData& data = this->ThreadData.Local();
+    for (vtkIdType batch=batchBegin; batch<batchEnd; batch++)
+      {
+      vtkvmtkStaticTemporalStreamTracerLines& lines = (*this->Batches)[batch];
+      if (this->Tracer->GetAbortExecute())
+        {
+        lines.Aborted = 1;
+        continue;
+        }
+      vtkIdType beginLine = batch * this->BatchSize;
+      vtkIdType endLine = std::min(beginLine + this->BatchSize, this->NumberOfLines);
+      this->Tracer->IntegrateSeeds(beginLine,endLine,this->NumberOfLines,
+                                   this->SeedSource,this->SeedIds,this->StartTimes,this->IntegrationDirections,
+                                   data.Function,data.Integrator,data.Cell,&data.Weights[0],
+                                   batch == 0 ? this->Propagation : 0.0,
+                                   batch == 0 ? this->NumberOfSteps : 0,
+                                   0,&lines);
+      }
+    }
+
+  void Reduce()
+    {
+    for (vtkSMPThreadLocal<vtkvmtkStaticTemporalStreamTracerThreadData>::iterator it = this->ThreadData.begin(); it != this->ThreadData.end(); ++it)
+      {
+      if (it->Function)
+        {
+        this->Tracer->AddLocationStatistics(it->Function);
+        it->Release();
+        }
+      }
+    }
+};
+
+// Advances the lines of a window of time steps in parallel. The copies of
+// the velocity field of the threads are kept from one window to the next,
+// and released by Release after the last one.
+class vtkvmtkStaticTemporalStreamTracerWindowFunctor
+{
+public:
+  vtkvmtkStaticTemporalStreamTracer* Tracer;
+  vtkAbstractInterpolatedVelocityField* Function;
+  const std::vector<vtkDataSet*>* DataSets;
+  int MaxCellSize;
+  vtkIdType NumberOfLines;
+  std::vector<vtkvmtkStaticTemporalStreamTracerLineState>* States;
+  const std::vector<vtkIdType>* WindowLines;
+  int FirstRow;
+  int LastRow;
+
+  vtkSMPThreadLocal<vtkvmtkStaticTemporalStreamTracerThreadData> ThreadData;
+
+  void Initialize()
+    {
+    vtkvmtkStaticTemporalStreamTracerThreadData& data = this->ThreadData.Local();
+    if (!data.Function)
+      {
+      data.Initialize(this->Function,this->Tracer->GetIntegrator(),*this->DataSets,this->MaxCellSize);
+      }
+    }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    vtkvmtkStaticTemporalStreamTracerThreadData& data = this->ThreadData.Local();
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      vtkvmtkStaticTemporalStreamTracerLineState& state = (*this->States)[(*this->WindowLines)[i]];
+      state.Status = this->Tracer->AdvanceLine(state,this->NumberOfLines,
+                                               data.Function,data.Integrator,data.Cell,&data.Weights[0],
+                                               this->FirstRow,this->LastRow,0,&state.Lines);
+      }
+    }
+
+  void Reduce()
+    {
+    }
+
+  void Release()
+    {
+    for (vtkSMPThreadLocal<vtkvmtkStaticTemporalStreamTracerThreadData>::iterator it = this->ThreadData.begin(); it != this->ThreadData.end(); ++it)
+      {
+      if (it->Function)
+        {
+        this->Tracer->AddLocationStatistics(it->Function);
+        it->Release();
+        }
+      }
+    }
+};
+
+// The output polylines and point data, grown as the batches of lines are
+// appended in seed order, so that each batch can be released once appended.
+class vtkvmtkStaticTemporalStreamTracerOutput
+{
+public:
+  vtkvmtkStaticTemporalStreamTracerOutput(int computeVorticity)
+  {
+    this->Points = vtkSmartPointer<vtkPoints>::New();
+    this->Lines = vtkSmartPointer<vtkCellArray>::New();
+
+    // We will keep track of integration time in this array
+    this->Time = vtkSmartPointer<vtkDoubleArray>::New();
+    this->Time->SetName("IntegrationTime");
+
+    // This array explains why the integration stopped
+    this->ReasonsForTermination = vtkSmartPointer<vtkIntArray>::New();
+    this->ReasonsForTermination->SetName("ReasonForTermination");
+
+    this->Velocity = vtkSmartPointer<vtkDoubleArray>::New();
+    this->Velocity->SetName("Velocity");
+    this->Velocity->SetNumberOfComponents(3);
+
+    this->Speed = vtkSmartPointer<vtkDoubleArray>::New();
+    this->Speed->SetName("Speed");
+
+    if (computeVorticity)
+      {
+      this->Vorticity = vtkSmartPointer<vtkDoubleArray>::New();
+      this->Vorticity->SetName("Vorticity");
+      this->Vorticity->SetNumberOfComponents(3);
+
+      this->Rotation = vtkSmartPointer<vtkDoubleArray>::New();
+      this->Rotation->SetName("Rotation");
+
+      this->AngularVelocity = vtkSmartPointer<vtkDoubleArray>::New();
+      this->AngularVelocity->SetName("AngularVelocity");
+      }
+  }
+
+  void Append(const vtkvmtkStaticTemporalStreamTracerLines& lines)
+  {
+    vtkIdType i;
+    vtkIdType pointId = this->Points->GetNumberOfPoints();
+    vtkIdType numBatchPts = static_cast<vtkIdType>(lines.Times.size());
+    for (i=0; i<numBatchPts; i++)
+      {
+      this->Points->InsertNextPoint(&lines.Points[3*i]);
+      this->Time->InsertNextValue(lines.Times[i]);
+      this->Velocity->InsertNextTuple(&lines.Velocities[3*i]);
+      this->Speed->InsertNextValue(lines.Speeds[i]);
+      if (this->Vorticity)
+        {
+        this->Vorticity->InsertNextTuple(&lines.Vorticities[3*i]);
+        this->Rotation->InsertNextValue(lines.Rotations[i]);
+        this->AngularVelocity->InsertNextValue(lines.AngularVelocities[i]);
+        }
+      }
+    for (size_t line=0; line<lines.LinePointCounts.size(); line++)
+      {
+      vtkIdType numPts = lines.LinePointCounts[line];
+      if (numPts > 1)
+        {
+        this->Lines->InsertNextCell(numPts);
+        for (i=pointId; i<pointId+numPts; i++)
+          {
+          this->Lines->InsertCellPoint(i);
+          }
+        this->ReasonsForTermination->InsertNextValue(lines.ReasonsForTermination[line]);
+        }
+      pointId += numPts;
+      }
+  }
+
+  vtkSmartPointer<vtkPoints> Points;
+  vtkSmartPointer<vtkCellArray> Lines;
+  vtkSmartPointer<vtkDoubleArray> Time;
+  vtkSmartPointer<vtkIntArray> ReasonsForTermination;
+  vtkSmartPointer<vtkDoubleArray> Velocity;
+  vtkSmartPointer<vtkDoubleArray> Speed;
+  vtkSmartPointer<vtkDoubleArray> Vorticity;
+  vtkSmartPointer<vtkDoubleArray> Rotation;
+  vtkSmartPointer<vtkDoubleArray> AngularVelocity;
+};
+
+void vtkvmtkStaticTemporalStreamTracer::AppendLines(vtkvmtkStaticTemporalStreamTracerLines& lines,
+                                                    vtkvmtkStaticTemporalStreamTracerOutput& output,
+                                                    double lastPoint[3],
+                                                    double& inPropagation,
+                                                    vtkIdType& inNumSteps)
+{
+  output.Append(lines);
+  if (lines.HasLastPoint)
+    {
+    memcpy(lastPoint, lines.LastPoint, 3*sizeof(double));
+    }
+  if (lines.HasLastUsedStepSize)
+    {
+    this->LastUsedStepSize = lines.LastUsedStepSize;
+    }
+  if (!lines.LinePointCounts.empty())
+    {
+    inPropagation = lines.Propagation;
+    inNumSteps = lines.NumberOfSteps;
+    }
+  // release the buffers
+  lines = vtkvmtkStaticTemporalStreamTracerLines();
+}
+
+void vtkvmtkStaticTemporalStreamTracer::Integrate(vtkDataSet *vtkNotUsed(input0),
                                                   vtkPolyData* output,
                                                   vtkDataArray* seedSource,
                                                   vtkIdList* seedIds,
@@ -311,503 +718,825 @@ void vtkvmtkStaticTemporalStreamTracer::Integrate(vtkDataSet *input0,
                                                   double& inPropagation,
                                                   vtkIdType& inNumSteps)
 {
-  int i;
   vtkIdType numLines = seedIds->GetNumberOfIds();
-  double propagation = inPropagation;
-  vtkIdType numSteps = inNumSteps;
 
   // Useful pointers
   vtkDataSetAttributes* outputPD = output->GetPointData();
   vtkDataSetAttributes* outputCD = output->GetCellData();
-  vtkPointData* inputPD;
-  vtkDataSet* input;
-  //TODO: this one will potentially change at every evaluation.
 
-  int direction=1;
+  if (this->GetIntegrator() == 0)
+    {
+    vtkErrorMacro("No integrator is specified.");
+    return;
+    }
+
+  vtkvmtkStaticTemporalStreamTracerOutput lineOutput(this->ComputeVorticity);
 
-  double* weights = 0;
-  if ( maxCellSize > 0 )
+  this->CellLocatorBuildTime = 0.0;
+  this->NumberOfCachedCellHits = 0;
+  this->NumberOfWalkHits = 0;
+  this->NumberOfWalkSteps = 0;
+  this->NumberOfLocatorSearches = 0;
+  this->NumberOfLocatorMisses = 0;
+
+  vtkvmtkStaticTemporalInterpolatedVelocityField* temporalFunc =
+    vtkvmtkStaticTemporalInterpolatedVelocityField::SafeDownCast(func);
+  if (temporalFunc)
     {
-    weights = new double[maxCellSize];
+    temporalFunc->ResetLocationStatistics();
     }
 
-  if (this->GetIntegrator() == 0)
+  vtkIdType batchSize = this->SeedBatchSize;
+  vtkIdType numBatches = (numLines + batchSize - 1) / batchSize;
+  int aborted = 0;
+
+  vtkvmtkVelocityTimeSeries* series = temporalFunc ? temporalFunc->GetVelocityTimeSeries() : NULL;
+  int parallel = this->UseMultithreading && numLines > 1;
+
+  // A window of time steps, together with the time step that the last
+  // integration step of a line leaving it reaches into, must fit in the
+  // cache of the series
+  int windowSize = series ? series->GetMaximumNumberOfCachedTimeSteps() - 2 : 0;
+
+  std::vector<vtkDataSet*> datasets;
+  if (parallel)
     {
-    vtkErrorMacro("No integrator is specified.");
-    return;
+    // Point locators, bounds and cell links are built on first use, which
+    // is not thread safe: build them before the threads search the datasets.
+    vtkCompositeDataIterator* iter = this->InputData->NewIterator();
+    vtkSmartPointer<vtkCompositeDataIterator> iterP(iter);
+    iter->Delete();
+    for (iterP->GoToFirstItem(); !iterP->IsDoneWithTraversal(); iterP->GoToNextItem())
+      {
+      vtkDataSet* inp = vtkDataSet::SafeDownCast(iterP->GetCurrentDataObject());
+      if (!inp)
+        {
+        continue;
+        }
+      inp->GetLength();
+      vtkPointSet* pointSet = vtkPointSet::SafeDownCast(inp);
+      if (pointSet && pointSet->GetNumberOfPoints() > 0)
+        {
+        pointSet->BuildLocator();
+        }
+      // FindCell gets the cells using a point through the cell links
+      vtkUnstructuredGrid* grid = vtkUnstructuredGrid::SafeDownCast(inp);
+      if (grid && grid->GetNumberOfCells() > 0)
+        {
+        grid->BuildLinks();
+        }
+      vtkPolyData* polyData = vtkPolyData::SafeDownCast(inp);
+      if (polyData && polyData->GetNumberOfCells() > 0)
+        {
+        polyData->BuildLinks();
+        }
+      datasets.push_back(inp);
+      }
+
+    // the threads share the cell locators of func
+    if (temporalFunc && this->UseCellWalk)
+      {
+      temporalFunc->BuildCellLocators();
+      }
     }
 
-  // Used in GetCell()
-  vtkGenericCell* cell = vtkGenericCell::New();
+  if (windowSize > 0)
+    {
+    // The time steps of a series are read into a cache of a few of them.
+    // Rather than tracing each line through all its time steps in turn, which
+    // would read them all again for every line, the lines of a batch are
+    // traced together through windows of time steps that fit in the cache,
+    // so that every time step is read about once per batch. The copies of
+    // the velocity field of the threads share the cache of the series.
+    double* weights = 0;
+    if ( maxCellSize > 0 )
+      {
+      weights = new double[maxCellSize];
+      }
+    vtkGenericCell* cell = vtkGenericCell::New();
+    vtkInitialValueProblemSolver* integrator =
+      this->GetIntegrator()->NewInstance();
+    integrator->SetFunctionSet(func);
+
+    vtkvmtkStaticTemporalStreamTracerWindowFunctor functor;
+    functor.Tracer = this;
+    functor.Function = func;
+    functor.DataSets = &datasets;
+    functor.MaxCellSize = maxCellSize;
+    functor.NumberOfLines = numLines;
+
+    for (vtkIdType batch=0; batch<numBatches && !aborted; batch++)
+      {
+      vtkIdType beginLine = batch * batchSize;
+      vtkIdType endLine = std::min(beginLine + batchSize, numLines);
+      std::vector<vtkvmtkStaticTemporalStreamTracerLineState> states(endLine - beginLine);
+      std::vector<vtkIdType> activeLines;
+
+      // Start the lines in seed order, passing propagation and number of
+      // steps on as IntegrateSeeds does
+      double propagation = batch == 0 ? inPropagation : 0.0;
+      vtkIdType numSteps = batch == 0 ? inNumSteps : 0;
+      vtkIdType i;
+      for (i=0; i<endLine-beginLine; i++)
+        {
+        vtkvmtkStaticTemporalStreamTracerLineState& state = states[i];
+        if (this->StartLine(beginLine+i,seedSource,seedIds,startTimes,integrationDirections,
+                            func,cell,weights,propagation,numSteps,state,&state.Lines))
+          {
+          state.StoreLastCell(temporalFunc);
+          activeLines.push_back(i);
+          propagation = 0;
+          numSteps = 0;
+          }
+        }
+
+      while (!activeLines.empty() && !aborted)
+        {
+        // the window starts at the earliest time step of the lines
+        int firstRow = VTK_INT_MAX;
+        for (i=0; i<static_cast<vtkIdType>(activeLines.size()); i++)
+          {
+          vtkvmtkStaticTemporalStreamTracerLineState& state = states[activeLines[i]];
+          state.TimeRow = temporalFunc->FindTimeRow(state.AccumTime);
+          firstRow = std::min(firstRow,state.TimeRow);
+          }
+        int lastRow = firstRow + windowSize - 1;
+
+        std::vector<vtkIdType> windowLines;
+        std::vector<vtkIdType> waitingLines;
+        for (i=0; i<static_cast<vtkIdType>(activeLines.size()); i++)
+          {
+          if (states[activeLines[i]].TimeRow <= lastRow)
+            {
+            windowLines.push_back(activeLines[i]);
+            }
+          else
+            {
+            waitingLines.push_back(activeLines[i]);
+            }
+          }
+
+        if (parallel)
+          {
+          functor.States = &states;
+          functor.WindowLines = &windowLines;
+          functor.FirstRow = firstRow;
+          functor.LastRow = lastRow;
+          vtkSMPTools::For(0,static_cast<vtkIdType>(windowLines.size()),1,functor);
+          }
+        else
+          {
+          for (i=0; i<static_cast<vtkIdType>(windowLines.size()); i++)
+            {
+            vtkvmtkStaticTemporalStreamTracerLineState& state = states[windowLines[i]];
+            state.Status = this->AdvanceLine(state,numLines,func,integrator,cell,weights,
+                                             firstRow,lastRow,0,&state.Lines);
+            }
+          }
+
+        activeLines.swap(waitingLines);
+        for (i=0; i<static_cast<vtkIdType>(windowLines.size()); i++)
+          {
+          vtkvmtkStaticTemporalStreamTracerLineState& state = states[windowLines[i]];
+          switch (state.Status)
+            {
+            case vtkvmtkStaticTemporalStreamTracerLineState::LINE_FINISHED:
+              state.Finish(&state.Lines);
+              break;
+            case vtkvmtkStaticTemporalStreamTracerLineState::LINE_SUSPENDED:
+              activeLines.push_back(windowLines[i]);
+              break;
+            default:
+              aborted = 1;
+              break;
+            }
+          }
+
+        this->UpdateProgress(static_cast<double>(endLine - static_cast<vtkIdType>(activeLines.size())) / numLines);
+        aborted = aborted || this->GetAbortExecute();
+        }
 
-  // Create a new integrator, the type is the same as Integrator
-  vtkInitialValueProblemSolver* integrator =
-    this->GetIntegrator()->NewInstance();
-  integrator->SetFunctionSet(func);
+      if (!aborted)
+        {
+        for (i=0; i<endLine-beginLine; i++)
+          {
+          this->AppendLines(states[i].Lines,lineOutput,lastPoint,inPropagation,inNumSteps);
+          }
+        }
+      }
 
-  // Since we do not know what the total number of points
-  // will be, we do not allocate any. This is important for
-  // cases where a lot of streamers are used at once. If we
-  // were to allocate any points here, potentially, we can
-  // waste a lot of memory if a lot of streamers are used.
-  // Always insert the first point
-  vtkPoints* outputPoints = vtkPoints::New();
-  vtkCellArray* outputLines = vtkCellArray::New();
+    functor.Release();
+    integrator->Delete();
+    cell->Delete();
 
-  // We will keep track of integration time in this array
-  vtkDoubleArray* time = vtkDoubleArray::New();
-  time->SetName("IntegrationTime");
+    delete[] weights;
+    }
+  else if (!parallel)
+    {
+    double* weights = 0;
+    if ( maxCellSize > 0 )
+      {
+      weights = new double[maxCellSize];
+      }
 
-  // This array explains why the integration stopped
-  vtkIntArray* retVals = vtkIntArray::New();
-  retVals->SetName("ReasonForTermination");
+    // Used in GetCell()
+    vtkGenericCell* cell = vtkGenericCell::New();
 
-  vtkDoubleArray* cellVectors = 0;
-  vtkDoubleArray* velocityArray = 0;
-  vtkDoubleArray* speedArray = 0;
-  vtkDoubleArray* vorticity = 0;
-  vtkDoubleArray* rotation = 0;
-  vtkDoubleArray* angularVel = 0;
+    // Create a new integrator, the type is the same as Integrator
+    vtkInitialValueProblemSolver* integrator =
+      this->GetIntegrator()->NewInstance();
+    integrator->SetFunctionSet(func);
 
-  velocityArray = vtkDoubleArray::New();
-  velocityArray->SetName("Velocity");
-  velocityArray->SetNumberOfComponents(3);
+    // one batch at a time, appended as soon as it is traced, so that the
+    // lines are buffered only once
+    vtkvmtkStaticTemporalStreamTracerLines lines;
+    for (vtkIdType batch=0; batch<numBatches && !aborted; batch++)
+      {
+      vtkIdType beginLine = batch * batchSize;
+      vtkIdType endLine = std::min(beginLine + batchSize, numLines);
+      this->IntegrateSeeds(beginLine,endLine,numLines,
+                           seedSource,seedIds,startTimes,integrationDirections,
+                           func,integrator,cell,weights,
+                           batch == 0 ? inPropagation : 0.0,
+                           batch == 0 ? inNumSteps : 0,
+                           1,&lines);
+      aborted = lines.Aborted;
+      if (!aborted)
+        {
+        this->AppendLines(lines,lineOutput,lastPoint,inPropagation,inNumSteps);
+        }
+      }
 
-  speedArray = vtkDoubleArray::New();
-  speedArray->SetName("Speed");
+    integrator->Delete();
+    cell->Delete();
 
-  if (this->ComputeVorticity)
+    delete[] weights;
+    }
+  else
+    {
+    std::vector<vtkvmtkStaticTemporalStreamTracerLines> batches(numBatches);
+
+    vtkvmtkStaticTemporalStreamTracerFunctor functor;
+    functor.Tracer = this;
+    functor.Function = func;
+    functor.DataSets = &datasets;
+    functor.MaxCellSize = maxCellSize;
+    functor.SeedSource = seedSource;
+    functor.SeedIds = seedIds;
+    functor.StartTimes = startTimes;
+    functor.IntegrationDirections = integrationDirections;
+    functor.NumberOfLines = numLines;
+    functor.BatchSize = batchSize;
+    functor.Propagation = inPropagation;
+    functor.NumberOfSteps = inNumSteps;
+    functor.Batches = &batches;
+
+    // batches are handed out one at a time, so that threads that finish
+    // short pathlines take over the remaining batches
+    vtkSMPTools::For(0,numBatches,1,functor);
+
+    // Append the lines in seed order, releasing each batch once appended
+    for (size_t batch=0; batch<batches.size() && !aborted; batch++)
+      {
+      aborted = batches[batch].Aborted;
+      if (!aborted)
+        {
+        this->AppendLines(batches[batch],lineOutput,lastPoint,inPropagation,inNumSteps);
+        }
+      }
+    }
+
+  this->AddLocationStatistics(func);
+  vtkDebugMacro("Cell locator build time: " << this->CellLocatorBuildTime
+                << ", cached cell hits: " << this->NumberOfCachedCellHits
+                << ", walk hits: " << this->NumberOfWalkHits
+                << ", walk steps: " << this->NumberOfWalkSteps
+                << ", locator searches: " << this->NumberOfLocatorSearches
+                << ", locator misses: " << this->NumberOfLocatorMisses);
+
+  if (aborted)
     {
-    cellVectors = vtkDoubleArray::New();
-    cellVectors->SetNumberOfComponents(3);
-    cellVectors->Allocate(3*VTK_CELL_SIZE);
+    output->Squeeze();
+    return;
+    }
 
-    vorticity = vtkDoubleArray::New();
-    vorticity->SetName("Vorticity");
-    vorticity->SetNumberOfComponents(3);
+  // Create the output polyline
+  output->SetPoints(lineOutput.Points);
+  outputPD->AddArray(lineOutput.Time);
+  outputPD->AddArray(lineOutput.Velocity);
+  outputPD->AddArray(lineOutput.Speed);
+  if (lineOutput.Vorticity)
+    {
+    outputPD->AddArray(lineOutput.Vorticity);
+    outputPD->AddArray(lineOutput.Rotation);
+    outputPD->AddArray(lineOutput.AngularVelocity);
+    }
 
-    rotation = vtkDoubleArray::New();
-    rotation->SetName("Rotation");
+  if ( lineOutput.Points->GetNumberOfPoints() > 1 )
+    {
+    // Assign geometry and attributes
+    output->SetLines(lineOutput.Lines);
+    if (this->GenerateNormalsInIntegrate)
+      {
+      ////////////////////////////// TODO //////////////////////////////
+      //this->GenerateNormals(output, 0, vecName);
+      }
 
-    angularVel = vtkDoubleArray::New();
-    angularVel->SetName("AngularVelocity");
+    outputCD->AddArray(lineOutput.ReasonsForTermination);
     }
 
+  output->Squeeze();
+  return;
+}
+
+void vtkvmtkStaticTemporalStreamTracer::IntegrateSeeds(vtkIdType beginLine,
+                                                       vtkIdType endLine,
+                                                       vtkIdType numLines,
+                                                       vtkDataArray* seedSource,
+                                                       vtkIdList* seedIds,
+                                                       vtkDoubleArray* startTimes,
+                                                       vtkIntArray* integrationDirections,
+                                                       vtkAbstractInterpolatedVelocityField* func,
+                                                       vtkInitialValueProblemSolver* integrator,
+                                                       vtkGenericCell* cell,
+                                                       double* weights,
+                                                       double propagation,
+                                                       vtkIdType numSteps,
+                                                       int reportProgress,
+                                                       vtkvmtkStaticTemporalStreamTracerLines* lines)
+{
   // We will interpolate all point attributes of the input on each point of
   // the output (unless they are turned off). Note that we are using only
   // the first input, if there are more than one, the attributes have to match.
-  //
-  // Note: We have to use a specific value (safe to employ the maximum number
-  //       of steps) as the size of the initial memory allocation here. The
-  //       use of the default argument might incur a crash problem (due to
-  //       "insufficient memory") in the parallel mode. This is the case when
-  //       a streamline intensely shuttles between two processes in an exactly
-  //       interleaving fashion --- only one point is produced on each process
-  //       (and actually two points, after point duplication, are saved to a
-  //       vtkPolyData in vtkDistributedStreamTracer::NoBlockProcessTask) and
-  //       as a consequence a large number of such small vtkPolyData objects
-  //       are needed to represent a streamline, consuming up the memory before
-  //       the intermediate memory is timely released.
-
   // TODO: this one should be avoided - or at least we should interpolate all vectors that are not in the list of temporal vector fields
   //outputPD->InterpolateAllocate( input0->GetPointData(),
   //                               this->MaximumNumberOfSteps );
 
-  vtkIdType numPtsTotal=0;
-  double velocity[3];
-
-  int shouldAbort = 0;
-
-  for(int currentLine = 0; currentLine < numLines; currentLine++)
+  for(vtkIdType currentLine = beginLine; currentLine < endLine; currentLine++)
     {
     double progress = static_cast<double>(currentLine)/numLines;
-    this->UpdateProgress(progress);
+    if (reportProgress)
+      {
+      this->UpdateProgress(progress);
+      }
 
-    switch (integrationDirections->GetValue(currentLine))
+    vtkvmtkStaticTemporalStreamTracerLineState state;
+    if (!this->StartLine(currentLine,seedSource,seedIds,startTimes,integrationDirections,
+                         func,cell,weights,propagation,numSteps,state,lines))
       {
-      case FORWARD:
-        direction = 1;
-        break;
-      case BACKWARD:
-        direction = -1;
-        break;
+      continue;
       }
 
-    // temporary variables used in the integration
-    double point1[3], point2[3], pcoords[3], vort[3], omega;
-    vtkIdType index, numPts=0;
+    if (this->AdvanceLine(state,numLines,func,integrator,cell,weights,-1,-1,reportProgress,lines) ==
+        vtkvmtkStaticTemporalStreamTracerLineState::LINE_ABORTED)
+      {
+      lines->Aborted = 1;
+      break;
+      }
+
+    state.Finish(lines);
+
+    // Initialize these to 0 before starting the next line.
+    // The values passed in the function call are only used
+    // for the first line.
+    propagation = 0;
+    numSteps = 0;
+    }
+}
+
+int vtkvmtkStaticTemporalStreamTracer::StartLine(vtkIdType currentLine,
+                                                 vtkDataArray* seedSource,
+                                                 vtkIdList* seedIds,
+                                                 vtkDoubleArray* startTimes,
+                                                 vtkIntArray* integrationDirections,
+                                                 vtkAbstractInterpolatedVelocityField* func,
+                                                 vtkGenericCell* cell,
+                                                 double* weights,
+                                                 double propagation,
+                                                 vtkIdType numSteps,
+                                                 vtkvmtkStaticTemporalStreamTracerLineState& state,
+                                                 vtkvmtkStaticTemporalStreamTracerLines* lines)
+{
+  vtkDataSet* input;
+  //TODO: this one will potentially change at every evaluation.
+
+  state.Line = currentLine;
+  state.Direction = 1;
+  switch (integrationDirections->GetValue(currentLine))
+    {
+    case FORWARD:
+      state.Direction = 1;
+      break;
+    case BACKWARD:
+      state.Direction = -1;
+      break;
+    }
+
+  // temporary variables used in the integration
+  double* point1 = state.Point1;
+  double* velocity = state.Velocity;
+  double pcoords[3], vort[3], omega;
+  state.NumberOfPoints = 0;
+
+  // Clear the last cell to avoid starting a search from
+  // the last point in the streamline
+  func->ClearLastCellId();
+
+  double startTime = startTimes->GetValue(currentLine);
+
+  // Initial point
+  seedSource->GetTuple(seedIds->GetId(currentLine), point1);
+
+  double point1t[4];
+  memcpy(point1t, point1, 3*sizeof(double)); 
+  point1t[3] = startTime;
 
-    // Clear the last cell to avoid starting a search from
-    // the last point in the streamline
-    func->ClearLastCellId();
+  if (!func->FunctionValues(point1t, velocity))
+    {
+    return 0;
+    }
 
-    double startTime = startTimes->GetValue(currentLine);
+  if ( propagation >= this->MaximumPropagation ||
+       numSteps    >  this->MaximumNumberOfSteps)
+    {
+    return 0;
+    }
 
-    // Initial point
-    seedSource->GetTuple(seedIds->GetId(currentLine), point1);
-    memcpy(point2, point1, 3*sizeof(double));
+  state.NumberOfPoints++;
+  lines->Points.insert(lines->Points.end(), point1, point1+3);
+
+  lines->Times.push_back(startTime);
+
+  // We will always pass an arc-length step size to the integrator.
+  // If the user specifies a step size in cell length unit, we will
+  // have to convert it to arc length.
+  state.StepSize = 0;  // either positive or negative
+  state.MinStep = 0;
+  state.MaxStep = 0;
+  state.AccumTime = startTime;
+  state.Propagation = propagation;
+  state.NumberOfSteps = numSteps;
+  state.ReasonForTermination = OUT_OF_LENGTH;
+
+  // Make sure we use the dataset found by the vtkAbstractInterpolatedVelocityField
+  input = func->GetLastDataSet();
+
+  // Convert intervals to arc-length unit
+  input->GetCell(func->GetLastCellId(), cell);
+  state.CellLength = sqrt(static_cast<double>(cell->GetLength2()));
+  double speed = vtkMath::Norm(velocity);
+  state.Speed = speed;
+  // Never call conversion methods if speed == 0
+  if ( speed != 0.0 )
+    {
+    this->ConvertIntervals( state.StepSize, state.MinStep, state.MaxStep,
+                            state.Direction, state.CellLength );
+    }
+
+  // Interpolate all point attributes on first point
+  func->GetLastWeights(weights);
+  //TODO: avoid this at least for time vectors
+  //outputPD->InterpolatePoint(inputPD, nextPoint, cell->PointIds, weights);
 
-    double point1t[4];
-    memcpy(point1t, point1, 3*sizeof(double)); 
-    point1t[3] = startTime;
+  lines->Velocities.insert(lines->Velocities.end(), velocity, velocity+3);
+  lines->Speeds.push_back(speed);
 
-    if (!func->FunctionValues(point1t, velocity))
+  // Compute vorticity if required
+  // This can be used later for streamribbon generation.
+  if (this->ComputeVorticity)
+    {
+    //TODO: for vorticity to work, inVectors should be updated with the vector field at the correct time step
+    //inVectors->GetTuples(cell->PointIds, cellVectors);
+    func->GetLastLocalCoordinates(pcoords);
+    vort[0] = vort[1] = vort[2] = 0.0;
+    //vtkStreamTracer::CalculateVorticity(cell, pcoords, cellVectors, vort);
+    lines->Vorticities.insert(lines->Vorticities.end(), vort, vort+3);
+    // rotation
+    // local rotation = vorticity . unit tangent ( i.e. velocity/speed )
+    if (speed != 0.0)
       {
-      continue;
+      omega = vtkMath::Dot(vort, velocity);
+      omega /= speed;
+      omega *= this->RotationScale;
       }
-
-    if ( propagation >= this->MaximumPropagation ||
-         numSteps    >  this->MaximumNumberOfSteps)
+    else
       {
-      continue;
+      omega = 0.0;
       }
+    lines->AngularVelocities.push_back(omega);
+    lines->Rotations.push_back(0.0);
+    }
 
-    numPts++;
-    numPtsTotal++;
-    vtkIdType nextPoint = outputPoints->InsertNextPoint(point1);
-
-    time->InsertNextValue(startTime);
-
-    // We will always pass an arc-length step size to the integrator.
-    // If the user specifies a step size in cell length unit, we will
-    // have to convert it to arc length.
-    vmtkIntervalInformation stepSize;  // either positive or negative
-    stepSize.Unit  = LENGTH_UNIT;
-    stepSize.Interval = 0;
-    vmtkIntervalInformation aStep; // always positive
-    aStep.Unit = LENGTH_UNIT;
-    double step, minStep=0, maxStep=0;
-    double stepTaken, accumTime=startTime;
-    double speed;
-    double cellLength;
-    int retVal=OUT_OF_LENGTH, tmp;
+  return 1;
+}
 
-    // Make sure we use the dataset found by the vtkAbstractInterpolatedVelocityField
-    input = func->GetLastDataSet();
-    inputPD = input->GetPointData();
+int vtkvmtkStaticTemporalStreamTracer::AdvanceLine(vtkvmtkStaticTemporalStreamTracerLineState& state,
+                                                   vtkIdType numLines,
+                                                   vtkAbstractInterpolatedVelocityField* func,
+                                                   vtkInitialValueProblemSolver* integrator,
+                                                   vtkGenericCell* cell,
+                                                   double* weights,
+                                                   int firstRow,
+                                                   int lastRow,
+                                                   int reportProgress,
+                                                   vtkvmtkStaticTemporalStreamTracerLines* lines)
+{
+  int i;
+  vtkDataSet* input;
 
-    // Convert intervals to arc-length unit
-    input->GetCell(func->GetLastCellId(), cell);
-    cellLength = sqrt(static_cast<double>(cell->GetLength2()));
-    speed = vtkMath::Norm(velocity);
-    // Never call conversion methods if speed == 0
-    if ( speed != 0.0 )
-      {
-      this->ConvertIntervals( stepSize.Interval, minStep, maxStep,
-                              direction, cellLength );
-      }
+  // Within a window of time steps, the line is located from the cell it was
+  // last found in, on whichever copy of the velocity field it resumes.
+  vtkvmtkStaticTemporalInterpolatedVelocityField* temporalFunc = NULL;
+  if (firstRow >= 0)
+    {
+    temporalFunc = vtkvmtkStaticTemporalInterpolatedVelocityField::SafeDownCast(func);
+    }
+  if (temporalFunc)
+    {
+    state.RestoreLastCell(temporalFunc);
+    }
 
-    // Interpolate all point attributes on first point
-    func->GetLastWeights(weights);
-    //TODO: avoid this at least for time vectors
-    //outputPD->InterpolatePoint(inputPD, nextPoint, cell->PointIds, weights);
+  vtkIdType currentLine = state.Line;
+  int direction = state.Direction;
+  double velocity[3];
+  memcpy(velocity, state.Velocity, 3*sizeof(double));
+
+  // temporary variables used in the integration
+  double point1[3], point2[3], pcoords[3], vort[3], omega;
+  memcpy(point1, state.Point1, 3*sizeof(double));
+  memcpy(point2, point1, 3*sizeof(double));
+  vtkIdType numPts = state.NumberOfPoints;
+  double propagation = state.Propagation;
+  vtkIdType numSteps = state.NumberOfSteps;
+  double progress;
+
+  vmtkIntervalInformation stepSize;  // either positive or negative
+  stepSize.Unit  = LENGTH_UNIT;
+  stepSize.Interval = state.StepSize;
+  vmtkIntervalInformation aStep; // always positive
+  aStep.Unit = LENGTH_UNIT;
+  double step, minStep=state.MinStep, maxStep=state.MaxStep;
+  double stepTaken, accumTime=state.AccumTime;
+  double speed = state.Speed;
+  double cellLength = state.CellLength;
+  int retVal=state.ReasonForTermination, tmp;
 
-    velocityArray->InsertNextTuple(velocity);
-    speedArray->InsertNextValue(speed);
+  int shouldAbort = 0;
+  int suspended = 0;
 
-    // Compute vorticity if required
-    // This can be used later for streamribbon generation.
-    if (this->ComputeVorticity)
+  double error = 0;
+  // Integrate until the maximum propagation length is reached,
+  // maximum number of steps is reached or until a boundary is encountered.
+  // Begin Integration
+  while ( propagation < this->MaximumPropagation )
+    {
+
+    // Leave the window when the line needs the time steps of another one
+    if (temporalFunc)
       {
-      //TODO: for vorticity to work, inVectors should be updated with the vector field at the correct time step
-      //inVectors->GetTuples(cell->PointIds, cellVectors);
-      func->GetLastLocalCoordinates(pcoords);
-      vort[0] = vort[1] = vort[2] = 0.0;
-      //vtkStreamTracer::CalculateVorticity(cell, pcoords, cellVectors, vort);
-      vorticity->InsertNextTuple(vort);
-      // rotation
-      // local rotation = vorticity . unit tangent ( i.e. velocity/speed )
-      if (speed != 0.0)
-        {
-        omega = vtkMath::Dot(vort, velocity);
-        omega /= speed;
-        omega *= this->RotationScale;
-        }
-      else
+      int row = temporalFunc->FindTimeRow(accumTime);
+      if (row < firstRow || row > lastRow)
         {
-        omega = 0.0;
+        suspended = 1;
+        break;
         }
-      angularVel->InsertNextValue(omega);
-      rotation->InsertNextValue(0.0);
       }
 
-    double error = 0;
-    // Integrate until the maximum propagation length is reached,
-    // maximum number of steps is reached or until a boundary is encountered.
-    // Begin Integration
-    while ( propagation < this->MaximumPropagation )
+    if (numSteps > this->MaximumNumberOfSteps)
       {
+      retVal = OUT_OF_STEPS;
+      break;
+      }
 
-      if (numSteps > this->MaximumNumberOfSteps)
-        {
-        retVal = OUT_OF_STEPS;
-        break;
-        }
-
-      if ( numSteps++ % 1000 == 1 )
+    if ( numSteps++ % 1000 == 1 )
+      {
+      if (reportProgress)
         {
         progress =
           ( currentLine + propagation / this->MaximumPropagation ) / numLines;
         this->UpdateProgress(progress);
-
-        if (this->GetAbortExecute())
-          {
-          shouldAbort = 1;
-          break;
-          }
         }
 
-      // Never call conversion methods if speed == 0
-      if ( (speed == 0) || (speed <= this->TerminalSpeed) )
+      if (this->GetAbortExecute())
         {
-        retVal = STAGNATION;
+        shouldAbort = 1;
         break;
         }
+      }
 
-      // If, with the next step, propagation will be larger than
-      // max, reduce it so that it is (approximately) equal to max.
-      aStep.Interval = fabs( stepSize.Interval );
+    // Never call conversion methods if speed == 0
+    if ( (speed == 0) || (speed <= this->TerminalSpeed) )
+      {
+      retVal = STAGNATION;
+      break;
+      }
+
+    // If, with the next step, propagation will be larger than
+    // max, reduce it so that it is (approximately) equal to max.
+    aStep.Interval = fabs( stepSize.Interval );
 
-      if ( ( propagation + aStep.Interval ) > this->MaximumPropagation )
+    if ( ( propagation + aStep.Interval ) > this->MaximumPropagation )
+      {
+      aStep.Interval = this->MaximumPropagation - propagation;
+      if ( stepSize.Interval >= 0 )
         {
-        aStep.Interval = this->MaximumPropagation - propagation;
-        if ( stepSize.Interval >= 0 )
-          {
 #if VMTK_USE_LEGACY_INTERVAL_INFORMATION
-          stepSize.Interval = this->ConvertToLength( aStep, cellLength );
+        stepSize.Interval = this->ConvertToLength( aStep, cellLength );
 #else
-          stepSize.Interval = vtkIntervalInformation::ConvertToLength(aStep, cellLength);
+        stepSize.Interval = vtkIntervalInformation::ConvertToLength(aStep, cellLength);
 #endif
-          }
-        else
-          {
+        }
+      else
+        {
 #if VMTK_USE_LEGACY_INTERVAL_INFORMATION
-          stepSize.Interval = this->ConvertToLength(aStep, cellLength) * (-1.0);
+        stepSize.Interval = this->ConvertToLength(aStep, cellLength) * (-1.0);
 #else
-          stepSize.Interval = vtkIntervalInformation::ConvertToLength(aStep, cellLength) * (-1.0);
+        stepSize.Interval = vtkIntervalInformation::ConvertToLength(aStep, cellLength) * (-1.0);
 #endif
-          }
-        maxStep = stepSize.Interval;
-        }
-      this->LastUsedStepSize = stepSize.Interval;
-
-      // Calculate the next step using the integrator provided
-      // Break if the next point is out of bounds.
-      func->SetNormalizeVector( true );
-      tmp = integrator->ComputeNextStep( point1, point2, accumTime, stepSize.Interval,
-                                         stepTaken, minStep, maxStep,
-                                         this->MaximumError, error );
-      func->SetNormalizeVector( false );
-      if ( tmp != 0 )
-        {
-        retVal = tmp;
-        memcpy(lastPoint, point2, 3*sizeof(double));
-        break;
         }
+      maxStep = stepSize.Interval;
+      }
+    lines->LastUsedStepSize = stepSize.Interval;
+    lines->HasLastUsedStepSize = 1;
+
+    // Calculate the next step using the integrator provided
+    // Break if the next point is out of bounds.
+    func->SetNormalizeVector( true );
+    tmp = integrator->ComputeNextStep( point1, point2, accumTime, stepSize.Interval,
+                                       stepTaken, minStep, maxStep,
+                                       this->MaximumError, error );
+    func->SetNormalizeVector( false );
+    if ( tmp != 0 )
+      {
+      retVal = tmp;
+      memcpy(lines->LastPoint, point2, 3*sizeof(double));
+      lines->HasLastPoint = 1;
+      break;
+      }
 
-      // It is not enough to use the starting point for stagnation calculation
-      // Use delX/stepSize to calculate speed and check if it is below
-      // stagnation threshold
-      double disp[3];
-      for (i=0; i<3; i++)
-        {
-        disp[i] = point2[i] - point1[i];
-        }
-      if ( (stepSize.Interval == 0) ||
-           (vtkMath::Norm(disp) / fabs(stepSize.Interval) <= this->TerminalSpeed) )
-        {
-        retVal = STAGNATION;
-        break;
-        }
+    // It is not enough to use the starting point for stagnation calculation
+    // Use delX/stepSize to calculate speed and check if it is below
+    // stagnation threshold
+    double disp[3];
+    for (i=0; i<3; i++)
+      {
+      disp[i] = point2[i] - point1[i];
+      }
+    if ( (stepSize.Interval == 0) ||
+         (vtkMath::Norm(disp) / fabs(stepSize.Interval) <= this->TerminalSpeed) )
+      {
+      retVal = STAGNATION;
+      break;
+      }
 
-      accumTime += stepTaken / speed;
-      // Calculate propagation (using the same units as MaximumPropagation
-      propagation += fabs( stepSize.Interval );
+    accumTime += stepTaken / speed;
+    // Calculate propagation (using the same units as MaximumPropagation
+    propagation += fabs( stepSize.Interval );
 
-      // This is the next starting point
-      for(i=0; i<3; i++)
-        {
-        point1[i] = point2[i];
-        }
+    // This is the next starting point
+    for(i=0; i<3; i++)
+      {
+      point1[i] = point2[i];
+      }
 
-      double point2t[4];
-      memcpy(point2t, point2, 3*sizeof(double)); 
-      point2t[3] = accumTime;
+    double point2t[4];
+    memcpy(point2t, point2, 3*sizeof(double)); 
+    point2t[3] = accumTime;
 
-      // Interpolate the velocity at the next point
-      if ( !func->FunctionValues(point2t, velocity) )
-        {
-        retVal = OUT_OF_DOMAIN;
-        memcpy(lastPoint, point2, 3*sizeof(double));
-        break;
-        }
-      // Make sure we use the dataset found by the vtkAbstractInterpolatedVelocityField
-      input = func->GetLastDataSet();
-      inputPD = input->GetPointData();
+    // Interpolate the velocity at the next point
+    if ( !func->FunctionValues(point2t, velocity) )
+      {
+      retVal = OUT_OF_DOMAIN;
+      memcpy(lines->LastPoint, point2, 3*sizeof(double));
+      lines->HasLastPoint = 1;
+      break;
+      }
+    // Make sure we use the dataset found by the vtkAbstractInterpolatedVelocityField
+    input = func->GetLastDataSet();
 
-      // Point is valid. Insert it.
-      numPts++;
-      numPtsTotal++;
-      nextPoint = outputPoints->InsertNextPoint(point1);
-      time->InsertNextValue(accumTime);
+    // Point is valid. Insert it.
+    numPts++;
+    lines->Points.insert(lines->Points.end(), point1, point1+3);
+    lines->Times.push_back(accumTime);
 
-      // Calculate cell length and speed to be used in unit conversions
-      input->GetCell(func->GetLastCellId(), cell);
-      cellLength = sqrt(static_cast<double>(cell->GetLength2()));
+    // Calculate cell length and speed to be used in unit conversions
+    input->GetCell(func->GetLastCellId(), cell);
+    cellLength = sqrt(static_cast<double>(cell->GetLength2()));
 
-      velocityArray->InsertNextTuple(velocity);
+    lines->Velocities.insert(lines->Velocities.end(), velocity, velocity+3);
 
-      speed = vtkMath::Norm(velocity);
+    speed = vtkMath::Norm(velocity);
 
-      speedArray->InsertNextValue(speed);
+    lines->Speeds.push_back(speed);
 
-      // Interpolate all point attributes on current point
-      func->GetLastWeights(weights);
-      //TODO: avoid this at least for time vectors
-      //outputPD->InterpolatePoint(inputPD, nextPoint, cell->PointIds, weights);
+    // Interpolate all point attributes on current point
+    func->GetLastWeights(weights);
+    //TODO: avoid this at least for time vectors
+    //outputPD->InterpolatePoint(inputPD, nextPoint, cell->PointIds, weights);
 
-      // Compute vorticity if required
-      // This can be used later for streamribbon generation.
-      if (this->ComputeVorticity)
-        {
-        //TODO
-        //inVectors->GetTuples(cell->PointIds, cellVectors);
-        func->GetLastLocalCoordinates(pcoords);
-        vort[0] = vort[1] = vort[2] = 0.0;
-        //vtkStreamTracer::CalculateVorticity(cell, pcoords, cellVectors, vort);
-        vorticity->InsertNextTuple(vort);
-        // rotation
-        // angular velocity = vorticity . unit tangent ( i.e. velocity/speed )
-        // rotation = sum ( angular velocity * stepSize )
-        omega = vtkMath::Dot(vort, velocity);
-        omega /= speed;
-        omega *= this->RotationScale;
-        index = angularVel->InsertNextValue(omega);
-        rotation->InsertNextValue(rotation->GetValue(index-1) +
-                                  (angularVel->GetValue(index-1) + omega)/2 *
-                                  (accumTime - time->GetValue(index-1)));
-        }
+    // Compute vorticity if required
+    // This can be used later for streamribbon generation.
+    if (this->ComputeVorticity)
+      {
+      //TODO
+      //inVectors->GetTuples(cell->PointIds, cellVectors);
+      func->GetLastLocalCoordinates(pcoords);
+      vort[0] = vort[1] = vort[2] = 0.0;
+      //vtkStreamTracer::CalculateVorticity(cell, pcoords, cellVectors, vort);
+      lines->Vorticities.insert(lines->Vorticities.end(), vort, vort+3);
+      // rotation
+      // angular velocity = vorticity . unit tangent ( i.e. velocity/speed )
+      // rotation = sum ( angular velocity * stepSize )
+      omega = vtkMath::Dot(vort, velocity);
+      omega /= speed;
+      omega *= this->RotationScale;
+      double previousAngularVel = lines->AngularVelocities.back();
+      double previousTime = lines->Times[lines->Times.size()-2];
+      lines->AngularVelocities.push_back(omega);
+      lines->Rotations.push_back(lines->Rotations.back() +
+                                 (previousAngularVel + omega)/2 *
+                                 (accumTime - previousTime));
+      }
 
-      // Never call conversion methods if speed == 0
-      if ( (speed == 0) || (speed <= this->TerminalSpeed) )
-        {
-        retVal = STAGNATION;
-        break;
-        }
+    // Never call conversion methods if speed == 0
+    if ( (speed == 0) || (speed <= this->TerminalSpeed) )
+      {
+      retVal = STAGNATION;
+      break;
+      }
 
-      // Convert all intervals to arc length
-      this->ConvertIntervals( step, minStep, maxStep, direction, cellLength );
+    // Convert all intervals to arc length
+    this->ConvertIntervals( step, minStep, maxStep, direction, cellLength );
 
 
-      // If the solver is adaptive and the next step size (stepSize.Interval)
-      // that the solver wants to use is smaller than minStep or larger
-      // than maxStep, re-adjust it. This has to be done every step
-      // because minStep and maxStep can change depending on the cell
-      // size (unless it is specified in arc-length unit)
-      if (integrator->IsAdaptive())
+    // If the solver is adaptive and the next step size (stepSize.Interval)
+    // that the solver wants to use is smaller than minStep or larger
+    // than maxStep, re-adjust it. This has to be done every step
+    // because minStep and maxStep can change depending on the cell
+    // size (unless it is specified in arc-length unit)
+    if (integrator->IsAdaptive())
+      {
+      if (fabs(stepSize.Interval) < fabs(minStep))
         {
-        if (fabs(stepSize.Interval) < fabs(minStep))
-          {
-          stepSize.Interval = fabs( minStep ) *
-                                stepSize.Interval / fabs( stepSize.Interval );
-          }
-        else if (fabs(stepSize.Interval) > fabs(maxStep))
-          {
-          stepSize.Interval = fabs( maxStep ) *
-                                stepSize.Interval / fabs( stepSize.Interval );
-          }
+        stepSize.Interval = fabs( minStep ) *
+                              stepSize.Interval / fabs( stepSize.Interval );
         }
-      else
+      else if (fabs(stepSize.Interval) > fabs(maxStep))
         {
-        stepSize.Interval = step;
+        stepSize.Interval = fabs( maxStep ) *
+                              stepSize.Interval / fabs( stepSize.Interval );
         }
-
-      // End Integration
-      }
-
-    if (shouldAbort)
-      {
-      break;
       }
-
-    if (numPts > 1)
+    else
       {
-      outputLines->InsertNextCell(numPts);
-      for (i=numPtsTotal-numPts; i<numPtsTotal; i++)
-        {
-        outputLines->InsertCellPoint(i);
-        }
-      retVals->InsertNextValue(retVal);
+      stepSize.Interval = step;
       }
 
-    // Initialize these to 0 before starting the next line.
-    // The values passed in the function call are only used
-    // for the first line.
-    inPropagation = propagation;
-    inNumSteps = numSteps;
-
-    propagation = 0;
-    numSteps = 0;
+    // End Integration
     }
 
-  if (!shouldAbort)
+  memcpy(state.Point1, point1, 3*sizeof(double));
+  memcpy(state.Velocity, velocity, 3*sizeof(double));
+  state.AccumTime = accumTime;
+  state.Speed = speed;
+  state.CellLength = cellLength;
+  state.StepSize = stepSize.Interval;
+  state.MinStep = minStep;
+  state.MaxStep = maxStep;
+  state.Propagation = propagation;
+  state.NumberOfSteps = numSteps;
+  state.NumberOfPoints = numPts;
+  state.ReasonForTermination = retVal;
+  if (temporalFunc)
     {
-    // Create the output polyline
-    output->SetPoints(outputPoints);
-    outputPD->AddArray(time);
-    outputPD->AddArray(velocityArray);
-    outputPD->AddArray(speedArray);
-    if (vorticity)
-      {
-      outputPD->AddArray(vorticity);
-      outputPD->AddArray(rotation);
-      outputPD->AddArray(angularVel);
-      }
-
-    vtkIdType numPts = outputPoints->GetNumberOfPoints();
-    if ( numPts > 1 )
-      {
-      // Assign geometry and attributes
-      output->SetLines(outputLines);
-      if (this->GenerateNormalsInIntegrate)
-        {
-        ////////////////////////////// TODO //////////////////////////////
-        //this->GenerateNormals(output, 0, vecName);
-        }
-
-      outputCD->AddArray(retVals);
-      }
+    state.StoreLastCell(temporalFunc);
     }
 
-  velocityArray->Delete();
-  speedArray->Delete();
-
-  if (vorticity)
+  if (shouldAbort)
     {
-    vorticity->Delete();
-    rotation->Delete();
-    angularVel->Delete();
+    return vtkvmtkStaticTemporalStreamTracerLineState::LINE_ABORTED;
     }
-
-  if (cellVectors)
+  if (suspended)
     {
-    cellVectors->Delete();
+    return vtkvmtkStaticTemporalStreamTracerLineState::LINE_SUSPENDED;
     }
-  retVals->Delete();
-
-  outputPoints->Delete();
-  outputLines->Delete();
-
-  time->Delete();
-
-
-  integrator->Delete();
-  cell->Delete();
-
-  delete[] weights;
+  return vtkvmtkStaticTemporalStreamTracerLineState::LINE_FINISHED;
+}
 
-  output->Squeeze();
-  return;
+void vtkvmtkStaticTemporalStreamTracer::AddLocationStatistics(vtkAbstractInterpolatedVelocityField* func)
+{
+  vtkvmtkStaticTemporalInterpolatedVelocityField* temporalFunc =
+    vtkvmtkStaticTemporalInterpolatedVelocityField::SafeDownCast(func);
+  if (!temporalFunc)
+    {
+    return;
+    }
+  this->CellLocatorBuildTime += temporalFunc->GetCellLocatorBuildTime();
+  this->NumberOfCachedCellHits += temporalFunc->GetNumberOfCachedCellHits();
+  this->NumberOfWalkHits += temporalFunc->GetNumberOfWalkHits();
+  this->NumberOfWalkSteps += temporalFunc->GetNumberOfWalkSteps();
+  this->NumberOfLocatorSearches += temporalFunc->GetNumberOfLocatorSearches();
+  this->NumberOfLocatorMisses += temporalFunc->GetNumberOfLocatorMisses();
 }
 
 void vtkvmtkStaticTemporalStreamTracer::PrintSelf(std::ostream& os, vtkIndent indent)
@@ -816,5 +1545,14 @@ void vtkvmtkStaticTemporalStreamTracer::PrintSelf(std::ostream& os, vtkIndent in
 
   os << indent << "Seed time: " << this->SeedTime
      << " unit: time." << endl;
+  os << indent << "Use multithreading: " << this->UseMultithreading << endl;
+  os << indent << "Seed batch size: " << this->SeedBatchSize << endl;
+  os << indent << "Use cell walk: " << this->UseCellWalk << endl;
+  os << indent << "Cell locator build time: " << this->CellLocatorBuildTime << endl;
+  os << indent << "Number of cached cell hits: " << this->NumberOfCachedCellHits << endl;
+  os << indent << "Number of walk hits: " << this->NumberOfWalkHits << endl;
+  os << indent << "Number of walk steps: " << this->NumberOfWalkSteps << endl;
+  os << indent << "Number of locator searches: " << this->NumberOfLocatorSearches << endl;
+  os << indent << "Number of locator misses: " << this->NumberOfLocatorMisses << endl;
 }
 
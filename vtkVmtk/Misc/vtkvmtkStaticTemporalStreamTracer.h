@@ -49,6 +49,24 @@ Program:   VMTK
  * driving the vmtkparticletracer pype script, typically used to visualize/analyze particle
  * transport in unsteady (e.g. pulsatile CFD) blood flow simulations.
  *
+ * With UseMultithreading on, seeds are split into batches of SeedBatchSize consecutive seeds
+ * which are integrated in parallel through vtkSMPTools, each thread with its own copy of the
+ * interpolator (and hence its own cached cell) and integrator. The lines of every batch are
+ * buffered and appended to the output in seed order, so the output is the same as with
+ * UseMultithreading off, whatever the number of threads. With UseMultithreading off, each batch
+ * is appended to the output as soon as it is traced, so only one batch is buffered at a time.
+ *
+ * With a VelocityTimeSeries caching at least 3 time steps, the lines of a batch are traced
+ * together, through windows of two time steps less than the series caches, so that each time step
+ * is read from the file about once per batch rather than once per line; with UseMultithreading on,
+ * the lines of a window are traced in parallel and the threads share the cache of the series. The
+ * output is the same as when the lines are traced one after the other.
+ *
+ * With UseCellWalk on, the interpolator locates points in tetrahedral meshes by walking across
+ * cell faces, falling back to a static cell locator that is built once and shared by all threads.
+ * The time spent building it and the outcome of the point locations of the last update are
+ * available through GetCellLocatorBuildTime, GetNumberOfWalkHits and related methods.
+ *
  * @sa
  * vtkvmtkStaticTemporalInterpolatedVelocityField
  */
@@ -60,6 +78,11 @@ Program:   VMTK
 #include "vtkvmtkWin32Header.h"
 
 class vtkTable;
+class vtkGenericCell;
+class vtkvmtkVelocityTimeSeries;
+class vtkvmtkStaticTemporalStreamTracerLines;
+class vtkvmtkStaticTemporalStreamTracerLineState;
+class vtkvmtkStaticTemporalStreamTracerOutput;
 
 class VTK_VMTK_MISC_EXPORT vtkvmtkStaticTemporalStreamTracer : public vtkStreamTracer
 {
@@ -121,6 +144,16 @@ public:
   virtual void SetTimeStepsTable(vtkTable*);
   ///@}
 
+  ///@{
+  /**
+   * Set/Get an opened vtkvmtkVelocityTimeSeries holding the velocity of every time step, read
+   * in place of the point data arrays named after TimeStepsTable (see
+   * vtkvmtkStaticTemporalInterpolatedVelocityField). Default: NULL.
+   */
+  vtkGetObjectMacro(VelocityTimeSeries,vtkvmtkVelocityTimeSeries);
+  virtual void SetVelocityTimeSeries(vtkvmtkVelocityTimeSeries*);
+  ///@}
+
   ///@{
   /**
    * Toggle whether each time step's velocity is read from three separate scalar point data
@@ -173,6 +206,50 @@ public:
   vtkGetStringMacro(Component2Prefix);
   ///@}
 
+  ///@{
+  /**
+   * Toggle parallel integration of the seeds. Default: off.
+   */
+  vtkSetMacro(UseMultithreading, int);
+  vtkGetMacro(UseMultithreading, int);
+  vtkBooleanMacro(UseMultithreading, int);
+  ///@}
+
+  ///@{
+  /**
+   * Set/Get the number of consecutive seeds integrated as one unit of work (and, with
+   * UseMultithreading off, buffered before being appended to the output). Small batches balance
+   * the load better when pathline lengths vary a lot, large batches reduce the scheduling
+   * overhead and, with a VelocityTimeSeries, the number of times the time steps are read.
+   * Default: 64.
+   */
+  vtkSetClampMacro(SeedBatchSize, int, 1, VTK_INT_MAX);
+  vtkGetMacro(SeedBatchSize, int);
+  ///@}
+
+  ///@{
+  /**
+   * Toggle cell location by walking across the faces of tetrahedral meshes, with a shared static
+   * cell locator as fallback (see vtkvmtkStaticTemporalInterpolatedVelocityField). Default: off.
+   */
+  vtkSetMacro(UseCellWalk, int);
+  vtkGetMacro(UseCellWalk, int);
+  vtkBooleanMacro(UseCellWalk, int);
+  ///@}
+
+  ///@{
+  /**
+   * Location statistics of the last update, summed over all threads (see
+   * vtkvmtkStaticTemporalInterpolatedVelocityField). Only collected with UseCellWalk on.
+   */
+  vtkGetMacro(CellLocatorBuildTime, double);
+  vtkGetMacro(NumberOfCachedCellHits, vtkIdType);
+  vtkGetMacro(NumberOfWalkHits, vtkIdType);
+  vtkGetMacro(NumberOfWalkSteps, vtkIdType);
+  vtkGetMacro(NumberOfLocatorSearches, vtkIdType);
+  vtkGetMacro(NumberOfLocatorMisses, vtkIdType);
+  ///@}
+
 protected:
 
   vtkvmtkStaticTemporalStreamTracer();
@@ -201,6 +278,69 @@ protected:
                  int maxCellSize,
                  double& propagation,
                  vtkIdType& numSteps);
+
+  void IntegrateSeeds(vtkIdType beginLine,
+                      vtkIdType endLine,
+                      vtkIdType numLines,
+                      vtkDataArray* seedSource,
+                      vtkIdList* seedIds,
+                      vtkDoubleArray* startTimes,
+                      vtkIntArray* integrationDirections,
+                      vtkAbstractInterpolatedVelocityField* func,
+                      vtkInitialValueProblemSolver* integrator,
+                      vtkGenericCell* cell,
+                      double* weights,
+                      double propagation,
+                      vtkIdType numSteps,
+                      int reportProgress,
+                      vtkvmtkStaticTemporalStreamTracerLines* lines);
+
+  /**
+   * Start the line of seed currentLine: evaluate the velocity at the seed, add it to lines and
+   * initialize state. Returns 0, adding nothing, if the seed is outside the datasets or
+   * propagation or numSteps are already at their maximum.
+   */
+  int StartLine(vtkIdType currentLine,
+                vtkDataArray* seedSource,
+                vtkIdList* seedIds,
+                vtkDoubleArray* startTimes,
+                vtkIntArray* integrationDirections,
+                vtkAbstractInterpolatedVelocityField* func,
+                vtkGenericCell* cell,
+                double* weights,
+                double propagation,
+                vtkIdType numSteps,
+                vtkvmtkStaticTemporalStreamTracerLineState& state,
+                vtkvmtkStaticTemporalStreamTracerLines* lines);
+
+  /**
+   * Integrate a started line, adding its points to lines, until it terminates or, if firstRow is
+   * not negative, until its time leaves the time steps firstRow to lastRow of the
+   * vtkvmtkStaticTemporalInterpolatedVelocityField func. Returns the status of the line
+   * (finished, suspended or aborted), with state updated to resume it.
+   */
+  int AdvanceLine(vtkvmtkStaticTemporalStreamTracerLineState& state,
+                  vtkIdType numLines,
+                  vtkAbstractInterpolatedVelocityField* func,
+                  vtkInitialValueProblemSolver* integrator,
+                  vtkGenericCell* cell,
+                  double* weights,
+                  int firstRow,
+                  int lastRow,
+                  int reportProgress,
+                  vtkvmtkStaticTemporalStreamTracerLines* lines);
+
+  /**
+   * Append lines to output, update lastPoint, LastUsedStepSize, propagation and numSteps from
+   * them, and release their buffers.
+   */
+  void AppendLines(vtkvmtkStaticTemporalStreamTracerLines& lines,
+                   vtkvmtkStaticTemporalStreamTracerOutput& output,
+                   double lastPoint[3],
+                   double& propagation,
+                   vtkIdType& numSteps);
+
+  void AddLocationStatistics(vtkAbstractInterpolatedVelocityField* func);
  
   double SeedTime;
   char* SeedTimesArrayName;
@@ -215,8 +355,25 @@ protected:
 
   vtkTable* TimeStepsTable;
 
+  vtkvmtkVelocityTimeSeries* VelocityTimeSeries;
+
   double VelocityScale;
 
+  int UseMultithreading;
+  int SeedBatchSize;
+
+  int UseCellWalk;
+
+  double CellLocatorBuildTime;
+  vtkIdType NumberOfCachedCellHits;
+  vtkIdType NumberOfWalkHits;
+  vtkIdType NumberOfWalkSteps;
+  vtkIdType NumberOfLocatorSearches;
+  vtkIdType NumberOfLocatorMisses;
+
+  friend class vtkvmtkStaticTemporalStreamTracerFunctor;
+  friend class vtkvmtkStaticTemporalStreamTracerWindowFunctor;
+
 private:
   vtkvmtkStaticTemporalStreamTracer(const vtkvmtkStaticTemporalStreamTracer&);  // Not implemented.
   void operator=(const vtkvmtkStaticTemporalStreamTracer&);  // Not implemented.
@@ -0,0 +1,654 @@
+/*=========================================================================
+
+Program:   VMTK
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENSE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "vtkvmtkVelocityTimeSeries.h"
+
+#include "vtkDataArray.h"
+#include "vtkObjectFactory.h"
+
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// File layout: a fixed size header, the time steps one after the other
+// ([point][3] values each, float or unsigned 16 bit) and a trailer with, for
+// every time step, its time and, for quantized files, the minimum and scale of
+// each component. The header is written again by EndWrite, once the number of
+// time steps and the position of the trailer are known. Values are stored in
+// the byte order of the writing machine, recorded in the header as the value
+// of ByteOrderMark.
+static const char vtkvmtkVelocityTimeSeriesMagic[8] = {'V','M','T','K','V','T','S','1'};
+static const vtkTypeInt32 vtkvmtkVelocityTimeSeriesByteOrderMark = 0x01020304;
+static const vtkTypeInt32 vtkvmtkVelocityTimeSeriesSwappedByteOrderMark = 0x04030201;
+static const std::streamoff vtkvmtkVelocityTimeSeriesHeaderSize = 8 + 4 + 4 + 3 * 8;
+
+typedef std::shared_ptr<const std::vector<float> > vtkvmtkVelocityTimeSeriesValues;
+
+class vtkvmtkVelocityTimeSeriesCacheEntry
+{
+public:
+  vtkvmtkVelocityTimeSeriesCacheEntry()
+  {
+    this->Step = -1;
+    this->LastUse = 0;
+  }
+
+  int Step;
+  vtkIdType LastUse;
+  vtkvmtkVelocityTimeSeriesValues Values;
+};
+
+// A file opened for reading and its cache of time steps, shared by the series
+// opened with CopyFileInformation, possibly from different threads: the cache
+// is locked while a time step is looked up or read, so that every time step
+// is read once however many series request it. The values of a time step are
+// reference counted, so that evicting it does not release them while a series
+// still holds them.
+class vtkvmtkVelocityTimeSeriesReader
+{
+public:
+  vtkvmtkVelocityTimeSeriesReader()
+  {
+    this->FileStorageType = vtkvmtkVelocityTimeSeries::STORAGE_FLOAT;
+    this->NumberOfPoints = 0;
+    this->UseCount = 0;
+    this->NumberOfTimeStepReads = 0;
+  }
+
+  std::streamoff GetTimeStepSize()
+  {
+    std::streamoff valueSize = this->FileStorageType == vtkvmtkVelocityTimeSeries::STORAGE_QUANTIZED_16 ? 2 : 4;
+    return static_cast<std::streamoff>(this->NumberOfPoints) * 3 * valueSize;
+  }
+
+  std::fstream File;
+  int FileStorageType;
+  vtkIdType NumberOfPoints;
+
+  std::vector<double> Times;
+  std::vector<float> Minimums;
+  std::vector<float> Scales;
+
+  std::mutex Mutex;
+  std::vector<vtkvmtkVelocityTimeSeriesCacheEntry> Cache;
+  vtkIdType UseCount;
+  vtkIdType NumberOfTimeStepReads;
+  std::vector<unsigned short> QuantizedBuffer;
+};
+
+class vtkvmtkVelocityTimeSeriesInternals
+{
+public:
+  vtkvmtkVelocityTimeSeriesInternals()
+  {
+    this->FileStorageType = vtkvmtkVelocityTimeSeries::STORAGE_FLOAT;
+    this->Writing = 0;
+  }
+
+  // writing
+  std::fstream File;
+  int FileStorageType;
+  int Writing;
+
+  std::vector<double> Times;
+  std::vector<float> Minimums;
+  std::vector<float> Scales;
+
+  std::vector<float> FloatBuffer;
+  std::vector<unsigned short> QuantizedBuffer;
+
+  // reading: the shared reader, and the time steps last returned by
+  // GetTimeStep, held until MaximumNumberOfCachedTimeSteps others are
+  std::shared_ptr<vtkvmtkVelocityTimeSeriesReader> Reader;
+  std::deque<vtkvmtkVelocityTimeSeriesValues> HeldTimeSteps;
+};
+
+vtkStandardNewMacro(vtkvmtkVelocityTimeSeries);
+
+vtkvmtkVelocityTimeSeries::vtkvmtkVelocityTimeSeries()
+{
+  this->FileName = NULL;
+  this->StorageType = STORAGE_FLOAT;
+  this->MaximumNumberOfCachedTimeSteps = 4;
+  this->NumberOfPoints = 0;
+  this->Internals = new vtkvmtkVelocityTimeSeriesInternals;
+}
+
+vtkvmtkVelocityTimeSeries::~vtkvmtkVelocityTimeSeries()
+{
+  if (this->Internals->Writing)
+    {
+    this->EndWrite();
+    }
+  this->Close();
+  delete this->Internals;
+  this->Internals = NULL;
+  this->SetFileName(NULL);
+}
+
+int vtkvmtkVelocityTimeSeries::BeginWrite(vtkIdType numberOfPoints)
+{
+  vtkvmtkVelocityTimeSeriesInternals* internals = this->Internals;
+
+  this->Close();
+
+  if (!this->FileName)
+    {
+    vtkErrorMacro(<<"No FileName set.");
+    return 0;
+    }
+
+  if (numberOfPoints <= 0)
+    {
+    vtkErrorMacro(<<"Invalid number of points: "<<numberOfPoints);
+    return 0;
+    }
+
+  internals->File.open(this->FileName,std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!internals->File.is_open())
+    {
+    vtkErrorMacro(<<"Cannot open "<<this->FileName<<" for writing.");
+    return 0;
+    }
+
+  this->NumberOfPoints = numberOfPoints;
+  internals->FileStorageType = this->StorageType;
+  internals->Writing = 1;
+
+  // Placeholder, rewritten by EndWrite.
+  std::vector<char> header(vtkvmtkVelocityTimeSeriesHeaderSize,0);
+  internals->File.write(&header[0],header.size());
+
+  return internals->File.good() ? 1 : 0;
+}
+
+int vtkvmtkVelocityTimeSeries::AppendTimeStep(double time, vtkDataArray* velocity)
+{
+  if (!velocity || velocity->GetNumberOfComponents() != 3)
+    {
+    vtkErrorMacro(<<"Velocity array must have 3 components.");
+    return 0;
+    }
+  vtkDataArray* arrays[3] = {velocity, velocity, velocity};
+  int components[3] = {0, 1, 2};
+  return this->AppendTimeStep(time,arrays,components);
+}
+
+int vtkvmtkVelocityTimeSeries::AppendTimeStep(double time, vtkDataArray* u, vtkDataArray* v, vtkDataArray* w)
+{
+  if (!u || !v || !w)
+    {
+    vtkErrorMacro(<<"Missing velocity component array.");
+    return 0;
+    }
+  vtkDataArray* arrays[3] = {u, v, w};
+  int components[3] = {0, 0, 0};
+  return this->AppendTimeStep(time,arrays,components);
+}
+
+int vtkvmtkVelocityTimeSeries::AppendTimeStep(double time, vtkDataArray* arrays[3], int components[3])
+{
+  vtkvmtkVelocityTimeSeriesInternals* internals = this->Internals;
+
+  if (!internals->Writing)
+    {
+    vtkErrorMacro(<<"AppendTimeStep called before BeginWrite.");
+    return 0;
+    }
+
+  if (!internals->Times.empty() && time <= internals->Times.back())
+    {
+    vtkErrorMacro(<<"Time steps must be appended in increasing time order.");
+    return 0;
+    }
+
+  vtkIdType numberOfPoints = this->NumberOfPoints;
+  int j;
+  for (j=0; j<3; j++)
+    {
+    if (arrays[j]->GetNumberOfTuples() != numberOfPoints)
+      {
+      vtkErrorMacro(<<"Velocity array has "<<arrays[j]->GetNumberOfTuples()<<" tuples, expected "<<numberOfPoints<<".");
+      return 0;
+      }
+    }
+
+  std::vector<float>& values = internals->FloatBuffer;
+  values.resize(3*numberOfPoints);
+  vtkIdType i;
+  for (i=0; i<numberOfPoints; i++)
+    {
+    for (j=0; j<3; j++)
+      {
+      values[3*i+j] = static_cast<float>(arrays[j]->GetComponent(i,components[j]));
+      }
+    }
+
+  float minimum[3] = {0.0f, 0.0f, 0.0f};
+  float scale[3] = {0.0f, 0.0f, 0.0f};
+
+  if (internals->FileStorageType == STORAGE_QUANTIZED_16)
+    {
+    float maximum[3];
+    for (j=0; j<3; j++)
+      {
+      minimum[j] = values[j];
+      maximum[j] = values[j];
+      }
+    for (i=1; i<numberOfPoints; i++)
+      {
+      for (j=0; j<3; j++)
+        {
+        minimum[j] = values[3*i+j] < minimum[j] ? values[3*i+j] : minimum[j];
+        maximum[j] = values[3*i+j] > maximum[j] ? values[3*i+j] : maximum[j];
+        }
+      }
+    for (j=0; j<3; j++)
+      {
+      scale[j] = (maximum[j] - minimum[j]) / 65535.0f;
+      }
+
+    std::vector<unsigned short>& quantized = internals->QuantizedBuffer;
+    quantized.resize(3*numberOfPoints);
+    for (i=0; i<numberOfPoints; i++)
+      {
+      for (j=0; j<3; j++)
+        {
+        float level = scale[j] > 0.0f ? (values[3*i+j] - minimum[j]) / scale[j] + 0.5f : 0.0f;
+        level = level > 65535.0f ? 65535.0f : level;
+        quantized[3*i+j] = static_cast<unsigned short>(level);
+        }
+      }
+    internals->File.write(reinterpret_cast<const char*>(&quantized[0]),quantized.size()*sizeof(unsigned short));
+    }
+  else
+    {
+    internals->File.write(reinterpret_cast<const char*>(&values[0]),values.size()*sizeof(float));
+    }
+
+  if (!internals->File.good())
+    {
+    vtkErrorMacro(<<"Error writing "<<this->FileName<<".");
+    return 0;
+    }
+
+  internals->Times.push_back(time);
+  for (j=0; j<3; j++)
+    {
+    internals->Minimums.push_back(minimum[j]);
+    internals->Scales.push_back(scale[j]);
+    }
+
+  return 1;
+}
+
+int vtkvmtkVelocityTimeSeries::EndWrite()
+{
+  vtkvmtkVelocityTimeSeriesInternals* internals = this->Internals;
+
+  if (!internals->Writing)
+    {
+    vtkErrorMacro(<<"EndWrite called before BeginWrite.");
+    return 0;
+    }
+
+  std::fstream& file = internals->File;
+  vtkTypeInt64 numberOfTimeSteps = static_cast<vtkTypeInt64>(internals->Times.size());
+  vtkTypeInt64 trailerOffset = static_cast<vtkTypeInt64>(file.tellp());
+
+  vtkTypeInt64 i;
+  for (i=0; i<numberOfTimeSteps; i++)
+    {
+    file.write(reinterpret_cast<const char*>(&internals->Times[i]),sizeof(double));
+    if (internals->FileStorageType == STORAGE_QUANTIZED_16)
+      {
+      file.write(reinterpret_cast<const char*>(&internals->Minimums[3*i]),3*sizeof(float));
+      file.write(reinterpret_cast<const char*>(&internals->Scales[3*i]),3*sizeof(float));
+      }
+    }
+
+  vtkTypeInt32 storageType = internals->FileStorageType;
+  vtkTypeInt32 byteOrderMark = vtkvmtkVelocityTimeSeriesByteOrderMark;
+  vtkTypeInt64 numberOfPoints = this->NumberOfPoints;
+  file.seekp(0);
+  file.write(vtkvmtkVelocityTimeSeriesMagic,8);
+  file.write(reinterpret_cast<const char*>(&storageType),sizeof(storageType));
+  file.write(reinterpret_cast<const char*>(&byteOrderMark),sizeof(byteOrderMark));
+  file.write(reinterpret_cast<const char*>(&numberOfPoints),sizeof(numberOfPoints));
+  file.write(reinterpret_cast<const char*>(&numberOfTimeSteps),sizeof(numberOfTimeSteps));
+  file.write(reinterpret_cast<const char*>(&trailerOffset),sizeof(trailerOffset));
+
+  int success = file.good() ? 1 : 0;
+  if (!success)
+    {
+    vtkErrorMacro(<<"Error writing "<<this->FileName<<".");
+    }
+
+  file.close();
+  internals->Writing = 0;
+  internals->Times.clear();
+  internals->Minimums.clear();
+  internals->Scales.clear();
+  std::vector<float>().swap(internals->FloatBuffer);
+  std::vector<unsigned short>().swap(internals->QuantizedBuffer);
+  this->NumberOfPoints = 0;
+
+  return success;
+}
+
+int vtkvmtkVelocityTimeSeries::Open()
+{
+  vtkvmtkVelocityTimeSeriesInternals* internals = this->Internals;
+
+  if (internals->Writing)
+    {
+    vtkErrorMacro(<<"Open called before EndWrite.");
+    return 0;
+    }
+
+  this->Close();
+
+  if (!this->FileName)
+    {
+    vtkErrorMacro(<<"No FileName set.");
+    return 0;
+    }
+
+  std::shared_ptr<vtkvmtkVelocityTimeSeriesReader> reader(new vtkvmtkVelocityTimeSeriesReader);
+  std::fstream& file = reader->File;
+  file.open(this->FileName,std::ios::in | std::ios::binary);
+  if (!file.is_open())
+    {
+    vtkErrorMacro(<<"Cannot open "<<this->FileName<<" for reading.");
+    return 0;
+    }
+
+  char magic[8];
+  vtkTypeInt32 storageType = 0;
+  vtkTypeInt32 byteOrderMark = 0;
+  vtkTypeInt64 numberOfPoints = 0;
+  vtkTypeInt64 numberOfTimeSteps = 0;
+  vtkTypeInt64 trailerOffset = 0;
+  file.read(magic,8);
+  file.read(reinterpret_cast<char*>(&storageType),sizeof(storageType));
+  file.read(reinterpret_cast<char*>(&byteOrderMark),sizeof(byteOrderMark));
+  file.read(reinterpret_cast<char*>(&numberOfPoints),sizeof(numberOfPoints));
+  file.read(reinterpret_cast<char*>(&numberOfTimeSteps),sizeof(numberOfTimeSteps));
+  file.read(reinterpret_cast<char*>(&trailerOffset),sizeof(trailerOffset));
+
+  if (file.good() && memcmp(magic,vtkvmtkVelocityTimeSeriesMagic,8) == 0 &&
+      byteOrderMark == vtkvmtkVelocityTimeSeriesSwappedByteOrderMark)
+    {
+    vtkErrorMacro(<<this->FileName<<" was written on a machine of the other byte order.");
+    return 0;
+    }
+
+  if (!file.good() || memcmp(magic,vtkvmtkVelocityTimeSeriesMagic,8) != 0 ||
+      byteOrderMark != vtkvmtkVelocityTimeSeriesByteOrderMark ||
+      (storageType != STORAGE_FLOAT && storageType != STORAGE_QUANTIZED_16) ||
+      numberOfPoints <= 0 || numberOfTimeSteps < 0)
+    {
+    vtkErrorMacro(<<this->FileName<<" is not a velocity time series file.");
+    return 0;
+    }
+
+  reader->FileStorageType = storageType;
+  reader->NumberOfPoints = numberOfPoints;
+
+  reader->Times.resize(numberOfTimeSteps);
+  reader->Minimums.assign(3*numberOfTimeSteps,0.0f);
+  reader->Scales.assign(3*numberOfTimeSteps,0.0f);
+  file.seekg(trailerOffset);
+  vtkTypeInt64 i;
+  for (i=0; i<numberOfTimeSteps; i++)
+    {
+    file.read(reinterpret_cast<char*>(&reader->Times[i]),sizeof(double));
+    if (storageType == STORAGE_QUANTIZED_16)
+      {
+      file.read(reinterpret_cast<char*>(&reader->Minimums[3*i]),3*sizeof(float));
+      file.read(reinterpret_cast<char*>(&reader->Scales[3*i]),3*sizeof(float));
+      }
+    }
+
+  if (!file.good())
+    {
+    vtkErrorMacro(<<"Error reading "<<this->FileName<<".");
+    return 0;
+    }
+
+  internals->Reader = reader;
+  this->NumberOfPoints = numberOfPoints;
+  this->Modified();
+
+  return 1;
+}
+
+void vtkvmtkVelocityTimeSeries::Close()
+{
+  vtkvmtkVelocityTimeSeriesInternals* internals = this->Internals;
+
+  if (internals->Writing)
+    {
+    return;
+    }
+
+  // the file stays open for the series sharing it
+  internals->Reader.reset();
+  internals->HeldTimeSteps.clear();
+  this->NumberOfPoints = 0;
+  this->Modified();
+}
+
+void vtkvmtkVelocityTimeSeries::CopyFileInformation(vtkvmtkVelocityTimeSeries* other)
+{
+  if (!other || other == this)
+    {
+    return;
+    }
+
+  this->Close();
+  this->SetFileName(other->GetFileName());
+  this->SetMaximumNumberOfCachedTimeSteps(other->GetMaximumNumberOfCachedTimeSteps());
+  if (other->Internals->Reader)
+    {
+    this->Internals->Reader = other->Internals->Reader;
+    this->NumberOfPoints = other->NumberOfPoints;
+    this->Modified();
+    }
+}
+
+int vtkvmtkVelocityTimeSeries::GetNumberOfTimeSteps()
+{
+  vtkvmtkVelocityTimeSeriesReader* reader = this->Internals->Reader.get();
+  return reader ? static_cast<int>(reader->Times.size()) : 0;
+}
+
+double vtkvmtkVelocityTimeSeries::GetTime(int step)
+{
+  if (step < 0 || step >= this->GetNumberOfTimeSteps())
+    {
+    vtkErrorMacro(<<"Time step "<<step<<" out of range.");
+    return 0.0;
+    }
+  return this->Internals->Reader->Times[step];
+}
+
+vtkIdType vtkvmtkVelocityTimeSeries::GetNumberOfTimeStepReads()
+{
+  vtkvmtkVelocityTimeSeriesReader* reader = this->Internals->Reader.get();
+  if (!reader)
+    {
+    return 0;
+    }
+  std::lock_guard<std::mutex> lock(reader->Mutex);
+  return reader->NumberOfTimeStepReads;
+}
+
+const float* vtkvmtkVelocityTimeSeries::GetTimeStep(int step)
+{
+  vtkvmtkVelocityTimeSeriesInternals* internals = this->Internals;
+  vtkvmtkVelocityTimeSeriesReader* reader = internals->Reader.get();
+
+  if (!reader)
+    {
+    vtkErrorMacro(<<"GetTimeStep called before Open.");
+    return NULL;
+    }
+
+  if (step < 0 || step >= this->GetNumberOfTimeSteps())
+    {
+    vtkErrorMacro(<<"Time step "<<step<<" out of range.");
+    return NULL;
+    }
+
+  vtkvmtkVelocityTimeSeriesValues values;
+  int readError = 0;
+  {
+  std::lock_guard<std::mutex> lock(reader->Mutex);
+  std::vector<vtkvmtkVelocityTimeSeriesCacheEntry>& cache = reader->Cache;
+  reader->UseCount++;
+
+  // Cached time step, or the least recently used entry to replace.
+  size_t leastRecentlyUsed = 0;
+  size_t i;
+  for (i=0; i<cache.size() && !values; i++)
+    {
+    if (cache[i].Step == step)
+      {
+      cache[i].LastUse = reader->UseCount;
+      values = cache[i].Values;
+      }
+    else if (cache[i].LastUse < cache[leastRecentlyUsed].LastUse)
+      {
+      leastRecentlyUsed = i;
+      }
+    }
+
+  if (!values)
+    {
+    if (cache.size() < static_cast<size_t>(this->MaximumNumberOfCachedTimeSteps))
+      {
+      cache.push_back(vtkvmtkVelocityTimeSeriesCacheEntry());
+      leastRecentlyUsed = cache.size() - 1;
+      }
+
+    vtkvmtkVelocityTimeSeriesCacheEntry& entry = cache[leastRecentlyUsed];
+    entry.Step = -1;
+    entry.Values.reset();
+
+    vtkIdType numberOfValues = 3 * reader->NumberOfPoints;
+    std::shared_ptr<std::vector<float> > readValues(new std::vector<float>(numberOfValues));
+    std::fstream& file = reader->File;
+    file.clear();
+    file.seekg(vtkvmtkVelocityTimeSeriesHeaderSize + step * reader->GetTimeStepSize());
+    if (reader->FileStorageType == STORAGE_QUANTIZED_16)
+      {
+      std::vector<unsigned short>& quantized = reader->QuantizedBuffer;
+      quantized.resize(numberOfValues);
+      file.read(reinterpret_cast<char*>(&quantized[0]),numberOfValues*sizeof(unsigned short));
+      const float* minimum = &reader->Minimums[3*step];
+      const float* scale = &reader->Scales[3*step];
+      vtkIdType k;
+      for (k=0; k<numberOfValues; k++)
+        {
+        (*readValues)[k] = minimum[k%3] + scale[k%3] * quantized[k];
+        }
+      }
+    else
+      {
+      file.read(reinterpret_cast<char*>(&(*readValues)[0]),numberOfValues*sizeof(float));
+      }
+
+    if (file.good())
+      {
+      entry.Step = step;
+      entry.LastUse = reader->UseCount;
+      entry.Values = readValues;
+      values = readValues;
+      reader->NumberOfTimeStepReads++;
+      }
+    else
+      {
+      readError = 1;
+      }
+    }
+  }
+
+  if (readError)
+    {
+    vtkErrorMacro(<<"Error reading time step "<<step<<" from "<<this->FileName<<".");
+    return NULL;
+    }
+
+  // Hold the time step, so that the series sharing the cache cannot release
+  // it before MaximumNumberOfCachedTimeSteps others are requested from this one.
+  std::deque<vtkvmtkVelocityTimeSeriesValues>& held = internals->HeldTimeSteps;
+  std::deque<vtkvmtkVelocityTimeSeriesValues>::iterator it;
+  for (it=held.begin(); it!=held.end(); ++it)
+    {
+    if (*it == values)
+      {
+      held.erase(it);
+      break;
+      }
+    }
+  held.push_back(values);
+  while (held.size() > static_cast<size_t>(this->MaximumNumberOfCachedTimeSteps))
+    {
+    held.pop_front();
+    }
+
+  return &(*values)[0];
+}
+
+int vtkvmtkVelocityTimeSeries::CopyTimeStep(int step, vtkDataArray* velocity)
+{
+  if (!velocity)
+    {
+    return 0;
+    }
+
+  const float* values = this->GetTimeStep(step);
+  if (!values)
+    {
+    return 0;
+    }
+
+  velocity->SetNumberOfComponents(3);
+  velocity->SetNumberOfTuples(this->NumberOfPoints);
+  vtkIdType i;
+  for (i=0; i<this->NumberOfPoints; i++)
+    {
+    velocity->SetTuple3(i,values[3*i],values[3*i+1],values[3*i+2]);
+    }
+
+  return 1;
+}
+
+void vtkvmtkVelocityTimeSeries::PrintSelf(std::ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "FileName: " << (this->FileName ? this->FileName : "(none)") << endl;
+  os << indent << "StorageType: " << this->StorageType << endl;
+  os << indent << "MaximumNumberOfCachedTimeSteps: " << this->MaximumNumberOfCachedTimeSteps << endl;
+  os << indent << "NumberOfPoints: " << this->NumberOfPoints << endl;
+  os << indent << "NumberOfTimeSteps: " << this->GetNumberOfTimeSteps() << endl;
+  os << indent << "NumberOfTimeStepReads: " << this->GetNumberOfTimeStepReads() << endl;
+}
@@ -0,0 +1,182 @@
+/*=========================================================================
+
+Program:   VMTK
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENSE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/**
+ * @class   vtkvmtkVelocityTimeSeries
+ * @brief   File-backed storage of the time steps of a velocity field on a fixed mesh.
+ * @ingroup Misc
+ *
+ * Stores the velocity of every point of a mesh at a sequence of time steps in a single binary
+ * file, as one contiguous [time step][point][3] block, either as floats or quantized to 16 bits
+ * per component (with a per time step and per component range, see StorageType). Only the time
+ * steps being used are held in memory: GetTimeStep reads a time step from the file on demand into
+ * a cache of MaximumNumberOfCachedTimeSteps time steps, evicting the least recently used one.
+ *
+ * Files are written one time step at a time (BeginWrite, AppendTimeStep, EndWrite), so that the
+ * time steps of a simulation never need to be in memory at once, and read after Open. The file
+ * stores the time value of every time step, so no separate time steps table is needed. Values are
+ * stored in the byte order of the machine that wrote the file, which Open checks: files can only
+ * be read on machines of the same byte order.
+ *
+ * Series made with CopyFileInformation share the opened file and its cache, which is locked while
+ * a time step is looked up or read: threads reading the same file each read through their own
+ * copy (vtkvmtkStaticTemporalInterpolatedVelocityField makes one when it is copied), and every
+ * time step is read once for all of them, as long as they request time steps within the size of
+ * the cache.
+ *
+ * @sa
+ * vtkvmtkStaticTemporalInterpolatedVelocityField, vtkvmtkStaticTemporalStreamTracer,
+ * vtkvmtkMeshVelocityStatistics
+ */
+
+#ifndef __vtkvmtkVelocityTimeSeries_h
+#define __vtkvmtkVelocityTimeSeries_h
+
+#include "vtkObject.h"
+#include "vtkvmtkWin32Header.h"
+
+class vtkDataArray;
+class vtkvmtkVelocityTimeSeriesInternals;
+
+class VTK_VMTK_MISC_EXPORT vtkvmtkVelocityTimeSeries : public vtkObject
+{
+  public:
+  vtkTypeMacro(vtkvmtkVelocityTimeSeries,vtkObject);
+  void PrintSelf(std::ostream& os, vtkIndent indent) override;
+
+  static vtkvmtkVelocityTimeSeries *New();
+
+  ///@{
+  /**
+   * Set/Get the name of the file the time steps are written to and read from.
+   */
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+  ///@}
+
+  ///@{
+  /**
+   * Set/Get how velocities are written: as floats, or as 16 bit integers spanning the range of
+   * each component at each time step (half the size, with a relative error of 1/65535 of the
+   * range). Files are read with the storage type they were written with. Default: float.
+   */
+  vtkSetClampMacro(StorageType,int,STORAGE_FLOAT,STORAGE_QUANTIZED_16);
+  vtkGetMacro(StorageType,int);
+  void SetStorageTypeToFloat() { this->SetStorageType(STORAGE_FLOAT); }
+  void SetStorageTypeToQuantized16() { this->SetStorageType(STORAGE_QUANTIZED_16); }
+  ///@}
+
+  ///@{
+  /**
+   * Set/Get the number of time steps kept in memory while reading. At least 2, so that the two
+   * time steps bracketing a time are available together. Default: 4.
+   */
+  vtkSetClampMacro(MaximumNumberOfCachedTimeSteps,int,2,VTK_INT_MAX);
+  vtkGetMacro(MaximumNumberOfCachedTimeSteps,int);
+  ///@}
+
+  /**
+   * Create FileName for a mesh of numberOfPoints points. Returns 1 on success.
+   */
+  int BeginWrite(vtkIdType numberOfPoints);
+
+  /**
+   * Append the velocity at time, from a 3-component array with one tuple per point. Returns 1 on
+   * success.
+   */
+  int AppendTimeStep(double time, vtkDataArray* velocity);
+
+  /**
+   * Append the velocity at time, from three 1-component arrays with one tuple per point. Returns
+   * 1 on success.
+   */
+  int AppendTimeStep(double time, vtkDataArray* u, vtkDataArray* v, vtkDataArray* w);
+
+  /**
+   * Write the time values and close the file. Returns 1 on success.
+   */
+  int EndWrite();
+
+  /**
+   * Open FileName for reading and read the number of points and the time values. Returns 0 if the
+   * file was written on a machine of the other byte order. Returns 1 on success.
+   */
+  int Open();
+
+  /**
+   * Close the file and release the cached time steps.
+   */
+  void Close();
+
+  /**
+   * Read the file that other is reading, with the same cache size, sharing its cache.
+   */
+  void CopyFileInformation(vtkvmtkVelocityTimeSeries* other);
+
+  vtkGetMacro(NumberOfPoints,vtkIdType);
+
+  int GetNumberOfTimeSteps();
+
+  double GetTime(int step);
+
+  /**
+   * Return the velocity of all points at a time step, as numberOfPoints x 3 floats, reading it
+   * from the file if it is not cached. The pointer stays valid until
+   * MaximumNumberOfCachedTimeSteps other time steps have been requested from this series, even if
+   * the series sharing its cache evict the time step. Returns NULL on error.
+   */
+  const float* GetTimeStep(int step);
+
+  /**
+   * Copy the velocity of all points at a time step into a 3-component array, resized to the
+   * number of points. Returns 1 on success.
+   */
+  int CopyTimeStep(int step, vtkDataArray* velocity);
+
+  /**
+   * Number of time steps read from the file since Open, by this series and the series sharing
+   * its cache.
+   */
+  vtkIdType GetNumberOfTimeStepReads();
+
+//BTX
+  enum
+  {
+    STORAGE_FLOAT,
+    STORAGE_QUANTIZED_16
+  };
+//ETX
+
+  protected:
+  vtkvmtkVelocityTimeSeries();
+  ~vtkvmtkVelocityTimeSeries();
+
+  int AppendTimeStep(double time, vtkDataArray* arrays[3], int components[3]);
+
+  char* FileName;
+  int StorageType;
+  int MaximumNumberOfCachedTimeSteps;
+
+  vtkIdType NumberOfPoints;
+
+  vtkvmtkVelocityTimeSeriesInternals* Internals;
+
+  private:
+  vtkvmtkVelocityTimeSeries(const vtkvmtkVelocityTimeSeries&);  // Not implemented.
+  void operator=(const vtkvmtkVelocityTimeSeries&);  // Not implemented.
+};
+
+#endif
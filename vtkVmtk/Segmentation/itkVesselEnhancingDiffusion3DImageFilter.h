@@ -7,6 +7,8 @@
 #define __itkVesselEnhancingDiffusion3DImageFilter_h
 
 #include "itkImageToImageFilter.h"
+#include "itkPlatformMultiThreader.h"
+#include "itkSymmetricSecondRankTensor.h"
 #include <vector>
 
 namespace itk
@@ -32,14 +34,22 @@ namespace itk
  *   diffusion. An alternative implementation is to only store the
  *   scale for which the vesselness has maximum response, and to
  *   recalculate the hessian (locally) during diffusion. Also stores
- *   the current image, ie at iteration i + temp image, therefore the complete
- *   memory consumption approximately peaks at 8 times the input image
- *   (input image in float)
- * - The hessian is stored as six individual images, an alternative 
- *   implementation is to use the itk symmetric second rank tensor
- *   as pixeltype (and eg using the class SymmetricEigenAnalysisImage
- *   Filter). However, we are lazy, and using this since we rely
- *   on vnl datatypes and its eigensystem calculations
+ *   the current image, ie at iteration i + temp image, and the
+ *   maximum vesselness, therefore the complete memory consumption
+ *   approximately peaks at 9 times the input image (input image in
+ *   float), plus the float Hessian of the scale being evaluated
+ * - The hessian (and then the diffusion tensor) is stored packed in
+ *   a single float buffer, six symmetric components (xx xy xz yy yz zz)
+ *   per voxel, so that the stencil reads neighbouring tensors from
+ *   one contiguous block
+ * - The per-voxel vesselness, diffusion tensor and diffusion update
+ *   passes are split in slabs along z and run on the filter's
+ *   multithreader; the Hessian at each scale is computed by the
+ *   (multithreaded) HessianRecursiveGaussianImageFilter, in float
+ * - With UseNarrowBand on, vesselness recalculations after the first
+ *   only revisit voxels with positive vesselness at the previous
+ *   calculation and their 26 neighbours; elsewhere the diffusion
+ *   tensor is kept. The band grows by one voxel at each recalculation
  * - note: most of computation time is spent at calculation of vesselness
  *   response
  *
@@ -48,7 +58,6 @@ namespace itk
  *
  *
  * - todo
- *   - using parallelism/threading eg over scales
  *   - completely itk-fying, eg eigenvalues calculation
  *   - possibly embedding within itk-diffusion framework
  *   - itk expert to have a look at use of iterators
@@ -72,6 +81,8 @@ public:
     typedef float                                           Precision;
     typedef Image<PixelType, Dimension>                     ImageType;
     typedef Image<Precision,Dimension>                      PrecisionImageType;
+    typedef SymmetricSecondRankTensor<Precision,Dimension>  HessianPixelType;
+    typedef Image<HessianPixelType,Dimension>               HessianImageType;
 
     typedef VesselEnhancingDiffusion3DImageFilter           Self;
     typedef ImageToImageFilter<ImageType,ImageType>         Superclass;
@@ -101,6 +112,9 @@ public:
     itkSetMacro(DarkObjectLightBackground,bool);
     itkBooleanMacro(Verbose);
     itkSetMacro(Verbose,bool);
+    itkBooleanMacro(UseNarrowBand);
+    itkSetMacro(UseNarrowBand,bool);
+    itkGetConstMacro(UseNarrowBand,bool);
 
     // some defaults for lowdose example
     // used in the paper
@@ -125,6 +139,7 @@ public:
 
         m_DarkObjectLightBackground = false;
         m_Verbose                   = true;
+        m_UseNarrowBand             = false;
     }
 
 protected: 
@@ -150,23 +165,30 @@ private:
     std::vector<Precision>          m_Scales;   
     bool                            m_DarkObjectLightBackground;
     bool                            m_Verbose;
+    bool                            m_UseNarrowBand;
 
     unsigned int                    m_CurrentIteration;
 
-    // current hessian for which we have max vesselresponse
-    typename PrecisionImageType::Pointer m_Dxx;
-    typename PrecisionImageType::Pointer m_Dxy;
-    typename PrecisionImageType::Pointer m_Dxz;
-    typename PrecisionImageType::Pointer m_Dyy;
-    typename PrecisionImageType::Pointer m_Dyz;
-    typename PrecisionImageType::Pointer m_Dzz;
+    // image size, voxels are indexed x + nx * (y + ny * z)
+    typename PrecisionImageType::SizeType m_Size;
 
-    void VED3DSingleIteration (typename ImageType::Pointer );
+    // current hessian for which we have max vesselresponse,
+    // packed xx xy xz yy yz zz per voxel, replaced in place
+    // by the diffusion tensor
+    std::vector<Precision>          m_Tensors;
+    std::vector<Precision>          m_Vesselness;
+    // voxels revisited by a narrow band recalculation
+    std::vector<unsigned char>      m_Band;
+    bool                            m_BandActive;
+    // result of a diffusion iteration, copied back to the image
+    std::vector<Precision>          m_Update;
+
+    void VED3DSingleIteration (typename PrecisionImageType::Pointer );
 
     // Calculates maxvessel response of the range
     // of scales and stores the hessian of each voxel
-    // into the member images m_Dij. 
-    void MaxVesselResponse (const typename ImageType::Pointer);
+    // into m_Tensors. 
+    void MaxVesselResponse (const typename PrecisionImageType::Pointer);
 
     // calculates diffusion tensor
     // based on current values of hessian (for which we have
@@ -177,7 +199,36 @@ private:
             const Precision,    // l1
             const Precision,    // l2
             const Precision     // l3
-            );
+            ) const;
+
+    // passes over the voxels, run in z slabs by ThreaderCallback
+    enum
+    {
+        BAND_PASS,
+        RESET_PASS,
+        VESSELNESS_PASS,
+        TENSOR_PASS,
+        DIFFUSION_PASS,
+        COPY_PASS
+    };
+
+    struct VEDThreadStruct
+    {
+        VesselEnhancingDiffusion3DImageFilter *Filter;
+        int Pass;
+        const HessianPixelType *Hessian;
+        Precision *Image;
+    };
+
+    void ExecutePass (int pass, const HessianPixelType *hessian, Precision *image);
+    static itk::ITK_THREAD_RETURN_TYPE ThreaderCallback (void *arg);
+
+    void ThreadedBand (SizeValueType zBegin, SizeValueType zEnd);
+    void ThreadedReset (SizeValueType zBegin, SizeValueType zEnd);
+    void ThreadedVesselness (const HessianPixelType *hessian, SizeValueType zBegin, SizeValueType zEnd);
+    void ThreadedDiffusionTensor (SizeValueType zBegin, SizeValueType zEnd);
+    void ThreadedDiffusion (const Precision *image, SizeValueType zBegin, SizeValueType zEnd);
+    void ThreadedCopy (Precision *image, SizeValueType zBegin, SizeValueType zEnd);
 
 
 };
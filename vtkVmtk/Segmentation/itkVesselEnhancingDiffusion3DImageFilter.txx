@@ -12,20 +12,16 @@
 #include "itkVesselEnhancingDiffusion3DImageFilter.h"
 
 #include "itkCastImageFilter.h"
-#include "itkConstShapedNeighborhoodIterator.h"
 #include "itkHessianRecursiveGaussianImageFilter.h"
-#include "itkImageRegionConstIterator.h"
-#include "itkImageRegionIterator.h"
 #include "itkMinimumMaximumImageFilter.h"
-#include "itkNeighborhoodAlgorithm.h"
 #include "itkNumericTraits.h"
-#include "itkZeroFluxNeumannBoundaryCondition.h"
 
 #include <vnl/vnl_vector.h>
 #include <vnl/vnl_matrix.h>
 #include <vnl/algo/vnl_symmetric_eigensystem.h>
 
-#include<iostream>
+#include <algorithm>
+#include <iostream>
 
 namespace itk
 {
@@ -40,7 +36,9 @@ VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
     m_Epsilon(0.0),
     m_Omega(0.0),
     m_Sensitivity(0.0),
-    m_DarkObjectLightBackground(false)
+    m_DarkObjectLightBackground(false),
+    m_UseNarrowBand(false),
+    m_BandActive(false)
 {
 	this->SetNumberOfRequiredInputs(1);
 }
@@ -62,11 +60,12 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
 	os << indent << "Omega 			            : " << m_Omega << std::endl;
 	os << indent << "Sensitivity 		        : " << m_Sensitivity << std::endl;
   	os << indent << "DarkObjectLightBackground  : " << m_DarkObjectLightBackground << std::endl;
+	os << indent << "UseNarrowBand              : " << m_UseNarrowBand << std::endl;
 }
 // singleiter
 template <class PixelType, unsigned int Dimension>
 void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
-::VED3DSingleIteration(typename ImageType::Pointer ci)
+::VED3DSingleIteration(typename PrecisionImageType::Pointer ci)
 {
     bool rec(false);
     if ( 
@@ -95,444 +94,52 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
         }
     }
 
-
     // calculate d = nonlineardiffusion(ci)
     // using 3x3x3 stencil, afterwards copy
     // result from d back to ci
-    typename PrecisionImageType::Pointer d = PrecisionImageType::New();
-    d->SetOrigin(ci->GetOrigin());
-    d->SetSpacing(ci->GetSpacing());
-    d->SetDirection(ci->GetDirection());
-    d->SetRegions(ci->GetLargestPossibleRegion());
-    d->Allocate();
-    d->FillBuffer(NumericTraits<Precision>::Zero);
-
-    // shapedneighborhood iter, zeroflux boundary condition
-    // division into faces and inner region
-    typedef ZeroFluxNeumannBoundaryCondition<PrecisionImageType>    BT;
-    typedef ConstShapedNeighborhoodIterator<PrecisionImageType,BT>  NT;
-    typedef typename NeighborhoodAlgorithm::ImageBoundaryFacesCalculator<PrecisionImageType> 
-                                                                    FT; 
-    BT                      b;
-    typename NT::RadiusType r;
-    r.Fill(1);
-
-
-    // offsets
-    const typename NT::OffsetType oxp = {{1,0,0}};
-    const typename NT::OffsetType oxm = {{-1,0,0}};
-    const typename NT::OffsetType oyp = {{0,1,0}};
-    const typename NT::OffsetType oym = {{0,-1,0}};
-    const typename NT::OffsetType ozp = {{0,0,1}};
-    const typename NT::OffsetType ozm = {{0,0,-1}};
-
-    const typename NT::OffsetType oxpyp = {{1,1,0}};
-    const typename NT::OffsetType oxmym = {{-1,-1,0}};
-    const typename NT::OffsetType oxpym = {{1,-1,0}};
-    const typename NT::OffsetType oxmyp = {{-1,1,0}};
-
-    const typename NT::OffsetType oxpzp = {{1,0,1}};
-    const typename NT::OffsetType oxmzm = {{-1,0,-1}};
-    const typename NT::OffsetType oxpzm = {{1,0,-1}};
-    const typename NT::OffsetType oxmzp = {{-1,0,1}};
-
-    const typename NT::OffsetType oypzp = {{0,1,1}};
-    const typename NT::OffsetType oymzm = {{0,-1,-1}};
-    const typename NT::OffsetType oypzm = {{0,1,-1}};
-    const typename NT::OffsetType oymzp = {{0,-1,1}};
+    m_Update.resize(m_Tensors.size() / 6);
 
-    // fixed weights (timers)
-	const typename PrecisionImageType::SpacingType ispacing = ci->GetSpacing();
-    const Precision rxx = m_TimeStep / (2.0 * ispacing[0] * ispacing[0]);
-    const Precision ryy = m_TimeStep / (2.0 * ispacing[1] * ispacing[1]);
-    const Precision rzz = m_TimeStep / (2.0 * ispacing[2] * ispacing[2]);
-    const Precision rxy = m_TimeStep / (4.0 * ispacing[0] * ispacing[1]);
-    const Precision rxz = m_TimeStep / (4.0 * ispacing[0] * ispacing[2]);
-    const Precision ryz = m_TimeStep / (4.0 * ispacing[1] * ispacing[2]);
-
-    // faces
-    FT                            fc;
-    typename FT::FaceListType     fci = fc(ci,d->GetLargestPossibleRegion(),r);
-    typename FT::FaceListType     fxx = fc(m_Dxx,d->GetLargestPossibleRegion(),r);
-    typename FT::FaceListType     fxy = fc(m_Dxy,d->GetLargestPossibleRegion(),r);
-    typename FT::FaceListType     fxz = fc(m_Dxz,d->GetLargestPossibleRegion(),r);
-    typename FT::FaceListType     fyy = fc(m_Dyy,d->GetLargestPossibleRegion(),r);
-    typename FT::FaceListType     fyz = fc(m_Dyz,d->GetLargestPossibleRegion(),r);
-    typename FT::FaceListType     fzz = fc(m_Dzz,d->GetLargestPossibleRegion(),r);
-
-    typename FT::FaceListType::iterator fitci,fitxx,fitxy,fitxz,fityy,fityz,fitzz;
-
-    for ( fitci = fci.begin(),
-            fitxx = fxx.begin(), fitxy = fxy.begin(), fitxz = fxz.begin(),
-            fityy = fyy.begin(), fityz = fyz.begin(), fitzz = fzz.begin();
-            fitci != fci.end();
-            ++fitci, ++fitxx, ++fitxy, ++fitxz, ++fityy, ++fityz, ++fitzz)
-    {
-        // output iter
-        ImageRegionIterator<PrecisionImageType> dit(d,*fitci);
-
-        // input iters
-        NT itci (r,ci,*fitci);
-        NT itxx (r,m_Dxx,*fitxx);
-        NT itxy (r,m_Dxy,*fitxy);
-        NT itxz (r,m_Dxz,*fitxz);
-        NT ityy (r,m_Dyy,*fityy);
-        NT ityz (r,m_Dyz,*fityz);
-        NT itzz (r,m_Dzz,*fitzz);
-
-        itci.OverrideBoundaryCondition(&b);
-        itxx.OverrideBoundaryCondition(&b);
-        itxy.OverrideBoundaryCondition(&b);
-        itxz.OverrideBoundaryCondition(&b);
-        ityy.OverrideBoundaryCondition(&b);
-        ityz.OverrideBoundaryCondition(&b);
-        itzz.OverrideBoundaryCondition(&b);
-
-        // setting active offsets (yeah there must
-        // be some smarter way of doing this)
-        itci.ClearActiveList();
-        itxx.ClearActiveList();
-        itxy.ClearActiveList();
-        itxz.ClearActiveList();
-        ityy.ClearActiveList();
-        ityz.ClearActiveList();
-        itzz.ClearActiveList();
-
-        itci.ActivateOffset(oxp);
-        itxx.ActivateOffset(oxp);
-        itxy.ActivateOffset(oxp);
-        itxz.ActivateOffset(oxp);
-        ityy.ActivateOffset(oxp);
-        ityz.ActivateOffset(oxp);
-        itzz.ActivateOffset(oxp);
-
-        itci.ActivateOffset(oxm);
-        itxx.ActivateOffset(oxm);
-        itxy.ActivateOffset(oxm);
-        itxz.ActivateOffset(oxm);
-        ityy.ActivateOffset(oxm);
-        ityz.ActivateOffset(oxm);
-        itzz.ActivateOffset(oxm);
-
-        itci.ActivateOffset(oyp);
-        itxx.ActivateOffset(oyp);
-        itxy.ActivateOffset(oyp);
-        itxz.ActivateOffset(oyp);
-        ityy.ActivateOffset(oyp);
-        ityz.ActivateOffset(oyp);
-        itzz.ActivateOffset(oyp);
-
-        itci.ActivateOffset(oym);
-        itxx.ActivateOffset(oym);
-        itxy.ActivateOffset(oym);
-        itxz.ActivateOffset(oym);
-        ityy.ActivateOffset(oym);
-        ityz.ActivateOffset(oym);
-        itzz.ActivateOffset(oym);
-
-        itci.ActivateOffset(ozp);
-        itxx.ActivateOffset(ozp);
-        itxy.ActivateOffset(ozp);
-        itxz.ActivateOffset(ozp);
-        ityy.ActivateOffset(ozp);
-        ityz.ActivateOffset(ozp);
-        itzz.ActivateOffset(ozp);
-
-        itci.ActivateOffset(ozm);
-        itxx.ActivateOffset(ozm);
-        itxy.ActivateOffset(ozm);
-        itxz.ActivateOffset(ozm);
-        ityy.ActivateOffset(ozm);
-        ityz.ActivateOffset(ozm);
-        itzz.ActivateOffset(ozm);
-
-        itci.ActivateOffset(oxpyp);
-        itxx.ActivateOffset(oxpyp);
-        itxy.ActivateOffset(oxpyp);
-        itxz.ActivateOffset(oxpyp);
-        ityy.ActivateOffset(oxpyp);
-        ityz.ActivateOffset(oxpyp);
-        itzz.ActivateOffset(oxpyp);
-
-        itci.ActivateOffset(oxmym);
-        itxx.ActivateOffset(oxmym);
-        itxy.ActivateOffset(oxmym);
-        itxz.ActivateOffset(oxmym);
-        ityy.ActivateOffset(oxmym);
-        ityz.ActivateOffset(oxmym);
-        itzz.ActivateOffset(oxmym);
-
-        itci.ActivateOffset(oxpym);
-        itxx.ActivateOffset(oxpym);
-        itxy.ActivateOffset(oxpym);
-        itxz.ActivateOffset(oxpym);
-        ityy.ActivateOffset(oxpym);
-        ityz.ActivateOffset(oxpym);
-        itzz.ActivateOffset(oxpym);
-
-        itci.ActivateOffset(oxmyp);
-        itxx.ActivateOffset(oxmyp);
-        itxy.ActivateOffset(oxmyp);
-        itxz.ActivateOffset(oxmyp);
-        ityy.ActivateOffset(oxmyp);
-        ityz.ActivateOffset(oxmyp);
-        itzz.ActivateOffset(oxmyp);
-
-        itci.ActivateOffset(oxpzp);
-        itxx.ActivateOffset(oxpzp);
-        itxy.ActivateOffset(oxpzp);
-        itxz.ActivateOffset(oxpzp);
-        ityy.ActivateOffset(oxpzp);
-        ityz.ActivateOffset(oxpzp);
-        itzz.ActivateOffset(oxpzp);
-
-        itci.ActivateOffset(oxmzm);
-        itxx.ActivateOffset(oxmzm);
-        itxy.ActivateOffset(oxmzm);
-        itxz.ActivateOffset(oxmzm);
-        ityy.ActivateOffset(oxmzm);
-        ityz.ActivateOffset(oxmzm);
-        itzz.ActivateOffset(oxmzm);
-
-        itci.ActivateOffset(oxpzm);
-        itxx.ActivateOffset(oxpzm);
-        itxy.ActivateOffset(oxpzm);
-        itxz.ActivateOffset(oxpzm);
-        ityy.ActivateOffset(oxpzm);
-        ityz.ActivateOffset(oxpzm);
-        itzz.ActivateOffset(oxpzm);
-
-        itci.ActivateOffset(oxmzp);
-        itxx.ActivateOffset(oxmzp);
-        itxy.ActivateOffset(oxmzp);
-        itxz.ActivateOffset(oxmzp);
-        ityy.ActivateOffset(oxmzp);
-        ityz.ActivateOffset(oxmzp);
-        itzz.ActivateOffset(oxmzp);
-
-        itci.ActivateOffset(oypzp);
-        itxx.ActivateOffset(oypzp);
-        itxy.ActivateOffset(oypzp);
-        itxz.ActivateOffset(oypzp);
-        ityy.ActivateOffset(oypzp);
-        ityz.ActivateOffset(oypzp);
-        itzz.ActivateOffset(oypzp);
-
-        itci.ActivateOffset(oymzm);
-        itxx.ActivateOffset(oymzm);
-        itxy.ActivateOffset(oymzm);
-        itxz.ActivateOffset(oymzm);
-        ityy.ActivateOffset(oymzm);
-        ityz.ActivateOffset(oymzm);
-        itzz.ActivateOffset(oymzm);
-
-        itci.ActivateOffset(oypzm);
-        itxx.ActivateOffset(oypzm);
-        itxy.ActivateOffset(oypzm);
-        itxz.ActivateOffset(oypzm);
-        ityy.ActivateOffset(oypzm);
-        ityz.ActivateOffset(oypzm);
-        itzz.ActivateOffset(oypzm);
-
-        itci.ActivateOffset(oymzp);
-        itxx.ActivateOffset(oymzp);
-        itxy.ActivateOffset(oymzp);
-        itxz.ActivateOffset(oymzp);
-        ityy.ActivateOffset(oymzp);
-        ityz.ActivateOffset(oymzp);
-        itzz.ActivateOffset(oymzp);
-
-        // run for each face diffusion
-        for (itci.GoToBegin(), dit.GoToBegin(),
-                itxx.GoToBegin(),itxy.GoToBegin(), itxz.GoToBegin(),
-                ityy.GoToBegin(),ityz.GoToBegin(), itzz.GoToBegin();
-                !itci.IsAtEnd();
-                ++itci, ++dit, ++itxx, ++itxy, ++itxz, ++ityy, ++ityz, ++itzz)
-        {
-            // weights
-            const Precision xp = itxx.GetPixel(oxp) + itxx.GetCenterPixel();
-            const Precision xm = itxx.GetPixel(oxm) + itxx.GetCenterPixel();
-            const Precision yp = ityy.GetPixel(oyp) + ityy.GetCenterPixel();
-            const Precision ym = ityy.GetPixel(oym) + ityy.GetCenterPixel();
-            const Precision zp = itzz.GetPixel(ozp) + itzz.GetCenterPixel();
-            const Precision zm = itzz.GetPixel(ozm) + itzz.GetCenterPixel();
-
-            const Precision xpyp = itxy.GetPixel(oxpyp) + itxy.GetCenterPixel();
-            const Precision xmym = itxy.GetPixel(oxmym) + itxy.GetCenterPixel();
-            const Precision xpym = - itxy.GetPixel(oxpym) - itxy.GetCenterPixel();
-            const Precision xmyp = - itxy.GetPixel(oxmyp) - itxy.GetCenterPixel();
-
-            const Precision xpzp =   itxz.GetPixel(oxpzp) + itxz.GetCenterPixel();
-            const Precision xmzm =   itxz.GetPixel(oxmzm) + itxz.GetCenterPixel();
-            const Precision xpzm = - itxz.GetPixel(oxpzm) - itxz.GetCenterPixel();
-            const Precision xmzp = - itxz.GetPixel(oxmzp) - itxz.GetCenterPixel();
-
-            const Precision ypzp =   ityz.GetPixel(oypzp) + ityz.GetCenterPixel();
-            const Precision ymzm =   ityz.GetPixel(oymzm) + ityz.GetCenterPixel();
-            const Precision ypzm = - ityz.GetPixel(oypzm) - ityz.GetCenterPixel();
-            const Precision ymzp = - ityz.GetPixel(oymzp) - ityz.GetCenterPixel();
-
-            // evolution
-            const Precision cv = itci.GetCenterPixel();
-            dit.Value() = cv + 
-                + rxx * ( xp * (itci.GetPixel(oxp) - cv)
-                        + xm * (itci.GetPixel(oxm) - cv) )
-                + ryy * ( yp * (itci.GetPixel(oyp) - cv)
-                        + ym * (itci.GetPixel(oym) - cv) )
-                + rzz * ( zp * (itci.GetPixel(ozp) - cv)
-                        + zm * (itci.GetPixel(ozm) - cv) )
-                + rxy * ( xpyp * (itci.GetPixel(oxpyp) - cv)
-                        + xmym * (itci.GetPixel(oxmym) - cv)
-                        + xpym * (itci.GetPixel(oxpym) - cv)
-                        + xmyp * (itci.GetPixel(oxmyp) - cv) )
-                + rxz * ( xpzp * (itci.GetPixel(oxpzp) - cv)
-                        + xmzm * (itci.GetPixel(oxmzm) - cv)
-                        + xpzm * (itci.GetPixel(oxpzm) - cv)
-                        + xmzp * (itci.GetPixel(oxmzp) - cv) )
-                + ryz * ( ypzp * (itci.GetPixel(oypzp) - cv)
-                        + ymzm * (itci.GetPixel(oymzm) - cv)
-                        + ypzm * (itci.GetPixel(oypzm) - cv)
-                        + ymzp * (itci.GetPixel(oymzp) - cv) );
-
-        }
-    }
-
-    // copying
-    ImageRegionConstIterator<PrecisionImageType> iti (d,d->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType>      ito (ci,ci->GetLargestPossibleRegion());
-    for (iti.GoToBegin(), ito.GoToBegin(); !iti.IsAtEnd(); ++iti,++ito)
-    {
-        ito.Value() = iti.Value();
-    }
+    ExecutePass(DIFFUSION_PASS, NULL, ci->GetBufferPointer());
+    ExecutePass(COPY_PASS, NULL, ci->GetBufferPointer());
 
     return;
 } 
 // maxvesselresponse
 template <class PixelType, unsigned int Dimension>
 void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
-::MaxVesselResponse(const typename ImageType::Pointer im)	
+::MaxVesselResponse(const typename PrecisionImageType::Pointer im)	
 {
+    const SizeValueType numberOfVoxels = m_Size[0] * m_Size[1] * m_Size[2];
+
+    // the first calculation, and every calculation without narrow
+    // band, revisits all voxels; the band is built from the
+    // vesselness of the previous calculation
+    m_BandActive = false;
+    if (m_UseNarrowBand && m_Vesselness.size() == numberOfVoxels)
+    {
+        m_Band.resize(numberOfVoxels);
+        ExecutePass(BAND_PASS, NULL, NULL);
+        m_BandActive = true;
+    }
+    else
+    {
+        m_Tensors.resize(6 * numberOfVoxels);
+        m_Vesselness.resize(numberOfVoxels);
+    }
 
-    // alloc memory for hessian/tensor
-    m_Dxx = PrecisionImageType::New();
-    m_Dxx->SetOrigin(im->GetOrigin());
-    m_Dxx->SetSpacing(im->GetSpacing());
-    m_Dxx->SetDirection(im->GetDirection());
-    m_Dxx->SetRegions(im->GetLargestPossibleRegion());
-    m_Dxx->Allocate();
-    m_Dxx->FillBuffer(NumericTraits<Precision>::One);
-
-    m_Dxy = PrecisionImageType::New();
-    m_Dxy->SetOrigin(im->GetOrigin());
-    m_Dxy->SetSpacing(im->GetSpacing());
-    m_Dxy->SetDirection(im->GetDirection());
-    m_Dxy->SetRegions(im->GetLargestPossibleRegion());
-    m_Dxy->Allocate();
-    m_Dxy->FillBuffer(NumericTraits<Precision>::Zero);
-
-    m_Dxz = PrecisionImageType::New();
-    m_Dxz->SetOrigin(im->GetOrigin());
-    m_Dxz->SetSpacing(im->GetSpacing());
-    m_Dxz->SetDirection(im->GetDirection());
-    m_Dxz->SetRegions(im->GetLargestPossibleRegion());
-    m_Dxz->Allocate();
-    m_Dxz->FillBuffer(NumericTraits<Precision>::Zero);
-
-    m_Dyy = PrecisionImageType::New();
-    m_Dyy->SetOrigin(im->GetOrigin());
-    m_Dyy->SetSpacing(im->GetSpacing());
-    m_Dyy->SetDirection(im->GetDirection());
-    m_Dyy->SetRegions(im->GetLargestPossibleRegion());
-    m_Dyy->Allocate();
-    m_Dyy->FillBuffer(NumericTraits<Precision>::One);
-
-    m_Dyz = PrecisionImageType::New();
-    m_Dyz->SetOrigin(im->GetOrigin());
-    m_Dyz->SetSpacing(im->GetSpacing());
-    m_Dyz->SetDirection(im->GetDirection());
-    m_Dyz->SetRegions(im->GetLargestPossibleRegion());
-    m_Dyz->Allocate();
-    m_Dyz->FillBuffer(NumericTraits<Precision>::Zero);
-
-    m_Dzz = PrecisionImageType::New();
-    m_Dzz->SetOrigin(im->GetOrigin());
-    m_Dzz->SetSpacing(im->GetSpacing());
-    m_Dzz->SetDirection(im->GetDirection());
-    m_Dzz->SetRegions(im->GetLargestPossibleRegion());
-    m_Dzz->Allocate();
-    m_Dzz->FillBuffer(NumericTraits<Precision>::One);
-
-
-	// create temp vesselness image to store maxvessel
-	typename PrecisionImageType::Pointer vi = PrecisionImageType::New();
-
-	vi->SetOrigin(im->GetOrigin());
-	vi->SetSpacing(im->GetSpacing());
-	vi->SetDirection(im->GetDirection());
-	vi->SetRegions(im->GetLargestPossibleRegion());
-	vi->Allocate();
-    vi->FillBuffer(NumericTraits<Precision>::Zero);
-    
+    // unit hessian and zero vesselness where the maxvessel is searched
+    ExecutePass(RESET_PASS, NULL, NULL);
 
 	for (unsigned int i=0; i< m_Scales.size(); ++i)
 	{
-        typedef HessianRecursiveGaussianImageFilter<PrecisionImageType> HessianType;
+        typedef HessianRecursiveGaussianImageFilter<PrecisionImageType,HessianImageType> HessianType;
         typename HessianType::Pointer hessian = HessianType::New();
         hessian->SetInput(im);
         hessian->SetNormalizeAcrossScale(true);
         hessian->SetSigma(m_Scales[i]);
         hessian->Update();
 
-        ImageRegionIterator<PrecisionImageType> itxx (m_Dxx, m_Dxx->GetLargestPossibleRegion());
-        ImageRegionIterator<PrecisionImageType> itxy (m_Dxy, m_Dxy->GetLargestPossibleRegion());
-        ImageRegionIterator<PrecisionImageType> itxz (m_Dxz, m_Dxz->GetLargestPossibleRegion());
-        ImageRegionIterator<PrecisionImageType> ityy (m_Dyy, m_Dyy->GetLargestPossibleRegion());
-        ImageRegionIterator<PrecisionImageType> ityz (m_Dyz, m_Dyz->GetLargestPossibleRegion());
-        ImageRegionIterator<PrecisionImageType> itzz (m_Dzz, m_Dzz->GetLargestPossibleRegion());
-        ImageRegionIterator<PrecisionImageType> vit(vi, vi->GetLargestPossibleRegion());
-
-        ImageRegionConstIterator<typename HessianType::OutputImageType> hit 
-            (hessian->GetOutput(), hessian->GetOutput()->GetLargestPossibleRegion());
-
-        for (itxx.GoToBegin(), itxy.GoToBegin(), itxz.GoToBegin(), 
-                ityy.GoToBegin(), ityz.GoToBegin(), itzz.GoToBegin(),
-                vit.GoToBegin(), hit.GoToBegin(); !vit.IsAtEnd(); 
-                ++itxx, ++itxy, ++itxz, ++ityy, ++ityz, ++itzz, ++hit, ++vit)
-        {
-            vnl_matrix<Precision> H(3,3);
-
-            H(0,0) = hit.Value()(0,0);
-            H(0,1) = H(1,0) = hit.Value()(0,1);
-            H(0,2) = H(2,0) = hit.Value()(0,2);
-            H(1,1) = hit.Value()(1,1);
-            H(1,2) = H(2,1) = hit.Value()(1,2);
-            H(2,2) = hit.Value()(2,2);
-
-            vnl_symmetric_eigensystem<Precision> ES(H);
-            vnl_vector<Precision> ev(3);
-
-            ev[0] = ES.get_eigenvalue(0); 
-            ev[1] = ES.get_eigenvalue(1); 
-            ev[2] = ES.get_eigenvalue(2);
-
-            if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
-            if ( vcl_abs(ev[1]) > vcl_abs(ev[2])  ) std::swap(ev[1], ev[2]);
-            if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
-
-			const Precision vesselness = VesselnessFunction3D(ev[0],ev[1],ev[2]);
-
-			if ( vesselness > 0 && vesselness > vit.Value() )
-			{
-				vit.Value() = vesselness;
-
-                itxx.Value() = hit.Value()(0,0);
-                itxy.Value() = hit.Value()(0,1);
-                itxz.Value() = hit.Value()(0,2);
-                ityy.Value() = hit.Value()(1,1);
-                ityz.Value() = hit.Value()(1,2);
-                itzz.Value() = hit.Value()(2,2);
-			}
-		} 
+        ExecutePass(VESSELNESS_PASS, hessian->GetOutput()->GetBufferPointer(), NULL);
 	} 
  
     return;
@@ -546,7 +153,7 @@ VesselEnhancingDiffusion3DImageFilter<PixelType,Dimension>::VesselnessFunction3D
 	const Precision l1,
 	const Precision l2,
 	const Precision l3
-)
+) const
 			
 {
 	Precision vesselness;
@@ -586,34 +193,221 @@ template <class PixelType, unsigned int Dimension>
 void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
 ::DiffusionTensor() 
 {
-    ImageRegionIterator<PrecisionImageType> itxx (m_Dxx, m_Dxx->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> itxy (m_Dxy, m_Dxy->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> itxz (m_Dxz, m_Dxz->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> ityy (m_Dyy, m_Dyy->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> ityz (m_Dyz, m_Dyz->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> itzz (m_Dzz, m_Dzz->GetLargestPossibleRegion());
-
-    for  ( itxx.GoToBegin(), itxy.GoToBegin(), itxz.GoToBegin(),
-            ityy.GoToBegin(), ityz.GoToBegin(), itzz.GoToBegin();
-            !itxx.IsAtEnd();
-            ++itxx, ++itxy, ++itxz, ++ityy, ++ityz, ++itzz)
+    ExecutePass(TENSOR_PASS, NULL, NULL);
+    return;
+
+} 
+// executepass
+template <class PixelType, unsigned int Dimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::ExecutePass(int pass, const HessianPixelType *hessian, Precision *image)
+{
+    VEDThreadStruct str;
+    str.Filter = this;
+    str.Pass = pass;
+    str.Hessian = hessian;
+    str.Image = image;
+#if (ITK_VERSION_MAJOR >= 5)
+    this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+#else
+    this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfThreads());
+#endif
+    this->GetMultiThreader()->SetSingleMethod(this->ThreaderCallback, &str);
+    this->GetMultiThreader()->SingleMethodExecute();
+}
+// threadercallback
+template <class PixelType, unsigned int Dimension>
+itk::ITK_THREAD_RETURN_TYPE
+VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::ThreaderCallback(void *arg)
+{
+#if (ITK_VERSION_MAJOR >= 5)
+    using Info = PlatformMultiThreader::WorkUnitInfo;
+    const auto info = reinterpret_cast<const Info *>(arg);
+    const SizeValueType threadId = info->WorkUnitID;
+    const SizeValueType threadCount = info->NumberOfWorkUnits;
+    const auto str = reinterpret_cast<VEDThreadStruct *>(info->UserData);
+#else
+    const SizeValueType threadId = ((PlatformMultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+    const SizeValueType threadCount = ((PlatformMultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+    VEDThreadStruct *str = (VEDThreadStruct *)(((PlatformMultiThreader::ThreadInfoStruct *)(arg))->UserData);
+#endif
+
+    // slab of z planes of this thread
+    const SizeValueType nz = str->Filter->m_Size[2];
+    const SizeValueType zBegin = threadId * nz / threadCount;
+    const SizeValueType zEnd = (threadId + 1) * nz / threadCount;
+
+    if (zBegin < zEnd)
+    {
+        switch (str->Pass)
+        {
+        case BAND_PASS:
+            str->Filter->ThreadedBand(zBegin, zEnd);
+            break;
+        case RESET_PASS:
+            str->Filter->ThreadedReset(zBegin, zEnd);
+            break;
+        case VESSELNESS_PASS:
+            str->Filter->ThreadedVesselness(str->Hessian, zBegin, zEnd);
+            break;
+        case TENSOR_PASS:
+            str->Filter->ThreadedDiffusionTensor(zBegin, zEnd);
+            break;
+        case DIFFUSION_PASS:
+            str->Filter->ThreadedDiffusion(str->Image, zBegin, zEnd);
+            break;
+        case COPY_PASS:
+            str->Filter->ThreadedCopy(str->Image, zBegin, zEnd);
+            break;
+        }
+    }
+
+// Under the single-threaded Emscripten/WebAssembly configuration the thread
+// callback return type is void, so no value may be returned.
+#if !defined(__EMSCRIPTEN__)
+#if ITK_VERSION_MAJOR >= 5
+    return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+    return ITK_THREAD_RETURN_VALUE;
+#endif
+#endif
+}
+// threadedband
+template <class PixelType, unsigned int Dimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::ThreadedBand(SizeValueType zBegin, SizeValueType zEnd)
+{
+    // a voxel is in the band if it or one of its 26 neighbours
+    // had a positive vesselness
+    const SizeValueType nx = m_Size[0], ny = m_Size[1], nz = m_Size[2];
+    for (SizeValueType z=zBegin; z<zEnd; ++z)
+    {
+        const SizeValueType z0 = z > 0 ? z-1 : 0, z1 = z < nz-1 ? z+1 : nz-1;
+        for (SizeValueType y=0; y<ny; ++y)
+        {
+            const SizeValueType y0 = y > 0 ? y-1 : 0, y1 = y < ny-1 ? y+1 : ny-1;
+            for (SizeValueType x=0; x<nx; ++x)
+            {
+                const SizeValueType x0 = x > 0 ? x-1 : 0, x1 = x < nx-1 ? x+1 : nx-1;
+                unsigned char inBand = 0;
+                for (SizeValueType k=z0; k<=z1 && !inBand; ++k)
+                {
+                    for (SizeValueType j=y0; j<=y1 && !inBand; ++j)
+                    {
+                        const Precision *v = &m_Vesselness[nx * (j + ny * k)];
+                        for (SizeValueType i=x0; i<=x1; ++i)
+                        {
+                            if (v[i] > 0)
+                            {
+                                inBand = 1;
+                                break;
+                            }
+                        }
+                    }
+                }
+                m_Band[x + nx * (y + ny * z)] = inBand;
+            }
+        }
+    }
+}
+// threadedreset
+template <class PixelType, unsigned int Dimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::ThreadedReset(SizeValueType zBegin, SizeValueType zEnd)
+{
+    const SizeValueType planeSize = m_Size[0] * m_Size[1];
+    for (SizeValueType n=zBegin*planeSize; n<zEnd*planeSize; ++n)
     {
-        vnl_matrix<Precision> H(3,3);
-        H(0,0) = itxx.Value();
-        H(0,1) = H(1,0) = itxy.Value();
-        H(0,2) = H(2,0) = itxz.Value();
-        H(1,1) = ityy.Value();
-        H(1,2) = H(2,1) = ityz.Value();
-        H(2,2) = itzz.Value();
+        if (m_BandActive && !m_Band[n])
+        {
+            continue;
+        }
+        Precision *t = &m_Tensors[6*n];
+        t[0] = NumericTraits<Precision>::One;
+        t[1] = NumericTraits<Precision>::Zero;
+        t[2] = NumericTraits<Precision>::Zero;
+        t[3] = NumericTraits<Precision>::One;
+        t[4] = NumericTraits<Precision>::Zero;
+        t[5] = NumericTraits<Precision>::One;
+        m_Vesselness[n] = NumericTraits<Precision>::Zero;
+    }
+}
+// threadedvesselness
+template <class PixelType, unsigned int Dimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::ThreadedVesselness(const HessianPixelType *hessian, SizeValueType zBegin, SizeValueType zEnd)
+{
+    const SizeValueType planeSize = m_Size[0] * m_Size[1];
+    for (SizeValueType n=zBegin*planeSize; n<zEnd*planeSize; ++n)
+    {
+        if (m_BandActive && !m_Band[n])
+        {
+            continue;
+        }
+
+        const HessianPixelType &h = hessian[n];
+
+        // eigenvalues only, in closed form
+        Precision ev[3];
+        vnl_symmetric_eigensystem_compute_eigenvals(h(0,0), h(0,1), h(0,2), h(1,1), h(1,2), h(2,2),
+                                                    ev[0], ev[1], ev[2]);
+
+        if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+        if ( vcl_abs(ev[1]) > vcl_abs(ev[2])  ) std::swap(ev[1], ev[2]);
+        if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+
+        const Precision vesselness = VesselnessFunction3D(ev[0],ev[1],ev[2]);
+
+        if ( vesselness > 0 && vesselness > m_Vesselness[n] )
+        {
+            m_Vesselness[n] = vesselness;
+
+            Precision *t = &m_Tensors[6*n];
+            t[0] = h(0,0);
+            t[1] = h(0,1);
+            t[2] = h(0,2);
+            t[3] = h(1,1);
+            t[4] = h(1,2);
+            t[5] = h(2,2);
+        }
+    }
+}
+// threadeddiffusiontensor
+template <class PixelType, unsigned int Dimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::ThreadedDiffusionTensor(SizeValueType zBegin, SizeValueType zEnd)
+{
+    const SizeValueType planeSize = m_Size[0] * m_Size[1];
+    const Precision exponent = static_cast<Precision>(1.0/m_Sensitivity);
+
+    vnl_matrix<Precision> H(3,3);
+    vnl_matrix<Precision> EV(3,3);
+    vnl_matrix<Precision> LAM(3,3);
+    LAM.fill(0);
+
+    for (SizeValueType n=zBegin*planeSize; n<zEnd*planeSize; ++n)
+    {
+        if (m_BandActive && !m_Band[n])
+        {
+            continue;
+        }
+
+        Precision *t = &m_Tensors[6*n];
+        H(0,0) = t[0];
+        H(0,1) = H(1,0) = t[1];
+        H(0,2) = H(2,0) = t[2];
+        H(1,1) = t[3];
+        H(1,2) = H(2,1) = t[4];
+        H(2,2) = t[5];
 
         vnl_symmetric_eigensystem<Precision> ES(H);
 
-        vnl_matrix<Precision> EV(3,3);
         EV.set_column(0,ES.get_eigenvector(0));
         EV.set_column(1,ES.get_eigenvector(1));
         EV.set_column(2,ES.get_eigenvector(2));
 
-        vnl_vector<Precision> ev(3);
+        Precision ev[3];
         ev[0] = ES.get_eigenvalue(0);
         ev[1] = ES.get_eigenvalue(1);
         ev[2] = ES.get_eigenvalue(2);
@@ -623,32 +417,120 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
         if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
 
         const Precision V=VesselnessFunction3D(ev[0],ev[1],ev[2]);
-        vnl_vector<Precision> evn(3);
+        const Precision Vs=vcl_pow(V,exponent);
 
         // adjusting eigenvalues
-        // static_cast required to prevent error with gcc 4.1.2
-        evn[0]   = 1.0 + (m_Epsilon - 1.0) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity));
-        evn[1]   = 1.0 + (m_Epsilon - 1.0) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity)); 
-        evn[2]   = 1.0 + (m_Omega - 1.0 ) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity)); 
-
-        vnl_matrix<Precision> LAM(3,3);
-        LAM.fill(0);
-        LAM(0,0) = evn[0];
-        LAM(1,1) = evn[1];
-        LAM(2,2) = evn[2];
+        LAM(0,0) = 1.0 + (m_Epsilon - 1.0) * Vs;
+        LAM(1,1) = 1.0 + (m_Epsilon - 1.0) * Vs;
+        LAM(2,2) = 1.0 + (m_Omega - 1.0 ) * Vs;
 
         const vnl_matrix<Precision> HN = EV * LAM * EV.transpose();
 
-        itxx.Value() = HN(0,0);
-        itxy.Value() = HN(0,1);
-        itxz.Value() = HN(0,2);
-        ityy.Value() = HN(1,1);
-        ityz.Value() = HN(1,2);
-        itzz.Value() = HN(2,2);
+        t[0] = HN(0,0);
+        t[1] = HN(0,1);
+        t[2] = HN(0,2);
+        t[3] = HN(1,1);
+        t[4] = HN(1,2);
+        t[5] = HN(2,2);
     }
-    return;
+}
+// threadeddiffusion
+template <class PixelType, unsigned int Dimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::ThreadedDiffusion(const Precision *image, SizeValueType zBegin, SizeValueType zEnd)
+{
+    const SizeValueType nx = m_Size[0], ny = m_Size[1], nz = m_Size[2];
+    const OffsetValueType sy = static_cast<OffsetValueType>(nx);
+    const OffsetValueType sz = static_cast<OffsetValueType>(nx * ny);
 
-} 
+    // fixed weights (timers)
+    const typename PrecisionImageType::SpacingType ispacing = this->GetInput()->GetSpacing();
+    const Precision rxx = m_TimeStep / (2.0 * ispacing[0] * ispacing[0]);
+    const Precision ryy = m_TimeStep / (2.0 * ispacing[1] * ispacing[1]);
+    const Precision rzz = m_TimeStep / (2.0 * ispacing[2] * ispacing[2]);
+    const Precision rxy = m_TimeStep / (4.0 * ispacing[0] * ispacing[1]);
+    const Precision rxz = m_TimeStep / (4.0 * ispacing[0] * ispacing[2]);
+    const Precision ryz = m_TimeStep / (4.0 * ispacing[1] * ispacing[2]);
+
+    const Precision *T = &m_Tensors[0];
+    Precision *d = &m_Update[0];
+
+    for (SizeValueType z=zBegin; z<zEnd; ++z)
+    {
+        // zeroflux boundary condition: neighbours outside
+        // the image are replaced by the nearest voxel
+        const OffsetValueType zm = z > 0 ? -sz : 0;
+        const OffsetValueType zp = z < nz-1 ? sz : 0;
+        for (SizeValueType y=0; y<ny; ++y)
+        {
+            const OffsetValueType ym = y > 0 ? -sy : 0;
+            const OffsetValueType yp = y < ny-1 ? sy : 0;
+            for (SizeValueType x=0; x<nx; ++x)
+            {
+                const OffsetValueType xm = x > 0 ? -1 : 0;
+                const OffsetValueType xp = x < nx-1 ? 1 : 0;
+                const OffsetValueType n = x + sy * y + sz * z;
+
+                // packed tensors and values, indexed by the offset of the neighbour
+                const Precision *tn = T + 6 * n;
+                const Precision *in = image + n;
+
+                // weights
+                const Precision wxp = tn[6*xp+0] + tn[0];
+                const Precision wxm = tn[6*xm+0] + tn[0];
+                const Precision wyp = tn[6*yp+3] + tn[3];
+                const Precision wym = tn[6*ym+3] + tn[3];
+                const Precision wzp = tn[6*zp+5] + tn[5];
+                const Precision wzm = tn[6*zm+5] + tn[5];
+
+                const Precision xpyp =   tn[6*(xp+yp)+1] + tn[1];
+                const Precision xmym =   tn[6*(xm+ym)+1] + tn[1];
+                const Precision xpym = - tn[6*(xp+ym)+1] - tn[1];
+                const Precision xmyp = - tn[6*(xm+yp)+1] - tn[1];
+
+                const Precision xpzp =   tn[6*(xp+zp)+2] + tn[2];
+                const Precision xmzm =   tn[6*(xm+zm)+2] + tn[2];
+                const Precision xpzm = - tn[6*(xp+zm)+2] - tn[2];
+                const Precision xmzp = - tn[6*(xm+zp)+2] - tn[2];
+
+                const Precision ypzp =   tn[6*(yp+zp)+4] + tn[4];
+                const Precision ymzm =   tn[6*(ym+zm)+4] + tn[4];
+                const Precision ypzm = - tn[6*(yp+zm)+4] - tn[4];
+                const Precision ymzp = - tn[6*(ym+zp)+4] - tn[4];
+
+                // evolution
+                const Precision cv = in[0];
+                d[n] = cv
+                    + rxx * ( wxp * (in[xp] - cv)
+                            + wxm * (in[xm] - cv) )
+                    + ryy * ( wyp * (in[yp] - cv)
+                            + wym * (in[ym] - cv) )
+                    + rzz * ( wzp * (in[zp] - cv)
+                            + wzm * (in[zm] - cv) )
+                    + rxy * ( xpyp * (in[xp+yp] - cv)
+                            + xmym * (in[xm+ym] - cv)
+                            + xpym * (in[xp+ym] - cv)
+                            + xmyp * (in[xm+yp] - cv) )
+                    + rxz * ( xpzp * (in[xp+zp] - cv)
+                            + xmzm * (in[xm+zm] - cv)
+                            + xpzm * (in[xp+zm] - cv)
+                            + xmzp * (in[xm+zp] - cv) )
+                    + ryz * ( ypzp * (in[yp+zp] - cv)
+                            + ymzm * (in[ym+zm] - cv)
+                            + ypzm * (in[yp+zm] - cv)
+                            + ymzp * (in[ym+zp] - cv) );
+            }
+        }
+    }
+}
+// threadedcopy
+template <class PixelType, unsigned int Dimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::ThreadedCopy(Precision *image, SizeValueType zBegin, SizeValueType zEnd)
+{
+    const SizeValueType planeSize = m_Size[0] * m_Size[1];
+    std::copy(m_Update.begin() + zBegin * planeSize, m_Update.begin() + zEnd * planeSize, image + zBegin * planeSize);
+}
 // generatedata
 template <class PixelType, unsigned int Dimension>
 void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
@@ -707,6 +589,11 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
 
     typename PrecisionImageType::Pointer ci = cast->GetOutput();
 
+    m_Size = ci->GetBufferedRegion().GetSize();
+    m_Tensors.clear();
+    m_Vesselness.clear();
+    m_Band.clear();
+    m_BandActive = false;
 
     if (m_Verbose)
     {
@@ -718,6 +605,12 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
         VED3DSingleIteration (ci);
     } 
 
+    // release the working buffers
+    std::vector<Precision>().swap(m_Tensors);
+    std::vector<Precision>().swap(m_Vesselness);
+    std::vector<unsigned char>().swap(m_Band);
+    std::vector<Precision>().swap(m_Update);
+
     typedef MinimumMaximumImageFilter<PrecisionImageType> MMT;
     typename MMT::Pointer mm = MMT::New();
     mm->SetInput(ci);
@@ -188,6 +188,16 @@ class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkVesselEnhancingDiffusion3DImageFilter
     DelegateITKInputMacro(SetRecalculateVesselness,value);
   }
 
+  /**
+   * Set whether vesselness recalculations after the first one are restricted to a narrow band
+   * around the voxels that had a positive vesselness, delegated directly to the underlying ITK
+   * filter (no local caching or corresponding getter).
+   */
+  void SetUseNarrowBand(int value)
+  {
+    DelegateITKInputMacro(SetUseNarrowBand,value != 0);
+  }
+
   /**
    * Compute the sigma value for the given 0-based scale level, according to SigmaStepMethod, between
    * SigmaMin and SigmaMax over NumberOfSigmaSteps steps. Used internally by Update() to build the